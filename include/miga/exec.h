@@ -27,6 +27,7 @@
 #include "miga/migaconf.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #ifdef MIGA_POSIX_API
 #include <sys/resource.h>
@@ -85,11 +86,16 @@ MIGA_API bool exec_set_args(miga_exec_t *executor, const strlist_t *args);
 MIGA_API bool exec_set_args_cstr(miga_exec_t *executor, int argc,
                                  char *const *argv);
 
+/* exec_set_envp_cstr() copies the array. The shell reads inherited variables
+ * from it on demand, so exec_set_envp_cstr_borrowed(), which skips the copy,
+ * requires the array and its strings to stay valid and unchanged while the
+ * executor exists -- as main()'s envp does. */
 MIGA_API bool exec_is_envp_set(const miga_exec_t *executor);
 MIGA_API const strlist_t *exec_get_envp(const miga_exec_t *executor);
 MIGA_API char *const *exec_get_envp_cstr(const miga_exec_t *executor);
 MIGA_API bool exec_set_envp(miga_exec_t *executor, const strlist_t *envp);
 MIGA_API bool exec_set_envp_cstr(miga_exec_t *executor, char *const *envp);
+MIGA_API bool exec_set_envp_cstr_borrowed(miga_exec_t *executor, char *const *envp);
 
 /* ── Shell identity ──────────────────────────────────────────────────────── */
 
@@ -191,6 +197,9 @@ MIGA_API bool exec_is_process_group_set(const miga_exec_t *executor);
 MIGA_API int exec_get_process_group(const miga_exec_t *executor);
 MIGA_API bool exec_set_process_group(miga_exec_t *executor, int pgid);
 
+/* Unlike most startup settings, the shell's PID and PPID may also be changed
+ * after setup, by a host that forks a set-up executor to act as a new shell
+ * rather than as a subshell (as mgsh --worker does for each job). */
 MIGA_API bool exec_is_shell_pid_set(const miga_exec_t *executor);
 MIGA_API int exec_get_shell_pid(const miga_exec_t *executor);
 MIGA_API bool exec_set_shell_pid(miga_exec_t *executor, int pid);
@@ -479,6 +488,152 @@ MIGA_API miga_exec_status_t exec_execute_named_stream(miga_exec_t *executor, FIL
 MIGA_API miga_exec_result_t exec_execute_command_string(miga_exec_t *executor,
                                                    const char *command);
 
+/* ── Compiled programs ───────────────────────────────────────────────────── */
+
+/**
+ * Opaque handle for shell text that has been lexed, parsed and lowered once
+ * so that it can be executed any number of times.
+ *
+ * Aliases are expanded while compiling, using the compiling executor's
+ * aliases at that moment; later alias and unalias commands do not change a
+ * compiled program.  A program is never modified once compiled, so one
+ * program may be run by several executors, including from several threads
+ * at once.
+ */
+typedef struct miga_program_t miga_program_t;
+
+/**
+ * Compile a complete command string.
+ *
+ * Incomplete input (unclosed quotes, missing keywords) is an error.  Text
+ * holding no commands compiles to a program that does nothing.
+ *
+ * @param executor  Supplies the aliases and receives any error message.
+ * @param text      The complete command string.
+ * @return A new program, or NULL on error (see exec_get_error_cstr()).
+ *         Release it with miga_program_free().
+ */
+MIGA_API miga_program_t *exec_compile_cstr(miga_exec_t *executor, const char *text);
+
+/**
+ * Compile everything that can be read from a stream, as exec_compile_cstr().
+ */
+MIGA_API miga_program_t *exec_compile_stream(miga_exec_t *executor, FILE *fp);
+
+/**
+ * Execute a compiled program at top level, as exec_execute_command_string()
+ * would execute the text it was compiled from.
+ *
+ * @param executor  The executor.  It need not be the one that compiled the
+ *                  program.
+ * @param program   The program.
+ * @return Result with status and exit code.
+ */
+MIGA_API miga_exec_result_t exec_run_program(miga_exec_t *executor,
+                                             const miga_program_t *program);
+
+/**
+ * Release a compiled program and set the pointer to NULL.  No executor may
+ * still be running it.  Safe to call with NULL or *program == NULL.
+ */
+MIGA_API void miga_program_free(miga_program_t **program);
+
+/* ── Snapshots ───────────────────────────────────────────────────────────── */
+
+/**
+ * Opaque, frozen copy of an executor's top-level shell state: variables,
+ * positional parameters, functions, aliases, traps, options, umask, working
+ * directory and last exit status.
+ *
+ * A host that evaluates many short scripts can set an executor up once
+ * (define functions, source a library, set options), take a snapshot, and
+ * then create a fresh, isolated executor from it for every script instead of
+ * repeating that setup.  Function bodies are shared between the snapshot and
+ * every executor cloned from it rather than copied.  A snapshot is never
+ * modified once taken, so several threads may clone from it at once.
+ */
+typedef struct miga_snapshot_t miga_snapshot_t;
+
+/**
+ * Freeze the top-level state of an executor.
+ *
+ * The executor is set up first if it has not been already.  It must not be
+ * executing (the current frame must be the top frame).  The executor is not
+ * changed and may go on being used or be destroyed; the snapshot does not
+ * refer to it.
+ *
+ * @return A new snapshot, or NULL if the executor is executing.
+ *         Release it with exec_snapshot_destroy().
+ */
+MIGA_API miga_snapshot_t *exec_snapshot(miga_exec_t *executor);
+
+/**
+ * Create a new, fully set-up executor whose top-level state is a copy of the
+ * snapshot.  Changes made by the new executor are not seen by the snapshot or
+ * by other executors cloned from it.  Startup (rc) files are not sourced
+ * again and the process environment is not imported again.
+ *
+ * @return A new executor; release it with exec_destroy().
+ */
+MIGA_API miga_exec_t *exec_clone_from_snapshot(const miga_snapshot_t *snapshot);
+
+/**
+ * Release a snapshot and set the pointer to NULL.  Executors cloned from it
+ * are unaffected.  Safe to call with NULL or *snapshot == NULL.
+ */
+MIGA_API void exec_snapshot_destroy(miga_snapshot_t **snapshot);
+
+/* ── Resumable execution ─────────────────────────────────────────────────── */
+
+/*
+ * The entry points above block the calling thread until the script is done,
+ * including while it waits for child processes.  A host driving many scripts
+ * from one event loop can instead start a script with exec_start().  Whenever
+ * the script would wait for a child (a command, pipeline, subshell, command
+ * substitution or `wait PID`), it is suspended and MIGA_EXEC_STATUS_PENDING is
+ * returned.  The host then polls the descriptor from exec_poll() along with
+ * its other work and calls exec_resume() once it is ready, until some other
+ * status is returned.
+ *
+ * A suspended script keeps its own stack, so any number of executors can have
+ * a script pending at once.  While one is pending, no other entry point may
+ * be called on that executor; the exec_execute_*() functions and
+ * exec_run_program() refuse, returning MIGA_EXEC_STATUS_ERROR.  exec_resume()
+ * may be called from another thread than exec_start(), but not from two at
+ * once.
+ *
+ * Where the platform cannot suspend a script, exec_start() runs it to
+ * completion.  Waits that have no descriptor to poll (job control, or any
+ * wait where the system lacks pidfds) block as usual.
+ */
+
+/**
+ * Start executing a complete command string, as exec_execute_command_string()
+ * would, and run it until it finishes or must wait.
+ *
+ * @return Result with status MIGA_EXEC_STATUS_PENDING if the script is
+ *         waiting, otherwise the script's final result.
+ */
+MIGA_API miga_exec_result_t exec_start(miga_exec_t *executor, const char *command);
+
+/**
+ * Report what a pending script is waiting for.
+ *
+ * @param fd      Receives a descriptor to poll (may be NULL).  It belongs to
+ *                the executor and is only valid until the next exec_resume().
+ * @param events  Receives the poll() events to wait for (may be NULL).
+ * @return true if a script is pending, false otherwise.
+ */
+MIGA_API bool exec_poll(const miga_exec_t *executor, int *fd, short *events);
+
+/**
+ * Continue a pending script until it finishes or must wait again.  Resuming
+ * before the descriptor is ready is harmless: the script is suspended again.
+ *
+ * @return As exec_start(); an error if no script is pending.
+ */
+MIGA_API miga_exec_result_t exec_resume(miga_exec_t *executor);
+
 /* ── Partial / incremental string execution ──────────────────────────────── */
 
 /**
@@ -632,6 +787,74 @@ exec_execute_stream_with_line_editor(miga_exec_t *executor, FILE *fp,
                                      line_editor_fn_t line_editor_fn,
                                      void *line_editor_user_data);
 
+/**
+ * Complete the first word of a command line.
+ *
+ * Returns the command names that start with @p prefix: executables in the
+ * absolute directories of PATH, builtins, functions and aliases.  The names
+ * are sorted bytewise and each appears once.
+ *
+ * The executor keeps an index of the names, built on the first call.  Later
+ * calls only read again the PATH directories whose modification time has
+ * changed, so a line editor can call this on every TAB.
+ *
+ * @param executor  The executor.
+ * @param prefix    The word typed so far (may be empty).
+ * @return A new list of names; free it with strlist_destroy().
+ */
+MIGA_API strlist_t *exec_complete_prefix(miga_exec_t *executor, const char *prefix);
+
+/**
+ * Open the command history kept in @p path.
+ *
+ * The file is an append-only log with one entry per line; a second file,
+ * @p path with ".idx" appended, holds the offset of each entry.  Both are
+ * mapped into memory rather than read, so opening takes the same time
+ * however long the history is.  Several shells may append to the same file
+ * at once.
+ *
+ * Without a call to this function, the history is opened on first use from
+ * HISTFILE, or kept in memory when HISTFILE is unset or empty.
+ *
+ * @param executor  The executor.
+ * @param path      History file, or NULL to keep the history in memory.
+ * @return false if the file cannot be opened; the history is then kept in
+ *         memory.
+ */
+MIGA_API bool exec_history_open(miga_exec_t *executor, const char *path);
+
+/**
+ * Append @p line to the command history.
+ *
+ * exec_execute_stream_with_line_editor() adds every non-empty line it
+ * reads.
+ *
+ * @return false if the history file could not be written.
+ */
+MIGA_API bool exec_history_add(miga_exec_t *executor, const char *line);
+
+/**
+ * Number of entries in the command history.
+ */
+MIGA_API long exec_history_count(miga_exec_t *executor);
+
+/**
+ * Entry @p n of the command history, 0 being the oldest.
+ *
+ * @return A new string, or NULL if there is no such entry.
+ */
+MIGA_API string_t *exec_history_get(miga_exec_t *executor, long n);
+
+/**
+ * Search the command history backwards.
+ *
+ * @param executor  The executor.
+ * @param text      Text the entry must contain.
+ * @param before    Start below this entry; negative to start at the newest.
+ * @return The newest matching entry before @p before, or -1.
+ */
+MIGA_API long exec_history_search(miga_exec_t *executor, const char *text, long before);
+
 /* ============================================================================
  * Global State Queries
  * ============================================================================ */
@@ -929,6 +1152,127 @@ MIGA_API int exec_wait_for_pid(miga_exec_t *executor, int pid);
  */
 MIGA_API int exec_wait_for_all(miga_exec_t *executor);
 
+/**
+ * Wait for any one background job to complete.
+ *
+ * If a background job has already completed but its status has not yet
+ * been reported, that job is reported immediately.  Otherwise blocks until
+ * the next background job finishes.  The reported job is removed from the
+ * job table.  This is the mechanism behind `wait -n`.
+ *
+ * @param executor    The executor.
+ * @param job_id_out  If non-NULL, receives the ID of the job that completed.
+ * @return The exit status of the last process in the completed job, or -1
+ *         if there are no background jobs to wait for.
+ */
+MIGA_API int exec_wait_for_any(miga_exec_t *executor, int *job_id_out);
+
+/* ── Background job pool ─────────────────────────────────────────────────── */
+
+/**
+ * Limit the number of background jobs that may run concurrently.
+ *
+ * When the limit is reached, starting another asynchronous list (`cmd &`)
+ * blocks until a running background job finishes.  A limit of 0 (the
+ * default) means unlimited, which is the POSIX behaviour.
+ *
+ * @param executor  The executor.
+ * @param max_jobs  The new limit, or 0 for unlimited.  Negative values are
+ *                  rejected.
+ * @return true if the limit was applied.
+ */
+MIGA_API bool exec_set_jobs_max(miga_exec_t *executor, int max_jobs);
+MIGA_API int exec_get_jobs_max(const miga_exec_t *executor);
+
+/**
+ * Return a sensible default job limit for this machine: the number of
+ * online processors, or 1 if that cannot be determined.
+ */
+MIGA_API int exec_get_default_jobs_max(void);
+
+/**
+ * Block until the number of running background jobs is below the limit
+ * set with exec_set_jobs_max().  Returns immediately if no limit is set.
+ *
+ * Called by the executor before starting each background job; embedders
+ * that launch their own children through the job table may call it too.
+ */
+MIGA_API void exec_wait_for_job_slot(miga_exec_t *executor);
+
+/* ── Profiling ───────────────────────────────────────────────────────────── */
+
+/**
+ * Start recording where the shell spends its time.
+ *
+ * Wall and CPU time are charged to source lines and to the stack of shell
+ * function calls, with time spent in word expansion, builtins, fork() and
+ * waiting for children recorded as separate leaf frames.  When profiling
+ * stops, two files are written: @p path holds folded stacks that
+ * flamegraph.pl can render, and @p path with ".lines" appended lists
+ * source lines by descending wall time.
+ *
+ * This is what `migash --profile=FILE` and `set -o profile` use.
+ *
+ * @param executor  The executor.
+ * @param path      Output file, or NULL to reuse the previous path (or
+ *                  "miga-profile.folded" if there is none).
+ * @return true if profiling is active on return.
+ */
+MIGA_API bool exec_start_profile(miga_exec_t *executor, const char *path);
+
+/**
+ * Stop profiling and write the results.
+ *
+ * Called automatically when the executor is destroyed or the shell exits.
+ *
+ * @return false if profiling was not active or the files could not be
+ *         written.
+ */
+MIGA_API bool exec_stop_profile(miga_exec_t *executor);
+
+MIGA_API bool exec_is_profiling(const miga_exec_t *executor);
+
+/* ── Statistics ──────────────────────────────────────────────────────────── */
+
+/**
+ * Running totals of the work an executor has done since it was created or
+ * since the last exec_reset_stats().  The counters are plain integers
+ * bumped on the hot paths, so they are always on.
+ *
+ * Work done inside forked children (subshells, pipeline members, command
+ * substitutions) is counted by the child and is not reflected here; the
+ * parent counts the fork, the pipes and the wait.
+ */
+typedef struct miga_exec_stats_t
+{
+    uint64_t forks;                 /**< Child processes created */
+    uint64_t execs;                 /**< External commands launched */
+    uint64_t pipes;                 /**< Pipes created (pipelines, here-documents, $(...)) */
+    uint64_t waits;                 /**< Children reaped */
+    uint64_t command_substitutions; /**< $(...) and `...` expansions */
+    uint64_t glob_expansions;       /**< Pathname expansions attempted */
+    uint64_t frame_pushes;          /**< Execution frames created */
+    uint64_t variable_lookups;      /**< Variable store lookups */
+    uint64_t variable_inserts;      /**< Variable store assignments */
+    uint64_t envp_rebuilds;         /**< Environment arrays rebuilt for exec */
+    uint64_t bytes_allocated;       /**< Bytes requested from the allocator */
+    uint64_t parse_ns;              /**< Time spent lexing, parsing and lowering */
+    uint64_t exec_ns;               /**< Time spent executing parsed commands */
+} miga_exec_stats_t;
+
+/**
+ * Copy the executor's counters into @p out.
+ *
+ * Allocator activity is that of the executor's own arena, and variable store
+ * activity that of the stores belonging to the executor's frames.
+ */
+MIGA_API void exec_get_stats(const miga_exec_t *executor, miga_exec_stats_t *out);
+
+/**
+ * Set all counters back to zero.
+ */
+MIGA_API void exec_reset_stats(miga_exec_t *executor);
+
 MIGA_EXTERN_C_END
 
 #endif /* MIGA_EXEC_H */
@@ -127,15 +127,28 @@ MIGA_API miga_var_status_t frame_set_variable_cstr(miga_frame_t *frame,
 
 /**
  * Sets a non-temporary variable in the variable store associated with the
- * current frame.  Even if the frame normally acts on a temporary variable
- * store to execute a simple command, this will add the variable as
- * non-temporary.
+ * current frame.  Prefix assignments on a simple command are written to the
+ * same store and reverted when the command finishes, so this behaves like
+ * frame_set_variable() except for a variable that was itself given as a
+ * prefix assignment, which still reverts.
  */
 MIGA_API miga_var_status_t frame_set_persistent_variable(miga_frame_t *frame, const string_t *name,
                                                 const string_t *value);
 MIGA_API miga_var_status_t frame_set_persistent_variable_cstr(miga_frame_t *frame, const char *name,
                                                      const char *value);
 
+/**
+ * Makes a variable local to the nearest enclosing function, as the 'local'
+ * builtin does.  The variable's current value and attributes are restored
+ * when that function returns.  If value is NULL the variable keeps its
+ * current value (or stays unset); otherwise it is set to value.  Returns
+ * MIGA_VAR_STATUS_NOT_FOUND if no function is executing,
+ * MIGA_VAR_STATUS_READ_ONLY if the variable is read-only, or
+ * MIGA_VAR_STATUS_OK on success.
+ */
+MIGA_API miga_var_status_t frame_declare_local_variable(miga_frame_t *frame, const string_t *name,
+                                                        const string_t *value);
+
 /**
  * Updates the export status of an existing variable in the variable store
  * associated with the current frame.  If the variable does not exist, this
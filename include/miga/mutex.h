@@ -2,7 +2,7 @@
 #define MIGA_MUTEX_H
 
 /**
- * Cross-platform recursive mutex abstraction.
+ * Cross-platform recursive mutex abstraction, plus MIGA_THREAD_LOCAL.
  *
  * Selection order:
  *   1. MIGA_POSIX_API defined          → pthread_mutex_t (recursive)
@@ -167,6 +167,22 @@ static inline void miga_mutex_destroy(miga_mutex_t *mtx)
 
 #endif /* platform selection */
 
+/* ------------------------------------------------------------------ */
+/* Thread-local storage                                               */
+/* ------------------------------------------------------------------ */
+
+/*
+ * MIGA_THREAD_LOCAL gives each thread its own copy of a static variable.
+ * Without threads it is empty and the variable is an ordinary static.
+ */
+#if defined(_MSC_VER)
+#define MIGA_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_NO_THREADS__) && !defined(MIGA_POSIX_API) && !defined(MIGA_UCRT_API)
+#define MIGA_THREAD_LOCAL
+#else
+#define MIGA_THREAD_LOCAL _Thread_local
+#endif
+
 MIGA_EXTERN_C_END
 
 #endif /* MIGA_MUTEX_H */
\ No newline at end of file
@@ -42,9 +42,10 @@ static const int STRING_REDUCE_THRESHOLD = 512;
 
 typedef struct string_t
 {
-    int length;
-    int capacity;
+    ptrdiff_t length;   // Wider than the int API so command output can pass 2 GiB
+    ptrdiff_t capacity;
     char *data;
+    uint32_t hash; // Cached string_hash(), 0 until computed; cleared by every modifier
     char inline_data[STRING_T_INITIAL_CAPACITY]; // Small string optimization. Length must be same as INITIAL_CAPACITY.
 } string_t;
 
@@ -187,6 +188,8 @@ MIGA_API char string_back(const string_t *str);
 /*
  * Returns a pointer to the internal mutable character data.
  * It is up to the caller to not be stupid and not modify beyond the string's length.
+ * Clears the cached hash; call it again rather than keeping the pointer if the
+ * string is hashed between writes.
  */
 MIGA_API char *string_data(string_t *x);
 
@@ -210,15 +213,16 @@ MIGA_API bool string_empty(const string_t *str);
 
 /*
  * Returns the length of the string, not including the null terminator.
+ * A string longer than INT_MAX reports INT_MAX; use string_size() for the
+ * full length.
  */
 MIGA_API int string_length(const string_t *str);
 
 /*
- * An alias for string_length(). string_length() is preferred.
+ * Returns the full length of the string as a size_t. Unlike string_length(),
+ * this is exact for strings past 2 GiB, such as large command output.
  */
-static inline int string_size(const string_t *str) {
-    return string_length(str);
-}
+MIGA_API size_t string_size(const string_t *str);
 
 /*
  * Increases the capacity of the string to at least new_cap, without changing its length.
@@ -725,7 +729,9 @@ MIGA_API string_t *string_from_double(double value);
 
 // Hash function
 /*
- * Computes a hash value for the string.
+ * Computes a hash value for the string (32-bit FNV-1a, never 0).
+ * The result is cached in the string and reused until the string is modified,
+ * so repeated lookups with the same key hash it only once.
  */
 MIGA_API uint32_t string_hash(const string_t *str);
 
@@ -144,6 +144,16 @@ MIGA_API void strlist_push_back(strlist_t *list, const string_t *str);
  */
 MIGA_API void strlist_move_push_back(strlist_t *list, string_t **str);
 
+/**
+ * Moves every string of another list onto the end of this one, taking
+ * ownership of them. No strings are copied. After this operation *other
+ * is destroyed and set to NULL.
+ *
+ * @param list The string list
+ * @param other Pointer to the list to drain (if NULL or *other is NULL, does nothing)
+ */
+MIGA_API void strlist_move_extend(strlist_t *list, strlist_t **other);
+
 /**
  * Inserts a copy of the string into the list at the given index.
  * Index is clamped to [0, size]. If index equals size, this is a simple append.
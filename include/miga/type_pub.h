@@ -32,7 +32,8 @@ typedef enum miga_exec_status_t
     MIGA_EXEC_STATUS_NOT_IMPL = 2,   /* Feature not implemented                     */
     MIGA_EXEC_STATUS_INCOMPLETE = 3, /* Input ended but command was incomplete      */
     MIGA_EXEC_STATUS_EMPTY = 4,      /* No commands to execute (empty/comment-only) */
-    MIGA_EXEC_STATUS_EXIT = 5        /* Exit requested (shell is done)              */
+    MIGA_EXEC_STATUS_EXIT = 5,       /* Exit requested (shell is done)              */
+    MIGA_EXEC_STATUS_PENDING = 6     /* Waiting; see exec_poll() and exec_resume()   */
 } miga_exec_status_t;
 
 /* This structure describes the outcome of an attempt to execute input data
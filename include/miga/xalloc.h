@@ -3,6 +3,7 @@
 
 #include <setjmp.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "miga/api.h"
@@ -53,6 +54,7 @@ typedef struct miga_arena_t
     long max_allocations; // maximum number of allocations allowed
     miga_arena_resource_cleanup_fn resource_cleanup;
     void *resource_cleanup_user_data;
+    uint64_t bytes_allocated; // running total of bytes requested; never reset
 } miga_arena_t;
 
 // Access to global singleton arena for use in miga_setjmp() macro
@@ -108,13 +110,51 @@ MIGA_API void miga_arena_reset(void);
  */
 MIGA_API void miga_arena_end(void);
 
-#ifndef MIGA_HIDE_LOCALS    
+/**
+ * Total number of bytes requested from the global arena since the process
+ * started, counting each realloc at its new size.  Freed memory is not
+ * subtracted.  Used for the executor statistics.
+ */
+MIGA_API uint64_t miga_arena_bytes_allocated(void);
+
+/**
+ * Create an arena of its own, for example one per executor so that executors
+ * running on different threads do not contend on the global arena's lock.
+ * Nothing allocates from it until it is made current with
+ * miga_arena_set_current().  Never fails: aborts if out of memory.
+ */
+MIGA_API miga_arena_t *miga_arena_create(void);
+
+/**
+ * Free everything still allocated from an arena made by miga_arena_create(),
+ * then the arena itself, and set the pointer to NULL.  If the arena is the
+ * calling thread's current arena, the thread goes back to the global arena.
+ */
+MIGA_API void miga_arena_destroy(miga_arena_t **arena);
+
+/**
+ * The arena that xmalloc and friends use on the calling thread: the one
+ * last passed to miga_arena_set_current() on this thread, or the global arena.
+ */
+MIGA_API miga_arena_t *miga_arena_get_current(void);
+
+/**
+ * Make @p arena the calling thread's current arena; NULL means the global
+ * arena.  Returns the previous current arena, for restoring it afterwards.
+ *
+ * xfree and xrealloc accept memory from any arena: memory is always freed
+ * back to, and reallocated within, the arena that allocated it.
+ */
+MIGA_API miga_arena_t *miga_arena_set_current(miga_arena_t *arena);
+
+#ifndef MIGA_HIDE_LOCALS
+
 /**
  * Allocate memory tracked by the arena.
  * On allocation failure, triggers a longjmp to the arena rollback point.
  */
 #ifdef MIGA_ARENA_DEBUG
-#define xmalloc(size) arena_xmalloc(miga_arena_get_global(), (size), __FILE__, __LINE__)
+#define xmalloc(size) arena_xmalloc(miga_arena_get_current(), (size), __FILE__, __LINE__)
 #else
 MIGA_LOCAL void *xmalloc(size_t size);
 #endif
@@ -124,7 +164,7 @@ MIGA_LOCAL void *xmalloc(size_t size);
  * On allocation failure, triggers a longjmp to the arena rollback point.
  */
 #ifdef MIGA_ARENA_DEBUG
-#define xcalloc(n, size) arena_xcalloc(miga_arena_get_global(), (n), (size), __FILE__, __LINE__)
+#define xcalloc(n, size) arena_xcalloc(miga_arena_get_current(), (n), (size), __FILE__, __LINE__)
 #else
 MIGA_LOCAL void *xcalloc(size_t n, size_t size);
 #endif
@@ -137,7 +177,7 @@ MIGA_LOCAL void *xcalloc(size_t n, size_t size);
  */
 #ifdef MIGA_ARENA_DEBUG
 #define xrealloc(old_ptr, new_size)                                                                \
-    arena_xrealloc(miga_arena_get_global(), (old_ptr), (new_size), __FILE__, __LINE__)
+    arena_xrealloc(arena_owner_ex(old_ptr), (old_ptr), (new_size), __FILE__, __LINE__)
 #else
 MIGA_LOCAL void *xrealloc(void *old_ptr, size_t new_size);
 #endif
@@ -147,7 +187,7 @@ MIGA_LOCAL void *xrealloc(void *old_ptr, size_t new_size);
  * On allocation failure, triggers a longjmp to the arena rollback point.
  */
 #ifdef MIGA_ARENA_DEBUG
-#define xstrdup(s) arena_xstrdup(miga_arena_get_global(), (s), __FILE__, __LINE__)
+#define xstrdup(s) arena_xstrdup(miga_arena_get_current(), (s), __FILE__, __LINE__)
 #else
 MIGA_LOCAL char *xstrdup(const char *s);
 #endif
@@ -157,7 +197,7 @@ MIGA_LOCAL char *xstrdup(const char *s);
  * Safe to call with NULL.
  */
 #ifdef MIGA_ARENA_DEBUG
-#define xfree(ptr) arena_xfree(miga_arena_get_global(), (ptr), __FILE__, __LINE__)
+#define xfree(ptr) arena_xfree(arena_owner_ex(ptr), (ptr), __FILE__, __LINE__)
 #else
 MIGA_LOCAL void xfree(void *ptr);
 #endif
@@ -170,7 +210,7 @@ MIGA_LOCAL void xfree(void *ptr);
  * multiple independent arenas and better testability.
  *
  * Note: These are primarily provided for unit testing. General code should use
- * the shorter API like xmalloc and xfree which operate on the global arena.
+ * the shorter API like xmalloc and xfree which operate on the current arena.
  */
 #ifdef MIGA_ARENA_DEBUG
 #define MIGA_ARENA_DEBUG_PARAMS , const char *file, int line
@@ -184,6 +224,13 @@ MIGA_LOCAL void *arena_xrealloc(miga_arena_t *arena, void *old_ptr, size_t new_s
 MIGA_LOCAL char *arena_xstrdup(miga_arena_t *arena, const char *s MIGA_ARENA_DEBUG_PARAMS);
 MIGA_LOCAL void arena_xfree(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS);
 
+/**
+ * The arena that tracks @p p: the current arena, else the global arena or
+ * another arena made by miga_arena_create().  Returns the current arena if
+ * @p p is NULL or no arena tracks it.
+ */
+MIGA_LOCAL miga_arena_t *arena_owner_ex(const void *p);
+
 MIGA_LOCAL void arena_init_ex(miga_arena_t *arena);
 MIGA_LOCAL void arena_set_cleanup_ex(miga_arena_t *arena, miga_arena_resource_cleanup_fn fn, void *user_data);
 MIGA_LOCAL void arena_reset_ex(miga_arena_t *arena);
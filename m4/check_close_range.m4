@@ -0,0 +1,32 @@
+#serial 1
+
+dnl CHECK_CLOSE_RANGE
+dnl Test whether close_range() is available to close a range of
+dnl descriptors in one call (Linux 5.9 with glibc 2.34, FreeBSD 12.2).
+dnl Sets HAVE_CLOSE_RANGE if supported.
+
+AC_DEFUN([CHECK_CLOSE_RANGE],
+[
+  AC_MSG_CHECKING([for close_range])
+
+  AC_CACHE_VAL([ac_cv_close_range],
+    [AC_LINK_IFELSE(
+       [AC_LANG_SOURCE([[
+         #define _GNU_SOURCE
+         #include <unistd.h>
+         int main(void) {
+           return close_range(1000, 1001, 0);
+         }
+       ]])],
+       [ac_cv_close_range=yes],
+       [ac_cv_close_range=no]
+     )]
+  )
+
+  AC_MSG_RESULT([$ac_cv_close_range])
+
+  if test "$ac_cv_close_range" = yes; then
+    AC_DEFINE([HAVE_CLOSE_RANGE], [1],
+      [Define to 1 if close_range() is available.])
+  fi
+])
@@ -3,6 +3,8 @@
 #endif
 
 #include <ctype.h>
+#include <stdint.h>
+#include <string.h>
 
 #define ALIAS_STORE_INTERNAL
 #include "alias_store.h"
@@ -11,6 +13,7 @@
 #include "alias_array.h"
 #include "logging.h"
 #include "miga/xalloc.h"
+#include "store_generation.h"
 
 // Check if a character is valid for an alias name
 static bool is_valid_alias_char(char c)
@@ -52,11 +55,116 @@ static int compare_alias_name_cstr(const alias_t *alias, const void *name)
     return string_compare_cstr(alias_get_name(alias), (const char *)name);
 }
 
+/* ============================================================================
+ * Name index
+ *
+ * Open addressing with linear probing over a power-of-two table. A slot
+ * holds the alias's position in the array plus one, so zero means empty.
+ * Removing an alias shifts every later position down, so removal rebuilds
+ * the index; that is no worse than the shift itself, and unalias is rare.
+ * ============================================================================ */
+
+#define ALIAS_INDEX_INITIAL_CAPACITY 16
+
+// The same function as string_hash(), for C-string names
+static uint32_t hash_name_cstr(const char *name)
+{
+    uint32_t h = 0x811c9dc5;
+    for (const unsigned char *p = (const unsigned char *)name; *p != '\0'; p++)
+    {
+        h ^= *p;
+        h *= 0x01000193;
+    }
+    return h ? h : 1;
+}
+
+static void mark_first_char(alias_store_t *store, char ch)
+{
+    unsigned char c = (unsigned char)ch;
+    store->first_chars[c >> 6] |= UINT64_C(1) << (c & 63);
+}
+
+static bool first_char_may_match(const alias_store_t *store, char ch)
+{
+    unsigned char c = (unsigned char)ch;
+    return (store->first_chars[c >> 6] >> (c & 63)) & 1;
+}
+
+// Put the alias at array position `position` into its slot
+static void index_place(alias_store_t *store, int position)
+{
+    const string_t *name = alias_get_name(alias_array_get(store->aliases, position));
+    uint32_t mask = (uint32_t)store->slot_capacity - 1;
+    uint32_t pos = string_hash(name) & mask;
+
+    while (store->slots[pos] != 0)
+        pos = (pos + 1) & mask;
+
+    store->slots[pos] = position + 1;
+    mark_first_char(store, string_front(name));
+}
+
+static void index_rebuild(alias_store_t *store, int32_t capacity)
+{
+    xfree(store->slots);
+    store->slots = xcalloc(capacity, sizeof(int32_t));
+    store->slot_capacity = capacity;
+    memset(store->first_chars, 0, sizeof(store->first_chars));
+
+    for (int i = 0; i < alias_array_size(store->aliases); i++)
+        index_place(store, i);
+}
+
+// Index a newly appended alias, growing the table past a 75% load
+static void index_add_last(alias_store_t *store)
+{
+    int size = alias_array_size(store->aliases);
+    if (size * 4 > store->slot_capacity * 3)
+        index_rebuild(store, store->slot_capacity * 2);
+    else
+        index_place(store, size - 1);
+}
+
+// Array position of the alias whose name compares equal to `name`, or -1
+static int index_find(const alias_store_t *store, uint32_t hash, const void *name,
+                      alias_array_compare_func_t compare)
+{
+    uint32_t mask = (uint32_t)store->slot_capacity - 1;
+    uint32_t pos = hash & mask;
+
+    while (store->slots[pos] != 0)
+    {
+        int position = store->slots[pos] - 1;
+        alias_t *alias = alias_array_get(store->aliases, position);
+        if (string_hash(alias_get_name(alias)) == hash && compare(alias, name) == 0)
+            return position;
+        pos = (pos + 1) & mask;
+    }
+    return -1;
+}
+
+static int find_alias(const alias_store_t *store, const string_t *name)
+{
+    if (!first_char_may_match(store, string_front(name)))
+        return -1;
+    return index_find(store, string_hash(name), name, compare_alias_name);
+}
+
+static int find_alias_cstr(const alias_store_t *store, const char *name)
+{
+    if (!first_char_may_match(store, name[0]))
+        return -1;
+    return index_find(store, hash_name_cstr(name), name, compare_alias_name_cstr);
+}
+
 // Constructors
 alias_store_t *alias_store_create(void)
 {
-    alias_store_t *store = xmalloc(sizeof(alias_store_t));
+    alias_store_t *store = xcalloc(1, sizeof(alias_store_t));
     store->aliases = alias_array_create();
+    store->slot_capacity = ALIAS_INDEX_INITIAL_CAPACITY;
+    store->slots = xcalloc(store->slot_capacity, sizeof(int32_t));
+    store->generation = store_generation_next();
 
     log_debug("alias_store_create: created store %p", store->aliases);
 
@@ -93,6 +201,7 @@ void alias_store_destroy(alias_store_t **store)
     log_debug("alias_store_destroy: freeing store %p, size %zu", *store,
               alias_array_size((*store)->aliases));
     alias_array_destroy(&((*store)->aliases));
+    xfree((*store)->slots);
     xfree(*store);
     *store = NULL;
 }
@@ -105,10 +214,11 @@ void alias_store_add(alias_store_t *store, const string_t *name, const string_t
     Expects_not_null(value);
 
     // Check if name exists
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name, &index) == 0)
+    store->generation = store_generation_next();
+    int index = find_alias(store, name);
+    if (index >= 0)
     {
-        // Replace existing alias
+        // Replace existing alias; the name, and so the index, is unchanged
         alias_t *new_alias = alias_create(name, value);
         alias_array_set(store->aliases, index, new_alias);
         log_debug("alias_store_add: replaced alias '%s' = '%s'", string_cstr(name),
@@ -119,6 +229,7 @@ void alias_store_add(alias_store_t *store, const string_t *name, const string_t
     // Add new alias
     alias_t *alias = alias_create(name, value);
     alias_array_append(store->aliases, alias);
+    index_add_last(store);
     log_debug("alias_store_add: added alias '%s' = '%s'", string_cstr(name), string_cstr(value));
 }
 
@@ -129,10 +240,11 @@ void alias_store_add_cstr(alias_store_t *store, const char *name, const char *va
     Expects_not_null(value);
 
     // Check if name exists
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name_cstr, &index) == 0)
+    store->generation = store_generation_next();
+    int index = find_alias_cstr(store, name);
+    if (index >= 0)
     {
-        // Replace existing alias
+        // Replace existing alias; the name, and so the index, is unchanged
         alias_t *new_alias = alias_create_from_cstr(name, value);
         alias_array_set(store->aliases, index, new_alias);
         log_debug("alias_store_add_cstr: replaced alias '%s' = '%s'", name, value);
@@ -142,6 +254,7 @@ void alias_store_add_cstr(alias_store_t *store, const char *name, const char *va
     // Add new alias
     alias_t *alias = alias_create_from_cstr(name, value);
     alias_array_append(store->aliases, alias);
+    index_add_last(store);
     log_debug("alias_store_add_cstr: added alias '%s' = '%s'", name, value);
 }
 
@@ -152,13 +265,15 @@ bool alias_store_remove(alias_store_t *store, const string_t *name)
     Expects_not_null(store->aliases);
     Expects_not_null(name);
 
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name, &index) != 0)
+    int index = find_alias(store, name);
+    if (index < 0)
     {
         return false; // Name not found
     }
 
     alias_array_remove(store->aliases, index);
+    index_rebuild(store, store->slot_capacity);
+    store->generation = store_generation_next();
     return true;
 }
 
@@ -168,13 +283,15 @@ bool alias_store_remove_cstr(alias_store_t *store, const char *name)
     Expects_not_null(store->aliases);
     Expects_not_null(name);
 
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name_cstr, &index) != 0)
+    int index = find_alias_cstr(store, name);
+    if (index < 0)
     {
         return false; // Name not found
     }
 
     alias_array_remove(store->aliases, index);
+    index_rebuild(store, store->slot_capacity);
+    store->generation = store_generation_next();
     return true;
 }
 
@@ -188,6 +305,9 @@ void alias_store_clear(alias_store_t *store)
               alias_array_size(store->aliases));
 
     alias_array_clear(store->aliases);
+    memset(store->slots, 0, (size_t)store->slot_capacity * sizeof(int32_t));
+    memset(store->first_chars, 0, sizeof(store->first_chars));
+    store->generation = store_generation_next();
 }
 
 // Get size
@@ -205,8 +325,7 @@ bool alias_store_has_name(const alias_store_t *store, const string_t *name)
     Expects_not_null(store);
     Expects_not_null(name);
 
-    int index;
-    return alias_array_find_with_compare(store->aliases, name, compare_alias_name, &index) == 0;
+    return find_alias(store, name) >= 0;
 }
 
 bool alias_store_has_name_cstr(const alias_store_t *store, const char *name)
@@ -215,9 +334,7 @@ bool alias_store_has_name_cstr(const alias_store_t *store, const char *name)
     Expects_not_null(store->aliases);
     Expects_not_null(name);
 
-    int index;
-    return alias_array_find_with_compare(store->aliases, name, compare_alias_name_cstr, &index) ==
-           0;
+    return find_alias_cstr(store, name) >= 0;
 }
 
 // Get value by name
@@ -227,8 +344,8 @@ const string_t *alias_store_get_value(const alias_store_t *store, const string_t
     Expects_not_null(store->aliases);
     Expects_not_null(name);
 
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name, &index) != 0)
+    int index = find_alias(store, name);
+    if (index < 0)
     {
         return NULL; // Name not found
     }
@@ -243,8 +360,8 @@ const char *alias_store_get_value_cstr(const alias_store_t *store, const char *n
     Expects_not_null(store->aliases);
     Expects_not_null(name);
 
-    int index;
-    if (alias_array_find_with_compare(store->aliases, name, compare_alias_name_cstr, &index) != 0)
+    int index = find_alias_cstr(store, name);
+    if (index < 0)
     {
         return NULL; // Name not found
     }
@@ -2,6 +2,7 @@
 #define ALIAS_STORE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "miga/string_t.h"
 
@@ -32,11 +33,24 @@ typedef struct alias_array_t alias_array_t;
 
 /**
  * Shell alias store.
+ *
+ * Aliases are kept in definition order, which is the order the alias
+ * builtin lists them in, with an open-addressing hash index over the names
+ * for lookup. The tokenizer asks about every word in command position, and
+ * most of those are not aliases, so a bitmap of the first characters of all
+ * defined names turns most misses away before the name is hashed.
  */
 typedef struct alias_store_t
 {
-    /** Internal array. Do not access directly. */
+    /** Internal array, in definition order. Do not access directly. */
     alias_array_t *aliases;
+    /** Hash index: array position + 1 per slot, 0 for an empty slot. */
+    int32_t *slots;
+    int32_t slot_capacity;
+    /** One bit per byte value that starts a defined name. */
+    uint64_t first_chars[4];
+    /** Changes whenever the store does; never shared with another store. */
+    uint32_t generation;
 } alias_store_t;
 
 /**
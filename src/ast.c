@@ -310,6 +310,100 @@ void ast_node_destroy(ast_node_t **node)
     *node = NULL;
 }
 
+static void ast_node_list_fill_hashes(const ast_node_list_t *list)
+{
+    if (!list)
+        return;
+    for (int i = 0; i < list->size; i++)
+        ast_node_fill_hashes(list->nodes[i]);
+}
+
+void ast_node_fill_hashes(const ast_node_t *node)
+{
+    if (!node)
+        return;
+
+    switch (node->type)
+    {
+    case AST_SIMPLE_COMMAND:
+        token_list_fill_hashes(node->data.simple_command.words);
+        token_list_fill_hashes(node->data.simple_command.assignments);
+        ast_node_list_fill_hashes(node->data.simple_command.redirections);
+        break;
+
+    case AST_PIPELINE:
+        ast_node_list_fill_hashes(node->data.pipeline.commands);
+        break;
+
+    case AST_AND_OR_LIST:
+        ast_node_fill_hashes(node->data.andor_list.left);
+        ast_node_fill_hashes(node->data.andor_list.right);
+        break;
+
+    case AST_COMMAND_LIST:
+        ast_node_list_fill_hashes(node->data.command_list.items);
+        break;
+
+    case AST_SUBSHELL:
+    case AST_BRACE_GROUP:
+        ast_node_fill_hashes(node->data.compound.body);
+        break;
+
+    case AST_IF_CLAUSE:
+        ast_node_fill_hashes(node->data.if_clause.condition);
+        ast_node_fill_hashes(node->data.if_clause.then_body);
+        ast_node_list_fill_hashes(node->data.if_clause.elif_list);
+        ast_node_fill_hashes(node->data.if_clause.else_body);
+        break;
+
+    case AST_WHILE_CLAUSE:
+    case AST_UNTIL_CLAUSE:
+        ast_node_fill_hashes(node->data.loop_clause.condition);
+        ast_node_fill_hashes(node->data.loop_clause.body);
+        break;
+
+    case AST_FOR_CLAUSE:
+        string_hash(node->data.for_clause.variable);
+        token_list_fill_hashes(node->data.for_clause.words);
+        ast_node_fill_hashes(node->data.for_clause.body);
+        break;
+
+    case AST_CASE_CLAUSE:
+        if (node->data.case_clause.word)
+            token_fill_hashes(node->data.case_clause.word);
+        ast_node_list_fill_hashes(node->data.case_clause.case_items);
+        break;
+
+    case AST_CASE_ITEM:
+        token_list_fill_hashes(node->data.case_item.patterns);
+        ast_node_fill_hashes(node->data.case_item.body);
+        break;
+
+    case AST_FUNCTION_DEF:
+        string_hash(node->data.function_def.name);
+        ast_node_fill_hashes(node->data.function_def.body);
+        ast_node_list_fill_hashes(node->data.function_def.redirections);
+        break;
+
+    case AST_REDIRECTED_COMMAND:
+        ast_node_fill_hashes(node->data.redirected_command.command);
+        ast_node_list_fill_hashes(node->data.redirected_command.redirections);
+        break;
+
+    case AST_REDIRECTION:
+        string_hash(node->data.redirection.fd_string);
+        string_hash(node->data.redirection.buffer);
+        if (node->data.redirection.target)
+            token_fill_hashes(node->data.redirection.target);
+        break;
+
+    case AST_FUNCTION_STORED:
+    case AST_NODE_TYPE_COUNT:
+    default:
+        break;
+    }
+}
+
 /* ============================================================================
  * AST Node Accessors
  * ============================================================================ */
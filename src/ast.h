@@ -1,8 +1,10 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "miga/strlist.h"
 #include "miga/string_t.h"
@@ -182,6 +184,10 @@ struct ast_node_t
                                            // NOTE: simple commands's redirections apply only to this command,
                                            // while AST_REDIRECTED_COMMAND's redirections apply to the entire command or compound.
             token_list_t *assignments;     // variable assignments (name=value)
+            // What a literal command name was last classified as, and against
+            // which builtin and function stores (see exec_command.c). The one
+            // thing execution writes in the tree, hence atomic.
+            _Atomic uint64_t command_class_cache;
         } simple_command;
 
         /* AST_PIPELINE */
@@ -323,6 +329,14 @@ ast_node_t *ast_node_create_function_stored(void);
  */
 void ast_node_destroy(ast_node_t **node);
 
+/**
+ * Fill in the cached hash of every string in the tree, so that executing it
+ * only reads the tree (apart from atomic caches) and one copy can be run by
+ * several threads at once.
+ * Safe to call with NULL.
+ */
+void ast_node_fill_hashes(const ast_node_t *node);
+
 /* ============================================================================
  * AST Node Accessors
  * ============================================================================ */
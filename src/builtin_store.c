@@ -2,9 +2,11 @@
  * @file builtin_store.c
  * @brief Hash-based builtin command registry implementation.
  *
- * Uses open addressing with linear probing and FNV-1a hashing.
- * The table grows by doubling when the load factor (live + tombstones)
- * exceeds 70%.  On growth, tombstones are purged.
+ * The standard builtins and reserved words are in the generated perfect-hash
+ * table (builtin_table.c).  The overlay of embedder changes uses open
+ * addressing with linear probing and FNV-1a hashing.  It grows by doubling
+ * when the load factor (live + tombstones) exceeds 70%.  On growth,
+ * tombstones are purged.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -16,7 +18,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "builtin_table.h"
 #include "miga/xalloc.h"
+#include "store_generation.h"
 
 /* ============================================================================
  * Constants
@@ -38,9 +42,9 @@
  * FNV-1a is fast, has good avalanche properties, and produces very few
  * collisions on short identifier-like strings — ideal for command names.
  */
-static uint32_t fnv1a_hash(const char *str)
+static uint32_t fnv1a_hash_seeded(const char *str, uint32_t seed)
 {
-    uint32_t hash = 2166136261u; /* FNV offset basis */
+    uint32_t hash = seed;
     for (const unsigned char *p = (const unsigned char *)str; *p; p++)
     {
         hash ^= *p;
@@ -49,6 +53,42 @@ static uint32_t fnv1a_hash(const char *str)
     return hash;
 }
 
+static uint32_t fnv1a_hash(const char *str)
+{
+    return fnv1a_hash_seeded(str, 2166136261u); /* FNV offset basis */
+}
+
+/* ============================================================================
+ * Standard Table and Generations
+ * ============================================================================ */
+
+/**
+ * The standard-table entry for @p name (a reserved word or a builtin), or
+ * NULL.  The table is a perfect hash, so there is nothing to probe past.
+ */
+static const builtin_table_entry_t *standard_find(const char *name)
+{
+    const builtin_table_entry_t *e =
+        &builtin_table[fnv1a_hash_seeded(name, BUILTIN_TABLE_SEED) & (BUILTIN_TABLE_SIZE - 1)];
+    return (e->name && strcmp(e->name, name) == 0) ? e : NULL;
+}
+
+/** The standard builtin named @p name, or NULL */
+static const builtin_table_entry_t *standard_find_builtin(const builtin_store_t *store,
+                                                          const char *name)
+{
+    if (!store->standard)
+        return NULL;
+    const builtin_table_entry_t *e = standard_find(name);
+    return (e && e->fn) ? e : NULL;
+}
+
+static miga_builtin_category_t class_to_category(command_class_t command_class)
+{
+    return command_class == COMMAND_CLASS_SPECIAL_BUILTIN ? MIGA_BUILTIN_CATEGORY_SPECIAL
+                                                          : MIGA_BUILTIN_CATEGORY_REGULAR;
+}
+
 /* ============================================================================
  * Internal Helpers
  * ============================================================================ */
@@ -168,6 +208,32 @@ builtin_store_t *builtin_store_create(void)
     store->capacity = BUILTIN_STORE_INITIAL_CAPACITY;
     store->count = 0;
     store->tombstones = 0;
+    store->standard = false;
+    store->generation = store_generation_next();
+
+    return store;
+}
+
+builtin_store_t *builtin_store_clone(const builtin_store_t *src)
+{
+    if (!src)
+        return NULL;
+
+    builtin_store_t *store = xcalloc(1, sizeof(builtin_store_t));
+    store->entries = xcalloc(src->capacity, sizeof(builtin_entry_t));
+    store->capacity = src->capacity;
+    store->count = src->count;
+    store->tombstones = src->tombstones;
+    store->standard = src->standard;
+    store->generation = store_generation_next();
+
+    /* Same capacity, so every entry keeps its slot and nothing is rehashed. */
+    for (size_t i = 0; i < src->capacity; i++)
+    {
+        store->entries[i] = src->entries[i];
+        store->entries[i].name =
+            src->entries[i].state == BUILTIN_SLOT_OCCUPIED ? xstrdup(src->entries[i].name) : NULL;
+    }
 
     return store;
 }
@@ -207,6 +273,8 @@ bool builtin_store_set(builtin_store_t *store, const char *name, miga_builtin_fn
     size_t slot = find_slot(store->entries, store->capacity, name, hash);
     builtin_entry_t *e = &store->entries[slot];
 
+    store->generation = store_generation_next();
+
     if (e->state == BUILTIN_SLOT_OCCUPIED)
     {
         /* Replace existing entry — keep the name allocation. */
@@ -244,10 +312,37 @@ bool builtin_store_remove(builtin_store_t *store, const char *name)
     uint32_t hash = fnv1a_hash(name);
     size_t slot = find_slot(store->entries, store->capacity, name, hash);
     builtin_entry_t *e = &store->entries[slot];
+    bool in_overlay = e->state == BUILTIN_SLOT_OCCUPIED;
+
+    if (in_overlay && !e->fn)
+        return false; /* Already hidden */
 
-    if (e->state != BUILTIN_SLOT_OCCUPIED)
+    /* A standard builtin cannot be deleted from the table: hide it instead */
+    const builtin_table_entry_t *standard = standard_find_builtin(store, name);
+    if (standard)
+    {
+        if (!in_overlay)
+        {
+            if (!ensure_capacity(store))
+                return false;
+            slot = find_slot(store->entries, store->capacity, name, hash);
+            e = &store->entries[slot];
+            if (e->state == BUILTIN_SLOT_TOMBSTONE)
+                store->tombstones--;
+            e->state = BUILTIN_SLOT_OCCUPIED;
+            e->hash = hash;
+            e->name = xstrdup(name);
+            store->count++;
+        }
+        e->fn = NULL;
+        store->generation = store_generation_next();
+        return true;
+    }
+
+    if (!in_overlay)
         return false;
 
+    store->generation = store_generation_next();
     xfree(e->name);
     e->name = NULL;
     e->fn = NULL;
@@ -277,36 +372,38 @@ void builtin_store_clear(builtin_store_t *store)
 
     store->count = 0;
     store->tombstones = 0;
+    store->standard = false;
+    store->generation = store_generation_next();
 }
 
 /* ============================================================================
  * Lookup
  * ============================================================================ */
 
-bool builtin_store_has(const builtin_store_t *store, const char *name)
+/**
+ * The overlay entry for @p name, or NULL.  An entry with a NULL fn hides the
+ * standard builtin of that name.
+ */
+static const builtin_entry_t *overlay_find(const builtin_store_t *store, const char *name)
 {
-    if (!store || !name)
-        return false;
+    if (store->count == 0)
+        return NULL;
 
-    uint32_t hash = fnv1a_hash(name);
-    size_t slot = find_slot(store->entries, store->capacity, name, hash);
+    size_t slot = find_slot(store->entries, store->capacity, name, fnv1a_hash(name));
+    const builtin_entry_t *e = &store->entries[slot];
+    return e->state == BUILTIN_SLOT_OCCUPIED ? e : NULL;
+}
 
-    return store->entries[slot].state == BUILTIN_SLOT_OCCUPIED;
+bool builtin_store_has(const builtin_store_t *store, const char *name)
+{
+    return builtin_store_lookup(store, name, NULL, NULL);
 }
 
 miga_builtin_fn_t builtin_store_get(const builtin_store_t *store, const char *name)
 {
-    if (!store || !name)
-        return NULL;
-
-    uint32_t hash = fnv1a_hash(name);
-    size_t slot = find_slot(store->entries, store->capacity, name, hash);
-    const builtin_entry_t *e = &store->entries[slot];
-
-    if (e->state == BUILTIN_SLOT_OCCUPIED)
-        return e->fn;
-
-    return NULL;
+    miga_builtin_fn_t fn = NULL;
+    builtin_store_lookup(store, name, &fn, NULL);
+    return fn;
 }
 
 bool builtin_store_lookup(const builtin_store_t *store, const char *name, miga_builtin_fn_t *fn_out,
@@ -315,30 +412,87 @@ bool builtin_store_lookup(const builtin_store_t *store, const char *name, miga_b
     if (!store || !name)
         return false;
 
-    uint32_t hash = fnv1a_hash(name);
-    size_t slot = find_slot(store->entries, store->capacity, name, hash);
-    const builtin_entry_t *e = &store->entries[slot];
+    miga_builtin_fn_t fn;
+    miga_builtin_category_t category;
 
-    if (e->state != BUILTIN_SLOT_OCCUPIED)
+    const builtin_entry_t *e = overlay_find(store, name);
+    const builtin_table_entry_t *standard;
+    if (e)
+    {
+        if (!e->fn)
+            return false;
+        fn = e->fn;
+        category = e->category;
+    }
+    else if ((standard = standard_find_builtin(store, name)) != NULL)
+    {
+        fn = standard->fn;
+        category = class_to_category(standard->command_class);
+    }
+    else
+    {
         return false;
+    }
 
     if (fn_out)
-        *fn_out = e->fn;
+        *fn_out = fn;
     if (category_out)
-        *category_out = e->category;
+        *category_out = category;
 
     return true;
 }
 
+command_class_t builtin_store_classify(const builtin_store_t *store, const char *name,
+                                       miga_builtin_fn_t *fn_out)
+{
+    if (fn_out)
+        *fn_out = NULL;
+    if (!store || !name)
+        return COMMAND_CLASS_EXTERNAL;
+
+    const builtin_table_entry_t *standard = standard_find(name);
+    if (standard && standard->command_class == COMMAND_CLASS_RESERVED_WORD)
+        return COMMAND_CLASS_RESERVED_WORD;
+
+    /* Embedder changes win over the standard table */
+    const builtin_entry_t *e = overlay_find(store, name);
+    if (e)
+    {
+        if (!e->fn)
+            return COMMAND_CLASS_EXTERNAL;
+        if (fn_out)
+            *fn_out = e->fn;
+        return e->category == MIGA_BUILTIN_CATEGORY_SPECIAL ? COMMAND_CLASS_SPECIAL_BUILTIN
+                                                            : COMMAND_CLASS_REGULAR_BUILTIN;
+    }
+
+    if (standard && store->standard)
+    {
+        if (fn_out)
+            *fn_out = standard->fn;
+        return standard->command_class;
+    }
+    return COMMAND_CLASS_EXTERNAL;
+}
+
 /* ============================================================================
  * Queries
  * ============================================================================ */
 
+static void count_callback(const char *name, miga_builtin_fn_t fn,
+                           miga_builtin_category_t category, void *context)
+{
+    (void)name;
+    (void)fn;
+    (void)category;
+    (*(size_t *)context)++;
+}
+
 size_t builtin_store_count(const builtin_store_t *store)
 {
-    if (!store)
-        return 0;
-    return store->count;
+    size_t count = 0;
+    builtin_store_for_each(store, count_callback, &count);
+    return count;
 }
 
 /* ============================================================================
@@ -354,9 +508,18 @@ void builtin_store_for_each(const builtin_store_t *store, builtin_store_iter_fn_
     for (size_t i = 0; i < store->capacity; i++)
     {
         const builtin_entry_t *e = &store->entries[i];
-        if (e->state == BUILTIN_SLOT_OCCUPIED)
+        if (e->state == BUILTIN_SLOT_OCCUPIED && e->fn)
             callback(e->name, e->fn, e->category, context);
     }
+
+    if (!store->standard)
+        return;
+    for (size_t i = 0; i < BUILTIN_TABLE_SIZE; i++)
+    {
+        const builtin_table_entry_t *t = &builtin_table[i];
+        if (t->fn && !overlay_find(store, t->name))
+            callback(t->name, t->fn, class_to_category(t->command_class), context);
+    }
 }
 
 /* ============================================================================
@@ -401,62 +564,18 @@ FILE *builtin_stderr(miga_frame_t *frame)
 
 #include "builtins.h"
 
+bool builtin_is_file_test(miga_builtin_fn_t fn)
+{
+    return fn == (miga_builtin_fn_t)builtin_bracket || fn == (miga_builtin_fn_t)builtin_test;
+}
+
 bool builtins_init_default(builtin_store_t *store)
 {
     if (!store)
         return false;
 
-    bool ok = true;
-
-    /* -- POSIX special builtins ------------------------------------------- */
-    ok = ok && builtin_store_set(store, "break", (miga_builtin_fn_t)builtin_break, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, ":", (miga_builtin_fn_t)builtin_colon, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok =
-        ok && builtin_store_set(store, "continue", (miga_builtin_fn_t)builtin_continue, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, ".", (miga_builtin_fn_t)builtin_dot, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "eval", (miga_builtin_fn_t)builtin_eval, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "exec", (miga_builtin_fn_t)builtin_exec, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "exit", (miga_builtin_fn_t)builtin_exit, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "export", (miga_builtin_fn_t)builtin_export, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok =
-        ok && builtin_store_set(store, "readonly", (miga_builtin_fn_t)builtin_readonly, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "return", (miga_builtin_fn_t)builtin_return, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "set", (miga_builtin_fn_t)builtin_set, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "shift", (miga_builtin_fn_t)builtin_shift, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "times", (miga_builtin_fn_t)builtin_times, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "trap", (miga_builtin_fn_t)builtin_trap, MIGA_BUILTIN_CATEGORY_SPECIAL);
-    ok = ok && builtin_store_set(store, "unset", (miga_builtin_fn_t)builtin_unset, MIGA_BUILTIN_CATEGORY_SPECIAL);
-
-    /* -- Regular builtins ------------------------------------------------- */
-#ifdef MIGA_UCRT_API
-    ok = ok && builtin_store_set(store, "cd", (miga_builtin_fn_t)builtin_cd, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "pwd", (miga_builtin_fn_t)builtin_pwd, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "ls", (miga_builtin_fn_t)builtin_ls, MIGA_BUILTIN_CATEGORY_REGULAR);
-#endif
-    ok = ok && builtin_store_set(store, "echo", (miga_builtin_fn_t)builtin_echo, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "printf", (miga_builtin_fn_t)builtin_printf, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "[", (miga_builtin_fn_t)builtin_bracket, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "alias", (miga_builtin_fn_t)builtin_alias, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "unalias", (miga_builtin_fn_t)builtin_unalias, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "getopts", (miga_builtin_fn_t)builtin_getopts, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "jobs", (miga_builtin_fn_t)builtin_jobs, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "kill", (miga_builtin_fn_t)builtin_kill, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "wait", (miga_builtin_fn_t)builtin_wait, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "fg", (miga_builtin_fn_t)builtin_fg, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "bg", (miga_builtin_fn_t)builtin_bg, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok =
-        ok && builtin_store_set(store, "basename", (miga_builtin_fn_t)builtin_basename, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "dirname", (miga_builtin_fn_t)builtin_dirname, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "true", (miga_builtin_fn_t)builtin_true, MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "false", (miga_builtin_fn_t)builtin_false, MIGA_BUILTIN_CATEGORY_REGULAR);
-
-    /* -- miga extensions -------------------------------------------------- */
-    ok = ok && builtin_store_set(store, "miga_dirnamevar", (miga_builtin_fn_t)builtin_miga_dirnamevar,
-                                 MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok = ok && builtin_store_set(store, "miga_printfvar", (miga_builtin_fn_t)builtin_miga_printfvar,
-                                 MIGA_BUILTIN_CATEGORY_REGULAR);
-    ok =
-        ok && builtin_store_set(store, "miga_cat", (miga_builtin_fn_t)builtin_miga_cat, MIGA_BUILTIN_CATEGORY_REGULAR);
-
-    return ok;
+    /* The list lives in tools/gen_builtin_table.py */
+    store->standard = true;
+    store->generation = store_generation_next();
+    return true;
 }
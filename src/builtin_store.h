@@ -11,9 +11,13 @@
  * (exec_register_builtin, etc.) and should not include this header
  * directly.
  *
- * The store uses open addressing with linear probing and a FNV-1a hash
- * of the command name.  It grows automatically when the load factor
- * exceeds a threshold.
+ * The standard builtins are not copied into each store: they live in a
+ * read-only perfect-hash table generated by tools/gen_builtin_table.py
+ * (builtin_table.c), which also holds the reserved words.  A store only
+ * records whether that table is visible, plus an overlay of builtins the
+ * embedder registered or removed.  The overlay uses open addressing with
+ * linear probing and a FNV-1a hash of the command name, and grows
+ * automatically when the load factor exceeds a threshold.
  */
 
 #include <stdbool.h>
@@ -27,6 +31,22 @@
 
 /* ── Forward declarations ────────────────────────────────────────────────── */
 
+/* ============================================================================
+ * Command Classes
+ * ============================================================================ */
+
+/**
+ * What a command name refers to, in the order the executor looks for it.
+ */
+typedef enum command_class_t
+{
+    COMMAND_CLASS_EXTERNAL,        /**< None of the below: search PATH  */
+    COMMAND_CLASS_RESERVED_WORD,   /**< if, done, {, ...                */
+    COMMAND_CLASS_SPECIAL_BUILTIN, /**< POSIX special builtin           */
+    COMMAND_CLASS_FUNCTION,        /**< Shell function                  */
+    COMMAND_CLASS_REGULAR_BUILTIN, /**< Any other builtin               */
+} command_class_t;
+
 /* ============================================================================
  * Entry
  * ============================================================================ */
@@ -49,7 +69,8 @@ typedef struct builtin_entry_t
     builtin_slot_state_t state;
     uint32_t hash;               /**< Cached FNV-1a hash of the name  */
     char *name;                  /**< Heap-allocated copy of the name */
-    miga_builtin_fn_t fn;             /**< Implementation function         */
+    miga_builtin_fn_t fn;             /**< Implementation function, or NULL
+                                           if this hides a standard builtin */
     miga_builtin_category_t category; /**< Special or regular              */
 } builtin_entry_t;
 
@@ -66,6 +87,8 @@ typedef struct builtin_store_t
     size_t capacity;          /**< Number of slots allocated           */
     size_t count;             /**< Number of live (OCCUPIED) entries    */
     size_t tombstones;        /**< Number of TOMBSTONE slots           */
+    bool standard;            /**< The standard builtins are visible   */
+    uint32_t generation;      /**< Changes whenever the store does     */
 } builtin_store_t;
 
 /* ============================================================================
@@ -78,6 +101,12 @@ typedef struct builtin_store_t
  */
 builtin_store_t *builtin_store_create(void);
 
+/**
+ * Create a copy of a builtin store.
+ * @return A new store with the same entries, or NULL if @p src is NULL.
+ */
+builtin_store_t *builtin_store_clone(const builtin_store_t *src);
+
 /**
  * Destroy a builtin store and free all associated memory.
  * Safe to call with a pointer to NULL.
@@ -111,7 +140,7 @@ bool builtin_store_set(builtin_store_t *store, const char *name, miga_builtin_fn
 bool builtin_store_remove(builtin_store_t *store, const char *name);
 
 /**
- * Remove all entries from the store.
+ * Remove all entries from the store, including the standard builtins.
  */
 void builtin_store_clear(builtin_store_t *store);
 
@@ -143,6 +172,21 @@ miga_builtin_fn_t builtin_store_get(const builtin_store_t *store, const char *na
 bool builtin_store_lookup(const builtin_store_t *store, const char *name, miga_builtin_fn_t *fn_out,
                           miga_builtin_category_t *category_out);
 
+/**
+ * Classify a command name with one probe of the standard table (and of the
+ * overlay, if the embedder changed any builtins).  Functions are not known
+ * to the store, so the result is never COMMAND_CLASS_FUNCTION.
+ *
+ * @param store   The builtin store.
+ * @param name    The command name.
+ * @param fn_out  If non-NULL, receives the builtin's function pointer, or
+ *                NULL if the name is not a builtin.
+ * @return COMMAND_CLASS_RESERVED_WORD, COMMAND_CLASS_SPECIAL_BUILTIN,
+ *         COMMAND_CLASS_REGULAR_BUILTIN, or COMMAND_CLASS_EXTERNAL.
+ */
+command_class_t builtin_store_classify(const builtin_store_t *store, const char *name,
+                                       miga_builtin_fn_t *fn_out);
+
 /* ============================================================================
  * Queries
  * ============================================================================ */
@@ -194,11 +238,18 @@ FILE *builtin_stderr(miga_frame_t *frame);
  * ============================================================================ */
 
 /**
- * Register all built-in commands (special and regular) into the given store.
+ * Make the built-in commands (special and regular) visible in the given
+ * store.  Nothing is copied: they are read from the standard table.
  *
  * @param store  The builtin store to populate.
- * @return true if all builtins were registered successfully, false on failure.
+ * @return true on success, false if @p store is NULL.
  */
 bool builtins_init_default(builtin_store_t *store);
 
+/**
+ * Return true if the builtin is test or [.  These only read the file system,
+ * so the executor keeps its cached stat() results across them.
+ */
+bool builtin_is_file_test(miga_builtin_fn_t fn);
+
 #endif /* BUILTIN_STORE_H */
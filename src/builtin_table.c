@@ -0,0 +1,81 @@
+/**
+ * @file builtin_table.c
+ * @brief Perfect-hash table of the reserved words and standard builtins.
+ *
+ * Generated by tools/gen_builtin_table.py -- do not edit.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "builtin_table.h"
+
+#include "builtins.h"
+
+const builtin_table_entry_t builtin_table[BUILTIN_TABLE_SIZE] = {
+    [2] = {"exec", (miga_builtin_fn_t)builtin_exec, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [4] = {"fg", (miga_builtin_fn_t)builtin_fg, COMMAND_CLASS_REGULAR_BUILTIN},
+    [19] = {"read", (miga_builtin_fn_t)builtin_read, COMMAND_CLASS_REGULAR_BUILTIN},
+    [22] = {"wait", (miga_builtin_fn_t)builtin_wait, COMMAND_CLASS_REGULAR_BUILTIN},
+    [27] = {"test", (miga_builtin_fn_t)builtin_test, COMMAND_CLASS_REGULAR_BUILTIN},
+    [29] = {"export", (miga_builtin_fn_t)builtin_export, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [44] = {"then", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [45] = {"return", (miga_builtin_fn_t)builtin_return, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [51] = {".", (miga_builtin_fn_t)builtin_dot, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [54] = {"}", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [58] = {"for", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [61] = {"miga_stats", (miga_builtin_fn_t)builtin_miga_stats, COMMAND_CLASS_REGULAR_BUILTIN},
+    [63] = {"jobs", (miga_builtin_fn_t)builtin_jobs, COMMAND_CLASS_REGULAR_BUILTIN},
+    [64] = {"while", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [70] = {"fi", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [75] = {"miga_jobs_max", (miga_builtin_fn_t)builtin_miga_jobs_max, COMMAND_CLASS_REGULAR_BUILTIN},
+    [78] = {"else", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [79] = {"exit", (miga_builtin_fn_t)builtin_exit, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [80] = {"printf", (miga_builtin_fn_t)builtin_printf, COMMAND_CLASS_REGULAR_BUILTIN},
+    [83] = {"case", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [85] = {"eval", (miga_builtin_fn_t)builtin_eval, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [89] = {"until", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [91] = {"miga_trace", (miga_builtin_fn_t)builtin_miga_trace, COMMAND_CLASS_REGULAR_BUILTIN},
+    [92] = {"{", NULL, COMMAND_CLASS_RESERVED_WORD},
+#ifdef MIGA_UCRT_API
+    [94] = {"ls", (miga_builtin_fn_t)builtin_ls, COMMAND_CLASS_REGULAR_BUILTIN},
+#endif
+    [99] = {"true", (miga_builtin_fn_t)builtin_true, COMMAND_CLASS_REGULAR_BUILTIN},
+    [115] = {"esac", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [116] = {"in", NULL, COMMAND_CLASS_RESERVED_WORD},
+#ifdef MIGA_UCRT_API
+    [126] = {"pwd", (miga_builtin_fn_t)builtin_pwd, COMMAND_CLASS_REGULAR_BUILTIN},
+#endif
+    [127] = {"kill", (miga_builtin_fn_t)builtin_kill, COMMAND_CLASS_REGULAR_BUILTIN},
+    [130] = {"break", (miga_builtin_fn_t)builtin_break, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [133] = {"shift", (miga_builtin_fn_t)builtin_shift, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [142] = {"false", (miga_builtin_fn_t)builtin_false, COMMAND_CLASS_REGULAR_BUILTIN},
+    [144] = {"bg", (miga_builtin_fn_t)builtin_bg, COMMAND_CLASS_REGULAR_BUILTIN},
+    [149] = {"set", (miga_builtin_fn_t)builtin_set, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [166] = {"continue", (miga_builtin_fn_t)builtin_continue, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [169] = {"alias", (miga_builtin_fn_t)builtin_alias, COMMAND_CLASS_REGULAR_BUILTIN},
+    [170] = {"!", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [172] = {"unalias", (miga_builtin_fn_t)builtin_unalias, COMMAND_CLASS_REGULAR_BUILTIN},
+    [175] = {":", (miga_builtin_fn_t)builtin_colon, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [176] = {"unset", (miga_builtin_fn_t)builtin_unset, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [177] = {"elif", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [184] = {"trap", (miga_builtin_fn_t)builtin_trap, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [185] = {"basename", (miga_builtin_fn_t)builtin_basename, COMMAND_CLASS_REGULAR_BUILTIN},
+    [191] = {"getopts", (miga_builtin_fn_t)builtin_getopts, COMMAND_CLASS_REGULAR_BUILTIN},
+    [205] = {"readonly", (miga_builtin_fn_t)builtin_readonly, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [206] = {"local", (miga_builtin_fn_t)builtin_local, COMMAND_CLASS_REGULAR_BUILTIN},
+    [214] = {"echo", (miga_builtin_fn_t)builtin_echo, COMMAND_CLASS_REGULAR_BUILTIN},
+    [219] = {"done", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [220] = {"if", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [222] = {"miga_printfvar", (miga_builtin_fn_t)builtin_miga_printfvar, COMMAND_CLASS_REGULAR_BUILTIN},
+#ifdef MIGA_UCRT_API
+    [224] = {"cd", (miga_builtin_fn_t)builtin_cd, COMMAND_CLASS_REGULAR_BUILTIN},
+#endif
+    [234] = {"miga_cat", (miga_builtin_fn_t)builtin_miga_cat, COMMAND_CLASS_REGULAR_BUILTIN},
+    [235] = {"miga_dirnamevar", (miga_builtin_fn_t)builtin_miga_dirnamevar, COMMAND_CLASS_REGULAR_BUILTIN},
+    [237] = {"dirname", (miga_builtin_fn_t)builtin_dirname, COMMAND_CLASS_REGULAR_BUILTIN},
+    [247] = {"times", (miga_builtin_fn_t)builtin_times, COMMAND_CLASS_SPECIAL_BUILTIN},
+    [250] = {"do", NULL, COMMAND_CLASS_RESERVED_WORD},
+    [252] = {"[", (miga_builtin_fn_t)builtin_bracket, COMMAND_CLASS_REGULAR_BUILTIN},
+};
@@ -0,0 +1,30 @@
+/**
+ * @file builtin_table.h
+ * @brief Perfect-hash table of the reserved words and standard builtins.
+ *
+ * Generated by tools/gen_builtin_table.py -- do not edit.
+ *
+ * Slot i holds the only name whose builtin_table_hash() is i, or a NULL
+ * name.  Only builtin_store.c should use this header.
+ */
+
+#ifndef BUILTIN_TABLE_H
+#define BUILTIN_TABLE_H
+
+#include <stdint.h>
+
+#include "builtin_store.h"
+
+#define BUILTIN_TABLE_SIZE 256u
+#define BUILTIN_TABLE_SEED 0x811c9dcfu
+
+typedef struct builtin_table_entry_t
+{
+    const char *name;
+    miga_builtin_fn_t fn; /**< NULL for reserved words */
+    command_class_t command_class;
+} builtin_table_entry_t;
+
+extern const builtin_table_entry_t builtin_table[BUILTIN_TABLE_SIZE];
+
+#endif /* BUILTIN_TABLE_H */
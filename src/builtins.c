@@ -11,6 +11,7 @@
 #endif
 
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -52,8 +53,11 @@
 #include "job_store.h"
 #include "lib.h"
 #include "logging.h"
+#include "printf_format.h"
+#include "stat_cache.h"
 #include "miga/strlist.h"
 #include "miga/string_t.h"
+#include "trace.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
 
@@ -585,6 +589,10 @@ int builtin_exit(miga_frame_t *frame, const strlist_t *args)
     if (frame->executor)
         exec_reap_background_jobs(frame->executor, true);
 
+    // The process is about to end without tearing down the executor
+    if (frame->executor && !frame->parent)
+        exec_stop_profile(frame->executor);
+
     // If this is the top-level frame, terminate the process
     if (!frame->parent)
     {
@@ -1464,7 +1472,7 @@ static void builtin_set_print_options(miga_frame_t *frame, bool reusable_format)
 /* Valid -o/+o option arguments for the set builtin */
 static const char *builtin_set_valid_o_args[] = {
     "allexport", "errexit",  "ignoreeof", "monitor", "noclobber", "noglob", "noexec",
-    "nounset",   "pipefail", "verbose",   "vi",      "xtrace",    NULL};
+    "nounset",   "pipefail", "profile",   "verbose", "vi",        "xtrace", NULL};
 
 /* Check if an -o argument is valid */
 static bool builtin_set_is_valid_o_arg(const char *arg)
@@ -1775,8 +1783,8 @@ int builtin_unset(miga_frame_t *frame, const strlist_t *args)
                         string_cstr(strlist_at(args, i)));
                 err_count++;
             }
-            else if (err == MIGA_FUNC_STATUS_EMPTY_NAME || err == MIGA_FUNC_STATUS_NAME_TOO_LONG ||
-                     err == MIGA_FUNC_STATUS_INVALID_NAMEs
+            else if (err == MIGA_FUNC_STATUS_EMPTY_NAME ||
+                     err == MIGA_FUNC_STATUS_INVALID_NAME)
             {
                 fprintf(stderr, "unset: invalid function name '%s'\n",
                         string_cstr(strlist_at(args, i)));
@@ -2179,6 +2187,356 @@ int builtin_getopts(miga_frame_t *frame, const strlist_t *args)
     }
 }
 
+/* ============================================================================
+ * read - Read a line from standard input and split it into variables
+ *
+ * POSIX Synopsis:
+ *   read [-r] [-d delim] var...
+ *
+ * Reads one record terminated by <newline> (or by the first byte of delim;
+ * an empty delim means NUL) from standard input.  Unless -r is given, a
+ * backslash quotes the following character and a backslash-<newline> pair
+ * is removed, continuing the record onto the next line.  The record is
+ * split on IFS as in field splitting; each var receives one field and the
+ * last var receives the remainder of the record, minus leading and
+ * trailing IFS white space.  Escaped characters never act as delimiters.
+ *
+ * Extension: with no var operands the record is stored in REPLY.
+ *
+ * On a regular file the input is read in blocks and the file offset is
+ * moved back to just past the delimiter, so the next command sees the
+ * rest of the file.  Pipes, terminals, and other unseekable inputs are read
+ * one byte at a time, since bytes past the delimiter cannot be pushed back.
+ *
+ * Returns 0 on success, 1 on end-of-file before a delimiter (the variables
+ * are still assigned), and >1 on error.
+ * ============================================================================
+ */
+
+#define READ_BLOCK_SIZE 4096
+
+/* Appends data to out without its NUL bytes, which a shell variable cannot
+ * hold; like bash, read drops them. */
+static void read_append_data(string_t *out, const char *data, int len)
+{
+    const char *end = data + len;
+    while (data < end)
+    {
+        const char *nul = memchr(data, '\0', (size_t)(end - data));
+        const char *stop = nul ? nul : end;
+        string_append_data(out, data, (int)(stop - data));
+        data = nul ? nul + 1 : end;
+    }
+}
+
+/* Reads one delim-terminated record from fd, appending it (without the
+ * delimiter) to out.  Returns 1 if a delimiter was seen, 0 at end-of-file,
+ * and -1 on a read error. */
+static int read_fill_record(int fd, char delim, string_t *out)
+{
+#ifdef MIGA_POSIX_API
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && lseek(fd, 0, SEEK_CUR) != (off_t)-1)
+    {
+        /* Seekable: read a block, then seek back over the bytes we did not use */
+        char buf[READ_BLOCK_SIZE];
+        for (;;)
+        {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+            if (n == 0)
+                return 0;
+
+            const char *hit = memchr(buf, (unsigned char)delim, (size_t)n);
+            if (hit)
+            {
+                ssize_t used = hit - buf;
+                read_append_data(out, buf, (int)used);
+                if (used + 1 < n)
+                    lseek(fd, (off_t)(used + 1 - n), SEEK_CUR);
+                return 1;
+            }
+            read_append_data(out, buf, (int)n);
+        }
+    }
+
+    for (;;)
+    {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0)
+            return 0;
+        if (c == delim)
+            return 1;
+        if (c != '\0')
+            string_push_back(out, c);
+    }
+#elifdef MIGA_UCRT_API
+    struct _stat st;
+    if (_fstat(fd, &st) == 0 && (st.st_mode & _S_IFREG) && _lseeki64(fd, 0, SEEK_CUR) != -1)
+    {
+        char buf[READ_BLOCK_SIZE];
+        for (;;)
+        {
+            int n = _read(fd, buf, sizeof(buf));
+            if (n < 0)
+                return -1;
+            if (n == 0)
+                return 0;
+
+            const char *hit = memchr(buf, (unsigned char)delim, (size_t)n);
+            if (hit)
+            {
+                int used = (int)(hit - buf);
+                read_append_data(out, buf, used);
+                if (used + 1 < n)
+                    _lseeki64(fd, (__int64)(used + 1 - n), SEEK_CUR);
+                return 1;
+            }
+            read_append_data(out, buf, n);
+        }
+    }
+
+    for (;;)
+    {
+        char c;
+        int n = _read(fd, &c, 1);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            return 0;
+        if (c == delim)
+            return 1;
+        if (c != '\0')
+            string_push_back(out, c);
+    }
+#else
+    /* ISO C: stdio is the only input we have */
+    (void)fd;
+    for (;;)
+    {
+        int c = fgetc(stdin);
+        if (c == EOF)
+            return ferror(stdin) ? -1 : 0;
+        if ((char)c == delim)
+            return 1;
+        if (c != '\0')
+            string_push_back(out, (char)c);
+    }
+#endif
+}
+
+static bool read_is_ifs_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+/* Splits line (with escaped[i] marking backslash-quoted bytes) into nvars
+ * values using the given IFS.  Fills values[0..nvars-1]. */
+static void read_split_fields(const string_t *line, const bool *escaped, const char *ifs,
+                              string_t **values, int nvars)
+{
+    int len = string_length(line);
+    const char *s = string_cstr(line);
+
+    /* One lookup per byte instead of a strchr() over IFS */
+    bool is_ifs[256] = {false};
+    for (const unsigned char *p = (const unsigned char *)ifs; *p; p++)
+        is_ifs[*p] = true;
+
+#define READ_IS_IFS(i) (!escaped[i] && is_ifs[(unsigned char)s[i]])
+#define READ_IS_IFS_WS(i) (READ_IS_IFS(i) && read_is_ifs_whitespace(s[i]))
+
+    int i = 0;
+    while (i < len && READ_IS_IFS_WS(i))
+        i++;
+
+    for (int v = 0; v < nvars; v++)
+    {
+        values[v] = string_create();
+        if (i >= len)
+            continue;
+
+        if (v == nvars - 1)
+        {
+            /* Last variable takes the remainder, minus trailing IFS white space */
+            int end = len;
+            while (end > i && READ_IS_IFS_WS(end - 1))
+                end--;
+            string_append_data(values[v], s + i, end - i);
+            break;
+        }
+
+        int start = i;
+        while (i < len && !READ_IS_IFS(i))
+            i++;
+        string_append_data(values[v], s + start, i - start);
+
+        /* Consume one delimiter: IFS white space around at most one other IFS char */
+        while (i < len && READ_IS_IFS_WS(i))
+            i++;
+        if (i < len && READ_IS_IFS(i))
+        {
+            i++;
+            while (i < len && READ_IS_IFS_WS(i))
+                i++;
+        }
+    }
+
+#undef READ_IS_IFS_WS
+#undef READ_IS_IFS
+}
+
+int builtin_read(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    bool raw = false;
+    char delim = '\n';
+    int flag_err = 0;
+    int c;
+
+    string_t *opts = string_create_from_cstr("rd:");
+    struct getopt_state state;
+    getopt_state_init(&state);
+    while ((c = getopt_r_string(args, opts, &state)) != -1)
+    {
+        switch (c)
+        {
+        case 'r':
+            raw = true;
+            break;
+        case 'd':
+            delim = state.optarg ? state.optarg[0] : '\0';
+            break;
+        case '?':
+            fprintf(stderr, "read: unrecognized option: '-%c'\n", state.optopt);
+            flag_err++;
+            break;
+        }
+    }
+    string_destroy(&opts);
+
+    if (flag_err)
+    {
+        fprintf(stderr, "usage: read [-r] [-d delim] var...\n");
+        return 2;
+    }
+
+    int argc = strlist_size(args);
+    int nvars = argc - state.optind;
+
+    /* Read the record, honoring backslash escapes unless -r */
+    string_t *line = string_create();
+    bool *escaped = NULL;
+    int escaped_cap = 0;
+    int status;
+    bool pending_escape = false;
+
+    for (;;)
+    {
+        string_t *chunk = string_create();
+        status = read_fill_record(STDIN_FILENO, delim, chunk);
+
+        int clen = string_length(chunk);
+        const char *cs = string_cstr(chunk);
+        if (string_length(line) + clen + 1 > escaped_cap)
+        {
+            int new_cap = (string_length(line) + clen + 1) * 2;
+            escaped = xrealloc(escaped, (size_t)new_cap * sizeof(bool));
+            escaped_cap = new_cap;
+        }
+        for (int k = 0; k < clen; k++)
+        {
+            if (!raw && !pending_escape && cs[k] == '\\')
+            {
+                pending_escape = true;
+                continue;
+            }
+            escaped[string_length(line)] = pending_escape;
+            string_push_back(line, cs[k]);
+            pending_escape = false;
+        }
+        string_destroy(&chunk);
+
+        if (status == 1 && pending_escape)
+        {
+            /* Backslash before the delimiter: a <newline> is removed and the
+             * record continues; any other delimiter is kept literally. */
+            pending_escape = false;
+            if (delim != '\n')
+            {
+                escaped[string_length(line)] = true;
+                string_push_back(line, delim);
+            }
+            continue;
+        }
+        break;
+    }
+
+    if (status < 0)
+    {
+        fprintf(stderr, "read: read error: %s\n", strerror(errno));
+        string_destroy(&line);
+        xfree(escaped);
+        return 2;
+    }
+
+    /* Split the record and assign */
+    const char *ifs = " \t\n";
+    string_t *ifs_var = NULL;
+    if (frame_has_variable_cstr(frame, "IFS"))
+    {
+        ifs_var = frame_get_variable_cstr(frame, "IFS");
+        ifs = string_cstr(ifs_var);
+    }
+
+    int nvalues = nvars > 0 ? nvars : 1;
+    string_t **values = xcalloc((size_t)nvalues, sizeof(string_t *));
+    if (nvars > 0)
+        read_split_fields(line, escaped, ifs, values, nvars);
+    else
+        values[0] = string_create_from(line);
+
+    int result = status == 1 ? 0 : 1;
+    for (int v = 0; v < nvalues; v++)
+    {
+        const char *name = nvars > 0 ? string_cstr(strlist_at(args, state.optind + v)) : "REPLY";
+        miga_var_status_t set_result =
+            frame_set_persistent_variable_cstr(frame, name, string_cstr(values[v]));
+        if (set_result == MIGA_VAR_STATUS_READ_ONLY)
+        {
+            fprintf(stderr, "read: %s: readonly variable\n", name);
+            result = 2;
+        }
+        else if (set_result != MIGA_VAR_STATUS_OK)
+        {
+            fprintf(stderr, "read: `%s': not a valid identifier\n", name);
+            result = 2;
+        }
+        string_destroy(&values[v]);
+    }
+
+    xfree(values);
+    if (ifs_var)
+        string_destroy(&ifs_var);
+    string_destroy(&line);
+    xfree(escaped);
+    return result;
+}
+
 /* ============================================================================
  * cd - Change the shell working directory
  * ============================================================================
@@ -3334,17 +3692,56 @@ int builtin_kill(miga_frame_t *frame, const strlist_t *args)
  *   wait [job_id...]
  *   wait [pid...]
  *
+ * Extension:
+ *   wait -n
+ *
  * If no operands are given, waits for all currently active child processes.
  * If one or more job_id or pid operands are given, waits for those specific
- * jobs/processes.
+ * jobs/processes.  With -n, waits for the next background job to complete
+ * and returns its exit status.
  *
  * Returns:
  *   - Exit status of the last process waited for
  *   - 0 if no children to wait for
- *   - 127 if a specified job/pid doesn't exist
+ *   - 127 if a specified job/pid doesn't exist, or -n has no jobs to wait for
  * ============================================================================
  */
 
+#ifdef MIGA_POSIX_API
+/**
+ * Wait for a running process of job `job_id` (of any job if 0) to finish and
+ * record it in the job table.  Only the job table's processes are waited
+ * for; other children of the process are left alone.
+ * Returns the process's exit status, or -1 if none is running.
+ */
+static int wait_next_job_process(miga_frame_t *frame, int job_id)
+{
+    pid_t *pids;
+    int count = job_store_active_pids(frame->executor->jobs, job_id, &pids);
+    int status;
+    pid_t pid = exec_async_wait_any(frame->executor, pids, count, &status);
+    xfree(pids);
+    if (pid < 0)
+        return -1;
+
+    if (status == -1)
+    {
+        /* Reaped by someone else; its status is lost */
+        job_store_set_process_state(frame->executor->jobs, pid, JOB_DONE, 127);
+        return 127;
+    }
+    frame->executor->stats.waits++;
+    if (WIFSIGNALED(status))
+    {
+        job_store_set_process_state(frame->executor->jobs, pid, JOB_TERMINATED,
+                                    128 + WTERMSIG(status));
+        return 128 + WTERMSIG(status);
+    }
+    job_store_set_process_state(frame->executor->jobs, pid, JOB_DONE, WEXITSTATUS(status));
+    return WEXITSTATUS(status);
+}
+#endif
+
 /**
  * Wait for a specific job to complete.
  * Returns the exit status of the job, or -1 on error.
@@ -3376,33 +3773,11 @@ static int wait_for_job(miga_frame_t *frame, int job_id, const char *target_str)
     }
 
 #ifdef MIGA_POSIX_API
-    /* Wait for the process group */
-    int status;
-    pid_t result;
-
-    /* Wait for any process in the job's process group */
-    while ((result = waitpid(-job->pgid, &status, 0)) > 0 || (result == -1 && errno == EINTR))
+    /* Wait for the job's processes one at a time */
+    while (!job_is_completed(job))
     {
-        if (result > 0)
-        {
-            /* Update the process state */
-            if (WIFEXITED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_DONE,
-                                            WEXITSTATUS(status));
-            }
-            else if (WIFSIGNALED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_TERMINATED,
-                                            WTERMSIG(status));
-            }
-        }
-
-        /* Check if job is now complete */
-        if (job_is_completed(job))
-        {
+        if (wait_next_job_process(frame, job->job_id) < 0)
             break;
-        }
     }
 
     /* Return the exit status of the first process */
@@ -3470,7 +3845,7 @@ static int wait_for_pid(miga_frame_t *frame, intptr_t pid, const char *target_st
 {
 #ifdef MIGA_POSIX_API
     int status;
-    pid_t result = waitpid((pid_t)pid, &status, 0);
+    pid_t result = exec_async_waitpid(frame ? frame->executor : NULL, (pid_t)pid, &status, 0);
 
     if (result == -1)
     {
@@ -3484,6 +3859,8 @@ static int wait_for_pid(miga_frame_t *frame, intptr_t pid, const char *target_st
         }
         return 127;
     }
+    if (frame && frame->executor)
+        frame->executor->stats.waits++;
 
     /* Update job store if this process is tracked */
     if (frame && frame->executor && frame->executor->jobs)
@@ -3562,28 +3939,19 @@ static int wait_for_all(miga_frame_t *frame)
     int last_exit_status = 0;
 
 #ifdef MIGA_POSIX_API
-    int status;
-    pid_t result;
+    /* Wait for every process in the job table */
+    int exit_status;
+    while ((exit_status = wait_next_job_process(frame, 0)) >= 0)
+        last_exit_status = exit_status;
 
-    /* Wait for all child processes */
-    while ((result = waitpid(-1, &status, 0)) > 0 || (result == -1 && errno == EINTR))
+    /* With no operands every known process ID is forgotten, so the jobs
+     * collected here are not handed out again by a later wait -n */
+    for (job_t *job = job_store_first(frame->executor->jobs); job; job = job->next)
     {
-        if (result > 0)
-        {
-            if (WIFEXITED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_DONE,
-                                            WEXITSTATUS(status));
-                last_exit_status = WEXITSTATUS(status);
-            }
-            else if (WIFSIGNALED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_TERMINATED,
-                                            WTERMSIG(status));
-                last_exit_status = 128 + WTERMSIG(status);
-            }
-        }
+        if (job_is_completed(job))
+            job->is_notified = true;
     }
+    job_store_remove_completed(frame->executor->jobs);
 
 #elifdef MIGA_UCRT_API
 /* Collect all active process handles and wait for them */
@@ -3644,7 +4012,7 @@ int builtin_wait(miga_frame_t *frame, const strlist_t *args)
         return wait_for_all(frame);
     }
 
-    /* Parse options (wait has no standard options, but handle -- for consistency) */
+    /* Parse options (-n is the only one; handle -- for consistency) */
     int first_operand = 1;
     for (int i = 1; i < argc; i++)
     {
@@ -3656,6 +4024,17 @@ int builtin_wait(miga_frame_t *frame, const strlist_t *args)
             break;
         }
 
+        if (strcmp(arg, "-n") == 0)
+        {
+            if (i + 1 < argc)
+            {
+                fprintf(stderr, "wait: -n does not take operands\n");
+                return 2;
+            }
+            int status = exec_wait_for_any(frame->executor, NULL);
+            return status < 0 ? 127 : status;
+        }
+
         /* If it starts with - but isn't --, it might be an invalid option or a negative number
          */
         if (arg[0] == '-' && arg[1] != '\0' && arg[1] != '-')
@@ -3814,33 +4193,30 @@ int builtin_fg(miga_frame_t *frame, const strlist_t *args)
     pid_t result;
     int exit_status = 0;
 
-    while ((result = waitpid(-job->pgid, &status, WUNTRACED)) > 0 ||
-           (result == -1 && errno == EINTR))
+    while ((result = exec_async_waitpid(frame->executor, -job->pgid, &status, WUNTRACED)) > 0)
     {
-        if (result > 0)
+        frame->executor->stats.waits++;
+        if (WIFEXITED(status))
         {
-            if (WIFEXITED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_DONE,
-                                            WEXITSTATUS(status));
-                exit_status = WEXITSTATUS(status);
-            }
-            else if (WIFSIGNALED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_TERMINATED,
-                                            WTERMSIG(status));
-                exit_status = 128 + WTERMSIG(status);
-            }
-            else if (WIFSTOPPED(status))
-            {
-                job_store_set_process_state(frame->executor->jobs, result, JOB_STOPPED,
-                                            WSTOPSIG(status));
-                /* Job was stopped, print notification */
-                fprintf(stderr, "\n[%d]+  Stopped                 %s\n", job_id,
-                        job->command_line ? string_cstr(job->command_line) : "");
-                exit_status = 128 + WSTOPSIG(status);
-                break;
-            }
+            job_store_set_process_state(frame->executor->jobs, result, JOB_DONE,
+                                        WEXITSTATUS(status));
+            exit_status = WEXITSTATUS(status);
+        }
+        else if (WIFSIGNALED(status))
+        {
+            job_store_set_process_state(frame->executor->jobs, result, JOB_TERMINATED,
+                                        WTERMSIG(status));
+            exit_status = 128 + WTERMSIG(status);
+        }
+        else if (WIFSTOPPED(status))
+        {
+            job_store_set_process_state(frame->executor->jobs, result, JOB_STOPPED,
+                                        WSTOPSIG(status));
+            /* Job was stopped, print notification */
+            fprintf(stderr, "\n[%d]+  Stopped                 %s\n", job_id,
+                    job->command_line ? string_cstr(job->command_line) : "");
+            exit_status = 128 + WSTOPSIG(status);
+            break;
         }
 
         /* Check if job is complete */
@@ -4657,681 +5033,417 @@ int builtin_echo(miga_frame_t *frame, const strlist_t *args)
  *
  * Width and precision modifiers supported.
  * If more arguments than format specifiers, format is reused.
+ *
+ * The format string is parsed once into a directive list (printf_format.c)
+ * and kept in a small per-executor LRU cache, and the output is written
+ * with a single fwrite() per call.
  * ============================================================================
  */
 
-/* Helper: Parse and process escape sequences for %b format
- * Returns a string_t that must be freed by the caller.
- */
-static string_t *printf_process_escapes(const char *str, int *stop_output)
+/* Compiled formats are cached per executor; scripts reuse a few formats
+ * many times over. */
+static const printf_format_t *printf_get_format(miga_frame_t *frame, const char *format)
 {
-    string_t *result = string_create();
-    const char *p = str;
-
-    *stop_output = 0;
-
-    while (*p)
-    {
-        if (*p == '\\' && *(p + 1))
-        {
-            p++;
-            switch (*p)
-            {
-            case 'a':
-                string_push_back(result, '\a');
-                break;
-            case 'b':
-                string_push_back(result, '\b');
-                break;
-            case 'c':
-                *stop_output = 1;
-                return result; /* Stop */
-            case 'e':          /* Extension: ESC */
-            case 'E':
-                string_push_back(result, '\033');
-                break;
-            case 'f':
-                string_push_back(result, '\f');
-                break;
-            case 'n':
-                string_push_back(result, '\n');
-                break;
-            case 'r':
-                string_push_back(result, '\r');
-                break;
-            case 't':
-                string_push_back(result, '\t');
-                break;
-            case 'v':
-                string_push_back(result, '\v');
-                break;
-            case '\\':
-                string_push_back(result, '\\');
-                break;
-            case '0': /* Octal */
-            case '1':
-            case '2':
-            case '3':
-            case '4':
-            case '5':
-            case '6':
-            case '7': {
-                int val = 0;
-                int count = 0;
-                while (count < 3 && *p >= '0' && *p <= '7')
-                {
-                    val = val * 8 + (*p - '0');
-                    p++;
-                    count++;
-                }
-                p--; /* Back up for loop increment */
-                string_push_back(result, (char)val);
-                break;
-            }
-            default:
-                /* Unknown escape - print literally */
-                string_push_back(result, '\\');
-                string_push_back(result, *p);
-                break;
-            }
-            p++;
-        }
-        else
-        {
-            string_push_back(result, *p++);
-        }
-    }
-    return result;
+    miga_exec_t *executor = frame->executor;
+    if (!executor->printf_cache)
+        executor->printf_cache = printf_format_cache_create();
+    return printf_format_cache_get(executor->printf_cache, format);
 }
 
-/* Helper: Parse width or precision number */
-static int printf_parse_number(const char **fmt)
+int builtin_printf(miga_frame_t *frame, const strlist_t *args)
 {
-    int num = 0;
-    while (**fmt >= '0' && **fmt <= '9')
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    int argc = strlist_size(args);
+
+    /* Need at least format string */
+    if (argc < 2)
     {
-        num = num * 10 + (**fmt - '0');
-        (*fmt)++;
+        frame_set_error_printf(frame, "printf: usage: printf format [arguments...]");
+        return 2;
     }
-    return num;
-}
 
-/* Helper: Parse and print a single format specifier */
-static int printf_process_format(const char **fmt, const char *arg, int *stop_output)
-{
-    const char *f = *fmt;
-    int width = 0;
-    int precision = -1;
-    int left_justify = 0;
-    int zero_pad = 0;
-    int has_precision = 0;
+    const printf_format_t *fmt = printf_get_format(frame, string_cstr(strlist_at(args, 1)));
 
-    *stop_output = 0;
+    /* Build the whole output first so that it goes out in one write */
+    printf_buffer_t output = {0};
+    int err = printf_format_render(fmt, args, 2, &output);
 
-    /* Skip % */
-    f++;
+    if (output.len > 0)
+        fwrite(output.data, 1, (size_t)output.len, stdout);
+    fflush(stdout);
+    printf_buffer_free(&output);
 
-    /* Parse flags */
-    while (*f == '-' || *f == '0' || *f == ' ' || *f == '+' || *f == '#')
+    if (err)
     {
-        if (*f == '-')
-            left_justify = 1;
-        if (*f == '0')
-            zero_pad = 1;
-        f++;
-    }
-
-    /* Parse width */
-    if (*f >= '0' && *f <= '9')
-    {
-        width = printf_parse_number(&f);
+        frame_set_error_printf(frame, "printf: invalid format");
+        return 1;
     }
+    return 0;
+}
 
-    /* Parse precision */
-    if (*f == '.')
-    {
-        f++;
-        has_precision = 1;
-        precision = printf_parse_number(&f);
-    }
+/* ============================================================================
+ * test / [ - Conditional expression evaluation
+ * Implements: test expression
+ *             [ expression ]
+ *
+ * Expressions are evaluated with the POSIX rules based on the number of
+ * arguments, so "!", "(" and ")" work without a general expression parser.
+ * Operators are classified once by a switch on their characters rather
+ * than by a chain of strcmp() calls, and file operators go through the
+ * executor's stat cache, so a run of tests on the same path such as
+ *     [ -e "$f" ] && [ -f "$f" ] && [ -r "$f" ]
+ * costs a single stat() call.
+ * ============================================================================
+ */
 
-    /* Get conversion specifier */
-    char spec = *f;
-    if (spec)
-        f++;
+typedef enum test_op_t
+{
+    TEST_OP_NONE,
+
+    /* Unary operators */
+    TEST_OP_BLOCK,      /* -b */
+    TEST_OP_CHAR,       /* -c */
+    TEST_OP_DIR,        /* -d */
+    TEST_OP_EXISTS,     /* -e */
+    TEST_OP_REGULAR,    /* -f */
+    TEST_OP_SETGID,     /* -g */
+    TEST_OP_SYMLINK,    /* -h, -L */
+    TEST_OP_STICKY,     /* -k */
+    TEST_OP_NONEMPTY,   /* -n */
+    TEST_OP_FIFO,       /* -p */
+    TEST_OP_READABLE,   /* -r */
+    TEST_OP_SOCKET,     /* -S */
+    TEST_OP_SIZE,       /* -s */
+    TEST_OP_TTY,        /* -t */
+    TEST_OP_SETUID,     /* -u */
+    TEST_OP_WRITABLE,   /* -w */
+    TEST_OP_EXECUTABLE, /* -x */
+    TEST_OP_EMPTY,      /* -z */
 
-    *fmt = f;
+    /* Binary operators */
+    TEST_OP_STR_EQ, /* = */
+    TEST_OP_STR_NE, /* != */
+    TEST_OP_INT_EQ, /* -eq */
+    TEST_OP_INT_NE, /* -ne */
+    TEST_OP_INT_LT, /* -lt */
+    TEST_OP_INT_LE, /* -le */
+    TEST_OP_INT_GT, /* -gt */
+    TEST_OP_INT_GE  /* -ge */
+} test_op_t;
+
+static test_op_t test_classify_unary(const string_t *arg)
+{
+    const char *s = string_cstr(arg);
+    if (string_length(arg) != 2 || s[0] != '-')
+        return TEST_OP_NONE;
 
-    /* Process conversion */
-    switch (spec)
+    switch (s[1])
     {
-    case 'b': /* String with backslash escapes */
-    {
-        string_t *processed = printf_process_escapes(arg, stop_output);
-        const char *processed_str = string_cstr(processed);
-        if (width > 0)
-        {
-            int len = (int)strlen(processed_str);
-            int pad = width - len;
-            if (pad > 0)
-            {
-                if (left_justify)
-                {
-                    printf("%s%*s", processed_str, pad, "");
-                }
-                else
-                {
-                    printf("%*s%s", pad, "", processed_str);
-                }
-            }
-            else
-            {
-                printf("%s", processed_str);
-            }
-        }
-        else
-        {
-            printf("%s", processed_str);
-        }
-        string_destroy(&processed);
-        break;
+    case 'b':
+        return TEST_OP_BLOCK;
+    case 'c':
+        return TEST_OP_CHAR;
+    case 'd':
+        return TEST_OP_DIR;
+    case 'e':
+        return TEST_OP_EXISTS;
+    case 'f':
+        return TEST_OP_REGULAR;
+    case 'g':
+        return TEST_OP_SETGID;
+    case 'h':
+    case 'L':
+        return TEST_OP_SYMLINK;
+    case 'k':
+        return TEST_OP_STICKY;
+    case 'n':
+        return TEST_OP_NONEMPTY;
+    case 'p':
+        return TEST_OP_FIFO;
+    case 'r':
+        return TEST_OP_READABLE;
+    case 'S':
+        return TEST_OP_SOCKET;
+    case 's':
+        return TEST_OP_SIZE;
+    case 't':
+        return TEST_OP_TTY;
+    case 'u':
+        return TEST_OP_SETUID;
+    case 'w':
+        return TEST_OP_WRITABLE;
+    case 'x':
+        return TEST_OP_EXECUTABLE;
+    case 'z':
+        return TEST_OP_EMPTY;
+    default:
+        return TEST_OP_NONE;
     }
+}
 
-    case 'c': /* Character */
-    {
-        int c = arg && *arg ? (unsigned char)*arg : 0;
-        if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*c", width, c);
-            else
-                printf("%*c", width, c);
-        }
-        else
-        {
-            putchar(c);
-        }
-        break;
-    }
+static test_op_t test_classify_binary(const string_t *arg)
+{
+    const char *s = string_cstr(arg);
 
-    case 'd':
-    case 'i': /* Signed decimal */
+    switch (string_length(arg))
     {
-        long val = arg && *arg ? strtol(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                printf("%-*.*ld", width, precision, val);
-            else
-                printf("%*.*ld", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
+    case 1:
+        return s[0] == '=' ? TEST_OP_STR_EQ : TEST_OP_NONE;
+    case 2:
+        return (s[0] == '!' && s[1] == '=') ? TEST_OP_STR_NE : TEST_OP_NONE;
+    case 3:
+        if (s[0] != '-')
+            return TEST_OP_NONE;
+        switch (s[1])
         {
-            printf("%0*ld", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*ld", width, val);
-            else
-                printf("%*ld", width, val);
-        }
-        else
-        {
-            printf("%ld", val);
+        case 'e':
+            return s[2] == 'q' ? TEST_OP_INT_EQ : TEST_OP_NONE;
+        case 'n':
+            return s[2] == 'e' ? TEST_OP_INT_NE : TEST_OP_NONE;
+        case 'l':
+            return s[2] == 't' ? TEST_OP_INT_LT : s[2] == 'e' ? TEST_OP_INT_LE : TEST_OP_NONE;
+        case 'g':
+            return s[2] == 't' ? TEST_OP_INT_GT : s[2] == 'e' ? TEST_OP_INT_GE : TEST_OP_NONE;
+        default:
+            return TEST_OP_NONE;
         }
-        break;
+    default:
+        return TEST_OP_NONE;
     }
+}
 
-    case 'u': /* Unsigned decimal */
-    {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                printf("%-*.*lu", width, precision, val);
-            else
-                printf("%*.*lu", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            printf("%0*lu", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*lu", width, val);
-            else
-                printf("%*lu", width, val);
-        }
-        else
-        {
-            printf("%lu", val);
-        }
-        break;
-    }
+static bool test_is_cstr(const string_t *arg, const char *s)
+{
+    return strcmp(string_cstr(arg), s) == 0;
+}
 
-    case 'o': /* Octal */
-    {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                printf("%-*.*lo", width, precision, val);
-            else
-                printf("%*.*lo", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            printf("%0*lo", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*lo", width, val);
-            else
-                printf("%*lo", width, val);
-        }
-        else
-        {
-            printf("%lo", val);
-        }
-        break;
-    }
+static stat_cache_t *test_stat_cache(miga_frame_t *frame)
+{
+    miga_exec_t *executor = frame->executor;
+    if (!executor->stat_cache)
+        executor->stat_cache = stat_cache_create();
+    return executor->stat_cache;
+}
 
-    case 'x': /* Hexadecimal lowercase */
-    {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                printf("%-*.*lx", width, precision, val);
-            else
-                printf("%*.*lx", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            printf("%0*lx", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*lx", width, val);
-            else
-                printf("%*lx", width, val);
-        }
-        else
-        {
-            printf("%lx", val);
-        }
-        break;
-    }
+/* Evaluate a unary operator. Returns 0 (true), 1 (false) or 2 (error). */
+static int test_eval_unary(miga_frame_t *frame, const char *name, test_op_t op,
+                           const string_t *arg)
+{
+    const char *path = string_cstr(arg);
+    stat_cache_info_t info;
 
-    case 'X': /* Hexadecimal uppercase */
+    switch (op)
     {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                printf("%-*.*lX", width, precision, val);
-            else
-                printf("%*.*lX", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            printf("%0*lX", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                printf("%-*lX", width, val);
-            else
-                printf("%*lX", width, val);
-        }
-        else
+    case TEST_OP_EMPTY:
+        return string_length(arg) == 0 ? 0 : 1;
+    case TEST_OP_NONEMPTY:
+        return string_length(arg) > 0 ? 0 : 1;
+
+    case TEST_OP_TTY: {
+        int endpos = 0;
+        long fd = string_atol_at(arg, 0, &endpos);
+
+        /* Check if valid file descriptor number */
+        if (string_length(arg) == 0 || endpos != (int)string_length(arg) || fd < 0)
         {
-            printf("%lX", val);
+            fprintf(stderr, "%s: -t: invalid file descriptor\n", name);
+            return 2;
         }
-        break;
+#ifdef MIGA_POSIX_API
+        return isatty((int)fd) ? 0 : 1;
+#elifdef MIGA_UCRT_API
+        return _isatty((int)fd) ? 0 : 1;
+#else
+        return 1;
+#endif
     }
 
-    case 's': /* String */
-    {
-        const char *str = arg ? arg : "";
-        int len = (int)strlen(str);
+    case TEST_OP_READABLE:
+        return stat_cache_access(test_stat_cache(frame), path, STAT_CACHE_READ) ? 0 : 1;
+    case TEST_OP_WRITABLE:
+        return stat_cache_access(test_stat_cache(frame), path, STAT_CACHE_WRITE) ? 0 : 1;
+    case TEST_OP_EXECUTABLE:
+        return stat_cache_access(test_stat_cache(frame), path, STAT_CACHE_EXEC) ? 0 : 1;
 
-        /* Apply precision (max chars) */
-        if (has_precision && precision < len)
-        {
-            len = precision;
-        }
+    case TEST_OP_SYMLINK:
+        if (!stat_cache_lookup(test_stat_cache(frame), path, false, &info))
+            return 1;
+        return info.type == STAT_CACHE_SYMLINK ? 0 : 1;
 
-        if (width > 0)
-        {
-            int pad = width - len;
-            if (left_justify)
-            {
-                printf("%.*s%*s", len, str, pad > 0 ? pad : 0, "");
-            }
-            else
-            {
-                printf("%*s%.*s", pad > 0 ? pad : 0, "", len, str);
-            }
-        }
-        else
-        {
-            printf("%.*s", len, str);
-        }
+    default:
         break;
     }
 
-    case '%': /* Literal % */
-        putchar('%');
-        break;
+    /* The remaining operators all examine the target of the path */
+    if (!stat_cache_lookup(test_stat_cache(frame), path, true, &info))
+        return 1;
 
+    switch (op)
+    {
+    case TEST_OP_EXISTS:
+        return 0;
+    case TEST_OP_REGULAR:
+        return info.type == STAT_CACHE_REGULAR ? 0 : 1;
+    case TEST_OP_DIR:
+        return info.type == STAT_CACHE_DIR ? 0 : 1;
+    case TEST_OP_BLOCK:
+        return info.type == STAT_CACHE_BLOCK ? 0 : 1;
+    case TEST_OP_CHAR:
+        return info.type == STAT_CACHE_CHAR ? 0 : 1;
+    case TEST_OP_FIFO:
+        return info.type == STAT_CACHE_FIFO ? 0 : 1;
+    case TEST_OP_SOCKET:
+        return info.type == STAT_CACHE_SOCKET ? 0 : 1;
+    case TEST_OP_SIZE:
+        return info.size > 0 ? 0 : 1;
+    case TEST_OP_SETUID:
+        return info.is_setuid ? 0 : 1;
+    case TEST_OP_SETGID:
+        return info.is_setgid ? 0 : 1;
+    case TEST_OP_STICKY:
+        return info.is_sticky ? 0 : 1;
     default:
-        /* Unknown specifier - print as-is */
-        putchar('%');
-        if (spec)
-            putchar(spec);
-        return 1; /* Error */
+        return 1;
     }
-
-    return 0;
 }
 
-int builtin_printf(miga_frame_t *frame, const strlist_t *args)
+static bool test_parse_integer(const string_t *arg, long *value)
 {
-    Expects_not_null(frame);
-    Expects_not_null(args);
-
-    int argc = strlist_size(args);
+    int endpos = 0;
+    *value = string_atol_at(arg, 0, &endpos);
+    return string_length(arg) > 0 && endpos == (int)string_length(arg);
+}
 
-    // for (int i = 0; i < strlist_size(args); i++)
-    //     log_debug(string_cstr(strlist_at(args, i)));
+/* Evaluate a binary operator. Returns 0 (true), 1 (false) or 2 (error). */
+static int test_eval_binary(const char *name, test_op_t op, const string_t *lhs,
+                            const string_t *rhs)
+{
+    if (op == TEST_OP_STR_EQ)
+        return string_eq(lhs, rhs) ? 0 : 1;
+    if (op == TEST_OP_STR_NE)
+        return string_ne(lhs, rhs) ? 0 : 1;
 
-    /* Need at least format string */
-    if (argc < 2)
+    long val1, val2;
+    if (!test_parse_integer(lhs, &val1))
     {
-        frame_set_error_printf(frame, "printf: usage: printf format [arguments...]");
+        fprintf(stderr, "%s: %s: integer expression expected\n", name, string_cstr(lhs));
         return 2;
     }
-
-    const char *format = string_cstr(strlist_at(args, 1));
-    int arg_index = 2; /* Start of actual arguments */
-    int stop_output = 0;
-
-    /* Process format string */
-    while (!stop_output)
+    if (!test_parse_integer(rhs, &val2))
     {
-        const char *f = format;
-        int format_used = 0;
-
-        while (*f && !stop_output)
-        {
-            if (*f == '%' && *(f + 1))
-            {
-                /* Get next argument (or empty string if no more args) */
-                const char *arg = "";
-                if (arg_index < argc)
-                {
-                    arg = string_cstr(strlist_at(args, arg_index));
-                    arg_index++;
-                    format_used = 1;
-                }
-                else if (format_used)
-                {
-                    /* No more arguments, use empty/zero defaults */
-                    arg = "";
-                }
-                else
-                {
-                    /* First pass through format, no arguments yet */
-                    arg = "";
-                }
-
-                int err = printf_process_format(&f, arg, &stop_output);
-                if (err)
-                {
-                    frame_set_error_printf(frame, "printf: invalid format");
-                    return 1;
-                }
-            }
-            else if (*f == '\\' && *(f + 1))
-            {
-                /* Process escape sequences in format string */
-                f++;
-                switch (*f)
-                {
-                case 'a':
-                    putchar('\a');
-                    break;
-                case 'b':
-                    putchar('\b');
-                    break;
-                case 'c':
-                    stop_output = 1;
-                    break;
-                case 'e':
-                    putchar('\033');
-                    break;
-                case 'f':
-                    putchar('\f');
-                    break;
-                case 'n':
-                    putchar('\n');
-                    break;
-                case 'r':
-                    putchar('\r');
-                    break;
-                case 't':
-                    putchar('\t');
-                    break;
-                case 'v':
-                    putchar('\v');
-                    break;
-                case '\\':
-                    putchar('\\');
-                    break;
-                case '0': /* Octal */
-                {
-                    int val = 0;
-                    int count = 0;
-                    f++;
-                    while (count < 3 && *f >= '0' && *f <= '7')
-                    {
-                        val = val * 8 + (*f - '0');
-                        f++;
-                        count++;
-                    }
-                    f--;
-                    putchar(val);
-                    break;
-                }
-                default:
-                    putchar(*f);
-                    break;
-                }
-                f++;
-            }
-            else
-            {
-                putchar(*f);
-                f++;
-            }
-        }
+        fprintf(stderr, "%s: %s: integer expression expected\n", name, string_cstr(rhs));
+        return 2;
+    }
 
-        /* If we used arguments, check if there are more to process */
-        if (format_used && arg_index < argc)
-        {
-            /* Reuse format string with remaining arguments */
-            continue;
-        }
-        else
-        {
-            /* Done */
-            break;
-        }
+    switch (op)
+    {
+    case TEST_OP_INT_EQ:
+        return val1 == val2 ? 0 : 1;
+    case TEST_OP_INT_NE:
+        return val1 != val2 ? 0 : 1;
+    case TEST_OP_INT_LT:
+        return val1 < val2 ? 0 : 1;
+    case TEST_OP_INT_LE:
+        return val1 <= val2 ? 0 : 1;
+    case TEST_OP_INT_GT:
+        return val1 > val2 ? 0 : 1;
+    case TEST_OP_INT_GE:
+        return val1 >= val2 ? 0 : 1;
+    default:
+        return 2;
     }
+}
 
-    fflush(stdout);
-    return 0;
+static int test_negate(int status)
+{
+    return status == 2 ? 2 : !status;
 }
 
-/* ============================================================================
- * bracket (test) - Conditional expression evaluation
- * Implements: [ expression ]
- * Focuses on ISO C compatible tests
- * ============================================================================
+/**
+ * Evaluate the expression args[first .. first+count-1] following the POSIX
+ * algorithm for test with 0 to 4 arguments. Returns 0 (true), 1 (false)
+ * or 2 (error).
  */
-
-int builtin_bracket(miga_frame_t *frame, const strlist_t *args)
+static int test_eval(miga_frame_t *frame, const char *name, const strlist_t *args, int first,
+                     int count)
 {
-    Expects_not_null(frame);
-    Expects_not_null(args);
-
-    int argc = strlist_size(args);
+    const string_t *a1 = count > 0 ? strlist_at(args, first) : NULL;
+    const string_t *a2 = count > 1 ? strlist_at(args, first + 1) : NULL;
+    const string_t *a3 = count > 2 ? strlist_at(args, first + 2) : NULL;
+    const string_t *a4 = count > 3 ? strlist_at(args, first + 3) : NULL;
+    test_op_t op;
 
-    /* Last argument must be "]" */
-    if (argc < 2)
-    {
-        frame_set_error_printf(frame, "[: missing ']'");
-        return 2;
-    }
-
-    const string_t *last_str = strlist_at(args, argc - 1);
-    if (string_length(last_str) != 1 || string_cstr(last_str)[0] != ']')
-    {
-        frame_set_error_printf(frame, "[: missing ']'");
-        return 2;
-    }
-
-    /* [ ] is false */
-    if (argc == 2)
+    switch (count)
     {
+    case 0:
         return 1;
-    }
 
-    /* Single argument - test if non-empty string */
-    if (argc == 3)
-    {
-        const string_t *arg = strlist_at(args, 1);
-        return (string_length(arg) > 0) ? 0 : 1;
-    }
+    case 1:
+        return string_length(a1) > 0 ? 0 : 1;
 
-    /* Unary operators or field splitting artifacts */
-    if (argc == 4)
-    {
-        const string_t *op_str = strlist_at(args, 1);
-        const string_t *arg_str = strlist_at(args, 2);
-        const char *op = string_cstr(op_str);
+    case 2:
+        if (test_is_cstr(a1, "!"))
+            return test_eval(frame, name, args, first + 1, 1) == 0 ? 1 : 0;
+        op = test_classify_unary(a1);
+        if (op != TEST_OP_NONE)
+            return test_eval_unary(frame, name, op, a2);
 
-        /* First check for unary operators */
-
-        /* File descriptor tests */
-        if (strcmp(op, "-t") == 0)
-        {
-            int endpos = 0;
-            long fd = string_atol_at(arg_str, 0, &endpos);
-
-            /* Check if valid file descriptor number */
-            if (endpos != (int)string_length(arg_str) || fd < 0)
-            {
-                frame_set_error_printf(frame, "[: -t: invalid file descriptor");
-                return 2;
-            }
-
-#ifdef MIGA_POSIX_API
-            return isatty((int)fd) ? 0 : 1;
-#elif defined MIGA_UCRT_API
-            return _isatty((int)fd) ? 0 : 1;
-#endif
-            /* else, fallthrough to failure */
-        }
-
-        /* String tests */
-        if (strcmp(op, "-z") == 0)
-            return (string_length(arg_str) == 0) ? 0 : 1;
-
-        if (strcmp(op, "-n") == 0)
-            return (string_length(arg_str) > 0) ? 0 : 1;
-
-        /* Check for field splitting artifact: binary operator as first argument.
-         *
-         * This happens when field splitting removes the entire first argument
-         * (producing zero words), leaving the binary operator as the first token.
-         * Per POSIX, this is expected behavior when an unquoted expansion produces
-         * only IFS whitespace.
-         *
-         * Example: [ $nl = "x" ] where nl contains only whitespace
-         * Correctly becomes: [ = "x" ] after field splitting (argc=4)
-         */
-
-        /* Common binary operators */
-        if (strcmp(op, "=") == 0 || strcmp(op, "!=") == 0 || strcmp(op, "-eq") == 0 ||
-            strcmp(op, "-ne") == 0 || strcmp(op, "-lt") == 0 || strcmp(op, "-le") == 0 ||
-            strcmp(op, "-gt") == 0 || strcmp(op, "-ge") == 0)
-        {
-            fprintf(stderr, "[: %s: unary operator expected\n", op);
-            return 2;
-        }
-
-        /* Unknown operator or too many arguments */
-        fprintf(stderr, "[: too many arguments\n");
+        /* A binary operator in first position usually means an unquoted
+         * expansion vanished during field splitting, e.g. [ $empty = x ] */
+        fprintf(stderr, "%s: %s: unary operator expected\n", name, string_cstr(a1));
         return 2;
-    }
-
-    /* Binary operators */
-    if (argc == 5)
-    {
-        const string_t *arg1_str = strlist_at(args, 1);
-        const string_t *op_str = strlist_at(args, 2);
-        const string_t *arg2_str = strlist_at(args, 3);
-        const char *op = string_cstr(op_str);
-
-        /* String comparisons */
-        if (strcmp(op, "=") == 0)
-            return (string_eq(arg1_str, arg2_str)) ? 0 : 1;
-
-        if (strcmp(op, "!=") == 0)
-            return (string_ne(arg1_str, arg2_str)) ? 0 : 1;
 
-        /* Integer comparisons */
-        int endpos1 = 0, endpos2 = 0;
-        long val1 = string_atol_at(arg1_str, 0, &endpos1);
-        long val2 = string_atol_at(arg2_str, 0, &endpos2);
+    case 3:
+        op = test_classify_binary(a2);
+        if (op != TEST_OP_NONE)
+            return test_eval_binary(name, op, a1, a3);
+        if (test_is_cstr(a1, "!"))
+            return test_negate(test_eval(frame, name, args, first + 1, 2));
+        if (test_is_cstr(a1, "(") && test_is_cstr(a3, ")"))
+            return test_eval(frame, name, args, first + 1, 1);
+        fprintf(stderr, "%s: unknown operator '%s'\n", name, string_cstr(a2));
+        return 2;
 
-        /* Check if both arguments are valid integers */
-        int arg1_is_int = (endpos1 == (int)string_length(arg1_str));
-        int arg2_is_int = (endpos2 == (int)string_length(arg2_str));
+    case 4:
+        if (test_is_cstr(a1, "!"))
+            return test_negate(test_eval(frame, name, args, first + 1, 3));
+        if (test_is_cstr(a1, "(") && test_is_cstr(a4, ")"))
+            return test_eval(frame, name, args, first + 1, 2);
+        break;
 
-        if (arg1_is_int && arg2_is_int)
-        {
-            if (strcmp(op, "-eq") == 0)
-                return (val1 == val2) ? 0 : 1;
+    default:
+        break;
+    }
 
-            if (strcmp(op, "-ne") == 0)
-                return (val1 != val2) ? 0 : 1;
+    fprintf(stderr, "%s: too many arguments\n", name);
+    return 2;
+}
 
-            if (strcmp(op, "-lt") == 0)
-                return (val1 < val2) ? 0 : 1;
+int builtin_test(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
 
-            if (strcmp(op, "-le") == 0)
-                return (val1 <= val2) ? 0 : 1;
+    return test_eval(frame, "test", args, 1, strlist_size(args) - 1);
+}
 
-            if (strcmp(op, "-gt") == 0)
-                return (val1 > val2) ? 0 : 1;
+int builtin_bracket(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
 
-            if (strcmp(op, "-ge") == 0)
-                return (val1 >= val2) ? 0 : 1;
-        }
+    int argc = strlist_size(args);
 
-        frame_set_error_printf(frame, "[: unknown operator '%s'", op);
+    /* Last argument must be "]" */
+    if (argc < 2 || !test_is_cstr(strlist_at(args, argc - 1), "]"))
+    {
+        fprintf(stderr, "[: missing ']'\n");
         return 2;
     }
 
-    frame_set_error_printf(frame, "[: too many arguments");
-    return 2;
+    return test_eval(frame, "[", args, 1, argc - 2);
 }
 
 /* ============================================================================
@@ -5353,31 +5465,97 @@ int builtin_return(miga_frame_t *frame, const strlist_t *args)
         return 2;
     }
 
-    /* Parse optional exit status argument */
-    int exit_status = frame_get_last_exit_status(frame);
+    /* Parse optional exit status argument */
+    int exit_status = frame_get_last_exit_status(frame);
+
+    if (strlist_size(args) > 1)
+    {
+        const string_t *arg_str = strlist_at(args, 1);
+        int endpos = 0;
+        long val = string_atol_at(arg_str, 0, &endpos);
+
+        if (endpos != string_length(arg_str))
+        {
+            frame_set_error_printf(frame, "return: numeric argument required");
+            return 2;
+        }
+
+        exit_status = (int)(val & 0xFF);
+    }
+
+    if (strlist_size(args) > 2)
+    {
+        frame_set_error_printf(frame, "return: too many arguments");
+        return 1;
+    }
+
+    frame_set_pending_control_flow(frame, MIGA_FRAME_FLOW_RETURN, 0);
+
+    return exit_status;
+}
+
+/* ============================================================================
+ * local - Make variables local to the current function
+ *
+ * Usage: local name[=value]...
+ *
+ * Not in POSIX, but provided by every shell in the ash family. Each name
+ * gets its value and attributes back when the function returns; functions
+ * called in the meantime see the local value. Without '=value' the
+ * variable keeps its current value.
+ * ============================================================================
+ */
+
+int builtin_local(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    int exit_status = 0;
 
-    if (strlist_size(args) > 1)
+    for (int i = 1; i < strlist_size(args); i++)
     {
-        const string_t *arg_str = strlist_at(args, 1);
-        int endpos = 0;
-        long val = string_atol_at(arg_str, 0, &endpos);
+        const string_t *arg = strlist_at(args, i);
+        int eq_pos = string_find_cstr(arg, "=");
 
-        if (endpos != string_length(arg_str))
+        string_t *name = NULL;
+        string_t *value = NULL;
+        if (eq_pos >= 0)
         {
-            frame_set_error_printf(frame, "return: numeric argument required");
-            return 2;
+            name = string_substring(arg, 0, eq_pos);
+            value = string_substring(arg, eq_pos + 1, string_length(arg));
+        }
+        else
+        {
+            name = string_create_from(arg);
         }
 
-        exit_status = (int)(val & 0xFF);
-    }
+        miga_var_status_t res = frame_declare_local_variable(frame, name, value);
+        switch (res)
+        {
+        case MIGA_VAR_STATUS_OK:
+            break;
+        case MIGA_VAR_STATUS_NOT_FOUND:
+            frame_set_error_printf(frame, "local: can only be used in a function");
+            exit_status = 1;
+            break;
+        case MIGA_VAR_STATUS_READ_ONLY:
+            frame_set_error_printf(frame, "local: %s: variable is readonly", string_cstr(name));
+            exit_status = 1;
+            break;
+        default:
+            frame_set_error_printf(frame, "local: '%s': invalid variable name", string_cstr(arg));
+            exit_status = 1;
+            break;
+        }
 
-    if (strlist_size(args) > 2)
-    {
-        frame_set_error_printf(frame, "return: too many arguments");
-        return 1;
-    }
+        string_destroy(&name);
+        if (value)
+            string_destroy(&value);
 
-    frame_set_pending_control_flow(frame, MIGA_FRAME_FLOW_RETURN, 0);
+        if (res == MIGA_VAR_STATUS_NOT_FOUND)
+            break;
+    }
 
     return exit_status;
 }
@@ -5683,429 +5861,126 @@ int builtin_miga_dirnamevar(miga_frame_t *frame, const strlist_t *args)
         return 2;
     }
 
-    /* Handle empty path string - dirname of empty is "." */
-    if (!path_arg || string_empty(path_arg))
-    {
-        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), ".");
-        return 0;
-    }
-
-    /* Make a working copy */
-    string_t *work = string_create_from(path_arg);
-    int len = string_length(work);
-
-    /* Remove trailing slashes */
-    while (len > 1)
-    {
-        char last = string_at(work, len - 1);
-        if (last == '/' || last == '\\')
-        {
-            string_pop_back(work);
-            len--;
-        }
-        else
-        {
-            break;
-        }
-    }
-
-    /* If only slashes remain, result is "/" */
-    if (len == 1)
-    {
-        char first = string_at(work, 0);
-        if (first == '/' || first == '\\')
-        {
-            frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), "/");
-            string_destroy(&work);
-            return 0;
-        }
-    }
-
-    /* If no slashes, result is "." */
-    int has_slash_pos = string_find_first_of_cstr(work, "/\\");
-    if (has_slash_pos < 0)
-    {
-        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), ".");
-        string_destroy(&work);
-        return 0;
-    }
-
-    /* Find last slash */
-    int last_slash_pos = string_rfind_cstr(work, "/");
-    int last_backslash_pos = string_rfind_cstr(work, "\\");
-
-    /* Use whichever is later */
-    int last_sep_pos = -1;
-    if (last_slash_pos > last_backslash_pos)
-        last_sep_pos = last_slash_pos;
-    else if (last_backslash_pos > last_slash_pos)
-        last_sep_pos = last_backslash_pos;
-    else
-        last_sep_pos = last_slash_pos; /* Both are -1 or equal */
-
-    /* Remove everything after the last slash */
-    if (last_sep_pos >= 0)
-    {
-        string_resize(work, last_sep_pos);
-        len = last_sep_pos;
-    }
-
-    /* Remove trailing slashes again */
-    while (len > 1)
-    {
-        char last = string_at(work, len - 1);
-        if (last == '/' || last == '\\')
-        {
-            string_pop_back(work);
-            len--;
-        }
-        else
-        {
-            break;
-        }
-    }
-
-    /* If we ended up with empty string or only slashes, result is "/" */
-    if (len == 0 || (len == 1 && (string_at(work, 0) == '/' || string_at(work, 0) == '\\')))
-    {
-        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), "/");
-    }
-    else
-    {
-        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), string_cstr(work));
-    }
-
-    string_destroy(&work);
-    return 0;
-}
-
-/* ============================================================================
- * miga_printfvar - Format data and assign to a variable
- *
- * Usage: miga_printfvar varname format [arguments...]
- *
- * This is a workaround for platforms where command substitution doesn't work
- * reliably (like UCRT). Instead of:
- *   RESULT=$(printf "%s-%d" "$name" "$count")
- * Use:
- *   miga_printfvar RESULT "%s-%d" "$name" "$count"
- *
- * Supports the same format specifiers as printf:
- *   %b    - String with backslash escapes interpreted
- *   %c    - Character
- *   %d, %i - Signed decimal integer
- *   %u    - Unsigned decimal integer
- *   %o    - Unsigned octal integer
- *   %x    - Unsigned hexadecimal (lowercase)
- *   %X    - Unsigned hexadecimal (uppercase)
- *   %s    - String
- *   %%    - Literal %
- * ============================================================================
- */
-
-/* Helper: Process a single format specifier and append to output string */
-static int printfvar_process_format(string_t *output, const char **fmt, const char *arg,
-                                    int *stop_output)
-{
-    const char *f = *fmt;
-    int width = 0;
-    int precision = -1;
-    int left_justify = 0;
-    int zero_pad = 0;
-    int has_precision = 0;
-    char buf[256];
-
-    *stop_output = 0;
-
-    /* Skip % */
-    f++;
-
-    /* Parse flags */
-    while (*f == '-' || *f == '0' || *f == ' ' || *f == '+' || *f == '#')
-    {
-        if (*f == '-')
-            left_justify = 1;
-        if (*f == '0')
-            zero_pad = 1;
-        f++;
-    }
-
-    /* Parse width */
-    if (*f >= '0' && *f <= '9')
-    {
-        width = printf_parse_number(&f);
-    }
-
-    /* Parse precision */
-    if (*f == '.')
-    {
-        f++;
-        has_precision = 1;
-        precision = printf_parse_number(&f);
-    }
-
-    /* Get conversion specifier */
-    char spec = *f;
-    if (spec)
-        f++;
-
-    *fmt = f;
-
-    /* Process conversion */
-    switch (spec)
-    {
-    case 'b': /* String with backslash escapes */
-    {
-        string_t *processed = printf_process_escapes(arg, stop_output);
-        const char *processed_str = string_cstr(processed);
-        if (width > 0)
-        {
-            int len = (int)strlen(processed_str);
-            int pad = width - len;
-            if (pad > 0)
-            {
-                if (left_justify)
-                {
-                    string_append_cstr(output, processed_str);
-                    for (int i = 0; i < pad; i++)
-                        string_append_char(output, ' ');
-                }
-                else
-                {
-                    for (int i = 0; i < pad; i++)
-                        string_append_char(output, ' ');
-                    string_append_cstr(output, processed_str);
-                }
-            }
-            else
-            {
-                string_append_cstr(output, processed_str);
-            }
-        }
-        else
-        {
-            string_append_cstr(output, processed_str);
-        }
-        string_destroy(&processed);
-        break;
-    }
-
-    case 'c': /* Character */
-    {
-        int c = arg && *arg ? (unsigned char)*arg : 0;
-        if (width > 0)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*c", width, c);
-            else
-                snprintf(buf, sizeof(buf), "%*c", width, c);
-            string_append_cstr(output, buf);
-        }
-        else
-        {
-            string_append_char(output, (char)c);
-        }
-        break;
-    }
-
-    case 'd':
-    case 'i': /* Signed decimal */
-    {
-        long val = arg && *arg ? strtol(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*.*ld", width, precision, val);
-            else
-                snprintf(buf, sizeof(buf), "%*.*ld", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            snprintf(buf, sizeof(buf), "%0*ld", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*ld", width, val);
-            else
-                snprintf(buf, sizeof(buf), "%*ld", width, val);
-        }
-        else
-        {
-            snprintf(buf, sizeof(buf), "%ld", val);
-        }
-        string_append_cstr(output, buf);
-        break;
-    }
-
-    case 'u': /* Unsigned decimal */
-    {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*.*lu", width, precision, val);
-            else
-                snprintf(buf, sizeof(buf), "%*.*lu", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            snprintf(buf, sizeof(buf), "%0*lu", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*lu", width, val);
-            else
-                snprintf(buf, sizeof(buf), "%*lu", width, val);
-        }
-        else
-        {
-            snprintf(buf, sizeof(buf), "%lu", val);
-        }
-        string_append_cstr(output, buf);
-        break;
-    }
-
-    case 'o': /* Octal */
-    {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*.*lo", width, precision, val);
-            else
-                snprintf(buf, sizeof(buf), "%*.*lo", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            snprintf(buf, sizeof(buf), "%0*lo", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*lo", width, val);
-            else
-                snprintf(buf, sizeof(buf), "%*lo", width, val);
-        }
-        else
-        {
-            snprintf(buf, sizeof(buf), "%lo", val);
-        }
-        string_append_cstr(output, buf);
-        break;
+    /* Handle empty path string - dirname of empty is "." */
+    if (!path_arg || string_empty(path_arg))
+    {
+        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), ".");
+        return 0;
     }
 
-    case 'x': /* Hexadecimal lowercase */
+    /* Make a working copy */
+    string_t *work = string_create_from(path_arg);
+    int len = string_length(work);
+
+    /* Remove trailing slashes */
+    while (len > 1)
     {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*.*lx", width, precision, val);
-            else
-                snprintf(buf, sizeof(buf), "%*.*lx", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            snprintf(buf, sizeof(buf), "%0*lx", width, val);
-        }
-        else if (width > 0)
+        char last = string_at(work, len - 1);
+        if (last == '/' || last == '\\')
         {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*lx", width, val);
-            else
-                snprintf(buf, sizeof(buf), "%*lx", width, val);
+            string_pop_back(work);
+            len--;
         }
         else
         {
-            snprintf(buf, sizeof(buf), "%lx", val);
+            break;
         }
-        string_append_cstr(output, buf);
-        break;
     }
 
-    case 'X': /* Hexadecimal uppercase */
+    /* If only slashes remain, result is "/" */
+    if (len == 1)
     {
-        unsigned long val = arg && *arg ? strtoul(arg, NULL, 0) : 0;
-        if (has_precision)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*.*lX", width, precision, val);
-            else
-                snprintf(buf, sizeof(buf), "%*.*lX", width, precision, val);
-        }
-        else if (zero_pad && !left_justify && width > 0)
-        {
-            snprintf(buf, sizeof(buf), "%0*lX", width, val);
-        }
-        else if (width > 0)
-        {
-            if (left_justify)
-                snprintf(buf, sizeof(buf), "%-*lX", width, val);
-            else
-                snprintf(buf, sizeof(buf), "%*lX", width, val);
-        }
-        else
+        char first = string_at(work, 0);
+        if (first == '/' || first == '\\')
         {
-            snprintf(buf, sizeof(buf), "%lX", val);
+            frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), "/");
+            string_destroy(&work);
+            return 0;
         }
-        string_append_cstr(output, buf);
-        break;
     }
 
-    case 's': /* String */
+    /* If no slashes, result is "." */
+    int has_slash_pos = string_find_first_of_cstr(work, "/\\");
+    if (has_slash_pos < 0)
     {
-        const char *str = arg ? arg : "";
-        int len = (int)strlen(str);
+        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), ".");
+        string_destroy(&work);
+        return 0;
+    }
 
-        /* Apply precision (max chars) */
-        if (has_precision && precision < len)
-        {
-            len = precision;
-        }
+    /* Find last slash */
+    int last_slash_pos = string_rfind_cstr(work, "/");
+    int last_backslash_pos = string_rfind_cstr(work, "\\");
+
+    /* Use whichever is later */
+    int last_sep_pos = -1;
+    if (last_slash_pos > last_backslash_pos)
+        last_sep_pos = last_slash_pos;
+    else if (last_backslash_pos > last_slash_pos)
+        last_sep_pos = last_backslash_pos;
+    else
+        last_sep_pos = last_slash_pos; /* Both are -1 or equal */
+
+    /* Remove everything after the last slash */
+    if (last_sep_pos >= 0)
+    {
+        string_resize(work, last_sep_pos);
+        len = last_sep_pos;
+    }
 
-        if (width > 0)
+    /* Remove trailing slashes again */
+    while (len > 1)
+    {
+        char last = string_at(work, len - 1);
+        if (last == '/' || last == '\\')
         {
-            int pad = width - len;
-            if (left_justify)
-            {
-                for (int i = 0; i < len; i++)
-                    string_append_char(output, str[i]);
-                for (int i = 0; i < pad; i++)
-                    string_append_char(output, ' ');
-            }
-            else
-            {
-                for (int i = 0; i < pad; i++)
-                    string_append_char(output, ' ');
-                for (int i = 0; i < len; i++)
-                    string_append_char(output, str[i]);
-            }
+            string_pop_back(work);
+            len--;
         }
         else
         {
-            for (int i = 0; i < len; i++)
-                string_append_char(output, str[i]);
+            break;
         }
-        break;
     }
 
-    case '%': /* Literal % */
-        string_append_char(output, '%');
-        break;
-
-    default:
-        /* Unknown specifier - append as-is */
-        string_append_char(output, '%');
-        if (spec)
-            string_append_char(output, spec);
-        return 1; /* Error */
+    /* If we ended up with empty string or only slashes, result is "/" */
+    if (len == 0 || (len == 1 && (string_at(work, 0) == '/' || string_at(work, 0) == '\\')))
+    {
+        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), "/");
+    }
+    else
+    {
+        frame_set_persistent_variable_cstr(frame, string_cstr(varname_arg), string_cstr(work));
     }
 
+    string_destroy(&work);
     return 0;
 }
 
+/* ============================================================================
+ * miga_printfvar - Format data and assign to a variable
+ *
+ * Usage: miga_printfvar varname format [arguments...]
+ *
+ * This is a workaround for platforms where command substitution doesn't work
+ * reliably (like UCRT). Instead of:
+ *   RESULT=$(printf "%s-%d" "$name" "$count")
+ * Use:
+ *   miga_printfvar RESULT "%s-%d" "$name" "$count"
+ *
+ * Supports the same format specifiers as printf:
+ *   %b    - String with backslash escapes interpreted
+ *   %c    - Character
+ *   %d, %i - Signed decimal integer
+ *   %u    - Unsigned decimal integer
+ *   %o    - Unsigned octal integer
+ *   %x    - Unsigned hexadecimal (lowercase)
+ *   %X    - Unsigned hexadecimal (uppercase)
+ *   %s    - String
+ *   %%    - Literal %
+ * ============================================================================
+ */
+
 int builtin_miga_printfvar(miga_frame_t *frame, const strlist_t *args)
 {
     Expects_not_null(frame);
@@ -6129,128 +6004,20 @@ int builtin_miga_printfvar(miga_frame_t *frame, const strlist_t *args)
         return 2;
     }
 
-    const char *format = string_cstr(strlist_at(args, 2));
-    int arg_index = 3; /* Start of actual arguments */
-    int stop_output = 0;
-
-    /* Create output buffer */
-    string_t *output = string_create();
+    const printf_format_t *fmt = printf_get_format(frame, string_cstr(strlist_at(args, 2)));
 
-    /* Process format string */
-    while (!stop_output)
+    printf_buffer_t rendered = {0};
+    if (printf_format_render(fmt, args, 3, &rendered))
     {
-        const char *f = format;
-        int format_used = 0;
-
-        while (*f && !stop_output)
-        {
-            if (*f == '%' && *(f + 1))
-            {
-                /* Get next argument (or empty string if no more args) */
-                const char *arg = "";
-                if (arg_index < argc)
-                {
-                    arg = string_cstr(strlist_at(args, arg_index));
-                    arg_index++;
-                    format_used = 1;
-                }
-                else if (format_used)
-                {
-                    /* No more arguments, use empty/zero defaults */
-                    arg = "";
-                }
-                else
-                {
-                    /* First pass through format, no arguments yet */
-                    arg = "";
-                }
-
-                int err = printfvar_process_format(output, &f, arg, &stop_output);
-                if (err)
-                {
-                    frame_set_error_printf(frame, "miga_printfvar: invalid format");
-                    string_destroy(&output);
-                    return 1;
-                }
-            }
-            else if (*f == '\\' && *(f + 1))
-            {
-                /* Process escape sequences in format string */
-                f++;
-                switch (*f)
-                {
-                case 'a':
-                    string_append_char(output, '\a');
-                    break;
-                case 'b':
-                    string_append_char(output, '\b');
-                    break;
-                case 'c':
-                    stop_output = 1;
-                    break;
-                case 'e':
-                    string_append_char(output, '\033');
-                    break;
-                case 'f':
-                    string_append_char(output, '\f');
-                    break;
-                case 'n':
-                    string_append_char(output, '\n');
-                    break;
-                case 'r':
-                    string_append_char(output, '\r');
-                    break;
-                case 't':
-                    string_append_char(output, '\t');
-                    break;
-                case 'v':
-                    string_append_char(output, '\v');
-                    break;
-                case '\\':
-                    string_append_char(output, '\\');
-                    break;
-                case '0': /* Octal */
-                {
-                    int val = 0;
-                    int count = 0;
-                    f++;
-                    while (count < 3 && *f >= '0' && *f <= '7')
-                    {
-                        val = val * 8 + (*f - '0');
-                        f++;
-                        count++;
-                    }
-                    f--;
-                    string_append_char(output, (char)val);
-                    break;
-                }
-                default:
-                    string_append_char(output, *f);
-                    break;
-                }
-                f++;
-            }
-            else
-            {
-                string_append_char(output, *f);
-                f++;
-            }
-        }
-
-        /* If we used arguments, check if there are more to process */
-        if (format_used && arg_index < argc)
-        {
-            /* Reuse format string with remaining arguments */
-            continue;
-        }
-        else
-        {
-            /* Done */
-            break;
-        }
+        frame_set_error_printf(frame, "miga_printfvar: invalid format");
+        printf_buffer_free(&rendered);
+        return 1;
     }
 
-    /* Assign result to variable */
+    /* Assign result to variable; a value ends at the first NUL byte */
+    string_t *output = string_create();
+    string_append_data(output, rendered.data, rendered.len);
+    printf_buffer_free(&rendered);
     frame_set_persistent_variable(frame, varname_arg, output);
 
     string_destroy(&output);
@@ -6294,6 +6061,194 @@ int builtin_miga_cat(miga_frame_t *frame, const strlist_t *args)
     return 0;
 }
 
+/* ============================================================================
+ * miga_jobs_max - Limit the number of concurrent background jobs
+ *
+ * Usage: miga_jobs_max [N | nproc]
+ *
+ * With no operand, prints the current limit (0 means unlimited).  With N,
+ * at most N background jobs run at once; starting another `&` job blocks
+ * until one finishes.  The operand "nproc" selects the number of online
+ * processors.  Use `wait -n` to collect jobs as they complete.
+ *
+ * Examples:
+ *   miga_jobs_max nproc
+ *   for f in *.json; do process "$f" & done; wait
+ * ============================================================================
+ */
+int builtin_miga_jobs_max(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    int argc = strlist_size(args);
+    if (argc == 1)
+    {
+        fprintf(stdout, "%d\n", exec_get_jobs_max(frame->executor));
+        return 0;
+    }
+    if (argc != 2)
+    {
+        fprintf(stderr, "miga_jobs_max: usage: miga_jobs_max [N | nproc]\n");
+        return 2;
+    }
+
+    const string_t *arg_str = strlist_at(args, 1);
+    int max_jobs;
+    if (strcmp(string_cstr(arg_str), "nproc") == 0)
+    {
+        max_jobs = exec_get_default_jobs_max();
+    }
+    else
+    {
+        int endpos = 0;
+        long val = string_atol_at(arg_str, 0, &endpos);
+        if (string_length(arg_str) == 0 || endpos != string_length(arg_str) || val < 0 ||
+            val > INT_MAX)
+        {
+            fprintf(stderr, "miga_jobs_max: %s: not a valid job count\n", string_cstr(arg_str));
+            return 2;
+        }
+        max_jobs = (int)val;
+    }
+
+    exec_set_jobs_max(frame->executor, max_jobs);
+    return 0;
+}
+
+/* ============================================================================
+ * miga_stats - Print the executor's work counters
+ *
+ * Usage: miga_stats [-r]
+ *
+ * Prints one "name value" line per counter reported by exec_get_stats():
+ * process creation, pipes, expansions, variable store traffic, allocation
+ * volume and the split between parse and execution time (in
+ * microseconds).  With -r, the counters are reset after printing, so a
+ * script can bracket the section it wants to measure.
+ *
+ * Examples:
+ *   miga_stats -r; build_index; miga_stats
+ * ============================================================================
+ */
+int builtin_miga_stats(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    int argc = strlist_size(args);
+    bool reset = false;
+    if (argc == 2 && strcmp(string_cstr(strlist_at(args, 1)), "-r") == 0)
+    {
+        reset = true;
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "miga_stats: usage: miga_stats [-r]\n");
+        return 2;
+    }
+
+    miga_exec_stats_t st;
+    exec_get_stats(frame->executor, &st);
+
+    const struct
+    {
+        const char *name;
+        uint64_t value;
+    } rows[] = {
+        {"forks", st.forks},
+        {"execs", st.execs},
+        {"pipes", st.pipes},
+        {"waits", st.waits},
+        {"command_substitutions", st.command_substitutions},
+        {"glob_expansions", st.glob_expansions},
+        {"frame_pushes", st.frame_pushes},
+        {"variable_lookups", st.variable_lookups},
+        {"variable_inserts", st.variable_inserts},
+        {"envp_rebuilds", st.envp_rebuilds},
+        {"bytes_allocated", st.bytes_allocated},
+        {"parse_us", st.parse_ns / 1000},
+        {"exec_us", st.exec_ns / 1000},
+    };
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++)
+    {
+        fprintf(stdout, "%-22s %llu\n", rows[i].name, (unsigned long long)rows[i].value);
+    }
+
+    if (reset)
+        exec_reset_stats(frame->executor);
+    return 0;
+}
+
+/* ============================================================================
+ * miga_trace - Control the binary event trace
+ *
+ * Usage: miga_trace [on | off | clear | dump [FILE]]
+ *
+ * The trace keeps the most recent executor events (frame pushes and pops,
+ * forks, waits, pipes, heredocs, command substitutions, parses) in a
+ * fixed-size in-memory ring.  Recording is cheap enough to leave on; the
+ * records are only formatted by "dump", which writes them to standard
+ * output or FILE, oldest first, or automatically when a fatal error aborts
+ * the shell.  With no operand, prints "on" or "off".  Setting MIGA_TRACE
+ * in the environment turns tracing on when the shell starts.
+ *
+ * Examples:
+ *   miga_trace on; ./build.sh; miga_trace dump build.trace
+ * ============================================================================
+ */
+int builtin_miga_trace(miga_frame_t *frame, const strlist_t *args)
+{
+    Expects_not_null(frame);
+    Expects_not_null(args);
+
+    int argc = strlist_size(args);
+    const char *op = argc > 1 ? string_cstr(strlist_at(args, 1)) : "";
+
+    if (argc == 1)
+    {
+        printf("%s\n", trace_is_enabled() ? "on" : "off");
+        return 0;
+    }
+    if (argc == 2 && strcmp(op, "on") == 0)
+    {
+        trace_enable(true);
+        return 0;
+    }
+    if (argc == 2 && strcmp(op, "off") == 0)
+    {
+        trace_enable(false);
+        return 0;
+    }
+    if (argc == 2 && strcmp(op, "clear") == 0)
+    {
+        trace_clear();
+        return 0;
+    }
+    if ((argc == 2 || argc == 3) && strcmp(op, "dump") == 0)
+    {
+        if (argc == 2)
+        {
+            fflush(stdout);
+            trace_dump(stdout);
+            return 0;
+        }
+        const char *path = string_cstr(strlist_at(args, 2));
+        FILE *fp = fopen(path, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "miga_trace: %s: %s\n", path, strerror(errno));
+            return 1;
+        }
+        trace_dump(fp);
+        fclose(fp);
+        return 0;
+    }
+
+    fprintf(stderr, "miga_trace: usage: miga_trace [on | off | clear | dump [FILE]]\n");
+    return 2;
+}
+
 /* ============================================================================
  * true / false - Return success or failure
  * ============================================================================
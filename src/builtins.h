@@ -64,10 +64,13 @@ int builtin_unset(miga_frame_t *frame, const strlist_t *args);
 int builtin_cd(miga_frame_t *frame, const strlist_t *args);
 int builtin_pwd(miga_frame_t *frame, const strlist_t *args);
 
+int builtin_local(miga_frame_t *frame, const strlist_t *args);
+
 int builtin_echo(miga_frame_t *frame, const strlist_t *args);
 int builtin_printf(miga_frame_t *frame, const strlist_t *args);
 
 int builtin_bracket(miga_frame_t *frame, const strlist_t *args);
+int builtin_test(miga_frame_t *frame, const strlist_t *args);
 
 int builtin_jobs(miga_frame_t *frame, const strlist_t *args);
 int builtin_kill(miga_frame_t *frame, const strlist_t *args);
@@ -76,6 +79,7 @@ int builtin_fg(miga_frame_t *frame, const strlist_t *args);
 int builtin_bg(miga_frame_t *frame, const strlist_t *args);
 
 int builtin_getopts(miga_frame_t *frame, const strlist_t *args);
+int builtin_read(miga_frame_t *frame, const strlist_t *args);
 int builtin_ls(miga_frame_t *frame, const strlist_t *args);
 
 int builtin_alias(miga_frame_t *frame, const strlist_t *args);
@@ -86,6 +90,9 @@ int builtin_dirname(miga_frame_t *frame, const strlist_t *args);
 int builtin_miga_dirnamevar(miga_frame_t *frame, const strlist_t *args);
 int builtin_miga_printfvar(miga_frame_t *frame, const strlist_t *args);
 int builtin_miga_cat(miga_frame_t *frame, const strlist_t *args);
+int builtin_miga_jobs_max(miga_frame_t *frame, const strlist_t *args);
+int builtin_miga_stats(miga_frame_t *frame, const strlist_t *args);
+int builtin_miga_trace(miga_frame_t *frame, const strlist_t *args);
 
 int builtin_true(miga_frame_t *frame, const strlist_t *args);
 int builtin_false(miga_frame_t *frame, const strlist_t *args);
@@ -0,0 +1,543 @@
+// ============================================================================
+// completion_index.c
+// Sorted index of command names for completing the first word of a line
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef MIGA_POSIX_API
+#define _POSIX_C_SOURCE 202405L
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef MIGA_POSIX_API
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "completion_index.h"
+
+#include "builtin_store.h"
+#include "logging.h"
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+#include "miga/xalloc.h"
+
+typedef struct completion_node_t completion_node_t;
+
+struct completion_node_t
+{
+    char *label;                  // Edge bytes from the parent, not terminated
+    int label_len;
+    int count;                    // Sources holding the name that ends here
+    completion_node_t **children; // Sorted by first label byte
+    int child_count;
+    int child_capacity;
+};
+
+typedef struct completion_dir_t
+{
+    char *path;
+    bool indexed;     // Its names are in the trie
+    bool in_path;     // Seen in the PATH of the current update
+    long long dev;    // Identity and modification time when last read
+    long long ino;
+    long long mtime_sec;
+    long mtime_nsec;
+    strlist_t *names; // Names it added to the trie
+} completion_dir_t;
+
+struct completion_index_t
+{
+    completion_node_t root;
+    int size;
+
+    completion_dir_t *dirs;
+    int dir_count;
+    int dir_capacity;
+    int dir_scans;
+
+    // Builtins, functions and aliases, and the store generations they
+    // were collected at
+    strlist_t *shell_names;
+    bool shell_names_valid;
+    uint32_t builtins_generation;
+    uint32_t functions_generation;
+    uint32_t aliases_generation;
+};
+
+// ============================================================================
+// Trie
+// ============================================================================
+
+static completion_node_t *node_create(const char *label, int len)
+{
+    completion_node_t *node = xcalloc(1, sizeof(completion_node_t));
+    node->label = xmalloc(len > 0 ? len : 1);
+    memcpy(node->label, label, len);
+    node->label_len = len;
+    return node;
+}
+
+static void node_destroy_children(completion_node_t *node)
+{
+    for (int i = 0; i < node->child_count; i++)
+    {
+        completion_node_t *child = node->children[i];
+        node_destroy_children(child);
+        xfree(child->label);
+        xfree(child);
+    }
+    xfree(node->children);
+    node->children = NULL;
+    node->child_count = 0;
+    node->child_capacity = 0;
+}
+
+// Index of the child whose label starts with c, or where it would go
+static int child_slot(const completion_node_t *node, unsigned char c, bool *found)
+{
+    int lo = 0;
+    int hi = node->child_count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        unsigned char m = (unsigned char)node->children[mid]->label[0];
+        if (m == c)
+        {
+            *found = true;
+            return mid;
+        }
+        if (m < c)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = false;
+    return lo;
+}
+
+static void node_insert_child(completion_node_t *node, int slot, completion_node_t *child)
+{
+    if (node->child_count == node->child_capacity)
+    {
+        node->child_capacity = node->child_capacity ? node->child_capacity * 2 : 4;
+        node->children =
+            xrealloc(node->children, node->child_capacity * sizeof(completion_node_t *));
+    }
+    memmove(&node->children[slot + 1], &node->children[slot],
+            (node->child_count - slot) * sizeof(completion_node_t *));
+    node->children[slot] = child;
+    node->child_count++;
+}
+
+static int common_prefix(const char *a, int a_len, const char *b, int b_len)
+{
+    int n = 0;
+    while (n < a_len && n < b_len && a[n] == b[n])
+        n++;
+    return n;
+}
+
+static void trie_insert(completion_index_t *index, const char *name, int len)
+{
+    completion_node_t *node = &index->root;
+    while (len > 0)
+    {
+        bool found;
+        int slot = child_slot(node, (unsigned char)name[0], &found);
+        if (!found)
+        {
+            completion_node_t *leaf = node_create(name, len);
+            leaf->count = 1;
+            index->size++;
+            node_insert_child(node, slot, leaf);
+            return;
+        }
+
+        completion_node_t *child = node->children[slot];
+        int common = common_prefix(child->label, child->label_len, name, len);
+        if (common < child->label_len)
+        {
+            // Split the edge: a new node for the shared bytes, with the old
+            // child under it
+            completion_node_t *mid = node_create(child->label, common);
+            memmove(child->label, child->label + common, child->label_len - common);
+            child->label_len -= common;
+            node_insert_child(mid, 0, child);
+            node->children[slot] = mid;
+            child = mid;
+        }
+        node = child;
+        name += common;
+        len -= common;
+    }
+    if (node->count++ == 0)
+        index->size++;
+}
+
+// Returns true if `node` is left with no names and should be removed
+static bool trie_remove(completion_index_t *index, completion_node_t *node, const char *name,
+                        int len)
+{
+    if (len == 0)
+    {
+        if (node->count > 0 && --node->count == 0)
+            index->size--;
+        return node->count == 0 && node->child_count == 0;
+    }
+
+    bool found;
+    int slot = child_slot(node, (unsigned char)name[0], &found);
+    if (!found)
+        return false;
+    completion_node_t *child = node->children[slot];
+    if (len < child->label_len || memcmp(child->label, name, child->label_len) != 0)
+        return false;
+
+    if (trie_remove(index, child, name + child->label_len, len - child->label_len))
+    {
+        xfree(child->label);
+        xfree(child);
+        memmove(&node->children[slot], &node->children[slot + 1],
+                (node->child_count - slot - 1) * sizeof(completion_node_t *));
+        node->child_count--;
+    }
+    else if (child->count == 0 && child->child_count == 1)
+    {
+        // Keep the trie compressed: join the child with its only child
+        completion_node_t *grandchild = child->children[0];
+        char *label = xmalloc(child->label_len + grandchild->label_len);
+        memcpy(label, child->label, child->label_len);
+        memcpy(label + child->label_len, grandchild->label, grandchild->label_len);
+        xfree(grandchild->label);
+        grandchild->label = label;
+        grandchild->label_len += child->label_len;
+        node->children[slot] = grandchild;
+        xfree(child->children);
+        xfree(child->label);
+        xfree(child);
+    }
+    return node != &index->root && node->count == 0 && node->child_count == 0;
+}
+
+typedef struct completion_buffer_t
+{
+    char *data;
+    int len;
+    int capacity;
+} completion_buffer_t;
+
+static void buffer_append(completion_buffer_t *buf, const char *data, int len)
+{
+    if (buf->len + len > buf->capacity)
+    {
+        while (buf->len + len > buf->capacity)
+            buf->capacity = buf->capacity ? buf->capacity * 2 : 64;
+        buf->data = xrealloc(buf->data, buf->capacity);
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+// Add every name at or under `node`, whose path spells buf, in order
+static void trie_collect(const completion_node_t *node, completion_buffer_t *buf,
+                         strlist_t *out)
+{
+    if (node->count > 0)
+    {
+        string_t *name = string_create_from_cstr_len(buf->data, buf->len);
+        strlist_move_push_back(out, &name);
+    }
+    for (int i = 0; i < node->child_count; i++)
+    {
+        const completion_node_t *child = node->children[i];
+        int len = buf->len;
+        buffer_append(buf, child->label, child->label_len);
+        trie_collect(child, buf, out);
+        buf->len = len;
+    }
+}
+
+// ============================================================================
+// Sources
+// ============================================================================
+
+static void add_names(completion_index_t *index, strlist_t *names)
+{
+    for (int i = 0; i < strlist_size(names); i++)
+    {
+        const string_t *name = strlist_at(names, i);
+        trie_insert(index, string_cstr(name), string_length(name));
+    }
+}
+
+static void remove_names(completion_index_t *index, strlist_t *names)
+{
+    for (int i = 0; i < strlist_size(names); i++)
+    {
+        const string_t *name = strlist_at(names, i);
+        trie_remove(index, &index->root, string_cstr(name), string_length(name));
+    }
+    strlist_clear(names);
+}
+
+static void dir_forget(completion_index_t *index, completion_dir_t *dir)
+{
+    remove_names(index, dir->names);
+    dir->indexed = false;
+}
+
+#ifdef MIGA_POSIX_API
+static void dir_scan(completion_index_t *index, completion_dir_t *dir)
+{
+    index->dir_scans++;
+    DIR *d = opendir(dir->path);
+    if (!d)
+        return;
+
+    int fd = dirfd(d);
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL)
+    {
+        const char *name = ent->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+        struct stat st;
+        if (fstatat(fd, name, &st, 0) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        if (faccessat(fd, name, X_OK, 0) != 0)
+            continue;
+        string_t *str = string_create_from_cstr(name);
+        strlist_move_push_back(dir->names, &str);
+    }
+    closedir(d);
+
+    add_names(index, dir->names);
+    dir->indexed = true;
+}
+
+// Read the directory again if it is new to the index or has changed
+static void dir_refresh(completion_index_t *index, completion_dir_t *dir)
+{
+    struct stat st;
+    if (stat(dir->path, &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        if (dir->indexed)
+            dir_forget(index, dir);
+        return;
+    }
+    if (dir->indexed && dir->dev == (long long)st.st_dev && dir->ino == (long long)st.st_ino &&
+        dir->mtime_sec == (long long)st.st_mtim.tv_sec && dir->mtime_nsec == st.st_mtim.tv_nsec)
+        return;
+
+    if (dir->indexed)
+        dir_forget(index, dir);
+    dir->dev = (long long)st.st_dev;
+    dir->ino = (long long)st.st_ino;
+    dir->mtime_sec = (long long)st.st_mtim.tv_sec;
+    dir->mtime_nsec = st.st_mtim.tv_nsec;
+    dir_scan(index, dir);
+}
+#endif
+
+static completion_dir_t *dir_find_or_add(completion_index_t *index, const char *path, int len)
+{
+    for (int i = 0; i < index->dir_count; i++)
+    {
+        completion_dir_t *dir = &index->dirs[i];
+        if ((int)strlen(dir->path) == len && memcmp(dir->path, path, len) == 0)
+            return dir;
+    }
+
+    if (index->dir_count == index->dir_capacity)
+    {
+        index->dir_capacity = index->dir_capacity ? index->dir_capacity * 2 : 8;
+        index->dirs = xrealloc(index->dirs, index->dir_capacity * sizeof(completion_dir_t));
+    }
+    completion_dir_t *dir = &index->dirs[index->dir_count++];
+    memset(dir, 0, sizeof(*dir));
+    dir->path = xmalloc(len + 1);
+    memcpy(dir->path, path, len);
+    dir->path[len] = '\0';
+    dir->names = strlist_create();
+    return dir;
+}
+
+static void update_path(completion_index_t *index, const char *path)
+{
+    for (int i = 0; i < index->dir_count; i++)
+        index->dirs[i].in_path = false;
+
+    for (const char *p = path; p && *p;)
+    {
+        const char *colon = strchr(p, ':');
+        int len = colon ? (int)(colon - p) : (int)strlen(p);
+        if (len > 0 && p[0] == '/')
+        {
+            completion_dir_t *dir = dir_find_or_add(index, p, len);
+            if (!dir->in_path)
+            {
+                dir->in_path = true;
+#ifdef MIGA_POSIX_API
+                dir_refresh(index, dir);
+#endif
+            }
+        }
+        p = colon ? colon + 1 : p + len;
+    }
+
+    // Drop the directories that have left PATH
+    int kept = 0;
+    for (int i = 0; i < index->dir_count; i++)
+    {
+        completion_dir_t *dir = &index->dirs[i];
+        if (dir->in_path)
+        {
+            index->dirs[kept++] = *dir;
+            continue;
+        }
+        dir_forget(index, dir);
+        strlist_destroy(&dir->names);
+        xfree(dir->path);
+    }
+    index->dir_count = kept;
+}
+
+static void collect_builtin(const char *name, miga_builtin_fn_t fn,
+                            miga_builtin_category_t category, void *context)
+{
+    (void)fn;
+    (void)category;
+    string_t *str = string_create_from_cstr(name);
+    strlist_move_push_back(context, &str);
+}
+
+static void collect_function(const string_t *name, const ast_node_t *func, void *user_data)
+{
+    (void)func;
+    strlist_push_back(user_data, name);
+}
+
+static void collect_alias(const string_t *name, const string_t *value, void *user_data)
+{
+    (void)value;
+    strlist_push_back(user_data, name);
+}
+
+static void update_shell_names(completion_index_t *index, const builtin_store_t *builtins,
+                               const func_store_t *functions, const alias_store_t *aliases)
+{
+    uint32_t builtins_generation = builtins ? builtins->generation : 0;
+    uint32_t functions_generation = functions ? functions->generation : 0;
+    uint32_t aliases_generation = aliases ? aliases->generation : 0;
+    if (index->shell_names_valid && index->builtins_generation == builtins_generation &&
+        index->functions_generation == functions_generation &&
+        index->aliases_generation == aliases_generation)
+        return;
+
+    remove_names(index, index->shell_names);
+    if (builtins)
+        builtin_store_for_each(builtins, collect_builtin, index->shell_names);
+    if (functions)
+        func_store_foreach(functions, collect_function, index->shell_names);
+    if (aliases)
+        alias_store_foreach(aliases, collect_alias, index->shell_names);
+    add_names(index, index->shell_names);
+
+    index->builtins_generation = builtins_generation;
+    index->functions_generation = functions_generation;
+    index->aliases_generation = aliases_generation;
+    index->shell_names_valid = true;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+completion_index_t *completion_index_create(void)
+{
+    completion_index_t *index = xcalloc(1, sizeof(completion_index_t));
+    index->shell_names = strlist_create();
+    return index;
+}
+
+void completion_index_destroy(completion_index_t **index)
+{
+    if (!index || !*index)
+        return;
+
+    completion_index_t *ix = *index;
+    node_destroy_children(&ix->root);
+    for (int i = 0; i < ix->dir_count; i++)
+    {
+        strlist_destroy(&ix->dirs[i].names);
+        xfree(ix->dirs[i].path);
+    }
+    xfree(ix->dirs);
+    strlist_destroy(&ix->shell_names);
+    xfree(ix);
+    *index = NULL;
+}
+
+void completion_index_update(completion_index_t *index, const char *path,
+                             const builtin_store_t *builtins, const func_store_t *functions,
+                             const alias_store_t *aliases)
+{
+    Expects_not_null(index);
+
+    update_path(index, path);
+    update_shell_names(index, builtins, functions, aliases);
+}
+
+strlist_t *completion_index_find(const completion_index_t *index, const char *prefix)
+{
+    Expects_not_null(index);
+    Expects_not_null(prefix);
+
+    strlist_t *out = strlist_create();
+    completion_buffer_t buf = {0};
+    const completion_node_t *node = &index->root;
+    int len = (int)strlen(prefix);
+
+    while (len > 0)
+    {
+        bool found;
+        int slot = child_slot(node, (unsigned char)prefix[0], &found);
+        if (!found)
+            goto out;
+        const completion_node_t *child = node->children[slot];
+        int common = common_prefix(child->label, child->label_len, prefix, len);
+        if (common < len && common < child->label_len)
+            goto out;
+
+        buffer_append(&buf, child->label, child->label_len);
+        node = child;
+        prefix += common;
+        len -= common;
+    }
+    trie_collect(node, &buf, out);
+
+out:
+    xfree(buf.data);
+    return out;
+}
+
+int completion_index_size(const completion_index_t *index)
+{
+    Expects_not_null(index);
+    return index->size;
+}
+
+int completion_index_dir_scans(const completion_index_t *index)
+{
+    Expects_not_null(index);
+    return index->dir_scans;
+}
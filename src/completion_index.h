@@ -0,0 +1,50 @@
+// ============================================================================
+// completion_index.h
+// Sorted index of command names for completing the first word of a line
+// ============================================================================
+
+#ifndef COMPLETION_INDEX_H
+#define COMPLETION_INDEX_H
+
+#include "alias_store.h"
+#include "func_store.h"
+#include "miga/strlist.h"
+
+typedef struct builtin_store_t builtin_store_t;
+
+// ============================================================================
+// Completion Index
+//
+// The index holds every name a command word could complete to: the
+// executables in the PATH directories, builtins, functions and aliases. The
+// names live in one compressed trie whose children are kept in byte order,
+// so the names under a prefix come out sorted and each one once, however
+// many sources hold it.
+//
+// Updating is incremental. A PATH directory is read again only when its
+// modification time changes (adding or removing a file changes it), and is
+// dropped from the index when it leaves PATH. The shell's own names are
+// collected again only when the generation of the builtin, function or
+// alias store changes. Only absolute PATH directories are indexed, so the
+// result does not depend on the working directory.
+// ============================================================================
+
+typedef struct completion_index_t completion_index_t;
+
+completion_index_t *completion_index_create(void);
+void completion_index_destroy(completion_index_t **index);
+
+// Bring the index up to date with `path` (a PATH value, or NULL) and the
+// given stores, any of which may be NULL.
+void completion_index_update(completion_index_t *index, const char *path,
+                             const builtin_store_t *builtins, const func_store_t *functions,
+                             const alias_store_t *aliases);
+
+// The names that start with `prefix`, sorted bytewise, each once
+strlist_t *completion_index_find(const completion_index_t *index, const char *prefix);
+
+// Statistics, mostly for testing
+int completion_index_size(const completion_index_t *index);      // Distinct names
+int completion_index_dir_scans(const completion_index_t *index); // Directories read
+
+#endif /* COMPLETION_INDEX_H */
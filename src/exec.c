@@ -16,12 +16,13 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif
 
-#include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "miga/exec.h"
@@ -49,9 +50,11 @@
 #include "lower.h"
 #include "parser.h"
 #include "positional_params.h"
+#include "profiler.h"
 #include "sig_act.h"
 #include "token.h"
 #include "tokenizer.h"
+#include "trace.h"
 #include "trap_store.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
@@ -59,7 +62,6 @@
 #ifdef MIGA_POSIX_API
 #include <fcntl.h>
 #include <fnmatch.h>
-#include <limits.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
@@ -136,7 +138,28 @@ static miga_exec_status_t source_rc_files(struct miga_exec_t *e)
 
 struct miga_exec_t *exec_create(void)
 {
-    return xcalloc(1, sizeof(struct miga_exec_t));
+    miga_arena_t *arena = miga_arena_create();
+    miga_arena_t *saved = miga_arena_set_current(arena);
+    struct miga_exec_t *e = xcalloc(1, sizeof(struct miga_exec_t));
+    miga_arena_set_current(saved);
+    e->arena = arena;
+    exec_reset_stats(e);
+
+    // MIGA_TRACE in the environment turns the event trace on from startup
+    const char *trace = getenv("MIGA_TRACE");
+    if (trace && *trace)
+        trace_enable(true);
+    return e;
+}
+
+static void free_owned_envp(miga_exec_t *executor)
+{
+    if (!executor->owned_envp)
+        return;
+    for (char **p = executor->owned_envp; *p; p++)
+        xfree(*p);
+    xfree(executor->owned_envp);
+    executor->owned_envp = NULL;
 }
 
 void exec_destroy(miga_exec_t **executor_ptr)
@@ -145,6 +168,8 @@ void exec_destroy(miga_exec_t **executor_ptr)
         return;
 
     miga_exec_t *e = *executor_ptr;
+    miga_arena_t *arena = e->arena;
+    miga_arena_t *saved = miga_arena_set_current(arena);
 
     /* Pop all frames */
     while (e->current_frame)
@@ -164,8 +189,6 @@ void exec_destroy(miga_exec_t **executor_ptr)
     /* If no frames were created, these may still be owned by the executor. */
     if (e->variables)
         variable_store_destroy(&e->variables);
-    if (e->local_variables)
-        variable_store_destroy(&e->local_variables);
     if (e->positional_params)
         positional_params_destroy(&e->positional_params);
     if (e->functions)
@@ -178,8 +201,24 @@ void exec_destroy(miga_exec_t **executor_ptr)
         trap_store_destroy(&e->traps);
     if (e->original_signals)
         sig_act_store_destroy(&e->original_signals);
+    if (e->builtins)
+        builtin_store_destroy(&e->builtins);
+    if (e->env_vars)
+        strlist_destroy(&e->env_vars);
+    free_owned_envp(e);
 
+    exec_async_destroy(&e->async);
     job_store_destroy(&e->jobs);
+    stat_cache_destroy(&e->stat_cache);
+    printf_format_cache_destroy(&e->printf_cache);
+    prompt_cache_destroy(&e->ps1_cache);
+    prompt_cache_destroy(&e->ps2_cache);
+    completion_index_destroy(&e->completion);
+    history_destroy(&e->history);
+    ifs_splitter_destroy(&e->ifs_splitter);
+    exec_stop_profile(e);
+    if (e->profile_path)
+        string_destroy(&e->profile_path);
 
 #if defined(MIGA_POSIX_API) || defined(MIGA_UCRT_API)
     if (e->open_fds)
@@ -191,6 +230,10 @@ void exec_destroy(miga_exec_t **executor_ptr)
 
     xfree(e);
     *executor_ptr = NULL;
+
+    /* Whatever the executor leaked goes with its arena */
+    miga_arena_set_current(saved == arena ? NULL : saved);
+    miga_arena_destroy(&arena);
 }
 
 /* ============================================================================
@@ -274,6 +317,30 @@ bool exec_set_envp_cstr(miga_exec_t *executor, char *const *envp)
 
     if (exec_is_top_frame_initialized(executor))
         return false;
+
+    char **copy = NULL;
+    if (envp)
+    {
+        int count = 0;
+        while (envp[count])
+            count++;
+        copy = xcalloc(count + 1, sizeof(char *));
+        for (int i = 0; i < count; i++)
+            copy[i] = xstrdup(envp[i]);
+    }
+    free_owned_envp(executor);
+    executor->owned_envp = copy;
+    executor->envp = copy;
+    return true;
+}
+
+bool exec_set_envp_cstr_borrowed(miga_exec_t *executor, char *const *envp)
+{
+    Expects_not_null(executor);
+
+    if (exec_is_top_frame_initialized(executor))
+        return false;
+    free_owned_envp(executor);
     executor->envp = envp;
     return true;
 }
@@ -663,8 +730,6 @@ int exec_get_shell_pid(const miga_exec_t *executor)
 bool exec_set_shell_pid(miga_exec_t *executor, int pid)
 {
     Expects_not_null(executor);
-    if (exec_is_top_frame_initialized(executor))
-        return false;
     executor->shell_pid = pid;
     executor->shell_pid_valid = true;
     return true;
@@ -687,8 +752,6 @@ int exec_get_shell_ppid(const miga_exec_t *executor)
 bool exec_set_shell_ppid(miga_exec_t *executor, int ppid)
 {
     Expects_not_null(executor);
-    if (exec_is_top_frame_initialized(executor))
-        return false;
     executor->shell_ppid = ppid;
     executor->shell_ppid_valid = true;
     return true;
@@ -941,7 +1004,7 @@ bool exec_get_builtin_category_cstr(const miga_exec_t *executor, const char *nam
  * Execution Setup
  * ============================================================================ */
 
-static miga_exec_status_t exec_setup_core(miga_exec_t *e, bool interactive)
+static miga_exec_status_t exec_setup_core_impl(miga_exec_t *e, bool interactive)
 {
     Expects_not_null(e);
 
@@ -1004,13 +1067,12 @@ static miga_exec_status_t exec_setup_core(miga_exec_t *e, bool interactive)
     e->sigchld_received = false;
     memset((void *)e->trap_pending, 0, sizeof(e->trap_pending));
 
-    if (!e->job_control_disabled)
-    {
-        if (e->is_interactive)
-            e->jobs = job_store_create();
-        else
-            e->job_control_disabled = true;
-    }
+    /* The job table is needed even without job control: $!, wait, and the
+     * background job pool all track asynchronous lists through it. */
+    if (!e->jobs)
+        e->jobs = job_store_create();
+    if (!e->job_control_disabled && !e->is_interactive)
+        e->job_control_disabled = true;
 
 #ifdef MIGA_POSIX_API
     if (!e->pgid_valid)
@@ -1050,27 +1112,23 @@ static miga_exec_status_t exec_setup_core(miga_exec_t *e, bool interactive)
         e->builtins = builtin_store_create();
     }
 
-    /* Register the default set of builtin commands unless suppressed.
-     * builtins_init_default uses builtin_store_set which replaces duplicates,
-     * so this is safe even if the caller pre-registered some builtins. */
+    /* Make the default set of builtin commands visible unless suppressed.
+     * They stay in the read-only standard table, under any builtins the
+     * caller pre-registered, so those keep precedence. */
     if (!e->nobuiltins)
     {
         builtins_init_default(e->builtins);
     }
 
-    // e->env_vars is only used for debugging and for keeping a permanent record of the
-    // initial environment variables.
-    // e->envp is the source of the initial environment variables for the top frame when the
-    // top frame is initialized.  It is not used after the top frame is initialized.
+    // e->envp is the source of the initial environment variables for the top frame.  The
+    // top frame's variable store reads it lazily, so the array must stay valid for as long
+    // as the executor exists; exec_set_envp_cstr() makes a copy to guarantee that.
     //
     // N.B. If e->variables is set, e->variables, rather than e->envp, becomes the source of the
     // initial environment variables for the top frame when the top frame is initialized.
-    if (e->envp)
-        e->env_vars = strlist_create_from_cstr_array((const char **)e->envp, -1);
-    else
-        // In MIGA_POSIX_API and MIGA_UCRT_API, this gets the env from the `environ` global.
-        // In ISO C, there is no `environ`, so this will be initialized as an empty list.
-        e->env_vars = strlist_create_from_system_env();
+    //
+    // e->env_vars, a record of the initial environment for debugging, is only kept when the
+    // caller supplied one.
 
     if (!e->top_frame)
     {
@@ -1137,6 +1195,15 @@ static miga_exec_status_t exec_setup_core(miga_exec_t *e, bool interactive)
     return MIGA_EXEC_STATUS_OK;
 }
 
+/* Everything set up for the top frame belongs to the executor's arena */
+static miga_exec_status_t exec_setup_core(miga_exec_t *e, bool interactive)
+{
+    miga_arena_t *saved = miga_arena_set_current(e->arena);
+    miga_exec_status_t status = exec_setup_core_impl(e, interactive);
+    miga_arena_set_current(saved);
+    return status;
+}
+
 miga_exec_status_t exec_setup_interactive(miga_exec_t *executor)
 {
     return exec_setup_core(executor, true);
@@ -1233,7 +1300,8 @@ struct miga_exec_t *exec_create(const struct exec_cfg_t *cfg)
      */
     e->argc = cfg->argv_set ? cfg->argc : 0;
     e->argv = cfg->argv_set ? (char **)cfg->argv : NULL;
-    e->envp = cfg->envp_set ? (char **)cfg->envp : NULL;
+    if (cfg->envp_set)
+        exec_set_envp_cstr(e, (char *const *)cfg->envp);
 
     /* -------------------------------------------------------------------------
      * Shell Name ($0) and Arguments ($@)
@@ -1373,7 +1441,6 @@ struct miga_exec_t *exec_create(const struct exec_cfg_t *cfg)
      * at which point ownership transfers to the frame.
      */
     e->variables = NULL;
-    e->local_variables = NULL;
     e->positional_params = NULL;
     e->functions = NULL;
     e->aliases = alias_store_create();
@@ -1509,295 +1576,49 @@ char *exec_get_ps1_cstr(const miga_exec_t *executor)
     return string_release(&s);
 }
 
-static bool is_valid_ps1_variable_char(char c)
-{
-    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
-}
-
-static bool is_xdigit(char c)
-{
-    return (c >= '0' && c <= '9') ||
-           (c >= 'a' && c <= 'f') ||
-           (c >= 'A' && c <= 'F');
-}
-
 /**
- * Render the PS1 prompt string.
+ * Render the PS1 prompt, or PS2 for a continuation line, as the interactive
+ * loops print it.
  *
  * POSIX (XBD 8.1, XCU 2.5.3) requires that PS1 undergo parameter expansion
- * before being displayed. This implementation performs $VAR / ${VAR}
- * substitution on the raw PS1 value. The special parameters $$ and $? are
- * also expanded, as they are ordinary special parameters defined by POSIX
- * and routinely used in prompts.
- *
- * As a non-POSIX extension, the following backslash escape sequences are
- * also recognised and expanded before parameter substitution:
- *
- *   \n          Newline
- *   \r          Carriage return
- *   \t          Horizontal tab
- *   \\          Backslash
- *   \xhh        Unicode code point U+00hh encoded as UTF-8 (exactly 2 hex digits)
- *   \uhhhh      Unicode code point U+hhhh encoded as UTF-8 (exactly 4 hex digits)
- *   \Uhhhhhhhh  Unicode code point encoded as UTF-8 (exactly 6 hex digits, full range)
- *
- * An unrecognised escape sequence is passed through literally (backslash
- * and following character both emitted) so that typos are visible.
+ * before being displayed; $VAR, ${VAR}, $? and $$ are expanded, along with
+ * some backslash escapes as a non-POSIX extension (see prompt.h).  PS2 is
+ * shown as it is.
  *
- * Returns a newly heap-allocated C string. The caller is responsible for
- * freeing it.
+ * Each prompt is parsed once per value and its rendering is kept until a
+ * variable or the exit status changes, so a paste of many lines does not
+ * render PS2 again for every line.  The result is owned by the executor and
+ * valid until the next call.
  */
-static string_t *render_ps1(const miga_exec_t *exec)
+static const char *render_prompt(miga_exec_t *exec, bool continuation)
 {
     Expects_not_null(exec);
 
     if (!exec->top_frame_initialized)
     {
-        /* No frames at all yet — return the default PS1 value. */
-        return string_create_from_cstr("$ ");
+        /* No frames at all yet — use the default value. */
+        return continuation ? "> " : "$ ";
     }
 
     const miga_frame_t *frame = exec->current_frame;
     Expects_not_null(frame);
 
-    /* -------------------------------------------------------------------------
-     * 1. Retrieve the raw PS1 value.
-     *
-     * If PS1 is unset or empty, use the POSIX
-     * default of "$ ".
-     * -------------------------------------------------------------------------
-     */
-    string_t *ps1_str = string_create_from_cstr("PS1");
-    const string_t *ps1_raw = exec_frame_get_variable(frame, ps1_str);
-    string_destroy(&ps1_str);
-
-    if (!ps1_raw)
-    {
-        return string_create_from_cstr("$ ");
-    }
-
-    /* -------------------------------------------------------------------------
-     * 2. Expand parameter references in the PS1 string.
-     *
-     * Walk the raw string character by character. On '$', attempt to parse a
-     * parameter reference and substitute its value. Everything else is copied
-     * verbatim. No quoting, no field splitting, no globbing — strict POSIX
-     * prompt expansion only.
-     * -------------------------------------------------------------------------
-     */
-    string_t *out = string_create();
-    if (!out)
-        return NULL;
-
-    int i = 0;
-    char c;
-    while (i < string_length(ps1_raw))
-    {
-        /* ------------------------------------------------------------------
-         * Backslash escape sequences (non-POSIX extension).
-         * Processed before '$' so that e.g. "\\$HOME" emits a literal
-         * backslash then expands HOME, not a literal backslash-dollar-HOME.
-         * ------------------------------------------------------------------ */
-        char c = string_at(ps1_raw, i);
-        if (c == '\\')
-        {
-            i++; /* consume '\\' */
-            if (i >= string_length(ps1_raw))
-            {
-                /* Trailing backslash at end of string — emit literally. */
-                string_append_char(out, '\\');
-                break;
-            }
-
-            char c2 = string_at(ps1_raw, i);
-            switch (c2)
-            {
-            case 'n':
-                string_append_char(out, '\n');
-                i++;
-                break;
-            case 'r':
-                string_append_char(out, '\r');
-                i++;
-                break;
-            case 't':
-                string_append_char(out, '\t');
-                i++;
-                break;
-            case '\\':
-                string_append_char(out, '\\');
-                i++;
-                break;
-
-            case 'x': {
-                /* \xhh — exactly 2 hex digits, emitted as a UTF-8 byte.
-                 * We interpret the value as a Unicode code point in the
-                 * range U+0000..U+00FF (Latin-1 supplement), which maps
-                 * trivially to its UTF-8 representation.  Fewer than 2
-                 * valid hex digits: copy the escape literally. */
-                i++; /* consume 'x' */
-                int end = string_find_first_not_of_predicate_at(ps1_raw, is_xdigit, i);
-                if (end == -1 || end - i < 2)
-                {
-                    /* Not enough hex digits — emit literally. */
-                    string_append_cstr(out, "\\x");
-                    continue;
-                }
-                string_t *hex_str = string_substring(ps1_raw, i, i + 2);
-                uint32_t cp = (uint32_t)strtoul(string_cstr(hex_str), NULL, 16);
-                string_append_utf8(out, cp);
-                string_destroy(&hex_str);
-                i += 2;
-                break;
-            }
-
-            case 'u': {
-                /* \uhhhh — exactly 4 hex digits, BMP Unicode code point. */
-                i++; /* consume 'u' */
-                int end = string_find_first_not_of_predicate_at(ps1_raw, is_xdigit, i);
-                if (end == -1 || end - i < 4)
-                {
-                    /* Not enough hex digits — emit literally. */
-                    string_append_cstr(out, "\\u");
-                    continue;
-                }
-                string_t *hex_str = string_substring(ps1_raw, i, i + 4);
-                uint32_t cp = (uint32_t)strtoul(string_cstr(hex_str), NULL, 16);
-                string_append_utf8(out, cp);
-                string_destroy(&hex_str);
-                i += 4;
-                break;
-            }
-
-            case 'U': {
-                /* \Uhhhhhh — exactly 6 hex digits, full Unicode range.
-                 * (Unicode only needs 5.5 hex digits to cover U+10FFFF,
-                 * but 6 gives a clean fixed-width field and matches common
-                 * shell practice for emoji, e.g. \U01F600.) */
-                i++; /* consume 'U' */
-                int end = string_find_first_not_of_predicate_at(ps1_raw, is_xdigit, i);
-                if (end == -1 || end - i < 6)
-                {
-                    /* Not enough hex digits — emit literally. */
-                    string_append_cstr(out, "\\U");
-                    continue;
-                }
-                string_t *hex_str = string_substring(ps1_raw, i, i + 6);
-                uint32_t cp = (uint32_t)strtoul(string_cstr(hex_str), NULL, 16);
-                string_append_utf8(out, cp);
-                string_destroy(&hex_str);
-                i += 6;
-                break;
-            }
-
-            default:
-                /* Unrecognised escape — emit literally so the user sees
-                 * what they typed and can diagnose typos. */
-                string_append_char(out, '\\');
-                string_append_char(out, string_at(ps1_raw, i));
-                i++;
-                break;
-            }
-            continue;
-        }
-
-        if (string_at(ps1_raw, i) != '$')
-        {
-            /* Ordinary character — copy verbatim. */
-            string_append_char(out, string_at(ps1_raw, i));
-            i++;
-            continue;
-        }
-
-        /* '$' found — identify the parameter reference. */
-        i++; /* consume '$' */
-
-        if (string_at(ps1_raw, i) == '{')
-        {
-            /* ${VAR} form */
-            i++; /* consume '{' */
-            int end = string_find_first_of_cstr_at(ps1_raw, "}", i);
-            if (end == -1)
-            {
-                /* No closing '}' found — emit literally. */
-                string_append_cstr(out, "${");
-                continue;
-            }
-            string_t *name_str = string_substring(ps1_raw, i, end);
-            i = end + 1; /* consume up to and including '}' */
-            const string_t *val = exec_frame_get_variable(frame, name_str);
-            if (val)
-                string_append(out, val);
-            else
-            {
-                /* Variable not found - emit literally. */
-                string_append_cstr(out, "${");
-                string_append(out, name_str);
-                string_append_char(out, '}');
-            }
-            string_destroy(&name_str);
-        }
-        else if (string_at(ps1_raw, i) == '?')
-        {
-            /* $? — last exit status */
-            i++;
-            string_t *exit_status_str = string_from_int(exec->last_exit_status);
-            string_append(out, exit_status_str);
-            string_destroy(&exit_status_str);
-        }
-        else if (string_at(ps1_raw, i) == '$')
-        {
-            /* $$ — shell PID */
-            i++;
-            if (exec->shell_pid_valid)
-            {
-                string_t *pid_str = string_from_int(exec->shell_pid);
-                string_append(out, pid_str);
-                string_destroy(&pid_str);
-            }
-            else
-            {
-                /* PID not available — emit literally. */
-                string_append_cstr(out, "$$");
-            }
-        }
-        else if (string_at(ps1_raw, i) == '_' || isalpha((unsigned char)string_at(ps1_raw, i)))
-        {
-            /* $VAR — unbraced name */
-            int end = string_find_first_not_of_predicate_at(ps1_raw, is_valid_ps1_variable_char, i);
-            Expects_ne(end, -1);
-            string_t *name_str = string_substring(ps1_raw, i, end);
-            i = end; /* consume the variable name */
-
-            const string_t *val = exec_frame_get_variable(frame, name_str);
-            if (val)
-                string_append(out, val);
-            else
-            {
-                /* Variable not found - emit literally. */
-                string_append_char(out, '$');
-                string_append(out, name_str);
-            }
-            string_destroy(&name_str);
-        }
-        else
-        {
-            /* Bare '$' not followed by a recognised parameter — copy literally.
-             * POSIX leaves the result unspecified; copying verbatim is the most
-             * conservative and user-friendly choice. */
-            string_append_char(out, '$');
-            /* Do not advance p — the character after '$' will be handled by
-             * the next iteration of the loop. */
-        }
-    }
+    prompt_cache_t **cache = continuation ? &exec->ps2_cache : &exec->ps1_cache;
+    if (!*cache)
+        *cache = continuation ? prompt_cache_create("PS2", "> ", false)
+                              : prompt_cache_create("PS1", "$ ", true);
 
-    return out;
+    prompt_params_t params = {.exit_status = exec->last_exit_status,
+                              .shell_pid = exec->shell_pid,
+                              .shell_pid_valid = exec->shell_pid_valid};
+    return string_cstr(prompt_cache_render(*cache, frame->variables, &params));
 }
 
 string_t *exec_get_rendered_ps1(const miga_exec_t *executor)
 {
     Expects_not_null(executor);
-    return render_ps1(executor);
+    /* Only the prompt cache changes, which is not visible to the caller. */
+    return string_create_from_cstr(render_prompt((miga_exec_t *)executor, false));
 }
 
 char *exec_get_rendered_ps1_cstr(const miga_exec_t *executor)
@@ -1841,10 +1662,16 @@ variable_store_t *exec_get_variables(const miga_exec_t *executor)
     return executor->variables;
 }
 
+/* The alias store moves to the top frame when it is created, and alias and
+ * unalias update it there. Parse sessions must expand from that store. */
 alias_store_t *exec_get_aliases(const miga_exec_t *executor)
 {
     Expects_not_null(executor);
-    return executor->aliases;
+    if (executor->aliases)
+        return executor->aliases;
+    if (executor->top_frame_initialized && executor->top_frame)
+        return executor->top_frame->aliases;
+    return NULL;
 }
 
 bool exec_is_interactive(const miga_exec_t *executor)
@@ -1885,6 +1712,16 @@ void exec_setup_interactive_execute(miga_exec_t *executor)
  * Stream Execution Core
  * ============================================================================ */
 
+/* A script started with exec_start() and not yet finished owns the
+ * executor's frames; running anything else on them would corrupt it. */
+static bool exec_refuse_while_pending(miga_exec_t *executor, const char *fn)
+{
+    if (!exec_async_pending(executor))
+        return false;
+    exec_set_error_printf(executor, "%s: a script started with exec_start() is pending", fn);
+    return true;
+}
+
 miga_exec_status_t exec_execute_stream_repl(miga_exec_t *executor, FILE *fp, bool interactive)
 {
     Expects_not_null(executor);
@@ -1930,17 +1767,7 @@ miga_exec_status_t exec_execute_stream_repl(miga_exec_t *executor, FILE *fp, boo
         /* ---- 1. Prompt ---- */
         if (interactive)
         {
-            if (need_continuation)
-            {
-                const char *ps2 = exec_get_ps2_cstr(executor);
-                fprintf(stderr, "%s", ps2);
-            }
-            else
-            {
-                string_t *ps1 = render_ps1(executor);
-                fprintf(stderr, "%s", ps1 ? string_cstr(ps1) : "$ ");
-                string_destroy(&ps1);
-            }
+            fputs(render_prompt(executor, need_continuation), stderr);
             fflush(stderr);
         }
 
@@ -2108,7 +1935,7 @@ miga_exec_status_t exec_execute_stream_repl(miga_exec_t *executor, FILE *fp, boo
                  * the lexer, accumulated tokens, and any buffered
                  * compound-command tokens in the tokenizer are flushed.
                  */
-                parse_session_hard_reset(session, executor->aliases);
+                parse_session_hard_reset(session, exec_get_aliases(executor));
             }
             else
             {
@@ -2126,11 +1953,17 @@ done:
 
 miga_exec_status_t exec_execute_stream(miga_exec_t *executor, FILE *fp)
 {
-    return exec_execute_stream_repl(executor, fp, executor->is_interactive);
+    if (exec_refuse_while_pending(executor, __func__))
+        return MIGA_EXEC_STATUS_ERROR;
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_status_t status = exec_execute_stream_repl(executor, fp, executor->is_interactive);
+    miga_arena_set_current(saved);
+    return status;
 }
 
 /* For non-interactive execution of a named script */
-miga_exec_status_t exec_execute_stream_named(miga_exec_t *executor, FILE *fp, const char *filename)
+static miga_exec_status_t exec_execute_named_stream_impl(miga_exec_t *executor, FILE *fp,
+                                                         const char *filename)
 {
     Expects_not_null(executor);
     Expects_not_null(fp);
@@ -2154,7 +1987,18 @@ miga_exec_status_t exec_execute_stream_named(miga_exec_t *executor, FILE *fp, co
     return status;
 }
 
-miga_exec_status_t exec_execute_stream_once(miga_exec_t *executor, FILE *fp)
+miga_exec_status_t exec_execute_named_stream(miga_exec_t *executor, FILE *fp, const char *filename)
+{
+    Expects_not_null(executor);
+    if (exec_refuse_while_pending(executor, __func__))
+        return MIGA_EXEC_STATUS_ERROR;
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_status_t result = exec_execute_named_stream_impl(executor, fp, filename);
+    miga_arena_set_current(saved);
+    return result;
+}
+
+static miga_exec_status_t exec_execute_stream_once_impl(miga_exec_t *executor, FILE *fp)
 {
     Expects_not_null(executor);
     Expects_not_null(fp);
@@ -2243,56 +2087,26 @@ miga_exec_status_t exec_execute_stream_once(miga_exec_t *executor, FILE *fp)
     return status;
 }
 
-/* this version is for executing -c complete strings. Incomplete inputs are errors */
-miga_exec_result_t exec_execute_command_string(miga_exec_t *executor, const char *command)
+miga_exec_status_t exec_execute_stream_once(miga_exec_t *executor, FILE *fp)
 {
     Expects_not_null(executor);
-    Expects_not_null(command);
+    if (exec_refuse_while_pending(executor, __func__))
+        return MIGA_EXEC_STATUS_ERROR;
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_status_t result = exec_execute_stream_once_impl(executor, fp);
+    miga_arena_set_current(saved);
+    return result;
+}
 
+/* Map the status of a complete command string to a top-level result.
+ * Incomplete input is an error here, and exit or a top-level return ends
+ * the shell. */
+static miga_exec_result_t exec_command_string_result(miga_exec_t *executor, miga_frame_t *frame,
+                                                     miga_exec_status_t status)
+{
     miga_exec_result_t result = {.status = MIGA_EXEC_STATUS_OK, .exit_code = 0};
 
-    /* ------------------------------------------------------------------
-     * Ensure the frame stack is initialized.
-     * For -c invocations the caller should have called
-     * exec_setup_noninteractive() beforehand, but handle the lazy case.
-     * ------------------------------------------------------------------ */
-    if (!executor->top_frame_initialized)
-    {
-        miga_exec_status_t setup = exec_setup_core(executor, false);
-        if (setup != MIGA_EXEC_STATUS_OK)
-            log_warn("lazy setup for command string failed with status %d", setup);
-        /* Not fatal — proceed with whatever state we have. */
-    }
-
-    miga_frame_t *frame = executor->current_frame;
-    if (!frame)
-    {
-        exec_set_error_cstr(executor, "No execution frame available");
-        result.status = MIGA_EXEC_STATUS_ERROR;
-        result.exit_code = EXEC_EXIT_FAILURE;
-        return result;
-    }
-
-    /* ------------------------------------------------------------------
-     * Create a temporary parse session.
-     * Unlike the REPL, we feed all input at once, so the session is
-     * local to this call rather than persistent across lines.
-     * ------------------------------------------------------------------ */
-    parse_session_t *session = exec_create_parse_session(executor);
-    if (!session)
-    {
-        exec_set_error_cstr(executor, "Failed to create parse session");
-        result.status = MIGA_EXEC_STATUS_ERROR;
-        result.exit_code = EXEC_EXIT_FAILURE;
-        return result;
-    }
-
-    /* ------------------------------------------------------------------
-     * Feed the entire command string to the core execution engine.
-     * ------------------------------------------------------------------ */
-    miga_exec_status_t str_status = exec_frame_string_core(frame, command, session);
-
-    switch (str_status)
+    switch (status)
     {
     case MIGA_EXEC_STATUS_OK:
         result.status = MIGA_EXEC_STATUS_OK;
@@ -2323,6 +2137,12 @@ miga_exec_result_t exec_execute_command_string(miga_exec_t *executor, const char
         result.exit_code =
             executor->last_exit_status ? executor->last_exit_status : EXEC_EXIT_FAILURE;
         break;
+
+    case MIGA_EXEC_STATUS_PENDING:
+        /* A script that must wait is suspended inside the executor; only
+         * exec_start() and exec_resume() report it, never the core. */
+        Expects(false && "Pending status from a command string");
+        break;
     }
 
     /* ------------------------------------------------------------------
@@ -2341,51 +2161,379 @@ miga_exec_result_t exec_execute_command_string(miga_exec_t *executor, const char
         result.exit_code = executor->last_exit_status;
     }
 
-    /* ------------------------------------------------------------------
-     * Clean up.
-     * ------------------------------------------------------------------ */
-    parse_session_destroy(&session);
-
     return result;
 }
 
-/* ============================================================================
- * Partial State Lifecycle
- * ============================================================================ */
-
-parse_session_t *exec_create_parse_session(miga_exec_t *executor)
+/* this version is for executing -c complete strings. Incomplete inputs are errors */
+static miga_exec_result_t exec_execute_command_string_impl(miga_exec_t *executor,
+                                                           const char *command)
 {
     Expects_not_null(executor);
-    return parse_session_create(executor->aliases);
-}
-
-size_t exec_get_parse_session_size(void)
-{
-    return sizeof(parse_session_t);
-}
+    Expects_not_null(command);
 
-void exec_reset_parse_session(parse_session_t *session)
-{
-    Expects_not_null(session);
-    parse_session_reset(session);
-}
+    miga_exec_result_t result = {.status = MIGA_EXEC_STATUS_OK, .exit_code = 0};
 
-void exec_hard_reset_parse_session(parse_session_t *session, miga_exec_t *executor)
-{
-    Expects_not_null(session);
-    if (executor)
-        parse_session_hard_reset(session, executor->aliases);
-    else
-        parse_session_hard_reset(session, NULL);
-}
+    /* ------------------------------------------------------------------
+     * Ensure the frame stack is initialized.
+     * For -c invocations the caller should have called
+     * exec_setup_noninteractive() beforehand, but handle the lazy case.
+     * ------------------------------------------------------------------ */
+    if (!executor->top_frame_initialized)
+    {
+        miga_exec_status_t setup = exec_setup_core(executor, false);
+        if (setup != MIGA_EXEC_STATUS_OK)
+            log_warn("lazy setup for command string failed with status %d", setup);
+        /* Not fatal — proceed with whatever state we have. */
+    }
 
-const char *exec_get_parse_session_filename_cstr(const parse_session_t *session)
-{
-    Expects_not_null(session);
-    return session->filename ? string_cstr(session->filename) : NULL;
-}
+    miga_frame_t *frame = executor->current_frame;
+    if (!frame)
+    {
+        exec_set_error_cstr(executor, "No execution frame available");
+        result.status = MIGA_EXEC_STATUS_ERROR;
+        result.exit_code = EXEC_EXIT_FAILURE;
+        return result;
+    }
 
-size_t exec_get_parse_session_line_number(const parse_session_t *session)
+    /* ------------------------------------------------------------------
+     * Create a temporary parse session.
+     * Unlike the REPL, we feed all input at once, so the session is
+     * local to this call rather than persistent across lines.
+     * ------------------------------------------------------------------ */
+    parse_session_t *session = exec_create_parse_session(executor);
+    if (!session)
+    {
+        exec_set_error_cstr(executor, "Failed to create parse session");
+        result.status = MIGA_EXEC_STATUS_ERROR;
+        result.exit_code = EXEC_EXIT_FAILURE;
+        return result;
+    }
+
+    /* ------------------------------------------------------------------
+     * Feed the entire command string to the core execution engine.
+     * ------------------------------------------------------------------ */
+    miga_exec_status_t str_status = exec_frame_string_core(frame, command, session);
+
+    result = exec_command_string_result(executor, frame, str_status);
+
+    /* ------------------------------------------------------------------
+     * Clean up.
+     * ------------------------------------------------------------------ */
+    parse_session_destroy(&session);
+
+    return result;
+}
+
+miga_exec_result_t exec_execute_command_string(miga_exec_t *executor, const char *command)
+{
+    Expects_not_null(executor);
+    if (exec_refuse_while_pending(executor, __func__))
+        return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_ERROR, .exit_code = 1};
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_result_t result = exec_execute_command_string_impl(executor, command);
+    miga_arena_set_current(saved);
+    return result;
+}
+
+/* ============================================================================
+ * Compiled Programs
+ * ============================================================================ */
+
+struct miga_program_t
+{
+    ast_node_t *ast; // Lowered program, NULL if the text held no commands
+};
+
+static miga_program_t *exec_compile_impl(miga_exec_t *executor, const char *text)
+{
+    Expects_not_null(executor);
+    Expects_not_null(text);
+
+    parse_session_t *session = exec_create_parse_session(executor);
+    if (!session)
+    {
+        exec_set_error_cstr(executor, "Failed to create parse session");
+        return NULL;
+    }
+
+    uint64_t start = profiler_wall_clock_ns();
+    ast_node_t *ast = NULL;
+    miga_exec_status_t status = exec_parse_core(executor, text, session, &ast);
+    executor->stats.parse_ns += profiler_wall_clock_ns() - start;
+    parse_session_destroy(&session);
+
+    switch (status)
+    {
+    case MIGA_EXEC_STATUS_OK:
+    case MIGA_EXEC_STATUS_EMPTY:
+        break;
+
+    case MIGA_EXEC_STATUS_INCOMPLETE:
+        exec_set_error_cstr(executor, "Unexpected end of input (unclosed quote, "
+                                      "here-document, or compound command)");
+        return NULL;
+
+    default:
+        return NULL;
+    }
+
+    /* Running the program must not write to it, not even to cache a hash,
+     * so that other executors can run it at the same time. */
+    ast_node_fill_hashes(ast);
+
+    miga_program_t *program = xcalloc(1, sizeof(miga_program_t));
+    program->ast = ast;
+    return program;
+}
+
+/* A program can outlive the executor that compiled it, so it is allocated
+ * from the global arena rather than the executor's. */
+miga_program_t *exec_compile_cstr(miga_exec_t *executor, const char *text)
+{
+    miga_arena_t *saved = miga_arena_set_current(NULL);
+    miga_program_t *program = exec_compile_impl(executor, text);
+    miga_arena_set_current(saved);
+    return program;
+}
+
+miga_program_t *exec_compile_stream(miga_exec_t *executor, FILE *fp)
+{
+    Expects_not_null(executor);
+    Expects_not_null(fp);
+
+    string_t *text = string_create();
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+        string_append_data(text, chunk, (int)n);
+
+    miga_program_t *program = NULL;
+    if (ferror(fp))
+        exec_set_error_cstr(executor, "Failed to read program text");
+    else
+        program = exec_compile_cstr(executor, string_cstr(text));
+
+    string_destroy(&text);
+    return program;
+}
+
+static miga_exec_result_t exec_run_program_impl(miga_exec_t *executor,
+                                                const miga_program_t *program)
+{
+    Expects_not_null(executor);
+    Expects_not_null(program);
+
+    miga_exec_result_t result = {.status = MIGA_EXEC_STATUS_OK, .exit_code = 0};
+
+    if (!executor->top_frame_initialized)
+    {
+        miga_exec_status_t setup = exec_setup_core(executor, false);
+        if (setup != MIGA_EXEC_STATUS_OK)
+            log_warn("lazy setup for compiled program failed with status %d", setup);
+    }
+
+    miga_frame_t *frame = executor->current_frame;
+    if (!frame)
+    {
+        exec_set_error_cstr(executor, "No execution frame available");
+        result.status = MIGA_EXEC_STATUS_ERROR;
+        result.exit_code = EXEC_EXIT_FAILURE;
+        return result;
+    }
+
+    miga_exec_status_t status = MIGA_EXEC_STATUS_EMPTY;
+    if (program->ast)
+        status = exec_frame_run_ast(frame, program->ast);
+
+    return exec_command_string_result(executor, frame, status);
+}
+
+miga_exec_result_t exec_run_program(miga_exec_t *executor, const miga_program_t *program)
+{
+    Expects_not_null(executor);
+    if (exec_refuse_while_pending(executor, __func__))
+        return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_ERROR, .exit_code = 1};
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_result_t result = exec_run_program_impl(executor, program);
+    miga_arena_set_current(saved);
+    return result;
+}
+
+void miga_program_free(miga_program_t **program)
+{
+    if (!program || !*program)
+        return;
+    ast_node_destroy(&(*program)->ast);
+    xfree(*program);
+    *program = NULL;
+}
+
+/* ============================================================================
+ * Snapshots
+ * ============================================================================ */
+
+struct miga_snapshot_t
+{
+    string_t *shell_name;
+    builtin_store_t *builtins;
+
+    variable_store_t *variables;
+    positional_params_t *positional_params;
+    func_store_t *functions; // Bodies are shared with every clone, read-only
+    alias_store_t *aliases;
+    trap_store_t *traps;
+    string_t *working_directory;
+    exec_opt_flags_t opt;
+#ifdef MIGA_POSIX_API
+    mode_t umask;
+#else
+    int umask;
+#endif
+    int last_exit_status;
+};
+
+static miga_snapshot_t *exec_snapshot_impl(miga_exec_t *executor)
+{
+    const miga_frame_t *top = executor->top_frame;
+    if (!top || executor->current_frame != top)
+    {
+        exec_set_error_cstr(executor, "Cannot snapshot an executor while it is executing");
+        return NULL;
+    }
+
+    miga_snapshot_t *snapshot = xcalloc(1, sizeof(miga_snapshot_t));
+    snapshot->shell_name =
+        executor->shell_name ? string_create_from(executor->shell_name) : NULL;
+    snapshot->builtins = builtin_store_clone(executor->builtins);
+
+    snapshot->variables = variable_store_clone(top->variables);
+    variable_store_set_counters(snapshot->variables, NULL);
+    // The snapshot outlives the executor's envp array
+    variable_store_import_env(snapshot->variables);
+    snapshot->positional_params = positional_params_clone(top->positional_params);
+    snapshot->functions = func_store_clone_detached(top->functions);
+    func_store_fill_hashes(snapshot->functions);
+    snapshot->aliases = alias_store_clone(top->aliases);
+    snapshot->traps = trap_store_clone(top->traps);
+    snapshot->working_directory =
+        top->working_directory ? string_create_from(top->working_directory) : NULL;
+    snapshot->opt = *top->opt_flags;
+    snapshot->umask = top->umask ? *top->umask : 0;
+    snapshot->last_exit_status = top->last_exit_status;
+
+    return snapshot;
+}
+
+/* Like a compiled program, a snapshot outlives the executor it came from and
+ * lives in the global arena. */
+miga_snapshot_t *exec_snapshot(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    if (!executor->top_frame_initialized)
+    {
+        miga_exec_status_t setup = exec_setup_core(executor, false);
+        if (setup != MIGA_EXEC_STATUS_OK)
+            log_warn("lazy setup for snapshot failed with status %d", setup);
+    }
+
+    miga_arena_t *saved = miga_arena_set_current(NULL);
+    miga_snapshot_t *snapshot = exec_snapshot_impl(executor);
+    miga_arena_set_current(saved);
+    return snapshot;
+}
+
+miga_exec_t *exec_clone_from_snapshot(const miga_snapshot_t *snapshot)
+{
+    Expects_not_null(snapshot);
+
+    miga_exec_t *e = exec_create();
+    miga_arena_t *saved = miga_arena_set_current(e->arena);
+    e->shell_name = snapshot->shell_name ? string_create_from(snapshot->shell_name) : NULL;
+    e->env_vars = strlist_create(); // Nothing is imported from the process environment
+    e->builtins = builtin_store_clone(snapshot->builtins);
+    e->nobuiltins = true; // Already in the copied registry, including removals
+    e->inhibit_rc_files = true;
+
+    /* exec_frame_create_top_level() adopts these instead of building its own */
+    e->variables = variable_store_clone(snapshot->variables);
+    variable_store_set_counters(e->variables, &e->var_counters);
+    e->positional_params = positional_params_clone(snapshot->positional_params);
+    e->functions = func_store_clone(snapshot->functions);
+    e->aliases = alias_store_clone(snapshot->aliases);
+    e->traps = trap_store_clone(snapshot->traps);
+    e->working_directory =
+        snapshot->working_directory ? string_create_from(snapshot->working_directory) : NULL;
+    e->opt = snapshot->opt;
+    e->umask = snapshot->umask;
+    e->last_exit_status = snapshot->last_exit_status;
+    e->last_exit_status_set = true;
+
+    miga_exec_status_t setup = exec_setup_core(e, false);
+    if (setup != MIGA_EXEC_STATUS_OK)
+        log_warn("setup for snapshot clone failed with status %d", setup);
+    miga_arena_set_current(saved);
+
+    return e;
+}
+
+void exec_snapshot_destroy(miga_snapshot_t **snapshot)
+{
+    if (!snapshot || !*snapshot)
+        return;
+
+    miga_snapshot_t *s = *snapshot;
+    if (s->shell_name)
+        string_destroy(&s->shell_name);
+    builtin_store_destroy(&s->builtins);
+    variable_store_destroy(&s->variables);
+    positional_params_destroy(&s->positional_params);
+    func_store_destroy(&s->functions);
+    alias_store_destroy(&s->aliases);
+    trap_store_destroy(&s->traps);
+    if (s->working_directory)
+        string_destroy(&s->working_directory);
+    xfree(s);
+    *snapshot = NULL;
+}
+
+/* ============================================================================
+ * Partial State Lifecycle
+ * ============================================================================ */
+
+parse_session_t *exec_create_parse_session(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+    return parse_session_create(exec_get_aliases(executor));
+}
+
+size_t exec_get_parse_session_size(void)
+{
+    return sizeof(parse_session_t);
+}
+
+void exec_reset_parse_session(parse_session_t *session)
+{
+    Expects_not_null(session);
+    parse_session_reset(session);
+}
+
+void exec_hard_reset_parse_session(parse_session_t *session, miga_exec_t *executor)
+{
+    Expects_not_null(session);
+    if (executor)
+        parse_session_hard_reset(session, exec_get_aliases(executor));
+    else
+        parse_session_hard_reset(session, NULL);
+}
+
+const char *exec_get_parse_session_filename_cstr(const parse_session_t *session)
+{
+    Expects_not_null(session);
+    return session->filename ? string_cstr(session->filename) : NULL;
+}
+
+size_t exec_get_parse_session_line_number(const parse_session_t *session)
 {
     Expects_not_null(session);
     return session->caller_line_number;
@@ -2427,9 +2575,9 @@ void exec_destroy_parse_session(parse_session_t **session)
  * Incremental Command String Execution
  * ============================================================================ */
 
-miga_exec_status_t exec_execute_command_string_partial_cstr(miga_exec_t *executor, const char *command,
-                                                       const char *filename, size_t line_number,
-                                                       parse_session_t *session)
+static miga_exec_status_t exec_execute_partial_impl(miga_exec_t *executor, const char *command,
+                                                    const char *filename, size_t line_number,
+                                                    parse_session_t *session)
 {
     Expects_not_null(executor);
     Expects_not_null(command);
@@ -2514,7 +2662,7 @@ miga_exec_status_t exec_execute_command_string_partial_cstr(miga_exec_t *executo
      * ------------------------------------------------------------------ */
     if (!session->tokenizer)
     {
-        session->tokenizer = tokenizer_create(executor->aliases);
+        session->tokenizer = tokenizer_create(exec_get_aliases(executor));
         if (!session->tokenizer)
         {
             exec_set_error_cstr(executor, "Failed to create tokenizer");
@@ -2621,6 +2769,20 @@ miga_exec_status_t exec_execute_command_string_partial_cstr(miga_exec_t *executo
     return result;
 }
 
+miga_exec_status_t exec_execute_command_string_partial_cstr(miga_exec_t *executor, const char *command,
+                                                       const char *filename, size_t line_number,
+                                                       parse_session_t *session)
+{
+    Expects_not_null(executor);
+    if (exec_refuse_while_pending(executor, __func__))
+        return MIGA_EXEC_STATUS_ERROR;
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    miga_exec_status_t result =
+        exec_execute_partial_impl(executor, command, filename, line_number, session);
+    miga_arena_set_current(saved);
+    return result;
+}
+
 /* ============================================================================
  * Line-Editor Integration
  * ============================================================================ */
@@ -2632,6 +2794,8 @@ miga_exec_status_t exec_execute_stream_with_line_editor(miga_exec_t *executor, F
     Expects_not_null(executor);
     Expects_not_null(fp);
     Expects_not_null(line_editor_fn);
+    if (exec_refuse_while_pending(executor, __func__))
+        return MIGA_EXEC_STATUS_ERROR;
 
     /* ------------------------------------------------------------------
      * This function is only valid for interactive mode.
@@ -2689,16 +2853,8 @@ miga_exec_status_t exec_execute_stream_with_line_editor(miga_exec_t *executor, F
         }
 
         /* ---- 1. Build the prompt ---- */
-        char *prompt = NULL;
-        if (need_continuation)
-        {
-            prompt = exec_get_ps2_cstr(executor);
-        }
-        else
-        {
-            string_t *ps1 = render_ps1(executor);
-            prompt = ps1 ? string_release(&ps1) : xstrdup("$ ");
-        }
+        /* A copy, since the line editor could render the prompt itself */
+        char *prompt = xstrdup(render_prompt(executor, need_continuation));
 
         /* ---- 2. Call the line editor ---- */
         line_edit_status_t le_status = line_editor_fn(prompt, &line, line_editor_user_data);
@@ -2754,7 +2910,7 @@ miga_exec_status_t exec_execute_stream_with_line_editor(miga_exec_t *executor, F
             consecutive_eof = 0;
             need_continuation = false;
 
-            parse_session_hard_reset(session, executor->aliases);
+            parse_session_hard_reset(session, exec_get_aliases(executor));
 
             /* POSIX: $? = 128 + SIGINT after an interrupted command. */
             executor->last_exit_status = 128 + SIGINT;
@@ -2776,6 +2932,9 @@ miga_exec_status_t exec_execute_stream_with_line_editor(miga_exec_t *executor, F
         /* Got valid input — reset consecutive-EOF counter. */
         consecutive_eof = 0;
 
+        if (string_length(line) > 0)
+            exec_history_add(executor, string_cstr(line));
+
         /* ---- 5. Append a newline and feed to the execution core ----
          *
          * exec_frame_string_core expects input lines to end with '\n' (the
@@ -2900,7 +3059,7 @@ miga_exec_status_t exec_execute_stream_with_line_editor(miga_exec_t *executor, F
             fprintf(stderr, "\n");
             need_continuation = false;
 
-            parse_session_hard_reset(session, executor->aliases);
+            parse_session_hard_reset(session, exec_get_aliases(executor));
         }
 
     } /* for (;;) */
@@ -2912,6 +3071,114 @@ done:
     return final_result;
 }
 
+strlist_t *exec_complete_prefix(miga_exec_t *executor, const char *prefix)
+{
+    Expects_not_null(executor);
+    Expects_not_null(prefix);
+
+    const miga_frame_t *frame = executor->current_frame;
+    variable_store_t *vars = frame ? frame->variables : executor->variables;
+    const func_store_t *functions = frame ? frame->functions : executor->functions;
+    const alias_store_t *aliases = frame ? frame->aliases : executor->aliases;
+    const char *path = vars ? variable_store_get_value_cstr(vars, "PATH") : NULL;
+
+    /* The index belongs to the executor; the list of names to the caller */
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    if (!executor->completion)
+        executor->completion = completion_index_create();
+    completion_index_update(executor->completion, path, executor->builtins, functions, aliases);
+    miga_arena_set_current(saved);
+
+    return completion_index_find(executor->completion, prefix);
+}
+
+/* The command history, opened from HISTFILE on first use. Call with the
+ * executor's arena current. */
+static history_t *exec_history(miga_exec_t *executor)
+{
+    if (executor->history)
+        return executor->history;
+
+    const miga_frame_t *frame = executor->current_frame;
+    variable_store_t *vars = frame ? frame->variables : executor->variables;
+    const char *path = vars ? variable_store_get_value_cstr(vars, "HISTFILE") : NULL;
+    if (path && *path)
+    {
+        executor->history = history_open(path);
+        if (!executor->history)
+            log_warn("history: cannot open %s: %s", path, strerror(errno));
+    }
+    if (!executor->history)
+        executor->history = history_create();
+    return executor->history;
+}
+
+bool exec_history_open(miga_exec_t *executor, const char *path)
+{
+    Expects_not_null(executor);
+
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    if (executor->history)
+        history_destroy(&executor->history);
+    bool ok = true;
+    if (path)
+    {
+        executor->history = history_open(path);
+        ok = executor->history != NULL;
+    }
+    if (!executor->history)
+        executor->history = history_create();
+    miga_arena_set_current(saved);
+    return ok;
+}
+
+bool exec_history_add(miga_exec_t *executor, const char *line)
+{
+    Expects_not_null(executor);
+    Expects_not_null(line);
+
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    bool ok = history_add(exec_history(executor), line);
+    miga_arena_set_current(saved);
+    return ok;
+}
+
+long exec_history_count(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    long count = history_count(exec_history(executor));
+    miga_arena_set_current(saved);
+    return count;
+}
+
+string_t *exec_history_get(miga_exec_t *executor, long n)
+{
+    Expects_not_null(executor);
+
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    history_t *hist = exec_history(executor);
+    miga_arena_set_current(saved);
+
+    string_t *entry = string_create();
+    if (!history_get(hist, n, entry))
+        string_destroy(&entry);
+    return entry;
+}
+
+long exec_history_search(miga_exec_t *executor, const char *text, long before)
+{
+    Expects_not_null(executor);
+    Expects_not_null(text);
+
+    /* The trigram index grows in the executor's arena */
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    long found = history_search(exec_history(executor), text, before);
+    miga_arena_set_current(saved);
+    return found;
+}
+
 /* ============================================================================
  * Global State Queries
  * ============================================================================ */
@@ -3544,6 +3811,7 @@ void exec_reap_background_jobs(miga_exec_t *executor, bool notify)
      * if no child process has recently completed */
     while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
     {
+        executor->stats.waits++;
         // Determine if the job is done, or if it was terminated by a signal
         bool terminated = WIFSIGNALED(status);
         int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
@@ -3595,3 +3863,251 @@ void exec_reap_background_jobs(miga_exec_t *executor, bool notify)
         job_store_remove_completed(executor->jobs);
 #endif
 }
+
+/* ── Background job pool ─────────────────────────────────────────────────── */
+
+#ifdef MIGA_POSIX_API
+/**
+ * Block until one of the job table's processes changes state and record the
+ * result.  Only those PIDs are waited for, so children of the embedding
+ * program or of another executor are not reaped.  Returns the reaped PID,
+ * or -1 if no job process is running.
+ */
+static pid_t exec_reap_next_child(miga_exec_t *executor)
+{
+    pid_t *pids;
+    int count = job_store_active_pids(executor->jobs, 0, &pids);
+
+    int status;
+    pid_t pid = exec_async_wait_any(executor, pids, count, &status);
+    xfree(pids);
+
+    if (pid > 0 && status == -1)
+    {
+        /* Reaped by someone else; its status is lost */
+        job_store_set_process_state(executor->jobs, pid, JOB_DONE, 127);
+    }
+    else if (pid > 0)
+    {
+        executor->stats.waits++;
+        if (WIFSIGNALED(status))
+            job_store_set_process_state(executor->jobs, pid, JOB_TERMINATED,
+                                        128 + WTERMSIG(status));
+        else
+            job_store_set_process_state(executor->jobs, pid, JOB_DONE, WEXITSTATUS(status));
+    }
+    return pid;
+}
+#elifdef MIGA_UCRT_API
+/**
+ * Block until any active background process exits and record the result in
+ * the job table.  Returns false if there was nothing to wait for.
+ */
+static bool exec_reap_next_child(miga_exec_t *executor)
+{
+#define MAX_WAIT_HANDLES 64
+    HANDLE handles[MAX_WAIT_HANDLES];
+    job_process_iterator_t iters[MAX_WAIT_HANDLES];
+    DWORD handle_count = 0;
+
+    job_process_iterator_t iter = job_store_active_processes_begin(executor->jobs);
+    while (job_store_active_processes_next(&iter) && handle_count < MAX_WAIT_HANDLES)
+    {
+        uintptr_t h = job_store_iter_get_handle(&iter);
+        if (h != 0)
+        {
+            handles[handle_count] = (HANDLE)h;
+            iters[handle_count] = iter;
+            handle_count++;
+        }
+    }
+    if (handle_count == 0)
+        return false;
+
+    DWORD result = WaitForMultipleObjects(handle_count, handles, FALSE, INFINITE);
+    if (result >= WAIT_OBJECT_0 + handle_count)
+        return false;
+
+    DWORD idx = result - WAIT_OBJECT_0;
+    DWORD exit_code = 0;
+    GetExitCodeProcess(handles[idx], &exit_code);
+    job_store_iter_set_state(&iters[idx], JOB_DONE, (int)exit_code);
+    return true;
+#undef MAX_WAIT_HANDLES
+}
+#endif
+
+/**
+ * Report a completed job: fetch the exit status of its last process and
+ * drop it from the job table.
+ */
+static int exec_collect_completed_job(miga_exec_t *executor, job_t *job, int *job_id_out)
+{
+    int exit_status = 0;
+    for (const process_t *proc = job->processes; proc; proc = proc->next)
+        exit_status = proc->exit_status;
+
+    if (job_id_out)
+        *job_id_out = job->job_id;
+    job_store_remove(executor->jobs, job->job_id);
+    return exit_status;
+}
+
+int exec_wait_for_any(miga_exec_t *executor, int *job_id_out)
+{
+    Expects_not_null(executor);
+
+    if (!executor->jobs)
+        return -1;
+
+    job_t *done = job_store_find_unreported_completed(executor->jobs);
+    if (done)
+        return exec_collect_completed_job(executor, done, job_id_out);
+
+#ifdef MIGA_POSIX_API
+    while (job_store_count_running(executor->jobs) > 0)
+    {
+        pid_t pid = exec_reap_next_child(executor);
+        if (pid < 0)
+            break;
+
+        job_t *job = job_store_find_by_pid(executor->jobs, pid);
+        if (job && job->is_background && job_is_completed(job))
+            return exec_collect_completed_job(executor, job, job_id_out);
+    }
+#elifdef MIGA_UCRT_API
+    while (job_store_count_running(executor->jobs) > 0)
+    {
+        if (!exec_reap_next_child(executor))
+            break;
+
+        done = job_store_find_unreported_completed(executor->jobs);
+        if (done)
+            return exec_collect_completed_job(executor, done, job_id_out);
+    }
+#endif
+    return -1;
+}
+
+bool exec_set_jobs_max(miga_exec_t *executor, int max_jobs)
+{
+    Expects_not_null(executor);
+    if (max_jobs < 0)
+        return false;
+    executor->jobs_max = max_jobs;
+    return true;
+}
+
+int exec_get_jobs_max(const miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+    return executor->jobs_max;
+}
+
+int exec_get_default_jobs_max(void)
+{
+#ifdef MIGA_POSIX_API
+    long nproc = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nproc > 0 && nproc <= INT_MAX)
+        return (int)nproc;
+#elifdef MIGA_UCRT_API
+    const char *nproc_str = getenv("NUMBER_OF_PROCESSORS");
+    if (nproc_str)
+    {
+        long nproc = strtol(nproc_str, NULL, 10);
+        if (nproc > 0 && nproc <= INT_MAX)
+            return (int)nproc;
+    }
+#endif
+    return 1;
+}
+
+void exec_wait_for_job_slot(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    if (executor->jobs_max <= 0 || !executor->jobs)
+        return;
+
+#if defined(MIGA_POSIX_API)
+    while (job_store_count_running(executor->jobs) >= (size_t)executor->jobs_max)
+    {
+        if (exec_reap_next_child(executor) < 0)
+            break;
+    }
+#elifdef MIGA_UCRT_API
+    while (job_store_count_running(executor->jobs) >= (size_t)executor->jobs_max)
+    {
+        if (!exec_reap_next_child(executor))
+            break;
+    }
+#endif
+}
+
+/* ============================================================================
+ * Profiling
+ * ============================================================================ */
+
+#define EXEC_DEFAULT_PROFILE_PATH "miga-profile.folded"
+
+bool exec_start_profile(miga_exec_t *executor, const char *path)
+{
+    Expects_not_null(executor);
+
+    if (path)
+    {
+        if (executor->profile_path)
+            string_set_cstr(executor->profile_path, path);
+        else
+            executor->profile_path = string_create_from_cstr(path);
+    }
+    else if (!executor->profile_path)
+    {
+        executor->profile_path = string_create_from_cstr(EXEC_DEFAULT_PROFILE_PATH);
+    }
+
+    if (!executor->profiler)
+        executor->profiler = profiler_create(string_cstr(executor->profile_path));
+    return true;
+}
+
+bool exec_stop_profile(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    if (!executor->profiler)
+        return false;
+
+    bool ok = profiler_write(executor->profiler);
+    profiler_destroy(&executor->profiler);
+    return ok;
+}
+
+bool exec_is_profiling(const miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+    return executor->profiler != NULL;
+}
+
+/* ── Statistics ──────────────────────────────────────────────────────────── */
+
+void exec_get_stats(const miga_exec_t *executor, miga_exec_stats_t *out)
+{
+    Expects_not_null(executor);
+    Expects_not_null(out);
+
+    *out = executor->stats;
+    out->variable_lookups = executor->var_counters.lookups;
+    out->variable_inserts = executor->var_counters.inserts;
+    out->envp_rebuilds = executor->var_counters.envp_builds;
+    out->bytes_allocated = executor->arena->bytes_allocated - executor->stats_bytes_base;
+}
+
+void exec_reset_stats(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    memset(&executor->stats, 0, sizeof(executor->stats));
+    memset(&executor->var_counters, 0, sizeof(executor->var_counters));
+    executor->stats_bytes_base = executor->arena->bytes_allocated;
+}
@@ -0,0 +1,520 @@
+// ============================================================================
+// exec_async.c
+// Resumable execution: scripts that yield to an event loop instead of blocking
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#ifdef MIGA_POSIX_API
+#define _GNU_SOURCE
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef MIGA_POSIX_API
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if __has_include(<ucontext.h>)
+#include <ucontext.h>
+#define EXEC_ASYNC_COROUTINES
+#endif
+#if __has_include(<sys/syscall.h>)
+#include <sys/syscall.h>
+#endif
+#if __has_include(<sys/epoll.h>) && defined(SYS_pidfd_open)
+#include <sys/epoll.h>
+#define EXEC_ASYNC_PID_WATCH
+#endif
+#endif
+
+#include "exec_async.h"
+
+#include "exec_types_internal.h"
+#include "logging.h"
+#include "miga/mutex.h"
+#include "miga/xalloc.h"
+
+// Function calls in the shell recurse in the executor, so a script needs a
+// generous stack. Pages are only committed as they are touched.
+#define EXEC_ASYNC_STACK_SIZE ((size_t)8 * 1024 * 1024)
+
+#ifdef EXEC_ASYNC_PID_WATCH
+typedef struct pid_watch_entry_t
+{
+    pid_t pid;
+    int fd; // pidfd, registered in the set's epoll descriptor
+} pid_watch_entry_t;
+
+// The children exec_async_wait_any() waits for, as pidfds in one epoll set.
+// The set is kept between calls, so a loop of `wait -n` only opens a pidfd
+// for a job it has not seen before and closes the ones for jobs that are gone.
+typedef struct pid_watch_t
+{
+    int ep;      // epoll descriptor, valid while owner is not 0
+    pid_t owner; // Process that made ep; a forked child makes its own
+    pid_watch_entry_t *entries;
+    struct epoll_event *events; // Scratch for pid_watch_sync(), same capacity
+    int count;
+    int capacity;
+} pid_watch_t;
+#endif
+
+struct exec_async_t
+{
+#ifdef EXEC_ASYNC_COROUTINES
+    ucontext_t loop;   // The caller of exec_start() or exec_resume()
+    ucontext_t script; // The script, while it is suspended
+    void *stack;       // Kept between scripts; NULL until the first exec_start()
+    pid_t owner;       // Only this process may suspend; forked children block
+#endif
+    char *command;
+    miga_exec_result_t result; // Valid once the script has finished
+    bool running;              // Started and not yet finished
+    bool in_script;            // Executing on the script's stack right now
+    int wait_fd;               // What a suspended script is waiting for
+    short wait_events;
+#ifdef EXEC_ASYNC_PID_WATCH
+    pid_watch_t watch; // For exec_async_wait_any()
+#endif
+};
+
+#ifdef EXEC_ASYNC_PID_WATCH
+static void pid_watch_release(pid_watch_t *w);
+#endif
+
+#ifdef MIGA_POSIX_API
+// The executor's resumable execution state, created on first use
+static exec_async_t *async_state(miga_exec_t *executor)
+{
+    if (!executor->async)
+    {
+        miga_arena_t *saved = miga_arena_set_current(executor->arena);
+        executor->async = xcalloc(1, sizeof(exec_async_t));
+        executor->async->wait_fd = -1;
+        miga_arena_set_current(saved);
+    }
+    return executor->async;
+}
+#endif
+
+void exec_async_destroy(exec_async_t **async)
+{
+    if (!async || !*async)
+        return;
+
+    exec_async_t *a = *async;
+    if (a->running)
+        log_warn("exec_async_destroy: abandoning a script that has not finished");
+#ifdef EXEC_ASYNC_COROUTINES
+    if (a->stack)
+        munmap(a->stack, EXEC_ASYNC_STACK_SIZE);
+#endif
+    if (a->command)
+        xfree(a->command);
+#ifdef EXEC_ASYNC_PID_WATCH
+    pid_watch_release(&a->watch);
+#endif
+    xfree(a);
+    *async = NULL;
+}
+
+bool exec_async_pending(const miga_exec_t *executor)
+{
+    const exec_async_t *a = executor ? executor->async : NULL;
+    return a && a->running && !a->in_script;
+}
+
+// ============================================================================
+// Suspending the Script
+// ============================================================================
+
+#ifdef MIGA_POSIX_API
+// The state to suspend, or NULL if the caller is not a resumable script
+// running in the process that started it
+static exec_async_t *suspendable(miga_exec_t *executor)
+{
+#ifdef EXEC_ASYNC_COROUTINES
+    exec_async_t *a = executor ? executor->async : NULL;
+    if (a && a->in_script && a->owner == getpid())
+        return a;
+#else
+    (void)executor;
+#endif
+    return NULL;
+}
+
+static void suspend(exec_async_t *a, int fd, short events)
+{
+#ifdef EXEC_ASYNC_COROUTINES
+    a->wait_fd = fd;
+    a->wait_events = events;
+    a->in_script = false;
+    swapcontext(&a->script, &a->loop);
+    a->in_script = true;
+    a->wait_fd = -1;
+    a->wait_events = 0;
+#else
+    (void)a;
+    (void)fd;
+    (void)events;
+#endif
+}
+
+// A descriptor that becomes readable when the child exits, or -1
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    if (pid > 0)
+        return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+#endif
+    return -1;
+}
+
+pid_t exec_async_waitpid(miga_exec_t *executor, pid_t pid, int *status, int options)
+{
+    pid_t ret;
+    exec_async_t *a = suspendable(executor);
+    if (a && !(options & WNOHANG))
+    {
+        for (;;)
+        {
+            ret = waitpid(pid, status, options | WNOHANG);
+            if (ret == -1 && errno == EINTR)
+                continue;
+            if (ret != 0)
+                return ret;
+
+            // Process groups and "any child" have no descriptor to poll
+            int fd = open_pidfd(pid);
+            if (fd < 0)
+                break;
+            suspend(a, fd, POLLIN);
+            close(fd);
+        }
+    }
+
+    do
+    {
+        ret = waitpid(pid, status, options);
+    } while (ret == -1 && errno == EINTR);
+    return ret;
+}
+
+#ifdef EXEC_ASYNC_PID_WATCH
+// Close every descriptor of the set. In a forked child this only drops the
+// child's copies; the parent's registrations are untouched.
+static void pid_watch_close(pid_watch_t *w)
+{
+    for (int i = 0; i < w->count; i++)
+        close(w->entries[i].fd);
+    if (w->owner)
+        close(w->ep);
+    w->count = 0;
+    w->owner = 0;
+}
+
+static void pid_watch_release(pid_watch_t *w)
+{
+    pid_watch_close(w);
+    xfree(w->entries);
+    xfree(w->events);
+    w->entries = NULL;
+    w->events = NULL;
+    w->capacity = 0;
+}
+
+static bool pid_listed(const pid_t *pids, int count, pid_t pid)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (pids[i] == pid)
+            return true;
+    }
+    return false;
+}
+
+static void pid_watch_remove(pid_watch_t *w, int i)
+{
+    epoll_ctl(w->ep, EPOLL_CTL_DEL, w->entries[i].fd, NULL);
+    close(w->entries[i].fd);
+    w->entries[i] = w->entries[--w->count];
+}
+
+// Make the set watch exactly PIDS, adding and removing only what changed.
+// Returns false if the set cannot be made.
+static bool pid_watch_sync(pid_watch_t *w, const pid_t *pids, int count)
+{
+    pid_t self = getpid();
+    if (w->owner != self)
+    {
+        pid_watch_close(w);
+        w->ep = epoll_create1(EPOLL_CLOEXEC);
+        if (w->ep < 0)
+            return false;
+        w->owner = self;
+    }
+
+    // The caller has just polled every PID without reaping one, so a pidfd
+    // that is ready now refers to a process that was reaped elsewhere, and
+    // its PID may since have been reused. It is reopened below.
+    int ready = w->count ? epoll_wait(w->ep, w->events, w->count, 0) : 0;
+    for (int r = 0; r < ready; r++)
+    {
+        for (int i = 0; i < w->count; i++)
+        {
+            if (w->entries[i].fd == w->events[r].data.fd)
+            {
+                pid_watch_remove(w, i);
+                break;
+            }
+        }
+    }
+    for (int i = w->count - 1; i >= 0; i--)
+    {
+        if (!pid_listed(pids, count, w->entries[i].pid))
+            pid_watch_remove(w, i);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        bool watched = false;
+        for (int j = 0; j < w->count && !watched; j++)
+            watched = w->entries[j].pid == pids[i];
+        if (watched)
+            continue;
+
+        int fd = open_pidfd(pids[i]);
+        if (fd < 0)
+            return false;
+        struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+        if (epoll_ctl(w->ep, EPOLL_CTL_ADD, fd, &ev) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        if (w->count == w->capacity)
+        {
+            w->capacity = w->capacity ? w->capacity * 2 : 8;
+            w->entries = xrealloc(w->entries, (size_t)w->capacity * sizeof(pid_watch_entry_t));
+            w->events = xrealloc(w->events, (size_t)w->capacity * sizeof(struct epoll_event));
+        }
+        w->entries[w->count++] = (pid_watch_entry_t){.pid = pids[i], .fd = fd};
+    }
+    return true;
+}
+#endif
+
+// Return once one of PIDS has changed state, suspending a resumable script
+// until then. All of them are watched through the executor's epoll set of
+// pidfds, which is also what a script suspends on. Returns false, having
+// waited for nothing, if that cannot be set up.
+static bool wait_any_pidfd(miga_exec_t *executor, exec_async_t *a, const pid_t *pids, int count)
+{
+#ifdef EXEC_ASYNC_PID_WATCH
+    pid_watch_t scratch = {0};
+    pid_watch_t *w = executor ? &async_state(executor)->watch : &scratch;
+    miga_arena_t *saved = executor ? miga_arena_set_current(executor->arena) : NULL;
+    bool ok = pid_watch_sync(w, pids, count);
+    if (!ok)
+        pid_watch_release(w);
+    if (executor)
+        miga_arena_set_current(saved);
+
+    if (ok && a)
+    {
+        suspend(a, w->ep, POLLIN);
+    }
+    else if (ok)
+    {
+        struct epoll_event ev;
+        while (epoll_wait(w->ep, &ev, 1, -1) < 0 && errno == EINTR)
+            ;
+    }
+    if (w == &scratch)
+        pid_watch_release(w);
+    return ok;
+#else
+    (void)executor;
+    (void)a;
+    (void)pids;
+    (void)count;
+    return false;
+#endif
+}
+
+pid_t exec_async_wait_any(miga_exec_t *executor, const pid_t *pids, int count, int *status)
+{
+    if (count <= 0)
+    {
+        errno = ECHILD;
+        return -1;
+    }
+
+    exec_async_t *a = suspendable(executor);
+    do
+    {
+        for (int i = 0; i < count; i++)
+        {
+            pid_t ret;
+            do
+            {
+                ret = waitpid(pids[i], status, WNOHANG);
+            } while (ret == -1 && errno == EINTR);
+            if (ret == pids[i])
+                return ret;
+            if (ret == -1 && errno == ECHILD)
+            {
+                *status = -1;
+                return pids[i];
+            }
+        }
+    } while (wait_any_pidfd(executor, a, pids, count));
+
+    // Without pidfds, wait for the first one
+    pid_t ret = exec_async_waitpid(executor, pids[0], status, 0);
+    if (ret == -1 && errno == ECHILD)
+    {
+        *status = -1;
+        return pids[0];
+    }
+    return ret;
+}
+
+void exec_async_wait_readable(miga_exec_t *executor, int fd)
+{
+    exec_async_t *a = suspendable(executor);
+    if (!a)
+        return;
+
+    struct pollfd p = {.fd = fd, .events = POLLIN};
+    int ready;
+    while ((ready = poll(&p, 1, 0)) == 0 || (ready < 0 && errno == EINTR))
+    {
+        if (ready == 0)
+            suspend(a, fd, POLLIN);
+    }
+}
+#endif
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+#ifdef EXEC_ASYNC_COROUTINES
+// makecontext() can only pass int arguments, so the executor being started
+// is handed to the new stack through here
+static MIGA_THREAD_LOCAL miga_exec_t *starting_executor;
+
+static void script_main(void)
+{
+    miga_exec_t *executor = starting_executor;
+    exec_async_t *a = executor->async;
+    a->result = exec_execute_command_string(executor, a->command);
+    a->running = false;
+    a->in_script = false;
+    // Returning resumes a->loop through uc_link
+}
+
+// Run the script until it finishes or suspends
+static miga_exec_result_t switch_to_script(miga_exec_t *executor)
+{
+    exec_async_t *a = executor->async;
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    a->in_script = true;
+    swapcontext(&a->loop, &a->script);
+    miga_arena_set_current(saved);
+
+    if (a->running)
+        return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_PENDING, .exit_code = 0};
+
+    miga_arena_t *own = miga_arena_set_current(executor->arena);
+    xfree(a->command);
+    a->command = NULL;
+    miga_arena_set_current(own);
+    return a->result;
+}
+#endif
+
+miga_exec_result_t exec_start(miga_exec_t *executor, const char *command)
+{
+    Expects_not_null(executor);
+    Expects_not_null(command);
+
+    if (executor->async && executor->async->running)
+    {
+        exec_set_error_cstr(executor, "exec_start: a script is already running");
+        return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_ERROR, .exit_code = 1};
+    }
+
+#ifdef EXEC_ASYNC_COROUTINES
+    exec_async_t *a = async_state(executor);
+    miga_arena_t *saved = miga_arena_set_current(executor->arena);
+    if (!a->stack)
+    {
+        a->stack = mmap(NULL, EXEC_ASYNC_STACK_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (a->stack == MAP_FAILED)
+        {
+            a->stack = NULL;
+            miga_arena_set_current(saved);
+            exec_set_error_cstr(executor, "exec_start: cannot allocate a stack for the script");
+            return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_ERROR, .exit_code = 1};
+        }
+        // Guard page: running off the end faults instead of corrupting memory
+        mprotect(a->stack, (size_t)sysconf(_SC_PAGESIZE), PROT_NONE);
+    }
+    a->command = xstrdup(command);
+    a->owner = getpid();
+    a->running = true;
+    miga_arena_set_current(saved);
+
+    getcontext(&a->script);
+    a->script.uc_stack.ss_sp = a->stack;
+    a->script.uc_stack.ss_size = EXEC_ASYNC_STACK_SIZE;
+    a->script.uc_link = &a->loop;
+    makecontext(&a->script, script_main, 0);
+
+    starting_executor = executor;
+    return switch_to_script(executor);
+#else
+    // No way to suspend a script here: run it to completion
+    return exec_execute_command_string(executor, command);
+#endif
+}
+
+bool exec_poll(const miga_exec_t *executor, int *fd, short *events)
+{
+    Expects_not_null(executor);
+
+    const exec_async_t *a = executor->async;
+    if (!a || !a->running)
+        return false;
+    if (fd)
+        *fd = a->wait_fd;
+    if (events)
+        *events = a->wait_events;
+    return true;
+}
+
+miga_exec_result_t exec_resume(miga_exec_t *executor)
+{
+    Expects_not_null(executor);
+
+    if (!executor->async || !executor->async->running)
+    {
+        exec_set_error_cstr(executor, "exec_resume: no script is pending");
+        return (miga_exec_result_t){.status = MIGA_EXEC_STATUS_ERROR, .exit_code = 1};
+    }
+#ifdef EXEC_ASYNC_COROUTINES
+    return switch_to_script(executor);
+#else
+    return executor->async->result;
+#endif
+}
@@ -0,0 +1,60 @@
+// ============================================================================
+// exec_async.h
+// Resumable execution: scripts that yield to an event loop instead of blocking
+// ============================================================================
+
+#ifndef EXEC_ASYNC_H
+#define EXEC_ASYNC_H
+
+#include "miga/exec.h"
+
+#ifdef MIGA_POSIX_API
+#include <sys/types.h>
+#endif
+
+// ============================================================================
+// Resumable Execution State
+//
+// A script started with exec_start() runs on a stack of its own. Wherever the
+// executor would otherwise block on a child process, it asks this module to
+// wait instead; the script's stack is then suspended and control returns to
+// the caller of exec_start() or exec_resume(), which can poll the descriptor
+// reported by exec_poll() before resuming. Scripts run by any other entry
+// point, and the children forked by a resumable script, wait as they always
+// did.
+//
+// The public functions, exec_start(), exec_poll() and exec_resume(), are
+// declared in miga/exec.h.
+// ============================================================================
+
+typedef struct exec_async_t exec_async_t;
+
+// Release an executor's resumable execution state and set the pointer to
+// NULL. A script that is still pending is abandoned. Safe to call with NULL
+// or *async == NULL.
+void exec_async_destroy(exec_async_t **async);
+
+// Whether a script started with exec_start() is suspended, waiting to be
+// resumed. Its frames are live, so nothing else may run on the executor;
+// code running inside the script itself (traps, say) does not count.
+bool exec_async_pending(const miga_exec_t *executor);
+
+#ifdef MIGA_POSIX_API
+// waitpid() that retries on EINTR. If the executor is running a resumable
+// script, the script is suspended until the child changes state rather than
+// blocking the thread. EXECUTOR may be NULL, in which case this just waits.
+pid_t exec_async_waitpid(miga_exec_t *executor, pid_t pid, int *status, int options);
+
+// Wait for whichever of the COUNT processes in PIDS changes state first, and
+// return its PID. Unlike waitpid(-1, ...), no other child is reaped, so
+// children the embedding program started are left alone. If one of PIDS
+// turns out not to be a child (reaped by someone else), its PID is returned
+// with *STATUS set to -1. Returns -1 with errno ECHILD if COUNT is 0.
+pid_t exec_async_wait_any(miga_exec_t *executor, const pid_t *pids, int count, int *status);
+
+// Return once FD has data to read or is at end of file, suspending a
+// resumable script until then. Returns at once for any other script.
+void exec_async_wait_readable(miga_exec_t *executor, int fd);
+#endif
+
+#endif
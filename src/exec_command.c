@@ -9,7 +9,9 @@
 #endif
 
 #include <errno.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +39,7 @@
 // #include "builtins.h"
 #include "builtin_store.h"
 #include "miga/exec.h"
+#include "miga/frame.h"
 #include "exec_frame.h"
 #include "exec_frame_expander.h"
 #include "exec_frame_policy.h"
@@ -48,6 +51,7 @@
 #include "miga/strlist.h"
 #include "miga/string_t.h"
 #include "token.h"
+#include "trace.h"
 #include "trap_store.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
@@ -59,153 +63,122 @@
  * ============================================================================ */
 
 /**
- * Populate special shell variables into a variable store.
- * Populates $?, $!, $$, $_, $- from frame state.
+ * Apply the prefix assignments of a simple command to the frame's variable
+ * store, exported, and record the values they hide in `saves` so that the
+ * caller can put them back when the command finishes. A failed assignment
+ * (to a read-only variable, say) is logged and skipped.
  */
-static void populate_special_variables(variable_store_t *store, const miga_frame_t *frame)
+static void apply_prefix_assignments(miga_frame_t *frame, const ast_node_t *node,
+                                     exec_var_saves_t *saves)
 {
-    Expects_not_null(store);
     Expects_not_null(frame);
-    Expects_not_null(frame->executor);
-
-    const miga_exec_t *ex = frame->executor;
-    char buf[32];
-
-    /* $? - last exit status from frame */
-    snprintf(buf, sizeof(buf), "%d", frame->last_exit_status);
-    variable_store_add_cstr(store, "?", buf, false, false);
+    Expects_not_null(node);
+    Expects_eq(node->type, AST_SIMPLE_COMMAND);
 
-    /* $! - last background PID from frame */
-    if (frame->last_bg_pid > 0)
-    {
-        snprintf(buf, sizeof(buf), "%d", frame->last_bg_pid);
-        variable_store_add_cstr(store, "!", buf, false, false);
-    }
+    token_list_t *assignments = node->data.simple_command.assignments;
+    if (!assignments)
+        return;
 
-    /* $$ - shell PID from executor (singleton) */
-    if (ex->shell_pid_valid)
+    for (int i = 0; i < token_list_size(assignments); i++)
     {
-        snprintf(buf, sizeof(buf), "%d", ex->shell_pid);
-        variable_store_add_cstr(store, "$", buf, false, false);
-    }
+        const token_t *tok = token_list_get(assignments, i);
+        string_t *value = expand_assignment_value(frame, tok);
 
-    /* $_ - last argument from executor */
-    if (ex->last_argument_set)
-    {
-        variable_store_add_cstr(store, "_", string_cstr(ex->last_argument), false, false);
-    }
+        exec_var_saves_record(saves, frame->variables, tok->assignment_name);
+        var_store_error_t err =
+            variable_store_add(frame->variables, tok->assignment_name, value, true, false);
+        string_destroy(&value);
 
-    /* $- - option flags from frame */
-    if (frame->opt_flags)
-    {
-        char flags[16] = {0};
-        int idx = 0;
-
-        if (frame->opt_flags->allexport)
-            flags[idx++] = 'a';
-        if (frame->opt_flags->errexit)
-            flags[idx++] = 'e';
-        if (frame->opt_flags->noclobber)
-            flags[idx++] = 'C';
-        if (frame->opt_flags->noglob)
-            flags[idx++] = 'f';
-        if (frame->opt_flags->noexec)
-            flags[idx++] = 'n';
-        if (frame->opt_flags->nounset)
-            flags[idx++] = 'u';
-        if (frame->opt_flags->verbose)
-            flags[idx++] = 'v';
-        if (frame->opt_flags->xtrace)
-            flags[idx++] = 'x';
-        if (ex->is_interactive)
-            flags[idx++] = 'i';
-
-        flags[idx] = '\0';
-        variable_store_add_cstr(store, "-", flags, false, false);
+        if (err != VAR_STORE_ERROR_NONE)
+        {
+            log_warn("Failed to assign variable '%s' for command",
+                     string_cstr(tok->assignment_name));
+        }
     }
 }
 
 /**
- * Build a temporary variable store for a simple command:
- *   - copies all variables from frame->variables
- *   - populates special vars ($?, $!, $$, $_, $-)
- *   - overlays assignment words from the command with expanded RHS
+ * Make the prefix assignments of a special builtin permanent, as POSIX
+ * requires. Each variable gets back the export flag it had before the
+ * command.
  */
-static variable_store_t *build_temp_store_for_siple_command(miga_frame_t *frame,
-                                                            const ast_node_t *node)
+static void keep_prefix_assignments(variable_store_t *store, exec_var_saves_t *saves)
 {
-    Expects_not_null(frame);
-    Expects_not_null(node);
-    Expects_eq(node->type, AST_SIMPLE_COMMAND);
-
-    variable_store_t *temp = variable_store_create();
-    variable_store_copy_all(temp, frame->variables);
-    populate_special_variables(temp, frame);
-
-    token_list_t *assignments = node->data.simple_command.assignments;
-    if (assignments)
+    for (int i = 0; i < saves->count; i++)
     {
-        for (int i = 0; i < token_list_size(assignments); i++)
-        {
-            const token_t *tok = token_list_get(assignments, i);
-            string_t *value = expand_assignment_value(frame, tok);
+        if (variable_store_has_name(store, saves->items[i].name))
+            variable_store_set_exported(store, saves->items[i].name, saves->items[i].exported);
+    }
+    exec_var_saves_clear(saves);
+}
 
-            var_store_error_t err =
-                variable_store_add(temp, tok->assignment_name, value, true, false);
-            string_destroy(&value);
+/* ============================================================================
+ * Command Classification
+ * ============================================================================ */
 
-            if (err != VAR_STORE_ERROR_NONE)
-            {
-                log_warn("Failed to add variable '%s' to temporary variable store",
-                         string_cstr(tok->assignment_name));
-            }
-        }
-    }
+/* The cache holds the class in the low byte, under the generations of the
+ * builtin and function stores it was computed against.  A generation is
+ * never 0, so neither is a filled cache. */
+#define COMMAND_CLASS_CACHE_STAMP(builtins, functions)                                             \
+    (((uint64_t)(functions)->generation << 32) |                                                   \
+     ((uint64_t)((builtins)->generation & 0xFFFFFFu) << 8))
 
-    return temp;
+/* A command name can be cached on the node only if it cannot expand to
+ * something else next time. */
+static bool command_name_is_literal(const ast_node_t *node)
+{
+    const token_t *tok = token_list_get(node->data.simple_command.words, 0);
+    return !token_needs_expansion(tok) && !token_needs_pathname_expansion(tok);
 }
 
 /**
- * Apply prefix assignments to the shell's variable store.
- * Used for special builtins where POSIX requires assignments to persist.
- *
- * This gets called when the executor is executing a special builtin command,
- * and when it's variable store is the shell's temp store for that command.
- * So we apply the assignments to both the temp store and the shell's main store.
- *
+ * Decide what the expanded command name refers to, in POSIX order: reserved
+ * word, special builtin, function, regular builtin, or external command.
+ * Sets *fn_out for a builtin and *func_body_out for a function.  When the
+ * name is literal, the class is remembered on the node, so the next run of
+ * the same command skips the lookups that cannot match until a builtin or
+ * function is defined or removed.
  */
-static miga_exec_status_t apply_prefix_assignments(miga_frame_t *frame, variable_store_t *main_store,
-                                              const ast_node_t *node)
+static command_class_t classify_command(miga_frame_t *frame, const ast_node_t *node,
+                                        const char *name, miga_builtin_fn_t *fn_out,
+                                        const ast_node_t **func_body_out)
 {
-    Expects_not_null(frame);
-    Expects_not_null(node);
-    Expects_eq(node->type, AST_SIMPLE_COMMAND);
+    const builtin_store_t *builtins = frame->executor->builtins;
+    _Atomic uint64_t *cache = &((ast_node_t *)node)->data.simple_command.command_class_cache;
+    uint64_t stamp = COMMAND_CLASS_CACHE_STAMP(builtins, frame->functions);
+    bool literal = command_name_is_literal(node);
 
-    miga_exec_t *executor = frame->executor;
-    const token_list_t *assignments = node->data.simple_command.assignments;
-    if (!assignments)
-        return MIGA_EXEC_STATUS_OK;
+    *fn_out = NULL;
+    *func_body_out = NULL;
 
-    for (int i = 0; i < token_list_size(assignments); i++)
+    if (literal)
     {
-        const token_t *tok = token_list_get(assignments, i);
-        string_t *value = expand_assignment_value(frame, tok);
-        var_store_error_t err =
-            variable_store_add(frame->variables, tok->assignment_name, value, false, false);
+        uint64_t cached = atomic_load_explicit(cache, memory_order_relaxed);
+        if (cached && (cached & ~(uint64_t)0xFF) == stamp)
+        {
+            command_class_t cls = (command_class_t)(cached & 0xFF);
+            if (cls == COMMAND_CLASS_FUNCTION)
+                *func_body_out = func_store_get_def_cstr(frame->functions, name);
+            else if (cls == COMMAND_CLASS_SPECIAL_BUILTIN || cls == COMMAND_CLASS_REGULAR_BUILTIN)
+                builtin_store_classify(builtins, name, fn_out);
+            return cls;
+        }
+    }
 
-        if (err != VAR_STORE_ERROR_NONE)
+    command_class_t cls = builtin_store_classify(builtins, name, fn_out);
+    if (cls != COMMAND_CLASS_RESERVED_WORD && cls != COMMAND_CLASS_SPECIAL_BUILTIN)
+    {
+        *func_body_out = func_store_get_def_cstr(frame->functions, name);
+        if (*func_body_out)
         {
-            exec_set_error_printf(executor, "Cannot assign variable (error %d)", err);
-            string_destroy(&value);
-            return MIGA_EXEC_STATUS_ERROR;
+            cls = COMMAND_CLASS_FUNCTION;
+            *fn_out = NULL;
         }
-        /* If we get here, the variable name and value must have been valid, so no need
-         * for error checking */
-        variable_store_add(main_store, tok->assignment_name, value, false, false);
-        string_destroy(&value);
     }
 
-    return MIGA_EXEC_STATUS_OK;
+    if (literal)
+        atomic_store_explicit(cache, stamp | (uint64_t)cls, memory_order_relaxed);
+    return cls;
 }
 
 /* ============================================================================
@@ -226,29 +199,40 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
     const ast_node_list_t *redirs = node->data.simple_command.redirections;
 
     bool has_words = (word_tokens && token_list_size(word_tokens) > 0);
+    bool has_redirs = (redirs && ast_node_list_size(redirs) > 0);
 
     /* Assignment-only command (no words, no redirs) */
-    if (!has_words && !redirs)
+    if (!has_words && !has_redirs)
     {
         if (assign_tokens)
         {
             for (int i = 0; i < token_list_size(assign_tokens); i++)
             {
                 const token_t *tok = token_list_get(assign_tokens, i);
+                if (executor->profiler)
+                    profiler_enter(executor->profiler, PROFILER_EXPAND, NULL);
                 string_t *value = expand_assignment_value(frame, tok);
+                if (executor->profiler)
+                    profiler_leave(executor->profiler);
                 if (!value)
                 {
                     exec_set_error_cstr(executor, "assignment expansion failed");
                     return (exec_frame_execute_result_t){.status = MIGA_EXEC_STATUS_ERROR};
                 }
 
-                var_store_error_t err =
-                    variable_store_add(frame->variables, tok->assignment_name, value, false, false);
+                /* Keeps the variable's exported and read-only attributes */
+                miga_var_status_t st = frame_set_variable(frame, tok->assignment_name, value);
                 string_destroy(&value);
 
-                if (err != VAR_STORE_ERROR_NONE)
+                if (st == MIGA_VAR_STATUS_READ_ONLY)
                 {
-                    exec_set_error_printf(executor, "cannot assign variable (error %d)", err);
+                    exec_set_error_printf(executor, "%s: readonly variable",
+                                          string_cstr(tok->assignment_name));
+                    return (exec_frame_execute_result_t){.status = MIGA_EXEC_STATUS_ERROR};
+                }
+                if (st != MIGA_VAR_STATUS_OK)
+                {
+                    exec_set_error_printf(executor, "cannot assign variable (error %d)", st);
                     return (exec_frame_execute_result_t){.status = MIGA_EXEC_STATUS_ERROR};
                 }
             }
@@ -258,11 +242,10 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
         return (exec_frame_execute_result_t){.status = MIGA_EXEC_STATUS_OK};
     }
 
-    /* Swap in temporary variable store */
-    frame->saved_variables = frame->variables;
-    variable_store_t *temp_vars = build_temp_store_for_siple_command(frame, node);
-    frame->variables = temp_vars;
-    temp_vars = NULL;
+    /* Prefix assignments are written straight into the frame's store; the
+     * values they hide are put back when the command finishes. */
+    exec_var_saves_t prefix_saves = {0};
+    apply_prefix_assignments(frame, node, &prefix_saves);
 
     /* Convert AST redirections early */
     exec_redirections_t *runtime_redirs = NULL;
@@ -279,8 +262,12 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
         runtime_redirs = exec_redirections_create();
 
     /* Expand command words */
+    if (executor->profiler)
+        profiler_enter(executor->profiler, PROFILER_EXPAND, NULL);
     strlist_t *expanded_words =
         has_words ? expand_words(frame, word_tokens) : strlist_create();
+    if (executor->profiler)
+        profiler_leave(executor->profiler);
     if (has_words && !expanded_words)
     {
         status = MIGA_EXEC_STATUS_ERROR;
@@ -293,7 +280,11 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
     {
         const char *cmd_name = string_cstr(strlist_at(expanded_words, 0));
 
-        if (token_is_reserved_word(cmd_name))
+        miga_builtin_fn_t builtin_fn;
+        const ast_node_t *func_body;
+        command_class_t cmd_class = classify_command(frame, node, cmd_name, &builtin_fn, &func_body);
+
+        if (cmd_class == COMMAND_CLASS_RESERVED_WORD)
         {
             exec_set_error_printf(executor, "%s: syntax error - reserved word in command position",
                                   cmd_name);
@@ -301,36 +292,22 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
             goto done_execution;
         }
 
-        miga_builtin_category_t builtin_category;
-        miga_builtin_fn_t builtin_fn = NULL;
-        bool builtin_found = builtin_store_lookup(frame->executor->builtins, cmd_name, &builtin_fn,
-                                                  &builtin_category);
-
         /* Special builtins: persist assignments */
-        if (builtin_found && builtin_category == MIGA_BUILTIN_CATEGORY_SPECIAL && assign_tokens &&
-            token_list_size(assign_tokens) > 0)
-        {
-            miga_exec_status_t assign_st = apply_prefix_assignments(frame, frame->saved_variables, node);
-            if (assign_st != MIGA_EXEC_STATUS_OK)
-            {
-                status = assign_st;
-                goto done_execution;
-            }
-        }
+        if (cmd_class == COMMAND_CLASS_SPECIAL_BUILTIN)
+            keep_prefix_assignments(frame->variables, &prefix_saves);
+
+        /* Consecutive file tests may share cached stat() results, but any
+         * other command could change the file system underneath them. */
+        if (!builtin_fn || !builtin_is_file_test(builtin_fn))
+            stat_cache_clear(executor->stat_cache);
 
         /* ────────────────────────────────────────────────
            Internal commands (builtins + functions)
            ──────────────────────────────────────────────── */
-        // Even if we know we have a regular builtin, we have to check for a function of the same
-        // name first, because functions take precedence over regular builtins.
-        bool is_internal = false;
 
         /* Shell function */
-        const ast_node_t *func_body = func_store_get_def_cstr(frame->functions, cmd_name);
-        if (func_body != NULL)
+        if (cmd_class == COMMAND_CLASS_FUNCTION)
         {
-            is_internal = true;
-
             string_t *func_name_str = string_create_from_cstr(cmd_name);
             const exec_redirections_t *func_redirs =
                 func_store_get_redirections(frame->functions, func_name_str);
@@ -347,8 +324,12 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
                 goto done_execution;
             }
 
+            if (executor->profiler)
+                profiler_push_function(executor->profiler, cmd_name);
             exec_frame_execute_result_t func_result =
                 exec_frame_execute_function_body(frame, func_body, func_args, func_redirs);
+            if (executor->profiler)
+                profiler_pop_function(executor->profiler);
             cmd_exit_status = func_result.exit_status;
 
             strlist_destroy(&func_args);
@@ -358,10 +339,8 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
         }
 
         /* Regular builtin */
-        if (builtin_found && builtin_category == MIGA_BUILTIN_CATEGORY_REGULAR)
+        if (cmd_class == COMMAND_CLASS_REGULAR_BUILTIN)
         {
-            is_internal = true;
-
             miga_exec_status_t redir_st = exec_redirect_apply_redirectons(frame, runtime_redirs);
             if (redir_st != MIGA_EXEC_STATUS_OK)
             {
@@ -369,7 +348,11 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
                 goto done_execution;
             }
 
+            if (executor->profiler)
+                profiler_enter(executor->profiler, PROFILER_BUILTIN, cmd_name);
             cmd_exit_status = (*builtin_fn)(frame, expanded_words);
+            if (executor->profiler)
+                profiler_leave(executor->profiler);
 
             exec_redirect_restore_redirections(frame, runtime_redirs);
 
@@ -377,10 +360,8 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
         }
 
         /* Special builtins (non-assignment case) */
-        if (builtin_found && builtin_category == MIGA_BUILTIN_CATEGORY_SPECIAL)
+        if (cmd_class == COMMAND_CLASS_SPECIAL_BUILTIN)
         {
-            is_internal = true;
-
             miga_exec_status_t redir_st =
                 (miga_exec_status_t)exec_redirect_apply_redirectons(frame, runtime_redirs);
             if (redir_st != MIGA_EXEC_STATUS_OK)
@@ -389,7 +370,11 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
                 goto done_execution;
             }
 
+            if (executor->profiler)
+                profiler_enter(executor->profiler, PROFILER_BUILTIN, cmd_name);
             cmd_exit_status = (*builtin_fn)(frame, expanded_words);
+            if (executor->profiler)
+                profiler_leave(executor->profiler);
 
             exec_redirect_restore_redirections(frame, runtime_redirs);
 
@@ -420,7 +405,15 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
 
         char *const *envp = variable_store_get_envp(frame->variables);
 
+        fflush(NULL);
+        executor->stats.forks++;
+        executor->stats.execs++;
+        if (executor->profiler)
+            profiler_enter(executor->profiler, PROFILER_FORK, NULL);
         pid_t pid = fork();
+        if (pid != 0 && executor->profiler)
+            profiler_leave(executor->profiler);
+        trace_event(TRACE_EVENT_FORK, pid, 0);
         if (pid == -1)
         {
             exec_set_error_printf(executor, "fork failed: %s", strerror(errno));
@@ -435,15 +428,8 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
                 _exit(127);
             }
 
-            /* Close CLOEXEC FDs */
-            fd_table_t *fds = exec_frame_get_fds(frame);
-            size_t cloexec_count = 0;
-            int *cloexec_fds = fd_table_get_fds_with_flag(fds, FD_IS_CLOSE_ON_EXEC, &cloexec_count);
-            for (size_t j = 0; j < cloexec_count; j++)
-            {
-                close(cloexec_fds[j]);
-            }
-            xfree(cloexec_fds);
+            /* The saved FDs were made with F_DUPFD_CLOEXEC, so execvpe()
+             * closes them without any help here */
 
             /* Exec */
 #if defined(HAVE_EXECVPE)
@@ -504,7 +490,15 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
         else /* parent */
         {
             int wstatus = 0;
-            if (waitpid(pid, &wstatus, 0) < 0)
+            if (executor->profiler)
+                profiler_enter(executor->profiler, PROFILER_WAIT, NULL);
+            int wait_rc = exec_async_waitpid(executor, pid, &wstatus, 0);
+            if (executor->profiler)
+                profiler_leave(executor->profiler);
+            if (wait_rc > 0)
+                executor->stats.waits++;
+            trace_event(TRACE_EVENT_WAIT, pid, wstatus);
+            if (wait_rc < 0)
             {
                 cmd_exit_status = 127;
             }
@@ -563,6 +557,7 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
             {
                 log_debug("\targv%d: %s", i, argv[i]);
             }
+            executor->stats.execs++;
             spawn_result = _spawnvpe(_P_NOWAIT, cmd_name, (const char *const *)argv,
                                      (const char *const *)envp);
         }
@@ -586,8 +581,15 @@ exec_frame_execute_result_t exec_frame_execute_simple_command_impl(miga_frame_t
             {
                 log_debug("\targv%d: %s", i, argv[i]);
             }
+            /* A synchronous spawn is creation and waiting in one call */
+            executor->stats.execs++;
+            executor->stats.waits++;
+            if (executor->profiler)
+                profiler_enter(executor->profiler, PROFILER_WAIT, NULL);
             spawn_result =
                 _spawnvpe(_P_WAIT, cmd_name, (const char *const *)argv, (const char *const *)envp);
+            if (executor->profiler)
+                profiler_leave(executor->profiler);
             if (runtime_redirs && runtime_redirs->count > 0)
             {
                 exec_redirect_restore_redirections(frame, runtime_redirs);
@@ -698,10 +700,9 @@ out_destroy_redirs:
     exec_redirections_destroy(&runtime_redirs);
 
 out_restore_vars:
-    /* Restore original variable store */
-    variable_store_destroy(&frame->variables);
-    frame->variables = frame->saved_variables;
-    frame->saved_variables = NULL;
+    if (prefix_saves.count > 0)
+        exec_var_saves_restore(&prefix_saves, frame->variables);
+    exec_var_saves_clear(&prefix_saves);
 
     return (exec_frame_execute_result_t){.status = status};
 }
@@ -731,6 +732,8 @@ exec_frame_execute_result_t exec_frame_execute_function_body(miga_frame_t *frame
     Expects_not_null(func_body);
 
     exec_params_t params = {0};
+    params.stdin_pipe_fd = -1;
+    params.stdout_pipe_fd = -1;
     params.body = func_body;
     params.arguments = func_args;
     params.redirections = func_redirs;
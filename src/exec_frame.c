@@ -67,6 +67,7 @@
 #include "miga/strlist.h"
 #include "miga/string_t.h"
 #include "trap_store.h"
+#include "trace.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
 
@@ -188,7 +189,12 @@ static void init_variables(miga_frame_t *frame, miga_exec_t *exec)
     switch (policy->variables.scope)
     {
     case EXEC_SCOPE_OWN:
-        if (policy->variables.init_from_envp)
+        if (!frame->parent && exec->variables)
+        {
+            /* Pre-populated top-frame store, adopted by exec_frame_create_top_level() */
+            frame->variables = NULL;
+        }
+        else if (policy->variables.init_from_envp)
         {
             frame->variables = variable_store_create_from_envp(exec->envp);
         }
@@ -196,6 +202,8 @@ static void init_variables(miga_frame_t *frame, miga_exec_t *exec)
         {
             frame->variables = variable_store_create();
         }
+        if (frame->variables)
+            variable_store_set_counters(frame->variables, &exec->var_counters);
         break;
     case EXEC_SCOPE_COPY:
         Expects_not_null(frame->parent);
@@ -216,15 +224,23 @@ static void init_variables(miga_frame_t *frame, miga_exec_t *exec)
         Expects(false && "Invalid variable scope");
     }
 
-    /* Local variable store for functions */
-    if (policy->variables.has_locals)
-    {
-        frame->local_variables = variable_store_create();
-    }
-    else
+    /* Locals are recorded in frame->local_saves on first use */
+}
+
+/* True if a call's arguments are the caller's $1, $2, ... unchanged */
+static bool arguments_match_positional_params(const positional_params_t *params,
+                                              const strlist_t *arguments)
+{
+    int count = 0;
+    const string_t *const *view = positional_params_view(params, &count);
+    if (count != strlist_size(arguments))
+        return false;
+    for (int i = 0; i < count; i++)
     {
-        frame->local_variables = NULL;
+        if (!string_eq(view[i], strlist_at(arguments, i)))
+            return false;
     }
+    return true;
 }
 
 static void init_positional_params(miga_frame_t *frame, miga_exec_t *exec, exec_params_t *params)
@@ -242,7 +258,16 @@ static void init_positional_params(miga_frame_t *frame, miga_exec_t *exec, exec_
                 string_cstr(exec->shell_name), exec->argc, (const char **)exec->argv);
             break;
         case EXEC_POSITIONAL_INIT_CALL_ARGS:
-            if (params && params->arguments)
+            if (params && params->arguments && frame->parent->positional_params &&
+                arguments_match_positional_params(frame->parent->positional_params,
+                                                  params->arguments))
+            {
+                /* Borrowed until someone modifies them, see
+                 * exec_frame_unshare_positional_params() */
+                frame->positional_params = frame->parent->positional_params;
+                frame->positional_params_borrowed = true;
+            }
+            else if (params && params->arguments)
             {
                 frame->positional_params = positional_params_create_from_strlist(
                     /* $0 inherited from parent */
@@ -294,6 +319,7 @@ static void init_positional_params(miga_frame_t *frame, miga_exec_t *exec, exec_
     case EXEC_ARG0_SET_TO_SOURCED_SCRIPT:
         if (params && params->script_path)
         {
+            exec_frame_unshare_positional_params(frame);
             positional_params_set_arg0(frame->positional_params, params->script_path);
         }
         break;
@@ -331,7 +357,12 @@ static void init_cwd(miga_frame_t *frame)
     switch (policy->cwd.scope)
     {
     case EXEC_SCOPE_OWN:
-        if (policy->cwd.init_from_system)
+        if (!frame->parent && frame->executor->working_directory)
+        {
+            /* Adopted by exec_frame_create_top_level() */
+            frame->working_directory = NULL;
+        }
+        else if (policy->cwd.init_from_system)
         {
             frame->working_directory = lib_getcwd();
         }
@@ -421,6 +452,8 @@ miga_frame_t *exec_frame_push(miga_frame_t *parent, exec_frame_type_t type, miga
     frame->policy = &EXEC_FRAME_POLICIES[type];
     frame->parent = parent;
     frame->executor = exec;
+    exec->stats.frame_pushes++;
+    trace_event(TRACE_EVENT_FRAME_PUSH, type, parent ? parent->loop_depth : 0);
 
     /* Initialize all scope-dependent storage */
     init_variables(frame, exec);
@@ -581,18 +614,18 @@ static void cleanup_frame_resources(miga_frame_t *frame)
 {
     const exec_frame_policy_t *policy = frame->policy;
 
-    /* Variables */
+    /* Variables, after putting back the values hidden by 'local' */
+    if (frame->local_saves.count > 0)
+        exec_var_saves_restore(&frame->local_saves, frame->variables);
+    exec_var_saves_clear(&frame->local_saves);
     if (policy->variables.scope != EXEC_SCOPE_SHARE && frame->variables)
     {
         variable_store_destroy(&frame->variables);
     }
-    if (frame->local_variables)
-    {
-        variable_store_destroy(&frame->local_variables);
-    }
 
     /* Positional params */
-    if (policy->positional.scope != EXEC_SCOPE_SHARE && frame->positional_params)
+    if (policy->positional.scope != EXEC_SCOPE_SHARE && frame->positional_params &&
+        !frame->positional_params_borrowed)
     {
         positional_params_destroy(&frame->positional_params);
     }
@@ -685,6 +718,7 @@ miga_frame_t *exec_frame_pop(miga_frame_t **frame_ptr)
     Expects_not_null(frame_ptr);
     miga_frame_t *frame = *frame_ptr;
     Expects_not_null(frame);
+    trace_event(TRACE_EVENT_FRAME_POP, frame->type, frame->last_exit_status);
 
     miga_frame_t *parent = frame->parent;
     if (parent)
@@ -911,20 +945,21 @@ static exec_frame_execute_result_t execute_frame_body(miga_frame_t *frame, exec_
     }
 #endif
 
-    /* Execute body based on what's provided */
-    if (params->body)
+    /* Execute body based on what's provided. Loops carry a body as well,
+     * so they must be recognized before the plain body case. */
+    if (params->iteration_words)
     {
-        result = exec_frame_execute_dispatch(frame, params->body);
+        /* For loop */
+        result = exec_frame_execute_iteration_loop(frame, params);
     }
     else if (params->condition)
     {
         /* While/until loop */
         result = exec_frame_execute_condition_loop(frame, params);
     }
-    else if (params->iteration_words)
+    else if (params->body)
     {
-        /* For loop */
-        result = exec_frame_execute_iteration_loop(frame, params);
+        result = exec_frame_execute_dispatch(frame, params->body);
     }
     else if (params->pipeline_commands)
     {
@@ -997,11 +1032,8 @@ static exec_frame_execute_result_t exec_frame_execute_condition_loop(miga_frame_
         }
 
         // Execute body
-        exec_frame_execute_result_t body_result;
-        if (params->body->type == AST_COMMAND_LIST)
-            body_result = exec_frame_execute_iteration_loop(frame, params);
-        else
-            body_result = exec_frame_execute_dispatch(frame, params->body);
+        exec_frame_execute_result_t body_result =
+            exec_frame_execute_dispatch(frame, params->body);
 
         // Handle control flow
         if (body_result.flow == MIGA_FRAME_FLOW_BREAK)
@@ -1055,6 +1087,8 @@ static exec_frame_execute_result_t exec_frame_execute_condition_loop(miga_frame_
                                  strlist_t *command_args)
  {
      exec_params_t params = {
+         .stdin_pipe_fd = -1,
+         .stdout_pipe_fd = -1,
          .body = body,
          .command_args = command_args,
      };
@@ -1065,6 +1099,8 @@ static exec_frame_execute_result_t exec_frame_execute_condition_loop(miga_frame_
  exec_frame_execute_result_t exec_frame_execute_subshell(miga_frame_t *parent, ast_node_t *body)
  {
      exec_params_t params = {
+         .stdin_pipe_fd = -1,
+         .stdout_pipe_fd = -1,
          .body = body,
      };
      return exec_in_frame(parent, EXEC_FRAME_SUBSHELL, &params);
@@ -1074,6 +1110,8 @@ exec_frame_execute_result_t exec_frame_execute_brace_group(miga_frame_t *parent,
                                                             exec_redirections_t *redirs)
 {
     exec_params_t params = {
+        .stdin_pipe_fd = -1,
+        .stdout_pipe_fd = -1,
         .body = node,
         .redirections = redirs,
     };
@@ -1085,6 +1123,8 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_group(miga_frame_t *pare
                                                               bool is_negated)
 {
      exec_params_t params = {
+        .stdin_pipe_fd = -1,
+        .stdout_pipe_fd = -1,
         .pipeline_commands = pipeline_commands,
          .pipeline_negated = is_negated,
      };
@@ -1095,6 +1135,8 @@ exec_frame_execute_result_t exec_frame_execute_for_loop(miga_frame_t *frame, str
                                                         strlist_t *words, ast_node_t *body)
 {
     exec_params_t params = {
+        .stdin_pipe_fd = -1,
+        .stdout_pipe_fd = -1,
         .iteration_words = words,
         .loop_var_name = var_name,
         .body = body,
@@ -1212,8 +1254,20 @@ exec_frame_execute_result_t exec_in_frame(miga_frame_t *parent, exec_frame_type_
     /* Handle forking if required */
     if (policy->process.forks)
     {
+        /* Respect the background job pool limit before starting another job */
+        if (policy->classification.is_background)
+            exec_wait_for_job_slot(exec);
+
 #ifdef MIGA_POSIX_API
+        /* Don't let the child inherit (and later re-emit) buffered output */
+        fflush(NULL);
+        exec->stats.forks++;
+        if (exec->profiler)
+            profiler_enter(exec->profiler, PROFILER_FORK, NULL);
         pid_t pid = fork();
+        if (pid != 0 && exec->profiler)
+            profiler_leave(exec->profiler);
+        trace_event(TRACE_EVENT_FORK, pid, 0);
         if (pid < 0)
         {
             /* Fork failed */
@@ -1243,7 +1297,14 @@ exec_frame_execute_result_t exec_in_frame(miga_frame_t *parent, exec_frame_type_
             {
                 /* Foreground: wait for child */
                 int status;
-                waitpid(pid, &status, 0);
+                if (exec->profiler)
+                    profiler_enter(exec->profiler, PROFILER_WAIT, NULL);
+                exec_async_waitpid(exec, pid, &status, 0);
+                exec->stats.waits++;
+                trace_event(TRACE_EVENT_WAIT, pid, status);
+                if (exec->profiler)
+                    profiler_leave(exec->profiler);
+                stat_cache_clear(exec->stat_cache);
                 int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
                 return (exec_frame_execute_result_t){.exit_status = exit_status,
                                                      .has_exit_status = true,
@@ -1293,6 +1354,8 @@ exec_frame_execute_result_t exec_in_frame(miga_frame_t *parent, exec_frame_type_
     if (policy->exit.terminates_process)
     {
 #ifdef MIGA_POSIX_API
+        /* _exit() skips stdio cleanup; don't lose builtin output */
+        fflush(NULL);
         _exit(result.exit_status);
 #else
         /* For ISO C mode, just return */
@@ -1365,21 +1428,118 @@ const string_t *exec_frame_get_variable(const miga_frame_t *frame, const string_
     Expects_not_null(name);
     Expects_gt(name->length, 0);
 
-    /* Check local store first if present */
-    if (frame->local_variables)
-    {
-        const string_t *local_value = variable_store_get_value(frame->local_variables, name);
-        if (local_value)
-            return local_value;
-    }
-
-    /* Fall back to global store */
     if (frame->variables)
+        return variable_store_get_value(frame->variables, name);
+
+    return NULL;
+}
+
+/* ============================================================================
+ * Dynamic Parameters
+ *
+ * $?, $$, $!, $-, $_ and LINENO change with nearly every command, so rather
+ * than formatting them into the variable store ahead of time they are
+ * computed from frame and executor state when something reads them.
+ *
+ * $_ and LINENO are ordinary names the user may assign or export; once the
+ * store holds a value for one, that value is used instead, until it is
+ * unset.
+ * ============================================================================ */
+
+typedef string_t *(*dynamic_param_getter_t)(const miga_frame_t *frame);
+
+static string_t *dynamic_param_exit_status(const miga_frame_t *frame)
+{
+    return string_from_int(frame->last_exit_status);
+}
+
+static string_t *dynamic_param_shell_pid(const miga_frame_t *frame)
+{
+    if (!frame->executor->shell_pid_valid)
+        return NULL;
+    return string_from_int(frame->executor->shell_pid);
+}
+
+static string_t *dynamic_param_bg_pid(const miga_frame_t *frame)
+{
+    if (frame->last_bg_pid <= 0)
+        return NULL;
+    return string_from_int(frame->last_bg_pid);
+}
+
+static string_t *dynamic_param_last_argument(const miga_frame_t *frame)
+{
+    if (!frame->executor->last_argument_set)
+        return NULL;
+    return string_create_from(frame->executor->last_argument);
+}
+
+static string_t *dynamic_param_opt_flags(const miga_frame_t *frame)
+{
+    char flags[16];
+    int idx = 0;
+    const exec_opt_flags_t *opt = frame->opt_flags;
+
+    if (opt)
+    {
+        if (opt->allexport)
+            flags[idx++] = 'a';
+        if (opt->errexit)
+            flags[idx++] = 'e';
+        if (opt->noclobber)
+            flags[idx++] = 'C';
+        if (opt->noglob)
+            flags[idx++] = 'f';
+        if (opt->noexec)
+            flags[idx++] = 'n';
+        if (opt->nounset)
+            flags[idx++] = 'u';
+        if (opt->verbose)
+            flags[idx++] = 'v';
+        if (opt->xtrace)
+            flags[idx++] = 'x';
+    }
+    if (frame->executor->is_interactive)
+        flags[idx++] = 'i';
+    flags[idx] = '\0';
+    return string_create_from_cstr(flags);
+}
+
+static string_t *dynamic_param_lineno(const miga_frame_t *frame)
+{
+    /* A frame that has not run a node yet reports its parent's line */
+    while (frame && frame->source_line <= 0)
+        frame = frame->parent;
+    if (!frame)
+        return NULL;
+    return string_from_int(frame->source_line);
+}
+
+static const struct
+{
+    const char *name;
+    dynamic_param_getter_t get;
+    bool assignable; // A value in the variable store takes precedence
+} dynamic_params[] = {
+    {"?", dynamic_param_exit_status, false},  {"$", dynamic_param_shell_pid, false},
+    {"!", dynamic_param_bg_pid, false},       {"-", dynamic_param_opt_flags, false},
+    {"_", dynamic_param_last_argument, true}, {"LINENO", dynamic_param_lineno, true},
+};
+
+string_t *exec_frame_get_dynamic_param(const miga_frame_t *frame, const string_t *name)
+{
+    Expects_not_null(frame);
+    Expects_not_null(name);
+
+    const char *n = string_cstr(name);
+    for (size_t i = 0; i < sizeof(dynamic_params) / sizeof(dynamic_params[0]); i++)
     {
-        const string_t *global_value = variable_store_get_value(frame->variables, name);
-        return global_value;
+        if (dynamic_params[i].name[0] != n[0] || strcmp(dynamic_params[i].name, n) != 0)
+            continue;
+        if (dynamic_params[i].assignable && exec_frame_get_variable(frame, name))
+            return NULL;
+        return dynamic_params[i].get(frame);
     }
-
     return NULL;
 }
 
@@ -1388,43 +1548,160 @@ void exec_frame_set_variable(miga_frame_t *frame, const string_t *name, const st
     if (!frame || !name || !value)
         return;
 
-    /* Set in local store if present, otherwise in global store */
-    if (frame->local_variables)
-    {
-        variable_store_add(frame->local_variables, name, value, false, false);
-    }
-    else if (frame->variables)
-    {
+    if (frame->variables)
         variable_store_add(frame->variables, name, value, false, false);
-    }
 }
 
 int exec_frame_declare_local(miga_frame_t *frame, const string_t *name, const string_t *value)
 {
-    if (!frame || !name || !value)
+    if (!frame || !name)
         return -1;
 
-    if (!frame->local_variables)
+    miga_frame_t *function = frame;
+    while (function && !function->policy->variables.has_locals)
+        function = function->parent;
+    if (!function || !frame->variables)
         return -1;
 
-    var_store_error_t result =
-        variable_store_add(frame->local_variables, name, value, false, false);
+    variable_view_t view;
+    bool exists = variable_store_get_variable(frame->variables, name, &view);
+    if (exists && view.read_only)
+        return -1;
+
+    /* In a subshell of the function the store is a copy that is thrown
+     * away anyway; only the function's own store needs restoring. */
+    if (function->variables == frame->variables)
+        exec_var_saves_record(&function->local_saves, frame->variables, name);
+
+    /* Without a value the variable keeps whatever it had, set or not */
+    if (!value)
+        return 0;
+
+    bool exported = exists && view.exported;
+    var_store_error_t result = variable_store_add(frame->variables, name, value, exported, false);
     return (result == VAR_STORE_ERROR_NONE) ? 0 : -1;
 }
 
+/* ============================================================================
+ * Variable Save Lists
+ * ============================================================================ */
+
+void exec_var_saves_record(exec_var_saves_t *saves, const variable_store_t *store,
+                           const string_t *name)
+{
+    Expects_not_null(saves);
+    Expects_not_null(store);
+    Expects_not_null(name);
+
+    for (int i = 0; i < saves->count; i++)
+    {
+        if (string_eq(saves->items[i].name, name))
+            return;
+    }
+
+    if (saves->count == saves->capacity)
+    {
+        int capacity = saves->capacity ? saves->capacity * 2 : 4;
+        saves->items = xrealloc(saves->items, (size_t)capacity * sizeof(exec_var_save_t));
+        saves->capacity = capacity;
+    }
+
+    exec_var_save_t *save = &saves->items[saves->count++];
+    variable_view_t view;
+    save->name = string_create_from(name);
+    if (variable_store_get_variable(store, name, &view))
+    {
+        save->value = view.value ? string_create_from(view.value) : string_create();
+        save->exported = view.exported;
+        save->read_only = view.read_only;
+    }
+    else
+    {
+        save->value = NULL;
+        save->exported = false;
+        save->read_only = false;
+    }
+}
+
+void exec_var_saves_restore(exec_var_saves_t *saves, variable_store_t *store)
+{
+    Expects_not_null(saves);
+    Expects_not_null(store);
+
+    for (int i = saves->count - 1; i >= 0; i--)
+    {
+        exec_var_save_t *save = &saves->items[i];
+        variable_store_remove(store, save->name);
+        if (save->value)
+            variable_store_add(store, save->name, save->value, save->exported, save->read_only);
+        string_destroy(&save->name);
+        if (save->value)
+            string_destroy(&save->value);
+    }
+    saves->count = 0;
+}
+
+void exec_var_saves_clear(exec_var_saves_t *saves)
+{
+    Expects_not_null(saves);
+
+    for (int i = 0; i < saves->count; i++)
+    {
+        string_destroy(&saves->items[i].name);
+        if (saves->items[i].value)
+            string_destroy(&saves->items[i].value);
+    }
+    xfree(saves->items);
+    saves->items = NULL;
+    saves->count = 0;
+    saves->capacity = 0;
+}
+
+/* ============================================================================
+ * Positional Parameter Sharing
+ * ============================================================================ */
+
+void exec_frame_unshare_positional_params(miga_frame_t *frame)
+{
+    Expects_not_null(frame);
+
+    positional_params_t *shared = frame->positional_params;
+    if (!shared)
+        return;
+
+    /* Find the function that borrowed these parameters; frames in between
+     * share them through EXEC_SCOPE_SHARE. */
+    miga_frame_t *owner = frame;
+    while (owner && owner->positional_params == shared && !owner->positional_params_borrowed)
+        owner = owner->parent;
+    if (!owner || owner->positional_params != shared)
+        return;
+
+    positional_params_t *copy = positional_params_clone(shared);
+    for (miga_frame_t *f = frame; f; f = f->parent)
+    {
+        if (f->positional_params == shared)
+            f->positional_params = copy;
+        if (f == owner)
+            break;
+    }
+    owner->positional_params_borrowed = false;
+}
+
 /* ============================================================================
  * Frame-level execution operations
  * ============================================================================ */
 
 /**
- * Update the LINENO variable in the frame's variable store.
+ * Record the source line of the node about to execute.
  *
  * POSIX says LINENO is set by the shell "to a decimal number representing the
  * current sequential line number (numbered starting with 1) within a script or
  * function before it executes each command."
  *
- * LINENO is a regular variable — the user can unset or reset it. If they do,
- * it will be recreated or updated again when the next command executes.
+ * Only the frame's line tracker is updated here. $LINENO itself is a dynamic
+ * parameter computed from it on read (see exec_frame_get_dynamic_param), so
+ * the variable store is not touched on every node.
  *
  * We only update when we have a valid source line (> 0) from the AST, and
  * only when executing within a script or function context.
@@ -1441,19 +1718,16 @@ static void exec_frame_update_lineno(miga_frame_t *frame, const ast_node_t *node
     /* Update the frame's internal line tracker */
     frame->source_line = node->first_line;
 
-    /* Write LINENO into the variable store as a regular variable */
-    variable_store_t *vars = exec_frame_get_variables(frame);
-    if (!vars)
-        return;
-
-    if (variable_store_has_name_cstr(vars, "LINENO") &&
-        variable_store_is_read_only_cstr(vars, "LINENO"))
-        /* You can't make LINENO readonly, permanently. Muhuhuwahaha! */
-        variable_store_set_read_only_cstr(vars, "LINENO", false);
-
-    char buf[24];
-    snprintf(buf, sizeof(buf), "%d", node->first_line);
-    variable_store_add_cstr(vars, "LINENO", buf, false, false);
+    if (frame->executor->profiler)
+    {
+        /* Function frames have no source name of their own; use the
+         * nearest enclosing frame that does. */
+        const miga_frame_t *named = frame;
+        while (named && (!named->source_name || string_empty(named->source_name)))
+            named = named->parent;
+        profiler_set_line(frame->executor->profiler,
+                          named ? string_cstr(named->source_name) : NULL, node->first_line);
+    }
 }
 
 exec_frame_execute_result_t exec_frame_execute_dispatch(miga_frame_t *frame, const ast_node_t *node)
@@ -1567,6 +1841,11 @@ exec_frame_execute_result_t exec_frame_execute_compound_list(miga_frame_t *frame
         /* Update LINENO before executing this command */
         exec_frame_update_lineno(frame, cmd);
 
+        /* Cached file tests only hold within one and-or list; anything
+         * else (another process, a loop iteration) may have changed the
+         * file system since. */
+        stat_cache_clear(frame->executor->stat_cache);
+
         exec_frame_execute_result_t cmd_result;
         cmd_separator_t sep = cmd_separator_list_get(separators, i);
         if (sep == CMD_EXEC_BACKGROUND)
@@ -1816,6 +2095,15 @@ exec_frame_execute_result_t exec_frame_execute_simple_command(miga_frame_t *fram
      * its own module, lol. Simple, my butt. */
     exec_frame_execute_result_t result = exec_frame_execute_simple_command_impl(frame, node);
 
+    /* The impl records the command's status on the frame rather than in
+     * the result; surface it so subshells and background jobs that
+     * _exit() with result.exit_status report the right value. */
+    if (result.status == MIGA_EXEC_STATUS_OK && !result.has_exit_status)
+    {
+        result.exit_status = frame->last_exit_status;
+        result.has_exit_status = true;
+    }
+
     /* Pick up any pending control flow that a builtin set on the frame
      * (return, break, continue).  The simple-command impl doesn't set
      * these in the result struct itself. */
@@ -2274,26 +2562,6 @@ exec_frame_execute_result_t exec_frame_execute_iteration_loop(miga_frame_t *fram
     return result;
 }
 
-/* ============================================================================
- * Helper: EINTR-safe waitpid
- * ============================================================================ */
-
-#ifdef MIGA_POSIX_API
-/**
- * waitpid wrapper that retries on EINTR.
- * Returns the pid on success, -1 on real error (with errno set).
- */
-static pid_t waitpid_eintr(pid_t pid, int *status, int options)
-{
-    pid_t ret;
-    do
-    {
-        ret = waitpid(pid, status, options);
-    } while (ret == -1 && errno == EINTR);
-    return ret;
-}
-#endif
-
 /* ============================================================================
  * Pipeline Orchestration
  * ============================================================================ */
@@ -2378,6 +2646,8 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
             result.exit_status = 1;
             goto cleanup;
         }
+        frame->executor->stats.pipes++;
+        trace_event(TRACE_EVENT_PIPE, pipes[2 * i], pipes[2 * i + 1]);
     }
 
     /* Initialize all PIDs to -1 so cleanup knows which children were forked */
@@ -2393,7 +2663,14 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
     {
         ast_node_t *cmd = commands->nodes[i];
 
+        fflush(NULL);
+        frame->executor->stats.forks++;
+        if (frame->executor->profiler)
+            profiler_enter(frame->executor->profiler, PROFILER_FORK, NULL);
         pid_t pid = fork();
+        if (pid != 0 && frame->executor->profiler)
+            profiler_leave(frame->executor->profiler);
+        trace_event(TRACE_EVENT_FORK, pid, 0);
         if (pid == -1)
         {
             exec_set_error_printf(frame->executor, "fork() failed in pipeline: %s", strerror(errno));
@@ -2406,7 +2683,7 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
             for (int j = 0; j < i; j++)
             {
                 int discard;
-                waitpid_eintr(pids[j], &discard, 0);
+                exec_async_waitpid(frame->executor, pids[j], &discard, 0);
             }
 
             result.status = MIGA_EXEC_STATUS_ERROR;
@@ -2442,11 +2719,16 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
                 dup2(pipes[2 * i + 1], STDOUT_FILENO);
             }
 
-            /* Close all pipe FDs in the child */
-            for (int j = 0; j < 2 * num_pipes; j++)
-            {
-                close(pipes[j]);
-            }
+            /* Close all pipe FDs in the child. The pipes were made one after
+             * another, so their FDs are mostly consecutive and this is
+             * usually a single close_range(). The parent's copy of the array
+             * is untouched by the sort. */
+            fd_table_close_fds(pipes, 2 * num_pipes);
+
+            /* This child runs shell code rather than exec'ing, so the kernel
+             * never closes the saved CLOEXEC FDs for it. Holding on to a copy
+             * of a pipe's write end would keep its reader from seeing EOF. */
+            fd_table_close_with_flag(exec_frame_get_fds(frame), FD_IS_CLOSE_ON_EXEC);
 
             /* Execute the command */
             exec_frame_execute_result_t cmd_result = exec_frame_execute_dispatch(frame, cmd);
@@ -2513,10 +2795,12 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
 
     /* Wait for all children (collect every status for future pipefail support) */
     int last_status = 0;
+    if (frame->executor->profiler)
+        profiler_enter(frame->executor->profiler, PROFILER_WAIT, NULL);
     for (int i = 0; i < ncmds; i++)
     {
         int status;
-        pid_t waited = waitpid_eintr(pids[i], &status, 0);
+        pid_t waited = exec_async_waitpid(frame->executor, pids[i], &status, 0);
         if (waited < 0)
         {
             /*
@@ -2535,6 +2819,8 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
             }
             continue;
         }
+        frame->executor->stats.waits++;
+        trace_event(TRACE_EVENT_WAIT, pids[i], status);
 
         int child_status;
         if (WIFEXITED(status))
@@ -2560,9 +2846,12 @@ exec_frame_execute_result_t exec_frame_execute_pipeline_orchestrate(miga_frame_t
             last_status = child_status;
         }
     }
+    if (frame->executor->profiler)
+        profiler_leave(frame->executor->profiler);
 
     result.exit_status = is_negated ? (last_status == 0 ? 1 : 0) : last_status;
     frame->last_exit_status = result.exit_status;
+    stat_cache_clear(frame->executor->stat_cache);
 
 cleanup:
     /* Free heap-allocated arrays */
@@ -2709,6 +2998,9 @@ exec_frame_execute_result_t exec_frame_execute_case_clause(miga_frame_t *frame,
  * @param session The parse session (maintains lexer, tokenizer, and accumulated tokens)
  * @return Status indicating success, need for more input, or error
  */
+static miga_exec_status_t exec_frame_string_core_impl(miga_frame_t *frame, const char *input,
+                                                      parse_session_t *session);
+
 miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input,
                                      parse_session_t *session)
 {
@@ -2719,14 +3011,39 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
     Expects_not_null(session->tokenizer);
     Expects_not_null(frame->executor);
 
-    miga_exec_t *executor = frame->executor;
+    /* Everything not charged to execution, here or in nested calls made
+     * by eval, ., and the like, is parse time. */
+    miga_exec_stats_t *stats = &frame->executor->stats;
+    uint64_t parse_before = stats->parse_ns;
+    uint64_t exec_before = stats->exec_ns;
+    uint64_t start = profiler_wall_clock_ns();
+
+    miga_exec_status_t status = exec_frame_string_core_impl(frame, input, session);
+
+    uint64_t elapsed = profiler_wall_clock_ns() - start;
+    uint64_t charged = (stats->parse_ns - parse_before) + (stats->exec_ns - exec_before);
+    if (elapsed > charged)
+        stats->parse_ns += elapsed - charged;
+    return status;
+}
+
+miga_exec_status_t exec_parse_core(miga_exec_t *executor, const char *input,
+                                   parse_session_t *session, ast_node_t **out_ast)
+{
+    Expects_not_null(executor);
+    Expects_not_null(input);
+    Expects_not_null(session);
+    Expects_not_null(out_ast);
+
+    *out_ast = NULL;
     lexer_t *lx = session->lexer;
     tokenizer_t *tokenizer = session->tokenizer;
 
     session->line_num++;
-    log_debug("exec_frame_string_core: Processing line %d: %.*s", session->line_num,
+    log_debug("exec_parse_core: Processing line %d: %.*s", session->line_num,
               (int)strcspn(input, "\r\n"), input);
 
+    lexer_set_start_line(lx, session->line_num);
     lexer_append_input_cstr(lx, input);
 
     token_list_t *raw_tokens = token_list_create();
@@ -2734,22 +3051,22 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
     if (lex_status == LEX_ERROR)
     {
-        log_debug("exec_frame_string_core: Lexer error at line %d", session->line_num);
+        log_debug("exec_parse_core: Lexer error at line %d", session->line_num);
         const char *err = lexer_get_error(lx);
-        frame_set_error_printf(frame, "Lexer error: %s", err ? err : "unknown");
+        exec_set_error_printf(executor, "Lexer error: %s", err ? err : "unknown");
         token_list_destroy(&raw_tokens);
         return MIGA_EXEC_STATUS_ERROR;
     }
 
     if (lex_status == LEX_INCOMPLETE || lex_status == LEX_NEED_HEREDOC)
     {
-        log_debug("exec_frame_string_core: Lexer incomplete/heredoc at line %d", session->line_num);
+        log_debug("exec_parse_core: Lexer incomplete/heredoc at line %d", session->line_num);
 
         /* Check if any tokens were produced before the incomplete state.
          * If so, we should accumulate them for parsing when more input arrives. */
         if (token_list_size(raw_tokens) > 0)
         {
-            log_debug("exec_frame_string_core: Lexer produced %d tokens before becoming incomplete",
+            log_debug("exec_parse_core: Lexer produced %d tokens before becoming incomplete",
                       token_list_size(raw_tokens));
 
             /* Process the tokens that were produced */
@@ -2759,17 +3076,17 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
             if (tok_status == TOK_ERROR)
             {
-                log_debug("exec_frame_string_core: Tokenizer error on incomplete line %d",
+                log_debug("exec_parse_core: Tokenizer error on incomplete line %d",
                           session->line_num);
                 const char *err = tokenizer_get_error(tokenizer);
-                frame_set_error_printf(frame, "Tokenizer error: %s", err ? err : "unknown");
+                exec_set_error_printf(executor, "Tokenizer error: %s", err ? err : "unknown");
                 token_list_destroy(&processed_tokens);
                 return MIGA_EXEC_STATUS_ERROR;
             }
 
             if (tok_status == TOK_INCOMPLETE)
             {
-                log_debug("exec_frame_string_core: Tokenizer incomplete (compound command) during lexer "
+                log_debug("exec_parse_core: Tokenizer incomplete (compound command) during lexer "
                           "incomplete at line %d",
                           session->line_num);
                 /* Tokens are buffered in tokenizer, continue to next line */
@@ -2787,7 +3104,7 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
                 if (token_list_append_list_move(session->accumulated_tokens, &processed_tokens) !=
                     0)
                 {
-                    log_debug("exec_frame_string_core: Failed to append incomplete tokens");
+                    log_debug("exec_parse_core: Failed to append incomplete tokens");
                     return MIGA_EXEC_STATUS_ERROR;
                 }
             }
@@ -2799,7 +3116,7 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
         return MIGA_EXEC_STATUS_INCOMPLETE;
     }
 
-    log_debug("exec_frame_string_core: Lexer produced %d raw tokens at line %d",
+    log_debug("exec_parse_core: Lexer produced %d raw tokens at line %d",
               token_list_size(raw_tokens), session->line_num);
 
     token_list_t *processed_tokens = token_list_create();
@@ -2808,9 +3125,9 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
     if (tok_status == TOK_ERROR)
     {
-        log_debug("exec_frame_string_core: Tokenizer error at line %d", session->line_num);
+        log_debug("exec_parse_core: Tokenizer error at line %d", session->line_num);
         const char *err = tokenizer_get_error(tokenizer);
-        frame_set_error_printf(frame, "Tokenizer error: %s", err ? err : "unknown");
+        exec_set_error_printf(executor, "Tokenizer error: %s", err ? err : "unknown");
         token_list_destroy(&processed_tokens);
         return MIGA_EXEC_STATUS_ERROR;
     }
@@ -2818,7 +3135,7 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
     if (tok_status == TOK_INCOMPLETE)
     {
         log_debug(
-            "exec_frame_string_core: Tokenizer incomplete (compound command) at line %d, tokens buffered",
+            "exec_parse_core: Tokenizer incomplete (compound command) at line %d, tokens buffered",
             session->line_num);
         /* Tokenizer is buffering tokens for an incomplete compound command.
          * The processed_tokens list will be empty - tokens are held in the tokenizer's buffer.
@@ -2829,7 +3146,7 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
     if (token_list_size(processed_tokens) == 0)
     {
-        log_debug("exec_frame_string_core: No tokens after processing at line %d", session->line_num);
+        log_debug("exec_parse_core: No tokens after processing at line %d", session->line_num);
         token_list_destroy(&processed_tokens);
         return MIGA_EXEC_STATUS_EMPTY;
     }
@@ -2837,13 +3154,13 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
     /* Accumulate tokens if we had an incomplete parse previously */
     if (session->accumulated_tokens)
     {
-        log_debug("exec_frame_string_core: Appending %d new tokens to %d accumulated tokens",
+        log_debug("exec_parse_core: Appending %d new tokens to %d accumulated tokens",
                   token_list_size(processed_tokens), token_list_size(session->accumulated_tokens));
 
         /* Move all tokens from processed_tokens to accumulated_tokens */
         if (token_list_append_list_move(session->accumulated_tokens, &processed_tokens) != 0)
         {
-            log_debug("exec_frame_string_core: Failed to append tokens");
+            log_debug("exec_parse_core: Failed to append tokens");
             return MIGA_EXEC_STATUS_ERROR;
         }
 
@@ -2852,30 +3169,34 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
         session->accumulated_tokens = NULL;
     }
 
-    log_debug("exec_frame_string_core: Tokenizer produced %d processed tokens at line %d",
+    log_debug("exec_parse_core: Tokenizer produced %d processed tokens at line %d",
               token_list_size(processed_tokens), session->line_num);
 
     /* Debug: print all tokens */
-    for (int i = 0; i < token_list_size(processed_tokens); i++)
+    if (log_level_enabled(LOG_LEVEL_DEBUG))
     {
-        const token_t *t = token_list_get(processed_tokens, i);
-        log_debug("  Token %d: type=%d, text='%s'", i, token_get_type(t),
-                  string_cstr(token_to_string(t)));
+        for (int i = 0; i < token_list_size(processed_tokens); i++)
+        {
+            const token_t *t = token_list_get(processed_tokens, i);
+            log_debug("  Token %d: type=%d, text='%s'", i, token_get_type(t),
+                      string_cstr(token_to_string(t)));
+        }
     }
 
     parser_t *parser = parser_create_with_tokens_move(&processed_tokens);
     gnode_t *gnode = NULL;
 
-    log_debug("exec_frame_string_core: Starting parse at line %d", session->line_num);
+    log_debug("exec_parse_core: Starting parse at line %d", session->line_num);
     parse_status_t parse_status = parser_parse_program(parser, &gnode);
+    trace_event(TRACE_EVENT_PARSE, session->line_num, parse_status);
 
     if (parse_status == PARSE_ERROR)
     {
-        log_debug("exec_frame_string_core: Parse error at line %d", session->line_num);
+        log_debug("exec_parse_core: Parse error at line %d", session->line_num);
         const char *err = parser_get_error(parser);
         if (err && err[0])
         {
-            frame_set_error_printf(frame, "Parse error at line %d: %s", session->line_num, err);
+            exec_set_error_printf(executor, "Parse error at line %d: %s", session->line_num, err);
         }
         else
         {
@@ -2884,10 +3205,10 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
             if (curr_tok)
             {
                 string_t *tok_str = token_to_string(curr_tok);
-                log_debug("exec_frame_string_core: Current token: type=%d, line=%d, col=%d, text='%s'",
+                log_debug("exec_parse_core: Current token: type=%d, line=%d, col=%d, text='%s'",
                           token_get_type(curr_tok), token_get_first_line(curr_tok),
                           token_get_first_column(curr_tok), string_cstr(tok_str));
-                frame_set_error_printf(frame, "Parse error at line %d, column %d near '%s'",
+                exec_set_error_printf(executor, "Parse error at line %d, column %d near '%s'",
                                        token_get_first_line(curr_tok),
                                        token_get_first_column(curr_tok), string_cstr(tok_str));
                 string_destroy(&tok_str);
@@ -2895,8 +3216,8 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
             }
             else
             {
-                log_debug("exec_frame_string_core: No current token available");
-                frame_set_error_printf(frame, "Parse error at line %d: no error details available",
+                log_debug("exec_parse_core: No current token available");
+                exec_set_error_printf(executor, "Parse error at line %d: no error details available",
                                        session->line_num);
             }
         }
@@ -2906,7 +3227,7 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
     if (parse_status == PARSE_INCOMPLETE)
     {
-        log_debug("exec_frame_string_core: Parse incomplete at line %d, accumulating tokens",
+        log_debug("exec_parse_core: Parse incomplete at line %d, accumulating tokens",
                   session->line_num);
         if (gnode)
             g_node_destroy(&gnode);
@@ -2918,21 +3239,31 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
 
     if (parse_status == PARSE_EMPTY || !gnode)
     {
-        log_debug("exec_frame_string_core: Parse empty at line %d", session->line_num);
+        log_debug("exec_parse_core: Parse empty at line %d", session->line_num);
         parser_destroy(&parser);
         return MIGA_EXEC_STATUS_EMPTY;
     }
 
-    ast_node_t *ast = ast_lower(gnode);
+    *out_ast = ast_lower(gnode);
     g_node_destroy(&gnode);
     parser_destroy(&parser);
 
-    if (!ast)
-    {
-        return MIGA_EXEC_STATUS_EMPTY;
-    }
+    return *out_ast ? MIGA_EXEC_STATUS_OK : MIGA_EXEC_STATUS_EMPTY;
+}
+
+miga_exec_status_t exec_frame_run_ast(miga_frame_t *frame, const ast_node_t *ast)
+{
+    Expects_not_null(frame);
+    Expects_not_null(ast);
+
+    miga_exec_t *executor = frame->executor;
+
+    /* Execute via the dispatch function. Nested parses and executions
+     * charge themselves, so only the remainder is added here. */
+    uint64_t parse_before = executor->stats.parse_ns;
+    uint64_t exec_before = executor->stats.exec_ns;
+    uint64_t exec_start = profiler_wall_clock_ns();
 
-    /* Execute via the dispatch function */
     exec_frame_execute_result_t result = exec_frame_execute_dispatch(frame, ast);
 
     /* Update frame's exit status */
@@ -2943,9 +3274,27 @@ miga_exec_status_t exec_frame_string_core(miga_frame_t *frame, const char *input
         executor->last_exit_status_set = true;
     }
 
+    uint64_t exec_elapsed = profiler_wall_clock_ns() - exec_start;
+    uint64_t charged = (executor->stats.parse_ns - parse_before) +
+                       (executor->stats.exec_ns - exec_before);
+    if (exec_elapsed > charged)
+        executor->stats.exec_ns += exec_elapsed - charged;
+
+    return result.status == MIGA_EXEC_STATUS_ERROR ? MIGA_EXEC_STATUS_ERROR : MIGA_EXEC_STATUS_OK;
+}
+
+static miga_exec_status_t exec_frame_string_core_impl(miga_frame_t *frame, const char *input,
+                                                      parse_session_t *session)
+{
+    ast_node_t *ast = NULL;
+    miga_exec_status_t status = exec_parse_core(frame->executor, input, session, &ast);
+    if (status != MIGA_EXEC_STATUS_OK)
+        return status;
+
+    status = exec_frame_run_ast(frame, ast);
     ast_node_destroy(&ast);
 
-    if (result.status == MIGA_EXEC_STATUS_ERROR)
+    if (status == MIGA_EXEC_STATUS_ERROR)
     {
         return MIGA_EXEC_STATUS_ERROR;
     }
@@ -3005,6 +3354,10 @@ miga_exec_status_t exec_frame_stream_core(miga_frame_t *frame, FILE *fp, parse_s
                 case MIGA_EXEC_STATUS_ERROR:
                     final_status = MIGA_EXEC_STATUS_ERROR;
                     break;
+                case MIGA_EXEC_STATUS_PENDING:
+                    /* A waiting script is suspended inside the core, not returned */
+                    Expects(false && "Pending status from exec_frame_string_core");
+                    break;
                 }
                 return final_status;
             }
@@ -3066,6 +3419,10 @@ miga_exec_status_t exec_frame_stream_core(miga_frame_t *frame, FILE *fp, parse_s
         case MIGA_EXEC_STATUS_ERROR:
             final_status = MIGA_EXEC_STATUS_ERROR;
             break;
+        case MIGA_EXEC_STATUS_PENDING:
+            /* A waiting script is suspended inside the core, not returned */
+            Expects(false && "Pending status from exec_frame_string_core");
+            break;
         }
     }
 
@@ -127,25 +127,90 @@ trap_store_t *exec_frame_get_traps(miga_frame_t *frame);
  * ============================================================================ */
 
 /**
- * Get variable value, checking local store first if applicable.
+ * Get variable value. Locals live in the same store as everything else.
  */
 const string_t *exec_frame_get_variable(const miga_frame_t *frame, const string_t *name);
 
 /**
- * Set variable, respecting local scope if applicable.
+ * Get the value of a dynamic parameter ($?, $$, $!, $-, $_ or LINENO),
+ * computed from frame and executor state at the time of the call.
+ * Returns a new string, or NULL if `name` is not dynamic, currently has no
+ * value, or is $_ or LINENO and has been assigned; the caller should then
+ * fall back to the variable store.
+ */
+string_t *exec_frame_get_dynamic_param(const miga_frame_t *frame, const string_t *name);
+
+/**
+ * Set variable. A variable made local by 'local' is restored when its
+ * function returns, whichever frame assigned it.
  */
 void exec_frame_set_variable(miga_frame_t *frame, const string_t *name, const string_t *value);
 
 /**
- * Declare a local variable (only valid in frames with has_locals=true).
- * Returns 0 on success, -1 if locals not supported in this frame.
+ * Declare a local variable in the nearest enclosing function.
+ * The variable's current value and flags are saved on the function frame
+ * (the first time only) and put back when the function returns. With a
+ * NULL value the variable keeps its current value.
+ * Returns 0 on success, -1 if not inside a function or the variable is
+ * read-only.
  */
 int exec_frame_declare_local(miga_frame_t *frame, const string_t *name, const string_t *value);
 
+/* ============================================================================
+ * Variable Save Lists
+ * ============================================================================ */
+
+/**
+ * Record the current state of `name` in `store`, unless `saves` already
+ * holds an earlier state for it.
+ */
+void exec_var_saves_record(exec_var_saves_t *saves, const variable_store_t *store,
+                           const string_t *name);
+
+/**
+ * Put every recorded variable back into `store`, newest first, and empty
+ * the list.
+ */
+void exec_var_saves_restore(exec_var_saves_t *saves, variable_store_t *store);
+
+/**
+ * Forget every recorded variable without restoring it.
+ */
+void exec_var_saves_clear(exec_var_saves_t *saves);
+
+/* ============================================================================
+ * Positional Parameter Sharing
+ * ============================================================================ */
+
+/**
+ * Give `frame` positional parameters of its own before they are modified.
+ * A function called with exactly its caller's arguments borrows the
+ * caller's parameters instead of copying them; this clones them for the
+ * borrowing function and the frames below it. Does nothing if the
+ * parameters are not borrowed.
+ */
+void exec_frame_unshare_positional_params(miga_frame_t *frame);
+
 /* ============================================================================
  * String Core Execution
  * ============================================================================ */
 
+/**
+ * Lex, tokenize, parse and lower one chunk of input.
+ *
+ * On MIGA_EXEC_STATUS_OK, *out_ast receives the lowered program, which the
+ * caller owns. MIGA_EXEC_STATUS_INCOMPLETE means the session is holding a
+ * partial command and wants more input; errors are reported on `executor`.
+ */
+miga_exec_status_t exec_parse_core(miga_exec_t *executor, const char *input,
+                                   parse_session_t *session, ast_node_t **out_ast);
+
+/**
+ * Execute an already lowered program in `frame` and record its exit status.
+ * The tree is only read, so it may be shared with other executors.
+ */
+miga_exec_status_t exec_frame_run_ast(miga_frame_t *frame, const ast_node_t *ast);
+
 /**
  * Core implementation for executing shell commands from a string.
  *
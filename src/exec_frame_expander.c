@@ -22,13 +22,16 @@
 #include "exec_frame_expander.h"
 #include "exec_types_internal.h"
 #include "glob_util.h"
+#include "ifs_split.h"
 #include "logging.h"
 #include "pattern_removal.h"
+#include "trace.h"
 #include "miga/string_t.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
 
 #ifdef MIGA_POSIX_API
+#include <errno.h>
 #include <pwd.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -44,39 +47,34 @@
  * ============================================================================ */
 
 /**
- * Get the IFS value from the frame, falling back to default.
+ * Get the IFS value from the frame, falling back to the environment and then
+ * the default. The result is borrowed from the variable store or environment.
  */
-static string_t *get_ifs(miga_frame_t *frame)
+static const char *get_ifs(miga_frame_t *frame)
 {
     Expects_not_null(frame);
 
-    string_t *ifs_var = NULL;
-    if (frame_has_variable_cstr(frame, "IFS"))
-    {
-        ifs_var = frame_get_variable_cstr(frame, "IFS");
-        /* If IFS is empty, this had to be an explicit choice by the user, since
-         * it is initialized to <space><tab><newline> by default. So we intentionally
-         * don't check it here. */
-    }
-    else
-    {
-        char *ifs_env = getenv("IFS");
-        if (ifs_env)
-        {
-            ifs_var = string_create_from_cstr(ifs_env);
-        }
-        else
-        {
-            /* Default IFS is space, tab, newline */
-            ifs_var = string_create_from_cstr(" \t\n");
-        }
-    }
-
-    return ifs_var;
+    /* If IFS is empty, this had to be an explicit choice by the user, since
+     * it is initialized to <space><tab><newline> by default. So we intentionally
+     * don't check it here. */
+    string_t *name = string_create_from_cstr("IFS");
+    const string_t *ifs_var = exec_frame_get_variable(frame, name);
+    string_destroy(&name);
+    if (ifs_var)
+        return string_cstr(ifs_var);
+
+    const char *ifs_env = getenv("IFS");
+    if (ifs_env)
+        return ifs_env;
+
+    /* Default IFS is space, tab, newline */
+    return " \t\n";
 }
 
 /**
- * Record the exit status from a command substitution.
+ * Record the exit status from a command substitution.  The substituted
+ * command may have touched the file system, so cached file tests are
+ * dropped here too.
  */
 static void record_subst_status(miga_frame_t *frame, int raw_status)
 {
@@ -102,6 +100,8 @@ static void record_subst_status(miga_frame_t *frame, int raw_status)
 #endif
 
     frame->last_exit_status = status;
+    if (frame->executor)
+        stat_cache_clear(frame->executor->stat_cache);
 }
 
 /**
@@ -266,6 +266,14 @@ static string_t *get_parameter_value(const miga_frame_t *frame, const string_t *
 
     const char *name_cstr = string_cstr(name);
 
+    /* Dynamic parameters ($?, $_, LINENO, ...) are computed, not stored */
+    if (frame)
+    {
+        string_t *dynamic = exec_frame_get_dynamic_param(frame, name);
+        if (dynamic)
+            return dynamic;
+    }
+
     /* Check for special parameters first */
     string_t *special = expand_special_param(frame, name);
     if (special)
@@ -523,28 +531,10 @@ string_t *expand_special_param(const miga_frame_t *frame, const string_t *name)
         switch (n[0])
         {
         case '?':
-            /* Exit status of last command */
-            if (frame)
-            {
-                return string_from_int(frame->last_exit_status);
-            }
-            return string_create_from_cstr("0");
-
         case '$':
-            /* PID of shell */
-            if (frame && frame->executor)
-            {
-                return string_from_int(frame->executor->shell_pid);
-            }
-            return string_create_from_cstr("0");
-
         case '!':
-            /* PID of last background job */
-            if (frame)
-            {
-                return string_from_int(frame->last_bg_pid);
-            }
-            return string_create_from_cstr("");
+            /* Exit status, shell PID, last background PID */
+            return frame ? exec_frame_get_dynamic_param(frame, name) : NULL;
 
         case '#':
             /* Number of positional parameters */
@@ -566,8 +556,7 @@ string_t *expand_special_param(const miga_frame_t *frame, const string_t *name)
 
         case '-':
             /* Current option flags */
-            /* TODO: Implement option flags string */
-            return string_create();
+            return frame ? exec_frame_get_dynamic_param(frame, name) : string_create();
 
         case '0':
             /* Shell or script name */
@@ -645,6 +634,7 @@ bool is_special_param(const string_t *name)
 
 string_t *expand_command_subst(miga_frame_t *frame, const string_t *command)
 {
+    frame->executor->stats.command_substitutions++;
 #ifdef MIGA_POSIX_API
     const char *cmd = string_cstr(command);
     if (cmd == NULL || *cmd == '\0')
@@ -653,24 +643,78 @@ string_t *expand_command_subst(miga_frame_t *frame, const string_t *command)
         return string_create();
     }
 
-    FILE *pipe = popen(cmd, "r");
-    if (pipe == NULL)
+    /* Run the command in a subshell of this shell, not /bin/sh, so that
+     * functions, aliases and unexported variables are visible to it. */
+    int pipefd[2];
+    if (pipe(pipefd) < 0)
     {
-        log_error("expand_command_subst: popen failed for '%s'", cmd);
-        record_subst_status(frame, 1);
+        log_error("expand_command_subst: pipe failed: %s", strerror(errno));
+        record_subst_status(frame, 1 << 8);
         return string_create();
     }
 
-    string_t *output = string_create();
-    char buffer[256];
+    miga_exec_stats_t *stats = &frame->executor->stats;
+    stats->pipes++;
+    stats->forks++;
+    trace_event(TRACE_EVENT_PIPE, pipefd[0], pipefd[1]);
+
+    profiler_t *prof = frame->executor->profiler;
+    fflush(NULL);
+    if (prof)
+        profiler_enter(prof, PROFILER_FORK, NULL);
+    pid_t pid = fork();
+    if (pid != 0 && prof)
+        profiler_leave(prof);
+    trace_event(TRACE_EVENT_FORK, pid, 0);
+    if (pid < 0)
+    {
+        log_error("expand_command_subst: fork failed: %s", strerror(errno));
+        close(pipefd[0]);
+        close(pipefd[1]);
+        record_subst_status(frame, 1 << 8);
+        return string_create();
+    }
 
-    while (fgets(buffer, sizeof(buffer), pipe) != NULL)
+    if (pid == 0)
     {
-        string_append_cstr(output, buffer);
+        close(pipefd[0]);
+        if (pipefd[1] != STDOUT_FILENO)
+        {
+            dup2(pipefd[1], STDOUT_FILENO);
+            close(pipefd[1]);
+        }
+        frame_execute_string(frame, command);
+        fflush(NULL);
+        _exit(frame->last_exit_status & 0xFF);
     }
 
-    int exit_code = pclose(pipe);
-    record_subst_status(frame, exit_code);
+    close(pipefd[1]);
+
+    /* Reading the output is waiting for the child as far as we can tell */
+    if (prof)
+        profiler_enter(prof, PROFILER_WAIT, NULL);
+    string_t *output = string_create();
+    char buffer[4096];
+    for (;;)
+    {
+        exec_async_wait_readable(frame->executor, pipefd[0]);
+        ssize_t n = read(pipefd[0], buffer, sizeof(buffer));
+        if (n > 0)
+            string_append_data(output, buffer, (int)n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+            break;
+    }
+    close(pipefd[0]);
+
+    int wstatus = 0;
+    exec_async_waitpid(frame->executor, pid, &wstatus, 0);
+    stats->waits++;
+    if (prof)
+        profiler_leave(prof);
+    trace_event(TRACE_EVENT_CMD_SUBST, pid, string_length(output));
+    record_subst_status(frame, wstatus);
 
     /* Strip trailing newlines per POSIX */
     strip_trailing_newlines(output);
@@ -685,6 +729,8 @@ string_t *expand_command_subst(miga_frame_t *frame, const string_t *command)
         return string_create();
     }
 
+    frame->executor->stats.pipes++;
+    frame->executor->stats.execs++;
     FILE *pipe = _popen(cmd, "r");
     if (pipe == NULL)
     {
@@ -755,150 +801,28 @@ string_t *expand_arithmetic(miga_frame_t *frame, const string_t *expression)
  * ============================================================================ */
 
 /**
- * Check if a character is IFS whitespace (space, tab, newline).
- */
-static bool is_ifs_whitespace(char c)
-{
-    return c == ' ' || c == '\t' || c == '\n';
-}
-
-/**
- * Check if a character is in the IFS string.
- */
-static bool is_ifs_char(char c, const char *ifs)
-{
-    for (const char *p = ifs; *p; p++)
-    {
-        if (*p == c)
-            return true;
-    }
-    return false;
-}
-
-/**
- * POSIX-compliant field splitting.
- *
- * Rules:
- * 1. If IFS is null (empty), no splitting occurs
- * 2. IFS whitespace (space/tab/newline) at start/end is ignored
- * 3. Consecutive IFS whitespace is treated as a single delimiter
- * 4. Non-whitespace IFS characters create empty fields
- * 5. IFS whitespace adjacent to non-whitespace IFS is ignored
- * 6. If the result contains only IFS whitespace, produce zero words (empty list)
+ * POSIX field splitting of `text` on the current IFS (see ifs_split.h for
+ * the rules). The executor keeps one splitter whose classification table
+ * is rebuilt only when IFS changes. The splitter also remembers which
+ * variable store, at which generation, it last read IFS from; until that
+ * store changes, IFS is not looked up at all.
  */
 strlist_t *expand_field_split(miga_frame_t *frame, const string_t *text)
 {
     Expects_not_null(frame);
     Expects_not_null(text);
 
-    strlist_t *fields = strlist_create();
-
     if (string_empty(text))
-        return fields;
-
-    string_t *ifs = get_ifs(frame);
-    if (string_empty(ifs))
-    {
-        // Empty IFS: no splitting, whole text is one field
-        strlist_push_back(fields, text);
-        string_destroy(&ifs);
-        return fields;
-    }
-
-    // Split IFS into whitespace and non-whitespace parts for efficient searching
-    string_t *ifs_ws = string_create();
-    string_t *ifs_nws = string_create();
-    for (int k = 0; k < string_length(ifs); k++)
-    {
-        char c = string_at(ifs, k);
-        if (is_ifs_whitespace(c))
-            string_append_char(ifs_ws, c);
-        else
-            string_append_char(ifs_nws, c);
-    }
-
-    int len = string_length(text);
-    int i = 0;
-
-    // 1. Skip all leading IFS whitespace (never produces fields)
-    if (!string_empty(ifs_ws))
-    {
-        i = string_find_first_not_of_at(text, ifs_ws, 0);
-        if (i == -1)
-        {
-            // Entire input is IFS whitespace → zero fields
-            goto cleanup;
-        }
-    }
-    // Now i is either at a non-IFS char or at a hard (non-ws) delimiter
-
-    while (i < len)
-    {
-        // 2. Collect the field: all characters until any IFS char
-        int field_start = i;
-        int field_end = string_find_first_of_at(text, ifs, i);
-        if (field_end == -1)
-            field_end = len;
-
-        string_t *field = string_create_from_range(text, field_start, field_end);
-        strlist_move_push_back(fields, &field);
-
-        i = field_end;
-        if (i >= len)
-            break;
-
-        // 3. Consume the delimiter sequence
-        //    - Skip all following IFS whitespace (collapsed)
-        //    - Handle each non-whitespace IFS char as a separate delimiter (empty fields)
-        bool in_delimiter = true;
-        while (in_delimiter && i < len)
-        {
-            // Skip whitespace part of delimiter
-            if (!string_empty(ifs_ws))
-            {
-                int after_ws = string_find_first_not_of_at(text, ifs_ws, i);
-                if (after_ws != -1)
-                    i = after_ws;
-                else
-                {
-                    // Only trailing whitespace left → done, no trailing empty from ws-only
-                    goto cleanup;
-                }
-            }
-
-            // Now handle zero or more consecutive hard delimiters
-            while (i < len && string_find_first_of_at(text, ifs_nws, i) == i)
-            {
-                // Consume this hard delimiter
-                i++;
-
-                // After each hard delimiter, we conceptually "end" a field.
-                // If we're at end or followed by more delimiters → empty field
-                if (i >= len || string_find_first_of_at(text, ifs, i) == i)
-                {
-                    string_t *empty = string_create();
-                    strlist_move_push_back(fields, &empty);
-                }
-                else
-                {
-                    // Next is start of real field → stop consuming delimiters
-                    in_delimiter = false;
-                    break;
-                }
-            }
-
-            // If we didn't hit another hard delimiter and whitespace is done,
-            // we're at the start of the next field (or end)
-            if (i < len && string_find_first_of_at(text, ifs, i) != i)
-                in_delimiter = false;
-        }
-    }
-
-cleanup:
-    string_destroy(&ifs);
-    string_destroy(&ifs_ws);
-    string_destroy(&ifs_nws);
-    return fields;
+        return strlist_create();
+
+    miga_exec_t *executor = frame->executor;
+    if (!executor->ifs_splitter)
+        executor->ifs_splitter = ifs_splitter_create();
+    const variable_store_t *vars = frame->variables;
+    uint32_t generation = vars ? vars->generation : 0;
+    if (!ifs_splitter_is_from(executor->ifs_splitter, vars, generation))
+        ifs_splitter_set_ifs_from(executor->ifs_splitter, get_ifs(frame), vars, generation);
+    return ifs_splitter_split(executor->ifs_splitter, text);
 }
 
 /* ============================================================================
@@ -907,8 +831,7 @@ cleanup:
 
 strlist_t *expand_pathname(miga_frame_t *frame, const string_t *pattern)
 {
-    (void)frame; /* May use frame for noglob check in future */
-
+    frame->executor->stats.glob_expansions++;
     strlist_t *matches = glob_util_expand_path(pattern);
 
     if (matches && strlist_size(matches) > 0)
@@ -923,7 +846,7 @@ strlist_t *expand_pathname(miga_frame_t *frame, const string_t *pattern)
     }
 
     strlist_t *result = strlist_create();
-    strlist_push_back(result, string_create_from(pattern));
+    strlist_push_back(result, pattern);
     return result;
 }
 
@@ -947,25 +870,12 @@ static string_t *expand_part(miga_frame_t *frame, const part_t *part)
         /* Use the full parameter expansion with modifiers */
         return expand_parameter_with_modifier(frame, part);
 
-    case PART_COMMAND_SUBST: {
-        /* Convert nested tokens to command string */
-        string_t *cmd = string_create();
-        int len = part->nested ? token_list_size(part->nested) : 0;
-        for (int i = 0; i < len; i++)
-        {
-            const token_t *t = token_list_get(part->nested, i);
-            string_t *ts = token_to_string(t);
-            string_append(cmd, ts);
-            string_destroy(&ts);
-            if (i < token_list_size(part->nested) - 1)
-            {
-                string_append_cstr(cmd, " ");
-            }
-        }
-        string_t *result = expand_command_subst(frame, cmd);
-        string_destroy(&cmd);
-        return result;
-    }
+    case PART_COMMAND_SUBST:
+        /* The lexer keeps the command's source text; re-parsing it in the
+         * subshell is simpler than re-serialising the nested tokens. */
+        if (!part->text)
+            return string_create();
+        return expand_command_subst(frame, part->text);
 
     case PART_ARITHMETIC:
         return expand_arithmetic(frame, part->text);
@@ -1014,6 +924,87 @@ static string_t *expand_parts_to_string(miga_frame_t *frame, const part_list_t *
     return result;
 }
 
+/**
+ * True if the part is a double-quoted plain "$@".
+ */
+static bool is_quoted_at_param(const part_t *part)
+{
+    return part->type == PART_PARAMETER && part->param_kind == PARAM_PLAIN &&
+           part->was_double_quoted && part->param_name && string_eq_cstr(part->param_name, "@");
+}
+
+static bool parts_have_quoted_at(const part_list_t *parts)
+{
+    for (int i = 0; i < part_list_size(parts); i++)
+    {
+        if (is_quoted_at_param(part_list_get(parts, i)))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Expand the parts of a word that contains a double-quoted "$@".
+ * Each positional parameter becomes a field of its own; text before and
+ * after "$@" joins the first and last parameter. With no parameters, a
+ * word that is only "$@" expands to no fields at all. The parameters are
+ * borrowed through positional_params_view(), so each is copied once,
+ * straight into its field. The resulting fields are not split.
+ */
+static strlist_t *expand_parts_with_quoted_at(miga_frame_t *frame, const part_list_t *parts)
+{
+    Expects_not_null(frame);
+    Expects_not_null(parts);
+
+    strlist_t *fields = strlist_create();
+    string_t *current = string_create();
+    bool have_field = false;
+
+    for (int i = 0; i < part_list_size(parts); i++)
+    {
+        const part_t *part = part_list_get(parts, i);
+
+        if (is_quoted_at_param(part))
+        {
+            int count = 0;
+            const string_t *const *params =
+                frame->positional_params ? positional_params_view(frame->positional_params, &count)
+                                         : NULL;
+            for (int j = 0; j < count; j++)
+            {
+                if (j > 0)
+                {
+                    strlist_move_push_back(fields, &current);
+                    current = string_create();
+                }
+                string_append(current, params[j]);
+                have_field = true;
+            }
+            continue;
+        }
+
+        have_field = true;
+        if (part->was_single_quoted && part->type == PART_LITERAL)
+        {
+            string_append(current, part->text);
+            continue;
+        }
+
+        string_t *expanded = expand_part(frame, part);
+        if (expanded)
+        {
+            string_append(current, expanded);
+            string_destroy(&expanded);
+        }
+    }
+
+    if (have_field)
+        strlist_move_push_back(fields, &current);
+    else
+        string_destroy(&current);
+    return fields;
+}
+
 /**
  * Remove quote characters from a string (final step of word expansion).
  * Note: This is typically handled during tokenization/parsing, but included
@@ -1052,13 +1043,18 @@ strlist_t *exec_frame_expander_expand_word(miga_frame_t *frame, const token_t *t
         return result;
     }
 
-    /* Expand all parts */
-    string_t *expanded = expand_parts_to_string(frame, token_get_parts_const(tok));
-
-    /* Field splitting */
+    const part_list_t *parts = token_get_parts_const(tok);
     strlist_t *fields;
-    if (tok->needs_field_splitting)
+
+    if (parts_have_quoted_at(parts))
     {
+        /* "$@" yields one field per positional parameter */
+        fields = expand_parts_with_quoted_at(frame, parts);
+    }
+    else if (tok->needs_field_splitting)
+    {
+        /* Expand all parts, then split */
+        string_t *expanded = expand_parts_to_string(frame, parts);
         fields = expand_field_split(frame, expanded);
         string_destroy(&expanded);
 
@@ -1067,6 +1063,7 @@ strlist_t *exec_frame_expander_expand_word(miga_frame_t *frame, const token_t *t
     }
     else
     {
+        string_t *expanded = expand_parts_to_string(frame, parts);
         fields = strlist_create();
         strlist_move_push_back(fields, &expanded);
     }
@@ -1080,12 +1077,7 @@ strlist_t *exec_frame_expander_expand_word(miga_frame_t *frame, const token_t *t
         {
             const string_t *pattern = strlist_at(fields, i);
             strlist_t *matches = expand_pathname(frame, pattern);
-
-            for (int j = 0; j < strlist_size(matches); j++)
-            {
-                strlist_push_back(globs, string_create_from(strlist_at(matches, j)));
-            }
-            strlist_destroy(&matches);
+            strlist_move_extend(globs, &matches);
         }
 
         strlist_destroy(&fields);
@@ -1131,14 +1123,8 @@ strlist_t *expand_words(miga_frame_t *frame, const token_list_t *tokens)
         const token_t *tok = token_list_get(tokens, i);
         strlist_t *expanded = exec_frame_expander_expand_word(frame, tok);
 
-        if (expanded)
-        {
-            for (int j = 0; j < strlist_size(expanded); j++)
-            {
-                strlist_push_back(result, string_create_from(strlist_at(expanded, j)));
-            }
-            strlist_destroy(&expanded);
-        }
+        /* Fields move into the result without being copied */
+        strlist_move_extend(result, &expanded);
     }
 
     return result;
@@ -52,6 +52,7 @@
 #include "logging.h"
 #include "miga/string_t.h"
 #include "token.h"
+#include "trace.h"
 #include "miga/xalloc.h"
 
 /**
@@ -484,6 +485,7 @@ miga_exec_status_t exec_apply_redirections_posix(miga_frame_t *frame, const exec
             }
             const char *content = content_str ? string_cstr(content_str) : "";
             size_t content_len = content_str ? string_length(content_str) : 0;
+            trace_event(TRACE_EVENT_HEREDOC, target_fd, content_len);
 
             // Design parameter: 4096-byte heredoc threshold
             // If heredoc content exceeds 4096 bytes, use temp file fallback instead of pipe.
@@ -547,6 +549,8 @@ miga_exec_status_t exec_apply_redirections_posix(miga_frame_t *frame, const exec
                 string_destroy(&content_str);
                 goto cleanup_error;
             }
+            executor->stats.pipes++;
+            trace_event(TRACE_EVENT_PIPE, pipefd[0], pipefd[1]);
 
             ssize_t written = write(pipefd[1], content, content_len);
             if (written < 0 || (size_t)written != content_len)
@@ -1044,6 +1048,7 @@ miga_exec_status_t exec_apply_redirections_ucrt_c(miga_frame_t *frame, const exe
             }
             const char *content = content_str ? string_cstr(content_str) : "";
             size_t content_len = strlen(content);
+            trace_event(TRACE_EVENT_HEREDOC, fd, content_len);
 
             if (content_len > 4096)
             {
@@ -1118,6 +1123,8 @@ miga_exec_status_t exec_apply_redirections_ucrt_c(miga_frame_t *frame, const exe
                 string_destroy(&content_str);
                 goto error_restore;
             }
+            executor->stats.pipes++;
+            trace_event(TRACE_EVENT_PIPE, pipefd[0], pipefd[1]);
 
             if (content_len > 0)
                 _write(pipefd[1], content, (unsigned int)content_len);
@@ -1523,7 +1530,12 @@ void exec_restore_redirections_iso_c(miga_frame_t *frame)
 
 void exec_redirect_restore_redirections(miga_frame_t *frame, const exec_redirections_t *redirections)
 {
-    (void)redirections;
+    /* Nothing was applied, so nothing to undo.  Restoring anyway would
+     * undo the redirections of an enclosing compound command, since the
+     * saved fds live in the shared fd table. */
+    if (redirections && redirections->count == 0)
+        return;
+    fflush(NULL);
 #ifdef MIGA_POSIX_API
     exec_restore_redirections_posix(frame);
 #elifdef MIGA_UCRT_API
@@ -1758,6 +1770,9 @@ exec_redirections_t *exec_redirections_clone(const exec_redirections_t *redirs)
 miga_exec_status_t exec_redirect_apply_redirectons(miga_frame_t *frame,
                                             const exec_redirections_t *redirections)
 {
+    /* Output buffered by stdio belongs to the old fds; write it out before
+     * they are replaced. */
+    fflush(NULL);
 #ifdef MIGA_POSIX_API
     miga_exec_status_t st = exec_apply_redirections_posix(frame, redirections);
 #elif defined(MIGA_UCRT_API)
@@ -1765,6 +1780,9 @@ miga_exec_status_t exec_redirect_apply_redirectons(miga_frame_t *frame,
 #else
     miga_exec_status_t st = exec_apply_redirections_iso_c(frame, redirections);
 #endif
+    /* Opening a file for output may create or truncate it */
+    if (redirections && redirections->count > 0)
+        stat_cache_clear(frame->executor->stat_cache);
     return st;
 }
 
@@ -1876,9 +1894,10 @@ exec_redirections_t *exec_redirections_create_from_ast_nodes(miga_frame_t *frame
         case REDIR_TARGET_FD:
             /* For FD target, we can have a fixed fd, a literal, or an expression (including
              * variable). */
-            if (ast_target && ast_target->io_number >= 0)
+            runtime_redir->target.fd.fixed_fd = -1;
+            if (ast_target && token_get_io_number(ast_target) >= 0)
             {
-                runtime_redir->target.fd.fixed_fd = ast_target->io_number;
+                runtime_redir->target.fd.fixed_fd = token_get_io_number(ast_target);
             }
             else if (ast_target && ast_target->parts && ast_target->parts->size > 0)
             {
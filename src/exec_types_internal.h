@@ -27,14 +27,23 @@
 #include "alias_store.h"
 #include "ast.h"
 #include "builtin_store.h"
+#include "completion_index.h"
+#include "exec_async.h"
 #include "exec_frame_policy.h"
 #include "fd_table.h"
 #include "func_store.h"
+#include "history.h"
+#include "ifs_split.h"
 #include "job_store.h"
 #include "positional_params.h"
+#include "printf_format.h"
+#include "profiler.h"
+#include "prompt.h"
 #include "sig_act.h"
+#include "stat_cache.h"
 #include "miga/strlist.h"
 #include "miga/string_t.h"
+#include "miga/xalloc.h"
 #include "trap_store.h"
 #include "variable_store.h"
 
@@ -117,6 +126,11 @@ struct miga_exec_t
 {
     /* ─── Singleton state ─────────────────────────────────────────────── */
 
+    /* Arena for everything the executor allocates.  The public entry points
+     * make it the calling thread's current arena while they run, so that
+     * executors on different threads do not share an allocator. */
+    miga_arena_t *arena;
+
     bool shell_pid_valid;
     bool shell_ppid_valid;
 #ifdef MIGA_POSIX_API
@@ -138,6 +152,40 @@ struct miga_exec_t
 
     job_store_t *jobs;
     bool job_control_disabled;
+    int jobs_max; /* Limit on running background jobs (0 = unlimited) */
+
+    /* File status results shared by test and [ (created on first use) */
+    stat_cache_t *stat_cache;
+
+    /* Compiled printf formats, most recently used (created on first use) */
+    printf_format_cache_t *printf_cache;
+
+    /* Parsed and rendered PS1 and PS2 (created on first use) */
+    prompt_cache_t *ps1_cache;
+    prompt_cache_t *ps2_cache;
+
+    /* Command names for exec_complete_prefix() (created on first use) */
+    completion_index_t *completion;
+
+    /* Command history (opened on first use) */
+    history_t *history;
+
+    /* IFS classification for field splitting (created on first use) */
+    ifs_splitter_t *ifs_splitter;
+
+    /* Script started with exec_start() (created on first use) */
+    exec_async_t *async;
+
+    /* Time profile (NULL unless profiling) and where to write it */
+    profiler_t *profiler;
+    string_t *profile_path;
+
+    /* Work counters (see exec_get_stats()). The variable stores of every
+     * frame count into `var_counters`; `stats_bytes_base` is the arena's
+     * total at the last reset. */
+    miga_exec_stats_t stats;
+    variable_store_counters_t var_counters;
+    uint64_t stats_bytes_base;
 
     bool pgid_valid;
 #ifdef MIGA_POSIX_API
@@ -165,6 +213,7 @@ struct miga_exec_t
     int argc;
     char *const *argv;
     char *const *envp;
+    char **owned_envp; // Copy made by exec_set_envp_cstr(), or NULL if envp is borrowed
 
     string_t *shell_name;
     strlist_t *shell_args;
@@ -181,7 +230,6 @@ struct miga_exec_t
 
     /* Top-frame stores (owned until top frame is created) */
     variable_store_t *variables;
-    variable_store_t *local_variables;
     positional_params_t *positional_params;
     func_store_t *functions;
     alias_store_t *aliases;
@@ -316,6 +364,34 @@ typedef struct exec_frame_execute_result_t
     int flow_depth;            /* for break/continue: how many nested loops */
 } exec_frame_execute_result_t;
 
+/* ============================================================================
+ * Variable Save List
+ * ============================================================================ */
+
+/**
+ * The value a variable had before it was temporarily overridden, either by
+ * 'local' in a function or by a prefix assignment on a simple command.
+ */
+typedef struct exec_var_save_t
+{
+    string_t *name;
+    string_t *value; /* NULL if the variable was unset */
+    bool exported;
+    bool read_only;
+} exec_var_save_t;
+
+/**
+ * Undo log of overridden variables. Overrides are written straight into
+ * the shared variable store; restoring the list puts the old values back,
+ * newest first. An empty list owns no memory.
+ */
+typedef struct exec_var_saves_t
+{
+    exec_var_save_t *items;
+    int count;
+    int capacity;
+} exec_var_saves_t;
+
 /* ============================================================================
  * Execution Frame Structure
  * ============================================================================ */
@@ -346,10 +422,9 @@ struct miga_frame_t
      * - EXEC_SCOPE_OWN/COPY: Owned by this frame, must be freed on pop
      */
     variable_store_t *variables;
-    variable_store_t *saved_variables;
-    variable_store_t *local_variables; /* Only for frames with has_locals=true */
     positional_params_t *positional_params;
     positional_params_t *saved_positional_params; /* For dot script override restore */
+    bool positional_params_borrowed; /* Function called with the caller's own arguments */
     func_store_t *functions;
     alias_store_t *aliases;
     fd_table_t *open_fds;
@@ -372,6 +447,7 @@ struct miga_frame_t
     FILE **stdout_fp;
     FILE **stderr_fp;
 #endif
+    exec_var_saves_t local_saves; /* Values hidden by 'local' (has_locals frames only) */
     int loop_depth;       /* 0 if not in loop, else depth of nested loops */
     int last_exit_status; /* $? */
     int last_bg_pid;      /* $! */
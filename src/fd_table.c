@@ -7,25 +7,39 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_CLOSE_RANGE
+#define _GNU_SOURCE // close_range() is a Linux and BSD extension
+#endif
+
 #ifdef _MSC_VER
 #define _CRT_SECURE_NO_WARNINGS
+#include <intrin.h>
 #endif
 
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef MIGA_POSIX_API
+#include <unistd.h>
+#endif
+
 #include "fd_table.h"
 
 #include "logging.h"
 #include "miga/string_t.h"
 #include "miga/xalloc.h"
 
-/* Initial capacity for the FD entries array */
-#define INITIAL_CAPACITY 16
+/* Initial length of the pages array: FDs 0 to 63 */
+#define INITIAL_PAGE_COUNT 1
 
-/* Growth factor when resizing the array */
+/* Growth factor when resizing the pages array */
 #define GROWTH_FACTOR 2
 
+#define FD_PAGE(fd) ((size_t)(fd) / FD_TABLE_PAGE_SIZE)
+#define FD_SLOT(fd) ((unsigned)(fd) % FD_TABLE_PAGE_SIZE)
+#define FD_BIT(slot) ((uint64_t)1 << (slot))
+
 static const char *fd_flags_to_string(fd_flags_t flags, char *buffer, size_t bufsize);
 
 /*
@@ -34,67 +48,150 @@ static const char *fd_flags_to_string(fd_flags_t flags, char *buffer, size_t buf
  * ============================================================================
  */
 
-fd_table_t *fd_table_get_global(void)
+static inline int lowest_set_bit(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+static inline int highest_set_bit(uint64_t mask)
 {
-    // Stub: return NULL or a static instance if needed
-    return NULL;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, mask);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(mask);
+#endif
+}
+
+/**
+ * @brief Find the entry for the given FD
+ *
+ * @param table The FD table
+ * @param fd File descriptor to look up
+ * @return The entry, or NULL if the FD is not tracked
+ */
+static fd_entry_t *lookup_entry(const fd_table_t *table, int fd)
+{
+    if (fd < 0 || FD_PAGE(fd) >= table->page_count)
+    {
+        return NULL;
+    }
+    fd_table_page_t *page = table->pages[FD_PAGE(fd)];
+    if (page == NULL || !(page->used & FD_BIT(FD_SLOT(fd))))
+    {
+        return NULL;
+    }
+    return &page->entries[FD_SLOT(fd)];
 }
 
 /**
- * @brief Find the index of an entry with the given FD
+ * @brief The page holding the given FD, allocated if need be
  *
  * @param table The FD table
- * @param fd File descriptor to search for
- * @return Index of the entry, or -1 if not found
+ * @param fd File descriptor number (not negative)
+ * @return The page
  */
-static int find_entry_index(const fd_table_t *table, int fd)
+static fd_table_page_t *ensure_page(fd_table_t *table, int fd)
 {
-    for (size_t i = 0; i < table->count; i++)
+    Expects_not_null(table);
+    size_t index = FD_PAGE(fd);
+
+    if (index >= table->page_count)
     {
-        if (table->entries[i].fd == fd)
+        size_t new_count = table->page_count * GROWTH_FACTOR;
+        if (new_count <= index)
         {
-            return (int)i;
+            new_count = index + 1;
         }
+        table->pages = xrealloc(table->pages, new_count * sizeof(fd_table_page_t *));
+        memset(table->pages + table->page_count, 0,
+               (new_count - table->page_count) * sizeof(fd_table_page_t *));
+        table->page_count = new_count;
     }
-    return -1;
+    if (table->pages[index] == NULL)
+    {
+        table->pages[index] = xcalloc(1, sizeof(fd_table_page_t));
+    }
+    return table->pages[index];
 }
 
 /**
- * @brief Grow the entries array if needed
+ * @brief Start tracking an FD with no entry yet
  *
  * @param table The FD table
- * @return true on success, false on allocation failure
+ * @param fd File descriptor number (not negative)
+ * @return The new entry, with its fields cleared
  */
-static bool ensure_capacity(fd_table_t *table)
+static fd_entry_t *new_entry(fd_table_t *table, int fd)
 {
-    Expects_not_null(table);
-    const int margin = 4; // Minimum free slots to maintain
+    fd_table_page_t *page = ensure_page(table, fd);
+    unsigned slot = FD_SLOT(fd);
 
-    if (table->count + margin < table->capacity)
+    page->used |= FD_BIT(slot);
+    fd_entry_t *entry = &page->entries[slot];
+    memset(entry, 0, sizeof(*entry));
+    entry->fd = fd;
+    entry->original_fd = -1;
+
+    table->count++;
+    if (fd > table->highest_fd)
     {
-        return true;
+        table->highest_fd = fd;
     }
+    return entry;
+}
 
-    size_t new_capacity = table->capacity * GROWTH_FACTOR;
-    fd_entry_t *new_entries = xrealloc(table->entries, new_capacity * sizeof(fd_entry_t));
-    table->entries = new_entries;
-    table->capacity = new_capacity;
-    return true;
+/**
+ * @brief Set an entry's flags and the matching flag bits of its page
+ *
+ * @param table The FD table
+ * @param fd File descriptor number of a tracked entry
+ * @param flags New flags
+ */
+static void set_entry_flags(fd_table_t *table, int fd, fd_flags_t flags)
+{
+    fd_table_page_t *page = table->pages[FD_PAGE(fd)];
+    uint64_t bit = FD_BIT(FD_SLOT(fd));
+
+    page->entries[FD_SLOT(fd)].flags = flags;
+    for (int i = 0; i < FD_TABLE_FLAG_COUNT; i++)
+    {
+        if (flags & (1 << i))
+        {
+            page->flag_bits[i] |= bit;
+        }
+        else
+        {
+            page->flag_bits[i] &= ~bit;
+        }
+    }
 }
 
 /**
- * @brief Clear an FD entry's resources
+ * @brief Bits of a page's FDs that have any of the given flags
  *
- * @param entry The entry to clear
+ * @param page The page
+ * @param flag One or more flags
+ * @return Bit n set for entries[n] having one of them
  */
-static void clear_entry(fd_entry_t *entry)
+static uint64_t page_flag_bits(const fd_table_page_t *page, fd_flags_t flag)
 {
-    // Do not clear or destroy entry->path here; caller is responsible for freeing.
-    entry->fd = -1;
-    entry->original_fd = -1;
-    entry->flags = FD_IS_DEFAULT;
-    entry->is_open = false;
-    entry->padding[0] = 0;
+    uint64_t bits = 0;
+    for (int i = 0; i < FD_TABLE_FLAG_COUNT; i++)
+    {
+        if (flag & (1 << i))
+        {
+            bits |= page->flag_bits[i];
+        }
+    }
+    return bits;
 }
 
 /*
@@ -110,14 +207,14 @@ fd_table_t *fd_table_create(void)
         return NULL;
     }
 
-    table->entries = xmalloc(INITIAL_CAPACITY * sizeof(fd_entry_t));
-    if (table->entries == NULL)
+    table->pages = xcalloc(INITIAL_PAGE_COUNT, sizeof(fd_table_page_t *));
+    if (table->pages == NULL)
     {
         xfree(table);
         return NULL;
     }
 
-    table->capacity = INITIAL_CAPACITY;
+    table->page_count = INITIAL_PAGE_COUNT;
     table->count = 0;
     table->highest_fd = -1;
 
@@ -129,19 +226,26 @@ fd_table_t *fd_table_clone(const fd_table_t *src)
     Expects_not_null(src);
     fd_table_t *table = xmalloc(sizeof(fd_table_t)); // Don't use fd_table_create()
 
-    table->capacity = src->capacity;
+    table->page_count = src->page_count;
     table->count = src->count;
     table->highest_fd = src->highest_fd;
-    table->entries = xcalloc(table->capacity, sizeof(fd_entry_t));
+    table->pages = xcalloc(table->page_count, sizeof(fd_table_page_t *));
 
-    for (size_t i = 0; i < src->count; i++)
+    for (size_t p = 0; p < src->page_count; p++)
     {
-        table->entries[i].fd = src->entries[i].fd;
-        table->entries[i].original_fd = src->entries[i].original_fd;
-        table->entries[i].flags = src->entries[i].flags;
-        table->entries[i].is_open = src->entries[i].is_open;
-        table->entries[i].path =
-            src->entries[i].path ? string_create_from(src->entries[i].path) : NULL;
+        const fd_table_page_t *src_page = src->pages[p];
+        if (src_page == NULL)
+        {
+            continue;
+        }
+        fd_table_page_t *page = xmalloc(sizeof(fd_table_page_t));
+        memcpy(page, src_page, sizeof(fd_table_page_t));
+        for (uint64_t used = page->used; used; used &= used - 1)
+        {
+            fd_entry_t *entry = &page->entries[lowest_set_bit(used)];
+            entry->path = entry->path ? string_create_from(entry->path) : NULL;
+        }
+        table->pages[p] = page;
     }
     return table;
 }
@@ -155,17 +259,26 @@ void fd_table_destroy(fd_table_t **table)
 
     fd_table_t *t = *table;
 
-    /* Clear all entries */
-    for (size_t i = 0; i < t->count; i++)
+    /* Free all pages and the paths of their entries */
+    for (size_t p = 0; p < t->page_count; p++)
     {
-        clear_entry(&t->entries[i]);
-        if (t->entries[i].path)
+        fd_table_page_t *page = t->pages[p];
+        if (page == NULL)
+        {
+            continue;
+        }
+        for (uint64_t used = page->used; used; used &= used - 1)
         {
-            string_destroy(&t->entries[i].path);
+            fd_entry_t *entry = &page->entries[lowest_set_bit(used)];
+            if (entry->path)
+            {
+                string_destroy(&entry->path);
+            }
         }
+        xfree(page);
     }
 
-    xfree(t->entries);
+    xfree(t->pages);
     xfree(t);
     *table = NULL;
 }
@@ -234,17 +347,28 @@ string_t *fd_table_generate_heredoc_name(int target_fd)
 bool fd_table_add(fd_table_t *table, int fd, fd_flags_t flags, const string_t *path)
 {
     Expects_not_null(table);
-    Expects_not_null(path);
+
+    if (fd < 0)
+    {
+        log_warn("fd_table_add: invalid fd=%d", fd);
+        return false;
+    }
 
     /* Check if entry already exists */
-    int idx = find_entry_index(table, fd);
-    if (idx >= 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry != NULL)
     {
         /* Update existing entry */
-        fd_entry_t *entry = &table->entries[idx];
 
-        /* Clear old path if present */
-        if (entry->path != NULL)
+        /* Replace old path if present */
+        if (path == NULL)
+        {
+            if (entry->path != NULL)
+            {
+                string_destroy(&entry->path);
+            }
+        }
+        else if (entry->path != NULL)
         {
             string_set(entry->path, path);
         }
@@ -253,7 +377,7 @@ bool fd_table_add(fd_table_t *table, int fd, fd_flags_t flags, const string_t *p
             entry->path = string_create_from(path);
         }
 
-        entry->flags = flags;
+        set_entry_flags(table, fd, flags);
         entry->is_open = true;
 
         /* IMPORTANT: do NOT touch original_fd here.
@@ -263,31 +387,21 @@ bool fd_table_add(fd_table_t *table, int fd, fd_flags_t flags, const string_t *p
          * the original-fd mapping, leaving the redirected descriptor live
          * forever (Bug 1). */
         char flags_buf[64];
-        log_debug("fd_table_add: fd=%d path='%s' updated flags=%s", fd, string_cstr(path),
+        log_debug("fd_table_add: fd=%d path='%s' updated flags=%s", fd,
+                  path ? string_cstr(path) : "(none)",
                   fd_flags_to_string(flags, flags_buf, sizeof(flags_buf)));
         return true;
     }
 
-    /* Need to add new entry */
-    ensure_capacity(table);
-
     /* Add new entry */
-    fd_entry_t *entry = &table->entries[table->count];
-    entry->fd = fd;
-    entry->original_fd = -1;
-    entry->flags = flags;
-    entry->path = string_create_from(path);
+    entry = new_entry(table, fd);
+    entry->path = path ? string_create_from(path) : NULL;
     entry->is_open = true;
+    set_entry_flags(table, fd, flags);
 
-    table->count++;
-
-    /* Update highest_fd */
-    if (fd > table->highest_fd)
-    {
-        table->highest_fd = fd;
-    }
     char flags_buf2[64];
-    log_debug("fd_table_add: fd=%d path='%s' new entry flags=%s", fd, string_cstr(path),
+    log_debug("fd_table_add: fd=%d path='%s' new entry flags=%s", fd,
+              path ? string_cstr(path) : "(none)",
               fd_flags_to_string(flags, flags_buf2, sizeof(flags_buf2)));
     return true;
 }
@@ -296,35 +410,30 @@ bool fd_table_mark_saved(fd_table_t *table, int saved_fd, int original_fd)
 {
     Expects_not_null(table);
 
+    if (saved_fd < 0)
+    {
+        log_warn("fd_table_mark_saved: invalid fd=%d", saved_fd);
+        return false;
+    }
+
     /* Check if entry exists */
-    int idx = find_entry_index(table, saved_fd);
-    if (idx >= 0)
+    fd_entry_t *entry = lookup_entry(table, saved_fd);
+    if (entry != NULL)
     {
         /* Update existing entry */
-        fd_entry_t *entry = &table->entries[idx];
         entry->original_fd = original_fd;
-        entry->flags = (fd_flags_t)(entry->flags | FD_IS_SAVED);
+        set_entry_flags(table, saved_fd, (fd_flags_t)(entry->flags | FD_IS_SAVED));
         log_debug("fd_table_mark_saved: fd=%d marked as saved copy of fd=%d", saved_fd,
                   original_fd);
         return true;
     }
 
     /* Shouldn't happen, but, create new entry for saved FD */
-    ensure_capacity(table);
-
-    fd_entry_t *entry = &table->entries[table->count];
-    entry->fd = saved_fd;
+    entry = new_entry(table, saved_fd);
     entry->original_fd = original_fd;
-    entry->flags = FD_IS_SAVED;
     entry->path = string_create_from_cstr("(unknown)");
     entry->is_open = true;
-
-    table->count++;
-
-    if (saved_fd > table->highest_fd)
-    {
-        table->highest_fd = saved_fd;
-    }
+    set_entry_flags(table, saved_fd, FD_IS_SAVED);
 
     log_warn("fd_table_mark_saved: untracked fd=%d marked as saved copy of fd=%d", saved_fd,
              original_fd);
@@ -335,13 +444,13 @@ bool fd_table_mark_closed(fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return false;
     }
 
-    table->entries[idx].is_open = false;
+    entry->is_open = false;
     log_debug("fd_table_mark_closed: fd=%d marked as closed", fd);
     return true;
 }
@@ -349,10 +458,10 @@ bool fd_table_mark_closed(fd_table_t *table, int fd)
 bool fd_table_mark_open(fd_table_t *table, int fd)
 {
     Expects_not_null(table);
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
         return false;
-    table->entries[idx].is_open = true;
+    entry->is_open = true;
     log_debug("fd_table_mark_open: fd=%d marked as open", fd);
     return true;
 }
@@ -361,40 +470,37 @@ bool fd_table_remove(fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         log_warn("fd_table_remove: fd=%d not found in table, cannot remove", fd);
         return false;
     }
 
     log_debug("fd_table_remove: fd=%d path='%s' removing entry", fd,
-              string_cstr(table->entries[idx].path));
+              entry->path ? string_cstr(entry->path) : "(none)");
 
     /* Clear entry resources */
-    clear_entry(&table->entries[idx]);
-    if (table->entries[idx].path)
-    {
-        string_destroy(&table->entries[idx].path);
-    }
-
-    /* Move last entry to fill gap */
-    if ((size_t)idx < table->count - 1)
+    if (entry->path)
     {
-        table->entries[idx] = table->entries[table->count - 1];
+        string_destroy(&entry->path);
     }
-
+    set_entry_flags(table, fd, FD_IS_DEFAULT);
+    table->pages[FD_PAGE(fd)]->used &= ~FD_BIT(FD_SLOT(fd));
     table->count--;
 
-    /* Recalculate highest_fd if we removed it */
+    /* Recalculate highest_fd if we removed it: the highest used bit of the
+     * highest page that still has one */
     if (fd == table->highest_fd)
     {
         table->highest_fd = -1;
-        for (size_t i = 0; i < table->count; i++)
+        for (size_t p = FD_PAGE(fd) + 1; p-- > 0;)
         {
-            if (table->entries[i].fd > table->highest_fd)
+            const fd_table_page_t *page = table->pages[p];
+            if (page != NULL && page->used)
             {
-                table->highest_fd = table->entries[i].fd;
+                table->highest_fd = (int)(p * FD_TABLE_PAGE_SIZE) + highest_set_bit(page->used);
+                break;
             }
         }
     }
@@ -412,78 +518,72 @@ fd_entry_t *fd_table_find(fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
-    {
-        return NULL;
-    }
-
-    return &table->entries[idx];
+    return lookup_entry(table, fd);
 }
 
 bool fd_table_is_open(const fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return false;
     }
 
-    return table->entries[idx].is_open;
+    return entry->is_open;
 }
 
 fd_flags_t fd_table_get_flags(const fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return FD_IS_DEFAULT;
     }
 
-    return table->entries[idx].flags;
+    return entry->flags;
 }
 
 bool fd_table_has_flag(const fd_table_t *table, int fd, fd_flags_t flag)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return false;
     }
 
-    return (table->entries[idx].flags & flag) != 0;
+    return (entry->flags & flag) != 0;
 }
 
 int fd_table_get_original(const fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return -1;
     }
 
-    return table->entries[idx].original_fd;
+    return entry->original_fd;
 }
 
 const string_t *fd_table_get_path(const fd_table_t *table, int fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return NULL;
     }
 
-    return table->entries[idx].path;
+    return entry->path;
 }
 
 /*
@@ -496,17 +596,17 @@ bool fd_table_set_flag(fd_table_t *table, int fd, fd_flags_t flag)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return false;
     }
 
-    table->entries[idx].flags = (fd_flags_t)(table->entries[idx].flags | flag);
+    set_entry_flags(table, fd, (fd_flags_t)(entry->flags | flag));
     char flag_buf[64], result_buf[64];
     log_debug("fd_table_set_flag: fd=%d set flag=%s resulting_flags=%s", fd,
               fd_flags_to_string(flag, flag_buf, sizeof(flag_buf)),
-              fd_flags_to_string(table->entries[idx].flags, result_buf, sizeof(result_buf)));
+              fd_flags_to_string(entry->flags, result_buf, sizeof(result_buf)));
     return true;
 }
 
@@ -514,17 +614,17 @@ bool fd_table_clear_flag(fd_table_t *table, int fd, fd_flags_t flag)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, fd);
-    if (idx < 0)
+    fd_entry_t *entry = lookup_entry(table, fd);
+    if (entry == NULL)
     {
         return false;
     }
 
-    table->entries[idx].flags = (fd_flags_t)(table->entries[idx].flags & ~flag);
+    set_entry_flags(table, fd, (fd_flags_t)(entry->flags & ~flag));
     char flag_buf[64], remain_buf[64];
     log_debug("fd_table_clear_flag: fd=%d cleared flag=%s remaining_flags=%s", fd,
               fd_flags_to_string(flag, flag_buf, sizeof(flag_buf)),
-              fd_flags_to_string(table->entries[idx].flags, remain_buf, sizeof(remain_buf)));
+              fd_flags_to_string(entry->flags, remain_buf, sizeof(remain_buf)));
     return true;
 }
 
@@ -541,9 +641,13 @@ int *fd_table_get_fds_with_flag(const fd_table_t *table, fd_flags_t flag, size_t
 
     /* First pass: count matching entries */
     size_t count = 0;
-    for (size_t i = 0; i < table->count; i++)
+    for (size_t p = 0; p < table->page_count; p++)
     {
-        if (table->entries[i].flags & flag)
+        if (table->pages[p] == NULL)
+        {
+            continue;
+        }
+        for (uint64_t bits = page_flag_bits(table->pages[p], flag); bits; bits &= bits - 1)
         {
             count++;
         }
@@ -559,13 +663,17 @@ int *fd_table_get_fds_with_flag(const fd_table_t *table, fd_flags_t flag, size_t
     /* Allocate result array */
     int *fds = xmalloc(count * sizeof(int));
 
-    /* Second pass: fill array */
+    /* Second pass: fill array, in increasing FD order */
     size_t j = 0;
-    for (size_t i = 0; i < table->count; i++)
+    for (size_t p = 0; p < table->page_count; p++)
     {
-        if (table->entries[i].flags & flag)
+        if (table->pages[p] == NULL)
+        {
+            continue;
+        }
+        for (uint64_t bits = page_flag_bits(table->pages[p], flag); bits; bits &= bits - 1)
         {
-            fds[j++] = table->entries[i].fd;
+            fds[j++] = (int)(p * FD_TABLE_PAGE_SIZE) + lowest_set_bit(bits);
         }
     }
 
@@ -577,17 +685,100 @@ int *fd_table_get_saved_fds(const fd_table_t *table, size_t *saved_count)
     return fd_table_get_fds_with_flag(table, FD_IS_SAVED, saved_count);
 }
 
+#ifdef MIGA_POSIX_API
+/**
+ * @brief Close FDs first through last
+ */
+static void close_run(int first, int last)
+{
+#ifdef HAVE_CLOSE_RANGE
+    if (close_range((unsigned)first, (unsigned)last, 0) == 0)
+    {
+        return;
+    }
+#endif
+    for (int fd = first; fd <= last; fd++)
+    {
+        close(fd);
+    }
+}
+
+void fd_table_close_with_flag(const fd_table_t *table, fd_flags_t flag)
+{
+    Expects_not_null(table);
+
+    int first = -1;
+    int last = -1;
+    for (size_t p = 0; p < table->page_count; p++)
+    {
+        if (table->pages[p] == NULL)
+        {
+            continue;
+        }
+        for (uint64_t bits = page_flag_bits(table->pages[p], flag); bits; bits &= bits - 1)
+        {
+            int fd = (int)(p * FD_TABLE_PAGE_SIZE) + lowest_set_bit(bits);
+            if (fd != last + 1 || first < 0)
+            {
+                if (first >= 0)
+                {
+                    close_run(first, last);
+                }
+                first = fd;
+            }
+            last = fd;
+        }
+    }
+    if (first >= 0)
+    {
+        close_run(first, last);
+    }
+}
+
+void fd_table_close_fds(int *fds, size_t count)
+{
+    /* Insertion sort: the lists are a handful of pipe ends */
+    for (size_t i = 1; i < count; i++)
+    {
+        int fd = fds[i];
+        size_t j = i;
+        while (j > 0 && fds[j - 1] > fd)
+        {
+            fds[j] = fds[j - 1];
+            j--;
+        }
+        fds[j] = fd;
+    }
+
+    size_t i = 0;
+    while (i < count && fds[i] < 0)
+    {
+        i++;
+    }
+    while (i < count)
+    {
+        size_t j = i;
+        while (j + 1 < count && fds[j + 1] <= fds[j] + 1)
+        {
+            j++;
+        }
+        close_run(fds[i], fds[j]);
+        i = j + 1;
+    }
+}
+#endif
+
 int fd_table_get_original_fd(const fd_table_t *table, int saved_fd)
 {
     Expects_not_null(table);
 
-    int idx = find_entry_index(table, saved_fd);
-    if (idx < 0)
+    const fd_entry_t *entry = lookup_entry(table, saved_fd);
+    if (entry == NULL)
     {
         return -1;
     }
 
-    return table->entries[idx].original_fd;
+    return entry->original_fd;
 }
 
 size_t fd_table_count(const fd_table_t *table)
@@ -608,17 +799,19 @@ void fd_table_foreach(const fd_table_t *table, fd_table_foreach_cb callback, voi
     Expects_not_null(table);
     Expects_not_null(callback);
 
-    for (size_t i = 0; i < table->count; i++)
+    for (size_t p = 0; p < table->page_count; p++)
     {
-        const fd_entry_t *entry = &table->entries[i];
-
-        /* Skip logically removed / invalid entries if you ever have them */
-        if (entry->fd < 0)
+        const fd_table_page_t *page = table->pages[p];
+        if (page == NULL)
+        {
             continue;
-
-        if (!callback(entry, user_data))
+        }
+        for (uint64_t used = page->used; used; used &= used - 1)
         {
-            break; /* User requested early termination */
+            if (!callback(&page->entries[lowest_set_bit(used)], user_data))
+            {
+                return; /* User requested early termination */
+            }
         }
     }
 }
@@ -6,6 +6,13 @@
  * by the shell, including their flags, origins, and associated paths.
  * It helps manage redirections, close-on-exec behavior, and saved FD copies.
  *
+ * The table is indexed directly by FD number. It is split into pages of
+ * FD_TABLE_PAGE_SIZE consecutive FDs, allocated when first used, so a lookup
+ * is two array accesses and a high FD such as one saved at 10 or above does
+ * not cost memory for the FDs below it. Each page keeps one bit per FD for
+ * "tracked" and one per flag, so the FDs with a given flag are found by
+ * scanning bits rather than entries.
+ *
  * The table grows dynamically as needed and tracks:
  * - Which FDs are open
  * - Which FDs should be closed on exec
@@ -19,6 +26,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "miga/string_t.h"
 
@@ -46,21 +54,36 @@ typedef struct fd_entry_t
     string_t *path; ///< Path if opened from file (NULL otherwise, takes ownership)
 } fd_entry_t;
 
+/** Number of flag bits in fd_flags_t */
+#define FD_TABLE_FLAG_COUNT 3
+
+/** Number of consecutive FDs held by one page of the table */
+#define FD_TABLE_PAGE_SIZE 64
+
+/**
+ * @brief The entries for FD_TABLE_PAGE_SIZE consecutive FD numbers
+ */
+typedef struct fd_table_page_t
+{
+    uint64_t used;                           ///< Bit n set: entries[n] is tracked
+    uint64_t flag_bits[FD_TABLE_FLAG_COUNT]; ///< Bit n of flag_bits[i]: entries[n] has flag 1 << i
+    fd_entry_t entries[FD_TABLE_PAGE_SIZE];  ///< Indexed by fd % FD_TABLE_PAGE_SIZE
+} fd_table_page_t;
+
 /**
- * @brief Dynamic table of file descriptor entries
+ * @brief Table of file descriptor entries, indexed by FD number
  */
 typedef struct fd_table_t
 {
-    fd_entry_t *entries; ///< Dynamic array of FD entries
-    size_t capacity;     ///< Current capacity of array
-    size_t count;        ///< Number of entries in use
-    int highest_fd;      ///< Highest FD number currently tracked
+    fd_table_page_t **pages; ///< Indexed by fd / FD_TABLE_PAGE_SIZE; NULL until used
+    size_t page_count;       ///< Length of the pages array
+    size_t count;            ///< Number of entries in use
+    int highest_fd;          ///< Highest FD number currently tracked
     int padding;
 } fd_table_t;
 
 // Stub declarations for linker errors
 // string_t *fd_table_generate_saved_fd_name(int backup, int fd, fd_flags_t flags);
-// fd_table_t *fd_table_get_global(void);
 
 /*
  * ============================================================================
@@ -121,7 +144,7 @@ string_t *fd_table_generate_heredoc_name(int target_fd);
  * @param table The FD table
  * @param fd File descriptor number
  * @param flags Flags to associate with this FD
- * @param path Path associated with this FD (copies, does not take ownership)
+ * @param path Path associated with this FD (copies, does not take ownership; may be NULL)
  * @return true on success, false on allocation failure
  */
 bool fd_table_add(fd_table_t *table, int fd, fd_flags_t flags, const string_t *path);
@@ -182,6 +205,10 @@ bool fd_table_remove(fd_table_t *table, int fd);
 /**
  * @brief Find an entry in the FD table
  *
+ * Change the entry's flags with fd_table_set_flag() and
+ * fd_table_clear_flag(), not through the returned pointer, so the table's
+ * flag bits stay in step.
+ *
  * @param table The FD table
  * @param fd File descriptor number to find
  * @return Pointer to fd_entry_t if found, NULL otherwise
@@ -286,6 +313,32 @@ int *fd_table_get_fds_with_flag(const fd_table_t *table, fd_flags_t flag, size_t
 
 int *fd_table_get_saved_fds(const fd_table_t *table, size_t *saved_count);
 
+#ifdef MIGA_POSIX_API
+/**
+ * @brief Close every FD that has a specific flag
+ *
+ * Meant for a child process that goes on running shell code instead of
+ * exec'ing, where O_CLOEXEC never takes effect. Each run of consecutive FDs is
+ * closed with one close_range() call where the system has it, and with one
+ * close() per FD otherwise. Allocates nothing and leaves the table as it is.
+ *
+ * @param table The FD table
+ * @param flag Flag to search for
+ */
+void fd_table_close_with_flag(const fd_table_t *table, fd_flags_t flag);
+
+/**
+ * @brief Close a list of FDs
+ *
+ * Sorts @p fds in place, skips negative entries, and closes each run of
+ * consecutive FDs as fd_table_close_with_flag() does.
+ *
+ * @param fds FD numbers
+ * @param count Number of FDs in @p fds
+ */
+void fd_table_close_fds(int *fds, size_t count);
+#endif
+
 int fd_table_get_original_fd(const fd_table_t *table, int saved_fd);
 
 
@@ -309,7 +362,8 @@ int fd_table_get_highest_fd(const fd_table_t *table);
 typedef bool (*fd_table_foreach_cb)(const fd_entry_t *entry, void *user_data);
 
 /**
- * This function applies a callback to each active entry of the fd table.
+ * This function applies a callback to each active entry of the fd table,
+ * in increasing FD order.
  * @param table
  * @param callback
  * @param user_data
@@ -143,7 +143,13 @@ bool frame_has_variable(const miga_frame_t *frame, const string_t *name)
     Expects_not_null(name);
 
     const string_t *value = exec_frame_get_variable(frame, name);
-    return (value != NULL);
+    if (value)
+        return true;
+
+    string_t *dynamic = exec_frame_get_dynamic_param(frame, name);
+    bool has_dynamic = (dynamic != NULL);
+    string_destroy(&dynamic);
+    return has_dynamic;
 }
 
 bool frame_has_variable_cstr(const miga_frame_t *frame, const char *name)
@@ -162,6 +168,10 @@ string_t *frame_get_variable_value(miga_frame_t *frame, const string_t *name)
     Expects_not_null(frame);
     Expects_not_null(name);
 
+    string_t *dynamic = exec_frame_get_dynamic_param(frame, name);
+    if (dynamic)
+        return dynamic;
+
     const string_t *value = exec_frame_get_variable(frame, name);
     if (value)
     {
@@ -278,7 +288,7 @@ miga_var_status_t frame_set_variable(miga_frame_t *frame, const string_t *name,
     Expects_not_null(name);
     Expects_not_null(value);
 
-    variable_store_t *vars = frame->local_variables ? frame->local_variables : frame->variables;
+    variable_store_t *vars = frame->variables;
     if (!vars)
     {
         return MIGA_VAR_STATUS_NOT_FOUND;
@@ -336,7 +346,7 @@ miga_var_status_t frame_set_persistent_variable(miga_frame_t *frame, const strin
     Expects_not_null(name);
     Expects_not_null(value);
 
-    variable_store_t *vars = frame->saved_variables ? frame->saved_variables : frame->variables;
+    variable_store_t *vars = frame->variables;
     if (!vars)
     {
         return MIGA_VAR_STATUS_NOT_FOUND;
@@ -387,6 +397,32 @@ miga_var_status_t frame_set_persistent_variable_cstr(miga_frame_t *frame, const
     return result;
 }
 
+miga_var_status_t frame_declare_local_variable(miga_frame_t *frame, const string_t *name,
+                                               const string_t *value)
+{
+    Expects_not_null(frame);
+    Expects_not_null(name);
+
+    if (string_empty(name))
+        return MIGA_VAR_STATUS_EMPTY_NAME;
+    for (int i = 0; i < string_length(name); i++)
+    {
+        char c = string_at(name, i);
+        bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        if (!alpha && (i == 0 || c < '0' || c > '9'))
+            return MIGA_VAR_STATUS_INVALID_NAME;
+    }
+
+    const miga_frame_t *function = frame;
+    while (function && !function->policy->variables.has_locals)
+        function = function->parent;
+    if (!function)
+        return MIGA_VAR_STATUS_NOT_FOUND;
+    if (exec_frame_declare_local(frame, name, value) != 0)
+        return MIGA_VAR_STATUS_READ_ONLY;
+    return MIGA_VAR_STATUS_OK;
+}
+
 miga_var_status_t frame_set_variable_exported(miga_frame_t *frame, const string_t *name,
                                               bool exported)
 {
@@ -473,10 +509,13 @@ miga_export_status_t frame_export_variable(miga_frame_t *frame, const string_t *
     }
     else if (!exists)
     {
-        /* If value is NULL and variable doesn't exist, create with empty value */
-        string_t *empty = string_create();
-        miga_var_status_t set_result = frame_set_variable(frame, name, empty);
-        string_destroy(&empty);
+        /* If value is NULL and variable doesn't exist, create it. A dynamic
+         * parameter such as LINENO is materialized with its current value. */
+        string_t *initial = exec_frame_get_dynamic_param(frame, name);
+        if (!initial)
+            initial = string_create();
+        miga_var_status_t set_result = frame_set_variable(frame, name, initial);
+        string_destroy(&initial);
         if (set_result != MIGA_VAR_STATUS_OK)
         {
             return MIGA_EXPORT_STATUS_SYSTEM_ERROR;
@@ -548,7 +587,7 @@ miga_var_status_t frame_unset_variable(miga_frame_t *frame, const string_t *name
     Expects_not_null(frame);
     Expects_not_null(name);
 
-    variable_store_t *vars = frame->local_variables ? frame->local_variables : frame->variables;
+    variable_store_t *vars = frame->variables;
     if (!vars)
     {
         return MIGA_VAR_STATUS_NOT_FOUND;
@@ -925,6 +964,7 @@ void frame_shift_positional_params(miga_frame_t *frame, int shift_count)
         return;
     }
 
+    exec_frame_unshare_positional_params(frame);
     positional_params_shift(frame->positional_params, shift_count);
 }
 
@@ -949,7 +989,13 @@ void frame_replace_positional_params(miga_frame_t *frame, const strlist_t *new_p
         }
     }
 
-    positional_params_replace(frame->positional_params, params, count);
+    exec_frame_unshare_positional_params(frame);
+    if (!positional_params_replace(frame->positional_params, params, count))
+    {
+        for (int i = 0; i < count; i++)
+            string_destroy(&params[i]);
+        xfree(params);
+    }
 }
 
 void frame_set_arg0(miga_frame_t *frame, const string_t *new_arg0)
@@ -961,6 +1007,7 @@ void frame_set_arg0(miga_frame_t *frame, const string_t *new_arg0)
         return;
     }
 
+    exec_frame_unshare_positional_params(frame);
     positional_params_set_arg0(frame->positional_params, new_arg0);
 }
 
@@ -972,6 +1019,7 @@ void frame_set_arg0_cstr(miga_frame_t *frame, const char *new_arg0)
         return;
     }
     string_t *new_arg0_str = string_create_from_cstr(new_arg0);
+    exec_frame_unshare_positional_params(frame);
     positional_params_set_arg0(frame->positional_params, new_arg0_str);
     string_destroy(&new_arg0_str);
 }
@@ -1060,6 +1108,8 @@ bool frame_has_named_option(const miga_frame_t *frame, const string_t *option_na
         return true;
     if (strcmp(name, "pipefail") == 0)
         return true;
+    if (strcmp(name, "profile") == 0)
+        return true;
     if (strcmp(name, "verbose") == 0 || strcmp(name, "v") == 0)
         return true;
     if (strcmp(name, "vi") == 0)
@@ -1110,6 +1160,8 @@ bool frame_get_named_option(const miga_frame_t *frame, const string_t *option_na
         return opts->nounset;
     if (strcmp(name, "pipefail") == 0)
         return opts->pipefail;
+    if (strcmp(name, "profile") == 0)
+        return exec_is_profiling(frame->executor);
     if (strcmp(name, "verbose") == 0 || strcmp(name, "v") == 0)
         return opts->verbose;
     if (strcmp(name, "vi") == 0)
@@ -1187,6 +1239,15 @@ bool frame_set_named_option(miga_frame_t *frame, const string_t *option_name, bo
         opts->pipefail = value;
         return true;
     }
+    if (strcmp(name, "profile") == 0)
+    {
+        /* Profiling belongs to the executor (the process), not the frame */
+        if (value)
+            exec_start_profile(frame->executor, NULL);
+        else
+            exec_stop_profile(frame->executor);
+        return true;
+    }
     if (strcmp(name, "verbose") == 0 || strcmp(name, "v") == 0)
     {
         opts->verbose = value;
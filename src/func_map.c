@@ -12,6 +12,38 @@
 
 #define FUNC_MAP_INITIAL_CAPACITY 16
 
+/* ============================================================================
+ * Function bodies
+ * ============================================================================ */
+
+func_body_t *func_body_create(ast_node_t *ast)
+{
+    func_body_t *body = xmalloc(sizeof(func_body_t));
+    body->ast = ast;
+    atomic_init(&body->refcount, 1);
+    return body;
+}
+
+func_body_t *func_body_ref(func_body_t *body)
+{
+    atomic_fetch_add_explicit(&body->refcount, 1, memory_order_relaxed);
+    return body;
+}
+
+void func_body_release(func_body_t **body)
+{
+    if (!body || !*body)
+        return;
+
+    func_body_t *b = *body;
+    *body = NULL;
+    if (atomic_fetch_sub_explicit(&b->refcount, 1, memory_order_acq_rel) != 1)
+        return;
+
+    ast_node_destroy(&b->ast);
+    xfree(b);
+}
+
 /* ============================================================================
  * Internal helpers
  * ============================================================================ */
@@ -39,9 +71,9 @@ static void destroy_entry(func_map_entry_t *entry)
         {
             string_destroy(&entry->mapped.name);
         }
-        if (entry->mapped.func)
+        if (entry->mapped.body)
         {
-            ast_node_destroy(&entry->mapped.func);
+            func_body_release(&entry->mapped.body);
         }
         if (entry->mapped.redirections)
         {
@@ -216,9 +248,9 @@ int32_t func_map_insert_or_assign_move(func_map_t *map, const string_t *key,
             {
                 string_destroy(&map->entries[pos].mapped.name);
             }
-            if (map->entries[pos].mapped.func)
+            if (map->entries[pos].mapped.body)
             {
-                ast_node_destroy(&map->entries[pos].mapped.func);
+                func_body_release(&map->entries[pos].mapped.body);
             }
             if (map->entries[pos].mapped.redirections)
             {
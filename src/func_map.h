@@ -7,6 +7,7 @@
 
 #include "ast.h"
 #include "miga/string_t.h"
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -22,12 +23,26 @@ typedef struct exec_redirections_t exec_redirections_t;
  * This is an INTERNAL header. External code must use func_store.h.
  */
 
+/**
+ * Reference-counted function body.
+ *
+ * Cloning a store shares bodies instead of deep-copying the AST, so
+ * subshells and executors cloned from a snapshot reuse one tree. The
+ * AST is never modified once stored; the count is atomic because
+ * executors that share bodies may run on different threads.
+ */
+typedef struct func_body_t
+{
+    ast_node_t *ast;
+    atomic_int refcount;
+} func_body_t;
+
 /**
  * Mapped value stored for each function
  */
 typedef struct func_map_mapped_t
 {
-    ast_node_t *func; // Function body (AST node, typically AST_FUNCTION_DEF)
+    func_body_t *body; // Function body (AST node, typically AST_FUNCTION_DEF)
     string_t *name;   // Function name (copy stored here for convenience)
     exec_redirections_t
         *redirections; // Redirections to apply when function is invoked (may be NULL)
@@ -62,6 +77,27 @@ typedef struct func_map_insert_result_t
     bool success; // True if new key was inserted, false if key already existed
 } func_map_insert_result_t;
 
+/* ============================================================================
+ * Function bodies
+ * ============================================================================ */
+
+/**
+ * Wrap an AST in a new body with a reference count of one.
+ * Takes ownership of the AST.
+ */
+func_body_t *func_body_create(ast_node_t *ast);
+
+/**
+ * Add a reference to a body and return it.
+ */
+func_body_t *func_body_ref(func_body_t *body);
+
+/**
+ * Drop a reference; the body and its AST are freed with the last one.
+ * Sets *body to NULL.
+ */
+void func_body_release(func_body_t **body);
+
 /* ============================================================================
  * Lifecycle
  * ============================================================================ */
@@ -13,6 +13,7 @@
 #include "logging.h"
 #include "miga/string_t.h"
 #include "miga/xalloc.h"
+#include "store_generation.h"
 
 // Simple POSIX-like identifier validator: [A-Za-z_][A-Za-z0-9_]*
 static bool is_valid_name_cstr(const char *s)
@@ -44,6 +45,7 @@ func_store_t *func_store_create(void)
 {
     func_store_t *store = xcalloc(1, sizeof(func_store_t));
     store->map = func_map_create();
+    store->generation = store_generation_next();
     return store;
 }
 
@@ -57,8 +59,13 @@ static void clone_callback(const string_t *key, const func_map_mapped_t *mapped,
 {
     clone_ctx_t *ctx = user_data;
 
-    /* func_store_add_ex deep-copies everything internally */
-    func_store_add_ex(ctx->dst, key, mapped->func, mapped->redirections);
+    /* Bodies are immutable once stored, so the clone shares them */
+    func_map_mapped_t copy;
+    copy.name = string_create_from(mapped->name);
+    copy.body = func_body_ref(mapped->body);
+    copy.redirections = mapped->redirections ? exec_redirections_clone(mapped->redirections) : NULL;
+
+    func_map_insert_or_assign_move(ctx->dst->map, key, &copy);
 }
 
 func_store_t *func_store_clone(const func_store_t *other)
@@ -76,6 +83,43 @@ func_store_t *func_store_clone(const func_store_t *other)
     return new_store;
 }
 
+static void clone_detached_callback(const string_t *key, const func_map_mapped_t *mapped,
+                                    void *user_data)
+{
+    clone_ctx_t *ctx = user_data;
+
+    /* func_store_add_ex deep-copies everything internally */
+    func_store_add_ex(ctx->dst, key, mapped->body->ast, mapped->redirections);
+}
+
+func_store_t *func_store_clone_detached(const func_store_t *other)
+{
+    if (!other || !other->map)
+        return NULL;
+
+    func_store_t *new_store = func_store_create();
+    clone_ctx_t ctx = {.dst = new_store};
+    func_map_foreach(other->map, clone_detached_callback, &ctx);
+
+    return new_store;
+}
+
+static void fill_hashes_callback(const string_t *key, const func_map_mapped_t *mapped,
+                                 void *user_data)
+{
+    (void)key;
+    (void)user_data;
+    ast_node_fill_hashes(mapped->body->ast);
+}
+
+void func_store_fill_hashes(const func_store_t *store)
+{
+    if (!store || !store->map)
+        return;
+
+    func_map_foreach(store->map, fill_hashes_callback, NULL);
+}
+
 void func_store_destroy(func_store_t **store)
 {
     if (!store || !*store)
@@ -92,6 +136,7 @@ void func_store_clear(func_store_t *store)
         return;
 
     func_map_clear(store->map);
+    store->generation = store_generation_next();
 }
 
 func_store_error_t func_store_add(func_store_t *store, const string_t *name,
@@ -114,10 +159,11 @@ func_store_error_t func_store_add(func_store_t *store, const string_t *name,
 
     func_map_mapped_t mapped;
     mapped.name = string_create_from(name);
-    mapped.func = ast_node_clone(value);
+    mapped.body = func_body_create(ast_node_clone(value));
     mapped.redirections = NULL;
 
     func_map_insert_or_assign_move(store->map, name, &mapped);
+    store->generation = store_generation_next();
 
     return FUNC_STORE_ERROR_NONE;
 }
@@ -147,6 +193,7 @@ func_store_error_t func_store_remove(func_store_t *store, const string_t *name)
         return FUNC_STORE_ERROR_NOT_FOUND;
 
     func_map_erase(store->map, name);
+    store->generation = store_generation_next();
     return FUNC_STORE_ERROR_NONE;
 }
 
@@ -191,7 +238,7 @@ const ast_node_t *func_store_get_def(const func_store_t *store, const string_t *
     if (!mapped)
         return NULL;
 
-    return mapped->func;
+    return mapped->body->ast;
 }
 
 const ast_node_t *func_store_get_def_cstr(const func_store_t *store, const char *name)
@@ -259,10 +306,11 @@ func_store_insert_result_t func_store_add_ex(func_store_t *store, const string_t
 
     func_map_mapped_t mapped;
     mapped.name = string_create_from(name);
-    mapped.func = ast_node_clone(value);
+    mapped.body = func_body_create(ast_node_clone(value));
     mapped.redirections = redirections ? exec_redirections_clone(redirections) : NULL;
 
     func_map_insert_or_assign_move(store->map, name, &mapped);
+    store->generation = store_generation_next();
 
     result.error = FUNC_STORE_ERROR_NONE;
     return result;
@@ -284,7 +332,7 @@ static void func_store_foreach_wrapper(const string_t *key, const func_map_mappe
     func_store_foreach_context_t *ctx = (func_store_foreach_context_t *)user_data;
     if (ctx && ctx->user_callback && mapped)
     {
-        ctx->user_callback(key, mapped->func, ctx->user_data);
+        ctx->user_callback(key, mapped->body->ast, ctx->user_data);
     }
 }
 
@@ -5,6 +5,7 @@
 #include "miga/string_t.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * @file func_store.h
@@ -39,6 +40,8 @@ typedef struct func_store_t
 {
     /** Internal map. Do not access directly. */
     func_map_t *map;
+    /** Changes whenever the store does; never shared with another store. */
+    uint32_t generation;
 } func_store_t;
 
 /**
@@ -78,14 +81,33 @@ typedef struct func_store_insert_result_t
 func_store_t *func_store_create(void);
 
 /**
- * Create a deep copy of a function store.
- * The returned store is fully independent (no shared pointers).
+ * Create a copy of a function store.
+ * Function bodies are immutable and reference-counted, so the copy shares
+ * them with the original; names and redirections are deep-copied. Adding,
+ * replacing or removing a function in either store does not affect the other.
  *
  * @param other Source function store (must not be NULL).
  * @return Newly allocated clone, or NULL on failure.
  */
 func_store_t *func_store_clone(const func_store_t *other);
 
+/**
+ * Create a fully independent deep copy of a function store, bodies included.
+ * Use it for a copy that must outlive the arena the original was allocated
+ * from, such as an executor snapshot.
+ *
+ * @param other Source function store (must not be NULL).
+ * @return Newly allocated copy, or NULL on failure.
+ */
+func_store_t *func_store_clone_detached(const func_store_t *other);
+
+/**
+ * Compute and cache the hashes of every string in every function body, so
+ * that executing the bodies never writes to them.  Needed before bodies are
+ * shared between threads.
+ */
+void func_store_fill_hashes(const func_store_t *store);
+
 /**
  * Destroy a function store and free all resources.
  *
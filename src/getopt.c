@@ -173,13 +173,41 @@ static const char *skip_optstring_prefix(const char *optstring)
  * Long option processing
  * ============================================================================ */
 
+/* Long option tables come in two layouts: struct option for the GNU entry
+ * points and struct option_ex for the plus-aware ones. Copy entry `idx` into
+ * *out, returning 0 at the terminator. An option_ex table may hold short-only
+ * entries with a NULL name, so only an entry with no name, flag or val ends it. */
+static int longopt_at(const void *longopts, int plus_aware, int idx, struct option *out)
+{
+    if (!longopts)
+        return 0;
+
+    if (plus_aware)
+    {
+        const struct option_ex *e = (const struct option_ex *)longopts + idx;
+        if (!e->name && !e->flag && e->val == 0)
+            return 0;
+        out->name = e->name;
+        out->has_arg = e->has_arg;
+        out->flag = e->flag;
+        out->val = e->val;
+        return 1;
+    }
+
+    const struct option *o = (const struct option *)longopts + idx;
+    if (!o->name)
+        return 0;
+    *out = *o;
+    return 1;
+}
+
 static int process_long_option(int argc, char **argv, const char *optstring,
-                               const struct option *longopts, int *longind, int long_only,
+                               const void *longopts, int *longind, int long_only,
                                struct getopt_state *st, const char *prefix, int plus_aware)
 {
     char *nameend;
     size_t namelen;
-    const struct option *p;
+    struct option opt;
     const struct option *pfound = NULL;
     int option_index = -1;
 
@@ -189,12 +217,11 @@ static int process_long_option(int argc, char **argv, const char *optstring,
 
     /* Exact match search */
     {
-        int idx = 0;
-        for (p = longopts; p && p->name; ++p, ++idx)
+        for (int idx = 0; longopt_at(longopts, plus_aware, idx, &opt); ++idx)
         {
-            if (strlen(p->name) == namelen && strncmp(p->name, st->__nextchar, namelen) == 0)
+            if (opt.name && strlen(opt.name) == namelen &&
+                strncmp(opt.name, st->__nextchar, namelen) == 0)
             {
-                pfound = p;
                 option_index = idx;
                 break;
             }
@@ -202,24 +229,21 @@ static int process_long_option(int argc, char **argv, const char *optstring,
     }
 
     /* Prefix match / ambiguity check */
-    if (!pfound)
+    if (option_index < 0)
     {
-        int idx = 0, matches = 0, exact = 0;
-        const struct option *candidate = NULL;
-        for (p = longopts; p && p->name; ++p, ++idx)
+        int matches = 0, exact = 0;
+        for (int idx = 0; longopt_at(longopts, plus_aware, idx, &opt); ++idx)
         {
-            if (strncmp(p->name, st->__nextchar, namelen) == 0)
+            if (opt.name && strncmp(opt.name, st->__nextchar, namelen) == 0)
             {
                 ++matches;
-                if (strlen(p->name) == namelen)
+                if (strlen(opt.name) == namelen)
                 {
                     ++exact;
-                    candidate = p;
                     option_index = idx;
                 }
-                else if (!candidate)
+                else if (option_index < 0)
                 {
-                    candidate = p;
                     option_index = idx;
                 }
             }
@@ -234,7 +258,12 @@ static int process_long_option(int argc, char **argv, const char *optstring,
             st->optopt = 0;
             return '?';
         }
-        pfound = candidate;
+    }
+
+    if (option_index >= 0)
+    {
+        longopt_at(longopts, plus_aware, option_index, &opt);
+        pfound = &opt;
     }
 
     /* Not found */
@@ -294,7 +323,7 @@ static int process_long_option(int argc, char **argv, const char *optstring,
     {
         if (plus_aware)
         {
-            const struct option_ex *pex = (const struct option_ex *)pfound;
+            const struct option_ex *pex = (const struct option_ex *)longopts + option_index;
             if (st->opt_plus_prefix)
             {
                 *pex->flag = 0;
@@ -432,7 +461,7 @@ static int handle_plus_aware_short(char c, int is_plus, const struct option_ex *
  * ============================================================================ */
 
 static int handle_W_long_option(int argc, char **argv, const char *optstring, char c,
-                                const struct option *longopts, int *longind,
+                                const void *longopts, int *longind,
                                 struct getopt_state *st, int plus_aware)
 {
     if (*st->__nextchar)
@@ -588,14 +617,14 @@ static int _getopt_internal_r(int argc, char *const argv[], const char *optstrin
             st->opt_plus_prefix = 0;
             st->__nextchar = (char *)(arg + 2);
             return process_long_option(argc, (char **)argv, optstring,
-                                       (const struct option *)longopts, longind, long_only, st,
+                                       longopts_void, longind, long_only, st,
                                        "--", plus_aware);
 
         case OPT_LONG_PLUS:
             st->opt_plus_prefix = 1;
             st->__nextchar = (char *)(arg + 2);
             return process_long_option(argc, (char **)argv, optstring,
-                                       (const struct option *)longopts, longind, long_only, st,
+                                       longopts_void, longind, long_only, st,
                                        "++", plus_aware);
 
         case OPT_SHORT:
@@ -626,7 +655,7 @@ static int _getopt_internal_r(int argc, char *const argv[], const char *optstrin
     if (temp[0] == 'W' && temp[1] == ';' && longopts)
     {
         return handle_W_long_option(argc, (char **)argv, optstring, c,
-                                    (const struct option *)longopts, longind, st, plus_aware);
+                                    longopts_void, longind, st, plus_aware);
     }
 
     /* Process argument if required */
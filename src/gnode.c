@@ -149,11 +149,11 @@ gnode_payload_t gnode_get_payload_type(gnode_type_t type)
         return GNODE_PAYLOAD_TOKEN;
 
     /* String wrappers */
-    case G_FNAME:
     case G_HERE_END:
         return GNODE_PAYLOAD_STRING;
 
-    /* G_FILENAME actually stores a token, not a string */
+    /* G_FNAME and G_FILENAME actually store a token, not a string */
+    case G_FNAME:
     case G_FILENAME:
         return GNODE_PAYLOAD_TOKEN;
 
@@ -0,0 +1,769 @@
+// ============================================================================
+// history.c
+// Command history: an append-only log, mapped into memory and indexed
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef MIGA_POSIX_API
+#define _POSIX_C_SOURCE 202405L
+#endif
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MIGA_POSIX_API
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "history.h"
+
+#include "logging.h"
+#include "miga/string_t.h"
+#include "miga/xalloc.h"
+
+// First bytes of an index file
+static const char history_idx_magic[8] = {'M', 'G', 'H', 'I', 'S', 'T', '1', '\n'};
+
+#define HISTORY_IDX_HEADER ((uint64_t)sizeof(history_idx_magic))
+
+typedef struct history_postings_t
+{
+    uint32_t key;      // Trigram + 1; 0 for an empty slot
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t *entries; // Entries containing the trigram, ascending
+} history_postings_t;
+
+struct history_t
+{
+    // The log and the offset of each entry in it, either mapped from the
+    // history file or held in the heap buffers below
+    const char *log;
+    uint64_t log_len;
+    const uint64_t *offsets;
+    long count;
+
+    // History file. It is opened and locked only to open the history or
+    // append to it; between those, the mappings are all that is used.
+    char *path;
+    void *log_map;
+    size_t log_map_len;
+    void *idx_map;
+    size_t idx_map_len;
+    // Read-only descriptors of the files the mappings were made from, kept so
+    // that a read can check the sizes without opening anything; -1 if unmapped
+    int map_log_fd;
+    int map_idx_fd;
+
+    // History without a file
+    char *mem_log;
+    uint64_t mem_log_capacity;
+    uint64_t *mem_offsets;
+    long mem_offsets_capacity;
+
+    // Trigram index, built by the first search that can use it
+    history_postings_t *trigrams; // Open addressing on the key
+    uint32_t trigram_capacity;    // Power of two, or 0 before building
+    uint32_t trigram_used;
+    long trigram_entries;         // Entries [0, trigram_entries) are indexed
+};
+
+// ============================================================================
+// Entries
+// ============================================================================
+
+// Bytes of entry `n` in the log, as stored (newlines written as NUL)
+static const char *history_entry(const history_t *hist, long n, uint64_t *len)
+{
+    uint64_t start = hist->offsets[n];
+    const char *entry = hist->log + start;
+    const char *end = memchr(entry, '\n', hist->log_len - start);
+    *len = end ? (uint64_t)(end - entry) : hist->log_len - start;
+    return entry;
+}
+
+// `text` as stored in the log, without the line terminator
+static char *history_encode(const char *text, uint64_t *len)
+{
+    *len = strlen(text);
+    char *out = xmalloc(*len + 1);
+    for (uint64_t i = 0; i < *len; i++)
+        out[i] = text[i] == '\n' ? '\0' : text[i];
+    out[*len] = '\n';
+    return out;
+}
+
+static bool history_contains(const char *hay, uint64_t hay_len, const char *needle,
+                             uint64_t needle_len)
+{
+    if (needle_len > hay_len)
+        return false;
+    const char *end = hay + (hay_len - needle_len) + 1;
+    for (const char *p = hay; p < end; p++)
+    {
+        p = memchr(p, needle[0], end - p);
+        if (!p)
+            return false;
+        if (memcmp(p, needle, needle_len) == 0)
+            return true;
+    }
+    return false;
+}
+
+// ============================================================================
+// Trigram Index
+// ============================================================================
+
+static uint32_t history_trigram_slot(uint32_t key, uint32_t capacity)
+{
+    uint32_t h = key;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6dU;
+    h ^= h >> 12;
+    return h & (capacity - 1);
+}
+
+static void history_trigrams_clear(history_t *hist)
+{
+    for (uint32_t i = 0; i < hist->trigram_capacity; i++)
+        xfree(hist->trigrams[i].entries);
+    xfree(hist->trigrams);
+    hist->trigrams = NULL;
+    hist->trigram_capacity = 0;
+    hist->trigram_used = 0;
+    hist->trigram_entries = 0;
+}
+
+static void history_trigrams_grow(history_t *hist)
+{
+    uint32_t old_capacity = hist->trigram_capacity;
+    history_postings_t *old = hist->trigrams;
+
+    hist->trigram_capacity = old_capacity ? old_capacity * 2 : 4096;
+    hist->trigrams = xcalloc(hist->trigram_capacity, sizeof(history_postings_t));
+    for (uint32_t i = 0; i < old_capacity; i++)
+    {
+        if (!old[i].key)
+            continue;
+        uint32_t slot = history_trigram_slot(old[i].key, hist->trigram_capacity);
+        while (hist->trigrams[slot].key)
+            slot = (slot + 1) & (hist->trigram_capacity - 1);
+        hist->trigrams[slot] = old[i];
+    }
+    xfree(old);
+}
+
+// The postings for `key`, added if `create` is set
+static history_postings_t *history_trigram_find(history_t *hist, uint32_t key, bool create)
+{
+    if (create && (hist->trigram_used + 1) * 4 >= hist->trigram_capacity * 3)
+        history_trigrams_grow(hist);
+    if (!hist->trigram_capacity)
+        return NULL;
+
+    uint32_t slot = history_trigram_slot(key, hist->trigram_capacity);
+    while (hist->trigrams[slot].key)
+    {
+        if (hist->trigrams[slot].key == key)
+            return &hist->trigrams[slot];
+        slot = (slot + 1) & (hist->trigram_capacity - 1);
+    }
+    if (!create)
+        return NULL;
+    hist->trigrams[slot].key = key;
+    hist->trigram_used++;
+    return &hist->trigrams[slot];
+}
+
+static uint32_t history_trigram_key(const char *p)
+{
+    return (((uint32_t)(unsigned char)p[0] << 16) | ((uint32_t)(unsigned char)p[1] << 8) |
+            (uint32_t)(unsigned char)p[2]) +
+           1;
+}
+
+// Add the entries not indexed yet
+static void history_trigrams_update(history_t *hist)
+{
+    for (long n = hist->trigram_entries; n < hist->count; n++)
+    {
+        uint64_t len;
+        const char *entry = history_entry(hist, n, &len);
+        for (uint64_t i = 0; i + 3 <= len; i++)
+        {
+            history_postings_t *p = history_trigram_find(hist, history_trigram_key(entry + i), true);
+            if (p->count && p->entries[p->count - 1] == (uint32_t)n)
+                continue;
+            if (p->count == p->capacity)
+            {
+                p->capacity = p->capacity ? p->capacity * 2 : 4;
+                p->entries = xrealloc(p->entries, p->capacity * sizeof(uint32_t));
+            }
+            p->entries[p->count++] = (uint32_t)n;
+        }
+    }
+    hist->trigram_entries = hist->count;
+}
+
+// ============================================================================
+// History File
+// ============================================================================
+
+#ifdef MIGA_POSIX_API
+
+static void history_unmap(history_t *hist)
+{
+    if (hist->log_map)
+        munmap(hist->log_map, hist->log_map_len);
+    if (hist->idx_map)
+        munmap(hist->idx_map, hist->idx_map_len);
+    if (hist->map_log_fd >= 0)
+        close(hist->map_log_fd);
+    if (hist->map_idx_fd >= 0)
+        close(hist->map_idx_fd);
+    hist->map_log_fd = -1;
+    hist->map_idx_fd = -1;
+    hist->log_map = NULL;
+    hist->log_map_len = 0;
+    hist->idx_map = NULL;
+    hist->idx_map_len = 0;
+    hist->log = NULL;
+    hist->log_len = 0;
+    hist->offsets = NULL;
+    hist->count = 0;
+}
+
+static void *history_map_fd(int fd, size_t len)
+{
+    if (len == 0)
+        return NULL;
+    void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    return map == MAP_FAILED ? NULL : map;
+}
+
+static bool history_write_at(int fd, const void *buf, uint64_t len, uint64_t offset)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (uint64_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool history_append_fd(int fd, const void *buf, uint64_t len)
+{
+    const char *p = buf;
+    while (len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (uint64_t)n;
+    }
+    return true;
+}
+
+static bool history_lock(int fd, short type)
+{
+    struct flock lock = {0};
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &lock) < 0)
+    {
+        if (errno != EINTR)
+            return false;
+    }
+    return true;
+}
+
+// Whether the index file describes the log: it starts with the header, and
+// its last offset starts a line of the log
+static bool history_idx_valid(int idx_fd, uint64_t idx_size, const char *log, uint64_t log_len)
+{
+    if (idx_size < HISTORY_IDX_HEADER || (idx_size - HISTORY_IDX_HEADER) % sizeof(uint64_t))
+        return false;
+    char header[sizeof(history_idx_magic)];
+    if (pread(idx_fd, header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header, history_idx_magic, sizeof(header)) != 0)
+        return false;
+    if (idx_size == HISTORY_IDX_HEADER)
+        return true;
+
+    uint64_t last;
+    if (pread(idx_fd, &last, sizeof(last), (off_t)(idx_size - sizeof(last))) !=
+        (ssize_t)sizeof(last))
+        return false;
+    return last < log_len && (last == 0 || log[last - 1] == '\n');
+}
+
+// PATH.idx, allocated
+static char *history_idx_path(const history_t *hist, const char *suffix)
+{
+    size_t path_len = strlen(hist->path);
+    size_t suffix_len = strlen(suffix);
+    char *idx_path = xmalloc(path_len + sizeof(".idx") + suffix_len);
+    memcpy(idx_path, hist->path, path_len);
+    memcpy(idx_path + path_len, ".idx", sizeof(".idx") - 1);
+    memcpy(idx_path + path_len + sizeof(".idx") - 1, suffix, suffix_len + 1);
+    return idx_path;
+}
+
+// Map both files, first bringing the index up to date with the log. The
+// caller holds the lock.
+//
+// Other shells may have the index mapped, so it is never truncated: a new
+// one is written to a temporary file and renamed over it, and `*idx_fd` is
+// replaced by the new file.
+static bool history_sync_locked(history_t *hist, int log_fd, int *idx_fd)
+{
+    history_unmap(hist);
+
+    struct stat st;
+    if (fstat(log_fd, &st) < 0)
+        return false;
+    uint64_t log_len = (uint64_t)st.st_size;
+    char *log = history_map_fd(log_fd, log_len);
+    if (log_len && !log)
+        return false;
+    hist->log_map = log;
+    hist->log_map_len = log_len;
+    hist->log = log;
+    hist->log_len = log_len;
+    hist->map_log_fd = fcntl(log_fd, F_DUPFD_CLOEXEC, 0);
+    if (hist->map_log_fd < 0)
+        return false;
+
+    if (fstat(*idx_fd, &st) < 0)
+        return false;
+    uint64_t idx_size = (uint64_t)st.st_size;
+    char *tmp_path = NULL;
+    if (!history_idx_valid(*idx_fd, idx_size, log, log_len))
+    {
+        if (idx_size)
+            log_debug("history: rebuilding index of %s", hist->path);
+        history_trigrams_clear(hist);
+        tmp_path = history_idx_path(hist, ".XXXXXX");
+        int tmp_fd = mkstemp(tmp_path);
+        if (tmp_fd < 0)
+        {
+            xfree(tmp_path);
+            return false;
+        }
+        close(*idx_fd);
+        *idx_fd = tmp_fd;
+        if (fcntl(tmp_fd, F_SETFD, FD_CLOEXEC) < 0 ||
+            !history_write_at(tmp_fd, history_idx_magic, HISTORY_IDX_HEADER, 0))
+            goto fail;
+        idx_size = HISTORY_IDX_HEADER;
+    }
+
+    // Index the complete lines after the last indexed entry. Normally there
+    // are none: every writer indexes its own entries.
+    uint64_t start = 0;
+    if (idx_size > HISTORY_IDX_HEADER)
+    {
+        uint64_t last;
+        if (pread(*idx_fd, &last, sizeof(last), (off_t)(idx_size - sizeof(last))) !=
+            (ssize_t)sizeof(last))
+            return false;
+        const char *end = memchr(log + last, '\n', log_len - last);
+        start = end ? (uint64_t)(end - log) + 1 : log_len;
+    }
+    uint64_t batch[512];
+    int batched = 0;
+    while (start < log_len)
+    {
+        const char *end = memchr(log + start, '\n', log_len - start);
+        if (!end)
+            break;
+        batch[batched++] = start;
+        start = (uint64_t)(end - log) + 1;
+        if (batched == 512)
+        {
+            if (!history_write_at(*idx_fd, batch, batched * sizeof(uint64_t), idx_size))
+                goto fail;
+            idx_size += batched * sizeof(uint64_t);
+            batched = 0;
+        }
+    }
+    if (batched && !history_write_at(*idx_fd, batch, batched * sizeof(uint64_t), idx_size))
+        goto fail;
+    idx_size += batched * sizeof(uint64_t);
+
+    if (tmp_path)
+    {
+        char *idx_path = history_idx_path(hist, "");
+        bool renamed = rename(tmp_path, idx_path) == 0;
+        xfree(idx_path);
+        if (!renamed)
+            goto fail;
+        xfree(tmp_path);
+        tmp_path = NULL;
+    }
+
+    if (fstat(*idx_fd, &st) < 0)
+        return false;
+    hist->map_idx_fd = fcntl(*idx_fd, F_DUPFD_CLOEXEC, 0);
+    if (hist->map_idx_fd < 0)
+        return false;
+    hist->idx_map = history_map_fd(*idx_fd, idx_size);
+    if (!hist->idx_map)
+        return false;
+    hist->idx_map_len = idx_size;
+    hist->offsets = (const uint64_t *)((const char *)hist->idx_map + HISTORY_IDX_HEADER);
+    hist->count = (long)((idx_size - HISTORY_IDX_HEADER) / sizeof(uint64_t));
+    if (hist->trigram_entries > hist->count)
+        history_trigrams_clear(hist);
+    return true;
+
+fail:
+    if (tmp_path)
+    {
+        int saved = errno;
+        unlink(tmp_path);
+        xfree(tmp_path);
+        errno = saved;
+    }
+    return false;
+}
+
+// Whether the mappings may reach past the end of the files they were made
+// from, which shrank (`: > $HISTFILE`). Shells sharing the file only append to
+// it and replace the index by renaming, which leaves the mapped files whole,
+// so this needs no lock.
+static bool history_mappings_stale(const history_t *hist)
+{
+    struct stat log_st, idx_st;
+    if (hist->map_log_fd < 0 || fstat(hist->map_log_fd, &log_st) < 0 ||
+        fstat(hist->map_idx_fd, &idx_st) < 0)
+        return true;
+    return (uint64_t)log_st.st_size < hist->log_map_len ||
+           (uint64_t)idx_st.st_size < hist->idx_map_len;
+}
+
+// Open both files and lock the history file; false if either fails. Unless
+// `create` is set, a missing file is not created.
+static bool history_files_open(const history_t *hist, bool create, int *log_fd, int *idx_fd)
+{
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0);
+    *log_fd = open(hist->path, flags | O_APPEND, 0600);
+    if (*log_fd < 0)
+        return false;
+
+    char *idx_path = history_idx_path(hist, "");
+    *idx_fd = open(idx_path, flags, 0600);
+    xfree(idx_path);
+
+    if (*idx_fd < 0 || !history_lock(*log_fd, F_WRLCK))
+    {
+        int saved = errno;
+        if (*idx_fd >= 0)
+            close(*idx_fd);
+        close(*log_fd);
+        errno = saved;
+        return false;
+    }
+    return true;
+}
+
+// Closing the history file releases the lock
+static void history_files_close(int log_fd, int idx_fd)
+{
+    close(idx_fd);
+    close(log_fd);
+}
+
+#endif /* MIGA_POSIX_API */
+
+// Make the entries safe to read. Normally that is two fstat() calls on the
+// kept descriptors; only if a file shrank under its mapping is the history
+// locked and mapped again. Returns false if the entries cannot be read.
+static bool history_begin_read(history_t *hist)
+{
+    if (!hist->path)
+        return true;
+#ifdef MIGA_POSIX_API
+    if (!history_mappings_stale(hist))
+        return true;
+
+    // Remapping may rebuild the index, so it takes the write lock
+    int log_fd, idx_fd;
+    if (!history_files_open(hist, false, &log_fd, &idx_fd))
+    {
+        history_unmap(hist);
+        return false;
+    }
+    if (!history_sync_locked(hist, log_fd, &idx_fd))
+        history_unmap(hist);
+    history_files_close(log_fd, idx_fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ============================================================================
+// History
+// ============================================================================
+
+history_t *history_create(void)
+{
+    history_t *hist = xcalloc(1, sizeof(history_t));
+    hist->map_log_fd = -1;
+    hist->map_idx_fd = -1;
+    return hist;
+}
+
+history_t *history_open(const char *path)
+{
+    Expects_not_null(path);
+
+#ifdef MIGA_POSIX_API
+    history_t *hist = history_create();
+    size_t len = strlen(path);
+    hist->path = xmalloc(len + 1);
+    memcpy(hist->path, path, len + 1);
+
+    int log_fd, idx_fd;
+    if (!history_files_open(hist, true, &log_fd, &idx_fd))
+    {
+        int saved = errno;
+        history_destroy(&hist);
+        errno = saved;
+        return NULL;
+    }
+    bool ok = history_sync_locked(hist, log_fd, &idx_fd);
+    int saved = errno;
+    history_files_close(log_fd, idx_fd);
+    if (!ok)
+    {
+        history_destroy(&hist);
+        errno = saved;
+        return NULL;
+    }
+    return hist;
+#else
+    (void)path;
+    errno = ENOSYS;
+    return NULL;
+#endif
+}
+
+void history_destroy(history_t **hist)
+{
+    Expects_not_null(hist);
+    history_t *h = *hist;
+    if (!h)
+        return;
+
+#ifdef MIGA_POSIX_API
+    history_unmap(h);
+#endif
+    history_trigrams_clear(h);
+    xfree(h->mem_log);
+    xfree(h->mem_offsets);
+    xfree(h->path);
+    xfree(h);
+    *hist = NULL;
+}
+
+static void history_add_memory(history_t *hist, const char *record, uint64_t len)
+{
+    if (hist->log_len + len > hist->mem_log_capacity)
+    {
+        uint64_t capacity = hist->mem_log_capacity ? hist->mem_log_capacity : 4096;
+        while (capacity < hist->log_len + len)
+            capacity *= 2;
+        hist->mem_log = xrealloc(hist->mem_log, capacity);
+        hist->mem_log_capacity = capacity;
+    }
+    if (hist->count == hist->mem_offsets_capacity)
+    {
+        hist->mem_offsets_capacity = hist->mem_offsets_capacity ? hist->mem_offsets_capacity * 2 : 256;
+        hist->mem_offsets =
+            xrealloc(hist->mem_offsets, hist->mem_offsets_capacity * sizeof(uint64_t));
+    }
+    memcpy(hist->mem_log + hist->log_len, record, len);
+    hist->mem_offsets[hist->count++] = hist->log_len;
+    hist->log_len += len;
+    hist->log = hist->mem_log;
+    hist->offsets = hist->mem_offsets;
+}
+
+bool history_add(history_t *hist, const char *line)
+{
+    Expects_not_null(hist);
+    Expects_not_null(line);
+
+    uint64_t len;
+    char *record = history_encode(line, &len);
+    len++; // The terminator
+
+    if (!hist->path)
+    {
+        history_add_memory(hist, record, len);
+        xfree(record);
+        return true;
+    }
+
+#ifdef MIGA_POSIX_API
+    int log_fd, idx_fd;
+    if (!history_files_open(hist, true, &log_fd, &idx_fd))
+    {
+        xfree(record);
+        return false;
+    }
+
+    // Pick up what other shells appended, so the offset written below is
+    // where this entry lands
+    bool ok = history_sync_locked(hist, log_fd, &idx_fd);
+    if (ok && hist->log_len && hist->log[hist->log_len - 1] != '\n')
+    {
+        // A writer stopped partway through a line; finish it as an entry of
+        // its own
+        ok = history_append_fd(log_fd, "\n", 1) && history_sync_locked(hist, log_fd, &idx_fd);
+    }
+    if (ok)
+    {
+        uint64_t offset = hist->log_len;
+        ok = history_append_fd(log_fd, record, len) &&
+             history_write_at(idx_fd, &offset, sizeof(offset),
+                              HISTORY_IDX_HEADER + (uint64_t)hist->count * sizeof(uint64_t)) &&
+             history_sync_locked(hist, log_fd, &idx_fd);
+    }
+    if (!ok)
+        log_warn("history: cannot append to %s: %s", hist->path, strerror(errno));
+    history_files_close(log_fd, idx_fd);
+    xfree(record);
+    return ok;
+#else
+    xfree(record);
+    return false;
+#endif
+}
+
+long history_count(const history_t *hist)
+{
+    Expects_not_null(hist);
+    return hist->count;
+}
+
+bool history_get(history_t *hist, long n, string_t *out)
+{
+    Expects_not_null(hist);
+    Expects_not_null(out);
+
+    if (!history_begin_read(hist) || n < 0 || n >= hist->count)
+        return false;
+    uint64_t len;
+    const char *entry = history_entry(hist, n, &len);
+    const char *end = entry + len;
+    while (entry < end)
+    {
+        const char *nul = memchr(entry, '\0', end - entry);
+        const char *stop = nul ? nul : end;
+        string_append_data(out, entry, (int)(stop - entry));
+        if (nul)
+            string_append_char(out, '\n');
+        entry = stop + (nul ? 1 : 0);
+    }
+    return true;
+}
+
+long history_search(history_t *hist, const char *text, long before)
+{
+    Expects_not_null(hist);
+    Expects_not_null(text);
+
+    if (!history_begin_read(hist))
+        return -1;
+    if (before < 0 || before > hist->count)
+        before = hist->count;
+    uint64_t needle_len;
+    char *needle = history_encode(text, &needle_len);
+    long found = -1;
+
+    if (needle_len == 0)
+    {
+        found = before - 1;
+    }
+    else if (needle_len >= 3 && hist->count >= HISTORY_TRIGRAM_MIN_ENTRIES)
+    {
+        history_trigrams_update(hist);
+
+        // The rarest trigram of the needle narrows the entries to check
+        const history_postings_t *rarest = NULL;
+        for (uint64_t i = 0; i + 3 <= needle_len; i++)
+        {
+            const history_postings_t *p =
+                history_trigram_find(hist, history_trigram_key(needle + i), false);
+            if (!p)
+            {
+                rarest = NULL;
+                break;
+            }
+            if (!rarest || p->count < rarest->count)
+                rarest = p;
+        }
+
+        if (rarest)
+        {
+            // Last posting below `before`
+            uint32_t lo = 0, hi = rarest->count;
+            while (lo < hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (rarest->entries[mid] < (uint32_t)before)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            while (lo-- > 0)
+            {
+                uint64_t len;
+                const char *entry = history_entry(hist, rarest->entries[lo], &len);
+                if (history_contains(entry, len, needle, needle_len))
+                {
+                    found = rarest->entries[lo];
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (long n = before - 1; n >= 0; n--)
+        {
+            uint64_t len;
+            const char *entry = history_entry(hist, n, &len);
+            if (history_contains(entry, len, needle, needle_len))
+            {
+                found = n;
+                break;
+            }
+        }
+    }
+
+    xfree(needle);
+    return found;
+}
@@ -0,0 +1,80 @@
+// ============================================================================
+// history.h
+// Command history: an append-only log, mapped into memory and indexed
+// ============================================================================
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdbool.h>
+
+#include "miga/string_t.h"
+
+// ============================================================================
+// History File
+//
+// The history file (HISTFILE) holds one entry per line, oldest first; a
+// newline inside an entry is written as a NUL byte. It is only ever
+// appended to. Beside it, PATH.idx holds a short header and then the byte
+// offset of every entry as a native 64-bit integer, so entry N is found
+// without reading the entries before it.
+//
+// Opening a history maps both files into memory; nothing is read line by
+// line, so startup does not depend on the size of the history. Only lines
+// the index does not cover yet (written by another program, or left by a
+// shell that stopped between the two writes) are read, and added to the
+// index. If the index is missing or does not match the file, it is built
+// again, into a new file that is then renamed over the old one: other
+// shells may have the old one mapped.
+//
+// Reading an entry takes no lock and opens nothing: the history keeps a
+// descriptor of each mapped file and checks that neither has shrunk since it
+// was mapped (truncated by `: > $HISTFILE`, say). Only if one has is the
+// history file locked and both mapped again. A deleted history file stays
+// readable through the kept descriptors and is not created again by a read.
+//
+// Several shells may append to the same file at the same time: each append
+// holds a POSIX record lock on the history file while it writes the entry
+// and its offset. A shell sees entries other shells added when it next
+// appends one itself.
+// ============================================================================
+
+typedef struct history_t history_t;
+
+// A history kept only in memory
+history_t *history_create(void);
+
+// Open (creating if need be) the history file at `path`. Returns NULL, with
+// errno set, if the file cannot be opened or mapped.
+history_t *history_open(const char *path);
+
+void history_destroy(history_t **hist);
+
+// Append an entry. Returns false if it could not be written.
+bool history_add(history_t *hist, const char *line);
+
+// Number of entries
+long history_count(const history_t *hist);
+
+// Append entry `n` (0 is the oldest) to `out`. Returns false if there is no
+// such entry.
+bool history_get(history_t *hist, long n, string_t *out);
+
+// ============================================================================
+// Search
+//
+// A search looks for the newest entry before a given one that contains a
+// string. Short histories are simply scanned. Once a history holds
+// HISTORY_TRIGRAM_MIN_ENTRIES entries, the first search of at least three
+// bytes builds an in-memory index from every three-byte sequence to the
+// entries that contain it (extended as entries are added), and only the
+// entries listed under the rarest sequence of the search string are
+// checked.
+// ============================================================================
+
+#define HISTORY_TRIGRAM_MIN_ENTRIES 1024
+
+// The newest entry before entry `before` that contains `text`, or -1
+long history_search(history_t *hist, const char *text, long before);
+
+#endif /* HISTORY_H */
@@ -0,0 +1,223 @@
+// ============================================================================
+// ifs_split.c
+// Table-driven field splitting on IFS
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IFS_SPLIT_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#include "ifs_split.h"
+
+#include "logging.h"
+#include "miga/xalloc.h"
+
+#define IFS_DEFAULT " \t\n"
+
+enum
+{
+    IFS_CLASS_NONE = 0,  // Ordinary field character
+    IFS_CLASS_SPACE = 1, // IFS white space
+    IFS_CLASS_HARD = 2   // Any other IFS character
+};
+
+struct ifs_splitter_t
+{
+    char *ifs;             // IFS text the table was built for, NULL before the first set
+    const void *source;    // Where ifs was read from (see ifs_splitter_set_ifs_from)
+    uint32_t generation;   // ...and that source's generation at the time
+    bool is_default;       // ifs is exactly <space><tab><newline>
+    bool is_empty;         // ifs is empty: no splitting at all
+    uint8_t classes[256];  // IFS_CLASS_* for every byte value
+    ifs_field_t *fields;   // Slices from the last scan
+    int fields_capacity;
+};
+
+ifs_splitter_t *ifs_splitter_create(void)
+{
+    ifs_splitter_t *splitter = xcalloc(1, sizeof(ifs_splitter_t));
+    ifs_splitter_set_ifs(splitter, IFS_DEFAULT);
+    return splitter;
+}
+
+void ifs_splitter_destroy(ifs_splitter_t **splitter)
+{
+    if (!splitter || !*splitter)
+        return;
+    xfree((*splitter)->ifs);
+    xfree((*splitter)->fields);
+    xfree(*splitter);
+    *splitter = NULL;
+}
+
+void ifs_splitter_set_ifs(ifs_splitter_t *splitter, const char *ifs)
+{
+    Expects_not_null(splitter);
+    Expects_not_null(ifs);
+
+    splitter->source = NULL;
+    if (splitter->ifs && strcmp(splitter->ifs, ifs) == 0)
+        return;
+
+    size_t len = strlen(ifs);
+    xfree(splitter->ifs);
+    splitter->ifs = xmalloc(len + 1);
+    memcpy(splitter->ifs, ifs, len + 1);
+    splitter->is_default = strcmp(ifs, IFS_DEFAULT) == 0;
+    splitter->is_empty = len == 0;
+
+    memset(splitter->classes, IFS_CLASS_NONE, sizeof(splitter->classes));
+    for (const unsigned char *p = (const unsigned char *)ifs; *p; p++)
+    {
+        bool space = *p == ' ' || *p == '\t' || *p == '\n';
+        splitter->classes[*p] = space ? IFS_CLASS_SPACE : IFS_CLASS_HARD;
+    }
+}
+
+bool ifs_splitter_is_from(const ifs_splitter_t *splitter, const void *source,
+                          uint32_t generation)
+{
+    Expects_not_null(splitter);
+    return source != NULL && splitter->source == source && splitter->generation == generation;
+}
+
+void ifs_splitter_set_ifs_from(ifs_splitter_t *splitter, const char *ifs, const void *source,
+                               uint32_t generation)
+{
+    ifs_splitter_set_ifs(splitter, ifs);
+    splitter->source = source;
+    splitter->generation = generation;
+}
+
+static void push_field(ifs_splitter_t *splitter, int *count, int start, int length)
+{
+    if (*count == splitter->fields_capacity)
+    {
+        int capacity = splitter->fields_capacity ? splitter->fields_capacity * 2 : 16;
+        splitter->fields = xrealloc(splitter->fields, (size_t)capacity * sizeof(ifs_field_t));
+        splitter->fields_capacity = capacity;
+    }
+    splitter->fields[*count].start = start;
+    splitter->fields[*count].length = length;
+    (*count)++;
+}
+
+static int skip_space(const ifs_splitter_t *splitter, const char *text, int i, int len)
+{
+    while (i < len && splitter->classes[(unsigned char)text[i]] == IFS_CLASS_SPACE)
+        i++;
+    return i;
+}
+
+#ifdef IFS_SPLIT_SSE2
+static inline int lowest_set_bit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Find the next space, tab or newline, 16 bytes at a time
+static int find_default_delimiter(const char *text, int i, int len)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    while (i + 16 <= len)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                    _mm_cmpeq_epi8(chunk, newline));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask)
+            return i + lowest_set_bit(mask);
+        i += 16;
+    }
+    while (i < len && text[i] != ' ' && text[i] != '\t' && text[i] != '\n')
+        i++;
+    return i;
+}
+#endif
+
+// Index of the first IFS character at or after i, or len
+static int find_delimiter(const ifs_splitter_t *splitter, const char *text, int i, int len)
+{
+#ifdef IFS_SPLIT_SSE2
+    if (splitter->is_default)
+        return find_default_delimiter(text, i, len);
+#endif
+    while (i < len && splitter->classes[(unsigned char)text[i]] == IFS_CLASS_NONE)
+        i++;
+    return i;
+}
+
+int ifs_splitter_scan(ifs_splitter_t *splitter, const char *text, int len,
+                      const ifs_field_t **fields)
+{
+    Expects_not_null(splitter);
+    Expects_not_null(text);
+    Expects_not_null(fields);
+
+    int count = 0;
+    *fields = splitter->fields;
+
+    if (splitter->is_empty)
+    {
+        if (len > 0)
+            push_field(splitter, &count, 0, len);
+        *fields = splitter->fields;
+        return count;
+    }
+
+    int i = skip_space(splitter, text, 0, len);
+    while (i < len)
+    {
+        int start = i;
+        i = find_delimiter(splitter, text, i, len);
+        push_field(splitter, &count, start, i - start);
+        if (i >= len)
+            break;
+
+        // One delimiter: white space, at most one hard delimiter, white space
+        i = skip_space(splitter, text, i, len);
+        if (i < len && splitter->classes[(unsigned char)text[i]] == IFS_CLASS_HARD)
+            i = skip_space(splitter, text, i + 1, len);
+    }
+
+    *fields = splitter->fields;
+    return count;
+}
+
+strlist_t *ifs_splitter_split(ifs_splitter_t *splitter, const string_t *text)
+{
+    Expects_not_null(splitter);
+    Expects_not_null(text);
+
+    const char *data = string_cstr(text);
+    const ifs_field_t *fields;
+    int count = ifs_splitter_scan(splitter, data, string_length(text), &fields);
+
+    strlist_t *list = strlist_create();
+    for (int i = 0; i < count; i++)
+    {
+        string_t *field = string_create_from_cstr_len(data + fields[i].start, fields[i].length);
+        strlist_move_push_back(list, &field);
+    }
+    return list;
+}
@@ -0,0 +1,66 @@
+// ============================================================================
+// ifs_split.h
+// Table-driven field splitting on IFS
+// ============================================================================
+
+#ifndef IFS_SPLIT_H
+#define IFS_SPLIT_H
+
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+
+// ============================================================================
+// IFS Splitter
+//
+// Field splitting classifies every byte of the expanded text as ordinary,
+// IFS white space (space, tab or newline present in IFS) or other IFS
+// ("hard") delimiter. The splitter keeps that classification as a 256-entry
+// table and rebuilds it only when it is handed an IFS different from the
+// one it was built for, so splitting word after word under the same IFS
+// does no per-word setup. With the default IFS of <space><tab><newline>,
+// the search for the end of each field compares 16 bytes at a time where
+// SSE2 is available.
+//
+// A split produces slices (offset and length) into the caller's text,
+// stored in one array owned by the splitter; ifs_splitter_split() turns
+// them into a strlist_t.
+// ============================================================================
+
+typedef struct ifs_field_t
+{
+    int start;  // Offset of the field in the split text
+    int length; // May be zero: "a::b" with IFS=":" has an empty field
+} ifs_field_t;
+
+typedef struct ifs_splitter_t ifs_splitter_t;
+
+ifs_splitter_t *ifs_splitter_create(void);
+void ifs_splitter_destroy(ifs_splitter_t **splitter);
+
+// Split using `ifs` from now on. Cheap when `ifs` is unchanged.
+void ifs_splitter_set_ifs(ifs_splitter_t *splitter, const char *ifs);
+
+// As ifs_splitter_set_ifs(), also recording that `ifs` was read from
+// `source` (the caller's variable store) when its generation was
+// `generation`. While ifs_splitter_is_from() says the source is unchanged,
+// the caller can skip looking IFS up again.
+void ifs_splitter_set_ifs_from(ifs_splitter_t *splitter, const char *ifs, const void *source,
+                               uint32_t generation);
+bool ifs_splitter_is_from(const ifs_splitter_t *splitter, const void *source,
+                          uint32_t generation);
+
+// Split text[0, len) following POSIX rules:
+//  - IFS white space at the start and end of the text is ignored
+//  - a delimiter is a run of IFS white space, optionally around one hard
+//    delimiter; consecutive hard delimiters delimit empty fields
+//  - a trailing hard delimiter does not start another field
+//  - an empty IFS leaves the text as one field
+// Returns the number of fields and points *fields at the slices, which
+// stay valid until the next call.
+int ifs_splitter_scan(ifs_splitter_t *splitter, const char *text, int len,
+                      const ifs_field_t **fields);
+
+// Split `text` into a new list of fields
+strlist_t *ifs_splitter_split(ifs_splitter_t *splitter, const string_t *text);
+
+#endif /* IFS_SPLIT_H */
@@ -356,6 +356,27 @@ job_t *job_store_find_by_pgid(const job_store_t *store, int pgid)
     return NULL;
 }
 
+#ifdef MIGA_POSIX_API
+job_t *job_store_find_by_pid(const job_store_t *store, pid_t pid)
+#else
+job_t *job_store_find_by_pid(const job_store_t *store, int pid)
+#endif
+{
+    if (!store)
+        return NULL;
+
+    for (job_t *job = store->jobs; job; job = job->next)
+    {
+        for (const process_t *proc = job->processes; proc; proc = proc->next)
+        {
+            if (proc->pid == pid)
+                return job;
+        }
+    }
+
+    return NULL;
+}
+
 // ============================================================================
 // Job State Management
 // ============================================================================
@@ -747,6 +768,66 @@ int job_get_process_exit_status(const job_t* job, size_t index)
     return -1; // Safe default if index is out of bounds
 }
 
+size_t job_store_count_running(const job_store_t *store)
+{
+    if (!store)
+        return 0;
+
+    size_t count = 0;
+    for (const job_t *job = store->jobs; job; job = job->next)
+    {
+        if (job->is_background && job_is_running(job))
+            count++;
+    }
+
+    return count;
+}
+
+#ifdef MIGA_POSIX_API
+int job_store_active_pids(const job_store_t *store, int job_id, pid_t **pids)
+{
+    *pids = NULL;
+    if (!store)
+        return 0;
+
+    int count = 0;
+    int capacity = 0;
+    for (const job_t *job = store->jobs; job; job = job->next)
+    {
+        if (job_id > 0 && job->job_id != job_id)
+            continue;
+        for (const process_t *proc = job->processes; proc; proc = proc->next)
+        {
+            if (proc->state != JOB_RUNNING && proc->state != JOB_STOPPED)
+                continue;
+            if (count == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 8;
+                *pids = xrealloc(*pids, (size_t)capacity * sizeof(pid_t));
+            }
+            (*pids)[count++] = proc->pid;
+        }
+    }
+    return count;
+}
+#endif
+
+job_t *job_store_find_unreported_completed(const job_store_t *store)
+{
+    if (!store)
+        return NULL;
+
+    // The list is kept most-recent-first, so the last match is the oldest
+    job_t *oldest = NULL;
+    for (job_t *job = store->jobs; job; job = job->next)
+    {
+        if (job->is_background && !job->is_notified && job_is_completed(job))
+            oldest = job;
+    }
+
+    return oldest;
+}
+
 int job_store_get_job_ids(const job_store_t *store, int *job_ids, size_t max_jobs)
 {
     if (!store || !job_ids || max_jobs == 0)
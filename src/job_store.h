@@ -206,6 +206,19 @@ job_t *job_store_find_by_pgid(const job_store_t *store, pid_t pgid);
 job_t *job_store_find_by_pgid(const job_store_t *store, int pgid);
 #endif
 
+/**
+ * Find the job that owns a process.
+ *
+ * @param store The job store
+ * @param pid The process ID
+ * @return Pointer to the job, or NULL if no job contains the process
+ */
+#ifdef MIGA_POSIX_API
+job_t *job_store_find_by_pid(const job_store_t *store, pid_t pid);
+#else
+job_t *job_store_find_by_pid(const job_store_t *store, int pid);
+#endif
+
 // ============================================================================
 // Job State Management
 // ============================================================================
@@ -357,6 +370,37 @@ bool job_store_iter_set_state(job_process_iterator_t *iter, job_state_t new_stat
  */
 size_t job_store_count(const job_store_t *store);
 
+/**
+ * Get the number of background jobs that still have a running process.
+ * Stopped and completed jobs are not counted.
+ *
+ * @param store The job store
+ * @return Number of running background jobs
+ */
+size_t job_store_count_running(const job_store_t *store);
+
+#ifdef MIGA_POSIX_API
+/**
+ * Collect the PIDs of the running and stopped processes of job `job_id`,
+ * or of every job if `job_id` is 0.
+ *
+ * @param store The job store
+ * @param job_id The job, or 0 for all jobs
+ * @param pids Receives a new array (free with xfree), or NULL if there are none
+ * @return Number of PIDs
+ */
+int job_store_active_pids(const job_store_t *store, int job_id, pid_t **pids);
+#endif
+
+/**
+ * Find a completed background job whose status has not yet been reported.
+ * If several qualify, the oldest one is returned.
+ *
+ * @param store The job store
+ * @return Pointer to the job, or NULL if none
+ */
+job_t *job_store_find_unreported_completed(const job_store_t *store);
+
 /**
  * @brief Retrieves job IDs from a job store.
  * @param store Pointer to the job store to query.
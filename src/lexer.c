@@ -137,6 +137,19 @@ lexer_t *lexer_append_input_cstr(lexer_t *lx, const char *input)
     return lx;
 }
 
+void lexer_set_start_line(lexer_t *lx, int line_no)
+{
+    Expects_not_null(lx);
+    Expects_not_null(lx->input);
+
+    if (string_length(lx->input) > 0 || line_no < 1)
+        return;
+    lx->line_no = line_no;
+    lx->col_no = 1;
+    lx->tok_start_line = line_no;
+    lx->tok_start_col = 1;
+}
+
 void lexer_set_line_no(lexer_t *lx, int line_no)
 {
     Expects_not_null(lx);
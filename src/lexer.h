@@ -80,6 +80,15 @@ void lexer_append_input(lexer_t *lx, const string_t *input);
  */
 lexer_t *lexer_append_input_cstr(lexer_t *lx, const char *input);
 
+/**
+ * Number the next line of input.
+ *
+ * Has no effect while the lexer still holds input from an incomplete
+ * command, whose lines it is already counting. Callers that feed input
+ * one line at a time use this so token locations match the source file.
+ */
+void lexer_set_start_line(lexer_t *lx, int line_no);
+
 /* ============================================================================
  * Tokenization  the main workhorse
  * ============================================================================ */
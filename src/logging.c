@@ -7,6 +7,7 @@
 #include <stdlib.h>
 
 #include "logging.h"
+#include "trace.h"
 
 #ifdef MIGA_POSIX_API
 #include <strings.h> // For strcasecmp
@@ -23,7 +24,7 @@
 LogLevel g_log_threshold = LOG_LEVEL_ERROR; // Default to ERROR level
 
 // Define the abort level
-static LogLevel g_log_abort_level = LOG_LEVEL_FATAL; // Default to no aborting, except for FATAL
+LogLevel g_log_abort_level = LOG_LEVEL_FATAL; // Default to no aborting, except for FATAL
 
 // Fatal try/catch support
 static jmp_buf *g_fatal_jmp = NULL;
@@ -31,47 +32,36 @@ static int g_fatal_jmp_enabled = 0;
 static LogLevel g_prev_abort_level = LOG_LEVEL_FATAL;
 static int g_prev_abort_level_valid = 0;
 
-// Internal logging function
-static void log_message(LogLevel level, const char *level_str, const char *format, va_list args)
+// Abort or unwind after a message, as the abort level and any fatal "try"
+// region require. A pending abort dumps the trace first, since it holds the
+// events leading up to the failure.
+static void log_finish(LogLevel level)
 {
-    if (level < g_log_threshold)
+    if (level >= g_log_abort_level && level != LOG_LEVEL_NONE)
     {
-        if (level >= g_log_abort_level && level != LOG_LEVEL_NONE)
-        {
-            abort();
-        }
-        if (level == LOG_LEVEL_FATAL && g_log_abort_level == LOG_LEVEL_NONE)
+        if (trace_is_enabled())
         {
-            if (g_fatal_jmp_enabled && g_fatal_jmp != NULL)
-            {
-                longjmp(*g_fatal_jmp, 1);
-            }
+            fprintf(stderr, "[TRACE] Events before abort:\n");
+            trace_dump(stderr);
         }
-        return;
+        abort();
     }
-
-    char *buffer = malloc(LOG_MESSAGE_BUFFER_SIZE);
-    if (buffer == NULL)
+    if (level == LOG_LEVEL_FATAL && g_log_abort_level == LOG_LEVEL_NONE)
     {
-        fprintf(stderr, "[%s] Failed to allocate log buffer\n", level_str);
-        fflush(stderr);
-        if (level >= g_log_abort_level && level != LOG_LEVEL_NONE)
-        {
-            abort();
-        }
-        if (level == LOG_LEVEL_FATAL && g_log_abort_level == LOG_LEVEL_NONE)
+        if (g_fatal_jmp_enabled && g_fatal_jmp != NULL)
         {
-            if (g_fatal_jmp_enabled && g_fatal_jmp != NULL)
-            {
-                longjmp(*g_fatal_jmp, 1);
-            }
+            longjmp(*g_fatal_jmp, 1);
         }
-        return;
     }
+}
 
-    if (!(level == LOG_LEVEL_FATAL && g_fatal_jmp_enabled))
+// Internal logging function
+static void log_message(LogLevel level, const char *level_str, const char *format, va_list args)
+{
+    if (level >= g_log_threshold && !(level == LOG_LEVEL_FATAL && g_fatal_jmp_enabled))
     {
-        int written = vsnprintf(buffer, LOG_MESSAGE_BUFFER_SIZE, format, args);
+        char buffer[LOG_MESSAGE_BUFFER_SIZE];
+        int written = vsnprintf(buffer, sizeof(buffer), format, args);
         if (written < 0)
         {
             fprintf(stderr, "[%s] Failed to format log message\n", level_str);
@@ -87,21 +77,8 @@ static void log_message(LogLevel level, const char *level_str, const char *forma
         }
         fflush(stderr);
     }
-    free(buffer);
-
-    // Check if this level should trigger abort
-    if (level >= g_log_abort_level && level != LOG_LEVEL_NONE)
-    {
-        abort();
-    }
 
-    if (level == LOG_LEVEL_FATAL && g_log_abort_level == LOG_LEVEL_NONE)
-    {
-        if (g_fatal_jmp_enabled && g_fatal_jmp != NULL)
-        {
-            longjmp(*g_fatal_jmp, 1);
-        }
-    }
+    log_finish(level);
 }
 
 static int strcompare(const char *s1, const char *s2)
@@ -225,8 +202,9 @@ void log_fatal_try_end(void)
     }
 }
 
-// Public logging functions
-void log_debug(const char *format, ...)
+// Public logging functions. The names are parenthesized because logging.h
+// also defines some of them as macros.
+void (log_debug)(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -234,7 +212,7 @@ void log_debug(const char *format, ...)
     va_end(args);
 }
 
-void log_warn(const char *format, ...)
+void (log_warn)(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -242,7 +220,7 @@ void log_warn(const char *format, ...)
     va_end(args);
 }
 
-void log_error(const char *format, ...)
+void (log_error)(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -250,7 +228,7 @@ void log_error(const char *format, ...)
     va_end(args);
 }
 
-void log_fatal(const char *format, ...)
+void (log_fatal)(const char *format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -120,6 +120,46 @@ void log_error(const char *format, ...);
  */
 void log_fatal(const char *format, ...);
 
+/**
+ * @def LOG_COMPILE_LEVEL
+ * @brief Lowest level compiled into the program
+ *
+ * log_debug() and log_warn() calls below this level (given as the numeric
+ * LogLevel value) are removed at compile time; their arguments are still
+ * type-checked but never evaluated. Defaults to 0, keeping everything, so
+ * that LOG_LEVEL=DEBUG works; build with -DLOG_COMPILE_LEVEL=1 to drop
+ * debug messages from hot paths entirely.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+/* Current thresholds; use log_level() and log_set_level() outside this file */
+extern LogLevel g_log_threshold;
+extern LogLevel g_log_abort_level;
+
+/**
+ * @brief True if a message at @p lv would be printed or would abort
+ *
+ * The macros below test this before evaluating their arguments, so a
+ * filtered message costs two loads and a branch.
+ */
+#define log_level_enabled(lv) ((lv) >= g_log_threshold || (lv) >= g_log_abort_level)
+
+/* The functions above are called through these macros; writing the name in
+ * parentheses, as logging.c does, reaches the function itself. */
+#if LOG_COMPILE_LEVEL <= 0
+#define log_debug(...) (log_level_enabled(LOG_LEVEL_DEBUG) ? (log_debug)(__VA_ARGS__) : (void)0)
+#else
+#define log_debug(...) (0 ? (log_debug)(__VA_ARGS__) : (void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define log_warn(...) (log_level_enabled(LOG_LEVEL_WARN) ? (log_warn)(__VA_ARGS__) : (void)0)
+#else
+#define log_warn(...) (0 ? (log_warn)(__VA_ARGS__) : (void)0)
+#endif
+
 // Existing recoverable precondition helpers
 
 #define return_if_null(ptr)                                                                                            \
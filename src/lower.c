@@ -63,6 +63,7 @@ static redirection_type_t map_redir_type_from_io_file(const gnode_t *io_file);
 static redir_target_kind_t determine_target_kind(token_type_t type,
                                                    token_t *target_tok, string_t **out_io_loc);
 static cmd_separator_t separator_from_gseparator_op(const gnode_t *gsep);
+static int first_line_of(const gnode_t *g);
 
 /* Entry point */
 ast_t *ast_lower(const gnode_t *root)
@@ -140,9 +141,12 @@ static ast_node_t *lower_complete_commands(const gnode_t *g)
     {
         const gnode_t *gcmd = lst->nodes[i];
         Expects_eq(gcmd->type, G_COMPLETE_COMMAND);
+        bool last = i == lst->size - 1;
 
         /* A complete_command may return either a COMMAND_LIST or a single command.
-         * If it's a COMMAND_LIST, we need to flatten it here to avoid nesting. */
+         * If it's a COMMAND_LIST, we need to flatten it here to avoid nesting.
+         * Only the final command ends the list; the newline after any other
+         * command is a sequential separator. */
         ast_node_t *item = lower_complete_command(gcmd);
         if (!item)
         {
@@ -159,6 +163,8 @@ static ast_node_t *lower_complete_commands(const gnode_t *g)
             {
                 ast_node_t *cmd = inner_items->nodes[j];
                 cmd_separator_t sep = (j < inner_seps->len) ? inner_seps->separators[j] : CMD_EXEC_END;
+                if (sep == CMD_EXEC_END && !(last && j == inner_items->size - 1))
+                    sep = CMD_EXEC_SEQUENTIAL;
                 /* Transfer ownership */
                 inner_items->nodes[j] = NULL;
                 ast_command_list_node_append_item(cl, cmd);
@@ -171,7 +177,7 @@ static ast_node_t *lower_complete_commands(const gnode_t *g)
         {
             /* Single command: add it directly */
             ast_command_list_node_append_item(cl, item);
-            ast_command_list_node_append_separator(cl, CMD_EXEC_END);
+            ast_command_list_node_append_separator(cl, last ? CMD_EXEC_END : CMD_EXEC_SEQUENTIAL);
         }
     }
 
@@ -543,7 +549,19 @@ static ast_node_t *lower_pipe_sequence(const gnode_t *g, bool is_negated)
  *         | function_definition
  * ============================================================================
  */
+static ast_node_t *lower_command_dispatch(const gnode_t *g);
+
 static ast_node_t *lower_command(const gnode_t *g)
+{
+    ast_node_t *node = lower_command_dispatch(g);
+
+    /* Commands carry the line they start on, for LINENO and the profiler */
+    if (node && node->first_line <= 0)
+        ast_node_set_location(node, first_line_of(g), 0, 0, 0);
+    return node;
+}
+
+static ast_node_t *lower_command_dispatch(const gnode_t *g)
 {
     Expects_eq(g->type, G_COMMAND);
 
@@ -560,6 +578,24 @@ static ast_node_t *lower_command(const gnode_t *g)
         return NULL;
     }
 
+    /* compound_command redirect_list: lower the command, then wrap it */
+    if (g->payload_type == GNODE_PAYLOAD_MULTI && g->data.multi.b)
+    {
+        ast_node_t *wrapper = lower_redirect_list(g->data.multi.b);
+        if (!wrapper)
+            return NULL;
+        gnode_t inner = *g;
+        inner.data.multi.b = NULL;
+        ast_node_t *cmd = lower_command(&inner);
+        if (!cmd)
+        {
+            ast_node_destroy(&wrapper);
+            return NULL;
+        }
+        wrapper->data.redirected_command.command = cmd;
+        return wrapper;
+    }
+
     /* Dispatch based on the actual command type */
     switch (child->type)
     {
@@ -898,9 +934,10 @@ static ast_node_t *lower_term_as_command_list(const gnode_t *g)
             const gnode_t *sep_node = lst->nodes[i];
             if (sep_node->type == G_SEPARATOR)
             {
-                /* normalize to CMD_EXEC_SEQUENTIAL for ; or newline,
-                   CMD_EXEC_BACKGROUND for &. For now treat all as SEQUENTIAL. */
-                sep = CMD_EXEC_SEQUENTIAL;
+                /* CMD_EXEC_BACKGROUND for &, CMD_EXEC_SEQUENTIAL for ; or newline */
+                const gnode_t *op = sep_node->data.child;
+                sep = (op && op->type == G_SEPARATOR_OP) ? separator_from_gseparator_op(op)
+                                                         : CMD_EXEC_SEQUENTIAL;
                 i++;
             }
         }
@@ -1661,6 +1698,52 @@ static cmd_separator_t separator_from_gseparator_op(const gnode_t *gsep)
     return CMD_EXEC_SEQUENTIAL;
 }
 
+/* Source line of the first token under a grammar node, or 0 if unknown */
+static int first_line_of(const gnode_t *g)
+{
+    if (!g)
+        return 0;
+    if (g->first_line > 0)
+        return g->first_line;
+
+    switch (g->payload_type)
+    {
+    case GNODE_PAYLOAD_TOKEN:
+        return g->data.token ? token_get_first_line(g->data.token) : 0;
+    case GNODE_PAYLOAD_IO_HERE:
+        return g->data.io_here.tok ? token_get_first_line(g->data.io_here.tok) : 0;
+    case GNODE_PAYLOAD_CHILD:
+        return first_line_of(g->data.child);
+    case GNODE_PAYLOAD_PAIR:
+    {
+        int line = first_line_of(g->data.pair.left);
+        return line > 0 ? line : first_line_of(g->data.pair.right);
+    }
+    case GNODE_PAYLOAD_MULTI:
+    {
+        const gnode_t *parts[] = {g->data.multi.a, g->data.multi.b, g->data.multi.c,
+                                  g->data.multi.d};
+        for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+        {
+            int line = first_line_of(parts[i]);
+            if (line > 0)
+                return line;
+        }
+        return 0;
+    }
+    case GNODE_PAYLOAD_LIST:
+        for (int i = 0; g->data.list && i < g->data.list->size; i++)
+        {
+            int line = first_line_of(g->data.list->nodes[i]);
+            if (line > 0)
+                return line;
+        }
+        return 0;
+    default:
+        return 0;
+    }
+}
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
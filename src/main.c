@@ -23,6 +23,9 @@
 /* Only use non-library headers */
 #include "shell.h"
 
+/* logging.h arrives through the headers above, but its functions are not
+ * exported from the library. */
+#undef log_debug
 #define log_debug(...) while(false) {} // FIXME: figure out logging
 
 typedef enum
@@ -59,6 +62,14 @@ static int flag_v = 0; /* verbose */
 static int flag_x = 0; /* xtrace */
 static int flag_c = 0; /* command string mode */
 static int flag_s = 0; /* stdin mode */
+static int flag_worker = 0; /* --worker batch mode */
+
+/* Long option values that have no short equivalent */
+enum
+{
+    LONG_OPT_PROFILE = 256,
+    LONG_OPT_WORKER
+};
 
 static int is_valid_o_arg(const char *arg)
 {
@@ -171,6 +182,9 @@ static void print_usage(const string_t *prog)
     fprintf(stderr, "\nOptions (- prefix only):\n");
     fprintf(stderr, "  -c command      command string mode\n");
     fprintf(stderr, "  -s              read from stdin\n");
+    fprintf(stderr, "\nLong options:\n");
+    fprintf(stderr, "  --profile=FILE  write a time profile (folded stacks) to FILE\n");
+    fprintf(stderr, "  --worker        run batches of jobs read from standard input\n");
 }
 
 // In gcc on POSIX and with cl on UCRT, you can have an envp in main().
@@ -190,7 +204,6 @@ int main(int argc, char **argv)
     // the logger?
     // log_init();
     setlocale(LC_ALL, "");
-    printf("Welcome to Miga Shell. This is pre-alpha software. Use at your own risk.\n");
 
     /* Convert argv to strlist_t for the new getopt API */
     strlist_t *argv_list = strlist_create_from_cstr_array((const char **)argv, argc);
@@ -200,6 +213,7 @@ int main(int argc, char **argv)
 
     const char *command_string = NULL;
     const char *command_file = NULL;
+    const char *profile_file = NULL;
 
     /* Define option_ex array with allow_plus settings.
        Options a, b, C, e, f, i, m, n, u, v, x allow both - and +
@@ -229,6 +243,18 @@ int main(int argc, char **argv)
         /* 'o' needs special handling - it takes an argument */
         {.name = NULL, .has_arg = required_argument, .allow_plus = 1, .flag = NULL, .val = 'o'},
 
+        /* Long-only options */
+        {.name = "profile",
+         .has_arg = required_argument,
+         .allow_plus = 0,
+         .flag = NULL,
+         .val = LONG_OPT_PROFILE},
+        {.name = "worker",
+         .has_arg = no_argument,
+         .allow_plus = 0,
+         .flag = NULL,
+         .val = LONG_OPT_WORKER},
+
         /* Terminator: both name and val are NULL/0 */
         {0}};
 
@@ -291,6 +317,15 @@ int main(int argc, char **argv)
             flag_s = 1;
             break;
 
+        case LONG_OPT_PROFILE:
+            /* Points into argv_list, like command_string below */
+            profile_file = state.optarg;
+            break;
+
+        case LONG_OPT_WORKER:
+            flag_worker = 1;
+            break;
+
         case '?':
             /* getopt_long_plus already printed an error message */
             print_usage(strlist_at(argv_list, 0));
@@ -310,6 +345,21 @@ int main(int argc, char **argv)
 
     int optind_final = state.optind;
 
+    /* Worker mode speaks a protocol on stdout, so it must not be greeted */
+    if (!flag_worker)
+        printf("Welcome to Miga Shell. This is pre-alpha software. Use at your own risk.\n");
+
+    /* The jobs bring their own scripts */
+    if (flag_worker && (flag_c || flag_s || optind_final < argc))
+    {
+        fprintf(stderr, "%s: --worker takes no command string, file or arguments\n", argv[0]);
+        print_usage(strlist_at(argv_list, 0));
+        strlist_destroy(&o_opts);
+        strlist_destroy(&argv_list);
+        string_destroy(&optstring);
+        return 2;
+    }
+
     /* Validate -c and -s mutual exclusion */
     if (flag_c && flag_s)
     {
@@ -455,7 +505,8 @@ int main(int argc, char **argv)
         }
     }
 
-    shell_mode_t mode = compute_shell_mode(flag_c, flag_s, flag_i, command_file);
+    shell_mode_t mode =
+        flag_worker ? SHELL_MODE_WORKER : compute_shell_mode(flag_c, flag_s, flag_i, command_file);
     if (mode == SHELL_MODE_INVALID_UID_GID)
     {
         fprintf(stderr, "%s: cannot run interactive shell with differing real and effective UID/GID\n", argv[0]);
@@ -478,6 +529,7 @@ int main(int argc, char **argv)
     cfg.arguments = arg_array;
     cfg.argument_count = arg_count;
     cfg.envp = envp;
+    cfg.profile_file = profile_file;
     cfg.flags = (shell_flags_t){.allexport = flag_a,
                                 .noclobber = flag_C,
                                 .errexit = flag_e,
@@ -526,6 +578,7 @@ int main(int argc, char **argv)
     miga_arena_end();
 
     free(arg_array);
-    printf("Goodbye!\n");
+    if (mode != SHELL_MODE_WORKER)
+        printf("Goodbye!\n");
     return status;
 }
@@ -2762,6 +2762,19 @@ parse_status_t gparse_simple_command(parser_t *parser, gnode_t **out_node)
             continue;
         }
 
+        /* After the command name, name=value is an ordinary argument */
+        if (t == TOKEN_ASSIGNMENT_WORD && has_cmd_name)
+        {
+            gnode_t *word = g_node_create(G_CMD_WORD);
+            word->data.token = token_clone(parser_current_token(parser));
+            token_demote_assignment_to_word(word->data.token);
+            parser_advance(parser);
+
+            g_list_append(suffix->data.list, word);
+            has_suffix = true;
+            continue;
+        }
+
         /* Parse WORD as cmd_suffix - but not if it's a reserved word */
         if (t == TOKEN_WORD && !is_terminating_reserved_word(parser_current_token(parser)))
         {
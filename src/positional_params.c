@@ -111,7 +111,7 @@ positional_params_t *positional_params_clone(const positional_params_t *src)
     p->params = xcalloc((size_t)src->count, sizeof(string_t *));
     for (int i = 0; i < src->count; i++)
     {
-        p->params[i] = string_create_from(src->params[i]);
+        p->params[i] = string_create_from(src->params[src->start + i]);
     }
 
     return p;
@@ -126,15 +126,15 @@ void positional_params_destroy(positional_params_t **params)
 
     if (p->params != NULL)
     {
-        for (int i = 0; i < p->count; i++)
+        for (int i = p->start; i < p->start + p->count; i++)
         {
             if (p->params[i] != NULL)
                 string_destroy(&p->params[i]);
         }
-        if (p->arg0 != NULL)
-            string_destroy(&p->arg0);
         xfree(p->params);
     }
+    if (p->arg0 != NULL)
+        string_destroy(&p->arg0);
 
     xfree(p);
     *params = NULL;
@@ -152,7 +152,7 @@ const string_t *positional_params_get(const positional_params_t *params, int n)
     if (n < 1 || n > params->count)
         return NULL;
 
-    return params->params[n - 1];
+    return params->params[params->start + n - 1];
 }
 
 const string_t *positional_params_get_arg0(const positional_params_t *params)
@@ -178,12 +178,23 @@ strlist_t *positional_params_get_all(const positional_params_t *params)
 
     for (int i = 0; i < params->count; i++)
     {
-        strlist_push_back(list, params->params[i]);
+        strlist_push_back(list, params->params[params->start + i]);
     }
 
     return list;
 }
 
+const string_t *const *positional_params_view(const positional_params_t *params, int *count)
+{
+    Expects_not_null(params);
+    Expects_not_null(count);
+
+    *count = params->count;
+    if (params->params == NULL || params->count == 0)
+        return NULL;
+    return (const string_t *const *)&params->params[params->start];
+}
+
 string_t *positional_params_get_all_joined(const positional_params_t *params, char sep)
 {
     Expects_not_null(params);
@@ -198,7 +209,7 @@ string_t *positional_params_get_all_joined(const positional_params_t *params, ch
     {
         if (i > 0)
             string_append_char(result, sep);
-        string_append(result, params->params[i]);
+        string_append(result, params->params[params->start + i]);
     }
 
     return result;
@@ -233,7 +244,7 @@ bool positional_params_replace(positional_params_t *params,
     // Free old parameters
     if (params->params != NULL)
     {
-        for (int i = 0; i < params->count; i++)
+        for (int i = params->start; i < params->start + params->count; i++)
         {
             if (params->params[i] != NULL)
                 string_destroy(&params->params[i]);
@@ -243,6 +254,7 @@ bool positional_params_replace(positional_params_t *params,
 
     // Set new parameters
     params->params = new_params;
+    params->start = 0;
     params->count = count;
 
     return true;
@@ -260,33 +272,35 @@ bool positional_params_shift(positional_params_t *params, int n)
         return true;
 
     // Free the shifted-out parameters
-    for (int i = 0; i < n; i++)
+    for (int i = params->start; i < params->start + n; i++)
     {
         if (params->params[i] != NULL)
             string_destroy(&params->params[i]);
     }
 
-    int new_count = params->count - n;
+    params->start += n;
+    params->count -= n;
 
-    if (new_count == 0)
+    if (params->count == 0)
     {
         xfree(params->params);
         params->params = NULL;
-        params->count = 0;
+        params->start = 0;
         return true;
     }
 
-    // Allocate new array and copy remaining parameters
-    string_t **new_params = xcalloc((size_t)new_count, sizeof(string_t *));
-    for (int i = 0; i < new_count; i++)
+    // Compact once the dead prefix is larger than what is left. Each
+    // parameter is moved at most once per halving, so shifting through all
+    // of them one at a time is linear overall.
+    if (params->start > params->count)
     {
-        new_params[i] = params->params[i + n];
+        string_t **compact = xcalloc((size_t)params->count, sizeof(string_t *));
+        memcpy(compact, &params->params[params->start], (size_t)params->count * sizeof(string_t *));
+        xfree(params->params);
+        params->params = compact;
+        params->start = 0;
     }
 
-    xfree(params->params);
-    params->params = new_params;
-    params->count = new_count;
-
     return true;
 }
 
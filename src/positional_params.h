@@ -17,7 +17,7 @@
 #include <limits.h>
 
 // Maximum number of positional parameters allowed
-#define POSITIONAL_PARAMS_MAX 4096
+#define POSITIONAL_PARAMS_MAX 1048576
 #if POSITIONAL_PARAMS_MAX <= 0 || POSITIONAL_PARAMS_MAX >= INT_MAX
 #error "POSITIONAL_PARAMS_MAX must be a positive integer less than INT_MAX"
 #endif
@@ -32,7 +32,8 @@
 typedef struct positional_params_t
 {
     string_t *arg0;     ///< Command name or argv[0]
-    string_t **params;  ///< Array of parameters (params[0] is $1)
+    string_t **params;  ///< Array of parameters (params[start] is $1)
+    int start;          ///< Slots before this index have been shifted out
     int count;          ///< Number of parameters not including arg0
     int max_params;     ///< Maximum allowed (for validation)
 } positional_params_t;
@@ -126,6 +127,18 @@ int positional_params_count(const positional_params_t *params);
  */
 strlist_t *positional_params_get_all(const positional_params_t *params);
 
+/**
+ * @brief Borrow the positional parameters as an array (for "$@")
+ *
+ * No strings are copied. The returned array and its strings belong to
+ * `params` and stay valid only until the parameters are next modified.
+ *
+ * @param params The positional parameters
+ * @param count Receives the number of parameters
+ * @return Array where element 0 is $1, or NULL if there are none
+ */
+const string_t *const *positional_params_view(const positional_params_t *params, int *count);
+
 /**
  * @brief Get all positional parameters joined by a separator (for "$*")
  *
@@ -158,6 +171,9 @@ bool positional_params_replace(positional_params_t *params,
  * @brief Shift positional parameters (for 'shift' builtin)
  *
  * Removes the first n parameters. $1 is deleted, $2 becomes $1, etc.
+ * Runs in O(n): the remaining parameters are not moved, only the start
+ * offset advances. The array is compacted once the shifted-out prefix
+ * outgrows the live part, so a shift-per-argument loop stays linear.
  *
  * @param params The positional parameters to modify
  * @param n Number of parameters to shift (typically 1)
@@ -0,0 +1,650 @@
+// ============================================================================
+// printf_format.c
+// Pre-parsed printf format strings and a small cache of them
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "printf_format.h"
+
+#include "logging.h"
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+#include "miga/xalloc.h"
+
+#define PRINTF_FORMAT_CACHE_SLOTS 16
+
+typedef enum printf_item_kind_t
+{
+    PRINTF_ITEM_LITERAL,    // Copy literal text
+    PRINTF_ITEM_CONVERSION, // Consume an argument and format it
+    PRINTF_ITEM_INVALID,    // Unknown conversion: emit it and fail
+    PRINTF_ITEM_STOP        // \c in the format: stop all output
+} printf_item_kind_t;
+
+typedef struct printf_item_t
+{
+    printf_item_kind_t kind;
+
+    // PRINTF_ITEM_LITERAL: a span of fmt->literals
+    int literal_start;
+    int literal_len;
+
+    // PRINTF_ITEM_CONVERSION / PRINTF_ITEM_INVALID
+    char spec;
+    int width;
+    int precision;
+    bool has_precision;
+    bool left_justify;
+    bool zero_pad;
+} printf_item_t;
+
+struct printf_format_t
+{
+    printf_buffer_t literals; // All literal text, escapes decoded
+    printf_item_t *items;
+    int count;
+    int capacity;
+};
+
+typedef struct printf_format_cache_entry_t
+{
+    char *source;
+    unsigned long hash;
+    unsigned long last_used;
+    printf_format_t *fmt;
+} printf_format_cache_entry_t;
+
+struct printf_format_cache_t
+{
+    printf_format_cache_entry_t entries[PRINTF_FORMAT_CACHE_SLOTS];
+    int count;
+    unsigned long tick;
+    int hits;
+    int misses;
+};
+
+// ============================================================================
+// Output Buffer
+// ============================================================================
+
+static void printf_buffer_append(printf_buffer_t *buf, const char *data, int len)
+{
+    if (len <= 0)
+        return;
+    if (buf->len + len > buf->capacity)
+    {
+        while (buf->len + len > buf->capacity)
+            buf->capacity = buf->capacity ? buf->capacity * 2 : 64;
+        buf->data = xrealloc(buf->data, buf->capacity);
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void printf_buffer_append_char(printf_buffer_t *buf, char c)
+{
+    printf_buffer_append(buf, &c, 1);
+}
+
+static void printf_buffer_append_n_chars(printf_buffer_t *buf, int count, char c)
+{
+    while (count-- > 0)
+        printf_buffer_append(buf, &c, 1);
+}
+
+void printf_buffer_free(printf_buffer_t *buf)
+{
+    if (!buf)
+        return;
+    xfree(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->capacity = 0;
+}
+
+// ============================================================================
+// Compilation
+// ============================================================================
+
+static printf_item_t *printf_format_add_item(printf_format_t *fmt, printf_item_kind_t kind)
+{
+    if (fmt->count == fmt->capacity)
+    {
+        fmt->capacity = fmt->capacity ? fmt->capacity * 2 : 8;
+        fmt->items = xrealloc(fmt->items, (size_t)fmt->capacity * sizeof(printf_item_t));
+    }
+    printf_item_t *item = &fmt->items[fmt->count++];
+    memset(item, 0, sizeof(*item));
+    item->kind = kind;
+    item->precision = -1;
+    return item;
+}
+
+/**
+ * Append one literal byte, extending the previous literal item if there
+ * is one so that a run of text renders as a single copy.
+ */
+static void printf_format_add_char(printf_format_t *fmt, char c)
+{
+    printf_item_t *last = fmt->count > 0 ? &fmt->items[fmt->count - 1] : NULL;
+    if (!last || last->kind != PRINTF_ITEM_LITERAL)
+    {
+        last = printf_format_add_item(fmt, PRINTF_ITEM_LITERAL);
+        last->literal_start = fmt->literals.len;
+    }
+    printf_buffer_append_char(&fmt->literals, c);
+    last->literal_len++;
+}
+
+static int printf_parse_number(const char **fmt)
+{
+    int num = 0;
+    while (**fmt >= '0' && **fmt <= '9')
+    {
+        num = num * 10 + (**fmt - '0');
+        (*fmt)++;
+    }
+    return num;
+}
+
+/**
+ * Parse the conversion specification starting at the '%' in *pf.
+ */
+static void printf_format_add_conversion(printf_format_t *fmt, const char **pf)
+{
+    const char *f = *pf + 1; // Skip %
+
+    if (*f == '%')
+    {
+        printf_format_add_char(fmt, '%');
+        *pf = f + 1;
+        return;
+    }
+
+    printf_item_t *item = printf_format_add_item(fmt, PRINTF_ITEM_CONVERSION);
+
+    // Flags: only '-' and '0' affect the output
+    while (*f == '-' || *f == '0' || *f == ' ' || *f == '+' || *f == '#')
+    {
+        if (*f == '-')
+            item->left_justify = true;
+        if (*f == '0')
+            item->zero_pad = true;
+        f++;
+    }
+
+    if (*f >= '0' && *f <= '9')
+        item->width = printf_parse_number(&f);
+
+    if (*f == '.')
+    {
+        f++;
+        item->has_precision = true;
+        item->precision = printf_parse_number(&f);
+    }
+
+    item->spec = *f;
+    if (*f)
+        f++;
+
+    switch (item->spec)
+    {
+    case 'b':
+    case 'c':
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+    case 's':
+        break;
+    default:
+        item->kind = PRINTF_ITEM_INVALID;
+        break;
+    }
+
+    *pf = f;
+}
+
+/**
+ * Decode the backslash escape starting at the '\\' in *pf.
+ */
+static void printf_format_add_escape(printf_format_t *fmt, const char **pf)
+{
+    const char *f = *pf + 1; // Skip backslash
+
+    switch (*f)
+    {
+    case 'a':
+        printf_format_add_char(fmt, '\a');
+        break;
+    case 'b':
+        printf_format_add_char(fmt, '\b');
+        break;
+    case 'c':
+        printf_format_add_item(fmt, PRINTF_ITEM_STOP);
+        break;
+    case 'e':
+        printf_format_add_char(fmt, '\033');
+        break;
+    case 'f':
+        printf_format_add_char(fmt, '\f');
+        break;
+    case 'n':
+        printf_format_add_char(fmt, '\n');
+        break;
+    case 'r':
+        printf_format_add_char(fmt, '\r');
+        break;
+    case 't':
+        printf_format_add_char(fmt, '\t');
+        break;
+    case 'v':
+        printf_format_add_char(fmt, '\v');
+        break;
+    case '\\':
+        printf_format_add_char(fmt, '\\');
+        break;
+    case '0': /* Octal: \0 followed by up to three digits */
+    {
+        int val = 0;
+        int count = 0;
+        f++;
+        while (count < 3 && *f >= '0' && *f <= '7')
+        {
+            val = val * 8 + (*f - '0');
+            f++;
+            count++;
+        }
+        f--;
+        printf_format_add_char(fmt, (char)val);
+        break;
+    }
+    default:
+        printf_format_add_char(fmt, *f);
+        break;
+    }
+
+    *pf = f + 1;
+}
+
+printf_format_t *printf_format_compile(const char *format)
+{
+    Expects_not_null(format);
+
+    printf_format_t *fmt = xcalloc(1, sizeof(printf_format_t));
+
+    const char *f = format;
+    while (*f)
+    {
+        if (*f == '%' && *(f + 1))
+            printf_format_add_conversion(fmt, &f);
+        else if (*f == '\\' && *(f + 1))
+            printf_format_add_escape(fmt, &f);
+        else
+            printf_format_add_char(fmt, *f++);
+    }
+
+    return fmt;
+}
+
+void printf_format_destroy(printf_format_t **fmt)
+{
+    if (!fmt || !*fmt)
+        return;
+
+    printf_buffer_free(&(*fmt)->literals);
+    xfree((*fmt)->items);
+    xfree(*fmt);
+    *fmt = NULL;
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+/**
+ * Interpret backslash escapes in a %b argument. Sets *stop on \c.
+ */
+static void printf_append_escaped(printf_buffer_t *out, const char *str, bool *stop)
+{
+    const char *p = str;
+
+    while (*p)
+    {
+        if (*p == '\\' && *(p + 1))
+        {
+            p++;
+            switch (*p)
+            {
+            case 'a':
+                printf_buffer_append_char(out, '\a');
+                break;
+            case 'b':
+                printf_buffer_append_char(out, '\b');
+                break;
+            case 'c':
+                *stop = true;
+                return;
+            case 'e': /* Extension: ESC */
+            case 'E':
+                printf_buffer_append_char(out, '\033');
+                break;
+            case 'f':
+                printf_buffer_append_char(out, '\f');
+                break;
+            case 'n':
+                printf_buffer_append_char(out, '\n');
+                break;
+            case 'r':
+                printf_buffer_append_char(out, '\r');
+                break;
+            case 't':
+                printf_buffer_append_char(out, '\t');
+                break;
+            case 'v':
+                printf_buffer_append_char(out, '\v');
+                break;
+            case '\\':
+                printf_buffer_append_char(out, '\\');
+                break;
+            case '0': /* Octal */
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7': {
+                int val = 0;
+                int count = 0;
+                while (count < 3 && *p >= '0' && *p <= '7')
+                {
+                    val = val * 8 + (*p - '0');
+                    p++;
+                    count++;
+                }
+                p--; /* Back up for loop increment */
+                char c = (char)val;
+                printf_buffer_append(out, &c, 1);
+                break;
+            }
+            default:
+                /* Unknown escape - print literally */
+                printf_buffer_append_char(out, '\\');
+                printf_buffer_append_char(out, *p);
+                break;
+            }
+            p++;
+        }
+        else
+        {
+            printf_buffer_append_char(out, *p++);
+        }
+    }
+}
+
+/**
+ * Append `len` bytes of `str` padded to the item's width.
+ */
+static void printf_append_padded(printf_buffer_t *out, const printf_item_t *item, const char *str,
+                                 int len)
+{
+    int pad = item->width > len ? item->width - len : 0;
+
+    if (pad > 0 && !item->left_justify)
+        printf_buffer_append_n_chars(out, pad, ' ');
+    printf_buffer_append(out, str, len);
+    if (pad > 0 && item->left_justify)
+        printf_buffer_append_n_chars(out, pad, ' ');
+}
+
+/**
+ * Format an integer conversion with snprintf(), building the C format from
+ * the item's flags.
+ */
+static void printf_append_integer(printf_buffer_t *out, const printf_item_t *item, const char *arg)
+{
+    char cfmt[16];
+    int n = 0;
+
+    cfmt[n++] = '%';
+    if (item->left_justify)
+        cfmt[n++] = '-';
+    else if (item->zero_pad && !item->has_precision && item->width > 0)
+        cfmt[n++] = '0';
+    cfmt[n++] = '*';
+    if (item->has_precision)
+    {
+        cfmt[n++] = '.';
+        cfmt[n++] = '*';
+    }
+    cfmt[n++] = 'l';
+    cfmt[n++] = item->spec == 'i' ? 'd' : item->spec;
+    cfmt[n] = '\0';
+
+    char buf[64];
+    char *dst = buf;
+    int len = 0;
+    bool is_signed = item->spec == 'd' || item->spec == 'i';
+    long sval = 0;
+    unsigned long uval = 0;
+
+    if (is_signed)
+        sval = *arg ? strtol(arg, NULL, 0) : 0;
+    else
+        uval = *arg ? strtoul(arg, NULL, 0) : 0;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        size_t size = dst == buf ? sizeof(buf) : (size_t)len + 1;
+        if (item->has_precision)
+            len = is_signed ? snprintf(dst, size, cfmt, item->width, item->precision, sval)
+                            : snprintf(dst, size, cfmt, item->width, item->precision, uval);
+        else
+            len = is_signed ? snprintf(dst, size, cfmt, item->width, sval)
+                            : snprintf(dst, size, cfmt, item->width, uval);
+        if (len < 0)
+            return;
+        if ((size_t)len < size)
+            break;
+        dst = xmalloc((size_t)len + 1); // Very wide field: retry with enough room
+    }
+
+    printf_buffer_append(out, dst, len);
+    if (dst != buf)
+        xfree(dst);
+}
+
+/**
+ * Render one conversion. Sets *stop if a %b argument contained \c.
+ */
+static void printf_render_conversion(printf_buffer_t *out, const printf_item_t *item, const char *arg,
+                                     bool *stop)
+{
+    switch (item->spec)
+    {
+    case 'b': {
+        printf_buffer_t processed = {0};
+        printf_append_escaped(&processed, arg, stop);
+        printf_append_padded(out, item, processed.data, processed.len);
+        printf_buffer_free(&processed);
+        break;
+    }
+
+    case 'c': {
+        char c = *arg;
+        printf_append_padded(out, item, &c, 1);
+        break;
+    }
+
+    case 's': {
+        int len = (int)strlen(arg);
+        if (item->has_precision && item->precision < len)
+            len = item->precision;
+        printf_append_padded(out, item, arg, len);
+        break;
+    }
+
+    default:
+        printf_append_integer(out, item, arg);
+        break;
+    }
+}
+
+int printf_format_render(const printf_format_t *fmt, const strlist_t *args, int first_arg,
+                         printf_buffer_t *out)
+{
+    Expects_not_null(fmt);
+    Expects_not_null(args);
+    Expects_not_null(out);
+
+    int argc = strlist_size(args);
+    int arg_index = first_arg;
+    const char *literals = fmt->literals.data;
+    bool stop = false;
+
+    while (!stop)
+    {
+        bool format_used = false;
+
+        for (int i = 0; i < fmt->count && !stop; i++)
+        {
+            const printf_item_t *item = &fmt->items[i];
+            switch (item->kind)
+            {
+            case PRINTF_ITEM_LITERAL:
+                printf_buffer_append(out, literals + item->literal_start, item->literal_len);
+                break;
+
+            case PRINTF_ITEM_CONVERSION: {
+                /* Missing arguments format as empty strings or zero */
+                const char *arg = "";
+                if (arg_index < argc)
+                {
+                    arg = string_cstr(strlist_at(args, arg_index++));
+                    format_used = true;
+                }
+                printf_render_conversion(out, item, arg, &stop);
+                break;
+            }
+
+            case PRINTF_ITEM_INVALID:
+                printf_buffer_append_char(out, '%');
+                if (item->spec)
+                    printf_buffer_append_char(out, item->spec);
+                return 1;
+
+            case PRINTF_ITEM_STOP:
+                stop = true;
+                break;
+            }
+        }
+
+        /* Reuse the format while arguments remain */
+        if (!format_used || arg_index >= argc)
+            break;
+    }
+
+    return 0;
+}
+
+// ============================================================================
+// Format Cache
+// ============================================================================
+
+static unsigned long printf_format_hash(const char *s)
+{
+    unsigned long h = 2166136261UL; // FNV-1a
+    for (; *s; s++)
+    {
+        h ^= (unsigned char)*s;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+printf_format_cache_t *printf_format_cache_create(void)
+{
+    return xcalloc(1, sizeof(printf_format_cache_t));
+}
+
+void printf_format_cache_destroy(printf_format_cache_t **cache)
+{
+    if (!cache || !*cache)
+        return;
+
+    for (int i = 0; i < (*cache)->count; i++)
+    {
+        xfree((*cache)->entries[i].source);
+        printf_format_destroy(&(*cache)->entries[i].fmt);
+    }
+    xfree(*cache);
+    *cache = NULL;
+}
+
+const printf_format_t *printf_format_cache_get(printf_format_cache_t *cache, const char *format)
+{
+    Expects_not_null(cache);
+    Expects_not_null(format);
+
+    unsigned long hash = printf_format_hash(format);
+    cache->tick++;
+
+    for (int i = 0; i < cache->count; i++)
+    {
+        printf_format_cache_entry_t *e = &cache->entries[i];
+        if (e->hash == hash && strcmp(e->source, format) == 0)
+        {
+            e->last_used = cache->tick;
+            cache->hits++;
+            return e->fmt;
+        }
+    }
+
+    cache->misses++;
+
+    printf_format_cache_entry_t *slot;
+    if (cache->count < PRINTF_FORMAT_CACHE_SLOTS)
+    {
+        slot = &cache->entries[cache->count++];
+    }
+    else
+    {
+        slot = &cache->entries[0];
+        for (int i = 1; i < cache->count; i++)
+        {
+            if (cache->entries[i].last_used < slot->last_used)
+                slot = &cache->entries[i];
+        }
+        xfree(slot->source);
+        printf_format_destroy(&slot->fmt);
+    }
+
+    slot->source = xstrdup(format);
+    slot->hash = hash;
+    slot->last_used = cache->tick;
+    slot->fmt = printf_format_compile(format);
+    return slot->fmt;
+}
+
+int printf_format_cache_hits(const printf_format_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->hits;
+}
+
+int printf_format_cache_misses(const printf_format_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->misses;
+}
@@ -0,0 +1,64 @@
+// ============================================================================
+// printf_format.h
+// Pre-parsed printf format strings and a small cache of them
+// ============================================================================
+
+#ifndef PRINTF_FORMAT_H
+#define PRINTF_FORMAT_H
+
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+
+// ============================================================================
+// Compiled Format
+//
+// A format string is parsed once into a list of items: runs of literal text
+// (with backslash escapes already decoded), conversion specifications, and
+// the \c stop marker. Rendering walks the item list and never looks at the
+// format text again.
+// ============================================================================
+
+typedef struct printf_format_t printf_format_t;
+
+// Rendered output. Unlike a string_t it may hold NUL bytes, which \0 and a
+// %c of an empty argument produce.
+typedef struct printf_buffer_t
+{
+    char *data;
+    int len;
+    int capacity;
+} printf_buffer_t;
+
+void printf_buffer_free(printf_buffer_t *buf);
+
+printf_format_t *printf_format_compile(const char *format);
+void printf_format_destroy(printf_format_t **fmt);
+
+// Render the format with args[first_arg..] appended to `out`. The format is
+// reused while arguments remain, as POSIX printf requires. Returns 0 on
+// success, or 1 if the format contains an invalid conversion; in that case
+// `out` holds the output produced up to and including the bad directive.
+int printf_format_render(const printf_format_t *fmt, const strlist_t *args, int first_arg,
+                         printf_buffer_t *out);
+
+// ============================================================================
+// Format Cache
+//
+// Scripts tend to call printf with the same handful of formats over and
+// over, so the executor keeps the most recently used compiled formats.
+// ============================================================================
+
+typedef struct printf_format_cache_t printf_format_cache_t;
+
+printf_format_cache_t *printf_format_cache_create(void);
+void printf_format_cache_destroy(printf_format_cache_t **cache);
+
+// Return the compiled form of `format`, compiling it on a miss and evicting
+// the least recently used entry if the cache is full. The result is owned
+// by the cache and valid until the next call.
+const printf_format_t *printf_format_cache_get(printf_format_cache_t *cache, const char *format);
+
+int printf_format_cache_hits(const printf_format_cache_t *cache);
+int printf_format_cache_misses(const printf_format_cache_t *cache);
+
+#endif /* PRINTF_FORMAT_H */
@@ -0,0 +1,474 @@
+// ============================================================================
+// profiler.c
+// Wall and CPU time profiler for shell scripts
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef MIGA_POSIX_API
+#define _POSIX_C_SOURCE 202405L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef MIGA_POSIX_API
+#include <unistd.h>
+#elifdef MIGA_UCRT_API
+#include <process.h>
+#endif
+
+#include "profiler.h"
+
+#include "logging.h"
+#include "miga/string_t.h"
+#include "miga/xalloc.h"
+
+#define PROFILER_LINES_INITIAL_CAPACITY 64
+#define PROFILER_NAME_MAX 128
+
+static const char *profiler_category_names[PROFILER_CATEGORY_COUNT] = {
+    "shell", "expand", "builtin", "fork", "wait"};
+
+// A node of the calling-context tree: one per distinct call stack
+typedef struct profiler_node_t
+{
+    char *name;
+    profiler_category_t category;
+    struct profiler_node_t *parent;
+    struct profiler_node_t *first_child;
+    struct profiler_node_t *next_sibling;
+    uint64_t self_wall_ns;
+    uint64_t self_cpu_ns;
+} profiler_node_t;
+
+// Time charged to one source line. An unused slot has file == -1.
+typedef struct profiler_line_t
+{
+    int file;
+    int line;
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+    long hits;
+} profiler_line_t;
+
+typedef struct profiler_location_t
+{
+    int file;
+    int line;
+} profiler_location_t;
+
+struct profiler_t
+{
+    char *output_path;
+    long owner_pid;
+
+    profiler_node_t *root;
+    profiler_node_t *current;
+
+    // Source names seen so far; lines refer to them by index
+    char **files;
+    int file_count;
+    int file_capacity;
+
+    // Open-addressed table of per-line totals
+    profiler_line_t *lines;
+    int line_count;
+    int line_capacity;
+
+    profiler_location_t location;
+
+    // Caller locations saved by profiler_push_function()
+    profiler_location_t *saved;
+    int saved_count;
+    int saved_capacity;
+
+    uint64_t last_wall_ns;
+    uint64_t last_cpu_ns;
+    uint64_t category_wall_ns[PROFILER_CATEGORY_COUNT];
+    uint64_t category_cpu_ns[PROFILER_CATEGORY_COUNT];
+};
+
+// ============================================================================
+// Internal Helper Functions
+// ============================================================================
+
+static long profiler_getpid(void)
+{
+#ifdef MIGA_POSIX_API
+    return (long)getpid();
+#elifdef MIGA_UCRT_API
+    return (long)_getpid();
+#else
+    return 0; // No fork in ISO C, so there is only ever one owner
+#endif
+}
+
+uint64_t profiler_wall_clock_ns(void)
+{
+    struct timespec ts;
+#ifdef MIGA_POSIX_API
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void profiler_now(uint64_t *wall_ns, uint64_t *cpu_ns)
+{
+    *wall_ns = profiler_wall_clock_ns();
+#ifdef MIGA_POSIX_API
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    *cpu_ns = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+    *cpu_ns = (uint64_t)((double)clock() * (1e9 / (double)CLOCKS_PER_SEC));
+#endif
+}
+
+static profiler_node_t *profiler_node_create(const char *name, profiler_category_t category,
+                                             profiler_node_t *parent)
+{
+    profiler_node_t *node = xcalloc(1, sizeof(profiler_node_t));
+    node->name = xstrdup(name);
+    node->category = category;
+    node->parent = parent;
+    if (parent)
+    {
+        node->next_sibling = parent->first_child;
+        parent->first_child = node;
+    }
+    return node;
+}
+
+static void profiler_node_destroy(profiler_node_t *node)
+{
+    while (node)
+    {
+        profiler_node_t *next = node->next_sibling;
+        profiler_node_destroy(node->first_child);
+        xfree(node->name);
+        xfree(node);
+        node = next;
+    }
+}
+
+static profiler_node_t *profiler_node_child(profiler_node_t *parent, const char *name,
+                                            profiler_category_t category)
+{
+    for (profiler_node_t *c = parent->first_child; c; c = c->next_sibling)
+    {
+        if (c->category == category && strcmp(c->name, name) == 0)
+            return c;
+    }
+    return profiler_node_create(name, category, parent);
+}
+
+static int profiler_file_index(profiler_t *prof, const char *source_name)
+{
+    if (prof->location.file >= 0 && strcmp(prof->files[prof->location.file], source_name) == 0)
+        return prof->location.file;
+
+    for (int i = 0; i < prof->file_count; i++)
+    {
+        if (strcmp(prof->files[i], source_name) == 0)
+            return i;
+    }
+
+    if (prof->file_count == prof->file_capacity)
+    {
+        prof->file_capacity = prof->file_capacity ? prof->file_capacity * 2 : 4;
+        prof->files = xrealloc(prof->files, (size_t)prof->file_capacity * sizeof(char *));
+    }
+    prof->files[prof->file_count] = xstrdup(source_name);
+    return prof->file_count++;
+}
+
+static size_t profiler_line_hash(int file, int line)
+{
+    return ((size_t)file * 31u + (size_t)line) * 2654435761u;
+}
+
+static void profiler_lines_grow(profiler_t *prof)
+{
+    profiler_line_t *old = prof->lines;
+    int old_capacity = prof->line_capacity;
+
+    prof->line_capacity = old_capacity ? old_capacity * 2 : PROFILER_LINES_INITIAL_CAPACITY;
+    prof->lines = xmalloc((size_t)prof->line_capacity * sizeof(profiler_line_t));
+    for (int i = 0; i < prof->line_capacity; i++)
+        prof->lines[i].file = -1;
+
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (old[i].file < 0)
+            continue;
+        size_t mask = (size_t)prof->line_capacity - 1;
+        size_t j = profiler_line_hash(old[i].file, old[i].line) & mask;
+        while (prof->lines[j].file >= 0)
+            j = (j + 1) & mask;
+        prof->lines[j] = old[i];
+    }
+    xfree(old);
+}
+
+static profiler_line_t *profiler_line_get(profiler_t *prof, int file, int line)
+{
+    if ((prof->line_count + 1) * 10 > prof->line_capacity * 7)
+        profiler_lines_grow(prof);
+
+    size_t mask = (size_t)prof->line_capacity - 1;
+    size_t j = profiler_line_hash(file, line) & mask;
+    while (prof->lines[j].file >= 0)
+    {
+        if (prof->lines[j].file == file && prof->lines[j].line == line)
+            return &prof->lines[j];
+        j = (j + 1) & mask;
+    }
+
+    profiler_line_t *entry = &prof->lines[j];
+    memset(entry, 0, sizeof(*entry));
+    entry->file = file;
+    entry->line = line;
+    prof->line_count++;
+    return entry;
+}
+
+/**
+ * Charge the time since the previous event to the current stack and line.
+ */
+static void profiler_charge(profiler_t *prof)
+{
+    uint64_t wall, cpu;
+    profiler_now(&wall, &cpu);
+
+    uint64_t dw = wall - prof->last_wall_ns;
+    uint64_t dc = cpu >= prof->last_cpu_ns ? cpu - prof->last_cpu_ns : 0;
+    prof->last_wall_ns = wall;
+    prof->last_cpu_ns = cpu;
+
+    prof->current->self_wall_ns += dw;
+    prof->current->self_cpu_ns += dc;
+    prof->category_wall_ns[prof->current->category] += dw;
+    prof->category_cpu_ns[prof->current->category] += dc;
+
+    if (prof->location.file >= 0)
+    {
+        profiler_line_t *entry = profiler_line_get(prof, prof->location.file, prof->location.line);
+        entry->wall_ns += dw;
+        entry->cpu_ns += dc;
+    }
+}
+
+static void profiler_write_node(FILE *fp, const profiler_node_t *node, string_t *path)
+{
+    for (; node; node = node->next_sibling)
+    {
+        int len = string_length(path);
+        if (len > 0)
+            string_append_char(path, ';');
+        string_append_cstr(path, node->name);
+
+        unsigned long long us = node->self_wall_ns / 1000u;
+        if (us > 0)
+            fprintf(fp, "%s %llu\n", string_cstr(path), us);
+        profiler_write_node(fp, node->first_child, path);
+
+        string_resize(path, len);
+    }
+}
+
+static int profiler_line_compare(const void *a, const void *b)
+{
+    const profiler_line_t *la = a;
+    const profiler_line_t *lb = b;
+    if (la->wall_ns != lb->wall_ns)
+        return la->wall_ns < lb->wall_ns ? 1 : -1;
+    if (la->file != lb->file)
+        return la->file - lb->file;
+    return la->line - lb->line;
+}
+
+static bool profiler_write_lines(const profiler_t *prof, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return false;
+
+    profiler_line_t *sorted = xcalloc((size_t)prof->line_count + 1, sizeof(profiler_line_t));
+    int n = 0;
+    for (int i = 0; i < prof->line_capacity; i++)
+    {
+        if (prof->lines[i].file >= 0)
+            sorted[n++] = prof->lines[i];
+    }
+    qsort(sorted, (size_t)n, sizeof(profiler_line_t), profiler_line_compare);
+
+    fprintf(fp, "# %12s %12s %10s  %s\n", "wall_us", "cpu_us", "count", "location");
+    for (int i = 0; i < n; i++)
+    {
+        fprintf(fp, "  %12llu %12llu %10ld  %s:%d\n",
+                (unsigned long long)(sorted[i].wall_ns / 1000u),
+                (unsigned long long)(sorted[i].cpu_ns / 1000u), sorted[i].hits,
+                prof->files[sorted[i].file], sorted[i].line);
+    }
+    xfree(sorted);
+
+    fprintf(fp, "#\n# %12s %12s  %s\n", "wall_us", "cpu_us", "category");
+    for (int c = 0; c < PROFILER_CATEGORY_COUNT; c++)
+    {
+        fprintf(fp, "# %12llu %12llu  %s\n",
+                (unsigned long long)(prof->category_wall_ns[c] / 1000u),
+                (unsigned long long)(prof->category_cpu_ns[c] / 1000u),
+                profiler_category_names[c]);
+    }
+
+    return fclose(fp) == 0;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+profiler_t *profiler_create(const char *output_path)
+{
+    Expects_not_null(output_path);
+
+    profiler_t *prof = xcalloc(1, sizeof(profiler_t));
+    prof->output_path = xstrdup(output_path);
+    prof->owner_pid = profiler_getpid();
+    prof->root = profiler_node_create("main", PROFILER_SHELL, NULL);
+    prof->current = prof->root;
+    prof->location.file = -1;
+    profiler_lines_grow(prof);
+    profiler_now(&prof->last_wall_ns, &prof->last_cpu_ns);
+    return prof;
+}
+
+void profiler_destroy(profiler_t **prof)
+{
+    if (!prof || !*prof)
+        return;
+
+    profiler_t *p = *prof;
+    profiler_node_destroy(p->root);
+    for (int i = 0; i < p->file_count; i++)
+        xfree(p->files[i]);
+    xfree(p->files);
+    xfree(p->lines);
+    xfree(p->saved);
+    xfree(p->output_path);
+    xfree(p);
+    *prof = NULL;
+}
+
+void profiler_set_line(profiler_t *prof, const char *source_name, int line)
+{
+    Expects_not_null(prof);
+
+    int file = profiler_file_index(prof, source_name ? source_name : "-");
+    if (file == prof->location.file && line == prof->location.line)
+        return;
+
+    profiler_charge(prof);
+    prof->location.file = file;
+    prof->location.line = line;
+    profiler_line_get(prof, file, line)->hits++;
+}
+
+void profiler_push_function(profiler_t *prof, const char *name)
+{
+    Expects_not_null(prof);
+    Expects_not_null(name);
+
+    profiler_charge(prof);
+    if (prof->saved_count == prof->saved_capacity)
+    {
+        prof->saved_capacity = prof->saved_capacity ? prof->saved_capacity * 2 : 8;
+        prof->saved = xrealloc(prof->saved,
+                               (size_t)prof->saved_capacity * sizeof(profiler_location_t));
+    }
+    prof->saved[prof->saved_count++] = prof->location;
+    prof->current = profiler_node_child(prof->current, name, PROFILER_SHELL);
+}
+
+void profiler_pop_function(profiler_t *prof)
+{
+    Expects_not_null(prof);
+
+    if (prof->saved_count == 0)
+        return;
+
+    profiler_charge(prof);
+    if (prof->current->parent)
+        prof->current = prof->current->parent;
+    prof->location = prof->saved[--prof->saved_count];
+}
+
+void profiler_enter(profiler_t *prof, profiler_category_t category, const char *detail)
+{
+    Expects_not_null(prof);
+
+    char name[PROFILER_NAME_MAX];
+    if (detail)
+        snprintf(name, sizeof(name), "[%s:%s]", profiler_category_names[category], detail);
+    else
+        snprintf(name, sizeof(name), "[%s]", profiler_category_names[category]);
+
+    profiler_charge(prof);
+    prof->current = profiler_node_child(prof->current, name, category);
+}
+
+void profiler_leave(profiler_t *prof)
+{
+    Expects_not_null(prof);
+
+    profiler_charge(prof);
+    if (prof->current->parent)
+        prof->current = prof->current->parent;
+}
+
+bool profiler_write(profiler_t *prof)
+{
+    Expects_not_null(prof);
+
+    if (profiler_getpid() != prof->owner_pid)
+        return false;
+
+    profiler_charge(prof);
+
+    FILE *fp = fopen(prof->output_path, "w");
+    if (!fp)
+        return false;
+    string_t *path = string_create();
+    profiler_write_node(fp, prof->root, path);
+    string_destroy(&path);
+    bool ok = fclose(fp) == 0;
+
+    string_t *lines_path = string_create_from_cstr(prof->output_path);
+    string_append_cstr(lines_path, ".lines");
+    ok = profiler_write_lines(prof, string_cstr(lines_path)) && ok;
+    string_destroy(&lines_path);
+
+    return ok;
+}
+
+uint64_t profiler_category_wall_ns(const profiler_t *prof, profiler_category_t category)
+{
+    Expects_not_null(prof);
+    return prof->category_wall_ns[category];
+}
+
+uint64_t profiler_total_wall_ns(const profiler_t *prof)
+{
+    Expects_not_null(prof);
+    uint64_t total = 0;
+    for (int c = 0; c < PROFILER_CATEGORY_COUNT; c++)
+        total += prof->category_wall_ns[c];
+    return total;
+}
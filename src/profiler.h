@@ -0,0 +1,74 @@
+// ============================================================================
+// profiler.h
+// Wall and CPU time profiler for shell scripts
+// ============================================================================
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ============================================================================
+// Profiler
+//
+// The executor reports events as it runs: the current source line changed,
+// a shell function was entered or left, or time is about to be spent in one
+// of the categories below. At every event the time elapsed since the
+// previous one is charged to the current line and to the current call
+// stack, so each nanosecond is counted exactly once (self time).
+//
+// Call stacks are kept as a calling-context tree whose nodes are shell
+// function frames and, at the leaves, category frames such as
+// "[builtin:echo]" or "[wait]". When the profile is written the tree is
+// flattened into folded stacks ("main;build;[wait] 1234"), the input
+// format of flamegraph.pl and compatible tools, with wall time in
+// microseconds as the sample count. A second file, named after the first
+// with ".lines" appended, lists source lines by descending wall time.
+// ============================================================================
+
+typedef enum profiler_category_t
+{
+    PROFILER_SHELL,   // Interpreting the script itself
+    PROFILER_EXPAND,  // Word expansion
+    PROFILER_BUILTIN, // Running a builtin
+    PROFILER_FORK,    // Creating a child process
+    PROFILER_WAIT,    // Waiting for a child process
+    PROFILER_CATEGORY_COUNT
+} profiler_category_t;
+
+typedef struct profiler_t profiler_t;
+
+// Start profiling. `output_path` names the folded-stack file written by
+// profiler_write(). Only the process that created the profiler writes it,
+// so forked children that inherit it do not clobber the output.
+profiler_t *profiler_create(const char *output_path);
+void profiler_destroy(profiler_t **prof);
+
+// Note the source line about to execute. `source_name` may be NULL.
+void profiler_set_line(profiler_t *prof, const char *source_name, int line);
+
+// Enter or leave a shell function frame. The current line is saved on
+// entry and restored on exit, so the rest of the calling command is not
+// charged to the function's last line.
+void profiler_push_function(profiler_t *prof, const char *name);
+void profiler_pop_function(profiler_t *prof);
+
+// Enter or leave a category. `detail` (may be NULL) is added to the frame
+// name, e.g. the builtin name. Enter and leave calls must nest.
+void profiler_enter(profiler_t *prof, profiler_category_t category, const char *detail);
+void profiler_leave(profiler_t *prof);
+
+// Write the folded stacks and the line hot list. Returns false if either
+// file could not be written, or if called from a forked child.
+bool profiler_write(profiler_t *prof);
+
+// Monotonic wall clock in nanoseconds; also used for the executor's
+// parse and execution time counters
+uint64_t profiler_wall_clock_ns(void);
+
+// Totals so far, in nanoseconds, mostly for testing
+uint64_t profiler_category_wall_ns(const profiler_t *prof, profiler_category_t category);
+uint64_t profiler_total_wall_ns(const profiler_t *prof);
+
+#endif /* PROFILER_H */
@@ -0,0 +1,386 @@
+// ============================================================================
+// prompt.c
+// Pre-parsed PS1/PS2 prompts, rendered again only when their inputs change
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "prompt.h"
+
+#include "logging.h"
+#include "miga/string_t.h"
+#include "miga/xalloc.h"
+#include "variable_store.h"
+
+typedef enum prompt_segment_kind_t
+{
+    PROMPT_SEGMENT_LITERAL,     // Text copied as is, escapes decoded
+    PROMPT_SEGMENT_VARIABLE,    // $NAME or ${NAME}
+    PROMPT_SEGMENT_EXIT_STATUS, // $?
+    PROMPT_SEGMENT_SHELL_PID    // $$
+} prompt_segment_kind_t;
+
+typedef struct prompt_segment_t
+{
+    prompt_segment_kind_t kind;
+    string_t *text; // LITERAL: the text; VARIABLE: the value last rendered
+    string_t *name; // VARIABLE: the variable name
+    bool braced;    // VARIABLE: written as ${NAME}
+} prompt_segment_t;
+
+struct prompt_cache_t
+{
+    string_t *name;
+    string_t *default_value;
+    bool expand;
+
+    // The prompt value and its segments
+    string_t *source;
+    prompt_segment_t *segments;
+    int count;
+    int capacity;
+    bool uses_exit_status;
+    bool uses_shell_pid;
+
+    // What the rendered prompt was made from
+    bool valid;
+    const variable_store_t *store;
+    uint32_t generation;
+    prompt_params_t params;
+    string_t *rendered;
+
+    int hits;
+    int parses;
+};
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+static prompt_segment_t *prompt_add_segment(prompt_cache_t *cache, prompt_segment_kind_t kind)
+{
+    if (cache->count == cache->capacity)
+    {
+        cache->capacity = cache->capacity ? cache->capacity * 2 : 8;
+        cache->segments = xrealloc(cache->segments, cache->capacity * sizeof(prompt_segment_t));
+    }
+    prompt_segment_t *seg = &cache->segments[cache->count++];
+    memset(seg, 0, sizeof(*seg));
+    seg->kind = kind;
+    return seg;
+}
+
+// The literal segment at the end, started if need be
+static string_t *prompt_literal(prompt_cache_t *cache)
+{
+    if (cache->count == 0 || cache->segments[cache->count - 1].kind != PROMPT_SEGMENT_LITERAL)
+        prompt_add_segment(cache, PROMPT_SEGMENT_LITERAL)->text = string_create();
+    return cache->segments[cache->count - 1].text;
+}
+
+static void prompt_add_variable(prompt_cache_t *cache, const char *name, int len, bool braced)
+{
+    prompt_segment_t *seg = prompt_add_segment(cache, PROMPT_SEGMENT_VARIABLE);
+    seg->name = string_create_from_cstr_len(name, len);
+    seg->text = string_create();
+    seg->braced = braced;
+}
+
+static void prompt_clear_segments(prompt_cache_t *cache)
+{
+    for (int i = 0; i < cache->count; i++)
+    {
+        if (cache->segments[i].text)
+            string_destroy(&cache->segments[i].text);
+        if (cache->segments[i].name)
+            string_destroy(&cache->segments[i].name);
+    }
+    cache->count = 0;
+    cache->uses_exit_status = false;
+    cache->uses_shell_pid = false;
+}
+
+static bool is_name_char(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Number of hex digits at p, up to max
+static int count_hex_digits(const char *p, int max)
+{
+    int n = 0;
+    while (n < max && isxdigit((unsigned char)p[n]))
+        n++;
+    return n;
+}
+
+// Decode the escape after a backslash at p[0]; returns the characters used
+static int prompt_parse_escape(string_t *out, const char *p)
+{
+    int digits = 0;
+    switch (p[0])
+    {
+    case '\0':
+        // Trailing backslash
+        string_append_char(out, '\\');
+        return 0;
+    case 'n':
+        string_append_char(out, '\n');
+        return 1;
+    case 'r':
+        string_append_char(out, '\r');
+        return 1;
+    case 't':
+        string_append_char(out, '\t');
+        return 1;
+    case '\\':
+        string_append_char(out, '\\');
+        return 1;
+    case 'x':
+        digits = 2;
+        break;
+    case 'u':
+        digits = 4;
+        break;
+    case 'U':
+        digits = 6;
+        break;
+    default:
+        string_append_char(out, '\\');
+        string_append_char(out, p[0]);
+        return 1;
+    }
+
+    if (count_hex_digits(p + 1, digits) < digits)
+    {
+        // Not enough hex digits: copy the escape, and go on after it
+        string_append_char(out, '\\');
+        string_append_char(out, p[0]);
+        return 1;
+    }
+    char hex[8];
+    memcpy(hex, p + 1, digits);
+    hex[digits] = '\0';
+    string_append_utf8(out, (uint32_t)strtoul(hex, NULL, 16));
+    return 1 + digits;
+}
+
+static void prompt_parse(prompt_cache_t *cache, const string_t *source)
+{
+    prompt_clear_segments(cache);
+    if (cache->source)
+        string_set(cache->source, source);
+    else
+        cache->source = string_create_from(source);
+    cache->parses++;
+
+    const char *p = string_cstr(source);
+    if (!cache->expand)
+    {
+        string_append(prompt_literal(cache), source);
+        return;
+    }
+
+    while (*p)
+    {
+        if (*p == '\\')
+        {
+            p++;
+            p += prompt_parse_escape(prompt_literal(cache), p);
+            continue;
+        }
+        if (*p != '$')
+        {
+            string_append_char(prompt_literal(cache), *p++);
+            continue;
+        }
+
+        p++; // consume '$'
+        if (*p == '{')
+        {
+            const char *close = strchr(p + 1, '}');
+            if (!close || close == p + 1)
+            {
+                // No closing brace, or no name: copy "${" literally
+                string_append_cstr(prompt_literal(cache), "${");
+                p++;
+                continue;
+            }
+            prompt_add_variable(cache, p + 1, (int)(close - p - 1), true);
+            p = close + 1;
+        }
+        else if (*p == '?')
+        {
+            prompt_add_segment(cache, PROMPT_SEGMENT_EXIT_STATUS);
+            cache->uses_exit_status = true;
+            p++;
+        }
+        else if (*p == '$')
+        {
+            prompt_add_segment(cache, PROMPT_SEGMENT_SHELL_PID);
+            cache->uses_shell_pid = true;
+            p++;
+        }
+        else if (*p == '_' || isalpha((unsigned char)*p))
+        {
+            const char *start = p;
+            while (is_name_char(*p))
+                p++;
+            prompt_add_variable(cache, start, (int)(p - start), false);
+        }
+        else
+        {
+            // A '$' that starts no parameter is copied; the next character
+            // is handled by the next iteration.
+            string_append_char(prompt_literal(cache), '$');
+        }
+    }
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+static void prompt_lookup_variables(prompt_cache_t *cache, const variable_store_t *vars)
+{
+    for (int i = 0; i < cache->count; i++)
+    {
+        prompt_segment_t *seg = &cache->segments[i];
+        if (seg->kind != PROMPT_SEGMENT_VARIABLE)
+            continue;
+
+        const string_t *value = variable_store_get_value(vars, seg->name);
+        if (value)
+        {
+            string_set(seg->text, value);
+            continue;
+        }
+        // Unset: show the reference as written
+        string_set_cstr(seg->text, seg->braced ? "${" : "$");
+        string_append(seg->text, seg->name);
+        if (seg->braced)
+            string_append_char(seg->text, '}');
+    }
+}
+
+static void prompt_concatenate(prompt_cache_t *cache, const prompt_params_t *params)
+{
+    string_clear(cache->rendered);
+    for (int i = 0; i < cache->count; i++)
+    {
+        const prompt_segment_t *seg = &cache->segments[i];
+        switch (seg->kind)
+        {
+        case PROMPT_SEGMENT_LITERAL:
+        case PROMPT_SEGMENT_VARIABLE:
+            string_append(cache->rendered, seg->text);
+            break;
+        case PROMPT_SEGMENT_EXIT_STATUS: {
+            string_t *num = string_from_int(params->exit_status);
+            string_append(cache->rendered, num);
+            string_destroy(&num);
+            break;
+        }
+        case PROMPT_SEGMENT_SHELL_PID:
+            if (params->shell_pid_valid)
+            {
+                string_t *num = string_from_int(params->shell_pid);
+                string_append(cache->rendered, num);
+                string_destroy(&num);
+            }
+            else
+            {
+                string_append_cstr(cache->rendered, "$$");
+            }
+            break;
+        }
+    }
+}
+
+prompt_cache_t *prompt_cache_create(const char *name, const char *default_value, bool expand)
+{
+    Expects_not_null(name);
+    Expects_not_null(default_value);
+
+    prompt_cache_t *cache = xcalloc(1, sizeof(prompt_cache_t));
+    cache->name = string_create_from_cstr(name);
+    cache->default_value = string_create_from_cstr(default_value);
+    cache->expand = expand;
+    cache->rendered = string_create();
+    return cache;
+}
+
+void prompt_cache_destroy(prompt_cache_t **cache)
+{
+    if (!cache || !*cache)
+        return;
+
+    prompt_cache_t *c = *cache;
+    prompt_clear_segments(c);
+    xfree(c->segments);
+    string_destroy(&c->name);
+    string_destroy(&c->default_value);
+    if (c->source)
+        string_destroy(&c->source);
+    string_destroy(&c->rendered);
+    xfree(c);
+    *cache = NULL;
+}
+
+const string_t *prompt_cache_render(prompt_cache_t *cache, const variable_store_t *vars,
+                                    const prompt_params_t *params)
+{
+    Expects_not_null(cache);
+    Expects_not_null(vars);
+    Expects_not_null(params);
+
+    bool vars_changed =
+        !cache->valid || cache->store != vars || cache->generation != vars->generation;
+    bool params_changed =
+        (cache->uses_exit_status && cache->params.exit_status != params->exit_status) ||
+        (cache->uses_shell_pid && (cache->params.shell_pid_valid != params->shell_pid_valid ||
+                                   cache->params.shell_pid != params->shell_pid));
+    if (!vars_changed && !params_changed)
+    {
+        cache->hits++;
+        return cache->rendered;
+    }
+
+    if (vars_changed)
+    {
+        const string_t *value = variable_store_get_value(vars, cache->name);
+        if (!value || (!cache->expand && string_length(value) == 0))
+            value = cache->default_value;
+        if (!cache->source || !string_eq(cache->source, value))
+            prompt_parse(cache, value);
+        prompt_lookup_variables(cache, vars);
+
+        cache->store = vars;
+        cache->generation = vars->generation;
+        cache->valid = true;
+    }
+
+    cache->params = *params;
+    prompt_concatenate(cache, params);
+    return cache->rendered;
+}
+
+int prompt_cache_hits(const prompt_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->hits;
+}
+
+int prompt_cache_parses(const prompt_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->parses;
+}
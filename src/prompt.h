@@ -0,0 +1,67 @@
+// ============================================================================
+// prompt.h
+// Pre-parsed PS1/PS2 prompts, rendered again only when their inputs change
+// ============================================================================
+
+#ifndef PROMPT_H
+#define PROMPT_H
+
+#include <stdbool.h>
+
+#include "miga/string_t.h"
+#include "variable_store.h"
+
+// ============================================================================
+// Prompt Expansion
+//
+// An expanded prompt (PS1) undergoes parameter expansion of $NAME, ${NAME},
+// $? and $$. A reference to an unset variable, or $$ when the PID is not
+// known, is copied literally. As a non-POSIX extension these backslash
+// escapes are decoded first:
+//
+//   \n \r \t \\   Newline, carriage return, tab, backslash
+//   \xhh          U+00hh as UTF-8 (exactly 2 hex digits)
+//   \uhhhh        U+hhhh as UTF-8 (exactly 4 hex digits)
+//   \Uhhhhhh      Any code point as UTF-8 (exactly 6 hex digits)
+//
+// An unrecognised escape is copied literally so that typos are visible.
+// An unexpanded prompt (PS2) is shown as it is.
+// ============================================================================
+
+// The parameters a prompt can use besides variables
+typedef struct prompt_params_t
+{
+    int exit_status;      // $?
+    int shell_pid;        // $$
+    bool shell_pid_valid; // Otherwise $$ is copied literally
+} prompt_params_t;
+
+// ============================================================================
+// Prompt Cache
+//
+// The interactive loop prints a prompt before every line, and a paste of
+// many lines prints as many PS2 prompts. A prompt cache parses the prompt
+// variable into segments (literal text, variable references, $? and $$)
+// once per value, keeps the text of each variable segment, and keeps the
+// rendered prompt. While the variable store's generation stays the same
+// neither the prompt variable nor any variable it references has changed,
+// so only $? and $$ are checked before the rendered prompt is reused.
+// ============================================================================
+
+typedef struct prompt_cache_t prompt_cache_t;
+
+// `name` is the prompt variable (e.g. "PS1"), shown as `default_value` when
+// unset. An unexpanded prompt also falls back to the default when empty.
+prompt_cache_t *prompt_cache_create(const char *name, const char *default_value, bool expand);
+void prompt_cache_destroy(prompt_cache_t **cache);
+
+// Render the prompt against `vars`. The result is owned by the cache and
+// valid until the next call.
+const string_t *prompt_cache_render(prompt_cache_t *cache, const variable_store_t *vars,
+                                    const prompt_params_t *params);
+
+// Statistics, mostly for testing
+int prompt_cache_hits(const prompt_cache_t *cache);   // Rendered prompt reused
+int prompt_cache_parses(const prompt_cache_t *cache); // Prompt value parsed
+
+#endif /* PROMPT_H */
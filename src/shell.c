@@ -6,6 +6,7 @@
 #include <string.h>
 
 #include "shell.h"
+#include "shell_worker.h"
 
 /* This is not part of libmigash, so only use the public API header. */
 #include "libmigash.h"
@@ -25,6 +26,7 @@ static sh_status_t shell_execute_script_file(shell_t *sh);
 static sh_status_t shell_execute_interactive(shell_t *sh);
 static sh_status_t shell_execute_command_string(shell_t *sh);
 static sh_status_t shell_execute_stdin(shell_t *sh);
+static sh_status_t shell_execute_worker(shell_t *sh);
 
 shell_t *shell_create(const shell_cfg_t *cfg)
 {
@@ -62,7 +64,7 @@ shell_t *shell_create(const shell_cfg_t *cfg)
     if (cfg->arguments)
         exec_set_args_cstr(sh->executor, cfg->argument_count, cfg->arguments);
     if (cfg->envp)
-        exec_set_envp_cstr(sh->executor, cfg->envp);
+        exec_set_envp_cstr_borrowed(sh->executor, cfg->envp); // main()'s envp
     if (cfg->flags.allexport)
         exec_set_flag_allexport(sh->executor, true);
     if (cfg->flags.errexit)
@@ -87,6 +89,8 @@ shell_t *shell_create(const shell_cfg_t *cfg)
         exec_set_flag_vi(sh->executor, true);
     if (cfg->flags.xtrace)
         exec_set_flag_xtrace(sh->executor, true);
+    if (cfg->profile_file)
+        exec_start_profile(sh->executor, cfg->profile_file);
 
     return sh;
 }
@@ -137,6 +141,8 @@ sh_status_t shell_execute(shell_t *sh)
     case SHELL_MODE_STDIN:
         exec_setup_interactive(sh->executor);
         return shell_execute_stdin(sh);
+    case SHELL_MODE_WORKER:
+        return shell_execute_worker(sh);
     case SHELL_MODE_UNKNOWN:
     case SHELL_MODE_INVALID_UID_GID:
     default:
@@ -203,7 +209,8 @@ static sh_status_t shell_execute_script_file(shell_t *sh)
     miga_frame_t *frame = exec_get_current_frame(sh->executor);
     frame_set_arg0(frame, sh->script_filename);
 
-    miga_exec_status_t status = exec_execute_stream(sh->executor, fp);
+    miga_exec_status_t status = exec_execute_named_stream(sh->executor, fp,
+                                                          string_cstr(sh->script_filename));
     fclose(fp);
 
     // Convert miga_exec_status_t to sh_status_t
@@ -331,6 +338,21 @@ sh_status_t shell_execute_stdin(shell_t *sh)
     }
 }
 
+static sh_status_t shell_execute_worker(shell_t *sh)
+{
+    Expects_not_null(sh);
+
+    /* Everything the jobs share is set up here, once */
+    miga_exec_status_t setup_status = exec_setup_noninteractive(sh->executor);
+    if (setup_status != MIGA_EXEC_STATUS_OK)
+    {
+        fprintf(stderr, "Failed to parse RC file: %s\n", exec_get_error_cstr(sh->executor));
+        // Not a fatal error.
+    }
+
+    return shell_worker_run(sh->executor, stdin, stdout);
+}
+
 const char *shell_last_error(shell_t *sh)
 {
     Expects_not_null(sh);
@@ -65,6 +65,7 @@ typedef enum
     SHELL_MODE_COMMAND_STRING,
     SHELL_MODE_STDIN,
     SHELL_MODE_SCRIPT_FILE,
+    SHELL_MODE_WORKER,      // --worker: run jobs from stdin (see shell_worker.h)
     SHELL_MODE_INVALID_UID_GID
 } shell_mode_t;
 
@@ -78,6 +79,7 @@ typedef struct
     int argument_count;
     char **arguments;     // argv for the shell
     char **envp;          // environment variables (if any)
+    const char *profile_file; // --profile output file (if any)
 
     // Flags
     shell_flags_t flags;
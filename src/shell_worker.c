@@ -0,0 +1,392 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shell_worker.h"
+
+/* This is not part of libmigash, so only use the public API header. */
+#include "libmigash.h"
+
+#ifdef MIGA_POSIX_API
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/* Exit status reported for a job the worker could not understand */
+#define WORKER_BAD_JOB_STATUS 2
+
+#ifdef MIGA_POSIX_API
+
+/* ============================================================================
+ * Job Requests
+ * ============================================================================ */
+
+typedef struct worker_job_t
+{
+    char *script;    // c: text to run, or NULL
+    char *file;      // f: script file to run, or NULL
+    char *name;      // n: $0, or NULL
+    char *dir;       // d: working directory, or NULL
+    strlist_t *args; // a: positional parameters
+    strlist_t *env;  // e: NAME=VALUE exports
+    char *error;     // Why the request is malformed, or NULL
+} worker_job_t;
+
+static void worker_job_clear(worker_job_t *job)
+{
+    free(job->script);
+    free(job->file);
+    free(job->name);
+    free(job->dir);
+    free(job->error);
+    if (job->args)
+        strlist_destroy(&job->args);
+    if (job->env)
+        strlist_destroy(&job->env);
+    memset(job, 0, sizeof(*job));
+}
+
+static void worker_job_set_error(worker_job_t *job, const char *message, const char *field)
+{
+    if (job->error)
+        return;
+    size_t len = strlen(message) + strlen(field) + 3;
+    job->error = malloc(len);
+    if (job->error && field[0])
+        snprintf(job->error, len, "%s: %s", message, field);
+    else if (job->error)
+        snprintf(job->error, len, "%s", message);
+}
+
+static void worker_list_add(strlist_t *list, const char *value)
+{
+    string_t *str = string_create_from_cstr(value);
+    strlist_move_push_back(list, &str);
+}
+
+static void worker_job_set_once(worker_job_t *job, char **slot, const char *value,
+                                const char *field)
+{
+    if (*slot)
+        worker_job_set_error(job, "field given twice", field);
+    else
+        *slot = strdup(value);
+}
+
+/**
+ * Read the next job from IN.  Returns false if the input ended before a job
+ * started.  A job that is malformed, or cut short by the end of the input,
+ * is returned with job->error set.
+ */
+static bool worker_read_job(FILE *in, worker_job_t *job, char **field, size_t *field_size)
+{
+    job->args = strlist_create();
+    job->env = strlist_create();
+
+    bool started = false;
+    for (;;)
+    {
+        ssize_t len = getdelim(field, field_size, '\0', in);
+        if (len < 0)
+        {
+            if (!started)
+                return false;
+            worker_job_set_error(job, "input ended inside a job", "");
+            return true;
+        }
+        started = true;
+
+        const char *f = *field;
+        if (f[0] == '\0')
+            break;
+        if (len < 2 || f[1] != ':')
+        {
+            worker_job_set_error(job, "malformed field", f);
+            continue;
+        }
+
+        const char *value = f + 2;
+        switch (f[0])
+        {
+        case 'c':
+            worker_job_set_once(job, &job->script, value, f);
+            break;
+        case 'f':
+            worker_job_set_once(job, &job->file, value, f);
+            break;
+        case 'n':
+            worker_job_set_once(job, &job->name, value, f);
+            break;
+        case 'd':
+            worker_job_set_once(job, &job->dir, value, f);
+            break;
+        case 'a':
+            worker_list_add(job->args, value);
+            break;
+        case 'e':
+            if (!strchr(value, '=') || value[0] == '=')
+                worker_job_set_error(job, "expected NAME=VALUE", f);
+            else
+                worker_list_add(job->env, value);
+            break;
+        default:
+            worker_job_set_error(job, "unknown field", f);
+            break;
+        }
+    }
+
+    if (!job->script == !job->file)
+        worker_job_set_error(job, "a job needs exactly one of c: and f:", "");
+    return true;
+}
+
+/* ============================================================================
+ * Running a Job
+ * ============================================================================ */
+
+/* In the forked child: prepare the copy of the shell and run the job */
+static int worker_run_job(miga_exec_t *executor, const worker_job_t *job)
+{
+    miga_frame_t *frame = exec_get_current_frame(executor);
+
+    /* A job is a new shell, not a subshell of the worker: $$ is its own */
+    exec_set_shell_pid(executor, (int)getpid());
+    exec_set_shell_ppid(executor, (int)getppid());
+
+    if (job->dir && !frame_change_directory_cstr(frame, job->dir))
+    {
+        fprintf(stderr, "%s: cannot change directory to %s: %s\n",
+                exec_get_shell_name_cstr(executor), job->dir, strerror(errno));
+        return WORKER_BAD_JOB_STATUS;
+    }
+
+    for (int i = 0; i < strlist_size(job->env); i++)
+    {
+        const char *assignment = string_cstr(strlist_at(job->env, i));
+        const char *eq = strchr(assignment, '=');
+        string_t *name = string_create_from_cstr_len(assignment, (int)(eq - assignment));
+        string_t *value = string_create_from_cstr(eq + 1);
+        frame_export_variable(frame, name, value);
+        string_destroy(&name);
+        string_destroy(&value);
+    }
+
+    if (job->name || job->file)
+        frame_set_arg0_cstr(frame, job->name ? job->name : job->file);
+    frame_replace_positional_params(frame, job->args);
+
+    if (job->script)
+    {
+        exec_execute_command_string(executor, job->script);
+    }
+    else
+    {
+        FILE *fp = fopen(job->file, "r");
+        if (!fp)
+        {
+            fprintf(stderr, "%s: cannot open %s: %s\n", exec_get_shell_name_cstr(executor),
+                    job->file, strerror(errno));
+            return 127;
+        }
+        exec_execute_named_stream(executor, fp, job->file);
+        fclose(fp);
+    }
+    return exec_get_exit_status(executor);
+}
+
+typedef struct worker_buffer_t
+{
+    char *data;
+    size_t len;
+    size_t cap;
+} worker_buffer_t;
+
+static bool worker_buffer_append(worker_buffer_t *buf, const char *data, size_t len)
+{
+    if (buf->len + len > buf->cap)
+    {
+        size_t cap = buf->cap ? buf->cap : 4096;
+        while (cap < buf->len + len)
+            cap *= 2;
+        char *grown = realloc(buf->data, cap);
+        if (!grown)
+            return false;
+        buf->data = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return true;
+}
+
+/* Read both pipes until the child has closed them */
+static void worker_collect_output(int out_fd, int err_fd, worker_buffer_t *out,
+                                  worker_buffer_t *err)
+{
+    struct pollfd fds[2] = {{.fd = out_fd, .events = POLLIN}, {.fd = err_fd, .events = POLLIN}};
+    worker_buffer_t *bufs[2] = {out, err};
+    int open_fds = 2;
+    char chunk[8192];
+
+    while (open_fds > 0)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            ssize_t n = read(fds[i].fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+            {
+                fds[i].fd = -1;
+                open_fds--;
+            }
+            else
+            {
+                worker_buffer_append(bufs[i], chunk, (size_t)n);
+            }
+        }
+    }
+}
+
+static void worker_write_result(FILE *out, int status, const worker_buffer_t *job_out,
+                                const worker_buffer_t *job_err)
+{
+    fprintf(out, "%d %zu %zu\n", status, job_out->len, job_err->len);
+    if (job_out->len)
+        fwrite(job_out->data, 1, job_out->len, out);
+    if (job_err->len)
+        fwrite(job_err->data, 1, job_err->len, out);
+    fflush(out);
+}
+
+/* Fork a child to run the job and report its result on OUT */
+static bool worker_dispatch_job(miga_exec_t *executor, const worker_job_t *job, FILE *out)
+{
+    worker_buffer_t job_out = {0};
+    worker_buffer_t job_err = {0};
+
+    if (job->error)
+    {
+        worker_buffer_append(&job_err, job->error, strlen(job->error));
+        worker_buffer_append(&job_err, "\n", 1);
+        worker_write_result(out, WORKER_BAD_JOB_STATUS, &job_out, &job_err);
+        free(job_err.data);
+        return true;
+    }
+
+    int out_pipe[2];
+    int err_pipe[2];
+    if (pipe(out_pipe) < 0)
+        return false;
+    if (pipe(err_pipe) < 0)
+    {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return false;
+    }
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd >= 0)
+        {
+            dup2(null_fd, STDIN_FILENO);
+            close(null_fd);
+        }
+        dup2(out_pipe[1], STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+
+        int status = worker_run_job(executor, job);
+        fflush(NULL);
+        _exit(status & 0xFF);
+    }
+
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    worker_collect_output(out_pipe[0], err_pipe[0], &job_out, &job_err);
+    close(out_pipe[0]);
+    close(err_pipe[0]);
+
+    int wstatus = 0;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR)
+        ;
+    int status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+
+    worker_write_result(out, status, &job_out, &job_err);
+    free(job_out.data);
+    free(job_err.data);
+    return true;
+}
+
+sh_status_t shell_worker_run(miga_exec_t *executor, FILE *in, FILE *out)
+{
+    if (!executor || !in || !out)
+        return SH_INTERNAL_ERROR;
+
+    char *field = NULL;
+    size_t field_size = 0;
+    sh_status_t status = SH_OK;
+    worker_job_t job = {0};
+
+    while (worker_read_job(in, &job, &field, &field_size))
+    {
+        bool ok = worker_dispatch_job(executor, &job, out);
+        worker_job_clear(&job);
+        if (!ok)
+        {
+            exec_set_error_printf(executor, "worker: cannot start a job: %s", strerror(errno));
+            status = SH_RUNTIME_ERROR;
+            break;
+        }
+    }
+
+    worker_job_clear(&job);
+    free(field);
+    return status;
+}
+
+#else
+
+sh_status_t shell_worker_run(miga_exec_t *executor, FILE *in, FILE *out)
+{
+    if (!executor)
+        return SH_INTERNAL_ERROR;
+    (void)in;
+    (void)out;
+    exec_set_error_cstr(executor, "worker mode is not supported on this platform");
+    return SH_INTERNAL_ERROR;
+}
+
+#endif
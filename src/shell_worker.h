@@ -0,0 +1,51 @@
+#ifndef SHELL_WORKER_H
+#define SHELL_WORKER_H
+
+#include <stdio.h>
+
+#include "shell.h"
+
+/* ============================================================================
+ * Batch Worker (mgsh --worker)
+ * ============================================================================ */
+
+/**
+ * Many short scripts run one after another pay for process startup,
+ * environment import, builtin registration and startup files every time.
+ * In worker mode the shell does that setup once, then reads jobs from an
+ * input stream and runs each one in a forked child of the prepared shell, so
+ * a job starts with a fork instead of an exec.  Each job gets a private copy
+ * of the shell: nothing it does (cd, variables, traps, exit) is seen by the
+ * jobs after it.
+ *
+ * A job is a sequence of NUL-terminated fields, ended by an empty field:
+ *
+ *   c:TEXT        run TEXT as with -c
+ *   f:PATH        run the script file PATH (exactly one of c: and f:)
+ *   n:NAME        $0 for the job (default: the file, or the shell's name)
+ *   a:ARG         append ARG to the positional parameters (repeatable)
+ *   e:NAME=VALUE  export NAME with VALUE for the job (repeatable)
+ *   d:DIR         run the job in DIR
+ *
+ * For every job the worker writes a line "STATUS OUTLEN ERRLEN\n", followed
+ * by OUTLEN bytes the job wrote to standard output and ERRLEN bytes it wrote
+ * to standard error.  STATUS is the exit status, or 128 plus the signal
+ * number if the job was killed.  A malformed job gets status 2 and a message
+ * on its standard error.  Jobs read /dev/null as their standard input.  The
+ * worker exits when its input ends.
+ *
+ * A job is finished when its standard output and standard error are closed,
+ * not when the job's shell exits.  Background commands a job starts inherit
+ * both, so the worker waits for them too: a job running `sleep 3 &` holds up
+ * its result, and every job after it, for three seconds.  Redirect the
+ * output of background commands that should outlive the job.
+ *
+ * @param executor  A set-up executor; it is not changed by the jobs.
+ * @param in        Job requests.
+ * @param out       Job results.
+ * @return SH_OK when the input ends, or SH_RUNTIME_ERROR if the worker
+ *         could not go on (e.g. fork() or pipe() failed).
+ */
+sh_status_t shell_worker_run(miga_exec_t *executor, FILE *in, FILE *out);
+
+#endif
@@ -0,0 +1,282 @@
+// ============================================================================
+// stat_cache.c
+// Short-lived cache of file status results for test and [
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef MIGA_POSIX_API
+#define _POSIX_C_SOURCE 202405L
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MIGA_POSIX_API
+#include <sys/stat.h>
+#include <unistd.h>
+#elifdef MIGA_UCRT_API
+#include <io.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+#include "stat_cache.h"
+
+#include "logging.h"
+#include "miga/xalloc.h"
+
+// A script rarely tests more than a handful of paths between two commands,
+// so a few slots with round-robin replacement is plenty.
+#define STAT_CACHE_SLOTS 8
+
+typedef struct stat_cache_entry_t
+{
+    char *path;
+    bool follow_links;
+    bool exists;
+    stat_cache_info_t info;
+    int access_known; // STAT_CACHE_* bits that have been checked
+    int access_ok;    // STAT_CACHE_* bits that were granted
+} stat_cache_entry_t;
+
+struct stat_cache_t
+{
+    stat_cache_entry_t entries[STAT_CACHE_SLOTS];
+    int count;
+    int next_victim;
+    int hits;
+    int misses;
+};
+
+// ============================================================================
+// Internal Helper Functions
+// ============================================================================
+
+static stat_cache_entry_t *stat_cache_find(stat_cache_t *cache, const char *path,
+                                           bool follow_links)
+{
+    for (int i = 0; i < cache->count; i++)
+    {
+        stat_cache_entry_t *e = &cache->entries[i];
+        if (e->follow_links == follow_links && strcmp(e->path, path) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/**
+ * Query the file system for a path and fill in a cache entry.
+ */
+static void stat_cache_fill(stat_cache_entry_t *e, const char *path, bool follow_links)
+{
+    memset(&e->info, 0, sizeof(e->info));
+    e->exists = false;
+    e->access_known = 0;
+    e->access_ok = 0;
+
+#ifdef MIGA_POSIX_API
+    struct stat st;
+    int rc = follow_links ? stat(path, &st) : lstat(path, &st);
+    if (rc != 0)
+        return;
+
+    e->exists = true;
+    if (S_ISREG(st.st_mode))
+        e->info.type = STAT_CACHE_REGULAR;
+    else if (S_ISDIR(st.st_mode))
+        e->info.type = STAT_CACHE_DIR;
+    else if (S_ISCHR(st.st_mode))
+        e->info.type = STAT_CACHE_CHAR;
+    else if (S_ISBLK(st.st_mode))
+        e->info.type = STAT_CACHE_BLOCK;
+    else if (S_ISFIFO(st.st_mode))
+        e->info.type = STAT_CACHE_FIFO;
+    else if (S_ISLNK(st.st_mode))
+        e->info.type = STAT_CACHE_SYMLINK;
+    else if (S_ISSOCK(st.st_mode))
+        e->info.type = STAT_CACHE_SOCKET;
+    else
+        e->info.type = STAT_CACHE_OTHER;
+    e->info.size = (long long)st.st_size;
+    e->info.is_setuid = (st.st_mode & S_ISUID) != 0;
+    e->info.is_setgid = (st.st_mode & S_ISGID) != 0;
+#ifdef S_ISVTX
+    e->info.is_sticky = (st.st_mode & S_ISVTX) != 0;
+#else
+    e->info.is_sticky = (st.st_mode & 01000) != 0; // XSI sticky bit
+#endif
+#elifdef MIGA_UCRT_API
+    (void)follow_links; // No symbolic links through the CRT
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0)
+        return;
+
+    e->exists = true;
+    if ((st.st_mode & _S_IFMT) == _S_IFREG)
+        e->info.type = STAT_CACHE_REGULAR;
+    else if ((st.st_mode & _S_IFMT) == _S_IFDIR)
+        e->info.type = STAT_CACHE_DIR;
+    else if ((st.st_mode & _S_IFMT) == _S_IFCHR)
+        e->info.type = STAT_CACHE_CHAR;
+    else if ((st.st_mode & _S_IFMT) == _S_IFIFO)
+        e->info.type = STAT_CACHE_FIFO;
+    else
+        e->info.type = STAT_CACHE_OTHER;
+    e->info.size = (long long)st.st_size;
+#else
+    // ISO C can only tell whether a file can be opened.
+    (void)follow_links;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return;
+    e->exists = true;
+    e->info.type = STAT_CACHE_REGULAR;
+    if (fseek(fp, 0, SEEK_END) == 0)
+    {
+        long size = ftell(fp);
+        e->info.size = size > 0 ? size : 0;
+    }
+    fclose(fp);
+#endif
+}
+
+static bool stat_cache_check_access(const char *path, int mode)
+{
+#ifdef MIGA_POSIX_API
+    int amode = 0;
+    if (mode & STAT_CACHE_READ)
+        amode |= R_OK;
+    if (mode & STAT_CACHE_WRITE)
+        amode |= W_OK;
+    if (mode & STAT_CACHE_EXEC)
+        amode |= X_OK;
+    return access(path, amode) == 0;
+#elifdef MIGA_UCRT_API
+    // The CRT has no execute check; existence is the best available answer.
+    int amode = 0;
+    if (mode & STAT_CACHE_READ)
+        amode |= 4;
+    if (mode & STAT_CACHE_WRITE)
+        amode |= 2;
+    return _access(path, amode) == 0;
+#else
+    if (mode & STAT_CACHE_EXEC)
+        return false;
+    FILE *fp = fopen(path, (mode & STAT_CACHE_WRITE) ? "ab" : "rb");
+    if (!fp)
+        return false;
+    fclose(fp);
+    return true;
+#endif
+}
+
+/**
+ * Return the entry for a path, querying the file system on a miss.
+ */
+static stat_cache_entry_t *stat_cache_get(stat_cache_t *cache, const char *path,
+                                          bool follow_links)
+{
+    stat_cache_entry_t *e = stat_cache_find(cache, path, follow_links);
+    if (e)
+    {
+        cache->hits++;
+        return e;
+    }
+
+    cache->misses++;
+    if (cache->count < STAT_CACHE_SLOTS)
+    {
+        e = &cache->entries[cache->count++];
+    }
+    else
+    {
+        e = &cache->entries[cache->next_victim];
+        cache->next_victim = (cache->next_victim + 1) % STAT_CACHE_SLOTS;
+        xfree(e->path);
+    }
+
+    e->path = xstrdup(path);
+    e->follow_links = follow_links;
+    stat_cache_fill(e, path, follow_links);
+    return e;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+stat_cache_t *stat_cache_create(void)
+{
+    return xcalloc(1, sizeof(stat_cache_t));
+}
+
+void stat_cache_destroy(stat_cache_t **cache)
+{
+    if (!cache || !*cache)
+        return;
+
+    stat_cache_clear(*cache);
+    xfree(*cache);
+    *cache = NULL;
+}
+
+void stat_cache_clear(stat_cache_t *cache)
+{
+    if (!cache)
+        return;
+
+    for (int i = 0; i < cache->count; i++)
+    {
+        xfree(cache->entries[i].path);
+        cache->entries[i].path = NULL;
+    }
+    cache->count = 0;
+    cache->next_victim = 0;
+}
+
+bool stat_cache_lookup(stat_cache_t *cache, const char *path, bool follow_links,
+                       stat_cache_info_t *info)
+{
+    Expects_not_null(cache);
+    Expects_not_null(path);
+    Expects_not_null(info);
+
+    const stat_cache_entry_t *e = stat_cache_get(cache, path, follow_links);
+    *info = e->info;
+    return e->exists;
+}
+
+bool stat_cache_access(stat_cache_t *cache, const char *path, int mode)
+{
+    Expects_not_null(cache);
+    Expects_not_null(path);
+
+    stat_cache_entry_t *e = stat_cache_get(cache, path, true);
+    if (!e->exists)
+        return false;
+
+    if ((e->access_known & mode) != mode)
+    {
+        if (stat_cache_check_access(path, mode))
+            e->access_ok |= mode;
+        else
+            e->access_ok &= ~mode;
+        e->access_known |= mode;
+    }
+    return (e->access_ok & mode) == mode;
+}
+
+int stat_cache_hits(const stat_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->hits;
+}
+
+int stat_cache_misses(const stat_cache_t *cache)
+{
+    Expects_not_null(cache);
+    return cache->misses;
+}
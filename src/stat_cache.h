@@ -0,0 +1,76 @@
+// ============================================================================
+// stat_cache.h
+// Short-lived cache of file status results for test and [
+// ============================================================================
+
+#ifndef STAT_CACHE_H
+#define STAT_CACHE_H
+
+#include <stdbool.h>
+
+// ============================================================================
+// File Information
+// ============================================================================
+
+typedef enum stat_cache_type_t
+{
+    STAT_CACHE_NONE,    // Path does not exist (or could not be examined)
+    STAT_CACHE_REGULAR, // Regular file
+    STAT_CACHE_DIR,     // Directory
+    STAT_CACHE_CHAR,    // Character special file
+    STAT_CACHE_BLOCK,   // Block special file
+    STAT_CACHE_FIFO,    // FIFO
+    STAT_CACHE_SYMLINK, // Symbolic link (only reported when links are not followed)
+    STAT_CACHE_SOCKET,  // Socket
+    STAT_CACHE_OTHER    // Exists, but none of the above
+} stat_cache_type_t;
+
+typedef struct stat_cache_info_t
+{
+    stat_cache_type_t type;
+    long long size;
+    bool is_setuid;
+    bool is_setgid;
+    bool is_sticky;
+} stat_cache_info_t;
+
+// Access checks, combinable as a bit mask
+#define STAT_CACHE_READ 0x1
+#define STAT_CACHE_WRITE 0x2
+#define STAT_CACHE_EXEC 0x4
+
+// ============================================================================
+// Stat Cache
+//
+// The cache holds the most recent results of stat(), lstat() and access() so
+// that a script testing the same path repeatedly, e.g.
+//     [ -e "$f" ] && [ -f "$f" ] && [ -r "$f" ]
+// makes one system call per path instead of one per test. Entries are only
+// valid until something could have changed the file system: the executor
+// clears the cache at every command-list boundary, after running external
+// commands or subshells, when applying redirections, and on cd.
+// ============================================================================
+
+typedef struct stat_cache_t stat_cache_t;
+
+stat_cache_t *stat_cache_create(void);
+void stat_cache_destroy(stat_cache_t **cache);
+
+// Forget every cached result. Accepts NULL so callers need not check
+// whether a cache was ever created.
+void stat_cache_clear(stat_cache_t *cache);
+
+// Look up a path, calling stat() (follow_links) or lstat() on a miss.
+// Returns true and fills *info if the path exists.
+bool stat_cache_lookup(stat_cache_t *cache, const char *path, bool follow_links,
+                       stat_cache_info_t *info);
+
+// Check access to a path for the current user. `mode` is one of the
+// STAT_CACHE_READ/WRITE/EXEC bits. Results are cached per path and per bit.
+bool stat_cache_access(stat_cache_t *cache, const char *path, int mode);
+
+// Statistics, mostly for testing
+int stat_cache_hits(const stat_cache_t *cache);
+int stat_cache_misses(const stat_cache_t *cache);
+
+#endif /* STAT_CACHE_H */
@@ -0,0 +1,19 @@
+// ============================================================================
+// store_generation.c
+// Generation numbers shared by the variable, builtin, function and alias stores
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdatomic.h>
+
+#include "store_generation.h"
+
+static _Atomic uint32_t generation_next = 1;
+
+uint32_t store_generation_next(void)
+{
+    return atomic_fetch_add_explicit(&generation_next, 1, memory_order_relaxed);
+}
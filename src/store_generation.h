@@ -0,0 +1,17 @@
+// ============================================================================
+// store_generation.h
+// Generation numbers shared by the variable, builtin, function and alias stores
+// ============================================================================
+
+#ifndef STORE_GENERATION_H
+#define STORE_GENERATION_H
+
+#include <stdint.h>
+
+// Every call returns a new value from one process-wide counter, so no two
+// stores, and no two states of one store, share a generation. A cache can
+// therefore be keyed on a generation alone. Safe to call from executors
+// running on different threads.
+uint32_t store_generation_next(void);
+
+#endif /* STORE_GENERATION_H */
@@ -1,8 +1,13 @@
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
+#ifdef MIGA_POSIX_API
+// memmem() and memrchr() are GNU/BSD extensions
+#define _GNU_SOURCE
+#endif
 
 #include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,15 +30,24 @@ static inline bool string_is_heap_allocated(const string_t *str)
     return str->capacity > STRING_INITIAL_CAPACITY;
 }
 
+/**
+ * Forget the cached hash. Every function that can change the contents calls
+ * this, including string_data(), which hands out a writable pointer.
+ */
+static inline void string_invalidate_hash(string_t *str)
+{
+    str->hash = 0;
+}
+
 /**
  * Normalize capacity and manage transitions between inline and heap storage.
  */
-static inline void string_normalize_capacity(string_t *str, int new_capacity)
+static inline void string_normalize_capacity(string_t *str, ptrdiff_t new_capacity)
 {
     if (string_is_heap_allocated(str) && new_capacity <= STRING_INITIAL_CAPACITY)
     {
         // Move from heap to inline storage
-        int new_length =
+        ptrdiff_t new_length =
             str->length < STRING_INITIAL_CAPACITY ? str->length : STRING_INITIAL_CAPACITY - 1;
         memcpy(str->inline_data, str->data, new_length);
         str->inline_data[new_length] = '\0';
@@ -45,14 +59,14 @@ static inline void string_normalize_capacity(string_t *str, int new_capacity)
     else if (string_is_heap_allocated(str) && new_capacity > STRING_INITIAL_CAPACITY)
     {
         // Resize heap allocation
-        char *new_data = (char *)xrealloc(str->data, new_capacity * sizeof(char));
+        char *new_data = (char *)xrealloc(str->data, (size_t)new_capacity);
         str->data = new_data;
         str->capacity = new_capacity;
     }
     else if (string_is_inline(str) && new_capacity > STRING_INITIAL_CAPACITY)
     {
         // Move from inline to heap storage
-        char *new_data = (char *)xmalloc(new_capacity * sizeof(char));
+        char *new_data = (char *)xmalloc((size_t)new_capacity);
         memcpy(new_data, str->inline_data, str->length);
         new_data[str->length] = '\0';
         str->data = new_data;
@@ -65,32 +79,44 @@ static inline void string_normalize_capacity(string_t *str, int new_capacity)
 // Range clamping helper
 // ============================================================================
 
-static inline void clamp_range(int len, int begin, int end, int *out_begin, int *out_end)
-{
-    if (end == -1)
-        end = len;
-    if (begin < 0)
-        begin = 0;
-    if (begin > len)
-        begin = len;
-    if (end < 0)
-        end = 0;
-    if (end > len)
-        end = len;
-    if (end <= begin)
+static inline void clamp_range(ptrdiff_t len, int begin, int end, ptrdiff_t *out_begin,
+                               ptrdiff_t *out_end)
+{
+    ptrdiff_t b = begin < 0 ? 0 : begin;
+    ptrdiff_t e = end == -1 ? len : end < 0 ? 0 : end;
+    if (b > len)
+        b = len;
+    if (e > len)
+        e = len;
+    if (e <= b)
     {
-        *out_begin = *out_end = begin;
+        *out_begin = *out_end = b;
         return;
     }
-    *out_begin = begin;
-    *out_end = end;
+    *out_begin = b;
+    *out_end = e;
+}
+
+/*
+ * Positions handed back through the int API. The fields are wide enough for
+ * strings past 2 GiB, but an offset that does not fit in an int cannot be
+ * returned, so searches report such a match as not found.
+ */
+static inline int string_int_pos(ptrdiff_t pos)
+{
+    return pos > INT_MAX ? -1 : (int)pos;
+}
+
+static inline int string_int_length(const string_t *str)
+{
+    return str->length > INT_MAX ? INT_MAX : (int)str->length;
 }
 
 // ============================================================================
 // Capacity management
 // ============================================================================
 
-static void string_ensure_capacity(string_t *str, int needed)
+static void string_ensure_capacity(string_t *str, ptrdiff_t needed)
 {
     Expects_not_null(str);
     return_if_lt(needed, 0);
@@ -98,11 +124,11 @@ static void string_ensure_capacity(string_t *str, int needed)
     if (needed <= str->capacity)
         return;
 
-    int new_capacity = str->capacity ? str->capacity : STRING_INITIAL_CAPACITY;
+    ptrdiff_t new_capacity = str->capacity ? str->capacity : STRING_INITIAL_CAPACITY;
 
     while (new_capacity < needed)
     {
-        if (new_capacity > INT_MAX / STRING_GROW_FACTOR)
+        if (new_capacity > PTRDIFF_MAX / STRING_GROW_FACTOR)
         {
             new_capacity = needed;
             break;
@@ -141,7 +167,7 @@ string_t *string_create_from_n_chars(int count, char ch)
     str->length = 0;
     str->inline_data[0] = '\0';
 
-    int needed_capacity = count + 1;
+    ptrdiff_t needed_capacity = (ptrdiff_t)count + 1;
     string_ensure_capacity(str, needed_capacity);
 
     for (int i = 0; i < count; i++)
@@ -154,12 +180,9 @@ string_t *string_create_from_n_chars(int count, char ch)
 
 string_t *string_create_from_cstr(const char *data)
 {
-    if (data == NULL)
-        return string_create();
-    size_t len = strlen(data);
-    if (len > INT_MAX)
-        len = INT_MAX - 1;
-    return string_create_from_cstr_len(data, (int)len);
+    string_t *str = string_create();
+    string_set_cstr(str, data);
+    return str;
 }
 
 string_t *string_create_from_cstr_len(const char *data, int len)
@@ -173,7 +196,7 @@ string_t *string_create_from_cstr_len(const char *data, int len)
     str->length = 0;
     str->inline_data[0] = '\0';
 
-    int needed_capacity = len + 1;
+    ptrdiff_t needed_capacity = (ptrdiff_t)len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data, data, len);
@@ -205,7 +228,9 @@ string_t *string_create_from(const string_t *other)
     Expects_not_null(other);
     if (other->length == 0)
         return string_create();
-    return string_create_from_range(other, 0, other->length);
+    string_t *copy = string_create_from_range(other, 0, other->length);
+    copy->hash = other->hash;
+    return copy;
 }
 
 string_t *string_create_from_range(const string_t *str, int start, int end)
@@ -215,13 +240,13 @@ string_t *string_create_from_range(const string_t *str, int start, int end)
     if (str->length == 0)
         return string_create();
 
-    int b, e;
+    ptrdiff_t b, e;
     clamp_range(str->length, start, end, &b, &e);
 
     if (b == e)
         return string_create();
 
-    int length = e - b;
+    ptrdiff_t length = e - b;
 
     string_t *result = xcalloc(1, sizeof(string_t));
     result->data = result->inline_data;
@@ -229,7 +254,7 @@ string_t *string_create_from_range(const string_t *str, int start, int end)
     result->length = 0;
     result->inline_data[0] = '\0';
 
-    int needed_capacity = length + 1;
+    ptrdiff_t needed_capacity = length + 1;
     string_ensure_capacity(result, needed_capacity);
 
     memcpy(result->data, str->data + b, length);
@@ -268,8 +293,8 @@ char *string_release(string_t **str)
     }
     else
     {
-        result = xmalloc((*str)->length + 1);
-        memcpy(result, (*str)->inline_data, (*str)->length + 1);
+        result = xmalloc((size_t)(*str)->length + 1);
+        memcpy(result, (*str)->inline_data, (size_t)(*str)->length + 1);
     }
 
     (*str)->data = NULL;
@@ -288,6 +313,7 @@ char *string_release(string_t **str)
 void string_set(string_t *str, const string_t *str2)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (str2 == NULL || str2->length == 0)
     {
@@ -299,12 +325,13 @@ void string_set(string_t *str, const string_t *str2)
     if (str2 == str)
         return;
 
-    int needed_capacity = str2->length + 1;
+    ptrdiff_t needed_capacity = str2->length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data, str2->data, str2->length);
     str->length = str2->length;
     str->data[str->length] = '\0';
+    str->hash = str2->hash;
 }
 
 void string_move(string_t *str, string_t *str2)
@@ -318,6 +345,7 @@ void string_move(string_t *str, string_t *str2)
     if (string_is_heap_allocated(str))
         xfree(str->data);
 
+    str->hash = str2->hash;
     if (string_is_heap_allocated(str2))
     {
         str->data = str2->data;
@@ -336,6 +364,7 @@ void string_move(string_t *str, string_t *str2)
     str2->length = 0;
     str2->capacity = STRING_INITIAL_CAPACITY;
     str2->inline_data[0] = '\0';
+    string_invalidate_hash(str2);
 }
 
 void string_consume(string_t *str, string_t **str2)
@@ -351,6 +380,7 @@ void string_consume(string_t *str, string_t **str2)
 void string_set_cstr(string_t *str, const char *cstr)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (cstr == NULL)
     {
@@ -359,12 +389,9 @@ void string_set_cstr(string_t *str, const char *cstr)
         return;
     }
 
-    size_t slen = strlen(cstr);
-    if (slen > INT_MAX - 1)
-        slen = INT_MAX - 1;
-    int len = (int)slen;
+    ptrdiff_t len = (ptrdiff_t)strlen(cstr);
 
-    int needed_capacity = len + 1;
+    ptrdiff_t needed_capacity = len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data, cstr, len);
@@ -375,6 +402,7 @@ void string_set_cstr(string_t *str, const char *cstr)
 void string_set_char(string_t *str, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (ch == '\0')
     {
@@ -391,6 +419,7 @@ void string_set_char(string_t *str, char ch)
 void string_set_data(string_t *str, const char *data, int n)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (data == NULL || n <= 0)
     {
@@ -399,14 +428,11 @@ void string_set_data(string_t *str, const char *data, int n)
         return;
     }
 
-    if (n > INT_MAX - 1)
-        n = INT_MAX - 1;
-
     int actual_len = 0;
     while (actual_len < n && data[actual_len] != '\0')
         actual_len++;
 
-    int needed_capacity = actual_len + 1;
+    ptrdiff_t needed_capacity = (ptrdiff_t)actual_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data, data, actual_len);
@@ -417,6 +443,7 @@ void string_set_data(string_t *str, const char *data, int n)
 void string_set_n_chars(string_t *str, int count, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (count <= 0 || ch == '\0')
     {
@@ -425,10 +452,7 @@ void string_set_n_chars(string_t *str, int count, char ch)
         return;
     }
 
-    if (count > INT_MAX - 1)
-        count = INT_MAX - 1;
-
-    int needed_capacity = count + 1;
+    ptrdiff_t needed_capacity = (ptrdiff_t)count + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memset(str->data, ch, count);
@@ -439,6 +463,7 @@ void string_set_n_chars(string_t *str, int count, char ch)
 void string_set_substring(string_t *str, const string_t *str2, int begin2, int end2)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (str2 == NULL || str2->length == 0)
     {
@@ -447,7 +472,7 @@ void string_set_substring(string_t *str, const string_t *str2, int begin2, int e
         return;
     }
 
-    int b, e;
+    ptrdiff_t b, e;
     clamp_range(str2->length, begin2, end2, &b, &e);
 
     if (b == e)
@@ -457,8 +482,8 @@ void string_set_substring(string_t *str, const string_t *str2, int begin2, int e
         return;
     }
 
-    int substring_length = e - b;
-    int needed_capacity = substring_length + 1;
+    ptrdiff_t substring_length = e - b;
+    ptrdiff_t needed_capacity = substring_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data, str2->data + b, substring_length);
@@ -497,12 +522,14 @@ char string_back(const string_t *str)
 char *string_data(string_t *str)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
     return str->data;
 }
 
 char *string_data_at(string_t *str, int pos)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
     if (pos < 0 || pos > str->length)
         return NULL;
     return str->data + pos;
@@ -527,7 +554,13 @@ bool string_empty(const string_t *str)
 int string_length(const string_t *str)
 {
     Expects_not_null(str);
-    return str->length;
+    return string_int_length(str);
+}
+
+size_t string_size(const string_t *str)
+{
+    Expects_not_null(str);
+    return (size_t)str->length;
 }
 
 void string_reserve(string_t *str, int new_cap)
@@ -535,24 +568,21 @@ void string_reserve(string_t *str, int new_cap)
     Expects_not_null(str);
     return_if_lt(new_cap, 0);
 
-    if (new_cap > INT_MAX - 1)
-        new_cap = INT_MAX - 1;
-
-    if (new_cap + 1 > str->capacity)
-        string_ensure_capacity(str, new_cap + 1);
+    if ((ptrdiff_t)new_cap + 1 > str->capacity)
+        string_ensure_capacity(str, (ptrdiff_t)new_cap + 1);
 }
 
 int string_capacity(const string_t *str)
 {
     Expects_not_null(str);
-    return str->capacity;
+    return str->capacity > INT_MAX ? INT_MAX : (int)str->capacity;
 }
 
 void string_shrink_to_fit(string_t *str)
 {
     Expects_not_null(str);
 
-    int needed = str->length + 1;
+    ptrdiff_t needed = str->length + 1;
 
     if (needed <= STRING_INITIAL_CAPACITY)
     {
@@ -561,7 +591,7 @@ void string_shrink_to_fit(string_t *str)
     }
     else if (str->capacity > needed)
     {
-        char *new_data = xrealloc(str->data, needed);
+        char *new_data = xrealloc(str->data, (size_t)needed);
         str->data = new_data;
         str->capacity = needed;
     }
@@ -574,6 +604,7 @@ void string_shrink_to_fit(string_t *str)
 void string_clear(string_t *str)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
     str->length = 0;
     str->data[0] = '\0';
 }
@@ -581,6 +612,7 @@ void string_clear(string_t *str)
 void string_insert(string_t *str, int pos, const string_t *other)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (other == NULL || other->length == 0)
         return;
@@ -590,8 +622,8 @@ void string_insert(string_t *str, int pos, const string_t *other)
     if (pos > str->length)
         pos = str->length;
 
-    int other_len = other->length;
-    int needed_capacity = str->length + other_len + 1;
+    ptrdiff_t other_len = other->length;
+    ptrdiff_t needed_capacity = str->length + other_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + other_len, str->data + pos, str->length - pos);
@@ -604,6 +636,7 @@ void string_insert(string_t *str, int pos, const string_t *other)
 void string_insert_n_chars(string_t *str, int pos, int count, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (count <= 0)
         return;
@@ -624,7 +657,7 @@ void string_insert_n_chars(string_t *str, int pos, int count, char ch)
     if (pos > str->length)
         pos = str->length;
 
-    int needed_capacity = str->length + count + 1;
+    ptrdiff_t needed_capacity = str->length + count + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + count, str->data + pos, str->length - pos);
@@ -637,6 +670,7 @@ void string_insert_n_chars(string_t *str, int pos, int count, char ch)
 void string_insert_cstr(string_t *str, int pos, const char *cstr)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (cstr == NULL || cstr[0] == '\0')
         return;
@@ -646,8 +680,8 @@ void string_insert_cstr(string_t *str, int pos, const char *cstr)
     if (pos > str->length)
         pos = str->length;
 
-    int cstr_len = (int)strlen(cstr);
-    int needed_capacity = str->length + cstr_len + 1;
+    ptrdiff_t cstr_len = (ptrdiff_t)strlen(cstr);
+    ptrdiff_t needed_capacity = str->length + cstr_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + cstr_len, str->data + pos, str->length - pos);
@@ -660,6 +694,7 @@ void string_insert_cstr(string_t *str, int pos, const char *cstr)
 void string_insert_data(string_t *str, int pos, const char *data, int len)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (data == NULL || len <= 0)
         return;
@@ -676,7 +711,7 @@ void string_insert_data(string_t *str, int pos, const char *data, int len)
     if (actual_len == 0)
         return;
 
-    int needed_capacity = str->length + actual_len + 1;
+    ptrdiff_t needed_capacity = str->length + actual_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + actual_len, str->data + pos, str->length - pos);
@@ -689,6 +724,7 @@ void string_insert_data(string_t *str, int pos, const char *data, int len)
 void string_erase(string_t *str, int pos, int len)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -696,8 +732,8 @@ void string_erase(string_t *str, int pos, int len)
         return;
     if (len <= 0)
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
     memmove(str->data + pos, str->data + pos + len, str->length - pos - len);
     str->length -= len;
@@ -710,13 +746,11 @@ void string_erase(string_t *str, int pos, int len)
 void string_push_back(string_t *str, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (ch == '\0')
         return;
-    if (str->length >= INT_MAX - 2)
-        return;
-
-    int needed_capacity = str->length + 1 + 1;
+    ptrdiff_t needed_capacity = str->length + 1 + 1;
     string_ensure_capacity(str, needed_capacity);
 
     str->data[str->length] = ch;
@@ -727,6 +761,7 @@ void string_push_back(string_t *str, char ch)
 char string_pop_back(string_t *str)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (str->length <= 0)
         return '\0';
@@ -741,15 +776,13 @@ char string_pop_back(string_t *str)
 void string_append(string_t *str, const string_t *other)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (other == NULL || other->length == 0)
         return;
 
-    int other_length = other->length;
-    if (other_length > INT_MAX - 1 - str->length)
-        other_length = INT_MAX - 1 - str->length;
-
-    int needed_capacity = str->length + other_length + 1;
+    ptrdiff_t other_length = other->length;
+    ptrdiff_t needed_capacity = str->length + other_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data + str->length, other->data, other_length);
@@ -760,18 +793,19 @@ void string_append(string_t *str, const string_t *other)
 void string_append_substring(string_t *str, const string_t *other, int begin, int end)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (other == NULL || other->length == 0)
         return;
 
-    int b, e;
+    ptrdiff_t b, e;
     clamp_range(other->length, begin, end, &b, &e);
 
     if (b == e)
         return;
 
-    int substring_length = e - b;
-    int needed_capacity = str->length + substring_length + 1;
+    ptrdiff_t substring_length = e - b;
+    ptrdiff_t needed_capacity = str->length + substring_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data + str->length, other->data + b, substring_length);
@@ -782,15 +816,13 @@ void string_append_substring(string_t *str, const string_t *other, int begin, in
 void string_append_cstr(string_t *str, const char *cstr)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (cstr == NULL || cstr[0] == '\0')
         return;
 
-    int cstr_len = (int)strlen(cstr);
-    if (cstr_len > INT_MAX - 1 - str->length)
-        cstr_len = INT_MAX - 1 - str->length;
-
-    int needed_capacity = str->length + cstr_len + 1;
+    ptrdiff_t cstr_len = (ptrdiff_t)strlen(cstr);
+    ptrdiff_t needed_capacity = str->length + cstr_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data + str->length, cstr, cstr_len);
@@ -801,14 +833,12 @@ void string_append_cstr(string_t *str, const char *cstr)
 void string_append_n_chars(string_t *str, int count, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (count <= 0 || ch == '\0')
         return;
 
-    if (count > INT_MAX - 1 - str->length)
-        count = INT_MAX - 1 - str->length;
-
-    int needed_capacity = str->length + count + 1;
+    ptrdiff_t needed_capacity = str->length + count + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memset(str->data + str->length, ch, count);
@@ -819,6 +849,7 @@ void string_append_n_chars(string_t *str, int count, char ch)
 void string_append_data(string_t *str, const char *data, int len)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (data == NULL || len <= 0)
         return;
@@ -830,10 +861,7 @@ void string_append_data(string_t *str, const char *data, int len)
     if (actual_len == 0)
         return;
 
-    if (actual_len > INT_MAX - 1 - str->length)
-        actual_len = INT_MAX - 1 - str->length;
-
-    int needed_capacity = str->length + actual_len + 1;
+    ptrdiff_t needed_capacity = str->length + actual_len + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memcpy(str->data + str->length, data, actual_len);
@@ -890,6 +918,7 @@ int string_append_utf8(string_t *str, uint32_t cp)
 void string_replace(string_t *str, int pos, int len, const string_t *other)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -897,13 +926,13 @@ void string_replace(string_t *str, int pos, int len, const string_t *other)
         return;
     if (len <= 0)
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
-    int other_len = (other == NULL) ? 0 : other->length;
+    ptrdiff_t other_len = (other == NULL) ? 0 : other->length;
 
-    int new_length = str->length - len + other_len;
-    int needed_capacity = new_length + 1;
+    ptrdiff_t new_length = str->length - len + other_len;
+    ptrdiff_t needed_capacity = new_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + other_len, str->data + pos + len, str->length - pos - len);
@@ -918,6 +947,7 @@ void string_replace(string_t *str, int pos, int len, const string_t *other)
 void string_replace_substring(string_t *str, int pos, int len, const string_t *other, int begin2, int end2)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -925,19 +955,19 @@ void string_replace_substring(string_t *str, int pos, int len, const string_t *o
         return;
     if (len <= 0)
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
-    int b = 0, e = 0;
-    int other_len = 0;
+    ptrdiff_t b = 0, e = 0;
+    ptrdiff_t other_len = 0;
     if (other != NULL && other->length > 0)
     {
         clamp_range(other->length, begin2, end2, &b, &e);
         other_len = e - b;
     }
 
-    int new_length = str->length - len + other_len;
-    int needed_capacity = new_length + 1;
+    ptrdiff_t new_length = str->length - len + other_len;
+    ptrdiff_t needed_capacity = new_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + other_len, str->data + pos + len, str->length - pos - len);
@@ -952,6 +982,7 @@ void string_replace_substring(string_t *str, int pos, int len, const string_t *o
 void string_replace_cstr(string_t *str, int pos, int len, const char *cstr)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -959,13 +990,13 @@ void string_replace_cstr(string_t *str, int pos, int len, const char *cstr)
         return;
     if (len <= 0)
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
-    int cstr_len = (cstr == NULL) ? 0 : (int)strlen(cstr);
+    ptrdiff_t cstr_len = (cstr == NULL) ? 0 : (ptrdiff_t)strlen(cstr);
 
-    int new_length = str->length - len + cstr_len;
-    int needed_capacity = new_length + 1;
+    ptrdiff_t new_length = str->length - len + cstr_len;
+    ptrdiff_t needed_capacity = new_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + cstr_len, str->data + pos + len, str->length - pos - len);
@@ -980,6 +1011,7 @@ void string_replace_cstr(string_t *str, int pos, int len, const char *cstr)
 void string_replace_n_chars(string_t *str, int pos, int len, int count, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -989,13 +1021,13 @@ void string_replace_n_chars(string_t *str, int pos, int len, int count, char ch)
         return;
     if (ch == '\0')
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
     int replacement_len = (count <= 0) ? 0 : count;
 
-    int new_length = str->length - len + replacement_len;
-    int needed_capacity = new_length + 1;
+    ptrdiff_t new_length = str->length - len + replacement_len;
+    ptrdiff_t needed_capacity = new_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + replacement_len, str->data + pos + len, str->length - pos - len);
@@ -1010,6 +1042,7 @@ void string_replace_n_chars(string_t *str, int pos, int len, int count, char ch)
 void string_replace_data(string_t *str, int pos, int len, const char *data, int data_len)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (pos < 0)
         pos = 0;
@@ -1019,8 +1052,8 @@ void string_replace_data(string_t *str, int pos, int len, const char *data, int
         return;
     if (data == NULL)
         return;
-    if (pos + len > str->length)
-        len = str->length - pos;
+    if (len > str->length - pos)
+        len = (int)(str->length - pos);
 
     int actual_data_len = 0;
     if (data_len > 0)
@@ -1029,8 +1062,8 @@ void string_replace_data(string_t *str, int pos, int len, const char *data, int
             actual_data_len++;
     }
 
-    int new_length = str->length - len + actual_data_len;
-    int needed_capacity = new_length + 1;
+    ptrdiff_t new_length = str->length - len + actual_data_len;
+    ptrdiff_t needed_capacity = new_length + 1;
     string_ensure_capacity(str, needed_capacity);
 
     memmove(str->data + pos + actual_data_len, str->data + pos + len, str->length - pos - len);
@@ -1050,7 +1083,7 @@ void string_copy_to_cstr(const string_t *str, char *dest, int count)
     if (count <= 0)
         return;
 
-    int to_copy = (str->length < count) ? str->length : count - 1;
+    ptrdiff_t to_copy = (str->length < count) ? str->length : count - 1;
     memcpy(dest, str->data, to_copy);
     dest[to_copy] = '\0';
 }
@@ -1071,8 +1104,8 @@ void string_copy_to_cstr_at(const string_t *str, int pos, char *dest, int count)
         return;
     }
 
-    int available = str->length - pos;
-    int to_copy = (available < count - 1) ? available : count - 1;
+    ptrdiff_t available = str->length - pos;
+    ptrdiff_t to_copy = (available < count - 1) ? available : count - 1;
     memcpy(dest, str->data + pos, to_copy);
     dest[to_copy] = '\0';
 }
@@ -1080,6 +1113,7 @@ void string_copy_to_cstr_at(const string_t *str, int pos, char *dest, int count)
 void string_resize(string_t *str, int new_size)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (new_size < 0)
         new_size = 0;
@@ -1093,6 +1127,7 @@ void string_resize(string_t *str, int new_size)
 void string_resize_with_char(string_t *str, int new_size, char ch)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (new_size < 0)
         new_size = 0;
@@ -1104,7 +1139,7 @@ void string_resize_with_char(string_t *str, int new_size, char ch)
         return;
     }
 
-    int needed = new_size + 1;
+    ptrdiff_t needed = (ptrdiff_t)new_size + 1;
     string_ensure_capacity(str, needed);
 
     memset(str->data + str->length, ch, new_size - str->length);
@@ -1114,8 +1149,137 @@ void string_resize_with_char(string_t *str, int new_size, char ch)
 
 // ============================================================================
 // String operations - Find
+//
+// Substring search uses memmem() where configure finds it (glibc implements
+// it with the two-way algorithm); elsewhere it scans for the needle's first
+// byte with memchr() and compares the rest only at candidate positions.
+// Reverse search does the same backwards, with memrchr() when available.
+// The find_*_of family tests each byte against a 256-bit set
+// built once per call instead of walking the character list for every
+// position; a single-character list reduces to memchr().
 // ============================================================================
 
+typedef struct byte_set_t
+{
+    uint64_t bits[4];
+} byte_set_t;
+
+static inline void byte_set_init(byte_set_t *set, const char *chars, ptrdiff_t len)
+{
+    memset(set, 0, sizeof(*set));
+    for (ptrdiff_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char)chars[i];
+        set->bits[c >> 6] |= UINT64_C(1) << (c & 63);
+    }
+}
+
+static inline bool byte_set_has(const byte_set_t *set, char ch)
+{
+    unsigned char c = (unsigned char)ch;
+    return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+// Offset of the first occurrence of needle[0, nlen) in hay[0, hlen), or -1
+static ptrdiff_t find_bytes(const char *hay, ptrdiff_t hlen, const char *needle, ptrdiff_t nlen)
+{
+    if (nlen > hlen)
+        return -1;
+
+#ifdef HAVE_MEMMEM
+    const char *p = memmem(hay, (size_t)hlen, needle, (size_t)nlen);
+    return p ? p - hay : -1;
+#else
+    const char *p = hay;
+    const char *last = hay + (hlen - nlen);
+    while (p <= last)
+    {
+        p = memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (p == NULL)
+            return -1;
+        if (memcmp(p + 1, needle + 1, (size_t)nlen - 1) == 0)
+            return p - hay;
+        p++;
+    }
+    return -1;
+#endif
+}
+
+// Offset of the last occurrence of needle[0, nlen) starting at or before
+// `start` in hay, or -1. Candidates are found by scanning backwards for the
+// needle's first byte, so only those positions pay for a memcmp().
+static ptrdiff_t rfind_bytes(const char *hay, ptrdiff_t start, const char *needle, ptrdiff_t nlen)
+{
+    ptrdiff_t span = start + 1;
+    while (span > 0)
+    {
+#ifdef HAVE_MEMRCHR
+        const char *p = memrchr(hay, needle[0], (size_t)span);
+        if (p == NULL)
+            return -1;
+#else
+        const char *p = hay + span - 1;
+        while (*p != needle[0])
+        {
+            if (p == hay)
+                return -1;
+            p--;
+        }
+#endif
+        if (memcmp(p + 1, needle + 1, (size_t)nlen - 1) == 0)
+            return p - hay;
+        span = p - hay;
+    }
+    return -1;
+}
+
+static int find_first_in_set(const string_t *str, const char *chars, ptrdiff_t nchars, int pos)
+{
+    if (nchars == 1)
+    {
+        const char *p = memchr(str->data + pos, chars[0], (size_t)(str->length - pos));
+        return p ? string_int_pos(p - str->data) : -1;
+    }
+
+    byte_set_t set;
+    byte_set_init(&set, chars, nchars);
+    for (ptrdiff_t i = pos; i < str->length; i++)
+    {
+        if (byte_set_has(&set, str->data[i]))
+            return string_int_pos(i);
+    }
+    return -1;
+}
+
+static int find_first_not_in_set(const string_t *str, const char *chars, ptrdiff_t nchars, int pos)
+{
+    byte_set_t set;
+    byte_set_init(&set, chars, nchars);
+    for (ptrdiff_t i = pos; i < str->length; i++)
+    {
+        if (!byte_set_has(&set, str->data[i]))
+            return string_int_pos(i);
+    }
+    return -1;
+}
+
+static int find_last_in_set(const string_t *str, const char *chars, ptrdiff_t nchars, int pos, bool in)
+{
+    byte_set_t set;
+    byte_set_init(&set, chars, nchars);
+    for (int i = pos; i >= 0; i--)
+    {
+        if (byte_set_has(&set, str->data[i]) == in)
+            return i;
+    }
+    return -1;
+}
+
+static ptrdiff_t cstr_length(const char *cstr)
+{
+    return (ptrdiff_t)strlen(cstr);
+}
+
 int string_find(const string_t *str, const string_t *substr)
 {
     Expects_not_null(str);
@@ -1136,16 +1300,8 @@ int string_find_at(const string_t *str, const string_t *substr, int pos)
     if (substr == NULL || substr->length == 0)
         return pos;
 
-    if (substr->length > str->length - pos)
-        return -1;
-
-    for (int i = pos; i <= str->length - substr->length; i++)
-    {
-        if (memcmp(str->data + i, substr->data, substr->length) == 0)
-            return i;
-    }
-
-    return -1;
+    ptrdiff_t found = find_bytes(str->data + pos, str->length - pos, substr->data, substr->length);
+    return found < 0 ? -1 : string_int_pos(pos + found);
 }
 
 int string_find_cstr(const string_t *str, const char *substr)
@@ -1168,26 +1324,16 @@ int string_find_cstr_at(const string_t *str, const char *substr, int pos)
     if (substr == NULL || substr[0] == '\0')
         return pos;
 
-    size_t sublen = strlen(substr);
-
-    if (sublen > (size_t)(str->length - pos))
-        return -1;
-
-    for (int i = pos; i <= str->length - (int)sublen; i++)
-    {
-        if (memcmp(str->data + i, substr, sublen) == 0)
-            return i;
-    }
-
-    return -1;
+    ptrdiff_t found = find_bytes(str->data + pos, str->length - pos, substr, cstr_length(substr));
+    return found < 0 ? -1 : string_int_pos(pos + found);
 }
 
 int string_rfind(const string_t *str, const string_t *substr)
 {
     Expects_not_null(str);
     if (substr == NULL || substr->length == 0)
-        return str->length;
-    return string_rfind_at(str, substr, str->length);
+        return string_int_length(str);
+    return string_rfind_at(str, substr, string_int_length(str));
 }
 
 int string_rfind_at(const string_t *str, const string_t *substr, int pos)
@@ -1202,25 +1348,19 @@ int string_rfind_at(const string_t *str, const string_t *substr, int pos)
     if (substr == NULL || substr->length == 0)
         return pos;
 
-    int start = pos;
+    ptrdiff_t start = pos;
     if (start > str->length - substr->length)
         start = str->length - substr->length;
 
-    for (int i = start; i >= 0; i--)
-    {
-        if (memcmp(str->data + i, substr->data, substr->length) == 0)
-            return i;
-    }
-
-    return -1;
+    return (int)rfind_bytes(str->data, start, substr->data, substr->length);
 }
 
 int string_rfind_cstr(const string_t *str, const char *substr)
 {
     Expects_not_null(str);
     if (substr == NULL || substr[0] == '\0')
-        return str->length;
-    return string_rfind_cstr_at(str, substr, str->length);
+        return string_int_length(str);
+    return string_rfind_cstr_at(str, substr, string_int_length(str));
 }
 
 int string_rfind_cstr_at(const string_t *str, const char *substr, int pos)
@@ -1235,19 +1375,13 @@ int string_rfind_cstr_at(const string_t *str, const char *substr, int pos)
     if (substr == NULL || substr[0] == '\0')
         return pos;
 
-    int sublen = (int)strlen(substr);
+    ptrdiff_t sublen = cstr_length(substr);
 
-    int start = pos;
+    ptrdiff_t start = pos;
     if (start > str->length - sublen)
         start = str->length - sublen;
 
-    for (int i = start; i >= 0; i--)
-    {
-        if (memcmp(str->data + i, substr, sublen) == 0)
-            return i;
-    }
-
-    return -1;
+    return (int)rfind_bytes(str->data, start, substr, sublen);
 }
 
 int string_find_first_of(const string_t *str, const string_t *chars)
@@ -1267,16 +1401,7 @@ int string_find_first_of_at(const string_t *str, const string_t *chars, int pos)
     if (pos >= str->length)
         return -1;
 
-    for (int i = pos; i < str->length; i++)
-    {
-        for (int j = 0; j < chars->length; j++)
-        {
-            if (str->data[i] == chars->data[j])
-                return i;
-        }
-    }
-
-    return -1;
+    return find_first_in_set(str, chars->data, chars->length, pos);
 }
 
 int string_find_first_of_cstr(const string_t *str, const char *chars)
@@ -1296,13 +1421,7 @@ int string_find_first_of_cstr_at(const string_t *str, const char *chars, int pos
     if (pos >= str->length)
         return -1;
 
-    for (int i = pos; i < str->length; i++)
-    {
-        if (strchr(chars, str->data[i]) != NULL)
-            return i;
-    }
-
-    return -1;
+    return find_first_in_set(str, chars, cstr_length(chars), pos);
 }
 
 int string_find_first_of_predicate(const string_t *str, bool (*predicate)(char))
@@ -1322,10 +1441,10 @@ int string_find_first_of_predicate_at(const string_t *str, bool (*predicate)(cha
     if (pos >= str->length)
         return -1;
 
-    for (int i = pos; i < str->length; i++)
+    for (ptrdiff_t i = pos; i < str->length; i++)
     {
         if (predicate(str->data[i]))
-            return i;
+            return string_int_pos(i);
     }
 
     return -1;
@@ -1348,22 +1467,7 @@ int string_find_first_not_of_at(const string_t *str, const string_t *chars, int
     if (chars == NULL || chars->length == 0)
         return (pos < str->length) ? pos : -1;
 
-    for (int i = pos; i < str->length; i++)
-    {
-        bool found = false;
-        for (int j = 0; j < chars->length; j++)
-        {
-            if (str->data[i] == chars->data[j])
-            {
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-            return i;
-    }
-
-    return -1;
+    return find_first_not_in_set(str, chars->data, chars->length, pos);
 }
 
 int string_find_first_not_of_cstr(const string_t *str, const char *chars)
@@ -1383,13 +1487,7 @@ int string_find_first_not_of_cstr_at(const string_t *str, const char *chars, int
     if (chars == NULL || chars[0] == '\0')
         return (pos < str->length) ? pos : -1;
 
-    for (int i = pos; i < str->length; i++)
-    {
-        if (strchr(chars, str->data[i]) == NULL)
-            return i;
-    }
-
-    return -1;
+    return find_first_not_in_set(str, chars, cstr_length(chars), pos);
 }
 
 int string_find_first_not_of_predicate(const string_t *str, bool (*predicate)(char))
@@ -1409,10 +1507,10 @@ int string_find_first_not_of_predicate_at(const string_t *str, bool (*predicate)
     if (predicate == NULL)
         return (pos < str->length) ? pos : -1;
 
-    for (int i = pos; i < str->length; i++)
+    for (ptrdiff_t i = pos; i < str->length; i++)
     {
         if (!predicate(str->data[i]))
-            return i;
+            return string_int_pos(i);
     }
 
     return -1;
@@ -1421,7 +1519,7 @@ int string_find_first_not_of_predicate_at(const string_t *str, bool (*predicate)
 int string_find_last_of(const string_t *str, const string_t *chars)
 {
     Expects_not_null(str);
-    return string_find_last_of_at(str, chars, str->length - 1);
+    return string_find_last_of_at(str, chars, string_int_length(str) - 1);
 }
 
 int string_find_last_of_at(const string_t *str, const string_t *chars, int pos)
@@ -1434,24 +1532,15 @@ int string_find_last_of_at(const string_t *str, const string_t *chars, int pos)
     if (pos < 0)
         return -1;
     if (pos >= str->length)
-        pos = str->length - 1;
-
-    for (int i = pos; i >= 0; i--)
-    {
-        for (int j = 0; j < chars->length; j++)
-        {
-            if (str->data[i] == chars->data[j])
-                return i;
-        }
-    }
+        pos = string_int_length(str) - 1;
 
-    return -1;
+    return find_last_in_set(str, chars->data, chars->length, pos, true);
 }
 
 int string_find_last_of_cstr(const string_t *str, const char *chars)
 {
     Expects_not_null(str);
-    return string_find_last_of_cstr_at(str, chars, str->length - 1);
+    return string_find_last_of_cstr_at(str, chars, string_int_length(str) - 1);
 }
 
 int string_find_last_of_cstr_at(const string_t *str, const char *chars, int pos)
@@ -1464,21 +1553,15 @@ int string_find_last_of_cstr_at(const string_t *str, const char *chars, int pos)
     if (pos < 0)
         return -1;
     if (pos >= str->length)
-        pos = str->length - 1;
-
-    for (int i = pos; i >= 0; i--)
-    {
-        if (strchr(chars, str->data[i]) != NULL)
-            return i;
-    }
+        pos = string_int_length(str) - 1;
 
-    return -1;
+    return find_last_in_set(str, chars, cstr_length(chars), pos, true);
 }
 
 int string_find_last_not_of(const string_t *str, const string_t *chars)
 {
     Expects_not_null(str);
-    return string_find_last_not_of_at(str, chars, str->length - 1);
+    return string_find_last_not_of_at(str, chars, string_int_length(str) - 1);
 }
 
 int string_find_last_not_of_at(const string_t *str, const string_t *chars, int pos)
@@ -1488,33 +1571,18 @@ int string_find_last_not_of_at(const string_t *str, const string_t *chars, int p
     if (pos < 0)
         return -1;
     if (pos >= str->length)
-        pos = str->length - 1;
+        pos = string_int_length(str) - 1;
 
     if (chars == NULL || chars->length == 0)
         return (str->length > 0) ? pos : -1;
 
-    for (int i = pos; i >= 0; i--)
-    {
-        bool found = false;
-        for (int j = 0; j < chars->length; j++)
-        {
-            if (str->data[i] == chars->data[j])
-            {
-                found = true;
-                break;
-            }
-        }
-        if (!found)
-            return i;
-    }
-
-    return -1;
+    return find_last_in_set(str, chars->data, chars->length, pos, false);
 }
 
 int string_find_last_not_of_cstr(const string_t *str, const char *chars)
 {
     Expects_not_null(str);
-    return string_find_last_not_of_cstr_at(str, chars, str->length - 1);
+    return string_find_last_not_of_cstr_at(str, chars, string_int_length(str) - 1);
 }
 
 int string_find_last_not_of_cstr_at(const string_t *str, const char *chars, int pos)
@@ -1524,18 +1592,12 @@ int string_find_last_not_of_cstr_at(const string_t *str, const char *chars, int
     if (pos < 0)
         return -1;
     if (pos >= str->length)
-        pos = str->length - 1;
+        pos = string_int_length(str) - 1;
 
     if (chars == NULL || chars[0] == '\0')
         return (str->length > 0) ? pos : -1;
 
-    for (int i = pos; i >= 0; i--)
-    {
-        if (strchr(chars, str->data[i]) == NULL)
-            return i;
-    }
-
-    return -1;
+    return find_last_in_set(str, chars, cstr_length(chars), pos, false);
 }
 
 // ============================================================================
@@ -1591,7 +1653,7 @@ int string_compare_cstr(const string_t *str, const char *cstr)
 int string_compare_cstr_at(const string_t *str, int pos1, const char *cstr, int pos2)
 {
     const char *buf1 = "";
-    int len1 = 0;
+    ptrdiff_t len1 = 0;
     if (str != NULL)
     {
         if (pos1 < 0)
@@ -1604,12 +1666,12 @@ int string_compare_cstr_at(const string_t *str, int pos1, const char *cstr, int
     }
 
     const char *buf2 = "";
-    int len2 = 0;
+    ptrdiff_t len2 = 0;
     if (cstr != NULL)
     {
         if (pos2 < 0)
             pos2 = 0;
-        int full_len = (int)strlen(cstr);
+        ptrdiff_t full_len = (ptrdiff_t)strlen(cstr);
         if (pos2 < full_len)
         {
             buf2 = cstr + pos2;
@@ -1617,7 +1679,7 @@ int string_compare_cstr_at(const string_t *str, int pos1, const char *cstr, int
         }
     }
 
-    int i = 0;
+    ptrdiff_t i = 0;
     while (i < len1 && i < len2)
     {
         if ((unsigned char)buf1[i] != (unsigned char)buf2[i])
@@ -1638,18 +1700,18 @@ int string_compare_substring(const string_t *str1, int begin1, int end1, const s
     Expects_not_null(str1);
     Expects_not_null(str2);
 
-    int b1, e1, b2, e2;
+    ptrdiff_t b1, e1, b2, e2;
     clamp_range(str1->length, begin1, end1, &b1, &e1);
     clamp_range(str2->length, begin2, end2, &b2, &e2);
 
-    int len1 = e1 - b1;
-    int len2 = e2 - b2;
+    ptrdiff_t len1 = e1 - b1;
+    ptrdiff_t len2 = e2 - b2;
 
     const char *p1 = (len1 > 0) ? str1->data + b1 : "";
     const char *p2 = (len2 > 0) ? str2->data + b2 : "";
 
-    int min_len = len1 < len2 ? len1 : len2;
-    int cmp = strncmp(p1, p2, min_len);
+    ptrdiff_t min_len = len1 < len2 ? len1 : len2;
+    int cmp = strncmp(p1, p2, (size_t)min_len);
 
     if (cmp != 0)
         return cmp;
@@ -1666,16 +1728,16 @@ int string_compare_cstr_substring(const string_t *str, int begin1, int end1, con
 {
     Expects_not_null(str);
 
-    int b1, e1;
+    ptrdiff_t b1, e1;
     clamp_range(str->length, begin1, end1, &b1, &e1);
-    int len1 = e1 - b1;
+    ptrdiff_t len1 = e1 - b1;
 
-    int len2 = 0;
-    int b2 = 0;
+    ptrdiff_t len2 = 0;
+    ptrdiff_t b2 = 0;
     if (cstr != NULL)
     {
-        int cstr_len = (int)strlen(cstr);
-        int dummy_e2;
+        ptrdiff_t cstr_len = (ptrdiff_t)strlen(cstr);
+        ptrdiff_t dummy_e2;
         clamp_range(cstr_len, begin2, end2, &b2, &dummy_e2);
         len2 = dummy_e2 - b2;
     }
@@ -1683,8 +1745,8 @@ int string_compare_cstr_substring(const string_t *str, int begin1, int end1, con
     const char *p1 = (len1 > 0) ? str->data + b1 : "";
     const char *p2 = (len2 > 0) ? cstr + b2 : "";
 
-    int min_len = len1 < len2 ? len1 : len2;
-    int cmp = strncmp(p1, p2, min_len);
+    ptrdiff_t min_len = len1 < len2 ? len1 : len2;
+    int cmp = strncmp(p1, p2, (size_t)min_len);
 
     if (cmp != 0)
         return cmp;
@@ -1716,7 +1778,7 @@ bool string_starts_with_cstr(const string_t *str, const char *prefix)
     if (prefix == NULL || prefix[0] == '\0')
         return true;
 
-    int prefix_len = (int)strlen(prefix);
+    ptrdiff_t prefix_len = (ptrdiff_t)strlen(prefix);
     if (prefix_len > str->length)
         return false;
 
@@ -1743,7 +1805,7 @@ bool string_ends_with_cstr(const string_t *str, const char *suffix)
     if (suffix == NULL || suffix[0] == '\0')
         return true;
 
-    int suffix_len = (int)strlen(suffix);
+    ptrdiff_t suffix_len = (ptrdiff_t)strlen(suffix);
     if (suffix_len > str->length)
         return false;
 
@@ -1830,6 +1892,7 @@ int string_cmp(const string_t *str1, const string_t *str2)
 void string_printf(string_t *str, const char *format, ...)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     va_list args;
     va_start(args, format);
@@ -1849,6 +1912,7 @@ void string_printf(string_t *str, const char *format, ...)
 void string_vprintf(string_t *str, const char *format, va_list args)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (format == NULL)
     {
@@ -1881,6 +1945,7 @@ void string_getline(string_t *str, FILE *stream)
 void string_getline_delim(string_t *str, char delim, FILE *stream)
 {
     Expects_not_null(str);
+    string_invalidate_hash(str);
 
     if (stream == NULL)
     {
@@ -2032,11 +2097,19 @@ uint32_t string_hash(const string_t *str)
     if (str == NULL || str->length == 0)
         return 0x811c9dc5;
 
+    // The cache is not part of the string's value, so filling it in through
+    // a const pointer is fine. Zero means "not computed", which is why a
+    // zero hash is reported as 1.
+    if (str->hash != 0)
+        return str->hash;
+
     uint32_t h = 0x811c9dc5;
-    for (int i = 0; i < str->length; i++)
+    for (ptrdiff_t i = 0; i < str->length; i++)
     {
         h ^= (uint32_t)(unsigned char)str->data[i];
         h *= 0x01000193;
     }
-    return h ? h : 1;
+    h = h ? h : 1;
+    ((string_t *)str)->hash = h;
+    return h;
 }
@@ -326,6 +326,32 @@ void strlist_move_push_back(strlist_t *list, string_t **str)
     list->size++;
 }
 
+void strlist_move_extend(strlist_t *list, strlist_t **other)
+{
+    Expects_not_null(list);
+
+    if (!other || !*other)
+    {
+        return;
+    }
+
+    strlist_t *src = *other;
+    if (list->size + src->size > list->capacity)
+    {
+        int new_capacity = list->capacity;
+        while (new_capacity < list->size + src->size)
+            new_capacity *= strlist_GROW_FACTOR;
+        strlist_normalize_capacity(list, new_capacity);
+    }
+
+    memcpy(list->strings + list->size, src->strings, src->size * sizeof(string_t *));
+    list->size += src->size;
+
+    // The strings now belong to list; destroy only the husk
+    src->size = 0;
+    strlist_destroy(other);
+}
+
 void strlist_insert(strlist_t *list, int index, const string_t *str)
 {
     Expects_not_null(list);
@@ -601,6 +601,60 @@ bool token_try_promote_to_rbrace(token_t *tok)
 {
     return token_try_promote_to_word_str_to_token(tok, "}", TOKEN_RBRACE);
 }
+
+void token_demote_assignment_to_word(token_t *tok)
+{
+    Expects_not_null(tok);
+
+    if (tok->type != TOKEN_ASSIGNMENT_WORD)
+        return;
+
+    /* Rebuild the leading "name=" literal, merged with the first part of
+     * the value when that is unquoted literal text, as the lexer had it */
+    string_t *text = string_create_from(tok->assignment_name);
+    string_append_cstr(text, "=");
+    part_list_t *value = tok->assignment_value;
+    int first = 0;
+    if (value && value->size > 0 && value->parts[0]->type == PART_LITERAL &&
+        !value->parts[0]->was_single_quoted && !value->parts[0]->was_double_quoted)
+    {
+        string_append(text, value->parts[0]->text);
+        first = 1;
+    }
+
+    if (!tok->parts)
+        tok->parts = part_list_create();
+    part_list_append(tok->parts, part_create_literal(text));
+    string_destroy(&text);
+
+    if (value)
+    {
+        /* Move the remaining parts; clear the old slots so that destroying
+         * the value list cannot reach them */
+        for (int i = first; i < value->size; i++)
+        {
+            part_list_append(tok->parts, value->parts[i]);
+            value->parts[i] = NULL;
+        }
+        if (first)
+            part_destroy(&value->parts[0]);
+        value->size = 0;
+        part_list_destroy(&tok->assignment_value);
+    }
+    string_destroy(&tok->assignment_name);
+    tok->type = TOKEN_WORD;
+
+    /* The expansion flags were not tracked for the assignment value */
+    for (int i = 0; i < tok->parts->size; i++)
+    {
+        const part_t *p = tok->parts->parts[i];
+        if (p->type == PART_LITERAL)
+            continue;
+        tok->needs_expansion = true;
+        if (p->type != PART_TILDE && !p->was_double_quoted && !p->was_single_quoted)
+            tok->needs_field_splitting = true;
+    }
+}
 /* ============================================================================
  * Token Location Tracking
  * ============================================================================ */
@@ -729,6 +783,39 @@ const char *token_type_to_cstr(token_type_t type)
     }
 }
 
+static void part_list_fill_hashes(const part_list_t *list)
+{
+    if (!list)
+        return;
+    for (int i = 0; i < list->size; i++)
+    {
+        const part_t *part = list->parts[i];
+        string_hash(part->text);
+        string_hash(part->param_name);
+        string_hash(part->word);
+        token_list_fill_hashes(part->nested);
+    }
+}
+
+void token_fill_hashes(const token_t *token)
+{
+    Expects_not_null(token);
+
+    part_list_fill_hashes(token->parts);
+    part_list_fill_hashes(token->assignment_value);
+    string_hash(token->assignment_name);
+    string_hash(token->io_location);
+    string_hash(token->heredoc_content);
+}
+
+void token_list_fill_hashes(const token_list_t *list)
+{
+    if (!list)
+        return;
+    for (int i = 0; i < list->size; i++)
+        token_fill_hashes(list->tokens[i]);
+}
+
 /* This returns a newly allocated DEBUG TREE representation of the token */
 string_t *token_to_string(const token_t *token)
 {
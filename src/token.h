@@ -405,6 +405,14 @@ bool token_try_promote_to_done(token_t *tok);
 bool token_try_promote_to_esac(token_t *tok);
 bool token_try_promote_to_in(token_t *tok);
 
+/**
+ * Turn a TOKEN_ASSIGNMENT_WORD back into an ordinary TOKEN_WORD with the
+ * same text. The lexer promotes every name=value word; after the command
+ * name such words are plain arguments ("export x=1", "local x=1").
+ * Does nothing for any other token type.
+ */
+void token_demote_assignment_to_word(token_t *tok);
+
 /* ============================================================================
  * Token Location Tracking
  * ============================================================================ */
@@ -468,6 +476,18 @@ bool token_is_operator(const char *str);
  */
 token_type_t token_string_to_operator(const char *str);
 
+/**
+ * Fill in the cached hash of every string held by the token, its parts and
+ * any nested tokens. Hashing them afterwards only reads, so the token can
+ * be shared between threads.
+ */
+void token_fill_hashes(const token_t *token);
+
+/**
+ * token_fill_hashes() for every token in the list. Safe to call with NULL.
+ */
+void token_list_fill_hashes(const token_list_t *list);
+
 /* ============================================================================
  * Part Lifecycle Functions
  * ============================================================================ */
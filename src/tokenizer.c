@@ -566,38 +566,38 @@ tok_status_t tokenizer_process_one_token(tokenizer_t *tok)
     token_t *token = tok->input_tokens->tokens[tok->input_pos];
 
     // Check if this token is eligible for alias expansion
-    if (tok->aliases != NULL && tokenizer_is_alias_eligible(tok, token))
+    if (tok->aliases != NULL && alias_store_size(tok->aliases) > 0 &&
+        tokenizer_is_alias_eligible(tok, token))
     {
-        // Extract the word text
-        char *word_text = tokenizer_extract_word_text(token);
-        if (word_text != NULL)
+        // Check the word against the store before copying it out: most
+        // words are not aliases, and the store turns those away cheaply
+        const string_t *word = part_get_text(token_get_part(token, 0));
+        if (word != NULL && alias_store_has_name(tok->aliases, word))
         {
-            // Check if there's an alias for this word
-            if (alias_store_has_name_cstr(tok->aliases, word_text))
-            {
-                // Check if already expanded (recursion prevention)
-                if (!tokenizer_is_alias_expanded(tok, word_text))
-                {
-                    // Before expanding, we need to remove this token from input
-                    // since it will be replaced by the expansion
-                    // token_list_remove will destroy the token
-                    token_list_remove(tok->input_tokens, tok->input_pos);
+            char *word_text = tokenizer_extract_word_text(token);
 
-                    // Expand the alias (this will insert new tokens at input_pos)
-                    tok_status_t status = tokenizer_expand_alias(tok, word_text);
-                    xfree(word_text);
+            // Check if already expanded (recursion prevention)
+            if (!tokenizer_is_alias_expanded(tok, word_text))
+            {
+                // Before expanding, we need to remove this token from input
+                // since it will be replaced by the expansion
+                // token_list_remove will destroy the token
+                token_list_remove(tok->input_tokens, tok->input_pos);
 
-                    if (status != TOK_OK)
-                    {
-                        return status;
-                    }
+                // Expand the alias (this will insert new tokens at input_pos)
+                tok_status_t status = tokenizer_expand_alias(tok, word_text);
+                xfree(word_text);
 
-                    // Don't increment input_pos - continue processing from the same position
-                    // which now contains the expanded tokens
-                    return TOK_OK;
+                if (status != TOK_OK)
+                {
+                    return status;
                 }
-                // else: alias already expanded, treat as normal word (fall through)
+
+                // Don't increment input_pos - continue processing from the same position
+                // which now contains the expanded tokens
+                return TOK_OK;
             }
+            // else: alias already expanded, treat as normal word (fall through)
             xfree(word_text);
         }
     }
@@ -698,18 +698,12 @@ tok_status_t tokenizer_process_one_token(tokenizer_t *tok)
 
                     if (all_digits)
                     {
-                        // Convert to TOKEN_IO_NUMBER by attaching it to the redirection operator
+                        // Convert this WORD to TOKEN_IO_NUMBER. The parser expects the
+                        // IO_NUMBER followed by the redirection operator as a separate token.
                         int io_num = atoi(word_text);
-                        token_list_set_io_number(tok->input_tokens, tok->input_pos + 1, io_num);
+                        token_list_set_io_number(tok->input_tokens, tok->input_pos, io_num);
                         xfree(word_text);
-
-                        // Remove this WORD token from input - it's been converted to an IO number
-                        // on the redirection operator. The token will be destroyed.
-                        token_list_remove(tok->input_tokens, tok->input_pos);
-
-                        // Don't increment input_pos - the next token is now at the current position
-                        // Continue processing from the same position
-                        return TOK_OK;
+                        goto add_token;
                     }
                 }
                 xfree(word_text);
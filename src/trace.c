@@ -0,0 +1,149 @@
+// ============================================================================
+// trace.c
+// Binary ring-buffer trace of executor events
+// ============================================================================
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef MIGA_POSIX_API
+#define _POSIX_C_SOURCE 202405L
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "trace.h"
+
+_Static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0,
+               "TRACE_BUFFER_SIZE must be a power of two");
+
+// A slot's sequence number is cleared while its record is being written and
+// published last, so a reader can tell a finished record from a torn one.
+typedef struct trace_slot_t
+{
+    _Atomic uint64_t seq;
+    uint64_t time_ns;
+    trace_event_t event;
+    int64_t a;
+    int64_t b;
+} trace_slot_t;
+
+volatile bool g_trace_enabled = false;
+
+static trace_slot_t trace_buffer[TRACE_BUFFER_SIZE];
+static _Atomic uint64_t trace_next; // Records claimed so far
+
+static const char *const trace_event_names[TRACE_EVENT_COUNT] = {
+    [TRACE_EVENT_NONE] = "none",
+    [TRACE_EVENT_FRAME_PUSH] = "frame-push",
+    [TRACE_EVENT_FRAME_POP] = "frame-pop",
+    [TRACE_EVENT_FORK] = "fork",
+    [TRACE_EVENT_WAIT] = "wait",
+    [TRACE_EVENT_PIPE] = "pipe",
+    [TRACE_EVENT_HEREDOC] = "heredoc",
+    [TRACE_EVENT_CMD_SUBST] = "cmd-subst",
+    [TRACE_EVENT_PARSE] = "parse",
+};
+
+static uint64_t trace_clock_ns(void)
+{
+    struct timespec ts;
+#ifdef MIGA_POSIX_API
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void trace_enable(bool enabled)
+{
+    g_trace_enabled = enabled;
+}
+
+bool trace_is_enabled(void)
+{
+    return g_trace_enabled;
+}
+
+void trace_clear(void)
+{
+    for (size_t i = 0; i < TRACE_BUFFER_SIZE; i++)
+        atomic_store_explicit(&trace_buffer[i].seq, 0, memory_order_relaxed);
+    atomic_store_explicit(&trace_next, 0, memory_order_release);
+}
+
+void trace_record(trace_event_t event, int64_t a, int64_t b)
+{
+    uint64_t seq = atomic_fetch_add_explicit(&trace_next, 1, memory_order_relaxed) + 1;
+    trace_slot_t *slot = &trace_buffer[(seq - 1) & (TRACE_BUFFER_SIZE - 1)];
+
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->time_ns = trace_clock_ns();
+    slot->event = event;
+    slot->a = a;
+    slot->b = b;
+    atomic_store_explicit(&slot->seq, seq, memory_order_release);
+}
+
+// Read the record with sequence number `seq`; false if it has been
+// overwritten or is still being written.
+static bool trace_read(uint64_t seq, trace_record_t *out)
+{
+    const trace_slot_t *slot = &trace_buffer[(seq - 1) & (TRACE_BUFFER_SIZE - 1)];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq)
+        return false;
+    out->seq = seq;
+    out->time_ns = slot->time_ns;
+    out->event = slot->event;
+    out->a = slot->a;
+    out->b = slot->b;
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+// First sequence number worth reading when at most `max` records are wanted
+static uint64_t trace_first(uint64_t last, size_t max)
+{
+    uint64_t keep = max < TRACE_BUFFER_SIZE ? max : TRACE_BUFFER_SIZE;
+    return last > keep ? last - keep + 1 : 1;
+}
+
+size_t trace_snapshot(trace_record_t *out, size_t max)
+{
+    uint64_t last = atomic_load_explicit(&trace_next, memory_order_acquire);
+    size_t count = 0;
+    for (uint64_t seq = trace_first(last, max); seq <= last && count < max; seq++)
+    {
+        if (trace_read(seq, &out[count]))
+            count++;
+    }
+    return count;
+}
+
+const char *trace_event_name(trace_event_t event)
+{
+    if (event < 0 || event >= TRACE_EVENT_COUNT || !trace_event_names[event])
+        return "unknown";
+    return trace_event_names[event];
+}
+
+void trace_dump(FILE *fp)
+{
+    uint64_t last = atomic_load_explicit(&trace_next, memory_order_acquire);
+    for (uint64_t seq = trace_first(last, TRACE_BUFFER_SIZE); seq <= last; seq++)
+    {
+        trace_record_t r;
+        if (!trace_read(seq, &r))
+            continue;
+        fprintf(fp, "%llu %llu.%09llu %s %lld %lld\n", (unsigned long long)r.seq,
+                (unsigned long long)(r.time_ns / 1000000000u),
+                (unsigned long long)(r.time_ns % 1000000000u), trace_event_name(r.event),
+                (long long)r.a, (long long)r.b);
+    }
+    fflush(fp);
+}
@@ -0,0 +1,85 @@
+// ============================================================================
+// trace.h
+// Binary ring-buffer trace of executor events
+// ============================================================================
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ============================================================================
+// Trace
+//
+// A fixed-size, process-wide ring buffer of binary records: an event id, two
+// integers and a monotonic timestamp. Recording costs an atomic increment and
+// a few stores, with no formatting and no allocation, so tracing can be left
+// on in production. Records are turned into text only by trace_dump(), which
+// runs on request (the miga_trace builtin) or when a fatal log message is
+// about to abort the process. Once the buffer is full the oldest records are
+// overwritten.
+//
+// Slots are claimed with an atomic counter, so concurrent writers never
+// share a slot; a reader skips any slot whose write has not completed.
+// ============================================================================
+
+// Number of records kept; must be a power of two
+#define TRACE_BUFFER_SIZE 4096
+
+// Event ids. The comment gives the meaning of the two integer arguments.
+typedef enum trace_event_t
+{
+    TRACE_EVENT_NONE,
+    TRACE_EVENT_FRAME_PUSH,     // frame type, enclosing loop depth
+    TRACE_EVENT_FRAME_POP,      // frame type, exit status
+    TRACE_EVENT_FORK,           // child pid, 0
+    TRACE_EVENT_WAIT,           // child pid, raw wait status
+    TRACE_EVENT_PIPE,           // read fd, write fd
+    TRACE_EVENT_HEREDOC,        // target fd, body length
+    TRACE_EVENT_CMD_SUBST,      // child pid, output length
+    TRACE_EVENT_PARSE,          // source line, parse status
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+typedef struct trace_record_t
+{
+    uint64_t seq;     // 1-based position in the stream of all records
+    uint64_t time_ns; // Monotonic clock
+    trace_event_t event;
+    int64_t a;
+    int64_t b;
+} trace_record_t;
+
+// Non-zero while tracing is on. Read through trace_event() so that a
+// disabled trace costs one load and a branch.
+extern volatile bool g_trace_enabled;
+
+void trace_enable(bool enabled);
+bool trace_is_enabled(void);
+
+// Forget every record
+void trace_clear(void);
+
+// Append a record unconditionally; normally called through trace_event()
+void trace_record(trace_event_t event, int64_t a, int64_t b);
+
+#define trace_event(event, a, b)                                                                   \
+    (g_trace_enabled ? trace_record((event), (int64_t)(a), (int64_t)(b)) : (void)0)
+
+// Copy out up to `max` of the most recent records, oldest first. Returns
+// the number copied.
+size_t trace_snapshot(trace_record_t *out, size_t max);
+
+// Name of an event id, e.g. "fork"
+const char *trace_event_name(trace_event_t event);
+
+// Write the buffered records, oldest first, one per line:
+//     <seq> <seconds>.<nanoseconds> <event> <a> <b>
+// Reads the buffer in place and allocates nothing, so it is safe to call
+// when the heap is in a bad state.
+void trace_dump(FILE *fp);
+
+#endif /* TRACE_H */
@@ -51,7 +51,14 @@ void trap_store_destroy(trap_store_t **store);
 trap_store_t *trap_store_clone(const trap_store_t *store);
 
 // Get or set the global trap store, which is the one
-// that will be used by the signal handlers
+// that will be used by the signal handlers.
+//
+// These two registrations stay process-wide on purpose: a signal is
+// delivered to the process, not to an executor or a thread, so only one
+// executor at a time can own the signal traps.  Trap actions themselves
+// live in each frame's trap store, and running commands never touches the
+// registrations, so executors on different threads do not share state
+// through them unless they install signal traps.
 trap_store_t *trap_store_get_current(void);
 void trap_store_set_current(trap_store_t *store);
 
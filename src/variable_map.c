@@ -65,12 +65,12 @@ static void destroy_entry(variable_map_entry_t *entry)
             }
             if (val->capacity > 12 * 1024 || val->capacity < 16)
             {
-                log_warn("destroy_entry: destroying very large value (capacity %zu) for key '%s'",
+                log_warn("destroy_entry: destroying very large value (capacity %td) for key '%s'",
                          val->capacity, entry->key ? string_cstr(entry->key) : "(null)");
             }
             if (val->length > val->capacity || val->length < 0)
             {
-                log_warn("destroy_entry: destroying value with invalid length %zu > capacity %zu "
+                log_warn("destroy_entry: destroying value with invalid length %td > capacity %td "
                          "for key '%s'",
                          val->length, val->capacity,
                          entry->key ? string_cstr(entry->key) : "(null)");
@@ -80,10 +80,10 @@ static void destroy_entry(variable_map_entry_t *entry)
                 log_warn("destroy_entry: destroying value with NULL data for key '%s'",
                          entry->key ? string_cstr(entry->key) : "(null)");
             }
-            if (strlen(val->data) != val->length)
+            if (strlen(val->data) != (size_t)val->length)
             {
                 log_warn("destroy_entry: destroying value with length mismatch (strlen %zu != "
-                         "length %zu) for key '%s'",
+                         "length %td) for key '%s'",
                          strlen(val->data), val->length,
                          entry->key ? string_cstr(entry->key) : "(null)");
             }
@@ -4,11 +4,14 @@
 
 #include <ctype.h>
 #include <limits.h>
+#include <stdlib.h>
 
 #define VARIABLE_MAP_INTERNAL
 #include "logging.h"
+#include "miga/mutex.h"
 #include "miga/strlist.h"
 #include "miga/string_t.h"
+#include "store_generation.h"
 #include "variable_map.h"
 #include "variable_store.h"
 #include "miga/xalloc.h"
@@ -18,21 +21,18 @@
 #define MAX_VAR_VALUE_LENGTH (128 * 1024) // 128KB
 
 // Helper function to validate variable name according to POSIX rules
-static var_store_error_t validate_variable_name(const string_t *name)
+static var_store_error_t validate_variable_name_cstr(const char *str, int len)
 {
-    if (string_empty(name))
+    if (len == 0)
     {
         return VAR_STORE_ERROR_EMPTY_NAME;
     }
 
-    int len = string_length(name);
     if (len > MAX_VAR_NAME_LENGTH)
     {
         return VAR_STORE_ERROR_NAME_TOO_LONG;
     }
 
-    const char *str = string_cstr(name);
-
     if (len == 1)
     {
         // Single character name may be special parameters.
@@ -67,6 +67,11 @@ static var_store_error_t validate_variable_name(const string_t *name)
     return VAR_STORE_ERROR_NONE;
 }
 
+static var_store_error_t validate_variable_name(const string_t *name)
+{
+    return validate_variable_name_cstr(string_cstr(name), string_length(name));
+}
+
 // Helper function to validate variable value
 static var_store_error_t validate_variable_value(const string_t *value)
 {
@@ -103,59 +108,41 @@ static void free_cached_envp(variable_store_t *store)
 {
     if (store->cached_envp)
     {
-        for (int i = 0; store->cached_envp[i] != NULL; i++)
+        // Only the leading strings are ours; the rest belong to the inherited envp
+        for (int i = 0; i < store->cached_envp_owned; i++)
         {
             xfree(store->cached_envp[i]);
         }
         xfree(store->cached_envp);
         store->cached_envp = NULL;
+        store->cached_envp_owned = 0;
     }
 }
 
-/**
- * Internal helper: look up a variable_map_entry_t by name.
- * This is for use within variable_store.c only. The variable_map_entry_t
- * type is internal and not exposed in the public header.
- */
-static const variable_map_entry_t *find_entry(const variable_store_t *store, const string_t *name)
-{
-    int32_t pos = variable_map_find(store->map, name);
-    if (pos == -1)
-    {
-        return NULL;
-    }
-    return &store->map->entries[pos];
-}
-
 variable_store_t *variable_store_create(void)
 {
     variable_store_t *store = xmalloc(sizeof(variable_store_t));
     store->map = variable_map_create();
-    store->generation = 0;
+    store->env_base = NULL;
+    store->generation = store_generation_next();
     store->cached_generation = 0;
     store->cached_parent_gen = 0;
     store->cached_parent = NULL;
     store->cached_envp = NULL;
+    store->cached_envp_owned = 0;
+    store->counters = NULL;
     return store;
 }
 
 /**
- * Parse a "NAME=VALUE" environment string into separate name and value strings.
- *
- * Validates that the name and value conform to POSIX shell variable rules.
- * Non-conforming entries are logged and skipped.
- *
- * On success, *out_name and *out_value are set to newly allocated strings
- * that the caller must free with string_destroy().
+ * Check that a "NAME=VALUE" environment string can be imported as a shell
+ * variable, without allocating anything.
  *
- * Returns true on success, false if the input is malformed or fails validation.
- * On failure, *out_name and *out_value are set to NULL.
+ * Non-conforming entries are logged and rejected. On success, *out_name_len
+ * is the length of NAME.
  */
-static bool parse_env_cstr(const char *env_str, string_t **out_name, string_t **out_value)
+static bool check_env_cstr(const char *env_str, int32_t *out_name_len)
 {
-    *out_name = NULL;
-    *out_value = NULL;
-
     if (!env_str || env_str[0] == '\0')
     {
         return false;
@@ -182,62 +169,323 @@ static bool parse_env_cstr(const char *env_str, string_t **out_name, string_t **
         return false;
     }
 
-    string_t *name = string_create_from_cstr_len(env_str, (int)name_len);
-    string_t *value = string_create_from_cstr(equals + 1);
-
     // Validate name conforms to POSIX rules
-    var_store_error_t name_err = validate_variable_name(name);
+    var_store_error_t name_err = validate_variable_name_cstr(env_str, (int)name_len);
     if (name_err != VAR_STORE_ERROR_NONE)
     {
-        log_debug("Skipping environment variable: invalid name '%s' (error %d)", string_cstr(name),
-                  name_err);
-        string_destroy(&name);
-        string_destroy(&value);
+        log_debug("Skipping environment variable: invalid name '%.*s' (error %d)", (int)name_len,
+                  env_str, name_err);
         return false;
     }
 
     // Validate value conforms to limits
-    var_store_error_t value_err = validate_variable_value(value);
-    if (value_err != VAR_STORE_ERROR_NONE)
+    if (strlen(equals + 1) > MAX_VAR_VALUE_LENGTH)
+    {
+        log_debug("Skipping environment variable: invalid value for '%.*s' (error %d)",
+                  (int)name_len, env_str, VAR_STORE_ERROR_VALUE_TOO_LONG);
+        return false;
+    }
+
+    *out_name_len = (int32_t)name_len;
+    return true;
+}
+
+/**
+ * Parse a "NAME=VALUE" environment string into separate name and value strings.
+ *
+ * Validates that the name and value conform to POSIX shell variable rules.
+ * Non-conforming entries are logged and skipped.
+ *
+ * On success, *out_name and *out_value are set to newly allocated strings
+ * that the caller must free with string_destroy().
+ *
+ * Returns true on success, false if the input is malformed or fails validation.
+ * On failure, *out_name and *out_value are set to NULL.
+ */
+static bool parse_env_cstr(const char *env_str, string_t **out_name, string_t **out_value)
+{
+    *out_name = NULL;
+    *out_value = NULL;
+
+    int32_t name_len;
+    if (!check_env_cstr(env_str, &name_len))
     {
-        log_debug("Skipping environment variable: invalid value for '%s' (error %d)",
-                  string_cstr(name), value_err);
-        string_destroy(&name);
-        string_destroy(&value);
         return false;
     }
 
-    *out_name = name;
-    *out_value = value;
+    *out_name = string_create_from_cstr_len(env_str, name_len);
+    *out_value = string_create_from_cstr(env_str + name_len + 1);
 
     return true;
 }
 
-variable_store_t *variable_store_create_from_envp(char * const *envp)
+/* ============================================================================
+ * Inherited Environment
+ * ============================================================================
+ *
+ * A shell often inherits hundreds of environment variables and uses a handful.
+ * Instead of turning each one into a map entry at startup, the store keeps the
+ * envp array as a backing layer under the map.  A name is in at most one of
+ * the two: once a variable is changed, removed, or the store is enumerated,
+ * the entry moves into the map and its slot here stops being live.
+ */
+
+typedef struct variable_env_slot_t
 {
-    variable_store_t *store = variable_store_create();
+    const char *entry; // "NAME=VALUE", borrowed from the envp array
+    int32_t name_len;
+    int32_t position; // Index in the envp array
+    bool live;        // Not yet moved into the map, overridden, or removed
+    string_t *name;   // Made on first read, or NULL; kept until the base goes
+    string_t *value;
+} variable_env_slot_t;
+
+struct variable_env_base_t
+{
+    char *const *envp;          // Borrowed from the caller
+    variable_env_slot_t *slots; // Sorted by name; NULL until the first lookup
+    int32_t count;
+    int32_t live;               // Live slots, once the index is built
+};
+
+static int compare_env_slots(const void *a, const void *b)
+{
+    const variable_env_slot_t *x = a;
+    const variable_env_slot_t *y = b;
+    int32_t len = x->name_len < y->name_len ? x->name_len : y->name_len;
+    int cmp = memcmp(x->entry, y->entry, (size_t)len);
+    if (cmp != 0)
+        return cmp;
+    if (x->name_len != y->name_len)
+        return x->name_len < y->name_len ? -1 : 1;
+    return x->position < y->position ? -1 : (x->position > y->position);
+}
 
-    if (envp)
+static variable_env_base_t *env_base_create(char *const *envp)
+{
+    variable_env_base_t *base = xcalloc(1, sizeof(variable_env_base_t));
+    base->envp = envp;
+    return base;
+}
+
+static void env_base_destroy(variable_env_base_t **base)
+{
+    if (!*base)
+        return;
+    for (int32_t i = 0; i < (*base)->count; i++)
     {
-        for (int i = 0; envp[i] != NULL; i++)
+        if ((*base)->slots[i].name)
         {
-            string_t *name;
-            string_t *value;
+            string_destroy(&(*base)->slots[i].name);
+            string_destroy(&(*base)->slots[i].value);
+        }
+    }
+    xfree((*base)->slots);
+    xfree(*base);
+    *base = NULL;
+}
 
-            if (parse_env_cstr(envp[i], &name, &value))
-            {
-                // Environment variables are exported by default and not read-only
-                variable_store_add(store, name, value, true, false);
+static void env_base_build_index(variable_env_base_t *base)
+{
+    if (base->slots)
+        return;
 
-                string_destroy(&name);
-                string_destroy(&value);
-            }
+    int32_t n = 0;
+    while (base->envp[n])
+        n++;
+    base->slots = xcalloc(n > 0 ? n : 1, sizeof(variable_env_slot_t));
+
+    int32_t count = 0;
+    for (int32_t i = 0; i < n; i++)
+    {
+        int32_t name_len;
+        if (check_env_cstr(base->envp[i], &name_len))
+        {
+            base->slots[count++] = (variable_env_slot_t){
+                .entry = base->envp[i], .name_len = name_len, .position = i, .live = true};
+        }
+    }
+    qsort(base->slots, (size_t)count, sizeof(variable_env_slot_t), compare_env_slots);
+
+    // As when importing entries one at a time, the last of a repeated name wins
+    base->count = count;
+    base->live = count;
+    for (int32_t i = 1; i < count; i++)
+    {
+        if (base->slots[i].name_len == base->slots[i - 1].name_len &&
+            memcmp(base->slots[i].entry, base->slots[i - 1].entry,
+                   (size_t)base->slots[i].name_len) == 0)
+        {
+            base->slots[i - 1].live = false;
+            base->live--;
+        }
+    }
+}
+
+// The live slot for NAME, or NULL
+static variable_env_slot_t *env_base_find(const variable_store_t *store, const string_t *name)
+{
+    variable_env_base_t *base = store->env_base;
+    if (!base || (base->slots && base->live == 0))
+        return NULL;
+    env_base_build_index(base);
+
+    const char *key = string_cstr(name);
+    int32_t key_len = string_length(name);
+    int32_t lo = 0;
+    int32_t hi = base->count;
+    while (lo < hi)
+    {
+        int32_t mid = lo + (hi - lo) / 2;
+        const variable_env_slot_t *slot = &base->slots[mid];
+        int32_t len = slot->name_len < key_len ? slot->name_len : key_len;
+        int cmp = memcmp(slot->entry, key, (size_t)len);
+        if (cmp == 0)
+            cmp = slot->name_len < key_len ? -1 : (slot->name_len > key_len);
+        if (cmp == 0)
+        {
+            // Repeated names sort by position, and only the last can be live
+            while (mid + 1 < hi && base->slots[mid + 1].name_len == key_len &&
+                   memcmp(base->slots[mid + 1].entry, key, (size_t)key_len) == 0)
+                mid++;
+            return base->slots[mid].live ? &base->slots[mid] : NULL;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+static void env_slot_make_strings(variable_env_slot_t *slot)
+{
+    if (!slot->name)
+    {
+        slot->name = string_create_from_cstr_len(slot->entry, slot->name_len);
+        slot->value = string_create_from_cstr(slot->entry + slot->name_len + 1);
+    }
+}
+
+// The variable no longer comes from the envp array: it was replaced or removed
+static void env_slot_retire(variable_store_t *store, variable_env_slot_t *slot)
+{
+    slot->live = false;
+    store->env_base->live--;
+}
+
+// Copy a live slot into the map as an exported variable; returns its position
+static int32_t env_slot_promote(variable_store_t *store, variable_env_slot_t *slot)
+{
+    env_slot_make_strings(slot);
+    variable_map_mapped_t mapped = {.value = slot->value, .exported = true, .read_only = false};
+    int32_t pos = variable_map_insert(store->map, slot->name, &mapped).pos;
+    env_slot_retire(store, slot);
+    return pos;
+}
+
+/**
+ * Copy every live slot into the map before the map is enumerated.
+ *
+ * Callers that enumerate a const store still get the same variables, just
+ * held differently, so this is allowed through a const pointer.  Strings
+ * already handed out from the slots stay valid until the base goes.
+ */
+static void env_base_promote_all(const variable_store_t *store)
+{
+    variable_env_base_t *base = store->env_base;
+    if (!base)
+        return;
+    env_base_build_index(base);
+    variable_store_t *mutable_store = (variable_store_t *)store;
+    for (int32_t i = 0; i < base->count && base->live > 0; i++)
+    {
+        if (base->slots[i].live)
+            env_slot_promote(mutable_store, &base->slots[i]);
+    }
+}
+
+// Another store reading the same envp array, with the same slots live
+static variable_env_base_t *env_base_clone(const variable_env_base_t *src)
+{
+    if (!src)
+        return NULL;
+    variable_env_base_t *base = env_base_create(src->envp);
+    if (src->slots)
+    {
+        base->slots = xcalloc(src->count > 0 ? src->count : 1, sizeof(variable_env_slot_t));
+        for (int32_t i = 0; i < src->count; i++)
+        {
+            base->slots[i] = src->slots[i];
+            base->slots[i].name = NULL;
+            base->slots[i].value = NULL;
         }
+        base->count = src->count;
+        base->live = src->live;
+    }
+    return base;
+}
+
+/**
+ * Internal helper: look up a variable by name, in the map and then in the
+ * inherited environment. Returns false, leaving *out_view alone, if there is
+ * no such variable.
+ */
+static bool find_variable(const variable_store_t *store, const string_t *name,
+                          variable_view_t *out_view)
+{
+    if (store->counters)
+        store->counters->lookups++;
+    int32_t pos = variable_map_find(store->map, name);
+    if (pos != -1)
+    {
+        const variable_map_entry_t *entry = &store->map->entries[pos];
+        out_view->name = entry->key;
+        out_view->value = entry->mapped.value;
+        out_view->exported = entry->mapped.exported;
+        out_view->read_only = entry->mapped.read_only;
+        return true;
+    }
+
+    variable_env_slot_t *slot = env_base_find(store, name);
+    if (!slot)
+    {
+        return false;
+    }
+    env_slot_make_strings(slot);
+    out_view->name = slot->name;
+    out_view->value = slot->value;
+    out_view->exported = true;
+    out_view->read_only = false;
+    return true;
+}
+
+variable_store_t *variable_store_create_from_envp(char * const *envp)
+{
+    variable_store_t *store = variable_store_create();
+
+    // Entries are looked at when first needed; see "Inherited Environment"
+    if (envp && envp[0])
+    {
+        store->env_base = env_base_create(envp);
     }
 
     return store;
 }
 
+void variable_store_import_env(variable_store_t *store)
+{
+    Expects_not_null(store);
+
+    if (store->env_base)
+    {
+        env_base_promote_all(store);
+        free_cached_envp(store);
+        store->generation = store_generation_next();
+        env_base_destroy(&store->env_base);
+    }
+}
+
 variable_store_t *variable_store_clone(const variable_store_t *src)
 {
     Expects_not_null(src);
@@ -250,6 +498,8 @@ variable_store_t *variable_store_clone(const variable_store_t *src)
                            entry->mapped.read_only);
         variable_map_iterator_increment(&it);
     }
+    clone->env_base = env_base_clone(src->env_base);
+    clone->counters = src->counters;
     return clone;
 }
 
@@ -269,6 +519,9 @@ variable_store_t *variable_store_clone_exported(const variable_store_t *src)
         }
         variable_map_iterator_increment(&it);
     }
+    // Inherited entries still read from envp are all exported
+    clone->env_base = env_base_clone(src->env_base);
+    clone->counters = src->counters;
     return clone;
 }
 
@@ -280,6 +533,7 @@ void variable_store_destroy(variable_store_t **store)
     }
 
     free_cached_envp(*store);
+    env_base_destroy(&(*store)->env_base);
     variable_map_destroy(&(*store)->map);
     xfree(*store);
     *store = NULL;
@@ -290,7 +544,8 @@ void variable_store_clear(variable_store_t *store)
     Expects_not_null(store);
 
     variable_map_clear(store->map);
-    store->generation++;
+    env_base_destroy(&store->env_base);
+    store->generation = store_generation_next();
     store->cached_generation = 0;
     store->cached_parent_gen = 0;
     store->cached_parent = NULL;
@@ -318,8 +573,8 @@ var_store_error_t variable_store_add(variable_store_t *store, const string_t *na
     }
 
     // Check if variable exists and is read-only
-    const variable_map_entry_t *existing = find_entry(store, name);
-    if (existing && existing->mapped.read_only)
+    int32_t pos = variable_map_find(store->map, name);
+    if (pos != -1 && store->map->entries[pos].mapped.read_only)
     {
         return VAR_STORE_ERROR_READ_ONLY;
     }
@@ -340,9 +595,21 @@ var_store_error_t variable_store_add(variable_store_t *store, const string_t *na
     // Insert or update the variable; insert_or_assign deep-copies so we still own mapped.value
     variable_map_insert_or_assign(store->map, name, &mapped);
     string_destroy(&mapped.value);
+    if (store->counters)
+        store->counters->inserts++;
+
+    // The new value hides any inherited one
+    if (pos == -1)
+    {
+        variable_env_slot_t *slot = env_base_find(store, name);
+        if (slot)
+        {
+            env_slot_retire(store, slot);
+        }
+    }
 
     // Invalidate cached envp
-    store->generation++;
+    store->generation = store_generation_next();
 
     return VAR_STORE_ERROR_NONE;
 }
@@ -391,8 +658,13 @@ void variable_store_remove(variable_store_t *store, const string_t *name)
     Expects_not_null(name);
 
     variable_map_erase(store->map, name);
+    variable_env_slot_t *slot = env_base_find(store, name);
+    if (slot)
+    {
+        env_slot_retire(store, slot);
+    }
     // Invalidate cached envp
-    store->generation++;
+    store->generation = store_generation_next();
 }
 
 void variable_store_remove_cstr(variable_store_t *store, const char *name)
@@ -410,7 +682,9 @@ bool variable_store_has_name(const variable_store_t *store, const string_t *name
     Expects_not_null(store);
     Expects_not_null(name);
 
-    return variable_map_contains(store->map, name);
+    if (store->counters)
+        store->counters->lookups++;
+    return variable_map_contains(store->map, name) || env_base_find(store, name) != NULL;
 }
 
 bool variable_store_has_name_cstr(const variable_store_t *store, const char *name)
@@ -431,8 +705,7 @@ bool variable_store_get_variable(const variable_store_t *store, const string_t *
     Expects_not_null(name);
     Expects_not_null(out_view);
 
-    const variable_map_entry_t *entry = find_entry(store, name);
-    if (!entry)
+    if (!find_variable(store, name, out_view))
     {
         out_view->name = NULL;
         out_view->value = NULL;
@@ -440,11 +713,6 @@ bool variable_store_get_variable(const variable_store_t *store, const string_t *
         out_view->read_only = false;
         return false;
     }
-
-    out_view->name = entry->key;
-    out_view->value = entry->mapped.value;
-    out_view->exported = entry->mapped.exported;
-    out_view->read_only = entry->mapped.read_only;
     return true;
 }
 
@@ -465,8 +733,8 @@ const string_t *variable_store_get_value(const variable_store_t *store, const st
 {
     Expects_not_null(store);
     Expects_not_null(name);
-    const variable_map_entry_t *entry = find_entry(store, name);
-    return entry ? entry->mapped.value : NULL;
+    variable_view_t view;
+    return find_variable(store, name, &view) ? view.value : NULL;
 }
 
 const char *variable_store_get_value_cstr(const variable_store_t *store, const char *name)
@@ -486,8 +754,8 @@ bool variable_store_is_read_only(const variable_store_t *store, const string_t *
 {
     Expects_not_null(store);
     Expects_not_null(name);
-    const variable_map_entry_t *entry = find_entry(store, name);
-    return entry ? entry->mapped.read_only : false;
+    variable_view_t view;
+    return find_variable(store, name, &view) ? view.read_only : false;
 }
 
 bool variable_store_is_read_only_cstr(const variable_store_t *store, const char *name)
@@ -505,8 +773,8 @@ bool variable_store_is_exported(const variable_store_t *store, const string_t *n
 {
     Expects_not_null(store);
     Expects_not_null(name);
-    const variable_map_entry_t *entry = find_entry(store, name);
-    return entry ? entry->mapped.exported : false;
+    variable_view_t view;
+    return find_variable(store, name, &view) ? view.exported : false;
 }
 
 bool variable_store_is_exported_cstr(const variable_store_t *store, const char *name)
@@ -529,7 +797,12 @@ var_store_error_t variable_store_set_read_only(variable_store_t *store, const st
     variable_map_mapped_t *mapped = variable_map_data_at(store->map, name);
     if (!mapped)
     {
-        return VAR_STORE_ERROR_NOT_FOUND;
+        variable_env_slot_t *slot = env_base_find(store, name);
+        if (!slot)
+        {
+            return VAR_STORE_ERROR_NOT_FOUND;
+        }
+        mapped = &store->map->entries[env_slot_promote(store, slot)].mapped;
     }
 
     // Cannot unset read-only flag on a read-only variable
@@ -540,7 +813,7 @@ var_store_error_t variable_store_set_read_only(variable_store_t *store, const st
 
     mapped->read_only = read_only;
     // Invalidate cached envp
-    store->generation++;
+    store->generation = store_generation_next();
     return VAR_STORE_ERROR_NONE;
 }
 
@@ -565,7 +838,12 @@ var_store_error_t variable_store_set_exported(variable_store_t *store, const str
     variable_map_mapped_t *mapped = variable_map_data_at(store->map, name);
     if (!mapped)
     {
-        return VAR_STORE_ERROR_NOT_FOUND;
+        variable_env_slot_t *slot = env_base_find(store, name);
+        if (!slot)
+        {
+            return VAR_STORE_ERROR_NOT_FOUND;
+        }
+        mapped = &store->map->entries[env_slot_promote(store, slot)].mapped;
     }
 
     if (mapped->read_only)
@@ -575,7 +853,7 @@ var_store_error_t variable_store_set_exported(variable_store_t *store, const str
 
     mapped->exported = exported;
     // Invalidate cached envp
-    store->generation++;
+    store->generation = store_generation_next();
 
     return VAR_STORE_ERROR_NONE;
 }
@@ -596,18 +874,19 @@ int32_t variable_store_get_value_length(const variable_store_t *store, const str
 {
     Expects_not_null(store);
     Expects_not_null(name);
-    const variable_map_entry_t *entry = find_entry(store, name);
-    if (!entry)
+    variable_view_t view;
+    if (!find_variable(store, name, &view))
     {
         return -1;
     }
-    return entry->mapped.value ? string_length(entry->mapped.value) : 0;
+    return view.value ? string_length(view.value) : 0;
 }
 
 void variable_store_for_each(const variable_store_t *store, var_store_iter_fn fn, void *user_data)
 {
     Expects_not_null(store);
     Expects_not_null(fn);
+    env_base_promote_all(store);
     for (int32_t i = 0; i < store->map->capacity; i++)
     {
         if (store->map->entries[i].occupied)
@@ -626,6 +905,7 @@ var_store_error_t variable_store_map(variable_store_t *store, var_store_map_fn f
 {
     Expects_not_null(store);
     Expects_not_null(fn);
+    env_base_promote_all(store);
 
     // Collect keys to remove after iteration to avoid invalidating the iteration
     strlist_t *keys_to_remove = NULL;
@@ -798,7 +1078,7 @@ var_store_error_t variable_store_map(variable_store_t *store, var_store_map_fn f
     xfree(rename_exported);
     xfree(rename_read_only);
 
-    store->generation++;
+    store->generation = store_generation_next();
     return VAR_STORE_ERROR_NONE;
 
 cleanup:
@@ -885,9 +1165,16 @@ char *const *variable_store_get_envp(variable_store_t *store)
 
     // Free old cached envp
     free_cached_envp(store);
+    if (store->counters)
+        store->counters->envp_builds++;
 
     // Allocate for worst case: all variables from current store could be exported
     int max_count = store->map->size;
+    if (store->env_base)
+    {
+        env_base_build_index(store->env_base);
+        max_count += store->env_base->live;
+    }
     store->cached_envp = xcalloc(max_count + 1, sizeof(char *));
 
     int idx = 0;
@@ -901,6 +1188,19 @@ char *const *variable_store_get_envp(variable_store_t *store)
                 make_env_cstr(store->map->entries[i].key, store->map->entries[i].mapped.value);
         }
     }
+    store->cached_envp_owned = idx;
+
+    // Inherited entries nobody changed are passed through as they came
+    if (store->env_base)
+    {
+        for (int32_t i = 0; i < store->env_base->count; i++)
+        {
+            if (store->env_base->slots[i].live)
+            {
+                store->cached_envp[idx++] = (char *)store->env_base->slots[i].entry;
+            }
+        }
+    }
 
     store->cached_envp[idx] = NULL; // NULL-terminate
 
@@ -917,6 +1217,7 @@ void variable_store_copy_all(variable_store_t *dst, const variable_store_t *src)
     if (!dst || !src || !src->map)
         return;
 
+    env_base_promote_all(src);
     for (int32_t i = 0; i < src->map->capacity; i++)
     {
         if (!src->map->entries[i].occupied)
@@ -989,6 +1290,9 @@ bool variable_store_debug_verify_independent(const variable_store_t *store_a,
 
     bool all_ok = true;
 
+    env_base_promote_all(store_a);
+    env_base_promote_all(store_b);
+
     // Check that both stores have the same number of variables
     if (store_a->map->size != store_b->map->size)
     {
@@ -1141,3 +1445,9 @@ bool variable_store_debug_verify_independent(const variable_store_t *store_a,
 
     return all_ok;
 }
+
+void variable_store_set_counters(variable_store_t *store, variable_store_counters_t *counters)
+{
+    Expects_not_null(store);
+    store->counters = counters;
+}
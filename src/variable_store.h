@@ -32,8 +32,20 @@
  * The internal variable_map is not exposed through this header.
  */
 
-/* Forward declaration -- opaque to public consumers */
+/* Forward declarations -- opaque to public consumers */
 typedef struct variable_map_t variable_map_t;
+typedef struct variable_env_base_t variable_env_base_t;
+
+/**
+ * Activity counters for the stores of one executor, reported through
+ * exec_get_stats().
+ */
+typedef struct variable_store_counters_t
+{
+    uint64_t lookups;
+    uint64_t inserts;
+    uint64_t envp_builds;
+} variable_store_counters_t;
 
 /**
  * Represents a shell variable store containing name/value pairs,
@@ -43,8 +55,17 @@ typedef struct variable_store_t
 {
     /** Map of variable names to values and metadata. (Internal -- do not access directly.) */
     variable_map_t *map;
+    /**
+     * Inherited environment entries that have not been copied into the map,
+     * or NULL. They are read from the original envp array on demand.
+     * (Internal -- do not access directly.)
+     */
+    variable_env_base_t *env_base;
 
-    /** Increment on any modification */
+    /**
+     * Changes on any modification. Drawn from store_generation_next(), so a
+     * generation is never reused, even by another store at the same address.
+     */
     uint32_t generation;
     /** Cached environment array generation info. */
     uint32_t cached_generation;
@@ -57,6 +78,13 @@ typedef struct variable_store_t
      * Owned by the store and rebuilt on demand.
      */
     char **cached_envp;
+    /**
+     * Number of leading cached_envp strings that the store allocated. The
+     * rest are borrowed unchanged from the inherited envp array.
+     */
+    int32_t cached_envp_owned;
+    /** Where to count activity, or NULL. Clones share it. */
+    variable_store_counters_t *counters;
 } variable_store_t;
 
 /**
@@ -109,7 +137,16 @@ variable_store_t *variable_store_create(void);
 
 /**
  * Creates a variable store initialized from an envp array.
- * The envp strings are deep-copied; the caller retains ownership.
+ *
+ * Nothing is copied up front: the store keeps the envp array as a backing
+ * layer, looks names up in it on demand (a sorted index is built on the first
+ * lookup that misses the variable map), and copies an entry into the map only
+ * when it is changed or the store is enumerated. Entries nobody changed are
+ * passed through unchanged by variable_store_get_envp().
+ *
+ * The caller retains ownership of envp, which must stay valid and unchanged
+ * while this store, or any clone of it, exists. Use
+ * variable_store_import_env() on a store that must outlive the array.
  *
  * @param envp NULL-terminated environment array.
  * @return Newly allocated variable store.
@@ -133,6 +170,14 @@ variable_store_t *variable_store_clone(const variable_store_t *src);
  */
 variable_store_t *variable_store_clone_exported(const variable_store_t *src);
 
+/**
+ * Copies every inherited environment entry the store still reads from its
+ * envp array into the store itself, so that the array may go away.
+ *
+ * @param store Variable store.
+ */
+void variable_store_import_env(variable_store_t *store);
+
 /**
  * Destroys a variable store and frees all associated memory.
  *
@@ -490,4 +535,11 @@ char *const *variable_store_get_envp(variable_store_t *vs);
  */
 string_t *variable_store_write_env_file(variable_store_t *vars);
 
+/**
+ * Count the store's lookups, inserts and environment array rebuilds in
+ * @p counters, which must outlive the store and every clone made from it
+ * afterwards. NULL stops counting.
+ */
+void variable_store_set_counters(variable_store_t *store, variable_store_counters_t *counters);
+
 #endif
@@ -34,12 +34,26 @@ static miga_arena_t global_arena = {.rollback_in_progress = false,
                                .initial_cap = ARENA_INITIAL_CAP,
                                .max_allocations = ARENA_MAX_ALLOCATIONS};
 
+// Arena that xmalloc and friends use on this thread; NULL means the global arena
+static MIGA_THREAD_LOCAL miga_arena_t *thread_arena = NULL;
+
+// Arenas made by miga_arena_create(), searched when memory is freed or
+// reallocated outside the arena that allocated it.  Guarded by global_arena.mtx.
+static miga_arena_t **registered_arenas = NULL;
+static long registered_count = 0;
+static long registered_cap = 0;
+
 // Provide access to global arena for miga_setjmp() macro
 miga_arena_t *miga_arena_get_global(void)
 {
     return &global_arena;
 }
 
+static inline miga_arena_t *current_arena(void)
+{
+    return thread_arena ? thread_arena : &global_arena;
+}
+
 // -------------------------------------------------------------
 // Internal helpers for maintaining the sorted pointer list
 // -------------------------------------------------------------
@@ -369,6 +383,7 @@ void *arena_xmalloc(miga_arena_t *arena, size_t size MIGA_ARENA_DEBUG_PARAMS)
     {
         fprintf(stderr, "%s: %p failed to track allocation\n", __func__, p);
     }
+    arena->bytes_allocated += size;
     miga_mutex_unlock(&arena->mtx);
     return p;
 }
@@ -410,6 +425,7 @@ void *arena_xcalloc(miga_arena_t *arena, size_t n, size_t size MIGA_ARENA_DEBUG_
     {
         fprintf(stderr, "%s: %p failed to track allocation\n", __func__, p);
     }
+    arena->bytes_allocated += n * size;
     miga_mutex_unlock(&arena->mtx);
     return p;
 }
@@ -482,6 +498,7 @@ void *arena_xrealloc(miga_arena_t *arena, void *old_ptr, size_t new_size MIGA_AR
     {
         fprintf(stderr, "%s: %p failed to track allocation\n", __func__, p);
     }
+    arena->bytes_allocated += new_size;
     miga_mutex_unlock(&arena->mtx);
     return p;
 }
@@ -520,19 +537,48 @@ char *arena_xstrdup(miga_arena_t *arena, const char *s MIGA_ARENA_DEBUG_PARAMS)
     {
         fprintf(stderr, "%s: %p failed to track allocation\n", __func__, p);
     }
+    arena->bytes_allocated += strlen(s) + 1;
     miga_mutex_unlock(&arena->mtx);
     return p;
 }
 
-void arena_xfree(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS)
+// True if p is tracked by the arena
+static bool arena_contains(miga_arena_t *arena, const void *p)
 {
-    if (!arena)
-    {
-        fprintf(stderr, "arena_xfree: NULL arena pointer\n");
-        abort();
+    ensure_mutex(arena);
+    miga_mutex_lock(&arena->mtx);
+    bool found = arena->initialized && arena->allocated_count > 0 && find_ptr(arena, p) >= 0;
+    miga_mutex_unlock(&arena->mtx);
+    return found;
+}
+
+miga_arena_t *arena_owner_ex(const void *p)
+{
+    miga_arena_t *current = current_arena();
+    if (!p || arena_contains(current, p))
+        return current;
+    if (current != &global_arena && arena_contains(&global_arena, p))
+        return &global_arena;
+
+    // Not found anywhere: hand back the current arena so that it reports the bad pointer
+    miga_arena_t *owner = current;
+    ensure_mutex(&global_arena);
+    miga_mutex_lock(&global_arena.mtx);
+    for (long i = 0; i < registered_count; i++)
+    {
+        if (registered_arenas[i] != current && arena_contains(registered_arenas[i], p))
+        {
+            owner = registered_arenas[i];
+            break;
+        }
     }
-    if (!p)
-        return;
+    miga_mutex_unlock(&global_arena.mtx);
+    return owner;
+}
+
+// Free p if the arena tracks it; returns false, having done nothing, if it does not
+static bool arena_free_tracked(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS)
+{
     ensure_mutex(arena);
     miga_mutex_lock(&arena->mtx);
     ensure_initialized(arena);
@@ -543,11 +589,8 @@ void arena_xfree(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS)
     long idx = find_ptr(arena, p);
     if (idx < 0)
     {
-#ifdef MIGA_ARENA_DEBUG
-        fprintf(stderr, "DEALLOC: %p (unknown):0 0 (double free or corruption detected)\n", p);
-#endif
-        fprintf(stderr, "arena_xfree: double free or corruption detected (%p)\n", p);
-        abort();
+        miga_mutex_unlock(&arena->mtx);
+        return false;
     }
 
 #ifdef MIGA_ARENA_DEBUG
@@ -558,6 +601,30 @@ void arena_xfree(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS)
     remove_ptr_at(arena, idx);
     free(p);
     miga_mutex_unlock(&arena->mtx);
+    return true;
+}
+
+void arena_xfree(miga_arena_t *arena, void *p MIGA_ARENA_DEBUG_PARAMS)
+{
+    if (!arena)
+    {
+        fprintf(stderr, "arena_xfree: NULL arena pointer\n");
+        abort();
+    }
+    if (!p)
+        return;
+
+#ifdef MIGA_ARENA_DEBUG
+    if (!arena_free_tracked(arena, p, file, line))
+    {
+        fprintf(stderr, "DEALLOC: %p (unknown):0 0 (double free or corruption detected)\n", p);
+#else
+    if (!arena_free_tracked(arena, p))
+    {
+#endif
+        fprintf(stderr, "arena_xfree: double free or corruption detected (%p)\n", p);
+        abort();
+    }
 }
 
 void arena_init_ex(miga_arena_t *arena)
@@ -691,30 +758,105 @@ void arena_end_ex(miga_arena_t *arena)
 #ifndef MIGA_ARENA_DEBUG
 void *xmalloc(size_t size)
 {
-    return arena_xmalloc(&global_arena, size);
+    return arena_xmalloc(current_arena(), size);
 }
 
 void *xcalloc(size_t n, size_t size)
 {
-    return arena_xcalloc(&global_arena, n, size);
+    return arena_xcalloc(current_arena(), n, size);
 }
 
 void *xrealloc(void *old_ptr, size_t new_size)
 {
-    return arena_xrealloc(&global_arena, old_ptr, new_size);
+    // The block stays in the arena that allocated it
+    return arena_xrealloc(arena_owner_ex(old_ptr), old_ptr, new_size);
 }
 
 char *xstrdup(const char *s)
 {
-    return arena_xstrdup(&global_arena, s);
+    return arena_xstrdup(current_arena(), s);
 }
 
 void xfree(void *p)
 {
-    arena_xfree(&global_arena, p);
+    if (!p)
+        return;
+    miga_arena_t *arena = current_arena();
+    if (!arena_free_tracked(arena, p))
+        arena_xfree(arena_owner_ex(p), p);
 }
 #endif
 
+// -------------------------------------------------------------
+// Additional arenas
+// -------------------------------------------------------------
+
+miga_arena_t *miga_arena_create(void)
+{
+    miga_arena_t *arena = calloc(1, sizeof(miga_arena_t));
+    if (!arena)
+    {
+        fprintf(stderr, "miga_arena_create: out of memory\n");
+        abort();
+    }
+    arena_init_ex(arena);
+
+    ensure_mutex(&global_arena);
+    miga_mutex_lock(&global_arena.mtx);
+    if (registered_count == registered_cap)
+    {
+        long new_cap = registered_cap > 0 ? registered_cap * 2 : 8;
+        miga_arena_t **grown = realloc(registered_arenas, new_cap * sizeof(miga_arena_t *));
+        if (!grown)
+        {
+            fprintf(stderr, "miga_arena_create: out of memory\n");
+            abort();
+        }
+        registered_arenas = grown;
+        registered_cap = new_cap;
+    }
+    registered_arenas[registered_count++] = arena;
+    miga_mutex_unlock(&global_arena.mtx);
+    return arena;
+}
+
+void miga_arena_destroy(miga_arena_t **arena_ptr)
+{
+    if (!arena_ptr || !*arena_ptr)
+        return;
+    miga_arena_t *arena = *arena_ptr;
+
+    ensure_mutex(&global_arena);
+    miga_mutex_lock(&global_arena.mtx);
+    for (long i = 0; i < registered_count; i++)
+    {
+        if (registered_arenas[i] == arena)
+        {
+            registered_arenas[i] = registered_arenas[--registered_count];
+            break;
+        }
+    }
+    miga_mutex_unlock(&global_arena.mtx);
+
+    if (thread_arena == arena)
+        thread_arena = NULL;
+    arena_end_ex(arena);
+    free(arena);
+    *arena_ptr = NULL;
+}
+
+miga_arena_t *miga_arena_get_current(void)
+{
+    return current_arena();
+}
+
+miga_arena_t *miga_arena_set_current(miga_arena_t *arena)
+{
+    miga_arena_t *previous = current_arena();
+    thread_arena = (arena == &global_arena) ? NULL : arena;
+    return previous;
+}
+
 /**
  * Preps the singleton internal memory arena to its initial state.
  */
@@ -755,3 +897,8 @@ void miga_arena_end(void)
 {
     arena_end_ex(&global_arena);
 }
+
+uint64_t miga_arena_bytes_allocated(void)
+{
+    return global_arena.bytes_allocated;
+}
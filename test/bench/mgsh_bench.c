@@ -0,0 +1,890 @@
+/**
+ * @file mgsh_bench.c
+ * @brief Microbenchmarks and end-to-end workloads for the shell
+ *
+ * Benchmarks are declared with the ctest CTEST() macro, so they are
+ * registered, listed and sanity-checked the same way unit tests are.  The
+ * runner below replaces ctest_run_suite(): it calls each benchmark body
+ * repeatedly, with bench_iterations() telling the body how many operations
+ * to perform per timed sample, and reports the median time per operation.
+ *
+ * Usage:
+ *   mgsh-bench [--quick] [--filter SUBSTR] [--json FILE]
+ *              [--baseline FILE] [--threshold PCT] [--list]
+ *
+ * Results are always printed as a table on stderr.  --json writes them as
+ * JSON ("-" for stdout).  --baseline reads a JSON file from an earlier run
+ * and flags every benchmark that got slower by more than --threshold
+ * percent (default 10); the exit status is 1 if any did, or if any
+ * benchmark failed its sanity checks.  --quick shortens the samples and
+ * shrinks the script workloads tenfold for smoke runs; its numbers are
+ * only comparable with other --quick runs.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ctest.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+#include "alias_store.h"
+#include "arithmetic.h"
+#include "ast.h"
+#include "exec_frame_expander.h"
+#include "glob_util.h"
+#include "gnode.h"
+#include "lexer.h"
+#include "logging.h"
+#include "lower.h"
+#include "parser.h"
+#include "profiler.h"
+#include "token.h"
+#include "tokenizer.h"
+#include "variable_store.h"
+#include "xalloc.h"
+
+/* ============================================================================
+ * Runner state
+ * ============================================================================ */
+
+#define BENCH_SAMPLES 5
+#define BENCH_MAX_RESULTS 64
+
+typedef struct bench_state_t
+{
+    long iterations;      /* Operations the body must perform this call */
+    size_t bytes_per_op;  /* Input size, for throughput; 0 if not meaningful */
+} bench_state_t;
+
+typedef struct bench_result_t
+{
+    const char *name;
+    long iterations;
+    double ns_per_op;
+    double mb_per_s;
+    bool ok;
+} bench_result_t;
+
+static long bench_iterations(const CTest *ctest)
+{
+    return ((const bench_state_t *)ctest->user_data)->iterations;
+}
+
+static void bench_set_bytes(CTest *ctest, size_t bytes)
+{
+    ((bench_state_t *)ctest->user_data)->bytes_per_op = bytes;
+}
+
+/* ============================================================================
+ * Fixtures
+ * ============================================================================ */
+
+/* A little of everything the lexer and parser have to handle */
+static const char bench_script_snippet[] =
+    "# configuration\n"
+    "prefix=${PREFIX:-/usr/local} count=0\n"
+    "for f in \"$@\" *.c; do\n"
+    "    case $f in\n"
+    "        *.c|*.h) count=$((count + 1)); echo \"source: $f\" ;;\n"
+    "        *) printf '%s\\n' 'other' >&2 ;;\n"
+    "    esac\n"
+    "done\n"
+    "build() { cc -o \"$1\" \"$1.c\" && echo ok || return 1; }\n"
+    "if [ -n \"$prefix\" ] && test $count -gt 0; then\n"
+    "    while read -r line; do echo \"${line#  }\"; done < input.txt | sort\n"
+    "fi\n"
+    "result=$(build main 2>&1) && echo \"$result\" > log.txt\n";
+
+static char *bench_script;
+static size_t bench_script_len;
+
+/* The snippet repeated to make a few kilobytes of input */
+static const char *bench_script_text(void)
+{
+    if (!bench_script)
+    {
+        const int copies = 16;
+        size_t snippet_len = strlen(bench_script_snippet);
+        bench_script_len = snippet_len * copies;
+        bench_script = malloc(bench_script_len + 1);
+        for (int i = 0; i < copies; i++)
+            memcpy(bench_script + (size_t)i * snippet_len, bench_script_snippet, snippet_len);
+        bench_script[bench_script_len] = '\0';
+    }
+    return bench_script;
+}
+
+static token_list_t *bench_lex(const char *input)
+{
+    lexer_t *lx = lexer_create();
+    lexer_append_input_cstr(lx, input);
+    token_list_t *tokens = token_list_create();
+    lex_status_t status = lexer_tokenize(lx, tokens, NULL);
+    lexer_destroy(&lx);
+    if (status != LEX_OK)
+        token_list_destroy(&tokens);
+    return tokens;
+}
+
+/* An executor whose top-level frame exists, for APIs that need a frame */
+static miga_exec_t *bench_executor;
+
+static miga_frame_t *bench_frame(void)
+{
+    if (!bench_executor)
+    {
+        bench_executor = exec_create();
+        exec_set_shell_name_cstr(bench_executor, "mgsh-bench");
+        exec_execute_command_string(bench_executor, "a=6 b=3");
+    }
+    return exec_get_current_frame(bench_executor);
+}
+
+/* Run a script on a fresh executor; returns its exit status */
+static int bench_run_script(const char *script)
+{
+    FILE *fp = tmpfile();
+    if (!fp)
+        return -1;
+    fputs(script, fp);
+    rewind(fp);
+
+    miga_exec_t *e = exec_create();
+    exec_set_shell_name_cstr(e, "mgsh-bench");
+    exec_execute_named_stream(e, fp, "bench");
+    int status = exec_get_last_exit_status(e);
+    exec_destroy(&e);
+    fclose(fp);
+    return status;
+}
+
+/* ============================================================================
+ * Microbenchmarks
+ * ============================================================================ */
+
+CTEST(lexer)
+{
+    const char *text = bench_script_text();
+    bench_set_bytes(ctest, bench_script_len);
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        token_list_t *tokens = bench_lex(text);
+        CTEST_ASSERT_NOT_NULL(ctest, tokens, "script lexes");
+        token_list_destroy(&tokens);
+    }
+}
+
+CTEST(lexer_tokenizer)
+{
+    const char *text = bench_script_text();
+    bench_set_bytes(ctest, bench_script_len);
+
+    alias_store_t *aliases = alias_store_create();
+    alias_store_add_cstr(aliases, "ll", "ls -l");
+    alias_store_add_cstr(aliases, "build", "make -j4");
+
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        token_list_t *raw = bench_lex(text);
+        tokenizer_t *tok = tokenizer_create(aliases);
+        token_list_t *out = token_list_create();
+        tok_status_t status = tokenizer_process(tok, raw, out);
+        CTEST_ASSERT_EQ(ctest, status, TOK_OK, "script tokenizes");
+        token_list_destroy(&out);
+        token_list_destroy(&raw);
+        tokenizer_destroy(&tok);
+    }
+    alias_store_destroy(&aliases);
+}
+
+CTEST(parse_lower)
+{
+    token_list_t *tokens = bench_lex(bench_script_text());
+    CTEST_ASSERT_NOT_NULL(ctest, tokens, "script lexes");
+    if (!tokens)
+        return;
+    bench_set_bytes(ctest, bench_script_len);
+
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        /* The parser consumes its tokens, so each pass gets a copy */
+        token_list_t *copy = token_list_clone(tokens);
+        parser_t *parser = parser_create_with_tokens_move(&copy);
+        gnode_t *gnode = NULL;
+        parse_status_t status = parser_parse_program(parser, &gnode);
+        CTEST_ASSERT_EQ(ctest, status, PARSE_OK, "script parses");
+        ast_node_t *ast = gnode ? ast_lower(gnode) : NULL;
+        CTEST_ASSERT_NOT_NULL(ctest, ast, "script lowers");
+        if (ast)
+            ast_node_destroy(&ast);
+        if (gnode)
+            g_node_destroy(&gnode);
+        parser_destroy(&parser);
+    }
+    token_list_destroy(&tokens);
+}
+
+#define BENCH_VARIABLES 1000
+
+CTEST(variable_store_insert)
+{
+    char name[32];
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        variable_store_t *vars = variable_store_create();
+        for (int v = 0; v < BENCH_VARIABLES; v++)
+        {
+            snprintf(name, sizeof(name), "var_%d", v);
+            variable_store_add_cstr(vars, name, "some value", false, false);
+        }
+        variable_store_destroy(&vars);
+    }
+}
+
+CTEST(variable_store_lookup)
+{
+    char name[32];
+    variable_store_t *vars = variable_store_create();
+    for (int v = 0; v < BENCH_VARIABLES; v++)
+    {
+        snprintf(name, sizeof(name), "var_%d", v);
+        variable_store_add_cstr(vars, name, "some value", false, false);
+    }
+
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        int found = 0;
+        for (int v = 0; v < BENCH_VARIABLES; v++)
+        {
+            snprintf(name, sizeof(name), "var_%d", v);
+            if (variable_store_get_value_cstr(vars, name))
+                found++;
+        }
+        CTEST_ASSERT_EQ(ctest, found, BENCH_VARIABLES, "every variable found");
+    }
+    variable_store_destroy(&vars);
+}
+
+#define BENCH_ALIASES 200
+
+/* Command-position words checked against a store of interactive-size
+ * aliases; most words are not aliases */
+CTEST(alias_lookup)
+{
+    static const char *const words[] = {"ls", "cd", "grep", "a7", "make", "a199", "echo", "x"};
+    char name[32];
+    alias_store_t *aliases = alias_store_create();
+    for (int a = 0; a < BENCH_ALIASES; a++)
+    {
+        snprintf(name, sizeof(name), "a%d", a);
+        alias_store_add_cstr(aliases, name, "command --option");
+    }
+
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        int found = 0;
+        for (size_t w = 0; w < sizeof(words) / sizeof(words[0]); w++)
+            found += alias_store_has_name_cstr(aliases, words[w]);
+        CTEST_ASSERT_EQ(ctest, found, 2, "two of the words are aliases");
+    }
+    alias_store_destroy(&aliases);
+}
+
+CTEST(string_ops)
+{
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        string_t *s = string_create();
+        for (int n = 0; n < 100; n++)
+        {
+            string_append_cstr(s, "path/component");
+            string_append_char(s, '/');
+        }
+        string_t *copy = string_create_from(s);
+        int pos = string_find_cstr(copy, "component/path/component/x");
+        CTEST_ASSERT_EQ(ctest, pos, -1, "absent substring not found");
+        string_t *sub = string_substring(copy, 100, 200);
+        string_append(s, sub);
+        string_destroy(&sub);
+        string_destroy(&copy);
+        string_destroy(&s);
+    }
+}
+
+/* A few kilobytes of path-like text with the needle only at the very end */
+static string_t *bench_search_text(void)
+{
+    string_t *text = string_create();
+    for (int n = 0; n < 256; n++)
+        string_append_cstr(text, "usr/local/lib:");
+    string_append_cstr(text, "opt/target=1;");
+    return text;
+}
+
+CTEST(string_find)
+{
+    string_t *text = bench_search_text();
+    bench_set_bytes(ctest, (size_t)string_length(text));
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        int pos = string_find_cstr(text, "opt/target");
+        CTEST_ASSERT_EQ(ctest, pos, string_length(text) - 13, "needle found at the end");
+        pos = string_rfind_cstr(text, "usr/local/lib");
+        CTEST_ASSERT_EQ(ctest, pos, string_length(text) - 27, "last repetition found");
+    }
+    string_destroy(&text);
+}
+
+CTEST(string_find_first_of)
+{
+    string_t *text = bench_search_text();
+    bench_set_bytes(ctest, (size_t)string_length(text));
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        int pos = string_find_first_of_cstr(text, "=;");
+        CTEST_ASSERT_EQ(ctest, pos, string_length(text) - 3, "first delimiter found");
+        pos = string_find_first_not_of_cstr(text, "abcdefghijklmnopqrstuvwxyz/:");
+        CTEST_ASSERT_EQ(ctest, pos, string_length(text) - 3, "first non-path byte found");
+    }
+    string_destroy(&text);
+}
+
+CTEST(glob_match)
+{
+    static const char *const patterns[] = {"*.c", "test_*_ctest.[ch]", "*[0-9]?.txt", "[!.]*"};
+    static const char *const names[] = {"exec_frame_expander.c", "test_lexer_ctest.c",
+                                        "report-2024-07.txt", ".hidden", "README.md"};
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        int matches = 0;
+        for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++)
+            for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++)
+                matches += glob_util_match(patterns[p], names[n], 0);
+        CTEST_ASSERT_EQ(ctest, matches, 8, "expected number of matches");
+    }
+}
+
+CTEST(arithmetic)
+{
+    miga_frame_t *frame = bench_frame();
+    /* Unspaced, and without parentheses, shifts or comparisons: the
+     * expansion pass in front of the evaluator still mis-lexes those */
+    string_t *expr = string_create_from_cstr("a*7%5+b*a/2-a%4+100/b-a");
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        ArithmeticResult r = arithmetic_evaluate(frame, expr);
+        CTEST_ASSERT_EQ(ctest, r.value, 36, "expression value");
+        arithmetic_result_free(&r);
+    }
+    string_destroy(&expr);
+}
+
+CTEST(field_split)
+{
+    miga_frame_t *frame = bench_frame();
+    string_t *text = string_create();
+    for (int w = 0; w < 1000; w++)
+        string_append_cstr(text, w % 10 == 0 ? "word\t\n " : "word ");
+    bench_set_bytes(ctest, (size_t)string_length(text));
+
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        strlist_t *fields = expand_field_split(frame, text);
+        CTEST_ASSERT_EQ(ctest, strlist_size(fields), 1000, "one field per word");
+        strlist_destroy(&fields);
+    }
+    string_destroy(&text);
+}
+
+/* One call of a one-command function, forwarding the caller's arguments;
+ * 1e9 / ns_per_op is calls per second */
+CTEST(function_call)
+{
+    miga_frame_t *frame = bench_frame();
+    exec_execute_command_string(bench_executor, "noop() { :; }");
+    string_t *name = string_create_from_cstr("noop");
+    strlist_t *args = strlist_create();
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, frame_call_function(frame, name, args), MIGA_EXEC_STATUS_OK,
+                        "function ran");
+    strlist_destroy(&args);
+    string_destroy(&name);
+}
+
+/* A short hook snippet, as an embedder would evaluate it over and over */
+static const char bench_hook_snippet[] =
+    "case $a in 6) r=$((a+b)) ;; *) r=0 ;; esac; [ \"$r\" = 9 ] && [ -n \"$b\" ]";
+
+/* The snippet lexed, parsed and lowered on every call */
+CTEST(hook_command_string)
+{
+    bench_frame();
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        miga_exec_result_t result = exec_execute_command_string(bench_executor, bench_hook_snippet);
+        CTEST_ASSERT_EQ(ctest, result.exit_code, 0, "snippet succeeded");
+    }
+}
+
+/* The snippet compiled once and run on every call */
+CTEST(hook_compiled_program)
+{
+    bench_frame();
+    miga_program_t *program = exec_compile_cstr(bench_executor, bench_hook_snippet);
+    CTEST_ASSERT_NOT_NULL(ctest, program, "snippet compiled");
+    for (long i = 0; program && i < bench_iterations(ctest); i++)
+    {
+        miga_exec_result_t result = exec_run_program(bench_executor, program);
+        CTEST_ASSERT_EQ(ctest, result.exit_code, 0, "snippet succeeded");
+    }
+    miga_program_free(&program);
+}
+
+/* Setup an embedder would repeat for each isolated evaluation */
+static const char bench_prelude[] =
+    "a=6 b=3 PATH=/usr/bin:/bin\n"
+    "add() { r=$(($1+$2)); }\n"
+    "max() { if [ \"$1\" -gt \"$2\" ]; then r=$1; else r=$2; fi; }\n"
+    "join() { local IFS=,; r=\"$*\"; }\n"
+    "alias ll='ls -l'\n"
+    "set -u\n";
+
+/* A new executor set up from scratch for each evaluation */
+CTEST(executor_fresh_setup)
+{
+    for (long i = 0; i < bench_iterations(ctest); i++)
+    {
+        miga_exec_t *executor = exec_create();
+        exec_set_shell_name_cstr(executor, "mgsh-bench");
+        miga_exec_result_t result = exec_execute_command_string(executor, bench_prelude);
+        CTEST_ASSERT_EQ(ctest, result.exit_code, 0, "prelude succeeded");
+        exec_destroy(&executor);
+    }
+}
+
+/* A new executor cloned from a snapshot of the set-up state */
+CTEST(executor_snapshot_clone)
+{
+    miga_exec_t *source = exec_create();
+    exec_set_shell_name_cstr(source, "mgsh-bench");
+    exec_execute_command_string(source, bench_prelude);
+    miga_snapshot_t *snapshot = exec_snapshot(source);
+    CTEST_ASSERT_NOT_NULL(ctest, snapshot, "snapshot taken");
+    exec_destroy(&source);
+
+    for (long i = 0; snapshot && i < bench_iterations(ctest); i++)
+    {
+        miga_exec_t *executor = exec_clone_from_snapshot(snapshot);
+        exec_destroy(&executor);
+    }
+    exec_snapshot_destroy(&snapshot);
+}
+
+/* ============================================================================
+ * End-to-end workloads
+ *
+ * Each iteration runs a whole script on a new executor.  Every script ends
+ * by checking its own result, so a broken shell fails the benchmark
+ * instead of producing a fast number.  Sizes are given for a full run;
+ * --quick divides them by bench_scale.
+ * ============================================================================ */
+
+static int bench_scale = 1;
+
+static int bench_size(int full)
+{
+    return full / bench_scale;
+}
+
+CTEST(script_while_loop)
+{
+    char script[256];
+    int n = bench_size(2000);
+    snprintf(script, sizeof(script),
+             "i=0\n"
+             "while [ $i -lt %d ]; do i=$((i + 1)); done\n"
+             "[ $i -eq %d ]\n",
+             n, n);
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(script), 0, "loop ran to completion");
+}
+
+CTEST(script_function_calls)
+{
+    char script[256];
+    int n = bench_size(1000);
+    snprintf(script, sizeof(script),
+             "nonneg() { [ \"$1\" -ge 0 ]; }\n"
+             "i=0 calls=0\n"
+             "while [ $i -lt %d ]; do nonneg $i && calls=$((calls + 1)); i=$((i + 1)); done\n"
+             "[ $calls -eq %d ]\n",
+             n, n);
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(script), 0, "every call made");
+}
+
+CTEST(script_command_substitution)
+{
+    char script[256];
+    int n = bench_size(100);
+    snprintf(script, sizeof(script),
+             "i=0 total=0\n"
+             "while [ $i -lt %d ]; do\n"
+             "    v=$(echo 3)\n"
+             "    total=$((total + v)); i=$((i + 1))\n"
+             "done\n"
+             "[ $total -eq %d ]\n",
+             n, 3 * n);
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(script), 0, "every substitution captured");
+}
+
+CTEST(script_recursive_functions)
+{
+    char script[512];
+    int n = bench_size(200);
+    snprintf(script, sizeof(script),
+             "depth() { local d=$1; if [ \"$d\" -gt 0 ]; then depth $((d - 1)); fi; }\n"
+             "pass() { each \"$@\"; }\n"
+             "each() { local w; for w in \"$@\"; do total=$((total + 1)); done; }\n"
+             "i=0 total=0 d=keep\n"
+             "while [ $i -lt %d ]; do depth 5; pass a b c; i=$((i + 1)); done\n"
+             "[ $total -eq %d ] && [ $d = keep ]\n",
+             n, 3 * n);
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(script), 0, "locals restored on return");
+}
+
+static char *heredoc_script;
+
+CTEST(script_large_heredoc)
+{
+    int lines = bench_size(5000);
+    if (!heredoc_script)
+    {
+        string_t *s = string_create_from_cstr("n=0\nwhile read -r line; do n=$((n + 1)); done <<EOF\n");
+        for (int l = 0; l < lines; l++)
+            string_append_cstr(s, "the quick brown fox jumps over the lazy dog\n");
+        char check[64];
+        snprintf(check, sizeof(check), "EOF\n[ $n -eq %d ]\n", lines);
+        string_append_cstr(s, check);
+        heredoc_script = strdup(string_cstr(s));
+        string_destroy(&s);
+    }
+    bench_set_bytes(ctest, strlen(heredoc_script));
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(heredoc_script), 0, "every line read");
+}
+
+static char *for_words_script;
+
+CTEST(script_for_words)
+{
+    int words = bench_size(100000);
+    if (!for_words_script)
+    {
+        string_t *s = string_create_from_cstr("words=\"");
+        for (int w = 0; w < words; w++)
+            string_append_cstr(s, w ? " w" : "w");
+        char loop[128];
+        snprintf(loop, sizeof(loop), "\"\nn=0\nfor w in $words; do n=$((n + 1)); done\n[ $n -eq %d ]\n",
+                 words);
+        string_append_cstr(s, loop);
+        for_words_script = strdup(string_cstr(s));
+        string_destroy(&s);
+    }
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(for_words_script), 0, "every word visited");
+}
+
+static char *shift_args_script;
+
+/* The usual argument loop: "$@" walked once, then consumed with shift.
+ * Shifting is O(1) per call; what still grows with the argument count is
+ * the allocator's sorted table of live blocks, which every allocation
+ * and free shifts. */
+CTEST(script_shift_args)
+{
+    int args = bench_size(10000);
+    if (!shift_args_script)
+    {
+        string_t *s = string_create_from_cstr("words=\"");
+        for (int w = 0; w < args; w++)
+            string_append_cstr(s, w ? " w" : "w");
+        char loop[256];
+        snprintf(loop, sizeof(loop),
+                 "\"\nset -- $words\nn=0\nfor a in \"$@\"; do n=$((n + 1)); done\n"
+                 "[ $n -eq %d ] || exit 1\n"
+                 "while [ \"$#\" -gt 0 ]; do shift; n=$((n - 1)); done\n[ $n -eq 0 ]\n",
+                 args);
+        string_append_cstr(s, loop);
+        shift_args_script = strdup(string_cstr(s));
+        string_destroy(&s);
+    }
+    for (long i = 0; i < bench_iterations(ctest); i++)
+        CTEST_ASSERT_EQ(ctest, bench_run_script(shift_args_script), 0, "every argument shifted");
+}
+
+/* ============================================================================
+ * Runner
+ * ============================================================================ */
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Time `entry` and fill in `result`.  The iteration count is doubled until
+ * one sample takes at least `min_sample_ns`; the median of up to
+ * BENCH_SAMPLES such samples is reported.  Samples stop early once ten
+ * times `min_sample_ns` has been spent, so very slow workloads run once. */
+static void bench_run_one(CTestEntry *entry, uint64_t min_sample_ns, bench_result_t *result)
+{
+    bench_state_t state = {.iterations = 1, .bytes_per_op = 0};
+    CTest ctest = {.current_test = entry->name, .user_data = &state};
+
+    uint64_t elapsed = 0;
+    for (;;)
+    {
+        uint64_t start = profiler_wall_clock_ns();
+        entry->func(&ctest);
+        elapsed = profiler_wall_clock_ns() - start;
+        if (ctest.tests_failed || elapsed >= min_sample_ns || state.iterations >= (1L << 30))
+            break;
+        state.iterations *= 2;
+    }
+
+    double samples[BENCH_SAMPLES];
+    samples[0] = (double)elapsed / (double)state.iterations;
+    uint64_t spent = elapsed;
+    int count = 1;
+    while (count < BENCH_SAMPLES && spent < 10 * min_sample_ns && !ctest.tests_failed)
+    {
+        uint64_t start = profiler_wall_clock_ns();
+        entry->func(&ctest);
+        elapsed = profiler_wall_clock_ns() - start;
+        samples[count++] = (double)elapsed / (double)state.iterations;
+        spent += elapsed;
+    }
+    qsort(samples, (size_t)count, sizeof(double), compare_double);
+
+    result->name = entry->name;
+    result->iterations = state.iterations;
+    result->ns_per_op = samples[count / 2];
+    result->mb_per_s = state.bytes_per_op && result->ns_per_op > 0
+                           ? (double)state.bytes_per_op / result->ns_per_op * 1e3
+                           : 0.0;
+    result->ok = ctest.tests_failed == 0;
+}
+
+static void bench_write_json(FILE *fp, const bench_result_t *results, int count)
+{
+    fprintf(fp, "{\n  \"version\": 1,\n  \"quick\": %s,\n  \"benchmarks\": [\n",
+            bench_scale > 1 ? "true" : "false");
+    for (int i = 0; i < count; i++)
+    {
+        const bench_result_t *r = &results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %ld, \"ns_per_op\": %.1f", r->name,
+                r->iterations, r->ns_per_op);
+        if (r->mb_per_s > 0)
+            fprintf(fp, ", \"mb_per_s\": %.2f", r->mb_per_s);
+        fprintf(fp, ", \"ok\": %s}%s\n", r->ok ? "true" : "false", i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+}
+
+/* Find the ns_per_op recorded for `name` in a JSON file written by
+ * bench_write_json().  Only that format is understood. */
+static bool bench_baseline_lookup(const char *json, const char *name, double *ns_per_op)
+{
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char *entry = strstr(json, key);
+    if (!entry)
+        return false;
+    const char *field = strstr(entry, "\"ns_per_op\":");
+    const char *end = strchr(entry, '}');
+    if (!field || (end && field > end))
+        return false;
+    *ns_per_op = strtod(field + strlen("\"ns_per_op\":"), NULL);
+    return *ns_per_op > 0;
+}
+
+static char *read_file(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+    string_t *s = string_create();
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        string_append_data(s, buf, (int)n);
+    fclose(fp);
+    char *text = strdup(string_cstr(s));
+    string_destroy(&s);
+    return text;
+}
+
+static void usage(FILE *fp)
+{
+    fprintf(fp, "usage: mgsh-bench [--quick] [--filter SUBSTR] [--json FILE]\n"
+                "                  [--baseline FILE] [--threshold PCT] [--list]\n");
+}
+
+int main(int argc, char **argv)
+{
+    log_set_level(LOG_LEVEL_ERROR);
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(lexer),
+        CTEST_ENTRY(lexer_tokenizer),
+        CTEST_ENTRY(parse_lower),
+        CTEST_ENTRY(variable_store_insert),
+        CTEST_ENTRY(variable_store_lookup),
+        CTEST_ENTRY(alias_lookup),
+        CTEST_ENTRY(string_ops),
+        CTEST_ENTRY(string_find),
+        CTEST_ENTRY(string_find_first_of),
+        CTEST_ENTRY(glob_match),
+        CTEST_ENTRY(arithmetic),
+        CTEST_ENTRY(field_split),
+        CTEST_ENTRY(function_call),
+        CTEST_ENTRY(hook_command_string),
+        CTEST_ENTRY(hook_compiled_program),
+        CTEST_ENTRY(executor_fresh_setup),
+        CTEST_ENTRY(executor_snapshot_clone),
+        CTEST_ENTRY(script_while_loop),
+        CTEST_ENTRY(script_function_calls),
+        CTEST_ENTRY(script_recursive_functions),
+        CTEST_ENTRY(script_command_substitution),
+        CTEST_ENTRY(script_large_heredoc),
+        CTEST_ENTRY(script_for_words),
+        CTEST_ENTRY(script_shift_args),
+        NULL
+    };
+
+    const char *filter = NULL;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    double threshold = 10.0;
+    uint64_t min_sample_ns = 100000000; /* 100 ms */
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--quick") == 0)
+        {
+            min_sample_ns = 10000000;
+            bench_scale = 10;
+        }
+        else if (strcmp(arg, "--list") == 0)
+        {
+            for (CTestEntry **p = suite; *p; ++p)
+                printf("%s\n", (*p)->name);
+            return 0;
+        }
+        else if (strcmp(arg, "--filter") == 0 && value)
+            filter = argv[++i];
+        else if (strcmp(arg, "--json") == 0 && value)
+            json_path = argv[++i];
+        else if (strcmp(arg, "--baseline") == 0 && value)
+            baseline_path = argv[++i];
+        else if (strcmp(arg, "--threshold") == 0 && value)
+            threshold = strtod(argv[++i], NULL);
+        else if (strcmp(arg, "--help") == 0)
+        {
+            usage(stdout);
+            return 0;
+        }
+        else
+        {
+            usage(stderr);
+            return 2;
+        }
+    }
+
+    char *baseline = NULL;
+    if (baseline_path && !(baseline = read_file(baseline_path)))
+    {
+        fprintf(stderr, "mgsh-bench: cannot read baseline '%s'\n", baseline_path);
+        return 2;
+    }
+    if (baseline && (strstr(baseline, "\"quick\": true") != NULL) != (bench_scale > 1))
+        fprintf(stderr, "mgsh-bench: warning: baseline was recorded %s --quick\n",
+                bench_scale > 1 ? "without" : "with");
+
+    bench_result_t results[BENCH_MAX_RESULTS];
+    int count = 0;
+    int failures = 0;
+    int regressions = 0;
+
+    fprintf(stderr, "%-28s %12s %14s %10s %s\n", "benchmark", "iterations", "ns/op", "MB/s",
+            baseline ? "vs baseline" : "");
+    for (CTestEntry **p = suite; *p && count < BENCH_MAX_RESULTS; ++p)
+    {
+        if (filter && !strstr((*p)->name, filter))
+            continue;
+
+        bench_result_t *r = &results[count++];
+        bench_run_one(*p, min_sample_ns, r);
+        if (!r->ok)
+            failures++;
+
+        fprintf(stderr, "%-28s %12ld %14.1f ", r->name, r->iterations, r->ns_per_op);
+        if (r->mb_per_s > 0)
+            fprintf(stderr, "%10.2f ", r->mb_per_s);
+        else
+            fprintf(stderr, "%10s ", "-");
+
+        double base;
+        if (!r->ok)
+            fprintf(stderr, "FAILED");
+        else if (baseline && bench_baseline_lookup(baseline, r->name, &base))
+        {
+            double change = (r->ns_per_op - base) / base * 100.0;
+            bool regressed = change > threshold;
+            regressions += regressed;
+            fprintf(stderr, "%+7.1f%%%s", change, regressed ? "  REGRESSION" : "");
+        }
+        else if (baseline)
+            fprintf(stderr, "    (new)");
+        fprintf(stderr, "\n");
+    }
+
+    if (json_path)
+    {
+        FILE *fp = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+        if (!fp)
+        {
+            fprintf(stderr, "mgsh-bench: cannot write '%s'\n", json_path);
+            failures++;
+        }
+        else
+        {
+            bench_write_json(fp, results, count);
+            if (fp != stdout)
+                fclose(fp);
+        }
+    }
+
+    if (regressions)
+        fprintf(stderr, "%d benchmark(s) regressed by more than %.1f%%\n", regressions, threshold);
+
+    free(baseline);
+    free(bench_script);
+    free(heredoc_script);
+    free(for_words_script);
+    free(shift_args_script);
+    if (bench_executor)
+        exec_destroy(&bench_executor);
+
+    return failures || regressions ? 1 : 0;
+}
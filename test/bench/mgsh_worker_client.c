@@ -0,0 +1,219 @@
+/**
+ * @file mgsh_worker_client.c
+ * @brief Stand-in batch client: jobs per second with mgsh --worker vs mgsh -c
+ *
+ * Runs the same small script many times, first by starting `mgsh -c SCRIPT`
+ * for every job, as a CI system would, then by sending every job to one
+ * `mgsh --worker` process (see src/shell_worker.h for the protocol).  Each
+ * job's exit status and output are checked, and the throughput of both ways
+ * is printed on stderr.
+ *
+ * Usage:
+ *   mgsh-worker-client [--jobs N] MGSH
+ *
+ * MGSH is the path of the shell to test.  The exit status is 1 if any job
+ * did not give the expected result.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_JOBS 200
+
+/* A job that does a little of everything without touching the file system */
+static const char job_script[] = "f() { echo \"$1:$((6*7))\"; }; f \"$FOO\"";
+static const char job_output[] = "bar:42\n";
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ============================================================================
+ * One process per job: mgsh -c
+ * ============================================================================ */
+
+static bool run_command_string_job(const char *mgsh)
+{
+    int out[2];
+    if (pipe(out) < 0)
+        return false;
+
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        close(out[1]);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0)
+            dup2(null_fd, STDERR_FILENO);
+        setenv("FOO", "bar", 1);
+        execl(mgsh, mgsh, "-c", job_script, (char *)NULL);
+        _exit(127);
+    }
+
+    close(out[1]);
+    char buf[4096];
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(out[0], buf + len, sizeof(buf) - 1 - len)) > 0)
+        len += (size_t)n;
+    close(out[0]);
+    buf[len] = '\0';
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && strstr(buf, job_output);
+}
+
+/* ============================================================================
+ * One worker for all jobs: mgsh --worker
+ * ============================================================================ */
+
+typedef struct worker_t
+{
+    pid_t pid;
+    FILE *to;
+    FILE *from;
+} worker_t;
+
+static bool worker_start(worker_t *w, const char *mgsh)
+{
+    int to[2];
+    int from[2];
+    if (pipe(to) < 0 || pipe(from) < 0)
+        return false;
+
+    w->pid = fork();
+    if (w->pid < 0)
+        return false;
+    if (w->pid == 0)
+    {
+        dup2(to[0], STDIN_FILENO);
+        dup2(from[1], STDOUT_FILENO);
+        close(to[0]);
+        close(to[1]);
+        close(from[0]);
+        close(from[1]);
+        execl(mgsh, mgsh, "--worker", (char *)NULL);
+        _exit(127);
+    }
+
+    close(to[0]);
+    close(from[1]);
+    w->to = fdopen(to[1], "w");
+    w->from = fdopen(from[0], "r");
+    return w->to && w->from;
+}
+
+static bool worker_run_job(worker_t *w)
+{
+    static const char fields[] = "c:%s%ce:FOO=bar%c%c";
+    fprintf(w->to, fields, job_script, '\0', '\0', '\0');
+    fflush(w->to);
+
+    int status;
+    size_t out_len;
+    size_t err_len;
+    if (fscanf(w->from, "%d %zu %zu", &status, &out_len, &err_len) != 3 || fgetc(w->from) != '\n')
+        return false;
+
+    bool ok = status == 0 && out_len == strlen(job_output);
+    char buf[4096];
+    for (size_t left = out_len + err_len; left > 0;)
+    {
+        size_t chunk = left < sizeof(buf) ? left : sizeof(buf);
+        size_t got = fread(buf, 1, chunk, w->from);
+        if (got == 0)
+            return false;
+        if (ok && left == out_len + err_len && memcmp(buf, job_output, out_len) != 0)
+            ok = false;
+        left -= got;
+    }
+    return ok;
+}
+
+static bool worker_stop(worker_t *w)
+{
+    fclose(w->to);
+    fclose(w->from);
+    int status;
+    while (waitpid(w->pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================ */
+
+int main(int argc, char **argv)
+{
+    long jobs = DEFAULT_JOBS;
+    const char *mgsh = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobs = strtol(argv[++i], NULL, 10);
+        else if (!mgsh && argv[i][0] != '-')
+            mgsh = argv[i];
+        else
+        {
+            mgsh = NULL;
+            break;
+        }
+    }
+    if (!mgsh || jobs <= 0)
+    {
+        fprintf(stderr, "usage: %s [--jobs N] MGSH\n", argv[0]);
+        return 2;
+    }
+
+    int failures = 0;
+
+    uint64_t start = now_ns();
+    for (long i = 0; i < jobs; i++)
+        failures += !run_command_string_job(mgsh);
+    double command_string_secs = (double)(now_ns() - start) / 1e9;
+
+    worker_t w;
+    start = now_ns();
+    if (!worker_start(&w, mgsh))
+    {
+        fprintf(stderr, "%s: cannot start %s --worker\n", argv[0], mgsh);
+        return 1;
+    }
+    for (long i = 0; i < jobs; i++)
+        failures += !worker_run_job(&w);
+    failures += !worker_stop(&w);
+    double worker_secs = (double)(now_ns() - start) / 1e9;
+
+    double command_string_rate = (double)jobs / command_string_secs;
+    double worker_rate = (double)jobs / worker_secs;
+    fprintf(stderr, "%-16s %10s %12s\n", "mode", "jobs", "jobs/sec");
+    fprintf(stderr, "%-16s %10ld %12.1f\n", "mgsh -c", jobs, command_string_rate);
+    fprintf(stderr, "%-16s %10ld %12.1f\n", "mgsh --worker", jobs, worker_rate);
+    fprintf(stderr, "speedup: %.2fx\n", worker_rate / command_string_rate);
+    if (failures)
+        fprintf(stderr, "%d job(s) gave the wrong result\n", failures);
+
+    return failures ? 1 : 0;
+}
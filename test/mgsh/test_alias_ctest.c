@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <string.h>
 #include "ctest.h"
 #include "alias_store.h"
@@ -328,6 +329,82 @@ CTEST(test_alias_store_multiple_entries)
     alias_store_destroy(&store);
 }
 
+// ------------------------------------------------------------
+// Index and ordering
+// ------------------------------------------------------------
+
+static void append_name(const string_t *name, const string_t *value, void *user_data)
+{
+    (void)value;
+    string_t *out = user_data;
+    string_append(out, name);
+    string_append_cstr(out, " ");
+}
+
+CTEST(test_alias_store_many_entries)
+{
+    alias_store_t *store = alias_store_create();
+    char name[32];
+    char value[32];
+
+    for (int i = 0; i < 500; i++)
+    {
+        snprintf(name, sizeof(name), "a%d", i);
+        snprintf(value, sizeof(value), "v%d", i);
+        alias_store_add_cstr(store, name, value);
+    }
+    CTEST_ASSERT_EQ(ctest, alias_store_size(store), 500, "size is 500");
+
+    int found = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        snprintf(name, sizeof(name), "a%d", i);
+        snprintf(value, sizeof(value), "v%d", i);
+        const char *got = alias_store_get_value_cstr(store, name);
+        if (got && strcmp(got, value) == 0)
+            found++;
+    }
+    CTEST_ASSERT_EQ(ctest, found, 500, "every alias found after growth");
+    CTEST_ASSERT_FALSE(ctest, alias_store_has_name_cstr(store, "a500"), "same first char, absent");
+    CTEST_ASSERT_FALSE(ctest, alias_store_has_name_cstr(store, "ls"), "other first char, absent");
+
+    for (int i = 0; i < 500; i += 2)
+    {
+        snprintf(name, sizeof(name), "a%d", i);
+        alias_store_remove_cstr(store, name);
+    }
+    CTEST_ASSERT_EQ(ctest, alias_store_size(store), 250, "half removed");
+    CTEST_ASSERT_FALSE(ctest, alias_store_has_name_cstr(store, "a10"), "removed alias gone");
+    CTEST_ASSERT_STR_EQ(ctest, alias_store_get_value_cstr(store, "a11"), "v11",
+                        "remaining alias found after removal");
+
+    alias_store_destroy(&store);
+}
+
+CTEST(test_alias_store_foreach_keeps_definition_order)
+{
+    alias_store_t *store = alias_store_create();
+    alias_store_add_cstr(store, "zz", "1");
+    alias_store_add_cstr(store, "ll", "2");
+    alias_store_add_cstr(store, "aa", "3");
+    alias_store_add_cstr(store, "mm", "4");
+    alias_store_add_cstr(store, "ll", "5");
+    alias_store_remove_cstr(store, "aa");
+
+    string_t *names = string_create();
+    alias_store_foreach(store, append_name, names);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(names), "zz ll mm ", "definition order kept");
+    CTEST_ASSERT_STR_EQ(ctest, alias_store_get_value_cstr(store, "ll"), "5", "replaced in place");
+
+    alias_store_clear(store);
+    CTEST_ASSERT_FALSE(ctest, alias_store_has_name_cstr(store, "zz"), "cleared");
+    alias_store_add_cstr(store, "zz", "6");
+    CTEST_ASSERT_STR_EQ(ctest, alias_store_get_value_cstr(store, "zz"), "6", "usable after clear");
+
+    string_destroy(&names);
+    alias_store_destroy(&store);
+}
+
 // ------------------------------------------------------------
 // Test suite entry
 // ------------------------------------------------------------
@@ -355,6 +432,8 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_alias_store_clone_is_independent),
         CTEST_ENTRY(test_alias_store_get_nonexistent),
         CTEST_ENTRY(test_alias_store_multiple_entries),
+        CTEST_ENTRY(test_alias_store_many_entries),
+        CTEST_ENTRY(test_alias_store_foreach_keeps_definition_order),
         NULL
     };
 
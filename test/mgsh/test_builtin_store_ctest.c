@@ -0,0 +1,145 @@
+// ============================================================================
+// test_builtin_store_ctest.c
+// Unit tests for the builtin store and command classification
+// ============================================================================
+
+#include "builtin_store.h"
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "xalloc.h"
+
+static int builtin_five(miga_frame_t *frame, const strlist_t *args)
+{
+    (void)frame;
+    (void)args;
+    return 5;
+}
+
+static builtin_store_t *create_default_store(void)
+{
+    builtin_store_t *store = builtin_store_create();
+    builtins_init_default(store);
+    return store;
+}
+
+CTEST(test_builtin_store_classify_standard)
+{
+    builtin_store_t *store = create_default_store();
+    miga_builtin_fn_t fn;
+
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "while", &fn),
+                    COMMAND_CLASS_RESERVED_WORD, "while is a reserved word");
+    CTEST_ASSERT_NULL(ctest, fn, "reserved words have no function");
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "export", &fn),
+                    COMMAND_CLASS_SPECIAL_BUILTIN, "export is special");
+    CTEST_ASSERT_NOT_NULL(ctest, fn, "export has a function");
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "echo", &fn),
+                    COMMAND_CLASS_REGULAR_BUILTIN, "echo is regular");
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "no_such_command", &fn),
+                    COMMAND_CLASS_EXTERNAL, "unknown names are external");
+    CTEST_ASSERT_NULL(ctest, fn, "external commands have no function");
+
+    CTEST_ASSERT_TRUE(ctest, builtin_store_has(store, "test"), "test is registered");
+    CTEST_ASSERT_FALSE(ctest, builtin_store_has(store, "if"), "if is not a builtin");
+    builtin_store_destroy(&store);
+}
+
+CTEST(test_builtin_store_override_and_remove)
+{
+    builtin_store_t *store = create_default_store();
+    size_t count = builtin_store_count(store);
+    uint32_t generation = store->generation;
+    miga_builtin_fn_t fn;
+
+    builtin_store_set(store, "echo", builtin_five, MIGA_BUILTIN_CATEGORY_SPECIAL);
+    CTEST_ASSERT_NE(ctest, store->generation, generation, "set changes the generation");
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "echo", &fn),
+                    COMMAND_CLASS_SPECIAL_BUILTIN, "override replaces the category");
+    CTEST_ASSERT_TRUE(ctest, fn == builtin_five, "override replaces the function");
+    CTEST_ASSERT_EQ(ctest, builtin_store_count(store), count, "override adds no name");
+
+    CTEST_ASSERT_TRUE(ctest, builtin_store_remove(store, "echo"), "remove an overridden builtin");
+    CTEST_ASSERT_FALSE(ctest, builtin_store_has(store, "echo"), "echo is gone");
+    CTEST_ASSERT_FALSE(ctest, builtin_store_remove(store, "echo"), "remove it only once");
+    CTEST_ASSERT_TRUE(ctest, builtin_store_remove(store, "printf"), "remove a standard builtin");
+    CTEST_ASSERT_EQ(ctest, builtin_store_classify(store, "printf", &fn), COMMAND_CLASS_EXTERNAL,
+                    "a removed builtin is external");
+    CTEST_ASSERT_EQ(ctest, builtin_store_count(store), count - 2, "two names removed");
+
+    builtin_store_set(store, "printf", builtin_five, MIGA_BUILTIN_CATEGORY_REGULAR);
+    CTEST_ASSERT_TRUE(ctest, builtin_store_get(store, "printf") == builtin_five,
+                      "a removed builtin can be registered again");
+
+    builtin_store_t *clone = builtin_store_clone(store);
+    CTEST_ASSERT_FALSE(ctest, builtin_store_has(clone, "echo"), "clone keeps removals");
+    CTEST_ASSERT_TRUE(ctest, builtin_store_has(clone, "cd") == builtin_store_has(store, "cd"),
+                      "clone keeps the standard builtins");
+    CTEST_ASSERT_NE(ctest, clone->generation, store->generation,
+                   "clone has its own generation");
+
+    builtin_store_clear(store);
+    CTEST_ASSERT_EQ(ctest, builtin_store_count(store), 0, "clear removes the standard builtins");
+    builtin_store_destroy(&clone);
+    builtin_store_destroy(&store);
+}
+
+// The class of a literal command name is cached on its AST node; running the
+// same program again must see builtins and functions defined in between.
+CTEST(test_builtin_store_cached_class_follows_changes)
+{
+    miga_exec_t *executor = exec_create();
+    exec_set_shell_name_cstr(executor, "test_builtin_store");
+    miga_program_t *program = exec_compile_cstr(executor, "true");
+    CTEST_ASSERT_NOT_NULL(ctest, program, "program compiled");
+
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 0, "standard true");
+
+    exec_execute_command_string(executor, "true() { return 3; }");
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 3, "function beats regular builtin");
+
+    exec_execute_command_string(executor, "unset -f true");
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 0, "builtin again after unset -f");
+
+    exec_register_builtin_cstr(executor, "true", builtin_five, MIGA_BUILTIN_CATEGORY_REGULAR);
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 5, "registered builtin replaces it");
+
+    miga_program_free(&program);
+    program = exec_compile_cstr(executor, "miga_five");
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 127, "not yet a builtin");
+    exec_register_builtin_cstr(executor, "miga_five", builtin_five, MIGA_BUILTIN_CATEGORY_REGULAR);
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 5, "new builtin is found");
+    exec_unregister_builtin_cstr(executor, "miga_five");
+    exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, exec_get_exit_status(executor), 127, "unregistered builtin is gone");
+
+    miga_program_free(&program);
+    exec_destroy(&executor);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_builtin_store_classify_standard),
+        CTEST_ENTRY(test_builtin_store_override_and_remove),
+        CTEST_ENTRY(test_builtin_store_cached_class_follows_changes),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file test_completion_index_ctest.c
+ * @brief Unit tests for the command-name completion index (completion_index.c)
+ */
+
+#include "builtin_store.h"
+#include "completion_index.h"
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+#include "xalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef MIGA_POSIX_API
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* The names in `list`, joined with spaces */
+static string_t *joined(strlist_t **list)
+{
+    return strlist_join_move(list, " ");
+}
+
+#define ASSERT_NAMES(index, prefix, expected)                                                      \
+    do                                                                                             \
+    {                                                                                              \
+        strlist_t *found = completion_index_find((index), (prefix));                               \
+        string_t *got = joined(&found);                                                            \
+        CTEST_ASSERT_STR_EQ(ctest, string_cstr(got), (expected), "names under " prefix);           \
+        string_destroy(&got);                                                                      \
+    } while (0)
+
+CTEST(test_completion_index_shell_names)
+{
+    completion_index_t *index = completion_index_create();
+    builtin_store_t *builtins = builtin_store_create();
+    builtins_init_default(builtins);
+    func_store_t *functions = func_store_create();
+    alias_store_t *aliases = alias_store_create();
+
+    alias_store_add_cstr(aliases, "ll", "ls -l");
+    completion_index_update(index, NULL, builtins, functions, aliases);
+    ASSERT_NAMES(index, "ex", "exec exit export");
+    ASSERT_NAMES(index, "l", "ll local");
+    ASSERT_NAMES(index, "zz", "");
+
+    /* A name held by two sources is listed once, and stays while one does */
+    alias_store_add_cstr(aliases, "exit", "exit 0");
+    completion_index_update(index, NULL, builtins, functions, aliases);
+    ASSERT_NAMES(index, "exi", "exit");
+    alias_store_remove_cstr(aliases, "exit");
+    builtin_store_remove(builtins, "local");
+    completion_index_update(index, NULL, builtins, functions, aliases);
+    ASSERT_NAMES(index, "exi", "exit");
+    ASSERT_NAMES(index, "l", "ll");
+
+    int size = completion_index_size(index);
+    builtin_store_clear(builtins);
+    alias_store_clear(aliases);
+    completion_index_update(index, NULL, builtins, functions, aliases);
+    CTEST_ASSERT_TRUE(ctest, size > 30, "standard builtins were indexed");
+    CTEST_ASSERT_EQ(ctest, completion_index_size(index), 0, "no names left");
+    ASSERT_NAMES(index, "", "");
+
+    alias_store_destroy(&aliases);
+    func_store_destroy(&functions);
+    builtin_store_destroy(&builtins);
+    completion_index_destroy(&index);
+    CTEST_ASSERT_NULL(ctest, index, "index pointer null after destroy");
+}
+
+#ifdef MIGA_POSIX_API
+
+static void make_file(const char *dir, const char *name, mode_t mode)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *fp = fopen(path, "w");
+    if (fp)
+        fclose(fp);
+    chmod(path, mode);
+}
+
+static void remove_file(const char *dir, const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    unlink(path);
+}
+
+/* Make sure a directory's modification time moves on after a change */
+static void touch_dir_later(const char *dir)
+{
+    struct stat st;
+    stat(dir, &st);
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    times[1].tv_sec += 1;
+    utimensat(AT_FDCWD, dir, times, 0);
+}
+
+CTEST(test_completion_index_path)
+{
+    char dir1[] = "/tmp/completion_a_XXXXXX";
+    char dir2[] = "/tmp/completion_b_XXXXXX";
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir1), "made first directory");
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir2), "made second directory");
+    make_file(dir1, "zfoo", 0755);
+    make_file(dir1, "zfoobar", 0755);
+    make_file(dir1, "zfnot_executable", 0644);
+    make_file(dir2, "zfoo", 0755);
+    make_file(dir2, "zfa", 0700);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s:relative/dir::%s:%s", dir1, dir2, dir1);
+    completion_index_t *index = completion_index_create();
+    completion_index_update(index, path, NULL, NULL, NULL);
+    ASSERT_NAMES(index, "zf", "zfa zfoo zfoobar");
+    CTEST_ASSERT_EQ(ctest, completion_index_dir_scans(index), 2, "each directory read once");
+
+    /* Unchanged directories are not read again */
+    completion_index_update(index, path, NULL, NULL, NULL);
+    CTEST_ASSERT_EQ(ctest, completion_index_dir_scans(index), 2, "nothing read again");
+
+    /* A changed directory is */
+    make_file(dir2, "zfoobaz", 0755);
+    remove_file(dir2, "zfa");
+    touch_dir_later(dir2);
+    completion_index_update(index, path, NULL, NULL, NULL);
+    CTEST_ASSERT_EQ(ctest, completion_index_dir_scans(index), 3, "changed directory read");
+    ASSERT_NAMES(index, "zfoob", "zfoobar zfoobaz");
+
+    /* A directory that leaves PATH takes its names along */
+    completion_index_update(index, dir1, NULL, NULL, NULL);
+    ASSERT_NAMES(index, "zf", "zfoo zfoobar");
+
+    completion_index_destroy(&index);
+
+    remove_file(dir1, "zfoo");
+    remove_file(dir1, "zfoobar");
+    remove_file(dir1, "zfnot_executable");
+    remove_file(dir2, "zfoo");
+    remove_file(dir2, "zfoobaz");
+    rmdir(dir1);
+    rmdir(dir2);
+}
+
+CTEST(test_completion_exec_complete_prefix)
+{
+    char dir[] = "/tmp/completion_c_XXXXXX";
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir), "made directory");
+    make_file(dir, "miga_test_tool", 0755);
+
+    miga_exec_t *executor = exec_create();
+    exec_set_shell_name_cstr(executor, "test_completion");
+    char script[256];
+    snprintf(script, sizeof(script),
+             "PATH=%s; miga_test_func() { :; }; alias miga_test_alias=true", dir);
+    exec_execute_command_string(executor, script);
+
+    strlist_t *found = exec_complete_prefix(executor, "miga_t");
+    string_t *got = joined(&found);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(got),
+                        "miga_test_alias miga_test_func miga_test_tool miga_trace",
+                        "all sources, sorted");
+    string_destroy(&got);
+
+    exec_execute_command_string(executor, "unset -f miga_test_func");
+    found = exec_complete_prefix(executor, "miga_test_f");
+    CTEST_ASSERT_EQ(ctest, strlist_size(found), 0, "removed function is gone");
+    strlist_destroy(&found);
+
+    exec_destroy(&executor);
+    remove_file(dir, "miga_test_tool");
+    rmdir(dir);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_completion_index_shell_names),
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_completion_index_path),
+        CTEST_ENTRY(test_completion_exec_complete_prefix),
+#endif
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
@@ -0,0 +1,204 @@
+// ============================================================================
+// test_exec_async_ctest.c
+// Unit tests for resumable execution: exec_start(), exec_poll(), exec_resume()
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+#include "profiler.h"
+#include "test_exec_helpers.h"
+#include "xalloc.h"
+
+#ifdef MIGA_POSIX_API
+#include <poll.h>
+extern char **environ;
+#endif
+
+#define SCRIPT_COUNT 3
+
+// The scripts run sleep and tr, so they need PATH
+static miga_exec_t *create_executor_with_path(void)
+{
+    miga_exec_t *executor = create_executor();
+#ifdef MIGA_POSIX_API
+    exec_set_envp_cstr(executor, environ);
+#endif
+    return executor;
+}
+
+// Drive a started script to completion the way an event loop would.
+// Returns the final result; *suspensions counts the pending results seen.
+static miga_exec_result_t run_to_completion(miga_exec_t *executor, miga_exec_result_t result,
+                                            int *suspensions)
+{
+    while (result.status == MIGA_EXEC_STATUS_PENDING)
+    {
+        if (suspensions)
+            (*suspensions)++;
+#ifdef MIGA_POSIX_API
+        int fd = -1;
+        short events = 0;
+        if (exec_poll(executor, &fd, &events) && fd >= 0)
+        {
+            struct pollfd p = {.fd = fd, .events = events};
+            poll(&p, 1, -1);
+        }
+#endif
+        result = exec_resume(executor);
+    }
+    return result;
+}
+
+CTEST(test_exec_async_no_waiting)
+{
+    miga_exec_t *executor = create_executor_with_path();
+    miga_exec_result_t result = exec_start(executor, "a=1; b=$((a+1))");
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "finished at once");
+    CTEST_ASSERT_FALSE(ctest, exec_poll(executor, NULL, NULL), "nothing pending");
+    ASSERT_VARIABLE(executor, "b", "2");
+
+    result = exec_resume(executor);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_ERROR, "nothing to resume");
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_async_external_command)
+{
+    miga_exec_t *executor = create_executor_with_path();
+    int suspensions = 0;
+    miga_exec_result_t result =
+        run_to_completion(executor, exec_start(executor, "sleep 0.1; (exit 3)"), &suspensions);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "script ran");
+    CTEST_ASSERT_EQ(ctest, result.exit_code, 3, "exit status of the last command");
+#ifdef MIGA_POSIX_API
+    CTEST_ASSERT_TRUE(ctest, suspensions > 0, "script was suspended");
+#endif
+    CTEST_ASSERT_FALSE(ctest, exec_poll(executor, NULL, NULL), "nothing pending");
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_async_command_substitution)
+{
+    miga_exec_t *executor = create_executor_with_path();
+    miga_exec_result_t result = run_to_completion(
+        executor, exec_start(executor, "x=$(echo one; sleep 0.1; echo two | tr a-z A-Z)"), NULL);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "script ran");
+    ASSERT_VARIABLE(executor, "x", "one\nTWO");
+
+    // The executor can be used normally, and started again, afterwards
+    exec_execute_command_string(executor, "y=$x");
+    ASSERT_VARIABLE(executor, "y", "one\nTWO");
+    result = run_to_completion(executor, exec_start(executor, "z=$(echo again)"), NULL);
+    ASSERT_VARIABLE(executor, "z", "again");
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_async_start_while_pending)
+{
+    miga_exec_t *executor = create_executor_with_path();
+    miga_exec_result_t first = exec_start(executor, "sleep 0.1; r=first");
+    if (first.status == MIGA_EXEC_STATUS_PENDING)
+    {
+        miga_exec_result_t second = exec_start(executor, "r=second");
+        CTEST_ASSERT_EQ(ctest, second.status, MIGA_EXEC_STATUS_ERROR, "second start refused");
+        second = exec_execute_command_string(executor, "r=second");
+        CTEST_ASSERT_EQ(ctest, second.status, MIGA_EXEC_STATUS_ERROR, "blocking run refused");
+    }
+    run_to_completion(executor, first, NULL);
+    ASSERT_VARIABLE(executor, "r", "first");
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_async_wait_for_jobs)
+{
+    miga_exec_t *executor = create_executor_with_path();
+    int suspensions = 0;
+    miga_exec_result_t result = run_to_completion(
+        executor, exec_start(executor, "sleep 0.1 & sleep 0.2 & wait -n; wait; w=done"),
+        &suspensions);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "finished");
+    ASSERT_VARIABLE(executor, "w", "done");
+#ifdef __linux__
+    CTEST_ASSERT_TRUE(ctest, suspensions >= 2, "both waits suspended");
+#endif
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_async_interleaved)
+{
+    miga_exec_t *executors[SCRIPT_COUNT];
+    miga_exec_result_t results[SCRIPT_COUNT];
+    uint64_t start = profiler_wall_clock_ns();
+
+    for (int i = 0; i < SCRIPT_COUNT; i++)
+    {
+        executors[i] = create_executor_with_path();
+        results[i] = exec_start(executors[i], "f() { sleep 0.3; echo ready; }; r=$(f)");
+    }
+
+    // One loop drives every script, resuming whichever is ready
+    for (int pending = SCRIPT_COUNT; pending > 0;)
+    {
+        pending = 0;
+        for (int i = 0; i < SCRIPT_COUNT; i++)
+        {
+            if (results[i].status != MIGA_EXEC_STATUS_PENDING)
+                continue;
+#ifdef MIGA_POSIX_API
+            int fd = -1;
+            short events = 0;
+            exec_poll(executors[i], &fd, &events);
+            struct pollfd p = {.fd = fd, .events = events};
+            if (fd >= 0 && poll(&p, 1, 10) == 0)
+            {
+                pending++;
+                continue;
+            }
+#endif
+            results[i] = exec_resume(executors[i]);
+            if (results[i].status == MIGA_EXEC_STATUS_PENDING)
+                pending++;
+        }
+    }
+    uint64_t elapsed = profiler_wall_clock_ns() - start;
+
+    for (int i = 0; i < SCRIPT_COUNT; i++)
+    {
+        CTEST_ASSERT_EQ(ctest, results[i].status, MIGA_EXEC_STATUS_OK, "script ran");
+        ASSERT_VARIABLE(executors[i], "r", "ready");
+        exec_destroy(&executors[i]);
+    }
+#ifdef MIGA_POSIX_API
+    // Run one after another they would take at least 0.9 s
+    CTEST_ASSERT_TRUE(ctest, elapsed < 800000000ull, "scripts waited at the same time");
+#else
+    (void)elapsed;
+#endif
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_exec_async_no_waiting),
+        CTEST_ENTRY(test_exec_async_external_command),
+        CTEST_ENTRY(test_exec_async_command_substitution),
+        CTEST_ENTRY(test_exec_async_start_while_pending),
+        CTEST_ENTRY(test_exec_async_wait_for_jobs),
+        CTEST_ENTRY(test_exec_async_interleaved),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
@@ -0,0 +1,36 @@
+// ============================================================================
+// test_exec_helpers.h
+// Executor setup and variable checks shared by the executor ctests
+// ============================================================================
+
+#ifndef TEST_EXEC_HELPERS_H
+#define TEST_EXEC_HELPERS_H
+
+#include "ctest.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+
+static inline miga_exec_t *create_executor(void)
+{
+    miga_exec_t *executor = exec_create();
+    exec_set_shell_name_cstr(executor, "mgsh_test");
+    return executor;
+}
+
+// Value of a variable in the executor's current frame, or "" if unset
+static inline string_t *variable_of(miga_exec_t *executor, const char *name)
+{
+    string_t *value = frame_get_variable_cstr(exec_get_current_frame(executor), name);
+    return value ? value : string_create();
+}
+
+#define ASSERT_VARIABLE(executor, name, expected)                                                  \
+    do                                                                                             \
+    {                                                                                              \
+        string_t *got = variable_of((executor), (name));                                           \
+        CTEST_ASSERT_STR_EQ(ctest, string_cstr(got), (expected), name);                            \
+        string_destroy(&got);                                                                      \
+    } while (0)
+
+#endif /* TEST_EXEC_HELPERS_H */
@@ -0,0 +1,164 @@
+// ============================================================================
+// test_exec_stats_ctest.c
+// Unit tests for the executor's work counters and the miga_stats builtin
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "test_exec_helpers.h"
+#include "xalloc.h"
+
+#include <stdint.h>
+
+// Compile and run TEXT once; returns the exit code
+static int run(miga_exec_t *executor, const char *text)
+{
+    miga_program_t *program = exec_compile_cstr(executor, text);
+    if (!program)
+        return -1;
+    miga_exec_result_t result = exec_run_program(executor, program);
+    miga_program_free(&program);
+    return result.exit_code;
+}
+
+// Run TEXT on counters that start from zero and return what it did
+static miga_exec_stats_t stats_of(miga_exec_t *executor, const char *text)
+{
+    exec_reset_stats(executor);
+    run(executor, text);
+    miga_exec_stats_t st;
+    exec_get_stats(executor, &st);
+    return st;
+}
+
+CTEST(test_exec_stats_process_counters)
+{
+    miga_exec_t *executor = create_executor();
+
+    miga_exec_stats_t st = stats_of(executor, "/bin/true");
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)1, "external command forks once");
+    CTEST_ASSERT_EQ(ctest, st.execs, (uint64_t)1, "and execs once");
+    CTEST_ASSERT_EQ(ctest, st.pipes, (uint64_t)0, "no pipe");
+    CTEST_ASSERT_TRUE(ctest, st.waits >= 1, "child reaped");
+
+    st = stats_of(executor, "true | true | true");
+    CTEST_ASSERT_EQ(ctest, st.pipes, (uint64_t)2, "one pipe between each pair");
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)3, "one child per stage");
+    CTEST_ASSERT_EQ(ctest, st.execs, (uint64_t)0, "builtin stages do not exec");
+
+    st = stats_of(executor, "x=$(echo hi)");
+    CTEST_ASSERT_EQ(ctest, st.command_substitutions, (uint64_t)1, "one substitution");
+    CTEST_ASSERT_EQ(ctest, st.pipes, (uint64_t)1, "read through a pipe");
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)1, "run in a subshell");
+    CTEST_ASSERT_TRUE(ctest, st.variable_inserts >= 1, "x assigned");
+
+    st = stats_of(executor, "y=$x; z=$y");
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)0, "assignments stay in process");
+    CTEST_ASSERT_TRUE(ctest, st.variable_lookups >= 2, "x and y looked up");
+    CTEST_ASSERT_TRUE(ctest, st.variable_inserts >= 2, "y and z assigned");
+
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_stats_per_executor)
+{
+    miga_exec_t *first = create_executor();
+    miga_exec_t *second = create_executor();
+    exec_reset_stats(first);
+    exec_reset_stats(second);
+
+    run(first, "a=1; b=$a; c=$b; d=$c");
+
+    miga_exec_stats_t st1, st2;
+    exec_get_stats(first, &st1);
+    exec_get_stats(second, &st2);
+    CTEST_ASSERT_TRUE(ctest, st1.variable_lookups >= 3, "first counts its lookups");
+    CTEST_ASSERT_TRUE(ctest, st1.variable_inserts >= 4, "first counts its inserts");
+    CTEST_ASSERT_EQ(ctest, st2.variable_lookups, (uint64_t)0, "second sees none of them");
+    CTEST_ASSERT_EQ(ctest, st2.variable_inserts, (uint64_t)0, "nor the inserts");
+    CTEST_ASSERT_EQ(ctest, st2.bytes_allocated, (uint64_t)0, "nor the allocations");
+
+    // And the other way round, with the first executor still alive
+    uint64_t first_lookups = st1.variable_lookups;
+    run(second, "e=$HOME");
+    exec_get_stats(first, &st1);
+    exec_get_stats(second, &st2);
+    CTEST_ASSERT_EQ(ctest, st1.variable_lookups, first_lookups, "first unchanged");
+    CTEST_ASSERT_TRUE(ctest, st2.variable_lookups >= 1, "second counts its own");
+
+    exec_destroy(&second);
+    exec_destroy(&first);
+}
+
+CTEST(test_exec_stats_reset)
+{
+    miga_exec_t *executor = create_executor();
+    run(executor, "x=$(echo hi); true | true; /bin/true; y=$x; for f in /*; do :; done");
+
+    miga_exec_stats_t st;
+    exec_get_stats(executor, &st);
+    CTEST_ASSERT_TRUE(ctest, st.forks > 0, "work was counted");
+    CTEST_ASSERT_TRUE(ctest, st.glob_expansions > 0, "glob counted");
+
+    exec_reset_stats(executor);
+    exec_get_stats(executor, &st);
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)0, "forks");
+    CTEST_ASSERT_EQ(ctest, st.execs, (uint64_t)0, "execs");
+    CTEST_ASSERT_EQ(ctest, st.pipes, (uint64_t)0, "pipes");
+    CTEST_ASSERT_EQ(ctest, st.waits, (uint64_t)0, "waits");
+    CTEST_ASSERT_EQ(ctest, st.command_substitutions, (uint64_t)0, "command_substitutions");
+    CTEST_ASSERT_EQ(ctest, st.glob_expansions, (uint64_t)0, "glob_expansions");
+    CTEST_ASSERT_EQ(ctest, st.frame_pushes, (uint64_t)0, "frame_pushes");
+    CTEST_ASSERT_EQ(ctest, st.variable_lookups, (uint64_t)0, "variable_lookups");
+    CTEST_ASSERT_EQ(ctest, st.variable_inserts, (uint64_t)0, "variable_inserts");
+    CTEST_ASSERT_EQ(ctest, st.envp_rebuilds, (uint64_t)0, "envp_rebuilds");
+    CTEST_ASSERT_EQ(ctest, st.bytes_allocated, (uint64_t)0, "bytes_allocated");
+    CTEST_ASSERT_EQ(ctest, st.parse_ns, (uint64_t)0, "parse_ns");
+    CTEST_ASSERT_EQ(ctest, st.exec_ns, (uint64_t)0, "exec_ns");
+
+    exec_destroy(&executor);
+}
+
+CTEST(test_exec_stats_builtin)
+{
+    miga_exec_t *executor = create_executor();
+
+    CTEST_ASSERT_EQ(ctest, run(executor, "miga_stats bogus 2>/dev/null"), 2, "usage error");
+    CTEST_ASSERT_EQ(ctest, run(executor, "/bin/true; miga_stats >/dev/null"), 0, "prints");
+
+    // -r resets after printing, so nothing before it is left over
+    run(executor, "/bin/true; miga_stats -r >/dev/null");
+    miga_exec_stats_t st;
+    exec_get_stats(executor, &st);
+    CTEST_ASSERT_EQ(ctest, st.forks, (uint64_t)0, "-r cleared the fork");
+    CTEST_ASSERT_EQ(ctest, st.execs, (uint64_t)0, "-r cleared the exec");
+
+    exec_destroy(&executor);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_exec_stats_process_counters),
+#endif
+        CTEST_ENTRY(test_exec_stats_per_executor),
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_exec_stats_reset),
+        CTEST_ENTRY(test_exec_stats_builtin),
+#endif
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
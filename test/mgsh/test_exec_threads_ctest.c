@@ -0,0 +1,191 @@
+// ============================================================================
+// test_exec_threads_ctest.c
+// Stress test: independent executors running in parallel on several threads
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+#include "profiler.h"
+#include "xalloc.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MIGA_POSIX_API
+#include <pthread.h>
+#endif
+
+#define THREAD_COUNT 4
+#define RUNS_PER_THREAD 25
+
+// Function calls, arithmetic and builtins only: nothing forks or touches files
+static const char worker_script[] =
+    "sum() { local i=0 t=0; while [ $i -lt $1 ]; do t=$((t+i)); i=$((i+1)); done; r=$t; }\n"
+    "sum 200\n";
+
+typedef enum worker_mode_t
+{
+    WORKER_FRESH,    // Each run on a new executor
+    WORKER_SNAPSHOT, // Each run on a clone of a shared snapshot
+    WORKER_PROGRAM   // All runs on one executor, of a shared compiled program
+} worker_mode_t;
+
+typedef struct worker_t
+{
+    worker_mode_t mode;
+    const miga_snapshot_t *snapshot;
+    const miga_program_t *program;
+    int runs;
+    int failures;
+} worker_t;
+
+static bool result_is_correct(miga_exec_t *executor)
+{
+    string_t *r = frame_get_variable_cstr(exec_get_current_frame(executor), "r");
+    bool ok = r && strcmp(string_cstr(r), "19900") == 0;
+    if (r)
+        string_destroy(&r);
+    return ok;
+}
+
+static void *worker_main(void *arg)
+{
+    worker_t *w = arg;
+    miga_exec_t *shared = NULL;
+    if (w->mode == WORKER_PROGRAM)
+    {
+        shared = exec_create();
+        exec_set_shell_name_cstr(shared, "test_exec_threads");
+    }
+
+    for (int i = 0; i < w->runs; i++)
+    {
+        miga_exec_t *executor = shared;
+        miga_exec_result_t result;
+        switch (w->mode)
+        {
+        case WORKER_FRESH:
+            executor = exec_create();
+            exec_set_shell_name_cstr(executor, "test_exec_threads");
+            result = exec_execute_command_string(executor, worker_script);
+            break;
+        case WORKER_SNAPSHOT:
+            executor = exec_clone_from_snapshot(w->snapshot);
+            result = exec_execute_command_string(executor, "sum 200");
+            break;
+        default:
+            exec_execute_command_string(executor, "r=0");
+            result = exec_run_program(executor, w->program);
+            break;
+        }
+        if (result.status != MIGA_EXEC_STATUS_OK || !result_is_correct(executor))
+            w->failures++;
+        if (executor != shared)
+            exec_destroy(&executor);
+    }
+
+    if (shared)
+        exec_destroy(&shared);
+    return NULL;
+}
+
+// Run `threads` workers at once; returns the wall time in nanoseconds
+static uint64_t run_workers(worker_t *workers, int threads)
+{
+    uint64_t start = profiler_wall_clock_ns();
+#ifdef MIGA_POSIX_API
+    pthread_t ids[THREAD_COUNT];
+    for (int i = 0; i < threads; i++)
+        pthread_create(&ids[i], NULL, worker_main, &workers[i]);
+    for (int i = 0; i < threads; i++)
+        pthread_join(ids[i], NULL);
+#else
+    for (int i = 0; i < threads; i++)
+        worker_main(&workers[i]);
+#endif
+    return profiler_wall_clock_ns() - start;
+}
+
+static int run_mode(worker_mode_t mode, const miga_snapshot_t *snapshot,
+                    const miga_program_t *program, int threads, uint64_t *ns)
+{
+    worker_t workers[THREAD_COUNT];
+    for (int i = 0; i < threads; i++)
+        workers[i] = (worker_t){.mode = mode,
+                                .snapshot = snapshot,
+                                .program = program,
+                                .runs = RUNS_PER_THREAD,
+                                .failures = 0};
+
+    uint64_t elapsed = run_workers(workers, threads);
+    if (ns)
+        *ns = elapsed;
+
+    int failures = 0;
+    for (int i = 0; i < threads; i++)
+        failures += workers[i].failures;
+    return failures;
+}
+
+CTEST(test_exec_threads_fresh_executors)
+{
+    uint64_t one = 0;
+    uint64_t many = 0;
+    CTEST_ASSERT_EQ(ctest, run_mode(WORKER_FRESH, NULL, NULL, 1, &one), 0, "one thread");
+    CTEST_ASSERT_EQ(ctest, run_mode(WORKER_FRESH, NULL, NULL, THREAD_COUNT, &many), 0,
+                    "all threads");
+
+    // Each thread does the same work, so perfect scaling keeps the time flat
+    printf("# %d threads did %.2fx the work of one in the same time\n", THREAD_COUNT,
+           many ? (double)one * THREAD_COUNT / (double)many : 0.0);
+}
+
+CTEST(test_exec_threads_snapshot_clones)
+{
+    miga_exec_t *source = exec_create();
+    exec_set_shell_name_cstr(source, "test_exec_threads");
+    exec_execute_command_string(source, worker_script);
+    miga_snapshot_t *snapshot = exec_snapshot(source);
+    exec_destroy(&source);
+    CTEST_ASSERT_NOT_NULL(ctest, snapshot, "snapshot taken");
+
+    CTEST_ASSERT_EQ(ctest, run_mode(WORKER_SNAPSHOT, snapshot, NULL, THREAD_COUNT, NULL), 0,
+                    "clones on all threads");
+    exec_snapshot_destroy(&snapshot);
+}
+
+CTEST(test_exec_threads_shared_program)
+{
+    miga_exec_t *compiler = exec_create();
+    exec_set_shell_name_cstr(compiler, "test_exec_threads");
+    miga_program_t *program = exec_compile_cstr(compiler, worker_script);
+    exec_destroy(&compiler);
+    CTEST_ASSERT_NOT_NULL(ctest, program, "program compiled");
+
+    CTEST_ASSERT_EQ(ctest, run_mode(WORKER_PROGRAM, NULL, program, THREAD_COUNT, NULL), 0,
+                    "program on all threads");
+    miga_program_free(&program);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_exec_threads_fresh_executors),
+        CTEST_ENTRY(test_exec_threads_snapshot_clones),
+        CTEST_ENTRY(test_exec_threads_shared_program),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
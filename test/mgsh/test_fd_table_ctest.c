@@ -3,12 +3,20 @@
  * @brief Unit tests for file descriptor table (fd_table.c)
  */
 
+#include <setjmp.h>
+#include <stdio.h>
 #include <string.h>
 #include "ctest.h"
 #include "fd_table.h"
+#include "logging.h"
 #include "miga/string_t.h"
 #include "xalloc.h"
 
+#ifdef MIGA_POSIX_API
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // ------------------------------------------------------------
 // Creation and Destruction Tests
 // ------------------------------------------------------------
@@ -30,8 +38,8 @@ CTEST(test_fd_table_clone)
     // Add some entries
     string_t* path1 = string_create_from_cstr("/tmp/file1.txt");
     string_t* path2 = string_create_from_cstr("/dev/null");
-    fd_table_add(table, 3, FD_REDIRECTED, path1);
-    fd_table_add(table, 5, FD_CLOEXEC | FD_REDIRECTED, path2);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path1);
+    fd_table_add(table, 5, FD_IS_CLOSE_ON_EXEC | FD_IS_REDIRECTED, path2);
     fd_table_mark_saved(table, 10, 3);
 
     // Clone the table
@@ -42,9 +50,9 @@ CTEST(test_fd_table_clone)
 
     // Verify entries match
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(clone, 3), "fd 3 is open in clone");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(clone, 3, FD_REDIRECTED), "fd 3 has FD_REDIRECTED in clone");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(clone, 3, FD_IS_REDIRECTED), "fd 3 has FD_IS_REDIRECTED in clone");
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(clone, 5), "fd 5 is open in clone");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(clone, 5, FD_CLOEXEC), "fd 5 has FD_CLOEXEC in clone");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(clone, 5, FD_IS_CLOSE_ON_EXEC), "fd 5 has FD_IS_CLOSE_ON_EXEC in clone");
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(clone, 10), "fd 10 is open in clone");
     CTEST_ASSERT_EQ(ctest, fd_table_get_original(clone, 10), 3, "fd 10 original is 3 in clone");
 
@@ -66,7 +74,7 @@ CTEST(test_fd_table_add_basic)
     fd_table_t* table = fd_table_create();
 
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    bool result = fd_table_add(table, 3, FD_REDIRECTED, path);
+    bool result = fd_table_add(table, 3, FD_IS_REDIRECTED, path);
 
     CTEST_ASSERT_TRUE(ctest, result, "add succeeded");
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 1, "count is 1");
@@ -84,9 +92,9 @@ CTEST(test_fd_table_add_multiple)
     string_t* path2 = string_create_from_cstr("/tmp/file2.txt");
     string_t* path3 = string_create_from_cstr("/tmp/file3.txt");
 
-    fd_table_add(table, 3, FD_REDIRECTED, path1);
-    fd_table_add(table, 7, FD_CLOEXEC, path2);
-    fd_table_add(table, 5, FD_NONE, path3);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path1);
+    fd_table_add(table, 7, FD_IS_CLOSE_ON_EXEC, path2);
+    fd_table_add(table, 5, FD_IS_DEFAULT, path3);
 
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 3, "count is 3");
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 7, "highest_fd is 7");
@@ -103,15 +111,15 @@ CTEST(test_fd_table_add_update_existing)
 
     // Add initial entry
     string_t* path1 = string_create_from_cstr("/tmp/old.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path1);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path1);
 
     // Update with new path and flags
     string_t* path2 = string_create_from_cstr("/tmp/new.txt");
-    fd_table_add(table, 3, FD_CLOEXEC, path2);
+    fd_table_add(table, 3, FD_IS_CLOSE_ON_EXEC, path2);
 
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 1, "count still 1");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "fd 3 has new flag");
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "fd 3 lost old flag");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "fd 3 has new flag");
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "fd 3 lost old flag");
 
     const string_t* path = fd_table_get_path(table, 3);
     CTEST_ASSERT_STR_EQ(ctest, string_cstr(path), "/tmp/new.txt", "path updated");
@@ -123,7 +131,7 @@ CTEST(test_fd_table_add_null_path)
 {
     fd_table_t* table = fd_table_create();
 
-    bool result = fd_table_add(table, 5, FD_NONE, NULL);
+    bool result = fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_TRUE(ctest, result, "add with NULL path succeeded");
     CTEST_ASSERT_NULL(ctest, fd_table_get_path(table, 5), "path is NULL");
 
@@ -136,13 +144,13 @@ CTEST(test_fd_table_mark_saved)
 
     // Add original FD
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path);
 
     // Mark FD 10 as saved copy of FD 3
     bool result = fd_table_mark_saved(table, 10, 3);
     CTEST_ASSERT_TRUE(ctest, result, "mark_saved succeeded");
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 2, "count is 2");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 10, FD_SAVED), "fd 10 has FD_SAVED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 10, FD_IS_SAVED), "fd 10 has FD_IS_SAVED");
     CTEST_ASSERT_EQ(ctest, fd_table_get_original(table, 10), 3, "fd 10 original is 3");
 
     fd_table_destroy(&table);
@@ -166,7 +174,7 @@ CTEST(test_fd_table_mark_closed)
     fd_table_t* table = fd_table_create();
 
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path);
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(table, 3), "fd 3 initially open");
 
     bool result = fd_table_mark_closed(table, 3);
@@ -192,7 +200,7 @@ CTEST(test_fd_table_remove)
     fd_table_t* table = fd_table_create();
 
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path);
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 1, "count is 1");
 
     bool result = fd_table_remove(table, 3);
@@ -207,9 +215,9 @@ CTEST(test_fd_table_remove_highest_fd)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_NONE, NULL);
-    fd_table_add(table, 5, FD_NONE, NULL);
-    fd_table_add(table, 7, FD_NONE, NULL);
+    fd_table_add(table, 3, FD_IS_DEFAULT, NULL);
+    fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
+    fd_table_add(table, 7, FD_IS_DEFAULT, NULL);
 
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 7, "highest_fd is 7");
 
@@ -234,13 +242,13 @@ CTEST(test_fd_table_find)
     fd_table_t* table = fd_table_create();
 
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path);
 
     fd_entry_t* entry = fd_table_find(table, 3);
     CTEST_ASSERT_NOT_NULL(ctest, entry, "entry found");
     CTEST_ASSERT_EQ(ctest, entry->fd, 3, "fd matches");
     CTEST_ASSERT_TRUE(ctest, entry->is_open, "is_open is true");
-    CTEST_ASSERT_EQ(ctest, entry->flags, FD_REDIRECTED, "flags match");
+    CTEST_ASSERT_EQ(ctest, entry->flags, FD_IS_REDIRECTED, "flags match");
 
     fd_entry_t* not_found = fd_table_find(table, 99);
     CTEST_ASSERT_NULL(ctest, not_found, "nonexistent entry not found");
@@ -252,7 +260,7 @@ CTEST(test_fd_table_is_open)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_NONE, NULL);
+    fd_table_add(table, 3, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(table, 3), "fd 3 is open");
 
     fd_table_mark_closed(table, 3);
@@ -267,13 +275,13 @@ CTEST(test_fd_table_get_flags)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED | FD_CLOEXEC, NULL);
+    fd_table_add(table, 3, FD_IS_REDIRECTED | FD_IS_CLOSE_ON_EXEC, NULL);
 
     fd_flags_t flags = fd_table_get_flags(table, 3);
-    CTEST_ASSERT_EQ(ctest, flags, FD_REDIRECTED | FD_CLOEXEC, "flags match");
+    CTEST_ASSERT_EQ(ctest, flags, FD_IS_REDIRECTED | FD_IS_CLOSE_ON_EXEC, "flags match");
 
     fd_flags_t no_flags = fd_table_get_flags(table, 99);
-    CTEST_ASSERT_EQ(ctest, no_flags, FD_NONE, "nonexistent fd returns FD_NONE");
+    CTEST_ASSERT_EQ(ctest, no_flags, FD_IS_DEFAULT, "nonexistent fd returns FD_IS_DEFAULT");
 
     fd_table_destroy(&table);
 }
@@ -282,12 +290,12 @@ CTEST(test_fd_table_has_flag)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED | FD_CLOEXEC, NULL);
+    fd_table_add(table, 3, FD_IS_REDIRECTED | FD_IS_CLOSE_ON_EXEC, NULL);
 
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "has FD_REDIRECTED");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "has FD_CLOEXEC");
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_SAVED), "does not have FD_SAVED");
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 99, FD_REDIRECTED), "nonexistent fd has no flags");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "has FD_IS_REDIRECTED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "has FD_IS_CLOSE_ON_EXEC");
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_IS_SAVED), "does not have FD_IS_SAVED");
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 99, FD_IS_REDIRECTED), "nonexistent fd has no flags");
 
     fd_table_destroy(&table);
 }
@@ -299,7 +307,7 @@ CTEST(test_fd_table_get_original)
     fd_table_mark_saved(table, 10, 3);
     CTEST_ASSERT_EQ(ctest, fd_table_get_original(table, 10), 3, "original is 3");
 
-    fd_table_add(table, 5, FD_NONE, NULL);
+    fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_get_original(table, 5), -1, "non-saved fd returns -1");
 
     CTEST_ASSERT_EQ(ctest, fd_table_get_original(table, 99), -1, "nonexistent fd returns -1");
@@ -312,14 +320,14 @@ CTEST(test_fd_table_get_path)
     fd_table_t* table = fd_table_create();
 
     string_t* path = string_create_from_cstr("/tmp/test.txt");
-    fd_table_add(table, 3, FD_REDIRECTED, path);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, path);
 
     const string_t* retrieved = fd_table_get_path(table, 3);
     CTEST_ASSERT_NOT_NULL(ctest, retrieved, "path retrieved");
     CTEST_ASSERT_STR_EQ(ctest, string_cstr(retrieved), "/tmp/test.txt", "path matches");
 
     // FD with no path
-    fd_table_add(table, 5, FD_NONE, NULL);
+    fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_NULL(ctest, fd_table_get_path(table, 5), "null path returns NULL");
 
     // Nonexistent FD
@@ -336,13 +344,13 @@ CTEST(test_fd_table_set_flag)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED, NULL);
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "initially no FD_CLOEXEC");
+    fd_table_add(table, 3, FD_IS_REDIRECTED, NULL);
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "initially no FD_IS_CLOSE_ON_EXEC");
 
-    bool result = fd_table_set_flag(table, 3, FD_CLOEXEC);
+    bool result = fd_table_set_flag(table, 3, FD_IS_CLOSE_ON_EXEC);
     CTEST_ASSERT_TRUE(ctest, result, "set_flag succeeded");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "now has FD_CLOEXEC");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "still has FD_REDIRECTED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "now has FD_IS_CLOSE_ON_EXEC");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "still has FD_IS_REDIRECTED");
 
     fd_table_destroy(&table);
 }
@@ -351,7 +359,7 @@ CTEST(test_fd_table_set_flag_nonexistent)
 {
     fd_table_t* table = fd_table_create();
 
-    bool result = fd_table_set_flag(table, 99, FD_CLOEXEC);
+    bool result = fd_table_set_flag(table, 99, FD_IS_CLOSE_ON_EXEC);
     CTEST_ASSERT_FALSE(ctest, result, "set_flag returns false for nonexistent fd");
 
     fd_table_destroy(&table);
@@ -361,13 +369,13 @@ CTEST(test_fd_table_clear_flag)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED | FD_CLOEXEC, NULL);
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "initially has FD_CLOEXEC");
+    fd_table_add(table, 3, FD_IS_REDIRECTED | FD_IS_CLOSE_ON_EXEC, NULL);
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "initially has FD_IS_CLOSE_ON_EXEC");
 
-    bool result = fd_table_clear_flag(table, 3, FD_CLOEXEC);
+    bool result = fd_table_clear_flag(table, 3, FD_IS_CLOSE_ON_EXEC);
     CTEST_ASSERT_TRUE(ctest, result, "clear_flag succeeded");
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "no longer has FD_CLOEXEC");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "still has FD_REDIRECTED");
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "no longer has FD_IS_CLOSE_ON_EXEC");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "still has FD_IS_REDIRECTED");
 
     fd_table_destroy(&table);
 }
@@ -376,7 +384,7 @@ CTEST(test_fd_table_clear_flag_nonexistent)
 {
     fd_table_t* table = fd_table_create();
 
-    bool result = fd_table_clear_flag(table, 99, FD_CLOEXEC);
+    bool result = fd_table_clear_flag(table, 99, FD_IS_CLOSE_ON_EXEC);
     CTEST_ASSERT_FALSE(ctest, result, "clear_flag returns false for nonexistent fd");
 
     fd_table_destroy(&table);
@@ -390,16 +398,16 @@ CTEST(test_fd_table_get_fds_with_flag)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED, NULL);
-    fd_table_add(table, 5, FD_CLOEXEC, NULL);
-    fd_table_add(table, 7, FD_REDIRECTED | FD_CLOEXEC, NULL);
-    fd_table_add(table, 9, FD_NONE, NULL);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, NULL);
+    fd_table_add(table, 5, FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 7, FD_IS_REDIRECTED | FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 9, FD_IS_DEFAULT, NULL);
 
     size_t count = 0;
-    int* redirected = fd_table_get_fds_with_flag(table, FD_REDIRECTED, &count);
+    int* redirected = fd_table_get_fds_with_flag(table, FD_IS_REDIRECTED, &count);
 
     CTEST_ASSERT_NOT_NULL(ctest, redirected, "array returned");
-    CTEST_ASSERT_EQ(ctest, count, 2, "2 FDs with FD_REDIRECTED");
+    CTEST_ASSERT_EQ(ctest, count, 2, "2 FDs with FD_IS_REDIRECTED");
 
     // Check that FDs 3 and 7 are in the array (order not guaranteed)
     bool found_3 = false;
@@ -419,11 +427,11 @@ CTEST(test_fd_table_get_fds_with_flag_none_found)
 {
     fd_table_t* table = fd_table_create();
 
-    fd_table_add(table, 3, FD_REDIRECTED, NULL);
-    fd_table_add(table, 5, FD_REDIRECTED, NULL);
+    fd_table_add(table, 3, FD_IS_REDIRECTED, NULL);
+    fd_table_add(table, 5, FD_IS_REDIRECTED, NULL);
 
     size_t count = 0;
-    int* saved = fd_table_get_fds_with_flag(table, FD_SAVED, &count);
+    int* saved = fd_table_get_fds_with_flag(table, FD_IS_SAVED, &count);
 
     CTEST_ASSERT_NULL(ctest, saved, "NULL returned when no matches");
     CTEST_ASSERT_EQ(ctest, count, 0, "count is 0");
@@ -436,7 +444,7 @@ CTEST(test_fd_table_get_fds_with_flag_empty_table)
     fd_table_t* table = fd_table_create();
 
     size_t count = 0;
-    int* fds = fd_table_get_fds_with_flag(table, FD_CLOEXEC, &count);
+    int* fds = fd_table_get_fds_with_flag(table, FD_IS_CLOSE_ON_EXEC, &count);
 
     CTEST_ASSERT_NULL(ctest, fds, "NULL returned for empty table");
     CTEST_ASSERT_EQ(ctest, count, 0, "count is 0");
@@ -450,11 +458,11 @@ CTEST(test_fd_table_count)
 
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 0, "count is 0 initially");
 
-    fd_table_add(table, 3, FD_NONE, NULL);
+    fd_table_add(table, 3, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 1, "count is 1");
 
-    fd_table_add(table, 5, FD_NONE, NULL);
-    fd_table_add(table, 7, FD_NONE, NULL);
+    fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
+    fd_table_add(table, 7, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_count(table), 3, "count is 3");
 
     fd_table_remove(table, 5);
@@ -469,13 +477,13 @@ CTEST(test_fd_table_get_highest_fd)
 
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), -1, "highest_fd is -1 initially");
 
-    fd_table_add(table, 3, FD_NONE, NULL);
+    fd_table_add(table, 3, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 3, "highest_fd is 3");
 
-    fd_table_add(table, 5, FD_NONE, NULL);
+    fd_table_add(table, 5, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 5, "highest_fd is 5");
 
-    fd_table_add(table, 10, FD_NONE, NULL);
+    fd_table_add(table, 10, FD_IS_DEFAULT, NULL);
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 10, "highest_fd is 10");
 
     fd_table_destroy(&table);
@@ -485,27 +493,44 @@ CTEST(test_fd_table_get_highest_fd)
 // Edge Cases and Stress Tests
 // ------------------------------------------------------------
 
+/* Expect `call` to stop at the table's not-NULL precondition */
+#define ASSERT_CONTRACT_VIOLATION(call, msg)                                                       \
+    do                                                                                             \
+    {                                                                                              \
+        jmp_buf env;                                                                               \
+        if (log_fatal_try_begin(&env) == 0)                                                        \
+        {                                                                                          \
+            (void)(call);                                                                          \
+            log_fatal_try_end();                                                                   \
+            CTEST_ASSERT_TRUE(ctest, false, msg);                                                  \
+        }                                                                                          \
+        else                                                                                       \
+        {                                                                                          \
+            log_fatal_try_end();                                                                   \
+        }                                                                                          \
+    } while (0)
+
 CTEST(test_fd_table_null_handling)
 {
-    // Test that operations handle NULL table gracefully
-    CTEST_ASSERT_FALSE(ctest, fd_table_add(NULL, 3, FD_NONE, NULL), "add with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_mark_saved(NULL, 10, 3), "mark_saved with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_mark_closed(NULL, 3), "mark_closed with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_remove(NULL, 3), "remove with NULL table");
-    CTEST_ASSERT_NULL(ctest, fd_table_find(NULL, 3), "find with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_is_open(NULL, 3), "is_open with NULL table");
-    CTEST_ASSERT_EQ(ctest, fd_table_get_flags(NULL, 3), FD_NONE, "get_flags with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(NULL, 3, FD_NONE), "has_flag with NULL table");
-    CTEST_ASSERT_EQ(ctest, fd_table_get_original(NULL, 3), -1, "get_original with NULL table");
-    CTEST_ASSERT_NULL(ctest, fd_table_get_path(NULL, 3), "get_path with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_set_flag(NULL, 3, FD_NONE), "set_flag with NULL table");
-    CTEST_ASSERT_FALSE(ctest, fd_table_clear_flag(NULL, 3, FD_NONE), "clear_flag with NULL table");
-    CTEST_ASSERT_EQ(ctest, fd_table_count(NULL), 0, "count with NULL table");
-    CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(NULL), -1, "get_highest_fd with NULL table");
-
+    // Test that operations reject a NULL table through their preconditions
     size_t count = 0;
-    CTEST_ASSERT_NULL(ctest, fd_table_get_fds_with_flag(NULL, FD_NONE, &count), "get_fds_with_flag with NULL table");
-    CTEST_ASSERT_EQ(ctest, count, 0, "count is 0 for NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_add(NULL, 3, FD_IS_DEFAULT, NULL), "add with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_mark_saved(NULL, 10, 3), "mark_saved with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_mark_closed(NULL, 3), "mark_closed with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_remove(NULL, 3), "remove with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_find(NULL, 3), "find with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_is_open(NULL, 3), "is_open with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_get_flags(NULL, 3), "get_flags with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_has_flag(NULL, 3, FD_IS_DEFAULT), "has_flag with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_get_original(NULL, 3), "get_original with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_get_path(NULL, 3), "get_path with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_set_flag(NULL, 3, FD_IS_DEFAULT), "set_flag with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_clear_flag(NULL, 3, FD_IS_DEFAULT), "clear_flag with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_count(NULL), "count with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_get_highest_fd(NULL), "get_highest_fd with NULL table");
+    ASSERT_CONTRACT_VIOLATION(fd_table_get_fds_with_flag(NULL, FD_IS_DEFAULT, &count),
+                              "get_fds_with_flag with NULL table");
+    CTEST_ASSERT_EQ(ctest, count, 0, "count untouched for NULL table");
 }
 
 CTEST(test_fd_table_large_fd_numbers)
@@ -513,9 +538,9 @@ CTEST(test_fd_table_large_fd_numbers)
     fd_table_t* table = fd_table_create();
 
     // Add FDs with large numbers
-    fd_table_add(table, 1000, FD_NONE, NULL);
-    fd_table_add(table, 5000, FD_CLOEXEC, NULL);
-    fd_table_add(table, 100, FD_REDIRECTED, NULL);
+    fd_table_add(table, 1000, FD_IS_DEFAULT, NULL);
+    fd_table_add(table, 5000, FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 100, FD_IS_REDIRECTED, NULL);
 
     CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 5000, "highest_fd is 5000");
     CTEST_ASSERT_TRUE(ctest, fd_table_is_open(table, 1000), "fd 1000 is open");
@@ -531,7 +556,7 @@ CTEST(test_fd_table_capacity_growth)
 
     // Add more entries than initial capacity to trigger growth
     for (int i = 0; i < 20; i++) {
-        bool result = fd_table_add(table, i, FD_NONE, NULL);
+        bool result = fd_table_add(table, i, FD_IS_DEFAULT, NULL);
         CTEST_ASSERT_TRUE(ctest, result, "add succeeded during growth");
     }
 
@@ -551,23 +576,125 @@ CTEST(test_fd_table_multiple_flags)
     fd_table_t* table = fd_table_create();
 
     // Add with no flags, then set multiple flags
-    fd_table_add(table, 3, FD_NONE, NULL);
-    fd_table_set_flag(table, 3, FD_REDIRECTED);
-    fd_table_set_flag(table, 3, FD_CLOEXEC);
-    fd_table_set_flag(table, 3, FD_SAVED);
+    fd_table_add(table, 3, FD_IS_DEFAULT, NULL);
+    fd_table_set_flag(table, 3, FD_IS_REDIRECTED);
+    fd_table_set_flag(table, 3, FD_IS_CLOSE_ON_EXEC);
+    fd_table_set_flag(table, 3, FD_IS_SAVED);
 
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "has FD_REDIRECTED");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "has FD_CLOEXEC");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_SAVED), "has FD_SAVED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "has FD_IS_REDIRECTED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "has FD_IS_CLOSE_ON_EXEC");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_SAVED), "has FD_IS_SAVED");
 
     // Clear one flag at a time
-    fd_table_clear_flag(table, 3, FD_CLOEXEC);
-    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_CLOEXEC), "FD_CLOEXEC cleared");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_REDIRECTED), "still has FD_REDIRECTED");
-    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_SAVED), "still has FD_SAVED");
+    fd_table_clear_flag(table, 3, FD_IS_CLOSE_ON_EXEC);
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 3, FD_IS_CLOSE_ON_EXEC), "FD_IS_CLOSE_ON_EXEC cleared");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_REDIRECTED), "still has FD_IS_REDIRECTED");
+    CTEST_ASSERT_TRUE(ctest, fd_table_has_flag(table, 3, FD_IS_SAVED), "still has FD_IS_SAVED");
+
+    fd_table_destroy(&table);
+}
+
+static bool collect_fd(const fd_entry_t *entry, void *user_data)
+{
+    string_t *out = user_data;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d ", entry->fd);
+    string_append_cstr(out, buf);
+    return true;
+}
+
+CTEST(test_fd_table_page_boundaries)
+{
+    fd_table_t* table = fd_table_create();
+
+    // FDs on both sides of a page boundary, added out of order
+    fd_table_add(table, 130, FD_IS_SAVED | FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 64, FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 63, FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 1, FD_IS_REDIRECTED, NULL);
+
+    string_t* order = string_create();
+    fd_table_foreach(table, collect_fd, order);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(order), "1 63 64 130 ", "foreach in FD order");
+    string_destroy(&order);
 
+    size_t count = 0;
+    int* cloexec = fd_table_get_fds_with_flag(table, FD_IS_CLOSE_ON_EXEC, &count);
+    CTEST_ASSERT_EQ(ctest, count, 3, "3 FDs with FD_IS_CLOSE_ON_EXEC");
+    CTEST_ASSERT_EQ(ctest, cloexec[0], 63, "first is 63");
+    CTEST_ASSERT_EQ(ctest, cloexec[1], 64, "second is 64");
+    CTEST_ASSERT_EQ(ctest, cloexec[2], 130, "third is 130");
+    xfree(cloexec);
+
+    // Removing the highest FD finds the next one on a lower page
+    fd_table_remove(table, 130);
+    CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 64, "highest_fd is 64");
+    fd_table_remove(table, 64);
+    CTEST_ASSERT_EQ(ctest, fd_table_get_highest_fd(table), 63, "highest_fd is 63");
+
+    // A removed FD leaves no flag behind when it is added again
+    fd_table_add(table, 130, FD_IS_DEFAULT, NULL);
+    CTEST_ASSERT_FALSE(ctest, fd_table_has_flag(table, 130, FD_IS_SAVED), "no stale FD_IS_SAVED");
+    cloexec = fd_table_get_fds_with_flag(table, FD_IS_SAVED, &count);
+    CTEST_ASSERT_EQ(ctest, count, 0, "no FD with FD_IS_SAVED");
+    xfree(cloexec);
+
+    // Flag bits are copied with the table
+    fd_table_t* clone = fd_table_clone(table);
+    cloexec = fd_table_get_fds_with_flag(clone, FD_IS_CLOSE_ON_EXEC | FD_IS_REDIRECTED, &count);
+    CTEST_ASSERT_EQ(ctest, count, 2, "clone has 2 flagged FDs");
+    CTEST_ASSERT_EQ(ctest, cloexec[0], 1, "first is 1");
+    CTEST_ASSERT_EQ(ctest, cloexec[1], 63, "second is 63");
+    xfree(cloexec);
+
+    fd_table_destroy(&clone);
+    fd_table_destroy(&table);
+}
+
+#ifdef MIGA_POSIX_API
+static bool fd_is_valid(int fd)
+{
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+CTEST(test_fd_table_close_with_flag)
+{
+    fd_table_t* table = fd_table_create();
+    int base = open("/dev/null", O_RDONLY);
+    CTEST_ASSERT_TRUE(ctest, base >= 0, "opened /dev/null");
+
+    // Two runs of CLOEXEC FDs with an untracked FD and a plain one between
+    int fds[] = {40, 41, 42, 43, 44, 45};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        dup2(base, fds[i]);
+    }
+    fd_table_add(table, 40, FD_IS_CLOSE_ON_EXEC, NULL);
+    fd_table_add(table, 41, FD_IS_CLOSE_ON_EXEC | FD_IS_SAVED, NULL);
+    fd_table_add(table, 43, FD_IS_REDIRECTED, NULL);
+    fd_table_add(table, 44, FD_IS_CLOSE_ON_EXEC, NULL);
+
+    fd_table_close_with_flag(table, FD_IS_CLOSE_ON_EXEC);
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(40), "fd 40 closed");
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(41), "fd 41 closed");
+    CTEST_ASSERT_TRUE(ctest, fd_is_valid(42), "untracked fd 42 still open");
+    CTEST_ASSERT_TRUE(ctest, fd_is_valid(43), "fd 43 without the flag still open");
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(44), "fd 44 closed");
+    CTEST_ASSERT_TRUE(ctest, fd_is_valid(45), "untracked fd 45 still open");
+    CTEST_ASSERT_EQ(ctest, fd_table_count(table), 4, "table unchanged");
+
+    // A list with gaps and unused slots, out of order
+    int list[] = {45, -1, 42, 43, -1};
+    fd_table_close_fds(list, sizeof(list) / sizeof(list[0]));
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(42), "fd 42 closed");
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(43), "fd 43 closed");
+    CTEST_ASSERT_FALSE(ctest, fd_is_valid(45), "fd 45 closed");
+    CTEST_ASSERT_TRUE(ctest, fd_is_valid(base), "other fd still open");
+
+    close(base);
     fd_table_destroy(&table);
 }
+#endif
 
 // ------------------------------------------------------------
 // Test suite entry
@@ -622,6 +749,10 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_fd_table_large_fd_numbers),
         CTEST_ENTRY(test_fd_table_capacity_growth),
         CTEST_ENTRY(test_fd_table_multiple_flags),
+        CTEST_ENTRY(test_fd_table_page_boundaries),
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_fd_table_close_with_flag),
+#endif
 
         NULL
     };
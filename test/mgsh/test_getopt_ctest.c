@@ -197,6 +197,31 @@ CTEST(test_long_option_with_plus)
     CTEST_ASSERT_EQ(ctest, state.optind, 2, "optind advanced");
 }
 
+CTEST(test_long_option_after_short_entries)
+{
+    /* Short-only entries (NULL name) may precede the long ones */
+    static struct option_ex mixed_opts[] = {
+        {NULL, no_argument, 1, &flag_v, 'v', NULL},
+        {NULL, no_argument, 0, NULL, 's', NULL},
+        {"profile", required_argument, 0, NULL, 256, NULL},
+        {NULL, 0, 0, NULL, 0, NULL}
+    };
+
+    char* argv[] = { "prog", "--profile=out.folded", "-v", NULL };
+    int argc = 3;
+    struct getopt_state state = { 0 };
+    state.opterr = 0;
+    flag_v = 0;
+
+    int c = getopt_long_plus_r(argc, argv, "vs", mixed_opts, NULL, &state);
+    CTEST_ASSERT_EQ(ctest, c, 256, "--profile found after short-only entries");
+    CTEST_ASSERT_STR_EQ(ctest, state.optarg, "out.folded", "optarg is the attached value");
+
+    c = getopt_long_plus_r(argc, argv, "vs", mixed_opts, NULL, &state);
+    CTEST_ASSERT_EQ(ctest, c, 'v', "short option still recognised");
+    CTEST_ASSERT_EQ(ctest, flag_v, 1, "-v sets flag_v");
+}
+
 CTEST(test_optional_argument_present)
 {
     char* argv[] = { "prog", "-ovalue", NULL };
@@ -443,6 +468,7 @@ int main(int argc, char** argv)
         CTEST_ENTRY(test_optarg_missing),
         CTEST_ENTRY(test_long_option_basic),
         CTEST_ENTRY(test_long_option_with_plus),
+        CTEST_ENTRY(test_long_option_after_short_entries),
         CTEST_ENTRY(test_optional_argument_present),
         CTEST_ENTRY(test_optional_argument_missing),
         CTEST_ENTRY(test_colon_prefix_missing_arg),
@@ -0,0 +1,273 @@
+/**
+ * @file test_history_ctest.c
+ * @brief Unit tests for the command history store (history.c)
+ */
+
+#include "ctest.h"
+#include "history.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/string_t.h"
+#include "xalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef MIGA_POSIX_API
+#include <unistd.h>
+#endif
+
+#define ASSERT_ENTRY(hist, n, expected)                                                            \
+    do                                                                                             \
+    {                                                                                              \
+        string_t *entry = string_create();                                                         \
+        CTEST_ASSERT_TRUE(ctest, history_get((hist), (n), entry), "entry exists");                 \
+        CTEST_ASSERT_STR_EQ(ctest, string_cstr(entry), (expected), "entry text");                 \
+        string_destroy(&entry);                                                                    \
+    } while (0)
+
+CTEST(test_history_memory)
+{
+    history_t *hist = history_create();
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 0, "starts empty");
+
+    history_add(hist, "echo one");
+    history_add(hist, "for i in 1 2\ndo echo $i\ndone");
+    history_add(hist, "echo two");
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 3, "three entries");
+    ASSERT_ENTRY(hist, 0, "echo one");
+    ASSERT_ENTRY(hist, 1, "for i in 1 2\ndo echo $i\ndone");
+    ASSERT_ENTRY(hist, 2, "echo two");
+
+    string_t *entry = string_create();
+    CTEST_ASSERT_FALSE(ctest, history_get(hist, 3, entry), "no entry past the end");
+    CTEST_ASSERT_FALSE(ctest, history_get(hist, -1, entry), "no negative entry");
+    string_destroy(&entry);
+
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "echo", -1), 2, "newest match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "echo", 2), 1, "match before entry 2");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "echo one", 2), 0, "older match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "$i\ndone", -1), 1, "match across newline");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "three", -1), -1, "no match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "", -1), 2, "empty text matches newest");
+
+    history_destroy(&hist);
+    CTEST_ASSERT_NULL(ctest, hist, "history pointer null after destroy");
+}
+
+CTEST(test_history_trigram_search)
+{
+    history_t *hist = history_create();
+    char line[64];
+    for (int i = 0; i < HISTORY_TRIGRAM_MIN_ENTRIES + 100; i++)
+    {
+        snprintf(line, sizeof(line), "make target_%d", i);
+        history_add(hist, line);
+    }
+
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "target_7", -1), 799, "newest match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "target_7", 700), 79, "match before entry 700");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "target_1100", -1), 1100, "only match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "target_99999", -1), -1, "no match");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "zzz", -1), -1, "unknown trigram");
+
+    /* Entries added after the index was built are found */
+    history_add(hist, "git status");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "status", -1), HISTORY_TRIGRAM_MIN_ENTRIES + 100,
+                    "new entry indexed");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "ma", -1), HISTORY_TRIGRAM_MIN_ENTRIES + 99,
+                    "short text scans");
+
+    history_destroy(&hist);
+}
+
+#ifdef MIGA_POSIX_API
+
+static void remove_history(const char *path)
+{
+    char idx[512];
+    snprintf(idx, sizeof(idx), "%s.idx", path);
+    unlink(path);
+    unlink(idx);
+}
+
+static void append_raw(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "a");
+    if (fp)
+    {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+CTEST(test_history_file)
+{
+    char dir[] = "/tmp/history_XXXXXX";
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir), "made directory");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/hist", dir);
+
+    history_t *hist = history_open(path);
+    CTEST_ASSERT_NOT_NULL(ctest, hist, "opened new file");
+    history_add(hist, "ls");
+    history_add(hist, "cat <<EOF\nx\nEOF");
+    history_destroy(&hist);
+
+    hist = history_open(path);
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 2, "entries kept");
+    ASSERT_ENTRY(hist, 0, "ls");
+    ASSERT_ENTRY(hist, 1, "cat <<EOF\nx\nEOF");
+
+    /* Two shells sharing the file see each other's entries */
+    history_t *other = history_open(path);
+    history_add(other, "pwd");
+    history_add(hist, "date");
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 4, "first sees both");
+    ASSERT_ENTRY(hist, 2, "pwd");
+    ASSERT_ENTRY(hist, 3, "date");
+    history_destroy(&other);
+    history_destroy(&hist);
+
+    /* Lines written by something else are indexed on opening */
+    append_raw(path, "uname\nid\n");
+    hist = history_open(path);
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 6, "appended lines indexed");
+    ASSERT_ENTRY(hist, 5, "id");
+    history_destroy(&hist);
+
+    /* A lost index is built again */
+    char idx[512];
+    snprintf(idx, sizeof(idx), "%s.idx", path);
+    unlink(idx);
+    hist = history_open(path);
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 6, "index rebuilt");
+    ASSERT_ENTRY(hist, 1, "cat <<EOF\nx\nEOF");
+    history_destroy(&hist);
+
+    /* An unfinished line becomes an entry of its own */
+    append_raw(path, "tru");
+    hist = history_open(path);
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 6, "unfinished line not indexed");
+    history_add(hist, "true");
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 8, "unfinished line finished");
+    ASSERT_ENTRY(hist, 6, "tru");
+    ASSERT_ENTRY(hist, 7, "true");
+    history_destroy(&hist);
+
+    remove_history(path);
+    rmdir(dir);
+}
+
+CTEST(test_history_truncated)
+{
+    char dir[] = "/tmp/history_XXXXXX";
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir), "made directory");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/hist", dir);
+
+    history_t *hist = history_open(path);
+    char line[64];
+    for (int i = 0; i < 2000; i++)
+    {
+        snprintf(line, sizeof(line), "echo %d", i);
+        history_add(hist, line);
+    }
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 2000, "entries added");
+
+    /* `: > $HISTFILE` while the file is mapped */
+    fclose(fopen(path, "w"));
+    string_t *entry = string_create();
+    CTEST_ASSERT_FALSE(ctest, history_get(hist, 1999, entry), "truncated entry gone");
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 0, "truncated history is empty");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "echo", -1), -1, "nothing to find");
+    string_destroy(&entry);
+    history_add(hist, "after");
+    CTEST_ASSERT_EQ(ctest, history_count(hist), 1, "added after truncation");
+    ASSERT_ENTRY(hist, 0, "after");
+
+    /* Another shell building a new index leaves the old mapping intact */
+    for (int i = 0; i < 2000; i++)
+    {
+        snprintf(line, sizeof(line), "echo %d", i);
+        history_add(hist, line);
+    }
+    char idx[512];
+    snprintf(idx, sizeof(idx), "%s.idx", path);
+    unlink(idx);
+    history_t *other = history_open(path);
+    CTEST_ASSERT_EQ(ctest, history_count(other), 2001, "other rebuilt the index");
+    ASSERT_ENTRY(hist, 2000, "echo 1999");
+    CTEST_ASSERT_EQ(ctest, history_search(hist, "echo 5", -1), 600, "search after rebuild");
+    history_destroy(&other);
+
+    /* Reading neither needs nor recreates a deleted history file */
+    remove_history(path);
+    ASSERT_ENTRY(hist, 2000, "echo 1999");
+    CTEST_ASSERT_EQ(ctest, access(path, F_OK), -1, "history file not recreated");
+    history_destroy(&hist);
+
+    remove_history(path);
+    rmdir(dir);
+}
+
+CTEST(test_history_exec)
+{
+    char dir[] = "/tmp/history_XXXXXX";
+    CTEST_ASSERT_NOT_NULL(ctest, mkdtemp(dir), "made directory");
+    char script[256];
+    snprintf(script, sizeof(script), "HISTFILE=%s/hist", dir);
+
+    miga_exec_t *executor = exec_create();
+    exec_set_shell_name_cstr(executor, "test_history");
+    exec_execute_command_string(executor, script);
+    exec_history_add(executor, "echo hello");
+    exec_history_add(executor, "echo world");
+    exec_destroy(&executor);
+
+    executor = exec_create();
+    exec_set_shell_name_cstr(executor, "test_history");
+    exec_execute_command_string(executor, script);
+    CTEST_ASSERT_EQ(ctest, exec_history_count(executor), 2, "HISTFILE read");
+    string_t *entry = exec_history_get(executor, 0);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(entry), "echo hello", "first entry");
+    string_destroy(&entry);
+    CTEST_ASSERT_NULL(ctest, exec_history_get(executor, 2), "no third entry");
+    CTEST_ASSERT_EQ(ctest, exec_history_search(executor, "hello", -1), 0, "search");
+
+    CTEST_ASSERT_TRUE(ctest, exec_history_open(executor, NULL), "memory history");
+    CTEST_ASSERT_EQ(ctest, exec_history_count(executor), 0, "memory history is empty");
+    exec_destroy(&executor);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/hist", dir);
+    remove_history(path);
+    rmdir(dir);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_history_memory),
+        CTEST_ENTRY(test_history_trigram_search),
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_history_file),
+        CTEST_ENTRY(test_history_truncated),
+        CTEST_ENTRY(test_history_exec),
+#endif
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
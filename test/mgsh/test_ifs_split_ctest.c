@@ -0,0 +1,149 @@
+// ============================================================================
+// test_ifs_split_ctest.c
+// Unit tests for table-driven IFS field splitting
+// ============================================================================
+
+#include "ctest.h"
+#include "ifs_split.h"
+#include "xalloc.h"
+#include <string.h>
+
+// Split `text` on `ifs` and join the fields as "[f1][f2]..." for comparison
+static string_t *split_to_brackets(ifs_splitter_t *sp, const char *ifs, const char *text)
+{
+    ifs_splitter_set_ifs(sp, ifs);
+    string_t *in = string_create_from_cstr(text);
+    strlist_t *fields = ifs_splitter_split(sp, in);
+    string_destroy(&in);
+
+    string_t *out = string_create();
+    for (int i = 0; i < strlist_size(fields); i++)
+    {
+        string_append_cstr(out, "[");
+        string_append(out, strlist_at(fields, i));
+        string_append_cstr(out, "]");
+    }
+    strlist_destroy(&fields);
+    return out;
+}
+
+#define ASSERT_SPLIT(ifs, text, expected)                                                          \
+    do                                                                                             \
+    {                                                                                              \
+        string_t *got = split_to_brackets(sp, (ifs), (text));                                      \
+        CTEST_ASSERT_STR_EQ(ctest, string_cstr(got), (expected), text);                            \
+        string_destroy(&got);                                                                      \
+    } while (0)
+
+CTEST(test_ifs_split_default_whitespace)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    ASSERT_SPLIT(" \t\n", "a b c", "[a][b][c]");
+    ASSERT_SPLIT(" \t\n", "  a \t\n b  ", "[a][b]");
+    ASSERT_SPLIT(" \t\n", " \t\n ", "");
+    ASSERT_SPLIT(" \t\n", "single", "[single]");
+    ifs_splitter_destroy(&sp);
+    CTEST_ASSERT_NULL(ctest, sp, "splitter destroyed");
+}
+
+CTEST(test_ifs_split_long_fields_cross_vector_width)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    // Fields longer than 16 bytes and delimiters on both sides of a 16-byte boundary
+    ASSERT_SPLIT(" \t\n", "abcdefghijklmnopqrstuvwxyz 0123456789abcde\tX",
+                 "[abcdefghijklmnopqrstuvwxyz][0123456789abcde][X]");
+    ASSERT_SPLIT(" \t\n", "0123456789abcdef 0123456789abcdef", "[0123456789abcdef][0123456789abcdef]");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_hard_delimiters)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    ASSERT_SPLIT(":", "a:b:c", "[a][b][c]");
+    ASSERT_SPLIT(":", "a::b", "[a][][b]");
+    ASSERT_SPLIT(":", ":a", "[][a]");
+    ASSERT_SPLIT(":", "a:", "[a]");
+    ASSERT_SPLIT(":", "a b:c", "[a b][c]");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_mixed_whitespace_and_hard)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    ASSERT_SPLIT(" ,", "a , b", "[a][b]");
+    ASSERT_SPLIT(" ,", "a ,, b", "[a][][b]");
+    ASSERT_SPLIT(" ,", " a, ", "[a]");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_empty_ifs)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    ASSERT_SPLIT("", " a b ", "[ a b ]");
+    ASSERT_SPLIT("", "", "");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_table_follows_ifs_changes)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    ASSERT_SPLIT(":", "a:b c", "[a][b c]");
+    ASSERT_SPLIT(" \t\n", "a:b c", "[a:b][c]");
+    ASSERT_SPLIT(":", "a:b c", "[a][b c]");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_remembers_source)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    int store_a, store_b;
+    CTEST_ASSERT_FALSE(ctest, ifs_splitter_is_from(sp, &store_a, 1), "nothing recorded yet");
+
+    ifs_splitter_set_ifs_from(sp, ":", &store_a, 7);
+    CTEST_ASSERT_TRUE(ctest, ifs_splitter_is_from(sp, &store_a, 7), "same store and generation");
+    CTEST_ASSERT_FALSE(ctest, ifs_splitter_is_from(sp, &store_a, 8), "store changed");
+    CTEST_ASSERT_FALSE(ctest, ifs_splitter_is_from(sp, &store_b, 7), "another store");
+
+    ifs_splitter_set_ifs(sp, ":");
+    CTEST_ASSERT_FALSE(ctest, ifs_splitter_is_from(sp, &store_a, 7), "plain set forgets the source");
+    ifs_splitter_destroy(&sp);
+}
+
+CTEST(test_ifs_split_scan_returns_slices)
+{
+    ifs_splitter_t *sp = ifs_splitter_create();
+    const char *text = "  ab  cde ";
+    const ifs_field_t *fields = NULL;
+    int n = ifs_splitter_scan(sp, text, (int)strlen(text), &fields);
+    CTEST_ASSERT_EQ(ctest, n, 2, "two fields");
+    CTEST_ASSERT_EQ(ctest, fields[0].start, 2, "first field offset");
+    CTEST_ASSERT_EQ(ctest, fields[0].length, 2, "first field length");
+    CTEST_ASSERT_EQ(ctest, fields[1].start, 6, "second field offset");
+    CTEST_ASSERT_EQ(ctest, fields[1].length, 3, "second field length");
+    ifs_splitter_destroy(&sp);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_ifs_split_default_whitespace),
+        CTEST_ENTRY(test_ifs_split_long_fields_cross_vector_width),
+        CTEST_ENTRY(test_ifs_split_hard_delimiters),
+        CTEST_ENTRY(test_ifs_split_mixed_whitespace_and_hard),
+        CTEST_ENTRY(test_ifs_split_empty_ifs),
+        CTEST_ENTRY(test_ifs_split_table_follows_ifs_changes),
+        CTEST_ENTRY(test_ifs_split_remembers_source),
+        CTEST_ENTRY(test_ifs_split_scan_returns_slices),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
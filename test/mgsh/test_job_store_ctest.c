@@ -399,6 +399,45 @@ CTEST(test_job_store_mark_notified)
     job_store_destroy(&store);
 }
 
+CTEST(test_job_store_count_running)
+{
+    job_store_t *store = job_store_create();
+
+    string_t *cmd1 = string_create_from_cstr("sleep 1");
+    string_t *cmd2 = string_create_from_cstr("sleep 2");
+    string_t *cmd3 = string_create_from_cstr("vi");
+
+    int job1 = job_store_add(store, cmd1, true);
+    int job2 = job_store_add(store, cmd2, true);
+    int job3 = job_store_add(store, cmd3, false);
+
+    job_store_add_process(store, job1, 2001, cmd1);
+    job_store_add_process(store, job2, 2002, cmd2);
+    job_store_add_process(store, job3, 2003, cmd3);
+
+    CTEST_ASSERT_EQ(ctest, job_store_count_running(store), 2, "two background jobs running");
+    CTEST_ASSERT_NULL(ctest, job_store_find_unreported_completed(store), "nothing completed yet");
+
+    job_store_set_process_state(store, 2002, JOB_DONE, 0);
+    CTEST_ASSERT_EQ(ctest, job_store_count_running(store), 1, "one background job running");
+
+    job_t *done = job_store_find_unreported_completed(store);
+    CTEST_ASSERT_NOT_NULL(ctest, done, "completed job found");
+    CTEST_ASSERT_EQ(ctest, done->job_id, job2, "completed job is job2");
+
+    job_store_mark_notified(store, job2);
+    CTEST_ASSERT_NULL(ctest, job_store_find_unreported_completed(store), "notified job skipped");
+
+    job_store_set_process_state(store, 2001, JOB_TERMINATED, 15);
+    CTEST_ASSERT_EQ(ctest, job_store_count_running(store), 0, "no background jobs running");
+    CTEST_ASSERT_EQ(ctest, job_store_count_running(NULL), 0, "count_running of null store is 0");
+
+	string_destroy(&cmd1);
+	string_destroy(&cmd2);
+	string_destroy(&cmd3);
+    job_store_destroy(&store);
+}
+
 // ------------------------------------------------------------
 // Job Removal Tests
 // ------------------------------------------------------------
@@ -667,6 +706,7 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_job_store_set_state),
         CTEST_ENTRY(test_job_store_set_process_state),
         CTEST_ENTRY(test_job_store_mark_notified),
+        CTEST_ENTRY(test_job_store_count_running),
 
         // Job removal
         CTEST_ENTRY(test_job_store_remove),
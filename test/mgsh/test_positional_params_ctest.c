@@ -15,6 +15,7 @@
 #include "positional_params.h"
 #include "lib.h"
 #include "xalloc.h"
+#include <stdio.h>
 #include <string.h>
 
 // ============================================================================
@@ -458,6 +459,68 @@ CTEST(test_shift_too_many_returns_false)
     positional_params_destroy(&params);
 }
 
+CTEST(test_shift_one_at_a_time_through_many)
+{
+    const int n = 1000;
+    char buf[16];
+    string_t **args = xcalloc((size_t)n, sizeof(string_t *));
+    for (int i = 0; i < n; i++)
+    {
+        snprintf(buf, sizeof buf, "p%d", i + 1);
+        args[i] = string_create_from_cstr(buf);
+    }
+
+    positional_params_t *params = positional_params_create();
+    positional_params_replace(params, args, n);
+
+    // Shifting past the compaction points must keep every later parameter
+    bool ok = true;
+    for (int i = 1; i < n; i++)
+    {
+        ok = ok && positional_params_shift(params, 1);
+        snprintf(buf, sizeof buf, "p%d", i + 1);
+        ok = ok && positional_params_count(params) == n - i;
+        ok = ok && strcmp(string_cstr(positional_params_get(params, 1)), buf) == 0;
+        ok = ok && strcmp(string_cstr(positional_params_get(params, n - i)), "p1000") == 0;
+    }
+    CTEST_ASSERT_TRUE(ctest, ok, "each shift leaves the right $1 and $#");
+
+    CTEST_ASSERT_TRUE(ctest, positional_params_shift(params, 1), "last shift succeeded");
+    CTEST_ASSERT_EQ(ctest, 0, positional_params_count(params), "count is 0");
+
+    positional_params_destroy(&params);
+}
+
+CTEST(test_view_borrows_parameters_after_shift)
+{
+    string_t *args[3];
+    args[0] = string_create_from_cstr("a");
+    args[1] = string_create_from_cstr("b c");
+    args[2] = string_create_from_cstr("");
+
+    string_t *arg0 = string_create_from_cstr("miga");
+    positional_params_t *params = positional_params_create_from_array(arg0, 3, (const string_t **)args);
+    string_destroy(&arg0);
+    for (int i = 0; i < 3; i++)
+        string_destroy(&args[i]);
+
+    positional_params_shift(params, 1);
+
+    int count = -1;
+    const string_t *const *view = positional_params_view(params, &count);
+    CTEST_ASSERT_EQ(ctest, 2, count, "view count is 2");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(view[0]), "b c", "view[0] is $1");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(view[1]), "", "view[1] is $2");
+    CTEST_ASSERT_TRUE(ctest, view[0] == positional_params_get(params, 1), "view is not a copy");
+
+    positional_params_shift(params, 2);
+    view = positional_params_view(params, &count);
+    CTEST_ASSERT_EQ(ctest, 0, count, "empty view count is 0");
+    CTEST_ASSERT_NULL(ctest, view, "empty view is NULL");
+
+    positional_params_destroy(&params);
+}
+
 // ============================================================================
 // Configuration Tests
 // ============================================================================
@@ -620,6 +683,8 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_shift_all_parameters),
         CTEST_ENTRY(test_shift_zero_is_noop),
         CTEST_ENTRY(test_shift_too_many_returns_false),
+        CTEST_ENTRY(test_shift_one_at_a_time_through_many),
+        CTEST_ENTRY(test_view_borrows_parameters_after_shift),
 
         /* Configuration */
         CTEST_ENTRY(test_get_max_returns_default_limit),
@@ -0,0 +1,143 @@
+/**
+ * @file test_printf_format_ctest.c
+ * @brief Unit tests for compiled printf formats (printf_format.c)
+ */
+
+#include <string.h>
+#include "ctest.h"
+#include "printf_format.h"
+#include "miga/string_t.h"
+#include "miga/strlist.h"
+#include "xalloc.h"
+
+/* Render `format` with argv-style arguments (argv[0] is the format itself) */
+static string_t *render(const char *format, const char **argv, int argc, int *err)
+{
+    printf_format_t *fmt = printf_format_compile(format);
+    strlist_t *args = strlist_create_from_cstr_array(argv, argc);
+    printf_buffer_t buf = {0};
+    *err = printf_format_render(fmt, args, 1, &buf);
+    string_t *out = string_create();
+    string_append_data(out, buf.data, buf.len);
+    printf_buffer_free(&buf);
+    strlist_destroy(&args);
+    printf_format_destroy(&fmt);
+    return out;
+}
+
+CTEST(test_printf_format_literals_and_escapes)
+{
+    const char *argv[] = {"f"};
+    int err = 0;
+    string_t *out = render("a\\tb\\n100%%", argv, 1, &err);
+    CTEST_ASSERT_EQ(ctest, err, 0, "no error");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "a\tb\n100%", "escapes decoded");
+    string_destroy(&out);
+}
+
+CTEST(test_printf_format_conversions)
+{
+    const char *argv[] = {"f", "hi", "ok", "42", "255", "8"};
+    int err = 0;
+    string_t *out = render("[%5s|%-4s|%05d|%x|%o]", argv, 6, &err);
+    CTEST_ASSERT_EQ(ctest, err, 0, "no error");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "[   hi|ok  |00042|ff|10]", "conversions");
+    string_destroy(&out);
+}
+
+CTEST(test_printf_format_reuse)
+{
+    const char *argv[] = {"f", "a", "b", "c"};
+    int err = 0;
+    string_t *out = render("%s,", argv, 4, &err);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "a,b,c,", "format reused for extra arguments");
+    string_destroy(&out);
+
+    out = render("%s=%s;", argv, 4, &err);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "a=b;c=;", "missing arguments are empty");
+    string_destroy(&out);
+}
+
+CTEST(test_printf_format_stop)
+{
+    const char *argv[] = {"f", "x\\cy", "z"};
+    int err = 0;
+    string_t *out = render("%b-%s", argv, 3, &err);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "x", "\\c in %b stops output");
+    string_destroy(&out);
+
+    out = render("one\\ctwo", argv, 1, &err);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "one", "\\c in the format stops output");
+    string_destroy(&out);
+}
+
+CTEST(test_printf_format_nul)
+{
+    const char *argv[] = {"f", "Z", ""};
+    printf_format_t *fmt = printf_format_compile("a\\0bc%sde|%c|");
+    strlist_t *args = strlist_create_from_cstr_array(argv, 3);
+    printf_buffer_t out = {0};
+    CTEST_ASSERT_EQ(ctest, printf_format_render(fmt, args, 1, &out), 0, "no error");
+    CTEST_ASSERT_EQ(ctest, out.len, 10, "NUL bytes kept");
+    CTEST_ASSERT_TRUE(ctest, memcmp(out.data, "a\0bcZde|\0|", 10) == 0, "output bytes");
+    printf_buffer_free(&out);
+    strlist_destroy(&args);
+    printf_format_destroy(&fmt);
+}
+
+CTEST(test_printf_format_invalid)
+{
+    const char *argv[] = {"f", "1"};
+    int err = 0;
+    string_t *out = render("ab%q", argv, 2, &err);
+    CTEST_ASSERT_EQ(ctest, err, 1, "invalid conversion reported");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "ab%q", "output up to the bad directive");
+    string_destroy(&out);
+}
+
+CTEST(test_printf_format_cache_lru)
+{
+    printf_format_cache_t *cache = printf_format_cache_create();
+    const printf_format_t *f1 = printf_format_cache_get(cache, "%s\\n");
+    const printf_format_t *f2 = printf_format_cache_get(cache, "%s\\n");
+    CTEST_ASSERT_TRUE(ctest, f1 == f2, "same format returns the cached entry");
+    CTEST_ASSERT_EQ(ctest, printf_format_cache_hits(cache), 1, "one hit");
+    CTEST_ASSERT_EQ(ctest, printf_format_cache_misses(cache), 1, "one miss");
+
+    /* Fill the cache past capacity while keeping the first format hot */
+    char buf[32];
+    for (int i = 0; i < 40; i++)
+    {
+        snprintf(buf, sizeof(buf), "%%d-%d", i);
+        printf_format_cache_get(cache, buf);
+        printf_format_cache_get(cache, "%s\\n");
+    }
+    int misses = printf_format_cache_misses(cache);
+    printf_format_cache_get(cache, "%s\\n");
+    CTEST_ASSERT_EQ(ctest, printf_format_cache_misses(cache), misses,
+                    "recently used format survives eviction");
+
+    printf_format_cache_destroy(&cache);
+    CTEST_ASSERT_NULL(ctest, cache, "cache pointer null after destroy");
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_printf_format_literals_and_escapes),
+        CTEST_ENTRY(test_printf_format_conversions),
+        CTEST_ENTRY(test_printf_format_reuse),
+        CTEST_ENTRY(test_printf_format_stop),
+        CTEST_ENTRY(test_printf_format_nul),
+        CTEST_ENTRY(test_printf_format_invalid),
+        CTEST_ENTRY(test_printf_format_cache_lru),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    return result;
+}
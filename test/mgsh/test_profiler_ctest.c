@@ -0,0 +1,188 @@
+// ============================================================================
+// test_profiler_ctest.c
+// Unit tests for the script profiler: self time and folded-stack output
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "profiler.h"
+#include "xalloc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef MIGA_POSIX_API
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#define SPIN_NS 5000000u // 5 ms
+
+// Busy-wait so the time lands on whatever frame is current
+static void spin(uint64_t ns)
+{
+    uint64_t end = profiler_wall_clock_ns() + ns;
+    while (profiler_wall_clock_ns() < end)
+        ;
+}
+
+// Read a whole file into a NUL-terminated buffer; the caller frees it
+static char *slurp(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return NULL;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    char *text = calloc(1, (size_t)size + 1);
+    if (fread(text, 1, (size_t)size, fp) != (size_t)size)
+        text[0] = '\0';
+    fclose(fp);
+    return text;
+}
+
+CTEST(test_profiler_nested_self_time)
+{
+    uint64_t start = profiler_wall_clock_ns();
+    profiler_t *prof = profiler_create("unused.folded");
+
+    profiler_enter(prof, PROFILER_BUILTIN, "eval");
+    spin(SPIN_NS);
+    profiler_enter(prof, PROFILER_FORK, NULL);
+    spin(2 * SPIN_NS);
+    profiler_enter(prof, PROFILER_WAIT, NULL);
+    spin(SPIN_NS);
+    profiler_leave(prof);
+    profiler_leave(prof);
+    spin(SPIN_NS);
+    profiler_leave(prof);
+
+    uint64_t builtin = profiler_category_wall_ns(prof, PROFILER_BUILTIN);
+    uint64_t fork = profiler_category_wall_ns(prof, PROFILER_FORK);
+    uint64_t wait = profiler_category_wall_ns(prof, PROFILER_WAIT);
+    uint64_t total = profiler_total_wall_ns(prof);
+    uint64_t elapsed = profiler_wall_clock_ns() - start;
+
+    // A frame's time stops while a nested frame is open, so the builtin
+    // gets its own 2 spins and none of the 3 spent below it
+    CTEST_ASSERT_TRUE(ctest, builtin >= 2 * SPIN_NS, "builtin self time");
+    CTEST_ASSERT_TRUE(ctest, builtin < 5 * SPIN_NS, "builtin excludes nested frames");
+    CTEST_ASSERT_TRUE(ctest, fork >= 2 * SPIN_NS, "fork self time");
+    CTEST_ASSERT_TRUE(ctest, fork < 3 * SPIN_NS, "fork excludes the wait");
+    CTEST_ASSERT_TRUE(ctest, wait >= SPIN_NS, "wait self time");
+
+    // Every nanosecond is charged once: the total is no more than the
+    // time that actually passed
+    CTEST_ASSERT_EQ(ctest, total,
+                    builtin + fork + wait + profiler_category_wall_ns(prof, PROFILER_SHELL) +
+                        profiler_category_wall_ns(prof, PROFILER_EXPAND),
+                    "total is the sum of the categories");
+    CTEST_ASSERT_TRUE(ctest, total <= elapsed, "nothing counted twice");
+    CTEST_ASSERT_TRUE(ctest, total >= 5 * SPIN_NS, "nothing dropped");
+
+    profiler_destroy(&prof);
+    CTEST_ASSERT_NULL(ctest, prof, "destroy clears the pointer");
+}
+
+CTEST(test_profiler_function_frames)
+{
+    profiler_t *prof = profiler_create("unused.folded");
+
+    profiler_set_line(prof, "script.sh", 1);
+    profiler_push_function(prof, "build");
+    profiler_set_line(prof, "script.sh", 7);
+    spin(SPIN_NS);
+    profiler_pop_function(prof);
+
+    // Function frames are shell time; popping one past the bottom is ignored
+    profiler_pop_function(prof);
+    CTEST_ASSERT_TRUE(ctest, profiler_category_wall_ns(prof, PROFILER_SHELL) >= SPIN_NS,
+                      "function body is shell time");
+    CTEST_ASSERT_EQ(ctest, profiler_category_wall_ns(prof, PROFILER_BUILTIN), (uint64_t)0,
+                    "no builtin time");
+
+    profiler_destroy(&prof);
+}
+
+#ifdef MIGA_POSIX_API
+
+CTEST(test_profiler_write_folded_stacks)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "test_profiler_%ld.folded", (long)getpid());
+    char lines_path[80];
+    snprintf(lines_path, sizeof(lines_path), "%s.lines", path);
+
+    profiler_t *prof = profiler_create(path);
+    profiler_set_line(prof, "script.sh", 3);
+    profiler_push_function(prof, "build");
+    profiler_enter(prof, PROFILER_BUILTIN, "echo");
+    spin(SPIN_NS);
+    profiler_leave(prof);
+    profiler_enter(prof, PROFILER_WAIT, NULL);
+    spin(SPIN_NS);
+    profiler_leave(prof);
+    profiler_pop_function(prof);
+
+    CTEST_ASSERT_TRUE(ctest, profiler_write(prof), "profile written");
+
+    char *folded = slurp(path);
+    CTEST_ASSERT_NOT_NULL(ctest, folded, "folded file exists");
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(folded, "main;build;[builtin:echo] "),
+                          "builtin frame under the function");
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(folded, "main;build;[wait] "), "wait frame");
+
+    // Each line is "stack count" with the count in microseconds
+    unsigned long long us = 0;
+    const char *line = strstr(folded, "main;build;[wait] ");
+    CTEST_ASSERT_EQ(ctest, sscanf(line, "main;build;[wait] %llu", &us), 1, "count parses");
+    CTEST_ASSERT_TRUE(ctest, us >= SPIN_NS / 1000u, "count is the self time in us");
+    free(folded);
+
+    char *lines = slurp(lines_path);
+    CTEST_ASSERT_NOT_NULL(ctest, lines, "line file exists");
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(lines, "script.sh:3"), "caller line listed");
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(lines, "  builtin"), "category totals listed");
+    free(lines);
+
+    // A forked child that inherits the profiler must not overwrite it
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(profiler_write(prof) ? 1 : 0);
+    int status = -1;
+    waitpid(pid, &status, 0);
+    CTEST_ASSERT_TRUE(ctest, WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                      "child does not write");
+
+    profiler_destroy(&prof);
+    remove(path);
+    remove(lines_path);
+}
+
+#endif
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_profiler_nested_self_time),
+        CTEST_ENTRY(test_profiler_function_frames),
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_profiler_write_folded_stacks),
+#endif
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
@@ -0,0 +1,126 @@
+// ============================================================================
+// test_program_ctest.c
+// Unit tests for compile-once / run-many programs
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+#include "test_exec_helpers.h"
+#include "xalloc.h"
+
+CTEST(test_program_runs_many_times)
+{
+    miga_exec_t *executor = create_executor();
+    miga_program_t *program = exec_compile_cstr(executor, "n=${n:-0}\nn=$((n+1))\n");
+    CTEST_ASSERT_NOT_NULL(ctest, program, "program compiled");
+
+    for (int i = 0; i < 3; i++)
+    {
+        miga_exec_result_t result = exec_run_program(executor, program);
+        CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "program ran");
+    }
+    ASSERT_VARIABLE(executor, "n", "3");
+
+    miga_program_free(&program);
+    CTEST_ASSERT_NULL(ctest, program, "program freed");
+    exec_destroy(&executor);
+}
+
+CTEST(test_program_shared_between_executors)
+{
+    miga_exec_t *first = create_executor();
+    miga_exec_t *second = create_executor();
+    miga_program_t *program = exec_compile_cstr(first, "n=${n:-0}; n=$((n+1)); f() { m=$n; }; f");
+    CTEST_ASSERT_NOT_NULL(ctest, program, "program compiled");
+
+    exec_run_program(first, program);
+    exec_run_program(first, program);
+    exec_run_program(second, program);
+    ASSERT_VARIABLE(first, "m", "2");
+    ASSERT_VARIABLE(second, "m", "1");
+
+    // Freeing the program leaves the functions it defined intact
+    miga_program_free(&program);
+    exec_execute_command_string(second, "n=5; f");
+    ASSERT_VARIABLE(second, "m", "5");
+
+    exec_destroy(&first);
+    exec_destroy(&second);
+}
+
+CTEST(test_program_exit_status)
+{
+    miga_exec_t *executor = create_executor();
+    miga_program_t *program = exec_compile_cstr(executor, "false");
+    miga_exec_result_t result = exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "program ran");
+    CTEST_ASSERT_EQ(ctest, result.exit_code, 1, "exit status of false");
+    miga_program_free(&program);
+
+    program = exec_compile_cstr(executor, "(exit 7)");
+    result = exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "program ran");
+    CTEST_ASSERT_EQ(ctest, result.exit_code, 7, "exit status of the subshell");
+    miga_program_free(&program);
+    exec_destroy(&executor);
+}
+
+CTEST(test_program_aliases_frozen_at_compile_time)
+{
+    miga_exec_t *executor = create_executor();
+    exec_execute_command_string(executor, "alias setit='v=compiled'");
+    miga_program_t *program = exec_compile_cstr(executor, "setit\n");
+    CTEST_ASSERT_NOT_NULL(ctest, program, "program compiled");
+
+    exec_execute_command_string(executor, "alias setit='v=changed'");
+    exec_run_program(executor, program);
+    ASSERT_VARIABLE(executor, "v", "compiled");
+
+    miga_program_free(&program);
+    exec_destroy(&executor);
+}
+
+CTEST(test_program_empty_and_incomplete)
+{
+    miga_exec_t *executor = create_executor();
+
+    miga_program_t *program = exec_compile_cstr(executor, "# nothing here\n");
+    CTEST_ASSERT_NOT_NULL(ctest, program, "empty text compiles");
+    miga_exec_result_t result = exec_run_program(executor, program);
+    CTEST_ASSERT_EQ(ctest, result.status, MIGA_EXEC_STATUS_OK, "empty program runs");
+    CTEST_ASSERT_EQ(ctest, result.exit_code, 0, "empty program succeeds");
+    miga_program_free(&program);
+
+    program = exec_compile_cstr(executor, "if true; then\n");
+    CTEST_ASSERT_NULL(ctest, program, "incomplete text does not compile");
+    CTEST_ASSERT_NOT_NULL(ctest, exec_get_error_cstr(executor), "error reported");
+
+    miga_program_free(&program);
+    exec_destroy(&executor);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_program_runs_many_times),
+        CTEST_ENTRY(test_program_shared_between_executors),
+        CTEST_ENTRY(test_program_exit_status),
+        CTEST_ENTRY(test_program_aliases_frozen_at_compile_time),
+        CTEST_ENTRY(test_program_empty_and_incomplete),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file test_prompt_ctest.c
+ * @brief Unit tests for parsed and cached prompts (prompt.c)
+ */
+
+#include "ctest.h"
+#include "prompt.h"
+#include "miga/string_t.h"
+#include "variable_store.h"
+#include "xalloc.h"
+
+static const prompt_params_t default_params = {
+    .exit_status = 0, .shell_pid = 1234, .shell_pid_valid = true};
+
+/* Render a PS1 value once with a fresh cache */
+static string_t *render_ps1(variable_store_t *vars, const char *ps1,
+                            const prompt_params_t *params)
+{
+    variable_store_add_cstr(vars, "PS1", ps1, false, false);
+    prompt_cache_t *cache = prompt_cache_create("PS1", "$ ", true);
+    string_t *out = string_create_from(prompt_cache_render(cache, vars, params));
+    prompt_cache_destroy(&cache);
+    return out;
+}
+
+CTEST(test_prompt_expansion)
+{
+    variable_store_t *vars = variable_store_create();
+    variable_store_add_cstr(vars, "USER", "me", false, false);
+    variable_store_add_cstr(vars, "host", "box", false, false);
+    prompt_params_t params = default_params;
+    params.exit_status = 3;
+
+    string_t *out = render_ps1(vars, "$USER@${host}[$?:$$]\\$ ", &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "me@box[3:1234]\\$ ", "parameters expanded");
+    string_destroy(&out);
+
+    out = render_ps1(vars, "$NOPE ${NOPE} ${ $", &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "$NOPE ${NOPE} ${ $", "unset copied literally");
+    string_destroy(&out);
+
+    params.shell_pid_valid = false;
+    out = render_ps1(vars, "$$", &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "$$", "unknown PID copied literally");
+    string_destroy(&out);
+
+    variable_store_destroy(&vars);
+}
+
+CTEST(test_prompt_escapes)
+{
+    variable_store_t *vars = variable_store_create();
+
+    string_t *out = render_ps1(vars, "a\\tb\\n\\x41\\u00e9\\U01F600\\q\\x4", &default_params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "a\tb\nA\xc3\xa9\xf0\x9f\x98\x80\\q\\x4",
+                        "escapes decoded");
+    string_destroy(&out);
+
+    variable_store_destroy(&vars);
+}
+
+CTEST(test_prompt_defaults)
+{
+    variable_store_t *vars = variable_store_create();
+    prompt_cache_t *ps1 = prompt_cache_create("PS1", "$ ", true);
+    prompt_cache_t *ps2 = prompt_cache_create("PS2", "> ", false);
+
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(prompt_cache_render(ps1, vars, &default_params)),
+                        "$ ", "unset PS1");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(prompt_cache_render(ps2, vars, &default_params)),
+                        "> ", "unset PS2");
+
+    variable_store_add_cstr(vars, "PS1", "", false, false);
+    variable_store_add_cstr(vars, "PS2", "", false, false);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(prompt_cache_render(ps1, vars, &default_params)),
+                        "", "empty PS1 is shown");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(prompt_cache_render(ps2, vars, &default_params)),
+                        "> ", "empty PS2 uses the default");
+
+    variable_store_add_cstr(vars, "PS2", "$HOME> ", false, false);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(prompt_cache_render(ps2, vars, &default_params)),
+                        "$HOME> ", "PS2 is not expanded");
+
+    prompt_cache_destroy(&ps1);
+    prompt_cache_destroy(&ps2);
+    CTEST_ASSERT_NULL(ctest, ps1, "cache pointer null after destroy");
+    variable_store_destroy(&vars);
+}
+
+CTEST(test_prompt_cache_reuse)
+{
+    variable_store_t *vars = variable_store_create();
+    variable_store_add_cstr(vars, "PS1", "$PWD $ ", false, false);
+    variable_store_add_cstr(vars, "PWD", "/a", false, false);
+    prompt_cache_t *cache = prompt_cache_create("PS1", "$ ", true);
+    prompt_params_t params = default_params;
+
+    prompt_cache_render(cache, vars, &params);
+    params.exit_status = 1; /* not used by this prompt */
+    const string_t *out = prompt_cache_render(cache, vars, &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "/a $ ", "first rendering");
+    CTEST_ASSERT_EQ(ctest, prompt_cache_hits(cache), 1, "unchanged prompt reused");
+
+    variable_store_add_cstr(vars, "PWD", "/b", false, false);
+    out = prompt_cache_render(cache, vars, &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "/b $ ", "changed variable seen");
+    CTEST_ASSERT_EQ(ctest, prompt_cache_parses(cache), 1, "same PS1 not parsed again");
+
+    variable_store_add_cstr(vars, "PS1", "[$?] ", false, false);
+    out = prompt_cache_render(cache, vars, &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "[1] ", "new PS1 used");
+    CTEST_ASSERT_EQ(ctest, prompt_cache_parses(cache), 2, "new PS1 parsed");
+
+    params.exit_status = 2;
+    out = prompt_cache_render(cache, vars, &params);
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(out), "[2] ", "changed exit status seen");
+    CTEST_ASSERT_EQ(ctest, prompt_cache_hits(cache), 1, "exit status is an input");
+
+    prompt_cache_destroy(&cache);
+    variable_store_destroy(&vars);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_prompt_expansion),
+        CTEST_ENTRY(test_prompt_escapes),
+        CTEST_ENTRY(test_prompt_defaults),
+        CTEST_ENTRY(test_prompt_cache_reuse),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    return result;
+}
@@ -0,0 +1,155 @@
+// ============================================================================
+// test_shell_worker_ctest.c
+// Unit tests for the batch worker protocol (mgsh --worker)
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "shell_worker.h"
+#include "xalloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Feed INPUT (LEN bytes, NULs included) to a fresh worker and return what it
+// wrote as a NUL-terminated string; the caller frees it.
+static char *run_worker(const char *input, size_t len, sh_status_t *status)
+{
+    miga_exec_t *executor = exec_create();
+    exec_set_shell_name_cstr(executor, "mgsh");
+    exec_setup_noninteractive(executor);
+
+    FILE *in = fmemopen((void *)input, len, "r");
+    FILE *out = tmpfile();
+    *status = shell_worker_run(executor, in, out);
+    fclose(in);
+
+    long size = ftell(out);
+    char *result = calloc(1, (size_t)size + 1);
+    rewind(out);
+    if (fread(result, 1, (size_t)size, out) != (size_t)size)
+        result[0] = '\0';
+    fclose(out);
+
+    exec_destroy(&executor);
+    return result;
+}
+
+#define RUN_WORKER(input, status) run_worker((input), sizeof(input) - 1, (status))
+
+CTEST(test_shell_worker_fields)
+{
+    static const char input[] = "c:echo \"$0 $1 $2 $FOO\"; echo \"$PWD\"; echo oops >&2; exit 3\0"
+                                "n:job\0"
+                                "a:x\0"
+                                "a:y\0"
+                                "e:FOO=bar\0"
+                                "d:/\0"
+                                "\0";
+    sh_status_t status;
+    char *got = RUN_WORKER(input, &status);
+    CTEST_ASSERT_EQ(ctest, status, SH_OK, "worker finished");
+    CTEST_ASSERT_STR_EQ(ctest, got, "3 14 5\njob x y bar\n/\noops\n", "status and output");
+    free(got);
+}
+
+CTEST(test_shell_worker_jobs_are_isolated)
+{
+    static const char input[] = "c:export X=1; echo \"${X:-unset}\"\0"
+                                "d:/\0"
+                                "\0"
+                                "c:echo \"${X:-unset}\"; [ \"$PWD\" != / ]\0"
+                                "\0";
+    sh_status_t status;
+    char *got = RUN_WORKER(input, &status);
+    CTEST_ASSERT_STR_EQ(ctest, got, "0 2 0\n1\n0 6 0\nunset\n", "second job sees neither");
+    free(got);
+}
+
+CTEST(test_shell_worker_malformed)
+{
+    static const char input[] = "zzz\0"
+                                "c:true\0"
+                                "\0"
+                                "e:=bad\0"
+                                "c:true\0"
+                                "\0"
+                                "c:true\0"
+                                "c:false\0"
+                                "\0"
+                                "a:x\0"
+                                "\0"
+                                "q:1\0"
+                                "c:true\0"
+                                "\0"
+                                "c:echo still running\0"
+                                "\0";
+    sh_status_t status;
+    char *got = RUN_WORKER(input, &status);
+    CTEST_ASSERT_EQ(ctest, status, SH_OK, "worker survived bad jobs");
+    CTEST_ASSERT_STR_EQ(ctest, got,
+                        "2 0 21\nmalformed field: zzz\n"
+                        "2 0 28\nexpected NAME=VALUE: e:=bad\n"
+                        "2 0 27\nfield given twice: c:false\n"
+                        "2 0 37\na job needs exactly one of c: and f:\n"
+                        "2 0 19\nunknown field: q:1\n"
+                        "0 14 0\nstill running\n",
+                        "each bad job reported with status 2");
+    free(got);
+}
+
+CTEST(test_shell_worker_exit_status)
+{
+    static const char input[] = "c:exit 300\0"
+                                "\0"
+                                "c:kill -9 $$\0"
+                                "\0"
+                                "f:/nonexistent/script.sh\0"
+                                "\0"
+                                "c:true\0";
+    sh_status_t status;
+    char *got = RUN_WORKER(input, &status);
+    CTEST_ASSERT_EQ(ctest, status, SH_OK, "input ended");
+
+    int exit_status = -1, killed_status = -1, missing_status = -1;
+    char *line = got;
+    CTEST_ASSERT_EQ(ctest, sscanf(line, "%d 0 0\n", &exit_status), 1, "first result");
+    CTEST_ASSERT_EQ(ctest, exit_status, 300 & 0xFF, "exit status truncated to a byte");
+    line = strchr(line, '\n') + 1;
+    CTEST_ASSERT_EQ(ctest, sscanf(line, "%d 0 0\n", &killed_status), 1, "second result");
+    CTEST_ASSERT_EQ(ctest, killed_status, 128 + 9, "killed job reports 128 plus the signal");
+    line = strchr(line, '\n') + 1;
+    CTEST_ASSERT_EQ(ctest, sscanf(line, "%d 0", &missing_status), 1, "third result");
+    CTEST_ASSERT_EQ(ctest, missing_status, 127, "missing script file");
+
+    // A job cut short by the end of the input is reported, not run
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(line, "2 0 25\ninput ended inside a job\n"),
+                          "unterminated job");
+    free(got);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+#ifdef MIGA_POSIX_API
+        CTEST_ENTRY(test_shell_worker_fields),
+        CTEST_ENTRY(test_shell_worker_jobs_are_isolated),
+        CTEST_ENTRY(test_shell_worker_malformed),
+        CTEST_ENTRY(test_shell_worker_exit_status),
+#endif
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
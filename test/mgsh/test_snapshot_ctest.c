@@ -0,0 +1,122 @@
+// ============================================================================
+// test_snapshot_ctest.c
+// Unit tests for executor snapshots and clones
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "miga/exec.h"
+#include "miga/frame.h"
+#include "miga/string_t.h"
+#include "test_exec_helpers.h"
+#include "xalloc.h"
+
+// An executor with a variable, a function, an alias, an option and a trap set up
+static miga_snapshot_t *create_snapshot(void)
+{
+    miga_exec_t *executor = create_executor();
+    exec_execute_command_string(executor, "x=base; f() { y=$x; }; alias a='z=aliased'; set -f\n"
+                                          "trap 'echo bye' USR1");
+    miga_snapshot_t *snapshot = exec_snapshot(executor);
+    exec_destroy(&executor);
+    return snapshot;
+}
+
+CTEST(test_snapshot_clone_has_state)
+{
+    miga_snapshot_t *snapshot = create_snapshot();
+    CTEST_ASSERT_NOT_NULL(ctest, snapshot, "snapshot taken");
+
+    miga_exec_t *clone = exec_clone_from_snapshot(snapshot);
+    CTEST_ASSERT_NOT_NULL(ctest, clone, "clone created");
+    exec_execute_command_string(clone, "f\na\ncase $- in *f*) o=set;; esac\n"
+                                       "t=$(trap -p USR1)");
+    ASSERT_VARIABLE(clone, "y", "base");
+    ASSERT_VARIABLE(clone, "z", "aliased");
+    ASSERT_VARIABLE(clone, "o", "set");
+    ASSERT_VARIABLE(clone, "t", "trap -- 'echo bye' USR1");
+
+    exec_destroy(&clone);
+    exec_snapshot_destroy(&snapshot);
+    CTEST_ASSERT_NULL(ctest, snapshot, "snapshot destroyed");
+}
+
+CTEST(test_snapshot_clones_are_isolated)
+{
+    miga_snapshot_t *snapshot = create_snapshot();
+    miga_exec_t *first = exec_clone_from_snapshot(snapshot);
+    miga_exec_t *second = exec_clone_from_snapshot(snapshot);
+
+    exec_execute_command_string(first, "x=changed; f() { y=redefined; }; unalias a; set +f");
+    exec_execute_command_string(second, "f; a; case $- in *f*) o=set;; esac");
+    ASSERT_VARIABLE(second, "y", "base");
+    ASSERT_VARIABLE(second, "z", "aliased");
+    ASSERT_VARIABLE(second, "o", "set");
+
+    // A clone taken after the others changed theirs still starts from the snapshot
+    miga_exec_t *third = exec_clone_from_snapshot(snapshot);
+    exec_execute_command_string(third, "f");
+    ASSERT_VARIABLE(third, "y", "base");
+
+    exec_execute_command_string(first, "f");
+    ASSERT_VARIABLE(first, "y", "redefined");
+
+    exec_destroy(&first);
+    exec_destroy(&second);
+    exec_destroy(&third);
+    exec_snapshot_destroy(&snapshot);
+}
+
+CTEST(test_snapshot_functions_outlive_snapshot)
+{
+    miga_snapshot_t *snapshot = create_snapshot();
+    miga_exec_t *clone = exec_clone_from_snapshot(snapshot);
+    exec_snapshot_destroy(&snapshot);
+
+    exec_execute_command_string(clone, "x=later; f");
+    ASSERT_VARIABLE(clone, "y", "later");
+
+    // A subshell's copy of the function store shares the bodies too
+    exec_execute_command_string(clone, "w=$(x=sub; f; echo $y)");
+    ASSERT_VARIABLE(clone, "w", "sub");
+    ASSERT_VARIABLE(clone, "y", "later");
+    exec_destroy(&clone);
+}
+
+CTEST(test_snapshot_source_executor_unchanged)
+{
+    miga_exec_t *executor = create_executor();
+    exec_execute_command_string(executor, "x=1");
+    miga_snapshot_t *snapshot = exec_snapshot(executor);
+
+    exec_execute_command_string(executor, "x=2");
+    miga_exec_t *clone = exec_clone_from_snapshot(snapshot);
+    ASSERT_VARIABLE(executor, "x", "2");
+    ASSERT_VARIABLE(clone, "x", "1");
+
+    exec_destroy(&clone);
+    exec_snapshot_destroy(&snapshot);
+    exec_destroy(&executor);
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    log_set_level(LOG_LEVEL_ERROR);
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_snapshot_clone_has_state),
+        CTEST_ENTRY(test_snapshot_clones_are_isolated),
+        CTEST_ENTRY(test_snapshot_functions_outlive_snapshot),
+        CTEST_ENTRY(test_snapshot_source_executor_unchanged),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
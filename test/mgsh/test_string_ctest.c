@@ -185,6 +185,65 @@ CTEST(test_string_find_cstr)
     string_destroy(&s);
 }
 
+CTEST(test_string_find_positions)
+{
+    string_t* s = string_create_from_cstr("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxaab-aabc");
+    CTEST_ASSERT_EQ(ctest, string_find_cstr(s, "aabc"), 36, "match after a near miss");
+    CTEST_ASSERT_EQ(ctest, string_find_cstr_at(s, "aab", 33), 36, "search from pos");
+    CTEST_ASSERT_EQ(ctest, string_find_cstr(s, "aabcd"), -1, "needle runs off the end");
+    CTEST_ASSERT_EQ(ctest, string_find_cstr(s, "c"), 39, "single character at the end");
+    CTEST_ASSERT_EQ(ctest, string_rfind_cstr(s, "aab"), 36, "rfind last match");
+    CTEST_ASSERT_EQ(ctest, string_rfind_cstr_at(s, "aab", 35), 32, "rfind before pos");
+    CTEST_ASSERT_EQ(ctest, string_rfind_cstr(s, "xxa"), 30, "rfind skips first-byte near misses");
+    CTEST_ASSERT_EQ(ctest, string_rfind_cstr_at(s, "xx", 0), 0, "rfind match at the start");
+    CTEST_ASSERT_EQ(ctest, string_rfind_cstr(s, "ba"), -1, "rfind no match");
+    CTEST_ASSERT_EQ(ctest, string_size(s), (size_t)40, "string_size is the full length");
+    string_destroy(&s);
+}
+
+CTEST(test_string_find_first_of_sets)
+{
+    string_t* s = string_create_from_cstr("  key=\xe9value;");
+    CTEST_ASSERT_EQ(ctest, string_find_first_of_cstr(s, "=;"), 5, "first of two");
+    CTEST_ASSERT_EQ(ctest, string_find_first_of_cstr(s, ";"), 12, "first of one");
+    CTEST_ASSERT_EQ(ctest, string_find_first_of_cstr(s, "\xe9"), 6, "byte above 127");
+    CTEST_ASSERT_EQ(ctest, string_find_first_not_of_cstr(s, " "), 2, "first not of");
+    CTEST_ASSERT_EQ(ctest, string_find_last_of_cstr(s, "ke"), 11, "last of");
+    CTEST_ASSERT_EQ(ctest, string_find_last_not_of_cstr(s, ";e"), 10, "last not of");
+    CTEST_ASSERT_EQ(ctest, string_find_first_of_cstr(s, "#!"), -1, "none of");
+    string_destroy(&s);
+}
+
+// ------------------------------------------------------------
+// Hash
+// ------------------------------------------------------------
+
+CTEST(test_string_hash_follows_modifications)
+{
+    string_t* a = string_create_from_cstr("PATH");
+    string_t* b = string_create_from_cstr("PATH");
+    uint32_t h = string_hash(a);
+    CTEST_ASSERT_EQ(ctest, string_hash(a), h, "repeatable");
+    CTEST_ASSERT_EQ(ctest, string_hash(b), h, "equal strings hash equal");
+
+    string_append_cstr(a, "X");
+    string_append_cstr(b, "X");
+    CTEST_ASSERT_EQ(ctest, string_hash(a), string_hash(b), "hash recomputed after append");
+    CTEST_ASSERT_TRUE(ctest, string_hash(a) != h, "hash changed");
+
+    string_data(a)[0] = 'M';
+    string_data(b)[0] = 'M';
+    CTEST_ASSERT_EQ(ctest, string_hash(a), string_hash(b), "hash recomputed after write through data");
+
+    string_t* c = string_create_from(a);
+    string_set_cstr(b, "PATH");
+    CTEST_ASSERT_EQ(ctest, string_hash(c), string_hash(a), "copy keeps hash");
+    CTEST_ASSERT_EQ(ctest, string_hash(b), h, "set resets hash");
+    string_destroy(&a);
+    string_destroy(&b);
+    string_destroy(&c);
+}
+
 // ------------------------------------------------------------
 // Compare
 // ------------------------------------------------------------
@@ -264,6 +323,9 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_string_resize_shrink),
         CTEST_ENTRY(test_string_find_basic),
         CTEST_ENTRY(test_string_find_cstr),
+        CTEST_ENTRY(test_string_find_positions),
+        CTEST_ENTRY(test_string_find_first_of_sets),
+        CTEST_ENTRY(test_string_hash_follows_modifications),
         CTEST_ENTRY(test_string_compare_equal),
         CTEST_ENTRY(test_string_compare_less),
         CTEST_ENTRY(test_string_compare_cstr),
@@ -0,0 +1,145 @@
+// ============================================================================
+// test_trace_ctest.c
+// Unit tests for the ring-buffer event trace and compiled-out logging
+// ============================================================================
+
+#include "ctest.h"
+#include "logging.h"
+#include "trace.h"
+#include "xalloc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static trace_record_t records[TRACE_BUFFER_SIZE];
+
+static int side_effects = 0;
+
+static int bump(void)
+{
+    side_effects++;
+    return side_effects;
+}
+
+CTEST(test_trace_disabled_records_nothing)
+{
+    trace_clear();
+    trace_enable(false);
+    trace_event(TRACE_EVENT_FORK, 1, 2);
+    CTEST_ASSERT_EQ(ctest, (int)trace_snapshot(records, TRACE_BUFFER_SIZE), 0, "nothing recorded");
+}
+
+CTEST(test_trace_records_in_order)
+{
+    trace_clear();
+    trace_enable(true);
+    trace_event(TRACE_EVENT_FORK, 100, 0);
+    trace_event(TRACE_EVENT_PIPE, 3, 4);
+    trace_event(TRACE_EVENT_WAIT, 100, 256);
+    trace_enable(false);
+
+    size_t n = trace_snapshot(records, TRACE_BUFFER_SIZE);
+    CTEST_ASSERT_EQ(ctest, (int)n, 3, "three records");
+    CTEST_ASSERT_EQ(ctest, (int)records[0].event, TRACE_EVENT_FORK, "first is fork");
+    CTEST_ASSERT_EQ(ctest, (int)records[1].a, 3, "pipe read fd");
+    CTEST_ASSERT_EQ(ctest, (int)records[1].b, 4, "pipe write fd");
+    CTEST_ASSERT_EQ(ctest, (int)records[2].b, 256, "wait status");
+    CTEST_ASSERT_TRUE(ctest, records[0].seq < records[2].seq, "sequence increases");
+    CTEST_ASSERT_TRUE(ctest, records[0].time_ns <= records[2].time_ns, "time is monotonic");
+}
+
+CTEST(test_trace_snapshot_limit_keeps_newest)
+{
+    trace_clear();
+    trace_enable(true);
+    for (int i = 0; i < 10; i++)
+        trace_event(TRACE_EVENT_PARSE, i, 0);
+    trace_enable(false);
+
+    size_t n = trace_snapshot(records, 4);
+    CTEST_ASSERT_EQ(ctest, (int)n, 4, "four records");
+    CTEST_ASSERT_EQ(ctest, (int)records[0].a, 6, "oldest of the newest four");
+    CTEST_ASSERT_EQ(ctest, (int)records[3].a, 9, "newest");
+}
+
+CTEST(test_trace_wraparound)
+{
+    trace_clear();
+    trace_enable(true);
+    for (int i = 0; i < TRACE_BUFFER_SIZE + 100; i++)
+        trace_event(TRACE_EVENT_FRAME_PUSH, i, 0);
+    trace_enable(false);
+
+    size_t n = trace_snapshot(records, TRACE_BUFFER_SIZE);
+    CTEST_ASSERT_EQ(ctest, (int)n, TRACE_BUFFER_SIZE, "buffer full");
+    CTEST_ASSERT_EQ(ctest, (int)records[0].a, 100, "oldest records overwritten");
+    CTEST_ASSERT_EQ(ctest, (int)records[n - 1].a, TRACE_BUFFER_SIZE + 99, "newest kept");
+}
+
+CTEST(test_trace_clear)
+{
+    trace_enable(true);
+    trace_event(TRACE_EVENT_HEREDOC, 0, 12);
+    trace_enable(false);
+    trace_clear();
+    CTEST_ASSERT_EQ(ctest, (int)trace_snapshot(records, TRACE_BUFFER_SIZE), 0, "cleared");
+}
+
+CTEST(test_trace_event_names)
+{
+    CTEST_ASSERT_STR_EQ(ctest, trace_event_name(TRACE_EVENT_FORK), "fork", "fork");
+    CTEST_ASSERT_STR_EQ(ctest, trace_event_name(TRACE_EVENT_CMD_SUBST), "cmd-subst", "cmd-subst");
+    CTEST_ASSERT_STR_EQ(ctest, trace_event_name(TRACE_EVENT_COUNT), "unknown", "out of range");
+}
+
+CTEST(test_trace_dump_format)
+{
+    trace_clear();
+    trace_enable(true);
+    trace_event(TRACE_EVENT_CMD_SUBST, 42, 7);
+    trace_enable(false);
+
+    FILE *fp = tmpfile();
+    CTEST_ASSERT_NOT_NULL(ctest, fp, "tmpfile");
+    trace_dump(fp);
+    rewind(fp);
+    char line[128] = {0};
+    CTEST_ASSERT_NOT_NULL(ctest, fgets(line, sizeof line, fp), "one line");
+    fclose(fp);
+    CTEST_ASSERT_TRUE(ctest, strncmp(line, "1 ", 2) == 0, "sequence first");
+    CTEST_ASSERT_NOT_NULL(ctest, strstr(line, " cmd-subst 42 7\n"), "event and arguments");
+}
+
+CTEST(test_log_disabled_skips_arguments)
+{
+    log_set_level(LOG_LEVEL_ERROR);
+    side_effects = 0;
+    log_debug("value %d", bump());
+    log_warn("value %d", bump());
+    CTEST_ASSERT_EQ(ctest, side_effects, 0, "arguments not evaluated below threshold");
+}
+
+int main(int argc, const char *argv[])
+{
+    (void)argc;
+    (void)argv;
+    miga_setjmp();
+
+    CTestEntry *suite[] = {
+        CTEST_ENTRY(test_trace_disabled_records_nothing),
+        CTEST_ENTRY(test_trace_records_in_order),
+        CTEST_ENTRY(test_trace_snapshot_limit_keeps_newest),
+        CTEST_ENTRY(test_trace_wraparound),
+        CTEST_ENTRY(test_trace_clear),
+        CTEST_ENTRY(test_trace_event_names),
+        CTEST_ENTRY(test_trace_dump_format),
+        CTEST_ENTRY(test_log_disabled_skips_arguments),
+        NULL
+    };
+
+    int result = ctest_run_suite(suite);
+
+    miga_arena_end();
+
+    return result;
+}
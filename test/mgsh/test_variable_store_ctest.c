@@ -3,6 +3,7 @@
  * @brief Unit tests for variable store (variable_store.c)
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "ctest.h"
 #include "variable_store.h"
@@ -18,7 +19,9 @@ CTEST(test_variable_store_create)
     variable_store_t *store = variable_store_create();
     CTEST_ASSERT_NOT_NULL(ctest, store, "store created");
     CTEST_ASSERT_NOT_NULL(ctest, store->map, "store map created");
-    CTEST_ASSERT_EQ(ctest, store->generation, 0, "initial generation is 0");
+    variable_store_t *other = variable_store_create();
+    CTEST_ASSERT_NE(ctest, store->generation, other->generation, "stores never share a generation");
+    variable_store_destroy(&other);
     variable_store_destroy(&store);
     CTEST_ASSERT_NULL(ctest, store, "store is null after destroy");
 }
@@ -228,11 +231,12 @@ CTEST(test_variable_store_get_variable_entry)
 
     variable_store_add_cstr(store, "VAR", "value", true, false);
 
-    const variable_map_entry_t *entry = variable_store_get_variable_cstr(store, "VAR");
-    CTEST_ASSERT_NOT_NULL(ctest, entry, "entry found");
-    CTEST_ASSERT_STR_EQ(ctest, string_cstr(entry->mapped.value), "value", "value in entry");
-    CTEST_ASSERT_TRUE(ctest, entry->mapped.exported, "exported flag in entry");
-    CTEST_ASSERT_FALSE(ctest, entry->mapped.read_only, "read_only flag in entry");
+    variable_view_t view;
+    bool found = variable_store_get_variable_cstr(store, "VAR", &view);
+    CTEST_ASSERT_TRUE(ctest, found, "entry found");
+    CTEST_ASSERT_STR_EQ(ctest, string_cstr(view.value), "value", "value in entry");
+    CTEST_ASSERT_TRUE(ctest, view.exported, "exported flag in entry");
+    CTEST_ASSERT_FALSE(ctest, view.read_only, "read_only flag in entry");
 
     variable_store_destroy(&store);
 }
@@ -551,6 +555,64 @@ CTEST(test_variable_store_create_from_envp_with_equals_in_value)
     variable_store_destroy(&store);
 }
 
+CTEST(test_variable_store_create_from_envp_lazy)
+{
+    char *test_envp[] = {
+        "KEEP=kept",
+        "DUP=first",
+        "CHANGE=old",
+        "DUP=second",
+        "GONE=soon",
+        NULL
+    };
+
+    variable_store_t *store = variable_store_create_from_envp(test_envp);
+
+    CTEST_ASSERT_STR_EQ(ctest, variable_store_get_value_cstr(store, "DUP"), "second", "last duplicate wins");
+    CTEST_ASSERT_TRUE(ctest, variable_store_is_exported_cstr(store, "KEEP"), "inherited variables are exported");
+
+    variable_store_add_cstr(store, "CHANGE", "new", true, false);
+    variable_store_remove_cstr(store, "GONE");
+    CTEST_ASSERT_STR_EQ(ctest, variable_store_get_value_cstr(store, "CHANGE"), "new", "changed value replaces inherited one");
+    CTEST_ASSERT_FALSE(ctest, variable_store_has_name_cstr(store, "GONE"), "removed inherited variable");
+
+    char *const *envp = variable_store_get_envp(store);
+    bool saw_keep = false;
+    int count = 0;
+    for (int i = 0; envp[i]; i++, count++)
+    {
+        if (envp[i] == test_envp[0])
+            saw_keep = true;
+        CTEST_ASSERT_TRUE(ctest, strcmp(envp[i], "CHANGE=old") != 0, "old value not passed on");
+        CTEST_ASSERT_TRUE(ctest, strcmp(envp[i], "GONE=soon") != 0, "removed variable not passed on");
+    }
+    CTEST_ASSERT_EQ(ctest, count, 3, "KEEP, DUP and CHANGE in envp");
+    CTEST_ASSERT_TRUE(ctest, saw_keep, "unchanged entry passed through as is");
+
+    variable_store_destroy(&store);
+}
+
+CTEST(test_variable_store_import_env)
+{
+    char *test_envp[] = {
+        strdup("HOME=/home/user"),
+        strdup("LANG=C"),
+        NULL
+    };
+
+    variable_store_t *store = variable_store_create_from_envp(test_envp);
+    variable_store_t *clone = variable_store_clone(store);
+    variable_store_import_env(clone);
+    variable_store_destroy(&store);
+    free(test_envp[0]);
+    free(test_envp[1]);
+
+    CTEST_ASSERT_STR_EQ(ctest, variable_store_get_value_cstr(clone, "HOME"), "/home/user", "HOME kept after envp is freed");
+    CTEST_ASSERT_STR_EQ(ctest, variable_store_get_value_cstr(clone, "LANG"), "C", "LANG kept after envp is freed");
+
+    variable_store_destroy(&clone);
+}
+
 // ------------------------------------------------------------
 // Integration Tests
 // ------------------------------------------------------------
@@ -677,6 +739,8 @@ CTEST(test_variable_store_generation_tracking)
             CTEST_ENTRY(test_variable_store_get_envp_empty),
             CTEST_ENTRY(test_variable_store_create_from_envp),
             CTEST_ENTRY(test_variable_store_create_from_envp_with_equals_in_value),
+            CTEST_ENTRY(test_variable_store_create_from_envp_lazy),
+            CTEST_ENTRY(test_variable_store_import_env),
 
             // Integration tests
             CTEST_ENTRY(test_variable_store_complex_scenario),
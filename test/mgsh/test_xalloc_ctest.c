@@ -231,6 +231,32 @@ CTEST(test_arena_xfree_null)
     (void)ctest;
 }
 
+// Test that the arena keeps a running total of bytes requested
+CTEST(test_arena_bytes_allocated)
+{
+    miga_arena_t arena = {0};
+    arena_init_ex(&arena);
+
+    if (setjmp(arena.rollback_point) == 0)
+    {
+        void *a = TEST_ARENA_XMALLOC(&arena, 100);
+        int *b = TEST_ARENA_XCALLOC(&arena, 10, sizeof(int));
+        a = TEST_ARENA_XREALLOC(&arena, a, 200);
+        char *c = TEST_ARENA_XSTRDUP(&arena, "abc");
+        CTEST_ASSERT_EQ(ctest, (long)arena.bytes_allocated, (long)(100 + 10 * sizeof(int) + 200 + 4),
+                        "every allocation is counted at its requested size");
+
+        TEST_ARENA_XFREE(&arena, a);
+        TEST_ARENA_XFREE(&arena, b);
+        TEST_ARENA_XFREE(&arena, c);
+        CTEST_ASSERT_EQ(ctest, (long)arena.bytes_allocated, (long)(100 + 10 * sizeof(int) + 200 + 4),
+                        "freeing does not reduce the total");
+    }
+
+    arena_end_ex(&arena);
+    (void)ctest;
+}
+
 int main(int argc, char **argv)
 {
     (void)argc;
@@ -244,6 +270,7 @@ int main(int argc, char **argv)
         CTEST_ENTRY(test_arena_lifecycle),
         CTEST_ENTRY(test_arena_multiple_allocs),
         CTEST_ENTRY(test_arena_xfree_null),
+        CTEST_ENTRY(test_arena_bytes_allocated),
         NULL
     };
 
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Test plain assignments to variables that already have attributes
+
+# An exported variable stays exported when it is assigned again
+export Q=1
+Q=2
+[ "$(printenv Q)" = 2 ] || exit 1
+
+# So does PATH, extended in place
+PATH=$PATH:/nonexistent
+ls / > /dev/null || exit 1
+
+# A readonly variable cannot be assigned
+readonly R=1
+(R=2) 2>/dev/null && exit 1
+[ "$R" = 1 ] || exit 1
+
+exit 0
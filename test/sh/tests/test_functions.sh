@@ -0,0 +1,64 @@
+#!/bin/sh
+# Test function calls: assignments, local, and positional parameters
+
+# Assignments in a function body change the caller's variables
+setx() { x=set; }
+x=unset
+setx
+[ "$x" = set ] || exit 1
+
+# local restores the caller's value, and callees see the local one
+outer() { local v=inner; inner; [ "$v" = changed ] || exit 1; }
+inner() { [ "$v" = inner ] || exit 1; v=changed; }
+v=outer
+outer
+[ "$v" = outer ] || exit 1
+
+# A local of an unset variable is unset again afterwards
+unset u
+mklocal() { local u=tmp; }
+mklocal
+[ -z "${u+set}" ] || exit 1
+
+# local without a value keeps the current one
+keep() { local v; [ "$v" = outer ] || exit 1; v=temp; }
+keep
+[ "$v" = outer ] || exit 1
+
+# local outside a function is an error
+(local v=top) 2>/dev/null && exit 1
+[ "$v" = outer ] || exit 1
+
+# Recursion gives each call its own local
+fact() {
+    local n=$1
+    if [ "$n" -le 1 ]; then
+        r=1
+    else
+        fact $((n-1))
+        r=$((r*n))
+    fi
+}
+fact 5
+[ "$r" = 120 ] || exit 1
+
+# shift and set in a function called with "$@" leave the caller alone
+set -- a b c
+drop() { shift; [ "$*" = "b c" ] || exit 1; set -- z; [ "$1" = z ] || exit 1; }
+drop "$@"
+[ "$*" = "a b c" ] || exit 1
+nested() { drop "$@"; [ "$*" = "a b c" ] || exit 1; }
+nested "$@"
+[ "$*" = "a b c" ] || exit 1
+
+# Prefix assignments on a function call are undone afterwards
+show() { [ "$p" = temp ] || exit 1; }
+p=orig
+p=temp show
+[ "$p" = orig ] || exit 1
+
+# name=value after the command name is an ordinary argument
+args() { [ "$1" = "k=v" ] || exit 1; }
+args k=v
+
+exit 0
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Test the background job pool: wait -n and miga_jobs_max
+
+# wait -n reports whichever job finishes first
+(sleep 1; exit 3) &
+(exit 5) &
+wait -n
+[ "$?" = 5 ] || exit 1
+wait -n
+[ "$?" = 3 ] || exit 1
+
+# Nothing left to wait for
+wait -n
+[ "$?" = 127 ] || exit 1
+
+# With one slot, the second job starts only after the first has finished
+tmp=/tmp/test_jobs.$$
+miga_jobs_max 1
+(sleep 1; echo first >> "$tmp") &
+echo second >> "$tmp" &
+wait
+[ "$(cat "$tmp")" = "first
+second" ] || exit 1
+rm -f "$tmp"
+
+# A loop body that goes on after the & still runs the job in the
+# background, and wait -n collects every status in turn
+miga_jobs_max 2
+n=0
+for s in 0 1 0 2; do
+    (sleep 0.1; exit $s) &
+    n=$((n+1))
+done
+failed=0
+while [ "$n" -gt 0 ]; do
+    wait -n || failed=$((failed+1))
+    n=$((n-1))
+done
+[ "$failed" = 2 ] || exit 1
+miga_jobs_max 0
+
+exit 0
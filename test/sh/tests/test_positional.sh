@@ -0,0 +1,39 @@
+#!/bin/sh
+# Test "$@" field expansion and shift
+
+count() {
+    echo "$#"
+}
+
+set -- "a b" c "" d
+[ "$(count "$@")" = 4 ] || exit 1
+[ "$(count $@)" = 4 ] || exit 1
+[ "$(count "$*")" = 1 ] || exit 1
+
+for x in "$@"; do out1="$out1[$x]"; done
+[ "$out1" = "[a b][c][][d]" ] || exit 1
+
+# Text around "$@" attaches to the first and last fields
+for x in "<$@>"; do out2="$out2[$x]"; done
+[ "$out2" = "[<a b][c][][d>]" ] || exit 1
+
+# No parameters: "$@" vanishes, but surrounding text still makes a field
+set --
+[ "$(count "$@")" = 0 ] || exit 1
+[ "$(count "x$@")" = 1 ] || exit 1
+
+# Shift through a long argument list
+i=0
+while [ "$i" -lt 500 ]; do words="$words w$i"; i=$((i+1)); done
+set -- $words
+[ "$#" = 500 ] || exit 1
+shift 2
+[ "$1" = w2 ] || exit 1
+n=0
+while [ "$#" -gt 1 ]; do shift; n=$((n+1)); done
+[ "$n" = 497 ] || exit 1
+[ "$1" = w499 ] || exit 1
+shift
+[ "$#" = 0 ] || exit 1
+
+exit 0
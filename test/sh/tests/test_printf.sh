@@ -52,5 +52,9 @@ c" || exit 1
 # Test %c format
 test "$(printf "%c" "A")" = "A" || exit 1
 
+# NUL bytes are written, not dropped
+test "$(printf 'a\0bc%sde\n' Z | od -An -c | tr -d ' \n')" = 'a\0bcZde\n' || exit 1
+test "$(printf '%c|' '' | od -An -c | tr -d ' \n')" = '\0|' || exit 1
+
 echo "All printf tests passed!"
 exit 0
@@ -0,0 +1,79 @@
+#!/bin/sh
+# Test read builtin
+
+set -e
+
+tmpfile="${TMPDIR:-/tmp}/migash_read_test.$$"
+printf 'one two three four\n  lead trail  \nback\\slash\ncont \\\nnued\nlast' > "$tmpfile"
+
+# Test field splitting; the last variable takes the remainder
+read a b c < "$tmpfile"
+test "$a" = "one" || exit 1
+test "$b" = "two" || exit 1
+test "$c" = "three four" || exit 1
+
+# Test successive reads share the file offset
+{
+    read l1
+    read l2
+    read l3
+    read -r l4
+    read l5
+} < "$tmpfile"
+test "$l1" = "one two three four" || exit 1
+test "$l2" = "lead trail" || exit 1
+test "$l3" = "backslash" || exit 1
+test "$l4" = 'cont \' || exit 1
+test "$l5" = "nued" || exit 1
+
+# Test backslash-newline continuation
+{
+    read x
+    read x
+    read x
+    read y
+} < "$tmpfile"
+test "$y" = "cont nued" || exit 1
+
+# Test a command after read sees the rest of a regular file
+{ read x; read x; read x; read x; cat; } < "$tmpfile" > "$tmpfile.rest"
+read rest < "$tmpfile.rest" || true
+test "$rest" = "last" || exit 1
+rm -f "$tmpfile.rest"
+
+# Test end-of-file without a delimiter still assigns, but returns 1
+status=0
+{ read x; read x; read x; read x; read z || status=$?; } < "$tmpfile"
+test "$z" = "last" || exit 1
+test "$status" = "1" || exit 1
+
+# Test IFS with a non-white-space delimiter
+IFS=: read p q r <<EOF
+a:b:c:d
+EOF
+test "$p" = "a" || exit 1
+test "$q" = "b" || exit 1
+test "$r" = "c:d" || exit 1
+
+# Test reading from a pipe
+printf 'x y\nz\n' | { read m n; read o; test "$m-$n-$o" = "x-y-z"; } || exit 1
+
+# Test -d
+printf 'a:b' | { read -d : w; test "$w" = "a"; } || exit 1
+
+# Test while read loop
+n=0
+while read -r line; do
+    n=$((n + 1))
+done < "$tmpfile"
+test "$n" = "5" || exit 1
+
+# Test that NUL bytes are dropped, not treated as delimiters
+printf 'a\000b c\n' > "$tmpfile"
+read x y < "$tmpfile"
+test "$x" = "ab" || exit 1
+test "$y" = "c" || exit 1
+printf 'a\000b c\n' | { read x y; test "$x-$y" = "ab-c"; } || exit 1
+
+rm -f "$tmpfile"
+echo "All read tests passed"
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Test dynamic special parameters: LINENO, $?, $$, $!, $-
+
+[ "$LINENO" = 4 ] || exit 1
+echo "$LINENO" > /dev/null
+[ "$LINENO" = 6 ] || exit 1
+[ $((LINENO+1)) = 8 ] || exit 1
+
+# An assigned LINENO keeps its value; unset, it tracks the line again
+LINENO=100
+[ "$LINENO" = 100 ] || exit 1
+unset LINENO 2>/dev/null
+[ "$LINENO" = 13 ] || exit 1
+
+f() {
+    echo "$LINENO"
+}
+[ "$(f)" = 16 ] || exit 1
+
+# Exit status
+false
+[ "$?" = 1 ] || exit 1
+true
+[ "$?" = 0 ] || exit 1
+
+# Shell PID is set and the same in a command substitution
+[ -n "$$" ] || exit 1
+[ "$(echo $$)" = "$$" ] || exit 1
+
+# No background job yet, then one
+[ -z "$!" ] || exit 1
+sleep 0 &
+[ -n "$!" ] || exit 1
+
+# Option flags
+case "$-" in *u*) exit 1 ;; esac
+set -u
+case "$-" in *u*) ;; *) exit 1 ;; esac
+set +u
+
+# The assigned value is the one exported and used in arithmetic
+LINENO=50
+export LINENO
+[ "$(printenv LINENO)" = 50 ] || exit 1
+[ $((LINENO+1)) = 51 ] || exit 1
+unset LINENO
+
+exit 0
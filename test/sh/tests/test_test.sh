@@ -0,0 +1,62 @@
+#!/bin/sh
+# Test test and [ builtins
+
+set -e
+
+tmpdir="${TMPDIR:-/tmp}/migash_test_test.$$"
+mkdir "$tmpdir"
+: > "$tmpdir/empty"
+echo data > "$tmpdir/full"
+
+# Test string and integer operators
+test abc || exit 1
+test "" && exit 1
+[ -n "x" ] || exit 1
+[ -z "" ] || exit 1
+[ "a" = "a" ] || exit 1
+[ "a" != "b" ] || exit 1
+[ 3 -lt 5 ] || exit 1
+[ 5 -ge 5 ] || exit 1
+test 2 -eq 3 && exit 1
+
+# Test ! and parentheses
+[ ! -e "$tmpdir/missing" ] || exit 1
+test ! "" || exit 1
+[ \( "x" \) ] || exit 1
+[ \( -n "x" \) ] || exit 1
+[ ! "a" = "b" ] || exit 1
+
+# Test file operators
+[ -e "$tmpdir/full" ] || exit 1
+[ -f "$tmpdir/full" ] || exit 1
+[ -d "$tmpdir" ] || exit 1
+[ -f "$tmpdir" ] && exit 1
+[ -s "$tmpdir/full" ] || exit 1
+[ -s "$tmpdir/empty" ] && exit 1
+[ -r "$tmpdir/full" ] || exit 1
+[ -w "$tmpdir/full" ] || exit 1
+[ -x "$tmpdir" ] || exit 1
+[ -e "$tmpdir/missing" ] && exit 1
+ln -s full "$tmpdir/link"
+[ -L "$tmpdir/link" ] || exit 1
+[ -h "$tmpdir/full" ] && exit 1
+[ -f "$tmpdir/link" ] || exit 1
+
+# Test cached results do not outlive a change to the file system
+[ -e "$tmpdir/new" ] && exit 1
+: > "$tmpdir/new"
+[ -e "$tmpdir/new" ] || exit 1
+[ -s "$tmpdir/new" ] || echo more > "$tmpdir/new"
+[ -s "$tmpdir/new" ] || exit 1
+[ -e "$tmpdir/new" ] && rm "$tmpdir/new" && [ ! -e "$tmpdir/new" ] || exit 1
+
+# Test errors return 2
+status=0
+[ 1 -eq x ] 2>/dev/null || status=$?
+test "$status" = "2" || exit 1
+status=0
+[ a b c d e ] 2>/dev/null || status=$?
+test "$status" = "2" || exit 1
+
+rm -rf "$tmpdir"
+echo "All test tests passed"
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Generate src/builtin_table.h and src/builtin_table.c: a read-only,
+perfect-hash table of the reserved words and the standard builtins.
+
+Every name hashes to its own slot, so the executor classifies a command
+name with one probe and one strcmp().  The hash is FNV-1a with the offset
+basis replaced by a seed; this script searches for a seed that gives no
+collisions in a table of TABLE_SIZE slots.
+
+Run it from the top of the source tree after changing the lists below:
+
+    python3 tools/gen_builtin_table.py
+"""
+
+import os
+import sys
+
+TABLE_SIZE = 256  # Must be a power of two
+
+# Must match token_is_reserved_word()
+RESERVED_WORDS = [
+    "if", "then", "else", "elif", "fi", "do", "done", "case", "esac",
+    "while", "until", "for", "in", "{", "}", "!",
+]
+
+# (name, function, class, guard)
+BUILTINS = [
+    # POSIX special builtins
+    ("break", "builtin_break", "SPECIAL", None),
+    (":", "builtin_colon", "SPECIAL", None),
+    ("continue", "builtin_continue", "SPECIAL", None),
+    (".", "builtin_dot", "SPECIAL", None),
+    ("eval", "builtin_eval", "SPECIAL", None),
+    ("exec", "builtin_exec", "SPECIAL", None),
+    ("exit", "builtin_exit", "SPECIAL", None),
+    ("export", "builtin_export", "SPECIAL", None),
+    ("readonly", "builtin_readonly", "SPECIAL", None),
+    ("return", "builtin_return", "SPECIAL", None),
+    ("set", "builtin_set", "SPECIAL", None),
+    ("shift", "builtin_shift", "SPECIAL", None),
+    ("times", "builtin_times", "SPECIAL", None),
+    ("trap", "builtin_trap", "SPECIAL", None),
+    ("unset", "builtin_unset", "SPECIAL", None),
+    # Regular builtins
+    ("cd", "builtin_cd", "REGULAR", "MIGA_UCRT_API"),
+    ("pwd", "builtin_pwd", "REGULAR", "MIGA_UCRT_API"),
+    ("ls", "builtin_ls", "REGULAR", "MIGA_UCRT_API"),
+    ("echo", "builtin_echo", "REGULAR", None),
+    ("printf", "builtin_printf", "REGULAR", None),
+    ("[", "builtin_bracket", "REGULAR", None),
+    ("test", "builtin_test", "REGULAR", None),
+    ("alias", "builtin_alias", "REGULAR", None),
+    ("unalias", "builtin_unalias", "REGULAR", None),
+    ("local", "builtin_local", "REGULAR", None),
+    ("getopts", "builtin_getopts", "REGULAR", None),
+    ("read", "builtin_read", "REGULAR", None),
+    ("jobs", "builtin_jobs", "REGULAR", None),
+    ("kill", "builtin_kill", "REGULAR", None),
+    ("wait", "builtin_wait", "REGULAR", None),
+    ("fg", "builtin_fg", "REGULAR", None),
+    ("bg", "builtin_bg", "REGULAR", None),
+    ("basename", "builtin_basename", "REGULAR", None),
+    ("dirname", "builtin_dirname", "REGULAR", None),
+    ("true", "builtin_true", "REGULAR", None),
+    ("false", "builtin_false", "REGULAR", None),
+    # miga extensions
+    ("miga_dirnamevar", "builtin_miga_dirnamevar", "REGULAR", None),
+    ("miga_printfvar", "builtin_miga_printfvar", "REGULAR", None),
+    ("miga_cat", "builtin_miga_cat", "REGULAR", None),
+    ("miga_jobs_max", "builtin_miga_jobs_max", "REGULAR", None),
+    ("miga_stats", "builtin_miga_stats", "REGULAR", None),
+    ("miga_trace", "builtin_miga_trace", "REGULAR", None),
+]
+
+CLASSES = {
+    "RESERVED": "COMMAND_CLASS_RESERVED_WORD",
+    "SPECIAL": "COMMAND_CLASS_SPECIAL_BUILTIN",
+    "REGULAR": "COMMAND_CLASS_REGULAR_BUILTIN",
+}
+
+HEADER_NOTE = "Generated by tools/gen_builtin_table.py -- do not edit."
+
+
+def fnv1a(name, seed):
+    h = seed
+    for b in name.encode():
+        h ^= b
+        h = (h * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def find_seed(names):
+    mask = TABLE_SIZE - 1
+    for seed in range(2166136261, 2166136261 + 10000000):
+        slots = set()
+        for name in names:
+            slot = fnv1a(name, seed) & mask
+            if slot in slots:
+                break
+            slots.add(slot)
+        else:
+            return seed
+    sys.exit("gen_builtin_table.py: no seed found; make TABLE_SIZE larger")
+
+
+def c_string(name):
+    return '"' + name.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def main():
+    entries = [(w, None, "RESERVED", None) for w in RESERVED_WORDS] + BUILTINS
+    names = [e[0] for e in entries]
+    if len(set(names)) != len(names):
+        sys.exit("gen_builtin_table.py: duplicate name")
+    seed = find_seed(names)
+    mask = TABLE_SIZE - 1
+    slotted = sorted(((fnv1a(e[0], seed) & mask, e) for e in entries), key=lambda x: x[0])
+
+    src = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "src")
+
+    with open(os.path.join(src, "builtin_table.h"), "w") as f:
+        f.write(f"""/**
+ * @file builtin_table.h
+ * @brief Perfect-hash table of the reserved words and standard builtins.
+ *
+ * {HEADER_NOTE}
+ *
+ * Slot i holds the only name whose builtin_table_hash() is i, or a NULL
+ * name.  Only builtin_store.c should use this header.
+ */
+
+#ifndef BUILTIN_TABLE_H
+#define BUILTIN_TABLE_H
+
+#include <stdint.h>
+
+#include "builtin_store.h"
+
+#define BUILTIN_TABLE_SIZE {TABLE_SIZE}u
+#define BUILTIN_TABLE_SEED {seed:#x}u
+
+typedef struct builtin_table_entry_t
+{{
+    const char *name;
+    miga_builtin_fn_t fn; /**< NULL for reserved words */
+    command_class_t command_class;
+}} builtin_table_entry_t;
+
+extern const builtin_table_entry_t builtin_table[BUILTIN_TABLE_SIZE];
+
+#endif /* BUILTIN_TABLE_H */
+""")
+
+    with open(os.path.join(src, "builtin_table.c"), "w") as f:
+        f.write(f"""/**
+ * @file builtin_table.c
+ * @brief Perfect-hash table of the reserved words and standard builtins.
+ *
+ * {HEADER_NOTE}
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "builtin_table.h"
+
+#include "builtins.h"
+
+const builtin_table_entry_t builtin_table[BUILTIN_TABLE_SIZE] = {{
+""")
+        for slot, (name, fn, cls, guard) in slotted:
+            fn_c = f"(miga_builtin_fn_t){fn}" if fn else "NULL"
+            line = f"    [{slot}] = {{{c_string(name)}, {fn_c}, {CLASSES[cls]}}},\n"
+            if guard:
+                f.write(f"#ifdef {guard}\n{line}#endif\n")
+            else:
+                f.write(line)
+        f.write("};\n")
+
+
+if __name__ == "__main__":
+    main()